@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+# Bytes/second microbenchmark for the runtime text kernels (split, trim, lower,
+# index_of, doc_term_counts).
+#
+# This is a developer baseline, not a release assertion. Each engine builds
+# tools/vais_text_kernel_bench.vais with --release, and the tool checks every
+# kernel result before it prints the kernel's rate.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+TOOL="$ROOT/tools/vais_text_kernel_bench.vais"
+ROUNDS="${1:-${VAIS_TEXT_BENCH_ROUNDS:-20}}"
+
+case "$ROUNDS" in
+    ''|*[!0-9]*|0)
+        echo "usage: bash scripts/bench-text-kernels.sh [positive-rounds]" >&2
+        exit 2
+        ;;
+esac
+
+bench_engine() {
+    local engine="$1"
+
+    printf '\n==> %s engine, %s rounds\n' "$engine" "$ROUNDS"
+    set +e
+    "$ROOT/scripts/vaisc" run "$TOOL" --engine "$engine" --release -- "$ROUNDS"
+    local got=$?
+    set -e
+    if [ "$got" -ne 42 ]; then
+        printf "FAIL %s engine: got=%s expect=42\n" "$engine" "$got" >&2
+        exit 1
+    fi
+}
+
+echo "Vais text kernel microbenchmark"
+bench_engine "direct"
+bench_engine "full"
+
+echo
+echo "RESULT: text kernel benchmark completed"
@@ -1,5 +1,13 @@
 #!/usr/bin/env bash
 # Build the native Vais compiler driver.
+#
+# The self-host core IR is split into function-group chunks (a function's
+# chunk comes from a hash of its name, so it stays put as the compiler
+# grows) and the driver C is compiled unit by unit. Every chunk and unit is
+# compiled to an object cached by content hash, up to VAISC_BUILD_JOBS at a
+# time, so a rebuild after a small self-host or driver edit only recompiles
+# the pieces that changed. VAISC_THINLTO=1 compiles to ThinLTO bitcode and
+# links with a ThinLTO cache, restoring inlining across chunks and units.
 set -euo pipefail
 
 HERE="$(cd "$(dirname "$0")/.." && pwd)"
@@ -7,13 +15,18 @@ CLANG="${CLANG:-clang}"
 OUT="${1:-$HERE/build/vaisc}"
 BUILD_DIR="$(dirname "$OUT")"
 CORE="$HERE/compiler/self/vaisc_core.ll"
-DRIVER="$HERE/tools/vaisc_native.c"
-CORE_NATIVE="$BUILD_DIR/vaisc_core_native.$(basename "$OUT").$$.ll"
+DRIVER_HEADER="$HERE/tools/vaisc_native.h"
+DRIVER_UNITS="vaisc_util vaisc_lower vaisc_resolve vaisc_direct vaisc_host_runtime vaisc_build vaisc_native"
+CORE_CHUNKS="${VAISC_CORE_CHUNKS:-16}"
+OBJ_CACHE="${VAISC_OBJ_CACHE:-$HERE/build/vaisc-objcache}"
+JOBS="${VAISC_BUILD_JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}"
+THINLTO="${VAISC_THINLTO:-0}"
 
-mkdir -p "$BUILD_DIR"
-trap 'rm -f "$CORE_NATIVE"' EXIT
+mkdir -p "$BUILD_DIR" "$OBJ_CACHE"
+WORK="$(mktemp -d "$BUILD_DIR/vaisc-build.XXXXXX")"
+trap 'rm -rf "$WORK"; rm -f "$OBJ_CACHE"/*.tmp.$$.*' EXIT
 
-main_count="$(grep -Ec '^define i64 @main\(\)( #[0-9]+)? \{$' "$CORE" || true)"
+main_count="$(grep -Ec '^define i64 @main\(\)( nounwind| #[0-9]+)? \{$' "$CORE" || true)"
 if [ "$main_count" != "1" ]; then
     echo "error: expected one @main in $CORE, found $main_count" >&2
     exit 1
@@ -21,7 +34,7 @@ fi
 
 awk '
     BEGIN { replaced = 0 }
-    /^define i64 @main\(\)( #[0-9]+)? \{$/ && replaced == 0 {
+    /^define i64 @main\(\)( nounwind| #[0-9]+)? \{$/ && replaced == 0 {
         sub("@main", "@vais_selftest_main")
         print
         replaced = 1
@@ -33,11 +46,258 @@ awk '
             exit 2
         }
     }
-' "$CORE" > "$CORE_NATIVE"
+' "$CORE" > "$WORK/core.ll"
 
-if [ "$(uname -s)" = "Darwin" ]; then
-    "$CLANG" -Wno-override-module -O2 -Wl,-stack_size,0x4000000 -o "$OUT" "$CORE_NATIVE" "$DRIVER"
+# Chunk i holds the functions whose name hashes to i, plus private copies of
+# the string constants and internal helpers they reference (the @.sN
+# constants are renumbered per chunk, so their positional names do not leak
+# into unrelated chunks), and declarations for everything else it calls.
+# The core's internal globals are shared state; core-data.ll owns them with
+# hidden linkage and every chunk refers to them as external.
+awk -v chunks="$CORE_CHUNKS" -v dir="$WORK" '
+    function name_hash(s,    h, i) {
+        h = 0
+        for (i = 1; i <= length(s); i++) h = (h * 31 + ord[substr(s, i, 1)]) % 1000003
+        return h
+    }
+    function define_name(line) {
+        match(line, /@[-A-Za-z0-9_.$]+\(/)
+        return substr(line, RSTART + 1, RLENGTH - 2)
+    }
+    function declare_of(line,    head, at, params, n, parts, i, p, out) {
+        head = line
+        sub(/^define (internal |weak )?/, "", head)
+        sub(/ \{$/, "", head)
+        sub(/\)[^)]*$/, ")", head)
+        at = index(head, "(")
+        params = substr(head, at + 1)
+        sub(/\)$/, "", params)
+        out = ""
+        n = split(params, parts, ", ")
+        for (i = 1; i <= n; i++) {
+            p = parts[i]
+            sub(/ %[^ ]*$/, "", p)
+            out = out (i > 1 ? ", " : "") p
+        }
+        return "declare " substr(head, 1, at) out ")"
+    }
+    function global_type(line,    rest) {
+        rest = line
+        sub(/^[^=]*= internal global /, "", rest)
+        if (substr(rest, 1, 1) == "[") return substr(rest, 1, index(rest, "]"))
+        sub(/ .*/, "", rest)
+        return rest
+    }
+    function note_refs(fn, line,    ref) {
+        while (match(line, /@[-A-Za-z0-9_.$]+/)) {
+            ref = substr(line, RSTART + 1, RLENGTH - 1)
+            line = substr(line, RSTART + RLENGTH)
+            if (!((fn, ref) in seen)) {
+                seen[fn, ref] = 1
+                refs[fn] = refs[fn] " " ref
+            }
+        }
+    }
+    function rename_line(line,    out, ref) {
+        out = ""
+        while (match(line, /@\.s[0-9]+/)) {
+            ref = substr(line, RSTART + 1, RLENGTH - 1)
+            out = out substr(line, 1, RSTART - 1) "@" local_name[ref]
+            line = substr(line, RSTART + RLENGTH)
+        }
+        return out line
+    }
+    function want(ref) {
+        if (ref in wanted) return
+        wanted[ref] = 1
+        want_order[++want_count] = ref
+    }
+    BEGIN {
+        for (i = 32; i < 127; i++) ord[sprintf("%c", i)] = i
+    }
+    /^define / {
+        cur = define_name($0)
+        fn_order[++fn_count] = cur
+        fn_first[cur] = ++line_count
+        text[line_count] = $0
+        fn_decl[cur] = declare_of($0)
+        if ($2 == "internal") {
+            fn_chunk[cur] = -1
+        } else {
+            fn_chunk[cur] = name_hash(cur) % chunks
+        }
+        in_fn = 1
+        next
+    }
+    in_fn {
+        text[++line_count] = $0
+        if ($0 == "}") {
+            fn_last[cur] = line_count
+            in_fn = 0
+        } else {
+            note_refs(cur, $0)
+        }
+        next
+    }
+    /^declare / {
+        ext_decl[define_name($0)] = $0
+        next
+    }
+    /^@/ {
+        g = substr($1, 2)
+        if ($0 ~ /^@[-A-Za-z0-9_.$]+ = internal global /) {
+            shared[g] = global_type($0)
+            shared_line[g] = $0
+            shared_order[++shared_count] = g
+        } else {
+            const_line[g] = $0
+        }
+        next
+    }
+    END {
+        data = dir "/core-data.ll"
+        printf "" > data
+        for (i = 1; i <= shared_count; i++) {
+            line = shared_line[shared_order[i]]
+            sub(/ = internal global /, " = hidden global ", line)
+            print line > data
+        }
+        close(data)
+        for (c = 0; c < chunks; c++) {
+            split("", wanted)
+            split("", want_order)
+            split("", helper)
+            split("", local_name)
+            want_count = 0
+            for (i = 1; i <= fn_count; i++) {
+                if (fn_chunk[fn_order[i]] == c) want(fn_order[i])
+            }
+            # Pull in referenced internal helpers transitively.
+            for (w = 1; w <= want_count; w++) {
+                n = split(refs[want_order[w]], parts, " ")
+                for (k = 1; k <= n; k++) {
+                    if ((parts[k] in fn_chunk) && fn_chunk[parts[k]] == -1) {
+                        helper[parts[k]] = 1
+                        want(parts[k])
+                    }
+                }
+            }
+            file = sprintf("%s/core-%02d.ll", dir, c)
+            printf "" > file
+            locals = 0
+            split("", emitted)
+            for (w = 1; w <= want_count; w++) {
+                n = split(refs[want_order[w]], parts, " ")
+                for (k = 1; k <= n; k++) {
+                    ref = parts[k]
+                    if (ref in emitted) continue
+                    emitted[ref] = 1
+                    if (ref in const_line) {
+                        line = const_line[ref]
+                        if (ref ~ /^\.s[0-9]+$/) {
+                            local_name[ref] = ".c" locals++
+                            line = "@" local_name[ref] substr(line, length(ref) + 2)
+                        }
+                        print line > file
+                    } else if (ref in shared) {
+                        print "@" ref " = external hidden global " shared[ref] > file
+                    } else if (ref in ext_decl) {
+                        print ext_decl[ref] > file
+                    } else if ((ref in fn_chunk) && fn_chunk[ref] != c && fn_chunk[ref] != -1) {
+                        print fn_decl[ref] > file
+                    }
+                }
+            }
+            for (i = 1; i <= fn_count; i++) {
+                name = fn_order[i]
+                if (fn_chunk[name] != c && !(name in helper)) continue
+                for (k = fn_first[name]; k <= fn_last[name]; k++) print rename_line(text[k]) > file
+            }
+            close(file)
+        }
+    }
+' "$WORK/core.ll"
+
+if command -v sha256sum >/dev/null 2>&1; then
+    content_hash() { sha256sum | awk '{ print $1 }'; }
+elif command -v shasum >/dev/null 2>&1; then
+    content_hash() { shasum -a 256 | awk '{ print $1 }'; }
 else
-    "$CLANG" -Wno-override-module -O2 -o "$OUT" "$CORE_NATIVE" "$DRIVER"
+    content_hash() { cksum | awk '{ print $1 "-" $2 }'; }
 fi
-echo "built: $OUT"
+
+CC_FLAGS="-O2"
+LL_FLAGS="-Wno-override-module -O2"
+LINK_FLAGS=""
+obj_ext="o"
+if [ "$THINLTO" = "1" ]; then
+    CC_FLAGS="$CC_FLAGS -flto=thin"
+    LL_FLAGS="$LL_FLAGS -flto=thin"
+    obj_ext="thin.o"
+    mkdir -p "$OBJ_CACHE/thinlto"
+    if [ "$(uname -s)" = "Darwin" ]; then
+        LINK_FLAGS="-flto=thin -Wl,-cache_path_lto,$OBJ_CACHE/thinlto"
+    else
+        LINK_FLAGS="-flto=thin -fuse-ld=lld -Wl,--thinlto-cache-dir=$OBJ_CACHE/thinlto"
+    fi
+fi
+if [ "$(uname -s)" = "Darwin" ]; then
+    LINK_FLAGS="$LINK_FLAGS -Wl,-stack_size,0x4000000"
+fi
+clang_id="$("$CLANG" --version 2>/dev/null | head -n 1)"
+
+# Adds the cached object for a source to $objects, compiling it in the
+# background when it is not cached yet. Objects are written under a
+# temporary name and renamed, so an interrupted build never leaves a
+# truncated cache entry.
+pids=""
+pending=0
+started=0
+total=0
+objects=""
+failed=0
+wait_oldest() {
+    local first="${pids%% *}"
+    pids="${pids#* }"
+    pending=$((pending - 1))
+    if ! wait "$first"; then failed=1; fi
+}
+compile_cached() {
+    local src="$1" flags="$2" key obj
+    shift 2
+    key="$({ printf '%s\n%s\n' "$clang_id" "$flags"; cat "$@" "$src"; } | content_hash)"
+    obj="$OBJ_CACHE/$key.$obj_ext"
+    case "$objects " in
+        *" $obj "*) return 0 ;;
+    esac
+    objects="$objects $obj"
+    total=$((total + 1))
+    if [ -f "$obj" ]; then
+        touch "$obj"
+        return 0
+    fi
+    if [ "$pending" -ge "$JOBS" ]; then wait_oldest; fi
+    started=$((started + 1))
+    ( "$CLANG" $flags -c -o "$obj.tmp.$$.$started" "$src" && mv "$obj.tmp.$$.$started" "$obj" ) &
+    pids="$pids$! "
+    pending=$((pending + 1))
+}
+
+compile_cached "$WORK/core-data.ll" "$LL_FLAGS"
+c=0
+while [ "$c" -lt "$CORE_CHUNKS" ]; do
+    compile_cached "$(printf '%s/core-%02d.ll' "$WORK" "$c")" "$LL_FLAGS"
+    c=$((c + 1))
+done
+for unit in $DRIVER_UNITS; do
+    compile_cached "$HERE/tools/$unit.c" "$CC_FLAGS" "$DRIVER_HEADER"
+done
+while [ "$pending" -gt 0 ]; do wait_oldest; done
+if [ "$failed" != "0" ]; then
+    echo "error: native driver compile failed" >&2
+    exit 1
+fi
+
+"$CLANG" $LINK_FLAGS -o "$OUT" $objects
+find "$OBJ_CACHE" -maxdepth 1 -name '*.o' -mtime +14 -exec rm -f {} + 2>/dev/null || true
+echo "built: $OUT ($started of $total objects compiled)"
@@ -2,7 +2,8 @@
 set -euo pipefail
 
 ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
-tmp="$(mktemp -d)"
+# Physical path: preflight reports canonical paths, and so must the checkers.
+tmp="$(cd "$(mktemp -d)" && pwd -P)"
 trap 'rm -rf "$tmp"' EXIT
 
 "$ROOT/scripts/vaisc" run "$ROOT/tools/vais_import_graph_contract_check.vais" -- "$ROOT" "$tmp/work"
@@ -3,7 +3,8 @@
 set -uo pipefail
 
 ROOT="$(cd "$(dirname "$0")/.." && pwd)"
-tmp="$(mktemp -d)"
+# Physical path: preflight reports canonical paths, and so must the checkers.
+tmp="$(cd "$(mktemp -d)" && pwd -P)"
 trap 'rm -rf "$tmp"' EXIT INT TERM
 
 "$ROOT/scripts/vaisc" run "$ROOT/tools/vais_manifest_contract_check.vais" -- "$ROOT" "$tmp/work"
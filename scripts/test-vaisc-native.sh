@@ -9,12 +9,13 @@ trap 'rm -rf "$tmp"' EXIT INT TERM
 
 native_tmp="$tmp/native-tmp"
 mkdir -p "$native_tmp"
+native_cache="$tmp/native-cache"
 
 native_tmp_count() {
     find "$native_tmp" -maxdepth 1 -mindepth 1 -type d -name 'vaisc-native-*' 2>/dev/null | wc -l | tr -d ' '
 }
 
-TMPDIR="$native_tmp" "$HERE/scripts/vaisc" run "$HERE/tools/vaisc_native_check.vais" -- "$HERE" "$tmp/work"
+TMPDIR="$native_tmp" VAISC_CACHE_DIR="$native_cache" "$HERE/scripts/vaisc" run "$HERE/tools/vaisc_native_check.vais" -- "$HERE" "$tmp/work"
 rc=$?
 if [ "$rc" -ne 0 ]; then
     exit "$rc"
@@ -26,3 +27,109 @@ if [ "$leftover" != "0" ]; then
     find "$native_tmp" -maxdepth 1 -mindepth 1 -type d -name 'vaisc-native-*' -print >&2
     exit 1
 fi
+
+# Builds link precompiled runtime objects from the cache instead of
+# regenerating and recompiling host_runtime.c (and the direct prelude) each time.
+for runtime in host-runtime direct-runtime; do
+    if ! ls "$native_cache/runtime/$runtime-"*.o >/dev/null 2>&1; then
+        echo "error: native vaisc did not cache a $runtime object in $native_cache/runtime" >&2
+        exit 1
+    fi
+done
+if ! ls "$native_cache/build/"*.bin >/dev/null 2>&1; then
+    echo "error: native vaisc did not populate the build cache in $native_cache/build" >&2
+    exit 1
+fi
+if ! ls "$native_cache/modules/"*.mod >/dev/null 2>&1; then
+    echo "error: native vaisc did not populate the module cache in $native_cache/modules" >&2
+    exit 1
+fi
+
+# `vaisc serve` runs forwarded commands with the client's stdio, directory, and
+# environment, and the client exits with the command's status.
+serve_sock="$tmp/serve.sock"
+VAISC_CACHE_DIR="$native_cache" "$HERE/build/vaisc" serve --socket "$serve_sock" >"$tmp/serve.log" 2>&1 &
+serve_pid=$!
+trap 'kill "$serve_pid" 2>/dev/null; rm -rf "$tmp"' EXIT INT TERM
+for _ in $(seq 100); do
+    [ -S "$serve_sock" ] && break
+    sleep 0.1
+done
+serve_mode="$(stat -c %a "$serve_sock" 2>/dev/null || stat -f %Lp "$serve_sock")"
+if [ "$serve_mode" != "600" ]; then
+    echo "error: vaisc serve socket mode is $serve_mode, expected 600" >&2
+    exit 1
+fi
+printf 'fn main() -> Int {\n    print("served")\n    return 42\n}\n' >"$tmp/serve_ok.vais"
+printf 'fn main() -> Int {\n    return missing_helper()\n}\n' >"$tmp/serve_bad.vais"
+served_out="$(cd "$tmp" && VAISC_SERVER="$serve_sock" VAISC_CACHE_DIR="$native_cache" "$HERE/build/vaisc" run serve_ok.vais)"
+served_rc=$?
+if [ "$served_rc" != "42" ] || [ "$served_out" != "served" ]; then
+    echo "error: vaisc serve run returned rc=$served_rc output=$served_out" >&2
+    exit 1
+fi
+VAISC_SERVER="$serve_sock" "$HERE/build/vaisc" emit-ir "$tmp/serve_ok.vais" -o "$tmp/serve_remote.ll"
+"$HERE/build/vaisc" emit-ir "$tmp/serve_ok.vais" -o "$tmp/serve_local.ll"
+if ! cmp -s "$tmp/serve_remote.ll" "$tmp/serve_local.ll"; then
+    echo "error: vaisc serve emit-ir differs from a local emit-ir" >&2
+    exit 1
+fi
+if VAISC_SERVER="$serve_sock" "$HERE/build/vaisc" check "$tmp/serve_bad.vais" 2>"$tmp/serve_bad.err"; then
+    echo "error: vaisc serve check accepted a call to an unknown function" >&2
+    exit 1
+fi
+if ! grep -q "call to an unknown function" "$tmp/serve_bad.err"; then
+    echo "error: vaisc serve check did not forward the diagnostic" >&2
+    cat "$tmp/serve_bad.err" >&2
+    exit 1
+fi
+kill "$serve_pid"
+wait "$serve_pid" 2>/dev/null
+if [ -e "$serve_sock" ]; then
+    echo "error: vaisc serve left its socket behind after SIGTERM" >&2
+    exit 1
+fi
+
+# Optimized builds probe once whether clang can link -flto and cache the
+# answer. A toolchain without LTO gets a plain optimized link with no
+# diagnostics instead of a failed LTO link and a retry.
+printf '#!/bin/sh\nfor arg in "$@"; do\n    if [ "$arg" = -flto ]; then\n        echo "clang: error: no LTO plugin" >&2\n        exit 1\n    fi\ndone\nexec "${CLANG:-clang}" "$@"\n' >"$tmp/clang-nolto"
+chmod +x "$tmp/clang-nolto"
+nolto_cache="$tmp/nolto-cache"
+for _ in 1 2; do
+    if ! VAISC_CACHE_DIR="$nolto_cache" "$HERE/build/vaisc" build "$tmp/serve_ok.vais" -o "$tmp/nolto_bin" --release --no-cache --clang "$tmp/clang-nolto" 2>"$tmp/nolto.err"; then
+        echo "error: vaisc --release build failed with a clang that lacks LTO" >&2
+        cat "$tmp/nolto.err" >&2
+        exit 1
+    fi
+    if [ -s "$tmp/nolto.err" ]; then
+        echo "error: vaisc --release build without LTO support printed diagnostics" >&2
+        cat "$tmp/nolto.err" >&2
+        exit 1
+    fi
+done
+"$tmp/nolto_bin" >/dev/null
+if [ "$?" != "42" ] || [ "$(cat "$nolto_cache/runtime/lto-"* 2>/dev/null)" != "0" ]; then
+    echo "error: vaisc did not cache a negative LTO probe or the non-LTO build is wrong" >&2
+    exit 1
+fi
+
+# `vaisc build-many` builds a list of entries through a bounded job pool and
+# reports per-entry PASS/FAIL lines plus the summed RESULT line.
+printf 'fn main() -> Int {\n    return 7\n}\n' >"$tmp/many_seven.vais"
+printf '%s %s\n' "$tmp/serve_ok.vais" "$tmp/many_ok" "$tmp/many_seven.vais" "$tmp/many_seven" "$tmp/serve_bad.vais" "$tmp/many_bad" >"$tmp/many.list"
+VAISC_CACHE_DIR="$native_cache" "$HERE/build/vaisc" build-many "$tmp/many.list" -j 2 >"$tmp/many.out" 2>"$tmp/many.err"
+many_rc=$?
+if [ "$many_rc" = "0" ] || ! grep -q '^RESULT: pass=2 fail=1 skip=0$' "$tmp/many.out"; then
+    echo "error: vaisc build-many rc=$many_rc did not report two passes and one failure" >&2
+    cat "$tmp/many.out" "$tmp/many.err" >&2
+    exit 1
+fi
+"$tmp/many_ok" >/dev/null
+ok_rc=$?
+"$tmp/many_seven"
+seven_rc=$?
+if [ "$ok_rc" != "42" ] || [ "$seven_rc" != "7" ]; then
+    echo "error: vaisc build-many binaries returned $ok_rc and $seven_rc, want 42 and 7" >&2
+    exit 1
+fi
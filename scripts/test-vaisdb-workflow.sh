@@ -290,7 +290,18 @@ printf 'prep = /usr/bin/true\nbuild = /bin/echo built\nfail = /usr/bin/false\nbr
 expect_exit "vaismake deps run first" 0 "$vmake_dist/bin/vaismake" "$vmake_dep_tasks" build
 expect_exit "vaismake dep failure stops" 1 "$vmake_dist/bin/vaismake" "$vmake_dep_tasks" broken
 expect_exit "vaismake dep cycle detected" 4 "$vmake_dist/bin/vaismake" "$vmake_dep_tasks" loopa
-expect_exit "vaismake gates.tasks parses" 15 "$vmake_dist/bin/vaismake" "$ROOT/tools/gates.tasks"
+vmake_par_tasks="$tmp/vaismake-par-tasks.txt"
+printf 'prep = /bin/echo ready\nleft = /bin/sleep 1\nright = /bin/sleep 1\nall = /bin/echo done\nfail = /nonexistent/vaismake-tool\nafter = /bin/echo never\n!needs left prep\n!needs right prep\n!needs all left right\n!needs after fail\n' > "$vmake_par_tasks"
+expect_exit "vaismake -j runs the graph" 0 "$vmake_dist/bin/vaismake" -j 2 "$vmake_par_tasks" all
+expect_exit "vaismake -j propagates failure" 127 "$vmake_dist/bin/vaismake" -j 2 "$vmake_par_tasks" after
+expect_exit "vaismake -j cycle detected" 4 "$vmake_dist/bin/vaismake" -j 2 "$vmake_dep_tasks" loopa
+expect_exit "vaismake -j needs a job count" 1 "$vmake_dist/bin/vaismake" -j 0 "$vmake_par_tasks" all
+vmake_par_out="$("$vmake_dist/bin/vaismake" -j 2 "$vmake_par_tasks" all)"
+case "$vmake_par_out" in
+    *"[prep] ready"*"[all] done"*"critical path: prep -> "*" -> all ("*) ;;
+    *) echo "error: vaismake -j output missing prefixes or timing: $vmake_par_out" >&2; exit 1 ;;
+esac
+expect_exit "vaismake gates.tasks parses" 17 "$vmake_dist/bin/vaismake" "$ROOT/tools/gates.tasks"
 
 vfmt_dist="$tmp/vaisfmt-dist"
 vfmt_src="$tmp/vaisfmt-src"
@@ -322,6 +333,27 @@ expect_exit "vaisbench propagates failure" 1 "$vbench_dist/bin/vaisbench" 3 /usr
 expect_exit "vaisbench rejects bad count" 2 "$vbench_dist/bin/vaisbench" 0 /usr/bin/true
 expect_exit "vaisbench budget passes" 0 "$vbench_dist/bin/vaisbench" -b 60000 2 /usr/bin/true
 expect_exit "vaisbench budget exceeded" 3 "$vbench_dist/bin/vaisbench" -b -1 2 /usr/bin/true
+vbench_json="$tmp/vaisbench-suite.json"
+expect_exit "vaisbench micro suite" 0 sh -c '"$1" --suite 1000 workflow > "$2"' sh "$vbench_dist/bin/vaisbench" "$vbench_json"
+if ! grep -q '"name": "snapshot_load", "size": 1000' "$vbench_json"; then
+    echo "error: vaisbench --suite JSON is missing the snapshot_load result" >&2
+    exit 1
+fi
+expect_exit "vaisbench compare passes" 0 "$vbench_dist/bin/vaisbench" --compare "$vbench_json" 100000
+vbench_fast="$tmp/vaisbench-fast.json"
+sed 's/"median_ns": [0-9]*/"median_ns": 1/' "$vbench_json" > "$vbench_fast"
+expect_exit "vaisbench compare regression" 3 "$vbench_dist/bin/vaisbench" --compare "$vbench_fast"
+expect_exit "vaisbench compare missing baseline" 2 "$vbench_dist/bin/vaisbench" --compare "$tmp/no-such-baseline.json"
+vbench_prof_bin="$tmp/vaisgrep-instrumented"
+vbench_prof="$tmp/vaisgrep-profile.tsv"
+expect_exit "vaisgrep instrumented build" 0 "$ROOT/scripts/vaisc" build "$ROOT/examples/e341_vaisgrep_package" -o "$vbench_prof_bin" --instrument
+expect_exit "vaisgrep instrumented run" 6 env VAIS_PROFILE_OUT="$vbench_prof" "$vbench_prof_bin" -r cache "$vgrep_docs"
+vbench_prof_out="$("$vbench_dist/bin/vaisbench" --profile "$vbench_prof" 5)"
+case "$vbench_prof_out" in
+    *"functions by self "*"vaisgrep_package/src/"*"loops by "*"allocation sites by bytes"*) ;;
+    *) echo "error: vaisbench --profile output is missing its tables: $vbench_prof_out" >&2; exit 1 ;;
+esac
+expect_exit "vaisbench profile rejects other text" 2 "$vbench_dist/bin/vaisbench" --profile "$vbench_json"
 
 vdiff_dist="$tmp/vaisdiff-dist"
 rm -rf "$vdiff_dist"
@@ -363,12 +395,12 @@ expect_exit "vaisbox dispatch grep pipe" 2 /bin/sh -c "printf 'cache x\nplain\nc
 expect_exit "vaisbox unknown tool" 2 /bin/sh -c "'$vbox_bin/vaisbox' nope < /dev/null 2>/dev/null"
 expect_exit "vaisbox missing sibling guard" 3 /bin/sh -c "'$vbox_dist/bin/vaisbox' vaisdb x < /dev/null 2>/dev/null"
 
-overflow_src="$tmp/list-cap-overflow.vais"
-cat > "$overflow_src" <<'VAIS'
+growth_src="$tmp/list-cap-growth.vais"
+cat > "$growth_src" <<'VAIS'
 fn main() -> Int {
     let b = str_builder_new()
     let mut k = 0
-    while k < 4200 {
+    while k < 1048600 {
         let r1 = str_builder_append(b, "x")
         let r2 = str_builder_push(b, 10)
         k = k + 1
@@ -379,10 +411,13 @@ fn main() -> Int {
     return n
 }
 VAIS
-expect_exit "list cap overflow full build" 0 "$ROOT/scripts/vaisc" build "$overflow_src" -o "$tmp/list-cap-overflow-full"
-expect_exit "list cap overflow full traps loud" 134 "$tmp/list-cap-overflow-full"
-expect_exit "list cap overflow direct build" 0 "$ROOT/scripts/vaisc" build "$overflow_src" --engine direct -o "$tmp/list-cap-overflow-direct"
-expect_exit "list cap overflow direct traps loud" 134 "$tmp/list-cap-overflow-direct"
+# Lists grow on the heap in both engines, so splitting past the 1048575
+# entries the full engine used to reserve per list keeps every line
+# (1048600 lines exit as 1048600 % 256).
+expect_exit "list cap growth full build" 0 "$ROOT/scripts/vaisc" build "$growth_src" -o "$tmp/list-cap-growth-full"
+expect_exit "list cap growth full keeps every line" 24 "$tmp/list-cap-growth-full"
+expect_exit "list cap growth direct build" 0 "$ROOT/scripts/vaisc" build "$growth_src" --engine direct -o "$tmp/list-cap-growth-direct"
+expect_exit "list cap growth direct keeps every line" 24 "$tmp/list-cap-growth-direct"
 empty_pop_src="$tmp/list-empty-pop.vais"
 cat > "$empty_pop_src" <<'VAIS'
 fn main() -> Int {
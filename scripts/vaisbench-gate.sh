@@ -3,9 +3,16 @@
 # median budget (exit 3 when exceeded). Budgets should sit well above the
 # docs/PERF-BASELINE.md figures (3x or more) so only real regressions fire.
 #   scripts/vaisbench-gate.sh <budget-ms> <runs> <cmd> [args...]
+# With --compare it reruns the in-process runtime micro suite and exits 3
+# when a data-path median grew past the tolerance (percent, default 200)
+# over a saved `vaisbench --suite` document from the same default build:
+#   scripts/vaisbench-gate.sh --compare <baseline.json> [tolerance-pct]
 set -euo pipefail
 HERE="$(cd "$(dirname "$0")/.." && pwd)"
 cd "$HERE"
 dist="$HERE/build/vaisbench-dist"
 "$HERE/scripts/vaisc" package "$HERE/examples/e350_vaisbench_package" -o "$dist" >/dev/null
+if [ "${1:-}" = "--compare" ]; then
+    exec "$dist/bin/vaisbench" "$@"
+fi
 exec "$dist/bin/vaisbench" -b "$@"
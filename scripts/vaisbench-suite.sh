@@ -0,0 +1,24 @@
+#!/usr/bin/env bash
+# Runtime micro suite across both engines and both build profiles: packages
+# vaisbench once per engine/profile pair and writes each run's JSON document
+# to <out-dir>/<engine>-<profile>.json (sizes 1000 up to max-size).
+#   scripts/vaisbench-suite.sh <out-dir> [max-size]
+set -euo pipefail
+HERE="$(cd "$(dirname "$0")/.." && pwd)"
+cd "$HERE"
+if [ "$#" -lt 1 ]; then
+    echo "usage: scripts/vaisbench-suite.sh <out-dir> [max-size]" >&2
+    exit 2
+fi
+out="$1"
+max_size="${2:-100000}"
+mkdir -p "$out"
+for engine in full direct; do
+    for profile in debug release; do
+        dist="$HERE/build/vaisbench-suite/$engine-$profile"
+        "$HERE/scripts/vaisc" package "$HERE/examples/e350_vaisbench_package" -o "$dist" \
+            --engine "$engine" --profile "$profile" >/dev/null
+        "$dist/bin/vaisbench" --suite "$max_size" "$engine-$profile" > "$out/$engine-$profile.json"
+        echo "wrote $out/$engine-$profile.json"
+    done
+done
@@ -1,9 +1,14 @@
 #!/usr/bin/env bash
 # Run the full Vais gate ladder through the vaismake tool itself: build the
 # packaged binary, then let tools/gates.tasks drive every gate via !needs.
+# VAISMAKE_JOBS=N (N > 1) runs ready tasks N at a time through vaismake -j.
 set -euo pipefail
 HERE="$(cd "$(dirname "$0")/.." && pwd)"
 cd "$HERE"
 dist="$HERE/build/vaismake-dist"
 "$HERE/scripts/vaisc" package "$HERE/examples/e344_vaismake_package" -o "$dist" >/dev/null
+jobs="${VAISMAKE_JOBS:-1}"
+if [ "$jobs" -gt 1 ]; then
+    exec "$dist/bin/vaismake" -j "$jobs" tools/gates.tasks "${1:-ladder}"
+fi
 exec "$dist/bin/vaismake" tools/gates.tasks "${1:-ladder}"
@@ -1,8 +1,11 @@
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/wait.h>
@@ -15,7 +18,7 @@ static int64_t vais_argc = 0;
 static char **vais_argv = NULL;
 
 void vais_list_trap(int64_t kind) {
-    if (kind == 3) fprintf(stderr, "vais list trap: capacity exceeded (fixed list contract: 4095 entries)\n");
+    if (kind == 3) fprintf(stderr, "vais list trap: allocation failed\n");
     else if (kind == 2) fprintf(stderr, "vais list trap: empty-list access\n");
     else fprintf(stderr, "vais list trap: index out of range\n");
     abort();
@@ -26,8 +29,13 @@ static void host_trap(const char *name) {
     abort();
 }
 
+/* Full-engine modules define vais_str_alloc over their string region. */
+__attribute__((weak)) char *vais_str_alloc(int64_t bytes) {
+    return (char *)malloc((size_t)bytes);
+}
+
 static char *copy_n(const char *text, size_t len) {
-    char *out = (char *)malloc(len + 1);
+    char *out = vais_str_alloc((int64_t)len + 1);
     if (out == NULL) host_trap("alloc");
     if (len > 0) memcpy(out, text, len);
     out[len] = '\0';
@@ -51,6 +59,18 @@ int64_t time_millis(void) {
     return (int64_t)tv.tv_sec * 1000 + (int64_t)(tv.tv_usec / 1000);
 }
 
+int64_t time_nanos(void) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+    }
+#endif
+    struct timeval tv;
+    if (gettimeofday(&tv, NULL) != 0) return 0;
+    return (int64_t)tv.tv_sec * 1000000000 + (int64_t)tv.tv_usec * 1000;
+}
+
 static const char *vais_self = "";
 
 char *proc_self(void) {
@@ -86,6 +106,121 @@ char *fs_read_text(char *path) {
     return out;
 }
 
+/* fs_map_text maps the file read-only over an anonymous reservation one byte
+   longer than the file, so the byte after the last one is always a NUL: either
+   the zero fill of the file's last page or the spare anonymous page. The
+   mapping stays valid for the rest of the run; the file must not shrink while
+   it is mapped. */
+char *fs_map_text(char *path) {
+    if (path == NULL) host_trap("fs_map_text");
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) host_trap("fs_map_text");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) { close(fd); host_trap("fs_map_text"); }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        char *empty = (char *)calloc(1, 1);
+        if (empty == NULL) host_trap("fs_map_text");
+        return empty;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t span = (size + page) / page * page;
+    char *base = (char *)mmap(NULL, span, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) { close(fd); host_trap("fs_map_text"); }
+    if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, span);
+        close(fd);
+        host_trap("fs_map_text");
+    }
+    close(fd);
+    return base;
+}
+
+/* fs_lines_* stream a file through a fixed read buffer. The current line is
+   copied into one reused buffer, so memory stays bounded by the longest line
+   however large the file is. */
+#define FS_LINES_CHUNK 65536
+
+typedef struct {
+    int fd;
+    int eof;
+    char *buf;
+    size_t pos;
+    size_t end;
+    char *line;
+    size_t line_cap;
+} FsLineReader;
+
+int64_t fs_lines_open(char *path) {
+    if (path == NULL) return 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    FsLineReader *r = (FsLineReader *)calloc(1, sizeof(FsLineReader));
+    if (r == NULL) { close(fd); host_trap("fs_lines_open"); }
+    r->buf = (char *)malloc(FS_LINES_CHUNK);
+    r->line = (char *)malloc(256);
+    if (r->buf == NULL || r->line == NULL) { close(fd); host_trap("fs_lines_open"); }
+    r->fd = fd;
+    r->line_cap = 256;
+    r->line[0] = '\0';
+    return (int64_t)(intptr_t)r;
+}
+
+int64_t fs_lines_next(int64_t handle) {
+    FsLineReader *r = (FsLineReader *)(intptr_t)handle;
+    if (r == NULL) return 0;
+    size_t len = 0;
+    int any = 0;
+    int found = 0;
+    while (!found) {
+        if (r->pos == r->end) {
+            if (r->eof) break;
+            ssize_t got = read(r->fd, r->buf, FS_LINES_CHUNK);
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) host_trap("fs_lines_next");
+            if (got == 0) { r->eof = 1; break; }
+            r->pos = 0;
+            r->end = (size_t)got;
+        }
+        char *start = r->buf + r->pos;
+        char *nl = (char *)memchr(start, '\n', r->end - r->pos);
+        size_t take = nl != NULL ? (size_t)(nl - start) : r->end - r->pos;
+        if (len + take + 1 > r->line_cap) {
+            size_t cap = r->line_cap;
+            while (cap < len + take + 1) cap *= 2;
+            char *line = (char *)realloc(r->line, cap);
+            if (line == NULL) host_trap("fs_lines_next");
+            r->line = line;
+            r->line_cap = cap;
+        }
+        memcpy(r->line + len, start, take);
+        len += take;
+        r->pos += take;
+        any = 1;
+        if (nl != NULL) { r->pos++; found = 1; }
+    }
+    if (len > 0 && r->line[len - 1] == '\r') len--;
+    r->line[len] = '\0';
+    return any;
+}
+
+char *fs_lines_text(int64_t handle) {
+    FsLineReader *r = (FsLineReader *)(intptr_t)handle;
+    if (r == NULL) host_trap("fs_lines_text");
+    return r->line;
+}
+
+int64_t fs_lines_close(int64_t handle) {
+    FsLineReader *r = (FsLineReader *)(intptr_t)handle;
+    if (r == NULL) return 1;
+    close(r->fd);
+    free(r->buf);
+    free(r->line);
+    free(r);
+    return 0;
+}
+
 int64_t fs_write_text(char *path, char *text) {
     if (path == NULL || text == NULL) return 1;
     FILE *fp = fopen(path, "wb");
@@ -157,7 +292,7 @@ char *path_join(char *base, char *child) {
     size_t a = strlen(base);
     size_t b = strlen(child);
     int need_slash = base[a - 1] != '/';
-    char *out = (char *)malloc(a + (size_t)need_slash + b + 1);
+    char *out = vais_str_alloc((int64_t)(a + (size_t)need_slash + b + 1));
     if (out == NULL) host_trap("path_join");
     memcpy(out, base, a);
     size_t pos = a;
@@ -185,7 +320,7 @@ char *str_concat(char *left, char *right) {
     if (left == NULL || right == NULL) host_trap("str_concat");
     size_t a = strlen(left);
     size_t b = strlen(right);
-    char *out = (char *)malloc(a + b + 1);
+    char *out = vais_str_alloc((int64_t)(a + b + 1));
     if (out == NULL) host_trap("str_concat");
     memcpy(out, left, a);
     memcpy(out + a, right, b);
@@ -202,7 +337,7 @@ char *str_slice(char *text, int64_t start, int64_t len) {
 
 char *str_byte(int64_t value) {
     if (value < 0 || value > 255) host_trap("str_byte");
-    char *out = (char *)malloc(2);
+    char *out = vais_str_alloc(2);
     if (out == NULL) host_trap("str_byte");
     out[0] = (char)value;
     out[1] = '\0';
@@ -265,6 +400,1010 @@ char *str_builder_finish(int64_t handle) {
     return copy_n(b->data, b->len);
 }
 
+/* Inverted index behind the index_* builtins: a hashed term dictionary whose
+   postings stay sorted by doc id, plus a doc table that remembers each
+   document's terms so index_remove_doc only touches its own postings. */
+typedef struct {
+    int64_t doc;
+    int64_t tf;
+} VaisPosting;
+
+typedef struct {
+    char *term;
+    uint64_t hash;
+    VaisPosting *items;
+    int64_t len;
+    int64_t cap;
+    int64_t mark;
+    int64_t mark_pos;
+} VaisPostings;
+
+typedef struct {
+    int64_t doc;
+    int64_t *terms;
+    int64_t len;
+    int64_t cap;
+} VaisIndexDoc;
+
+typedef struct {
+    VaisPostings *terms;
+    int64_t term_len;
+    int64_t term_cap;
+    int64_t *term_slots;
+    int64_t term_slot_cap;
+    VaisIndexDoc *docs;
+    int64_t doc_used;
+    int64_t doc_live;
+    int64_t doc_cap;
+    int64_t mark;
+    int64_t *scratch;
+    int64_t scratch_cap;
+    VaisPosting *hits;
+    int64_t hit_len;
+    int64_t hit_cap;
+    char *token;
+    size_t token_cap;
+} VaisIndex;
+
+static void *index_grow(void *data, int64_t *cap, size_t item, int64_t need) {
+    if (need <= *cap) return data;
+    int64_t next = *cap == 0 ? 8 : *cap;
+    while (next < need) next *= 2;
+    void *grown = realloc(data, (size_t)next * item);
+    if (grown == 0) host_trap("index_alloc");
+    *cap = next;
+    return grown;
+}
+
+static VaisIndex *index_ptr(int64_t handle) {
+    if (handle == 0) host_trap("index");
+    return (VaisIndex *)(intptr_t)handle;
+}
+
+static uint64_t index_hash(const char *s, size_t n) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++) h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+    return h;
+}
+
+static int index_space(unsigned char c) {
+    return c == 32 || (c >= 9 && c <= 13);
+}
+
+static void index_rehash_terms(VaisIndex *ix) {
+    int64_t cap = ix->term_slot_cap == 0 ? 64 : ix->term_slot_cap * 2;
+    int64_t *slots = (int64_t *)calloc((size_t)cap, sizeof(int64_t));
+    if (slots == 0) host_trap("index_alloc");
+    for (int64_t t = 0; t < ix->term_len; t++) {
+        int64_t s = (int64_t)(ix->terms[t].hash & (uint64_t)(cap - 1));
+        while (slots[s] != 0) s = (s + 1) & (cap - 1);
+        slots[s] = t + 1;
+    }
+    free(ix->term_slots);
+    ix->term_slots = slots;
+    ix->term_slot_cap = cap;
+}
+
+/* Term id for term[0..n), or -1 when it is absent and create is 0. */
+static int64_t index_term_id(VaisIndex *ix, const char *term, size_t n, int create) {
+    uint64_t h = index_hash(term, n);
+    if (ix->term_slot_cap > 0) {
+        int64_t s = (int64_t)(h & (uint64_t)(ix->term_slot_cap - 1));
+        while (ix->term_slots[s] != 0) {
+            VaisPostings *p = &ix->terms[ix->term_slots[s] - 1];
+            if (p->hash == h && strncmp(p->term, term, n) == 0 && p->term[n] == '\0') return ix->term_slots[s] - 1;
+            s = (s + 1) & (ix->term_slot_cap - 1);
+        }
+    }
+    if (!create) return -1;
+    if ((ix->term_len + 1) * 2 > ix->term_slot_cap) index_rehash_terms(ix);
+    ix->terms = (VaisPostings *)index_grow(ix->terms, &ix->term_cap, sizeof(VaisPostings), ix->term_len + 1);
+    VaisPostings *p = &ix->terms[ix->term_len];
+    memset(p, 0, sizeof(*p));
+    p->term = (char *)malloc(n + 1);
+    if (p->term == 0) host_trap("index_alloc");
+    memcpy(p->term, term, n);
+    p->term[n] = '\0';
+    p->hash = h;
+    int64_t s = (int64_t)(h & (uint64_t)(ix->term_slot_cap - 1));
+    while (ix->term_slots[s] != 0) s = (s + 1) & (ix->term_slot_cap - 1);
+    ix->term_slots[s] = ix->term_len + 1;
+    return ix->term_len++;
+}
+
+/* Slot of doc in the open-addressed doc table (doc -1 = empty, -2 = removed). */
+static int64_t index_doc_slot(VaisIndex *ix, int64_t doc) {
+    if (ix->doc_cap == 0) return -1;
+    int64_t s = (int64_t)(((uint64_t)doc * 11400714819323198485ULL) >> 20) & (ix->doc_cap - 1);
+    while (ix->docs[s].doc != -1) {
+        if (ix->docs[s].doc == doc) return s;
+        s = (s + 1) & (ix->doc_cap - 1);
+    }
+    return -1;
+}
+
+static VaisIndexDoc *index_doc_insert(VaisIndex *ix, int64_t doc) {
+    if ((ix->doc_used + 1) * 2 > ix->doc_cap) {
+        int64_t cap = 64;
+        while (cap < (ix->doc_live + 1) * 4) cap *= 2;
+        VaisIndexDoc *docs = (VaisIndexDoc *)malloc((size_t)cap * sizeof(VaisIndexDoc));
+        if (docs == 0) host_trap("index_alloc");
+        for (int64_t i = 0; i < cap; i++) docs[i].doc = -1;
+        for (int64_t i = 0; i < ix->doc_cap; i++) {
+            if (ix->docs[i].doc < 0) continue;
+            int64_t s = (int64_t)(((uint64_t)ix->docs[i].doc * 11400714819323198485ULL) >> 20) & (cap - 1);
+            while (docs[s].doc != -1) s = (s + 1) & (cap - 1);
+            docs[s] = ix->docs[i];
+        }
+        free(ix->docs);
+        ix->docs = docs;
+        ix->doc_cap = cap;
+        ix->doc_used = ix->doc_live;
+    }
+    int64_t s = (int64_t)(((uint64_t)doc * 11400714819323198485ULL) >> 20) & (ix->doc_cap - 1);
+    while (ix->docs[s].doc >= 0) s = (s + 1) & (ix->doc_cap - 1);
+    if (ix->docs[s].doc == -1) ix->doc_used++;
+    ix->doc_live++;
+    VaisIndexDoc *d = &ix->docs[s];
+    memset(d, 0, sizeof(*d));
+    d->doc = doc;
+    return d;
+}
+
+/* First posting position whose doc is >= doc. */
+static int64_t index_posting_lower(VaisPostings *p, int64_t doc) {
+    int64_t lo = 0;
+    int64_t hi = p->len;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (p->items[mid].doc < doc) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void index_posting_add(VaisIndex *ix, VaisIndexDoc *d, int64_t term, int64_t tf) {
+    VaisPostings *p = &ix->terms[term];
+    int64_t at = p->len > 0 && p->items[p->len - 1].doc < d->doc ? p->len : index_posting_lower(p, d->doc);
+    if (at < p->len && p->items[at].doc == d->doc) {
+        p->items[at].tf += tf;
+        return;
+    }
+    p->items = (VaisPosting *)index_grow(p->items, &p->cap, sizeof(VaisPosting), p->len + 1);
+    memmove(p->items + at + 1, p->items + at, (size_t)(p->len - at) * sizeof(VaisPosting));
+    p->items[at].doc = d->doc;
+    p->items[at].tf = tf;
+    p->len++;
+    d->terms = (int64_t *)index_grow(d->terms, &d->cap, sizeof(int64_t), d->len + 1);
+    d->terms[d->len++] = term;
+}
+
+/* Distinct terms of text with their counts, lowercased like doc_term_counts_into:
+   ids land in ix->scratch, counts in terms[id].mark_pos; returns the token total. */
+static int64_t index_tokenize(VaisIndex *ix, const char *text, int create, int64_t *distinct) {
+    if (text == 0) host_trap("index_text");
+    ix->mark++;
+    int64_t total = 0;
+    int64_t count = 0;
+    size_t i = 0;
+    while (text[i] != '\0') {
+        while (text[i] != '\0' && index_space((unsigned char)text[i])) i++;
+        size_t start = i;
+        while (text[i] != '\0' && !index_space((unsigned char)text[i])) i++;
+        if (i == start) continue;
+        size_t n = i - start;
+        if (n + 1 > ix->token_cap) {
+            ix->token_cap = n + 64;
+            ix->token = (char *)realloc(ix->token, ix->token_cap);
+            if (ix->token == 0) host_trap("index_alloc");
+        }
+        for (size_t k = 0; k < n; k++) {
+            unsigned char c = (unsigned char)text[start + k];
+            ix->token[k] = (char)((c >= 'A' && c <= 'Z') ? c + 32 : c);
+        }
+        ix->token[n] = '\0';
+        total++;
+        int64_t term = index_term_id(ix, ix->token, n, create);
+        if (term < 0) continue;
+        VaisPostings *p = &ix->terms[term];
+        if (p->mark != ix->mark) {
+            p->mark = ix->mark;
+            p->mark_pos = 0;
+            ix->scratch = (int64_t *)index_grow(ix->scratch, &ix->scratch_cap, sizeof(int64_t), count + 1);
+            ix->scratch[count++] = term;
+        }
+        p->mark_pos++;
+    }
+    *distinct = count;
+    return total;
+}
+
+int64_t index_new(void) {
+    VaisIndex *ix = (VaisIndex *)calloc(1, sizeof(VaisIndex));
+    if (ix == 0) host_trap("index_new");
+    return (int64_t)(intptr_t)ix;
+}
+
+int64_t index_remove_doc(int64_t handle, int64_t doc) {
+    VaisIndex *ix = index_ptr(handle);
+    int64_t s = index_doc_slot(ix, doc);
+    if (s < 0) return 0;
+    VaisIndexDoc *d = &ix->docs[s];
+    for (int64_t i = 0; i < d->len; i++) {
+        VaisPostings *p = &ix->terms[d->terms[i]];
+        int64_t at = index_posting_lower(p, doc);
+        if (at < p->len && p->items[at].doc == doc) {
+            memmove(p->items + at, p->items + at + 1, (size_t)(p->len - at - 1) * sizeof(VaisPosting));
+            p->len--;
+        }
+    }
+    free(d->terms);
+    memset(d, 0, sizeof(*d));
+    d->doc = -2;
+    ix->doc_live--;
+    return 1;
+}
+
+int64_t index_add_doc(int64_t handle, int64_t doc, char *text) {
+    VaisIndex *ix = index_ptr(handle);
+    if (doc < 0) host_trap("index_add_doc");
+    index_remove_doc(handle, doc);
+    int64_t distinct = 0;
+    int64_t total = index_tokenize(ix, text, 1, &distinct);
+    VaisIndexDoc *d = index_doc_insert(ix, doc);
+    for (int64_t i = 0; i < distinct; i++) {
+        int64_t term = ix->scratch[i];
+        index_posting_add(ix, d, term, ix->terms[term].mark_pos);
+    }
+    return total;
+}
+
+int64_t index_add_term(int64_t handle, int64_t doc, char *term, int64_t tf) {
+    VaisIndex *ix = index_ptr(handle);
+    if (doc < 0 || term == 0 || tf <= 0) host_trap("index_add_term");
+    int64_t s = index_doc_slot(ix, doc);
+    VaisIndexDoc *d = s >= 0 ? &ix->docs[s] : index_doc_insert(ix, doc);
+    index_posting_add(ix, d, index_term_id(ix, term, strlen(term), 1), tf);
+    return tf;
+}
+
+int64_t index_doc_count(int64_t handle) {
+    return index_ptr(handle)->doc_live;
+}
+
+typedef struct {
+    VaisPosting *items;
+    int64_t len;
+    int64_t pos;
+    int64_t weight;
+} VaisIndexCursor;
+
+static void index_cursor_sift(VaisIndexCursor *c, int64_t n, int64_t i) {
+    for (;;) {
+        int64_t m = i;
+        int64_t l = 2 * i + 1;
+        int64_t r = l + 1;
+        if (l < n && c[l].items[c[l].pos].doc < c[m].items[c[m].pos].doc) m = l;
+        if (r < n && c[r].items[c[r].pos].doc < c[m].items[c[m].pos].doc) m = r;
+        if (m == i) return;
+        VaisIndexCursor t = c[i];
+        c[i] = c[m];
+        c[m] = t;
+        i = m;
+    }
+}
+
+/* Hits reuse VaisPosting as (doc, score); a worse hit has the lower score,
+   or the higher doc id on a tie. */
+static int index_hit_worse(VaisPosting a, VaisPosting b) {
+    return a.tf < b.tf || (a.tf == b.tf && a.doc > b.doc);
+}
+
+static void index_hit_sift(VaisPosting *h, int64_t n, int64_t i) {
+    for (;;) {
+        int64_t w = i;
+        int64_t l = 2 * i + 1;
+        int64_t r = l + 1;
+        if (l < n && index_hit_worse(h[l], h[w])) w = l;
+        if (r < n && index_hit_worse(h[r], h[w])) w = r;
+        if (w == i) return;
+        VaisPosting t = h[i];
+        h[i] = h[w];
+        h[w] = t;
+        i = w;
+    }
+}
+
+/* Scores every document that shares a term with query (the sum of query tf
+   times doc tf, as in doc_term_weighted_score) by merging the query terms'
+   postings through a heap of cursors, and keeps the best k in a min-heap.
+   Returns the hit count; index_hit_doc/index_hit_score read them best first. */
+int64_t index_top_k(int64_t handle, char *query, int64_t k) {
+    VaisIndex *ix = index_ptr(handle);
+    ix->hit_len = 0;
+    int64_t distinct = 0;
+    index_tokenize(ix, query, 0, &distinct);
+    if (k <= 0 || distinct == 0) return 0;
+    VaisIndexCursor *c = (VaisIndexCursor *)malloc((size_t)distinct * sizeof(VaisIndexCursor));
+    if (c == 0) host_trap("index_alloc");
+    int64_t n = 0;
+    for (int64_t i = 0; i < distinct; i++) {
+        VaisPostings *p = &ix->terms[ix->scratch[i]];
+        if (p->len == 0) continue;
+        c[n].items = p->items;
+        c[n].len = p->len;
+        c[n].pos = 0;
+        c[n].weight = p->mark_pos;
+        n++;
+    }
+    for (int64_t i = n / 2 - 1; i >= 0; i--) index_cursor_sift(c, n, i);
+    int64_t cap = k < ix->doc_live ? k : ix->doc_live;
+    ix->hits = (VaisPosting *)index_grow(ix->hits, &ix->hit_cap, sizeof(VaisPosting), cap + 1);
+    while (n > 0) {
+        VaisPosting hit;
+        hit.doc = c[0].items[c[0].pos].doc;
+        hit.tf = 0;
+        while (n > 0 && c[0].items[c[0].pos].doc == hit.doc) {
+            hit.tf += c[0].weight * c[0].items[c[0].pos].tf;
+            c[0].pos++;
+            if (c[0].pos == c[0].len) c[0] = c[--n];
+            index_cursor_sift(c, n, 0);
+        }
+        if (ix->hit_len < cap) {
+            int64_t i = ix->hit_len++;
+            ix->hits[i] = hit;
+            while (i > 0 && index_hit_worse(ix->hits[i], ix->hits[(i - 1) / 2])) {
+                VaisPosting t = ix->hits[i];
+                ix->hits[i] = ix->hits[(i - 1) / 2];
+                ix->hits[(i - 1) / 2] = t;
+                i = (i - 1) / 2;
+            }
+        } else if (cap > 0 && index_hit_worse(ix->hits[0], hit)) {
+            ix->hits[0] = hit;
+            index_hit_sift(ix->hits, cap, 0);
+        }
+    }
+    free(c);
+    for (int64_t end = ix->hit_len - 1; end > 0; end--) {
+        VaisPosting t = ix->hits[0];
+        ix->hits[0] = ix->hits[end];
+        ix->hits[end] = t;
+        index_hit_sift(ix->hits, end, 0);
+    }
+    return ix->hit_len;
+}
+
+int64_t index_hit_doc(int64_t handle, int64_t i) {
+    VaisIndex *ix = index_ptr(handle);
+    if (i < 0 || i >= ix->hit_len) host_trap("index_hit_doc");
+    return ix->hits[i].doc;
+}
+
+int64_t index_hit_score(int64_t handle, int64_t i) {
+    VaisIndex *ix = index_ptr(handle);
+    if (i < 0 || i >= ix->hit_len) host_trap("index_hit_score");
+    return ix->hits[i].tf;
+}
+
+/* Binary snapshot store behind the snap_* builtins. A snapshot file is
+ * "VAISSNP1", the user version, the entry count, and a key-sorted offset
+ * table over 8-byte aligned {klen, vlen, key NUL, value NUL} records, all
+ * in native byte order; an empty file is an empty store. snap_open maps it
+ * read-only and binary-searches it in place; puts and removes go to an
+ * in-memory overlay and are appended to <path>.log, and snap_compact folds
+ * both into a fresh snapshot. Returned strings point into the mapping or
+ * the overlay and stay valid until snap_close. */
+typedef struct {
+    char *key;
+    char *value;
+    size_t klen;
+    uint64_t hash;
+} VaisSnapDelta;
+
+typedef struct {
+    void *addr;
+    size_t size;
+} VaisSnapMap;
+
+typedef struct {
+    char *path;
+    char *log_path;
+    const unsigned char *base;
+    size_t base_size;
+    int64_t base_count;
+    VaisSnapMap *maps;
+    int64_t map_len;
+    int64_t map_cap;
+    VaisSnapDelta *delta;
+    int64_t delta_len;
+    int64_t delta_cap;
+    int64_t *slots;
+    int64_t slot_cap;
+    char **pool;
+    int64_t pool_len;
+    int64_t pool_cap;
+    const char **view_keys;
+    const char **view_values;
+    int64_t view_len;
+    int view_dirty;
+    int64_t version;
+    int64_t live;
+    int64_t log_records;
+    int log_fd;
+} VaisSnap;
+
+#define VAIS_SNAP_HEADER 24
+
+static void *snap_grow(void *data, int64_t *cap, size_t item, int64_t need) {
+    if (need <= *cap) return data;
+    int64_t next = *cap == 0 ? 8 : *cap;
+    while (next < need) next *= 2;
+    void *grown = realloc(data, (size_t)next * item);
+    if (grown == 0) host_trap("snap_alloc");
+    *cap = next;
+    return grown;
+}
+
+static VaisSnap *snap_ptr(int64_t handle) {
+    if (handle == 0) host_trap("snap");
+    return (VaisSnap *)(intptr_t)handle;
+}
+
+static char *snap_keep(VaisSnap *s, const char *text, size_t n) {
+    char *out = (char *)malloc(n + 1);
+    if (out == 0) host_trap("snap_alloc");
+    memcpy(out, text, n);
+    out[n] = '\0';
+    s->pool = (char **)snap_grow(s->pool, &s->pool_cap, sizeof(char *), s->pool_len + 1);
+    s->pool[s->pool_len++] = out;
+    return out;
+}
+
+static uint64_t snap_word(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Key and value of base record i; traps when the record leaves the file. */
+static const char *snap_base_record(VaisSnap *s, int64_t i, size_t *klen, const char **value) {
+    uint64_t off = snap_word(s->base + VAIS_SNAP_HEADER + (size_t)i * 8);
+    if (off > s->base_size || s->base_size - off < 18) host_trap("snap_corrupt");
+    uint64_t kl = snap_word(s->base + off);
+    uint64_t vl = snap_word(s->base + off + 8);
+    if (kl > s->base_size || vl > s->base_size || s->base_size - off - 16 < kl + vl + 2) host_trap("snap_corrupt");
+    const char *key = (const char *)s->base + off + 16;
+    if (key[kl] != '\0' || key[kl + 1 + vl] != '\0') host_trap("snap_corrupt");
+    *klen = (size_t)kl;
+    if (value != 0) *value = key + kl + 1;
+    return key;
+}
+
+static int snap_key_cmp(const char *a, size_t an, const char *b, size_t bn) {
+    int c = memcmp(a, b, an < bn ? an : bn);
+    if (c != 0) return c;
+    return an < bn ? -1 : (an > bn ? 1 : 0);
+}
+
+static const char *snap_base_find(VaisSnap *s, const char *key, size_t n) {
+    int64_t lo = 0;
+    int64_t hi = s->base_count;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        size_t klen = 0;
+        const char *value = 0;
+        const char *k = snap_base_record(s, mid, &klen, &value);
+        int c = snap_key_cmp(k, klen, key, n);
+        if (c == 0) return value;
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return 0;
+}
+
+static void snap_rehash(VaisSnap *s) {
+    int64_t cap = s->slot_cap == 0 ? 64 : s->slot_cap * 2;
+    int64_t *slots = (int64_t *)malloc((size_t)cap * sizeof(int64_t));
+    if (slots == 0) host_trap("snap_alloc");
+    for (int64_t i = 0; i < cap; i++) slots[i] = -1;
+    for (int64_t i = 0; i < s->delta_len; i++) {
+        int64_t at = (int64_t)(s->delta[i].hash & (uint64_t)(cap - 1));
+        while (slots[at] >= 0) at = (at + 1) & (cap - 1);
+        slots[at] = i;
+    }
+    free(s->slots);
+    s->slots = slots;
+    s->slot_cap = cap;
+}
+
+/* Overlay entry for key, created when create is set. */
+static VaisSnapDelta *snap_delta(VaisSnap *s, const char *key, size_t n, int create) {
+    uint64_t h = index_hash(key, n);
+    if (s->slot_cap > 0) {
+        int64_t at = (int64_t)(h & (uint64_t)(s->slot_cap - 1));
+        while (s->slots[at] >= 0) {
+            VaisSnapDelta *d = &s->delta[s->slots[at]];
+            if (d->hash == h && d->klen == n && memcmp(d->key, key, n) == 0) return d;
+            at = (at + 1) & (s->slot_cap - 1);
+        }
+    }
+    if (!create) return 0;
+    if ((s->delta_len + 1) * 4 > s->slot_cap * 3) snap_rehash(s);
+    s->delta = (VaisSnapDelta *)snap_grow(s->delta, &s->delta_cap, sizeof(VaisSnapDelta), s->delta_len + 1);
+    VaisSnapDelta *d = &s->delta[s->delta_len];
+    d->key = snap_keep(s, key, n);
+    d->value = 0;
+    d->klen = n;
+    d->hash = h;
+    int64_t at = (int64_t)(h & (uint64_t)(s->slot_cap - 1));
+    while (s->slots[at] >= 0) at = (at + 1) & (s->slot_cap - 1);
+    s->slots[at] = s->delta_len++;
+    return d;
+}
+
+/* The live value for key, or 0 when it is absent or removed. */
+static const char *snap_lookup(VaisSnap *s, const char *key, size_t n) {
+    VaisSnapDelta *d = snap_delta(s, key, n, 0);
+    if (d != 0) return d->value;
+    return snap_base_find(s, key, n);
+}
+
+static void snap_apply_put(VaisSnap *s, const char *key, size_t kn, const char *value, size_t vn) {
+    if (snap_lookup(s, key, kn) == 0) s->live++;
+    VaisSnapDelta *d = snap_delta(s, key, kn, 1);
+    d->value = snap_keep(s, value, vn);
+    s->view_dirty = 1;
+}
+
+static int snap_apply_remove(VaisSnap *s, const char *key, size_t kn) {
+    if (snap_lookup(s, key, kn) == 0) return 0;
+    snap_delta(s, key, kn, 1)->value = 0;
+    s->live--;
+    s->view_dirty = 1;
+    return 1;
+}
+
+static int snap_map_base(VaisSnap *s) {
+    int fd = open(s->path, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size > 0 && st.st_size < VAIS_SNAP_HEADER)) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void *addr = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return -1;
+    const unsigned char *p = (const unsigned char *)addr;
+    uint64_t count = snap_word(p + 16);
+    if (memcmp(p, "VAISSNP1", 8) != 0 || count > ((uint64_t)st.st_size - VAIS_SNAP_HEADER) / 8) {
+        munmap(addr, (size_t)st.st_size);
+        return -1;
+    }
+    s->maps = (VaisSnapMap *)snap_grow(s->maps, &s->map_cap, sizeof(VaisSnapMap), s->map_len + 1);
+    s->maps[s->map_len].addr = addr;
+    s->maps[s->map_len].size = (size_t)st.st_size;
+    s->map_len++;
+    s->base = p;
+    s->base_size = (size_t)st.st_size;
+    s->base_count = (int64_t)count;
+    s->live = (int64_t)count;
+    s->version = (int64_t)snap_word(p + 8);
+    return 0;
+}
+
+/* Replays <path>.log; a torn final record is cut off so appends stay aligned. */
+static int snap_replay(VaisSnap *s) {
+    int fd = open(s->log_path, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    unsigned char *buf = (unsigned char *)malloc(size + 1);
+    if (buf == 0) host_trap("snap_alloc");
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, buf + got, size - got);
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+    size_t at = 0;
+    while (at < got) {
+        unsigned char op = buf[at];
+        if (op == 'V' && got - at >= 9) {
+            s->version = (int64_t)snap_word(buf + at + 1);
+            at += 9;
+        } else if (op == 'D' && got - at >= 9 && snap_word(buf + at + 1) <= got - at - 9) {
+            uint64_t kn = snap_word(buf + at + 1);
+            snap_apply_remove(s, (const char *)buf + at + 9, (size_t)kn);
+            at += 9 + (size_t)kn;
+        } else if (op == 'P' && got - at >= 17 && snap_word(buf + at + 1) <= got - at - 17 &&
+            snap_word(buf + at + 9) <= got - at - 17 - snap_word(buf + at + 1)) {
+            uint64_t kn = snap_word(buf + at + 1);
+            uint64_t vn = snap_word(buf + at + 9);
+            snap_apply_put(s, (const char *)buf + at + 17, (size_t)kn, (const char *)buf + at + 17 + kn, (size_t)vn);
+            at += 17 + (size_t)(kn + vn);
+        } else {
+            break;
+        }
+        s->log_records++;
+    }
+    free(buf);
+    if (at < got && truncate(s->log_path, (off_t)at) != 0) return -1;
+    return 0;
+}
+
+static int snap_log(VaisSnap *s, unsigned char op, const char *key, size_t kn, const char *value, size_t vn) {
+    if (s->log_fd < 0) {
+        s->log_fd = open(s->log_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (s->log_fd < 0) return 1;
+    }
+    unsigned char head[17];
+    size_t hn = 1;
+    head[0] = op;
+    if (op == 'V') {
+        uint64_t v = (uint64_t)s->version;
+        memcpy(head + 1, &v, 8);
+        hn = 9;
+    } else {
+        uint64_t k = (uint64_t)kn;
+        memcpy(head + 1, &k, 8);
+        hn = 9;
+        if (op == 'P') {
+            uint64_t v = (uint64_t)vn;
+            memcpy(head + 9, &v, 8);
+            hn = 17;
+        }
+    }
+    size_t total = hn + (op == 'V' ? 0 : kn) + (op == 'P' ? vn : 0);
+    unsigned char *rec = (unsigned char *)malloc(total);
+    if (rec == 0) host_trap("snap_alloc");
+    memcpy(rec, head, hn);
+    if (op != 'V') memcpy(rec + hn, key, kn);
+    if (op == 'P') memcpy(rec + hn + kn, value, vn);
+    ssize_t wrote = write(s->log_fd, rec, total);
+    free(rec);
+    if (wrote != (ssize_t)total) return 1;
+    s->log_records++;
+    return 0;
+}
+
+static int snap_view_cmp(const void *a, const void *b) {
+    const VaisSnapDelta *x = *(const VaisSnapDelta *const *)a;
+    const VaisSnapDelta *y = *(const VaisSnapDelta *const *)b;
+    return snap_key_cmp(x->key, x->klen, y->key, y->klen);
+}
+
+/* Key-sorted merge of the base records and the overlay. */
+static void snap_build_view(VaisSnap *s) {
+    if (!s->view_dirty) return;
+    VaisSnapDelta **order = (VaisSnapDelta **)malloc((size_t)(s->delta_len + 1) * sizeof(VaisSnapDelta *));
+    if (order == 0) host_trap("snap_alloc");
+    for (int64_t i = 0; i < s->delta_len; i++) order[i] = &s->delta[i];
+    qsort(order, (size_t)s->delta_len, sizeof(VaisSnapDelta *), snap_view_cmp);
+    free(s->view_keys);
+    free(s->view_values);
+    s->view_keys = (const char **)malloc((size_t)(s->live + 1) * sizeof(char *));
+    s->view_values = (const char **)malloc((size_t)(s->live + 1) * sizeof(char *));
+    if (s->view_keys == 0 || s->view_values == 0) host_trap("snap_alloc");
+    int64_t n = 0;
+    int64_t b = 0;
+    int64_t d = 0;
+    while (b < s->base_count || d < s->delta_len) {
+        size_t klen = 0;
+        const char *value = 0;
+        const char *key = b < s->base_count ? snap_base_record(s, b, &klen, &value) : 0;
+        int c = key == 0 ? 1 : (d == s->delta_len ? -1 : snap_key_cmp(key, klen, order[d]->key, order[d]->klen));
+        if (c >= 0) {
+            if (order[d]->value != 0) {
+                s->view_keys[n] = order[d]->key;
+                s->view_values[n++] = order[d]->value;
+            }
+            d++;
+            if (c == 0) b++;
+        } else {
+            s->view_keys[n] = key;
+            s->view_values[n++] = value;
+            b++;
+        }
+    }
+    free(order);
+    s->view_len = n;
+    s->view_dirty = 0;
+}
+
+int64_t snap_close(int64_t handle) {
+    VaisSnap *s = snap_ptr(handle);
+    if (s->log_fd >= 0) close(s->log_fd);
+    for (int64_t i = 0; i < s->map_len; i++) munmap(s->maps[i].addr, s->maps[i].size);
+    for (int64_t i = 0; i < s->pool_len; i++) free(s->pool[i]);
+    free(s->maps);
+    free(s->pool);
+    free(s->delta);
+    free(s->slots);
+    free(s->view_keys);
+    free(s->view_values);
+    free(s->path);
+    free(s->log_path);
+    free(s);
+    return 0;
+}
+
+int64_t snap_open(char *path) {
+    if (path == 0 || path[0] == '\0') host_trap("snap_open");
+    VaisSnap *s = (VaisSnap *)calloc(1, sizeof(VaisSnap));
+    if (s == 0) host_trap("snap_open");
+    size_t n = strlen(path);
+    s->path = strdup(path);
+    s->log_path = (char *)malloc(n + 5);
+    if (s->path == 0 || s->log_path == 0) host_trap("snap_open");
+    memcpy(s->log_path, path, n);
+    memcpy(s->log_path + n, ".log", 5);
+    s->log_fd = -1;
+    s->view_dirty = 1;
+    int64_t handle = (int64_t)(intptr_t)s;
+    if (snap_map_base(s) != 0 || snap_replay(s) != 0) {
+        snap_close(handle);
+        return 0;
+    }
+    return handle;
+}
+
+char *snap_get(int64_t handle, char *key, char *fallback) {
+    if (key == 0) host_trap("snap_get");
+    const char *value = snap_lookup(snap_ptr(handle), key, strlen(key));
+    return value != 0 ? (char *)value : fallback;
+}
+
+int64_t snap_has(int64_t handle, char *key) {
+    if (key == 0) host_trap("snap_has");
+    return snap_lookup(snap_ptr(handle), key, strlen(key)) != 0;
+}
+
+/* Appends to the log only when the stored value changes; 1 means the log
+ * write failed and the store is unchanged. */
+int64_t snap_put(int64_t handle, char *key, char *value) {
+    VaisSnap *s = snap_ptr(handle);
+    if (key == 0 || value == 0) host_trap("snap_put");
+    size_t kn = strlen(key);
+    size_t vn = strlen(value);
+    const char *old = snap_lookup(s, key, kn);
+    if (old != 0 && strcmp(old, value) == 0) return 0;
+    if (snap_log(s, 'P', key, kn, value, vn) != 0) return 1;
+    snap_apply_put(s, key, kn, value, vn);
+    return 0;
+}
+
+int64_t snap_remove(int64_t handle, char *key) {
+    VaisSnap *s = snap_ptr(handle);
+    if (key == 0) host_trap("snap_remove");
+    size_t kn = strlen(key);
+    if (snap_lookup(s, key, kn) == 0) return 0;
+    if (snap_log(s, 'D', key, kn, 0, 0) != 0) return 0;
+    return snap_apply_remove(s, key, kn);
+}
+
+int64_t snap_len(int64_t handle) {
+    return snap_ptr(handle)->live;
+}
+
+int64_t snap_log_len(int64_t handle) {
+    return snap_ptr(handle)->log_records;
+}
+
+int64_t snap_version(int64_t handle) {
+    return snap_ptr(handle)->version;
+}
+
+int64_t snap_set_version(int64_t handle, int64_t version) {
+    VaisSnap *s = snap_ptr(handle);
+    if (version == s->version) return 0;
+    int64_t old = s->version;
+    s->version = version;
+    if (snap_log(s, 'V', 0, 0, 0, 0) != 0) {
+        s->version = old;
+        return 1;
+    }
+    return 0;
+}
+
+char *snap_key_at(int64_t handle, int64_t i) {
+    VaisSnap *s = snap_ptr(handle);
+    snap_build_view(s);
+    if (i < 0 || i >= s->view_len) host_trap("snap_key_at");
+    return (char *)s->view_keys[i];
+}
+
+char *snap_value_at(int64_t handle, int64_t i) {
+    VaisSnap *s = snap_ptr(handle);
+    snap_build_view(s);
+    if (i < 0 || i >= s->view_len) host_trap("snap_value_at");
+    return (char *)s->view_values[i];
+}
+
+/* fsyncs the directory holding path, so a rename into it is durable. */
+static int snap_sync_dir(const char *path) {
+    const char *last = strrchr(path, '/');
+    size_t n = last == 0 ? 0 : last == path ? 1 : (size_t)(last - path);
+    char *dir = (char *)malloc(n + 2);
+    if (dir == 0) return -1;
+    if (n == 0) dir[n++] = '.';
+    else memcpy(dir, path, n);
+    dir[n] = '\0';
+    int fd = open(dir, O_RDONLY);
+    free(dir);
+    if (fd < 0) return -1;
+    int rc = fsync(fd);
+    close(fd);
+    return rc;
+}
+
+/* Writes the merged view to <path>.tmp, fsyncs it, renames it over the
+ * snapshot, and drops the log only once the directory entry is synced, so a
+ * crash leaves either the old snapshot and its log or the new snapshot;
+ * replaying a stale log over the new snapshot is harmless. Returns the entry
+ * count, or -1 when the snapshot could not be written. */
+int64_t snap_compact(int64_t handle) {
+    VaisSnap *s = snap_ptr(handle);
+    snap_build_view(s);
+    size_t n = strlen(s->path);
+    char *tmp = (char *)malloc(n + 5);
+    if (tmp == 0) host_trap("snap_alloc");
+    memcpy(tmp, s->path, n);
+    memcpy(tmp + n, ".tmp", 5);
+    FILE *f = fopen(tmp, "wb");
+    if (f == 0) {
+        free(tmp);
+        return -1;
+    }
+    uint64_t head[3] = {0, (uint64_t)s->version, (uint64_t)s->view_len};
+    memcpy(head, "VAISSNP1", 8);
+    int ok = fwrite(head, 8, 3, f) == 3;
+    uint64_t off = VAIS_SNAP_HEADER + (uint64_t)s->view_len * 8;
+    for (int64_t i = 0; ok && i < s->view_len; i++) {
+        ok = fwrite(&off, 8, 1, f) == 1;
+        off += (16 + strlen(s->view_keys[i]) + strlen(s->view_values[i]) + 2 + 7) & ~(uint64_t)7;
+    }
+    static const char pad[8] = {0};
+    for (int64_t i = 0; ok && i < s->view_len; i++) {
+        uint64_t rec[2] = {strlen(s->view_keys[i]), strlen(s->view_values[i])};
+        size_t body = (size_t)(rec[0] + rec[1] + 2);
+        size_t fill = ((16 + body + 7) & ~(size_t)7) - 16 - body;
+        ok = fwrite(rec, 8, 2, f) == 2 &&
+            fwrite(s->view_keys[i], 1, (size_t)rec[0] + 1, f) == rec[0] + 1 &&
+            fwrite(s->view_values[i], 1, (size_t)rec[1] + 1, f) == rec[1] + 1 &&
+            fwrite(pad, 1, fill, f) == fill;
+    }
+    if (ok && (fflush(f) != 0 || fsync(fileno(f)) != 0)) ok = 0;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, s->path) != 0) {
+        unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    if (s->log_fd >= 0) close(s->log_fd);
+    s->log_fd = -1;
+    if (snap_sync_dir(s->path) == 0) unlink(s->log_path);
+    s->log_records = 0;
+    if (snap_map_base(s) != 0) host_trap("snap_compact");
+    for (int64_t i = 0; i < s->slot_cap; i++) s->slots[i] = -1;
+    s->delta_len = 0;
+    s->view_dirty = 1;
+    return s->live;
+}
+
+/* Parallel pipeline workers behind `par` list pipelines. vais_par_begin
+   forks up to one worker per core, and every process, parent included,
+   claims fixed-size chunks from a shared counter until none are left. Each
+   chunk's partial result goes into its own slot in a shared mapping, and
+   vais_par_reduce folds the slots in chunk order, so the result does not
+   depend on which worker ran which chunk. A pipeline started inside a worker
+   or inside another pipeline runs on the calling process alone. */
+typedef struct {
+    int64_t next;
+    int64_t chunks;
+    int64_t workers;
+    size_t bytes;
+    pid_t pids[64];
+    int64_t slots[];
+} VaisPar;
+
+static VaisPar *vais_par_forked_for = NULL;
+static int vais_par_depth = 0;
+
+static int64_t vais_par_worker_count(int64_t chunks) {
+    if (vais_par_forked_for != NULL || vais_par_depth > 0) return 1;
+    long want = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *env = getenv("VAIS_PAR_WORKERS");
+    if (env != NULL && env[0] != '\0') want = strtol(env, NULL, 10);
+    if (want > 65) want = 65;
+    if (want > chunks) want = (long)chunks;
+    return want < 1 ? 1 : want;
+}
+
+int64_t vais_par_begin(int64_t len, int64_t chunk) {
+    if (chunk < 1) chunk = 1;
+    int64_t chunks = len > 0 ? (len + chunk - 1) / chunk : 0;
+    size_t bytes = sizeof(VaisPar) + (size_t)chunks * 2 * sizeof(int64_t);
+    VaisPar *p = (VaisPar *)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) host_trap("vais_par_begin");
+    p->bytes = bytes;
+    p->chunks = chunks;
+    int64_t want = vais_par_worker_count(chunks);
+    fflush(NULL);
+    while (p->workers + 1 < want) {
+        pid_t pid = fork();
+        if (pid < 0) break;
+        if (pid == 0) {
+            vais_par_forked_for = p;
+            return (int64_t)(intptr_t)p;
+        }
+        p->pids[p->workers++] = pid;
+    }
+    vais_par_depth++;
+    return (int64_t)(intptr_t)p;
+}
+
+/* Stores the finished chunk's partial (chunk < 0 on the first call) and
+   claims the next chunk, or returns -1 when every chunk is taken. */
+int64_t vais_par_next(int64_t handle, int64_t chunk, int64_t value, int64_t seen) {
+    VaisPar *p = (VaisPar *)(intptr_t)handle;
+    if (chunk >= 0 && chunk < p->chunks) {
+        p->slots[chunk * 2] = value;
+        p->slots[chunk * 2 + 1] = seen;
+    }
+    int64_t claimed = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED);
+    return claimed < p->chunks ? claimed : -1;
+}
+
+/* Workers exit here. The parent waits for them and returns how many chunks
+   produced a value. */
+int64_t vais_par_wait(int64_t handle) {
+    VaisPar *p = (VaisPar *)(intptr_t)handle;
+    if (vais_par_forked_for == p) _exit(0);
+    int failed = 0;
+    for (int64_t w = 0; w < p->workers; w++) {
+        int status = 0;
+        while (waitpid(p->pids[w], &status, 0) < 0) {
+            if (errno != EINTR) { failed = 1; break; }
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+    p->workers = 0;
+    vais_par_depth--;
+    if (failed) host_trap("vais_par_wait");
+    int64_t seen = 0;
+    for (int64_t c = 0; c < p->chunks; c++) {
+        if (p->slots[c * 2 + 1] != 0) seen++;
+    }
+    return seen;
+}
+
+/* Folds the chunk partials in chunk order (op 0 sum, 1 min, 2 max) and
+   releases the pipeline. */
+int64_t vais_par_reduce(int64_t handle, int64_t op) {
+    VaisPar *p = (VaisPar *)(intptr_t)handle;
+    int64_t acc = 0;
+    int have = 0;
+    for (int64_t c = 0; c < p->chunks; c++) {
+        if (p->slots[c * 2 + 1] == 0) continue;
+        int64_t v = p->slots[c * 2];
+        if (op == 0) acc = (int64_t)((uint64_t)acc + (uint64_t)v);
+        else if (!have || (op == 1 ? v < acc : v > acc)) acc = v;
+        have = 1;
+    }
+    munmap(p, p->bytes);
+    return acc;
+}
+
 int64_t proc_argc(void) {
     return vais_argc;
 }
@@ -274,14 +1413,20 @@ char *proc_arg(int64_t index) {
     return copy_str(vais_argv[index]);
 }
 
+/* Full-engine Lists are a header: [0] element block, [1] len, [2] capacity. */
+static int64_t *list_items(int64_t *list) {
+    return (int64_t *)(intptr_t)list[0];
+}
+
 static char **argv_from_list(int64_t *argv_buf, int64_t *argc_out) {
     if (argv_buf == NULL) return NULL;
-    int64_t argc = argv_buf[4095];
-    if (argc <= 0 || argc > 4095) return NULL;
+    int64_t argc = argv_buf[1];
+    int64_t *items = list_items(argv_buf);
+    if (argc <= 0 || items == NULL) return NULL;
     char **argv = (char **)malloc((size_t)(argc + 1) * sizeof(char *));
     if (argv == NULL) return NULL;
     for (int64_t i = 0; i < argc; i++) {
-        argv[i] = (char *)(intptr_t)argv_buf[i];
+        argv[i] = (char *)(intptr_t)items[i];
         if (argv[i] == NULL) {
             free(argv);
             return NULL;
@@ -336,59 +1481,287 @@ int64_t proc_run(int64_t *argv_buf) {
     return proc_capture_to(argv_buf, "", "");
 }
 
+static int apply_env(int64_t *env_buf) {
+    if (env_buf == NULL) return 0;
+    int64_t envc = env_buf[1];
+    int64_t *items = list_items(env_buf);
+    if (envc < 0 || (envc > 0 && items == NULL)) return 1;
+    for (int64_t i = 0; i < envc; i++) {
+        char *entry = (char *)(intptr_t)items[i];
+        if (entry == NULL) return 1;
+        char *eq = strchr(entry, '=');
+        if (eq == NULL || eq == entry) return 1;
+        size_t key_len = (size_t)(eq - entry);
+        char *key = (char *)malloc(key_len + 1);
+        if (key == NULL) return 1;
+        memcpy(key, entry, key_len);
+        key[key_len] = '\0';
+        int rc = setenv(key, eq + 1, 1);
+        free(key);
+        if (rc != 0) return 1;
+    }
+    return 0;
+}
+
+static int64_t status_code(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
 int64_t proc_run_env(int64_t *argv_buf, int64_t *env_buf) {
-    (void)env_buf;
-    return proc_run(argv_buf);
+    int64_t argc = 0;
+    char **argv = argv_from_list(argv_buf, &argc);
+    if (argv == NULL) return 1;
+    pid_t pid = fork();
+    if (pid < 0) {
+        free(argv);
+        return errno == 0 ? 1 : errno;
+    }
+    if (pid == 0) {
+        if (apply_env(env_buf) != 0) _exit(127);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno == EINTR) continue;
+        free(argv);
+        return errno == 0 ? 1 : errno;
+    }
+    free(argv);
+    return status_code(status);
+}
+
+/* Runs argv with stdout and/or stderr on pipes (a NULL text pointer leaves
+   that stream inherited) and drains both with poll until they close. */
+static int64_t capture_pipes(char **argv, char **out_text, char **err_text) {
+    char **texts[2] = { out_text, err_text };
+    int targets[2] = { STDOUT_FILENO, STDERR_FILENO };
+    int fds[2][2] = { { -1, -1 }, { -1, -1 } };
+    for (int s = 0; s < 2; s++) {
+        if (texts[s] != NULL && pipe(fds[s]) != 0) host_trap("proc_capture");
+    }
+    pid_t pid = fork();
+    if (pid < 0) host_trap("proc_capture");
+    if (pid == 0) {
+        for (int s = 0; s < 2; s++) {
+            if (texts[s] == NULL) continue;
+            close(fds[s][0]);
+            if (dup2(fds[s][1], targets[s]) < 0) _exit(127);
+            close(fds[s][1]);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    int live_fd[2] = { -1, -1 };
+    char *data[2] = { NULL, NULL };
+    size_t len[2] = { 0, 0 };
+    size_t cap[2] = { 0, 0 };
+    int live = 0;
+    for (int s = 0; s < 2; s++) {
+        if (texts[s] == NULL) continue;
+        close(fds[s][1]);
+        live_fd[s] = fds[s][0];
+        cap[s] = 256;
+        data[s] = (char *)malloc(cap[s]);
+        if (data[s] == NULL) host_trap("proc_capture");
+        live++;
+    }
+    char buf[65536];
+    while (live > 0) {
+        struct pollfd polls[2];
+        for (int s = 0; s < 2; s++) {
+            polls[s].fd = live_fd[s];
+            polls[s].events = POLLIN;
+            polls[s].revents = 0;
+        }
+        if (poll(polls, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            host_trap("proc_capture");
+        }
+        for (int s = 0; s < 2; s++) {
+            if (live_fd[s] < 0 || polls[s].revents == 0) continue;
+            ssize_t n = read(live_fd[s], buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) host_trap("proc_capture");
+            if (n == 0) {
+                close(live_fd[s]);
+                live_fd[s] = -1;
+                live--;
+                continue;
+            }
+            if (len[s] + (size_t)n + 1 > cap[s]) {
+                while (len[s] + (size_t)n + 1 > cap[s]) cap[s] *= 2;
+                data[s] = (char *)realloc(data[s], cap[s]);
+                if (data[s] == NULL) host_trap("proc_capture");
+            }
+            memcpy(data[s] + len[s], buf, (size_t)n);
+            len[s] += (size_t)n;
+        }
+    }
+    int64_t code = 1;
+    int status = 0;
+    for (;;) {
+        if (waitpid(pid, &status, 0) >= 0) {
+            code = status_code(status);
+            break;
+        }
+        if (errno != EINTR) {
+            code = errno == 0 ? 1 : errno;
+            break;
+        }
+    }
+    for (int s = 0; s < 2; s++) {
+        if (texts[s] == NULL) continue;
+        data[s][len[s]] = '\0';
+        *texts[s] = data[s];
+    }
+    return code;
 }
 
 char *proc_capture_stdout(int64_t *argv_buf) {
-    char out_template[] = "/tmp/vais-fixpoint-out-XXXXXX";
-    char err_template[] = "/tmp/vais-fixpoint-err-XXXXXX";
-    int out_fd = mkstemp(out_template);
-    int err_fd = mkstemp(err_template);
-    if (out_fd >= 0) close(out_fd);
-    if (err_fd >= 0) close(err_fd);
-    if (out_fd < 0 || err_fd < 0) return copy_str("");
-    proc_capture_to(argv_buf, out_template, err_template);
-    char *out = fs_read_text(out_template);
-    unlink(out_template);
-    unlink(err_template);
+    int64_t argc = 0;
+    char **argv = argv_from_list(argv_buf, &argc);
+    if (argv == NULL) return copy_str("");
+    char *out = NULL;
+    capture_pipes(argv, &out, NULL);
+    free(argv);
     return out;
 }
 
 char *proc_capture_stderr(int64_t *argv_buf) {
-    char out_template[] = "/tmp/vais-fixpoint-out-XXXXXX";
-    char err_template[] = "/tmp/vais-fixpoint-err-XXXXXX";
-    int out_fd = mkstemp(out_template);
-    int err_fd = mkstemp(err_template);
-    if (out_fd >= 0) close(out_fd);
-    if (err_fd >= 0) close(err_fd);
-    if (out_fd < 0 || err_fd < 0) return copy_str("");
-    proc_capture_to(argv_buf, out_template, err_template);
-    char *err = fs_read_text(err_template);
-    unlink(out_template);
-    unlink(err_template);
+    int64_t argc = 0;
+    char **argv = argv_from_list(argv_buf, &argc);
+    if (argv == NULL) return copy_str("");
+    char *err = NULL;
+    capture_pipes(argv, NULL, &err);
+    free(argv);
     return err;
 }
 
 void proc_capture(int64_t *argv_buf, int64_t *out) {
     if (out == NULL) return;
-    char out_template[] = "/tmp/vais-fixpoint-out-XXXXXX";
-    char err_template[] = "/tmp/vais-fixpoint-err-XXXXXX";
-    int out_fd = mkstemp(out_template);
-    int err_fd = mkstemp(err_template);
-    if (out_fd >= 0) close(out_fd);
-    if (err_fd >= 0) close(err_fd);
-    if (out_fd < 0 || err_fd < 0) {
+    int64_t argc = 0;
+    char **argv = argv_from_list(argv_buf, &argc);
+    if (argv == NULL) {
         out[0] = 1;
         out[1] = (int64_t)(intptr_t)copy_str("");
         out[2] = (int64_t)(intptr_t)copy_str("");
         return;
     }
-    int64_t code = proc_capture_to(argv_buf, out_template, err_template);
-    out[0] = code;
-    out[1] = (int64_t)(intptr_t)fs_read_text(out_template);
-    out[2] = (int64_t)(intptr_t)fs_read_text(err_template);
-    unlink(out_template);
-    unlink(err_template);
+    char *out_text = NULL;
+    char *err_text = NULL;
+    out[0] = capture_pipes(argv, &out_text, &err_text);
+    free(argv);
+    out[1] = (int64_t)(intptr_t)out_text;
+    out[2] = (int64_t)(intptr_t)err_text;
+}
+
+/* Children started by proc_spawn, keyed by pid; a child reaped by
+   proc_wait_any keeps its exit code here until proc_wait collects it. */
+typedef struct {
+    pid_t pid;
+    int done;
+    int64_t code;
+} SpawnedChild;
+
+static SpawnedChild *spawned = NULL;
+static int64_t spawned_len = 0;
+static int64_t spawned_cap = 0;
+
+static int64_t spawned_slot(int64_t handle) {
+    for (int64_t i = 0; i < spawned_len; i++) {
+        if ((int64_t)spawned[i].pid == handle) return i;
+    }
+    return -1;
+}
+
+static int64_t spawn_child(int64_t *argv_buf, char *stdout_path, char *stderr_path) {
+    int64_t argc = 0;
+    char **argv = argv_from_list(argv_buf, &argc);
+    if (argv == NULL) return 0;
+    if (spawned_len == spawned_cap) {
+        int64_t cap = spawned_cap == 0 ? 16 : spawned_cap * 2;
+        SpawnedChild *next = (SpawnedChild *)realloc(spawned, (size_t)cap * sizeof(SpawnedChild));
+        if (next == NULL) {
+            free(argv);
+            return 0;
+        }
+        spawned = next;
+        spawned_cap = cap;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        free(argv);
+        return 0;
+    }
+    if (pid == 0) {
+        if (redirect_path(stdout_path, STDOUT_FILENO) != 0) _exit(127);
+        if (stderr_path != NULL && stderr_path[0] != '\0' && stdout_path != NULL && strcmp(stderr_path, stdout_path) == 0) {
+            if (dup2(STDOUT_FILENO, STDERR_FILENO) < 0) _exit(127);
+        } else if (redirect_path(stderr_path, STDERR_FILENO) != 0) {
+            _exit(127);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    free(argv);
+    spawned[spawned_len].pid = pid;
+    spawned[spawned_len].done = 0;
+    spawned[spawned_len].code = 0;
+    spawned_len++;
+    return (int64_t)pid;
+}
+
+int64_t proc_spawn(int64_t *argv_buf) {
+    return spawn_child(argv_buf, "", "");
+}
+
+int64_t proc_spawn_to(int64_t *argv_buf, char *stdout_path, char *stderr_path) {
+    return spawn_child(argv_buf, stdout_path, stderr_path);
+}
+
+int64_t proc_wait(int64_t handle) {
+    int64_t slot = spawned_slot(handle);
+    if (slot < 0) return -1;
+    SpawnedChild *child = &spawned[slot];
+    if (!child->done) {
+        int status = 0;
+        for (;;) {
+            if (waitpid(child->pid, &status, 0) >= 0) {
+                child->code = status_code(status);
+                break;
+            }
+            if (errno != EINTR) {
+                child->code = -1;
+                break;
+            }
+        }
+    }
+    int64_t code = child->code;
+    spawned[slot] = spawned[spawned_len - 1];
+    spawned_len--;
+    return code;
+}
+
+int64_t proc_wait_any(void) {
+    for (;;) {
+        int running = 0;
+        for (int64_t i = 0; i < spawned_len; i++) {
+            if (!spawned[i].done) running = 1;
+        }
+        if (!running) return 0;
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        int64_t slot = spawned_slot((int64_t)pid);
+        if (slot < 0 || spawned[slot].done) continue;
+        spawned[slot].done = 1;
+        spawned[slot].code = status_code(status);
+        return (int64_t)pid;
+    }
 }
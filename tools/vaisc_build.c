@@ -0,0 +1,567 @@
+/* Child processes, the build and runtime object caches, clang linking, and temp paths. */
+#include "vaisc_native.h"
+
+static void cleanup_tmp_root(void);
+static void register_tmp_cleanup(void);
+
+int run_program_wait(char *const argv[]) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "error: fork failed: %s\n", strerror(errno));
+        return 1;
+    }
+    if (pid == 0) {
+        execvp(argv[0], argv);
+        fprintf(stderr, "error: cannot exec %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0) {
+        fprintf(stderr, "error: waitpid failed: %s\n", strerror(errno));
+        return 1;
+    }
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
+/* run_program_wait with data[0..len) written to the child's stdin through a
+   pipe, so in-memory modules reach clang without a temp file. A child that
+   exits early only ends the write; its exit status is still returned. */
+int run_program_feed(char *const argv[], const char *data, size_t len) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        fprintf(stderr, "error: pipe failed: %s\n", strerror(errno));
+        return 1;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "error: fork failed: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        close(fds[1]);
+        if (dup2(fds[0], STDIN_FILENO) < 0) _exit(127);
+        close(fds[0]);
+        execvp(argv[0], argv);
+        fprintf(stderr, "error: cannot exec %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    close(fds[0]);
+    void (*old_pipe)(int) = signal(SIGPIPE, SIG_IGN);
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fds[1], data + off, len - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        off += (size_t)n;
+    }
+    close(fds[1]);
+    signal(SIGPIPE, old_pipe);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno == EINTR) continue;
+        fprintf(stderr, "error: waitpid failed: %s\n", strerror(errno));
+        return 1;
+    }
+    if (WIFEXITED(status)) return WEXITSTATUS(status) == 0 && off < len ? 1 : WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
+uint64_t runtime_cache_hash(uint64_t h, const char *text) {
+    for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    h ^= 0xff;
+    h *= 1099511628211ULL;
+    return h;
+}
+
+/* Names the clang binary by resolved path, size, and mtime so upgrading the
+   toolchain in place invalidates cached runtime objects. */
+static void append_program_identity(StrBuf *sb, const char *program) {
+    char resolved[4096];
+    resolved[0] = '\0';
+    if (strchr(program, '/') != NULL) {
+        snprintf(resolved, sizeof(resolved), "%s", program);
+    } else {
+        const char *path = getenv("PATH");
+        while (path != NULL && *path != '\0') {
+            const char *colon = strchr(path, ':');
+            size_t len = colon == NULL ? strlen(path) : (size_t)(colon - path);
+            if (len > 0 && snprintf(resolved, sizeof(resolved), "%.*s/%s", (int)len, path, program) < (int)sizeof(resolved) &&
+                access(resolved, X_OK) == 0) {
+                break;
+            }
+            resolved[0] = '\0';
+            path = colon == NULL ? NULL : colon + 1;
+        }
+    }
+    sb_append(sb, program);
+    struct stat st;
+    if (resolved[0] != '\0' && stat(resolved, &st) == 0) {
+        char meta[128];
+        snprintf(meta, sizeof(meta), " %lld %lld", (long long)st.st_size, (long long)st.st_mtime);
+        sb_append(sb, " ");
+        sb_append(sb, resolved);
+        sb_append(sb, meta);
+    }
+}
+
+int vaisc_cache_disabled(void) {
+    const char *env = getenv("VAISC_NO_CACHE");
+    return vaisc_no_cache || (env != NULL && strcmp(env, "1") == 0);
+}
+
+char *vaisc_cache_root(void) {
+    const char *dir = getenv("VAISC_CACHE_DIR");
+    if (dir != NULL && dir[0] != '\0') {
+        char *copy = strdup(dir);
+        if (copy == NULL) die_oom();
+        return copy;
+    }
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg != NULL && xdg[0] != '\0') return path_join2(xdg, "vaisc");
+    const char *home = getenv("HOME");
+    if (home != NULL && home[0] != '\0') return path_join2(home, ".cache/vaisc");
+    return NULL;
+}
+
+/* mkdir -p without diagnostics: an unusable cache directory only disables
+   caching. */
+int cache_mkdirs(const char *path) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s", path) >= (int)sizeof(tmp)) return 1;
+    for (char *p = tmp + 1; *p != '\0'; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0777) != 0 && errno != EEXIST) return 1;
+        *p = '/';
+    }
+    if (mkdir(tmp, 0777) != 0 && errno != EEXIST) return 1;
+    return path_is_directory_c(tmp) ? 0 : 1;
+}
+
+/*
+ * Compiles a fixed runtime C unit once per (vaisc version, clang binary, host
+ * target, optimization level, LTO mode, runtime text hash) into
+ * <cache>/runtime/<name>-<hash>.o and writes that path to `out`. Objects are
+ * published with rename(), so concurrent builds never link a partial file.
+ * Without a usable cache directory the object goes to the per-run temp root.
+ */
+int runtime_cache_object(const char *clang, const char *name, const char *text, int lto, char *out, size_t outlen) {
+    StrBuf key;
+    sb_init(&key);
+    sb_append(&key, VAIS_VERSION);
+    sb_append(&key, "\n");
+    append_program_identity(&key, clang);
+    sb_append(&key, "\n");
+    struct utsname host;
+    if (uname(&host) == 0) {
+        sb_append(&key, host.sysname);
+        sb_append(&key, " ");
+        sb_append(&key, host.machine);
+    }
+    sb_append(&key, "\n");
+    sb_append(&key, vaisc_opt_flag());
+    sb_append(&key, lto ? " -flto" : "");
+    uint64_t hash = runtime_cache_hash(1469598103934665603ULL, key.data);
+    hash = runtime_cache_hash(hash, text);
+    free(key.data);
+
+    int cached = 0;
+    char *root = vaisc_cache_root();
+    if (root != NULL) {
+        char *dir = path_join2(root, "runtime");
+        if (cache_mkdirs(dir) == 0 &&
+            snprintf(out, outlen, "%s/%s-%016llx.o", dir, name, (unsigned long long)hash) < (int)outlen) {
+            cached = 1;
+        }
+        free(dir);
+        free(root);
+    }
+    if (cached && path_is_regular_file_c(out)) return 0;
+
+    char src_path[512];
+    char suffix[128];
+    snprintf(suffix, sizeof(suffix), "%s.c", name);
+    if (make_tmp_path(src_path, sizeof(src_path), suffix) != 0) return 1;
+    if (write_file_text(src_path, text) != 0) return 1;
+    char obj_path[4096];
+    if (cached) {
+        snprintf(obj_path, sizeof(obj_path), "%s.tmp.%ld", out, (long)getpid());
+    } else {
+        snprintf(suffix, sizeof(suffix), "%s.o", name);
+        if (make_tmp_path(out, outlen, suffix) != 0) return 1;
+        snprintf(obj_path, sizeof(obj_path), "%s", out);
+    }
+    char *argv[8];
+    int argc = 0;
+    argv[argc++] = (char *)clang;
+    argv[argc++] = "-c";
+    argv[argc++] = (char *)vaisc_opt_flag();
+    if (lto) argv[argc++] = "-flto";
+    argv[argc++] = "-o";
+    argv[argc++] = obj_path;
+    argv[argc++] = src_path;
+    argv[argc] = NULL;
+    int rc = run_program_wait(argv);
+    if (rc != 0) {
+        if (cached) unlink(obj_path);
+        fprintf(stderr, "error: clang failed compiling the %s object with exit code %d\n", name, rc);
+        return 1;
+    }
+    if (cached && rename(obj_path, out) != 0) {
+        fprintf(stderr, "error: cannot publish cached %s object %s: %s\n", name, out, strerror(errno));
+        unlink(obj_path);
+        return 1;
+    }
+    return 0;
+}
+
+/* Links an in-memory module (`lang` is "ir" or "c", as for clang -x) read
+   from stdin together with the cached runtime objects. */
+static int clang_link(const char *clang, const char *lang, const char *text, size_t len, const char *out_path, int lto) {
+    char host_obj[4096];
+    char direct_obj[4096];
+    if (runtime_cache_object(clang, "host-runtime", host_runtime_c_text(), lto, host_obj, sizeof(host_obj)) != 0) return 1;
+    if (vaisc_direct_runtime_split) {
+        char *direct_text = direct_runtime_c_text();
+        int rc = runtime_cache_object(clang, "direct-runtime", direct_text, lto, direct_obj, sizeof(direct_obj));
+        free(direct_text);
+        if (rc != 0) return 1;
+    }
+    char *argv[16];
+    int argc = 0;
+    argv[argc++] = (char *)clang;
+    argv[argc++] = "-Wno-override-module";
+#ifdef __APPLE__
+    argv[argc++] = "-Wl,-stack_size,0x4000000";
+#endif
+    argv[argc++] = (char *)vaisc_opt_flag();
+    if (lto) argv[argc++] = "-flto";
+    argv[argc++] = "-o";
+    argv[argc++] = (char *)out_path;
+    argv[argc++] = "-x";
+    argv[argc++] = (char *)lang;
+    argv[argc++] = "-";
+    argv[argc++] = "-x";
+    argv[argc++] = "none";
+    argv[argc++] = host_obj;
+    if (vaisc_direct_runtime_split) argv[argc++] = direct_obj;
+    argv[argc] = NULL;
+    return run_program_feed(argv, text, len);
+}
+
+/* Whether clang can compile and link `-flto` with its default linker. Probed
+   once per (vaisc version, clang binary, host) by linking an empty C program
+   with the probe's output silenced; the answer is kept in memory and as
+   <cache>/runtime/lto-<hash>, so later builds skip the probe. */
+static int clang_supports_lto(const char *clang) {
+    static int known = -1;
+    if (known >= 0) return known;
+    StrBuf key;
+    sb_init(&key);
+    sb_append(&key, VAIS_VERSION);
+    sb_append(&key, "\nlto-probe\n");
+    append_program_identity(&key, clang);
+    struct utsname host;
+    if (uname(&host) == 0) {
+        sb_append(&key, host.sysname);
+        sb_append(&key, " ");
+        sb_append(&key, host.machine);
+    }
+    uint64_t hash = runtime_cache_hash(1469598103934665603ULL, key.data);
+    free(key.data);
+
+    char answer_path[4096];
+    answer_path[0] = '\0';
+    char *root = vaisc_cache_root();
+    if (root != NULL) {
+        char *dir = path_join2(root, "runtime");
+        if (cache_mkdirs(dir) != 0 ||
+            snprintf(answer_path, sizeof(answer_path), "%s/lto-%016llx", dir, (unsigned long long)hash) >= (int)sizeof(answer_path)) {
+            answer_path[0] = '\0';
+        }
+        free(dir);
+        free(root);
+    }
+    if (answer_path[0] != '\0' && path_is_regular_file_c(answer_path)) {
+        char *text = read_file(answer_path);
+        if (text != NULL && (text[0] == '0' || text[0] == '1')) known = text[0] == '1';
+        free(text);
+        if (known >= 0) return known;
+    }
+
+    char probe_out[512];
+    if (make_tmp_path(probe_out, sizeof(probe_out), "lto-probe") != 0) return known = 0;
+    char *argv[] = {(char *)clang, "-O1", "-flto", "-o", probe_out, "-x", "c", "-", NULL};
+    static const char probe[] = "int main(void) { return 0; }\n";
+    fflush(stderr);
+    int saved_err = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved_err >= 0 && null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+    int rc = run_program_feed(argv, probe, sizeof(probe) - 1);
+    if (saved_err >= 0) {
+        dup2(saved_err, STDERR_FILENO);
+        close(saved_err);
+    }
+    if (null_fd >= 0) close(null_fd);
+    unlink(probe_out);
+    known = rc == 0;
+
+    if (answer_path[0] != '\0') {
+        char tmp[4200];
+        snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", answer_path, (long)getpid());
+        if (write_file_text(tmp, known ? "1\n" : "0\n") != 0 || rename(tmp, answer_path) != 0) unlink(tmp);
+    }
+    return known;
+}
+
+int clang_build(const char *clang, const char *lang, const char *text, size_t len, const char *out_path) {
+    /* Optimized builds link the user module and the host runtime as one LTO
+       unit so runtime helpers can inline into user loops. Toolchains without
+       LTO support get a plain optimized link, so a real link error is
+       reported once instead of being retried. */
+    int lto = vaisc_effective_opt_level() > 0 && clang_supports_lto(clang);
+    int phase = stats_child_phase_begin("clang_build", len);
+    int rc = clang_link(clang, lang, text, len, out_path, lto);
+    stats_phase_end(phase, rc == 0 ? stats_file_size(out_path) : 0);
+    if (rc != 0) {
+        fprintf(stderr, "error: clang failed with exit code %d\n", rc);
+        return 1;
+    }
+    return 0;
+}
+
+/* Fills the runtime object cache for both ends of what a build can ask for:
+   the split debug objects (host and direct runtime, no LTO) and the release
+   profile's host runtime, LTO when clang supports it. The optimized direct
+   engine compiles its runtime into the module, so it has no object to warm. */
+void runtime_cache_warm(const char *clang) {
+    int saved = vaisc_opt_level;
+    char obj[4096];
+    vaisc_opt_level = 0;
+    runtime_cache_object(clang, "host-runtime", host_runtime_c_text(), 0, obj, sizeof(obj));
+    char *direct_text = direct_runtime_c_text();
+    runtime_cache_object(clang, "direct-runtime", direct_text, 0, obj, sizeof(obj));
+    free(direct_text);
+    vaisc_opt_level = profile_opt_level("release");
+    runtime_cache_object(clang, "host-runtime", host_runtime_c_text(), clang_supports_lto(clang), obj, sizeof(obj));
+    vaisc_opt_level = saved;
+}
+
+void append_self_identity(StrBuf *sb) {
+    char self[4096];
+    ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (n > 0) {
+        self[n] = '\0';
+        append_program_identity(sb, self);
+    } else {
+        append_program_identity(sb, vaisc_argv0);
+    }
+}
+
+/*
+ * Content-addressed build cache. A key hashes the merged module graph the
+ * build itself compiles (resolved once by the caller) with the entry path,
+ * engine, vaisc and clang identities, and optimization flags;
+ * <cache>/build/<key>.ll and .bin hold the emitted IR and linked binary.
+ * Returns 0 with both paths filled and 1 when the cache does not apply.
+ */
+int build_cache_paths(const char *entry, const char *merged, const char *engine, const char *clang, char *bin, size_t bin_len, char *ir, size_t ir_len) {
+    if (vaisc_cache_disabled() || merged == NULL) return 1;
+    char *root = vaisc_cache_root();
+    if (root == NULL) return 1;
+    char *dir = path_join2(root, "build");
+    free(root);
+    if (cache_mkdirs(dir) != 0) {
+        free(dir);
+        return 1;
+    }
+    StrBuf key;
+    sb_init(&key);
+    sb_append(&key, VAIS_VERSION);
+    sb_append(&key, "\n");
+    append_self_identity(&key);
+    sb_append(&key, "\n");
+    append_program_identity(&key, clang);
+    sb_append(&key, "\n");
+    sb_append(&key, engine);
+    sb_append(&key, " ");
+    sb_append(&key, vaisc_opt_flag());
+    if (vaisc_instrument) sb_append(&key, " --instrument");
+    sb_append(&key, "\n");
+    sb_append(&key, entry);
+    uint64_t hash = runtime_cache_hash(1469598103934665603ULL, key.data);
+    hash = runtime_cache_hash(hash, merged);
+    free(key.data);
+    int ok = snprintf(bin, bin_len, "%s/%016llx.bin", dir, (unsigned long long)hash) < (int)bin_len &&
+        snprintf(ir, ir_len, "%s/%016llx.ll", dir, (unsigned long long)hash) < (int)ir_len;
+    free(dir);
+    return ok ? 0 : 1;
+}
+
+/* The IR entry is only stored by builds that asked for --ir-out, so it is
+   only required when this one does. */
+int build_cache_fetch(const char *bin, const char *ir, const char *output, const char *ir_out) {
+    if (!path_is_regular_file_c(bin)) return 1;
+    if (ir_out != NULL && !path_is_regular_file_c(ir)) return 1;
+    /* Hits refresh mtime, which is the eviction order. */
+    utime(bin, NULL);
+    if (ir_out != NULL) utime(ir, NULL);
+    if (copy_file_binary_c(bin, output) != 0) return 1;
+    if (ir_out != NULL && copy_file_binary_c(ir, ir_out) != 0) return 1;
+    return 0;
+}
+
+static void build_cache_publish(const char *src, const char *dst) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", dst, (long)getpid()) >= (int)sizeof(tmp)) return;
+    if (copy_file_binary_c(src, tmp) != 0 || rename(tmp, dst) != 0) unlink(tmp);
+}
+
+static int build_cache_entry_cmp(const void *a, const void *b) {
+    const BuildCacheEntry *x = (const BuildCacheEntry *)a;
+    const BuildCacheEntry *y = (const BuildCacheEntry *)b;
+    return x->mtime < y->mtime ? -1 : (x->mtime > y->mtime ? 1 : 0);
+}
+
+/* Drops least-recently-used entries until the build cache fits in
+   VAISC_CACHE_MAX_MB (default 512). */
+void build_cache_evict(const char *dir) {
+    long long limit = 512LL * 1024 * 1024;
+    const char *env = getenv("VAISC_CACHE_MAX_MB");
+    if (env != NULL && env[0] != '\0') limit = atoll(env) * 1024 * 1024;
+    DIR *d = opendir(dir);
+    if (d == NULL) return;
+    BuildCacheEntry *items = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    long long total = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.' || strstr(entry->d_name, ".tmp.") != NULL) continue;
+        char *path = path_join2(dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+        if (len == cap) {
+            cap = cap == 0 ? 64 : cap * 2;
+            items = (BuildCacheEntry *)realloc(items, cap * sizeof(*items));
+            if (items == NULL) die_oom();
+        }
+        items[len].path = path;
+        items[len].size = (long long)st.st_size;
+        items[len].mtime = st.st_mtime;
+        total += items[len].size;
+        len++;
+    }
+    closedir(d);
+    if (total > limit) {
+        qsort(items, len, sizeof(*items), build_cache_entry_cmp);
+        for (size_t i = 0; i < len && total > limit; i++) {
+            if (unlink(items[i].path) == 0) total -= items[i].size;
+        }
+    }
+    for (size_t i = 0; i < len; i++) free(items[i].path);
+    free(items);
+}
+
+void build_cache_store(const char *bin, const char *ir, const char *output, const char *ir_path) {
+    if (ir_path != NULL) build_cache_publish(ir_path, ir);
+    build_cache_publish(output, bin);
+    char *dir = dirname_copy(bin);
+    build_cache_evict(dir);
+    free(dir);
+}
+
+int make_tmp_path(char *buf, size_t buflen, const char *suffix) {
+    register_tmp_cleanup();
+    if (!vaisc_tmp_root_ready) {
+        const char *base = getenv("TMPDIR");
+        if (base == NULL || base[0] == '\0') base = "/tmp";
+        size_t len = strlen(base);
+        const char *sep = len > 0 && base[len - 1] == '/' ? "" : "/";
+        char tmpl[512];
+        if (snprintf(tmpl, sizeof(tmpl), "%s%svaisc-native-XXXXXX", base, sep) >= (int)sizeof(tmpl)) {
+            fprintf(stderr, "error: temporary root path too long\n");
+            return 1;
+        }
+        char *dir = mkdtemp(tmpl);
+        if (dir == NULL) {
+            fprintf(stderr, "error: mkdtemp failed: %s\n", strerror(errno));
+            return 1;
+        }
+        if (snprintf(vaisc_tmp_root, sizeof(vaisc_tmp_root), "%s", dir) >= (int)sizeof(vaisc_tmp_root)) {
+            fprintf(stderr, "error: temporary root path too long\n");
+            return 1;
+        }
+        vaisc_tmp_root_ready = 1;
+    }
+    vaisc_tmp_counter++;
+    if (snprintf(buf, buflen, "%s/%03d-%s", vaisc_tmp_root, vaisc_tmp_counter, suffix) >= (int)buflen) {
+        fprintf(stderr, "error: temporary path too long\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void remove_tmp_entry_recursive(const char *path) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return;
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        if (dir != NULL) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+                char child[1024];
+                if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) < (int)sizeof(child)) {
+                    remove_tmp_entry_recursive(child);
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(path);
+    } else {
+        unlink(path);
+    }
+}
+
+static void cleanup_tmp_root(void) {
+    if (vaisc_keep_tmp || !vaisc_tmp_root_ready || vaisc_tmp_root[0] == '\0') return;
+    DIR *dir = opendir(vaisc_tmp_root);
+    if (dir != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            char path[1024];
+            if (snprintf(path, sizeof(path), "%s/%s", vaisc_tmp_root, entry->d_name) < (int)sizeof(path)) {
+                remove_tmp_entry_recursive(path);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(vaisc_tmp_root);
+}
+
+void set_keep_tmp(void) {
+    vaisc_keep_tmp = 1;
+}
+
+static void register_tmp_cleanup(void) {
+    static int registered = 0;
+    if (!registered) {
+        atexit(cleanup_tmp_root);
+        registered = 1;
+    }
+}
@@ -0,0 +1,13802 @@
+/* The direct engine: Vais-to-C lowering, its C prelude, and IR emission. */
+#include "vaisc_native.h"
+
+static char *direct_rewrite_struct_literals(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectStructInfo *structs,
+    int struct_count
+);
+static char *direct_rewrite_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+);
+static int direct_check_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+);
+static char *direct_infer_expr_type(
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+);
+static int direct_source_brace_delta(const char *text);
+static int direct_lower_line(
+    const char *path,
+    int line_no,
+    const char *line,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+);
+
+/*
+ * Every local, function and struct name the direct engine looks up is
+ * interned: each distinct name gets a dense id and one owned copy, and the
+ * name tables map ids to entries, so a lookup costs one string hash. Ids stay
+ * valid for the life of the process.
+ */
+static char **direct_interned = NULL;
+
+static int direct_interned_count = 0;
+
+static int direct_interned_cap = 0;
+
+static StrIndex direct_intern_index;
+
+static DirectNameIndex direct_fn_index;
+
+static DirectNameIndex direct_struct_index;
+
+static int direct_intern_find(const char *name) {
+    return str_index_get(&direct_intern_index, name);
+}
+
+static int direct_intern(const char *name) {
+    int id = str_index_get(&direct_intern_index, name);
+    if (id >= 0) return id;
+    if (direct_interned_count == direct_interned_cap) {
+        int cap = direct_interned_cap == 0 ? 256 : direct_interned_cap * 2;
+        char **grown = (char **)realloc(direct_interned, (size_t)cap * sizeof(char *));
+        if (grown == NULL) die_oom();
+        direct_interned = grown;
+        direct_interned_cap = cap;
+    }
+    char *copy = strdup(name);
+    if (copy == NULL) die_oom();
+    id = direct_interned_count++;
+    direct_interned[id] = copy;
+    str_index_put(&direct_intern_index, copy, id);
+    return id;
+}
+
+/* Grows an id -> index + 1 map so `id` is in range; new entries are 0. */
+static void direct_id_map_reserve(int **map, int *cap, int id) {
+    if (id < *cap) return;
+    int next = *cap == 0 ? 64 : *cap;
+    while (next <= id) next *= 2;
+    int *grown = (int *)realloc(*map, (size_t)next * sizeof(int));
+    if (grown == NULL) die_oom();
+    memset(grown + *cap, 0, (size_t)(next - *cap) * sizeof(int));
+    *map = grown;
+    *cap = next;
+}
+
+static void direct_name_index_reset(DirectNameIndex *ix) {
+    free(ix->slot_of);
+    memset(ix, 0, sizeof(*ix));
+}
+
+/* Records that `table` grew to `count` entries by appending `name`. The
+   first entry with a name wins, matching the linear scans. */
+static void direct_name_index_note(DirectNameIndex *ix, const void *table, int count, const char *name) {
+    if (ix->count != count - 1) {
+        direct_name_index_reset(ix);
+        if (count != 1) return;
+    }
+    int id = direct_intern(name);
+    direct_id_map_reserve(&ix->slot_of, &ix->cap, id);
+    if (ix->slot_of[id] == 0) ix->slot_of[id] = count;
+    ix->table = table;
+    ix->count = count;
+}
+
+/* Entry index for `name`, -1 when absent, or -2 when `ix` does not
+   describe this table. */
+static int direct_name_index_get(const DirectNameIndex *ix, const void *table, int count, const char *name) {
+    if (ix->table == NULL || ix->table != table || ix->count != count) return -2;
+    int id = direct_intern_find(name);
+    if (id < 0 || id >= ix->cap || ix->slot_of[id] == 0) return -1;
+    return ix->slot_of[id] - 1;
+}
+
+static void direct_names_free(DirectNameSet *set) {
+    for (int i = 0; i < set->count; i++) {
+        free(set->items[i]->type);
+        free(set->items[i]);
+    }
+    free(set->items);
+    free(set->slot_of);
+    set->items = NULL;
+    set->count = 0;
+    set->cap = 0;
+    set->slot_of = NULL;
+    set->slot_cap = 0;
+    set->temp_count = 0;
+    free(set->current_return_type);
+    set->current_return_type = NULL;
+}
+
+static DirectLocalInfo *direct_names_find(DirectNameSet *set, const char *name) {
+    int id = direct_intern_find(name);
+    if (id < 0 || id >= set->slot_cap || set->slot_of[id] == 0) return NULL;
+    return set->items[set->slot_of[id] - 1];
+}
+
+static int direct_names_has(DirectNameSet *set, const char *name) {
+    return direct_names_find(set, name) != NULL;
+}
+
+static const char *direct_names_type(DirectNameSet *set, const char *name) {
+    DirectLocalInfo *info = direct_names_find(set, name);
+    return info == NULL ? NULL : info->type;
+}
+
+static void direct_names_add_typed_ref(DirectNameSet *set, const char *name, const char *type, int is_ref) {
+    DirectLocalInfo *existing = direct_names_find(set, name);
+    if (existing != NULL) {
+        free(existing->type);
+        existing->type = strdup(type);
+        existing->is_ref = is_ref;
+        existing->concat_acc = 0;
+        existing->heap_owned = 0;
+        return;
+    }
+    int id = direct_intern(name);
+    direct_id_map_reserve(&set->slot_of, &set->slot_cap, id);
+    if (set->count == set->cap) {
+        int cap = set->cap == 0 ? 32 : set->cap * 2;
+        DirectLocalInfo **grown = (DirectLocalInfo **)realloc(set->items, (size_t)cap * sizeof(DirectLocalInfo *));
+        if (grown == NULL) die_oom();
+        set->items = grown;
+        set->cap = cap;
+    }
+    /* Items are allocated one by one so pointers returned by
+       direct_names_find survive later additions. */
+    DirectLocalInfo *info = (DirectLocalInfo *)calloc(1, sizeof(DirectLocalInfo));
+    if (info == NULL) die_oom();
+    info->name = direct_interned[id];
+    info->name_id = id;
+    info->type = strdup(type);
+    info->is_ref = is_ref;
+    set->items[set->count++] = info;
+    set->slot_of[id] = set->count;
+}
+
+static void direct_names_add_typed(DirectNameSet *set, const char *name, const char *type) {
+    direct_names_add_typed_ref(set, name, type, 0);
+}
+
+static void direct_names_remove(DirectNameSet *set, const char *name) {
+    DirectLocalInfo *info = direct_names_find(set, name);
+    if (info == NULL) return;
+    int at = set->slot_of[info->name_id] - 1;
+    set->slot_of[info->name_id] = 0;
+    free(info->type);
+    free(info);
+    for (int j = at; j + 1 < set->count; j++) {
+        set->items[j] = set->items[j + 1];
+        set->slot_of[set->items[j]->name_id] = j + 1;
+    }
+    set->count--;
+}
+
+static int direct_names_is_ref(DirectNameSet *set, const char *name) {
+    DirectLocalInfo *info = direct_names_find(set, name);
+    return info != NULL && info->is_ref;
+}
+
+static void direct_fns_free(DirectFnInfo *fns, int count) {
+    if (direct_fn_index.table == fns) direct_name_index_reset(&direct_fn_index);
+    for (int i = 0; i < count; i++) {
+        free(fns[i].name);
+        free(fns[i].return_type);
+        for (int p = 0; p < fns[i].param_count; p++) {
+            free(fns[i].params[p]);
+            free(fns[i].param_types[p]);
+        }
+    }
+}
+
+static DirectFnInfo *direct_find_fn(DirectFnInfo *fns, int count, const char *name) {
+    int at = direct_name_index_get(&direct_fn_index, fns, count, name);
+    if (at != -2) return at < 0 ? NULL : &fns[at];
+    for (int i = 0; i < count; i++) {
+        if (strcmp(fns[i].name, name) == 0) return &fns[i];
+    }
+    return NULL;
+}
+
+static void direct_struct_free_one(DirectStructInfo *info) {
+    free(info->name);
+    for (int i = 0; i < info->field_count; i++) {
+        free(info->fields[i]);
+        free(info->field_types[i]);
+    }
+    memset(info, 0, sizeof(*info));
+}
+
+static void direct_structs_free(DirectStructInfo *structs, int count) {
+    if (direct_struct_index.table == structs) direct_name_index_reset(&direct_struct_index);
+    for (int i = 0; i < count; i++) direct_struct_free_one(&structs[i]);
+}
+
+static DirectStructInfo *direct_find_struct(DirectStructInfo *structs, int count, const char *name) {
+    int at = direct_name_index_get(&direct_struct_index, structs, count, name);
+    if (at != -2) return at < 0 ? NULL : &structs[at];
+    for (int i = 0; i < count; i++) {
+        if (strcmp(structs[i].name, name) == 0) return &structs[i];
+    }
+    return NULL;
+}
+
+static int direct_struct_has_field(DirectStructInfo *info, const char *field) {
+    for (int i = 0; i < info->field_count; i++) {
+        if (strcmp(info->fields[i], field) == 0) return 1;
+    }
+    return 0;
+}
+
+static int direct_has_process_result_struct(DirectStructInfo *structs, int struct_count) {
+    DirectStructInfo *info = direct_find_struct(structs, struct_count, "ProcessResult");
+    if (info == NULL || info->field_count != 3) return 0;
+    return strcmp(info->fields[0], "code") == 0 &&
+        strcmp(info->field_types[0], "Int") == 0 &&
+        strcmp(info->fields[1], "stdout") == 0 &&
+        strcmp(info->field_types[1], "Str") == 0 &&
+        strcmp(info->fields[2], "stderr") == 0 &&
+        strcmp(info->field_types[2], "Str") == 0;
+}
+
+static int direct_struct_field_index(DirectStructInfo *info, const char *field) {
+    for (int i = 0; i < info->field_count; i++) {
+        if (strcmp(info->fields[i], field) == 0) return i;
+    }
+    return -1;
+}
+
+static const char *direct_struct_field_type(DirectStructInfo *info, const char *field) {
+    int idx = direct_struct_field_index(info, field);
+    if (idx < 0) return NULL;
+    return info->field_types[idx];
+}
+
+static int direct_is_single_int_field_struct(DirectStructInfo *info) {
+    return info != NULL &&
+        info->field_count == 1 &&
+        info->field_types[0] != NULL &&
+        strcmp(info->field_types[0], "Int") == 0;
+}
+
+static int direct_is_plain_ident(const char *text) {
+    if (!is_ident_start(text[0])) return 0;
+    int i = 1;
+    while (is_ident_continue(text[i])) i++;
+    return text[i] == '\0';
+}
+
+static int direct_is_list_int_type(const char *type) {
+    return type != NULL && strcmp(type, "List<Int>") == 0;
+}
+
+static int direct_is_list_str_type(const char *type) {
+    return type != NULL && strcmp(type, "List<Str>") == 0;
+}
+
+static int direct_is_option_int_type(const char *type) {
+    return type != NULL && strcmp(type, "Option<Int>") == 0;
+}
+
+static int direct_is_result_int_int_type(const char *type) {
+    return type != NULL && strcmp(type, "Result<Int,Int>") == 0;
+}
+
+static int direct_is_option_result_type(const char *type) {
+    return direct_is_option_int_type(type) || direct_is_result_int_int_type(type);
+}
+
+static int direct_is_map_int_int_type(const char *type) {
+    return type != NULL && strcmp(type, "Map<Int,Int>") == 0;
+}
+
+static int direct_is_map_int_bool_type(const char *type) {
+    return type != NULL && strcmp(type, "Map<Int,Bool>") == 0;
+}
+
+static int direct_is_map_int_char_type(const char *type) {
+    return type != NULL && strcmp(type, "Map<Int,Char>") == 0;
+}
+
+static int direct_is_map_str_int_type(const char *type) {
+    return type != NULL && strcmp(type, "Map<Str,Int>") == 0;
+}
+
+static int direct_is_map_str_bool_type(const char *type) {
+    return type != NULL && strcmp(type, "Map<Str,Bool>") == 0;
+}
+
+static int direct_is_map_str_char_type(const char *type) {
+    return type != NULL && strcmp(type, "Map<Str,Char>") == 0;
+}
+
+static int direct_is_map_str_str_type(const char *type) {
+    return type != NULL && strcmp(type, "Map<Str,Str>") == 0;
+}
+
+static int direct_is_map_type(const char *type) {
+    return direct_is_map_int_int_type(type) || direct_is_map_int_bool_type(type) || direct_is_map_int_char_type(type) || direct_is_map_str_int_type(type) || direct_is_map_str_bool_type(type) || direct_is_map_str_char_type(type) || direct_is_map_str_str_type(type);
+}
+
+static int direct_is_supported_map_return_type(const char *type) {
+    return direct_is_map_int_int_type(type) || direct_is_map_int_bool_type(type) || direct_is_map_int_char_type(type) || direct_is_map_str_int_type(type) || direct_is_map_str_bool_type(type) || direct_is_map_str_char_type(type) || direct_is_map_str_str_type(type);
+}
+
+static const char *direct_map_key_type(const char *type) {
+    if (direct_is_map_str_str_type(type)) return "Str";
+    if (direct_is_map_str_char_type(type)) return "Str";
+    if (direct_is_map_str_bool_type(type)) return "Str";
+    if (direct_is_map_str_int_type(type)) return "Str";
+    if (direct_is_map_type(type)) return "Int";
+    return NULL;
+}
+
+static const char *direct_map_value_type(const char *type) {
+    if (direct_is_map_str_str_type(type)) return "Str";
+    if (direct_is_map_str_char_type(type)) return "Char";
+    if (direct_is_map_str_bool_type(type)) return "Bool";
+    if (direct_is_map_str_int_type(type)) return "Int";
+    if (direct_is_map_int_int_type(type)) return "Int";
+    if (direct_is_map_int_bool_type(type)) return "Bool";
+    if (direct_is_map_int_char_type(type)) return "Char";
+    return NULL;
+}
+
+static const char *direct_map_helper_name(const char *type, const char *method) {
+    if (direct_is_map_str_str_type(type)) {
+        if (strcmp(method, "insert") == 0) return "__vais_map_str_str_insert";
+        if (strcmp(method, "remove") == 0) return "__vais_map_str_str_remove";
+        if (strcmp(method, "clear") == 0) return "__vais_map_str_str_clear";
+        if (strcmp(method, "copy") == 0) return "__vais_map_str_str_copy";
+        if (strcmp(method, "clone") == 0) return "__vais_map_str_str_clone";
+        if (strcmp(method, "free") == 0) return "__vais_map_str_str_free";
+        if (strcmp(method, "get") == 0) return "__vais_map_str_str_get";
+        if (strcmp(method, "get_opt") == 0) return "__vais_map_str_str_get_opt";
+        if (strcmp(method, "contains") == 0) return "__vais_map_str_str_contains";
+        if (strcmp(method, "len") == 0) return "__vais_map_str_str_len";
+        if (strcmp(method, "key_at") == 0) return "__vais_map_str_str_key_at";
+        if (strcmp(method, "value_at") == 0) return "__vais_map_str_str_value_at";
+    }
+    if (direct_is_map_str_int_type(type) || direct_is_map_str_bool_type(type) || direct_is_map_str_char_type(type)) {
+        if (strcmp(method, "insert") == 0) return "__vais_map_str_int_insert";
+        if (strcmp(method, "remove") == 0) return "__vais_map_str_int_remove";
+        if (strcmp(method, "clear") == 0) return "__vais_map_str_int_clear";
+        if (strcmp(method, "copy") == 0) return "__vais_map_str_int_copy";
+        if (strcmp(method, "clone") == 0) return "__vais_map_str_int_clone";
+        if (strcmp(method, "free") == 0) return "__vais_map_str_int_free";
+        if (strcmp(method, "get") == 0) return "__vais_map_str_int_get";
+        if (strcmp(method, "get_opt") == 0) return "__vais_map_str_int_get_opt";
+        if (strcmp(method, "contains") == 0) return "__vais_map_str_int_contains";
+        if (strcmp(method, "len") == 0) return "__vais_map_str_int_len";
+        if (strcmp(method, "key_at") == 0) return "__vais_map_str_int_key_at";
+        if (strcmp(method, "value_at") == 0) return "__vais_map_str_int_value_at";
+    }
+    if (strcmp(method, "insert") == 0) return "__vais_map_int_int_insert";
+    if (strcmp(method, "remove") == 0) return "__vais_map_int_int_remove";
+    if (strcmp(method, "clear") == 0) return "__vais_map_int_int_clear";
+    if (strcmp(method, "copy") == 0) return "__vais_map_int_int_copy";
+    if (strcmp(method, "clone") == 0) return "__vais_map_int_int_clone";
+    if (strcmp(method, "free") == 0) return "__vais_map_int_int_free";
+    if (strcmp(method, "get") == 0) return "__vais_map_int_int_get";
+    if (strcmp(method, "get_opt") == 0) return "__vais_map_int_int_get_opt";
+    if (strcmp(method, "contains") == 0) return "__vais_map_int_int_contains";
+    if (strcmp(method, "len") == 0) return "__vais_map_int_int_len";
+    if (strcmp(method, "key_at") == 0) return "__vais_map_int_int_key_at";
+    if (strcmp(method, "value_at") == 0) return "__vais_map_int_int_value_at";
+    return "__vais_map_int_int_len";
+}
+
+static int direct_map_arg_type_compatible(const char *expected, const char *actual) {
+    if (expected == NULL || actual == NULL) return 0;
+    return strcmp(expected, actual) == 0;
+}
+
+static int direct_is_list_type(const char *type) {
+    size_t n = type == NULL ? 0 : strlen(type);
+    return n > 6 && starts_with(type, "List<") && type[n - 1] == '>';
+}
+
+static char *direct_list_element_type(const char *type) {
+    if (!direct_is_list_type(type)) return NULL;
+    size_t n = strlen(type);
+    return substr_copy(type + 5, n - 6);
+}
+
+static int direct_is_list_struct_type(DirectStructInfo *structs, int struct_count, const char *type) {
+    char *elem = direct_list_element_type(type);
+    if (elem == NULL) return 0;
+    int ok = strcmp(elem, "Int") != 0 && direct_find_struct(structs, struct_count, elem) != NULL;
+    free(elem);
+    return ok;
+}
+
+static int direct_is_str_type(const char *type) {
+    return type != NULL && strcmp(type, "Str") == 0;
+}
+
+static int direct_is_bool_type(const char *type) {
+    return type != NULL && strcmp(type, "Bool") == 0;
+}
+
+static int direct_is_char_type(const char *type) {
+    return type != NULL && strcmp(type, "Char") == 0;
+}
+
+static int direct_is_intlike_scalar_type(const char *type) {
+    return type != NULL && (
+        strcmp(type, "Int") == 0 ||
+        direct_is_bool_type(type) ||
+        direct_is_char_type(type)
+    );
+}
+
+static int direct_return_type_allowed(DirectStructInfo *structs, int struct_count, const char *type) {
+    return strcmp(type, "Int") == 0 ||
+        direct_is_str_type(type) ||
+        direct_is_bool_type(type) ||
+        direct_is_char_type(type) ||
+        direct_is_option_result_type(type) ||
+        direct_is_list_int_type(type) ||
+        direct_is_list_str_type(type) ||
+        direct_is_list_struct_type(structs, struct_count, type) ||
+        direct_is_supported_map_return_type(type) ||
+        direct_find_struct(structs, struct_count, type) != NULL;
+}
+
+static int direct_param_type_allowed(DirectStructInfo *structs, int struct_count, const char *type) {
+    return direct_return_type_allowed(structs, struct_count, type) ||
+        direct_is_map_int_int_type(type) ||
+        direct_is_map_int_bool_type(type) ||
+        direct_is_map_int_char_type(type) ||
+        direct_is_map_str_int_type(type) ||
+        direct_is_map_str_bool_type(type) ||
+        direct_is_map_str_char_type(type) ||
+        direct_is_map_str_str_type(type);
+}
+
+static int direct_local_type_allowed(DirectStructInfo *structs, int struct_count, const char *type) {
+    return direct_return_type_allowed(structs, struct_count, type) ||
+        direct_is_list_struct_type(structs, struct_count, type) ||
+        direct_is_map_type(type);
+}
+
+static int direct_type_compatible(const char *expected, const char *actual) {
+    if (expected == NULL || actual == NULL) return 1;
+    if (direct_is_intlike_scalar_type(expected) && direct_is_intlike_scalar_type(actual)) return 1;
+    return strcmp(expected, actual) == 0;
+}
+
+static const char *direct_c_type(const char *type) {
+    if (direct_is_str_type(type)) return "Str";
+    if (direct_is_bool_type(type)) return "Bool";
+    if (direct_is_char_type(type)) return "long";
+    if (direct_is_option_result_type(type)) return "long";
+    if (direct_is_list_int_type(type)) return "DirectListInt";
+    if (direct_is_list_str_type(type)) return "DirectList_Str";
+    if (direct_is_map_str_str_type(type)) return "DirectMapStrStr";
+    if (direct_is_map_str_int_type(type) || direct_is_map_str_bool_type(type) || direct_is_map_str_char_type(type)) return "DirectMapStrInt";
+    if (direct_is_map_type(type)) return "DirectMapIntInt";
+    if (direct_is_list_type(type)) {
+        static char bufs[4][128];
+        static int slot = 0;
+        char *elem = direct_list_element_type(type);
+        slot = (slot + 1) % 4;
+        snprintf(bufs[slot], sizeof(bufs[slot]), "DirectList_%s", elem == NULL ? "Unknown" : elem);
+        free(elem);
+        return bufs[slot];
+    }
+    return strcmp(type, "Int") == 0 ? "long" : type;
+}
+
+static const char *direct_c_param_type(const char *type) {
+    if (direct_is_map_str_str_type(type)) return "DirectMapStrStr *";
+    if (direct_is_map_str_int_type(type) || direct_is_map_str_bool_type(type) || direct_is_map_str_char_type(type)) return "DirectMapStrInt *";
+    if (direct_is_map_type(type)) return "DirectMapIntInt *";
+    if (direct_is_list_type(type)) {
+        static char bufs[4][136];
+        static int slot = 0;
+        slot = (slot + 1) % 4;
+        snprintf(bufs[slot], sizeof(bufs[slot]), "%s *", direct_c_type(type));
+        return bufs[slot];
+    }
+    return direct_c_type(type);
+}
+
+static void direct_append_default_initializer(StrBuf *out, const char *type) {
+    if (direct_is_str_type(type)) {
+        sb_append(out, "\"\"");
+    } else if (direct_is_option_result_type(type)) {
+        sb_append(out, "1");
+    } else if (direct_is_intlike_scalar_type(type)) {
+        sb_append(out, "0");
+    } else {
+        sb_append(out, "{0}");
+    }
+}
+
+static void direct_append_cast_initializer_prefix(StrBuf *out, const char *type) {
+    sb_append(out, "(");
+    sb_append(out, direct_c_type(type));
+    sb_append(out, ")");
+}
+
+static void direct_emit_local_binding_prefix(
+    StrBuf *out,
+    DirectNameSet *locals,
+    const char *name,
+    const char *type,
+    int already_bound,
+    int force_local_decl
+) {
+    if (locals->hoist_decls != NULL && !force_local_decl) {
+        if (!already_bound) {
+            sb_append(locals->hoist_decls, direct_c_type(type));
+            sb_append(locals->hoist_decls, " ");
+            sb_append(locals->hoist_decls, name);
+            sb_append(locals->hoist_decls, " = ");
+            direct_append_default_initializer(locals->hoist_decls, type);
+            sb_append(locals->hoist_decls, ";\n");
+        }
+        sb_append(out, name);
+        sb_append(out, " = ");
+        return;
+    }
+    sb_append(out, direct_c_type(type));
+    sb_append(out, " ");
+    sb_append(out, name);
+    sb_append(out, " = ");
+}
+
+/*
+ * Owned List and Map locals live in hoisted C variables that start as {0},
+ * so a binding frees the storage it replaces (a `let` re-run by a loop, an
+ * assignment) and every return frees what is still held, except a local
+ * the return moves out. Freeing a never-bound local frees NULL pointers.
+ */
+static const char *direct_map_helper_name(const char *type, const char *method);
+
+static int direct_local_owns_heap(const DirectLocalInfo *info) {
+    return info->heap_owned && !info->is_ref && (direct_is_list_type(info->type) || direct_is_map_type(info->type));
+}
+
+static int direct_names_has_owned_heap(DirectNameSet *locals, const char *keep) {
+    for (int i = 0; i < locals->count; i++) {
+        DirectLocalInfo *info = locals->items[i];
+        if (direct_local_owns_heap(info) && (keep == NULL || strcmp(info->name, keep) != 0)) return 1;
+    }
+    return 0;
+}
+
+/* Frees a List or Map value held in `name` (a local or a saved old value). */
+static void direct_append_heap_free(StrBuf *out, const char *type, const char *name) {
+    if (direct_is_map_type(type)) {
+        sb_append(out, direct_map_helper_name(type, "free"));
+        sb_append(out, "(&");
+        sb_append(out, name);
+        sb_append(out, ");\n");
+        return;
+    }
+    sb_append(out, "free(");
+    sb_append(out, name);
+    sb_append(out, ".data);\n");
+}
+
+static void direct_append_owned_heap_frees(StrBuf *out, DirectNameSet *locals, const char *keep) {
+    for (int i = 0; i < locals->count; i++) {
+        DirectLocalInfo *info = locals->items[i];
+        if (!direct_local_owns_heap(info) || (keep != NULL && strcmp(info->name, keep) == 0)) continue;
+        direct_append_heap_free(out, info->type, info->name);
+    }
+}
+
+/* Whether a `let name: List<..>` or `Map<..>` about to be emitted rebinds a
+   hoisted variable that may still hold storage from an earlier run. */
+static int direct_let_replaces_heap(DirectNameSet *locals, const char *name, int already_bound, int redeclare_local) {
+    if (locals->hoist_decls == NULL || redeclare_local) return 0;
+    if (!already_bound) return 1;
+    DirectLocalInfo *info = direct_names_find(locals, name);
+    return info != NULL && direct_local_owns_heap(info);
+}
+
+/* Saves `name`'s current value in a fresh temp (written to old_name) so its
+   storage can be freed once the new value, which may still read it, is
+   stored. */
+static void direct_append_heap_old_value(StrBuf *out, DirectNameSet *locals, const char *name, const char *type, int is_ref, char *old_name, size_t old_len) {
+    snprintf(old_name, old_len, "__vais_heap_old_%d", locals->temp_count++);
+    sb_append(out, direct_c_type(type));
+    sb_append(out, " ");
+    sb_append(out, old_name);
+    sb_append(out, is_ref ? " = *" : " = ");
+    sb_append(out, name);
+    sb_append(out, ";\n");
+}
+
+static void direct_note_owned_heap(DirectNameSet *locals, const char *name) {
+    DirectLocalInfo *info = direct_names_find(locals, name);
+    if (info != NULL) info->heap_owned = 1;
+}
+
+static char *direct_parse_local_type(const char **cursor) {
+    const char *p = skip_ws(*cursor);
+    if (*p == '&') {
+        p = skip_ws(p + 1);
+        *cursor = p;
+        return direct_parse_local_type(cursor);
+    }
+    if (starts_with(p, "Option") && !is_ident_continue(p[6])) {
+        const char *q = skip_ws(p + 6);
+        if (*q == '<') {
+            q = skip_ws(q + 1);
+            if (starts_with(q, "Int") && !is_ident_continue(q[3])) {
+                q = skip_ws(q + 3);
+                if (*q == '>') {
+                    *cursor = skip_ws(q + 1);
+                    return strdup("Option<Int>");
+                }
+            }
+        }
+    }
+    if (starts_with(p, "Result") && !is_ident_continue(p[6])) {
+        const char *q = skip_ws(p + 6);
+        if (*q == '<') {
+            q = skip_ws(q + 1);
+            if (starts_with(q, "Int") && !is_ident_continue(q[3])) {
+                q = skip_ws(q + 3);
+                if (*q == ',') {
+                    q = skip_ws(q + 1);
+                    if (starts_with(q, "Int") && !is_ident_continue(q[3])) {
+                        q = skip_ws(q + 3);
+                        if (*q == '>') {
+                            *cursor = skip_ws(q + 1);
+                            return strdup("Result<Int,Int>");
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (starts_with(p, "Map") && !is_ident_continue(p[3])) {
+        const char *q = skip_ws(p + 3);
+        if (*q == '<') {
+            q = skip_ws(q + 1);
+            if (!is_ident_start(*q)) return NULL;
+            const char *key_start = q;
+            q++;
+            while (is_ident_continue(*q)) q++;
+            char *key = substr_copy(key_start, (size_t)(q - key_start));
+            q = skip_ws(q);
+            if (*q == ',') {
+                q = skip_ws(q + 1);
+                if (!is_ident_start(*q)) {
+                    free(key);
+                    return NULL;
+                }
+                const char *value_start = q;
+                q++;
+                while (is_ident_continue(*q)) q++;
+                char *value = substr_copy(value_start, (size_t)(q - value_start));
+                q = skip_ws(q);
+                if (*q == '>') {
+                    *cursor = skip_ws(q + 1);
+                    StrBuf out;
+                    sb_init(&out);
+                    sb_append(&out, "Map<");
+                    sb_append(&out, key);
+                    sb_append(&out, ",");
+                    sb_append(&out, value);
+                    sb_append(&out, ">");
+                    free(key);
+                    free(value);
+                    return sb_take(&out);
+                }
+                free(value);
+            }
+            free(key);
+        }
+    }
+    if (starts_with(p, "List") && !is_ident_continue(p[4])) {
+        const char *q = skip_ws(p + 4);
+        if (*q == '<') {
+            q = skip_ws(q + 1);
+            if (!is_ident_start(*q)) return NULL;
+            const char *elem_start = q;
+            q++;
+            while (is_ident_continue(*q)) q++;
+            char *elem = substr_copy(elem_start, (size_t)(q - elem_start));
+            q = skip_ws(q);
+            if (*q == '>') {
+                *cursor = skip_ws(q + 1);
+                StrBuf out;
+                sb_init(&out);
+                sb_append(&out, "List<");
+                sb_append(&out, elem);
+                sb_append(&out, ">");
+                free(elem);
+                return sb_take(&out);
+            }
+            free(elem);
+        }
+    }
+    if (!is_ident_start(*p)) return NULL;
+    const char *type_start = p;
+    p++;
+    while (is_ident_continue(*p)) p++;
+    *cursor = p;
+    return substr_copy(type_start, (size_t)(p - type_start));
+}
+
+int find_matching_brace_c(const char *text, int open_index) {
+    int depth = 0;
+    for (int i = open_index; text[i] != '\0'; i++) {
+        if (is_string_delim_c(text[i])) {
+            int end = skip_string_literal_c(text, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (text[i] == '\'') {
+            int end = skip_char_literal_c(text, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (text[i] == '{') depth++;
+        if (text[i] == '}') {
+            depth--;
+            if (depth == 0) return i;
+        }
+    }
+    return -1;
+}
+
+static int direct_parse_struct_field(
+    const char *path,
+    int line_no,
+    const char *source_line,
+    const char *text,
+    DirectStructInfo *known_structs,
+    int known_struct_count,
+    DirectStructInfo *out
+) {
+    char *part = trim_copy(text);
+    const char *s = skip_ws(part);
+    if (*s == '\0') {
+        free(part);
+        return 0;
+    }
+    if (!is_ident_start(*s)) {
+        report_issue(path, line_no, 1, source_line,
+            "direct native emitter expected a struct field name",
+            "write struct fields as `name: Int`.",
+            NULL);
+        free(part);
+        return -1;
+    }
+    const char *name_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    char *field = substr_copy(name_start, (size_t)(s - name_start));
+    char *field_type = strdup("Int");
+    if (field_type == NULL) die_oom();
+    const char *rest = skip_ws(s);
+    if (*rest == ':') {
+        char *ty = trim_copy(rest + 1);
+        int ok = strcmp(ty, "Int") == 0 || strcmp(ty, "Str") == 0;
+        if (ok && strcmp(ty, "Int") != 0) {
+            free(field_type);
+            field_type = strdup(ty);
+            if (field_type == NULL) die_oom();
+        }
+        if (!ok) {
+            DirectStructInfo *nested = direct_find_struct(known_structs, known_struct_count, ty);
+            ok = nested != NULL;
+            if (ok) {
+                free(field_type);
+                field_type = strdup(ty);
+                if (field_type == NULL) die_oom();
+            }
+        }
+        if (!ok) {
+            report_issue(path, line_no, find_col(source_line, field), source_line,
+                "direct native emitter supports Int, Str, and previously declared nested struct fields only",
+                "write this direct-engine field as `name: Int`, `name: Str`, or as a previously declared struct type.",
+                NULL);
+            free(ty);
+            free(field_type);
+            free(field);
+            free(part);
+            return -1;
+        }
+        free(ty);
+    } else if (*rest != '\0') {
+        report_issue(path, line_no, find_col(source_line, field), source_line,
+            "direct native emitter expected an Int struct field",
+            "write struct fields as `name: Int`.",
+            NULL);
+        free(field_type);
+        free(field);
+        free(part);
+        return -1;
+    }
+    if (direct_struct_has_field(out, field)) {
+        report_issue(path, line_no, find_col(source_line, field), source_line,
+            "direct native emitter found a duplicate struct field",
+            "use each field name only once in a struct declaration.",
+            NULL);
+        free(field_type);
+        free(field);
+        free(part);
+        return -1;
+    }
+    if (out->field_count >= DIRECT_MAX_STRUCT_FIELDS) {
+        report_issue(path, line_no, 1, source_line,
+            "direct native emitter supports up to 64 struct fields",
+            "split this direct-engine struct into a smaller shape for now.",
+            NULL);
+        free(field_type);
+        free(field);
+        free(part);
+        return -1;
+    }
+    out->fields[out->field_count++] = field;
+    out->field_types[out->field_count - 1] = field_type;
+    free(part);
+    return 0;
+}
+
+static int direct_parse_struct_fields(
+    const char *path,
+    int line_no,
+    const char *source_line,
+    const char *body,
+    DirectStructInfo *known_structs,
+    int known_struct_count,
+    DirectStructInfo *out
+) {
+    const char *start = body;
+    for (const char *p = body; ; p++) {
+        char ch = *p;
+        if (ch == ',' || ch == '\n' || ch == '\0') {
+            char *piece = substr_copy(start, (size_t)(p - start));
+            int rc = direct_parse_struct_field(path, line_no, source_line, piece, known_structs, known_struct_count, out);
+            free(piece);
+            if (rc < 0) return -1;
+            if (ch == '\0') break;
+            start = p + 1;
+        }
+        if (ch == '\0') break;
+    }
+    if (out->field_count == 0) {
+        report_issue(path, line_no, 1, source_line,
+            "direct native emitter expected at least one Int struct field",
+            "write a shape such as `struct Box { value: Int }`.",
+            NULL);
+        return -1;
+    }
+    return 0;
+}
+
+static int direct_parse_struct_decl(
+    LineVec *lines,
+    size_t start_index,
+    DirectStructInfo *out,
+    size_t *end_index,
+    DirectStructInfo *known_structs,
+    int known_struct_count,
+    const char *path
+) {
+    char *first = strip_line_comment(lines->items[start_index], strlen(lines->items[start_index]));
+    const char *s = skip_ws(first);
+    if (!starts_with(s, "struct ")) {
+        free(first);
+        return 0;
+    }
+    s += 7;
+    if (!is_ident_start(*s)) {
+        report_issue(path, (int)start_index + 1, find_col(lines->items[start_index], "struct"), lines->items[start_index],
+            "direct native emitter expected a struct name",
+            "write `struct Name { field: Int }`.",
+            NULL);
+        free(first);
+        return -1;
+    }
+    const char *name_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *open = strchr(s, '{');
+    if (open == NULL) {
+        report_issue(path, (int)start_index + 1, find_col(lines->items[start_index], "struct"), lines->items[start_index],
+            "direct native emitter expected a struct body",
+            "write `struct Name { field: Int }`.",
+            NULL);
+        free(first);
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->name = substr_copy(name_start, (size_t)(s - name_start));
+    out->line_no = (int)start_index + 1;
+
+    StrBuf body;
+    sb_init(&body);
+    const char *close = strchr(open + 1, '}');
+    if (close != NULL) {
+        sb_append_n(&body, open + 1, (size_t)(close - open - 1));
+        *end_index = start_index;
+    } else {
+        sb_append(&body, open + 1);
+        sb_append(&body, "\n");
+        int found = 0;
+        for (size_t i = start_index + 1; i < lines->len; i++) {
+            char *field_line = strip_line_comment(lines->items[i], strlen(lines->items[i]));
+            const char *field_close = strchr(field_line, '}');
+            if (field_close != NULL) {
+                sb_append_n(&body, field_line, (size_t)(field_close - field_line));
+                *end_index = i;
+                found = 1;
+                free(field_line);
+                break;
+            }
+            sb_append(&body, field_line);
+            sb_append(&body, "\n");
+            free(field_line);
+        }
+        if (!found) {
+            report_issue(path, (int)start_index + 1, find_col(lines->items[start_index], "struct"), lines->items[start_index],
+                "direct native emitter expected `}` to close the struct",
+                "close the struct declaration before declaring functions.",
+                NULL);
+            free(body.data);
+            direct_struct_free_one(out);
+            free(first);
+            return -1;
+        }
+    }
+
+    if (direct_parse_struct_fields(path, (int)start_index + 1, lines->items[start_index], body.data, known_structs, known_struct_count, out) != 0) {
+        free(body.data);
+        direct_struct_free_one(out);
+        free(first);
+        return -1;
+    }
+    free(body.data);
+    free(first);
+    return 1;
+}
+
+static int parse_direct_fn_header(const char *line, DirectFnInfo *out) {
+    const char *s = skip_ws(line);
+    if (!starts_with(s, "fn ")) return 0;
+    s += 3;
+    if (!is_ident_start(*s)) return -1;
+    const char *name_start = s;
+    while (is_ident_continue(*s)) s++;
+    char *name = substr_copy(name_start, (size_t)(s - name_start));
+    const char *open = strchr(s, '(');
+    const char *close = open == NULL ? NULL : strchr(open, ')');
+    const char *brace = close == NULL ? NULL : strchr(close, '{');
+    const char *arrow = close == NULL ? NULL : strstr(close, "->");
+    if (open == NULL || close == NULL || brace == NULL || arrow == NULL) {
+        free(name);
+        return -1;
+    }
+    const char *ret = skip_ws(arrow + 2);
+    const char *ret_cursor = ret;
+    char *return_type = direct_parse_local_type(&ret_cursor);
+    if (return_type == NULL) {
+        free(name);
+        return -1;
+    }
+    if (*skip_ws(ret_cursor) != '{') {
+        free(return_type);
+        free(name);
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+    out->name = name;
+    out->return_type = return_type;
+    char *params_text = substr_copy(open + 1, (size_t)(close - open - 1));
+    char *parts[16] = {0};
+    int n = split_top_level_type_commas_c(params_text, parts, 16);
+    free(params_text);
+    if (n < 0) {
+        direct_fns_free(out, 1);
+        return -1;
+    }
+    if (n == 1 && parts[0] != NULL && strlen(skip_ws(parts[0])) == 0) {
+        free(parts[0]);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        char *part = parts[i];
+        char *colon = strchr(part, ':');
+        if (colon == NULL) {
+            free(part);
+            direct_fns_free(out, 1);
+            for (int k = i + 1; k < n; k++) free(parts[k]);
+            return -1;
+        }
+        char *pname_raw = substr_copy(part, (size_t)(colon - part));
+        char *pname = trim_copy(pname_raw);
+        free(pname_raw);
+        const char *pty_cursor = skip_ws(colon + 1);
+        char *pty = direct_parse_local_type(&pty_cursor);
+        int ok = direct_is_plain_ident(pname) && pty != NULL && *skip_ws(pty_cursor) == '\0';
+        free(part);
+        if (!ok) {
+            free(pname);
+            free(pty);
+            free(out->name);
+            free(out->return_type);
+            for (int p = 0; p < out->param_count; p++) {
+                free(out->params[p]);
+                free(out->param_types[p]);
+            }
+            for (int k = i + 1; k < n; k++) free(parts[k]);
+            return -1;
+        }
+        out->params[out->param_count] = pname;
+        out->param_types[out->param_count] = pty;
+        out->param_count++;
+    }
+    return 1;
+}
+
+static int direct_validate_fn_types(
+    const char *path,
+    const char *line,
+    DirectFnInfo *info,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    int issues = 0;
+    if (!direct_return_type_allowed(structs, struct_count, info->return_type)) {
+            report_issue(path, info->line_no, find_col(line, info->return_type), line,
+                "direct native emitter function return type is not available",
+                "use `Int`, `Bool`, `Char`, `Str`, `Option<Int>`, `Result<Int,Int>`, `List<Int>`, `List<Struct>`, `Map<Int,Int>`, `Map<Int,Bool>`, `Map<Int,Char>`, `Map<Str,Int>`, `Map<Str,Bool>`, `Map<Str,Char>`, `Map<Str,Str>`, or a struct declared in this file.",
+                "fn f() -> Int");
+        issues++;
+    }
+    for (int p = 0; p < info->param_count; p++) {
+        if (!direct_param_type_allowed(structs, struct_count, info->param_types[p])) {
+            report_issue(path, info->line_no, find_col(line, info->param_types[p]), line,
+                "direct native emitter function parameter type is not available",
+                "use `Int`, `Bool`, `Char`, `Str`, `Option<Int>`, `Result<Int,Int>`, `List<Int>`, `List<Struct>`, `Map<Int,Int>`, `Map<Int,Bool>`, `Map<Int,Char>`, `Map<Str,Int>`, `Map<Str,Bool>`, `Map<Str,Char>`, `Map<Str,Str>`, or a struct declared in this file.",
+                "fn f(x: Int) -> Int");
+            issues++;
+        }
+    }
+    return issues;
+}
+
+static char *direct_translate_expr(const char *expr) {
+    char *a = replace_word_all(expr, "and", "&&");
+    char *b = replace_word_all(a, "or", "||");
+    free(a);
+    char *c = replace_word_all(b, "not", "!");
+    free(b);
+    return c;
+}
+
+static int direct_parse_list_literal_items(const char *expr, char **parts, int max_parts, int *count) {
+    *count = 0;
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (*s != '[') {
+        free(trimmed);
+        return 0;
+    }
+    int open = (int)(s - trimmed);
+    int close = find_matching_bracket_c(trimmed, open);
+    if (close < 0 || *skip_ws(trimmed + close + 1) != '\0') {
+        free(trimmed);
+        return 0;
+    }
+    char *body = substr_copy(trimmed + open + 1, (size_t)(close - open - 1));
+    char *body_trim = trim_copy(body);
+    free(body);
+    if (body_trim[0] == '\0') {
+        free(body_trim);
+        free(trimmed);
+        return 1;
+    }
+    int n = split_top_level_commas_c(body_trim, parts, max_parts);
+    free(body_trim);
+    free(trimmed);
+    if (n < 0) return -1;
+    if (n > 0 && parts[n - 1] != NULL && parts[n - 1][0] == '\0') {
+        free(parts[n - 1]);
+        parts[n - 1] = NULL;
+        n--;
+    }
+    *count = n;
+    return 1;
+}
+
+static int direct_is_list_constructor_expr(const char *expr) {
+    char *trimmed = trim_copy(expr);
+    int ok = strcmp(trimmed, "list()") == 0;
+    free(trimmed);
+    return ok;
+}
+
+static int direct_parse_list_initializer_items(const char *expr, char **parts, int max_parts, int *count) {
+    *count = 0;
+    if (direct_is_list_constructor_expr(expr)) return 1;
+    return direct_parse_list_literal_items(expr, parts, max_parts, count);
+}
+
+static int direct_list_initializer_state(const char *expr) {
+    char *parts[16] = {0};
+    int count = 0;
+    int parsed = direct_parse_list_initializer_items(expr, parts, 16, &count);
+    for (int i = 0; i < 16; i++) free(parts[i]);
+    return parsed;
+}
+
+static int direct_is_list_initializer_expr(const char *expr) {
+    int parsed = direct_list_initializer_state(expr);
+    return parsed == 1;
+}
+
+static int direct_is_map_empty_initializer_expr(const char *expr) {
+    char *trimmed = trim_copy(expr);
+    int ok = strcmp(trimmed, "{}") == 0;
+    free(trimmed);
+    return ok;
+}
+
+static char *direct_rewrite_single_field_nested_struct_value(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *value,
+    const char *expected_type,
+    DirectStructInfo *nested,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    char *trimmed = trim_copy(value);
+    const char *s = skip_ws(trimmed);
+    if (!is_ident_start(*s)) {
+        report_issue(path, line_no, 1, line,
+            "direct native emitter expected a nested struct literal",
+            "write the nested field as `inner: Inner { v: value }`.",
+            NULL);
+        free(trimmed);
+        return NULL;
+    }
+    const char *type_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    char *type_name = substr_copy(type_start, (size_t)(s - type_start));
+    const char *open = skip_ws(s);
+    if (strcmp(type_name, expected_type) != 0 || *open != '{') {
+        report_issue(path, line_no, find_col(line, type_name), line,
+            "direct native emitter nested field type does not match",
+            "use the struct type declared by the outer field.",
+            NULL);
+        free(type_name);
+        free(trimmed);
+        return NULL;
+    }
+    int close = find_matching_brace_c(trimmed, (int)(open - trimmed));
+    if (close < 0 || *skip_ws(trimmed + close + 1) != '\0') {
+        report_issue(path, line_no, find_col(line, type_name), line,
+            "direct native emitter expected `}` to close the nested struct literal",
+            "write a complete single-field nested struct literal.",
+            NULL);
+        free(type_name);
+        free(trimmed);
+        return NULL;
+    }
+    char *body = substr_copy(open + 1, (size_t)(close - (open - trimmed) - 1));
+    char *parts[16] = {0};
+    int n = split_top_level_commas_c(body, parts, 16);
+    free(body);
+    if (n < 0) {
+        report_issue(path, line_no, find_col(line, type_name), line,
+            "direct native emitter supports up to 64 nested literal fields",
+            "keep this direct-engine nested literal small.",
+            NULL);
+        free(type_name);
+        free(trimmed);
+        return NULL;
+    }
+    char *result = NULL;
+    for (int p = 0; p < n; p++) {
+        char *part = trim_copy(parts[p]);
+        if (part[0] == '\0') {
+            free(part);
+            continue;
+        }
+        char *colon = strchr(part, ':');
+        if (colon == NULL) {
+            report_issue(path, line_no, find_col(line, type_name), line,
+                "direct native emitter expected named nested struct fields",
+                "write nested fields as `v: expr`.",
+                NULL);
+            free(part);
+            for (int k = 0; k < n; k++) free(parts[k]);
+            free(type_name);
+            free(trimmed);
+            return NULL;
+        }
+        char *field_raw = substr_copy(part, (size_t)(colon - part));
+        char *field = trim_copy(field_raw);
+        free(field_raw);
+        if (strcmp(field, nested->fields[0]) != 0) {
+            report_issue(path, line_no, find_col(line, field), line,
+                "direct native emitter found an unknown nested struct field",
+                "use the single field declared on this nested struct.",
+                NULL);
+            free(field);
+            free(part);
+            for (int k = 0; k < n; k++) free(parts[k]);
+            free(type_name);
+            free(trimmed);
+            return NULL;
+        }
+        char *inner_value = trim_copy(colon + 1);
+        result = direct_rewrite_struct_literals(path, line_no, line, inner_value, structs, struct_count);
+        free(inner_value);
+        free(field);
+        free(part);
+        if (result == NULL) {
+            for (int k = 0; k < n; k++) free(parts[k]);
+            free(type_name);
+            free(trimmed);
+            return NULL;
+        }
+        break;
+    }
+    for (int k = 0; k < n; k++) free(parts[k]);
+    if (result == NULL) {
+        report_issue(path, line_no, find_col(line, type_name), line,
+            "direct native emitter expected the nested struct field value",
+            "initialize the single field declared by this nested struct.",
+            NULL);
+    }
+    free(type_name);
+    free(trimmed);
+    return result;
+}
+
+static char *direct_rewrite_struct_literals(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    StrBuf out;
+    sb_init(&out);
+    for (int i = 0; expr[i] != '\0';) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an unterminated string literal",
+                    "close the string before the end of the line.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an invalid char literal",
+                    "write a single-byte character literal such as `'A'`.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (!is_ident_start(expr[i])) {
+            sb_append_n(&out, expr + i, 1);
+            i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(expr[i])) i++;
+        char *name = substr_copy(expr + start, (size_t)(i - start));
+        int cursor = i;
+        while (expr[cursor] == ' ' || expr[cursor] == '\t') cursor++;
+        DirectStructInfo *st = direct_find_struct(structs, struct_count, name);
+        if (st == NULL || expr[cursor] != '{') {
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(name);
+            continue;
+        }
+        int close = find_matching_brace_c(expr, cursor);
+        if (close < 0) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter expected `}` to close the struct literal",
+                "write a complete literal such as `Box { value: 42 }`.",
+                NULL);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        char *body = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+        char *parts[DIRECT_MAX_STRUCT_LITERAL_FIELDS] = {0};
+        int n = split_top_level_commas_c(body, parts, DIRECT_MAX_STRUCT_LITERAL_FIELDS);
+        free(body);
+        if (n < 0) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter supports up to 64 struct literal fields",
+                "keep this direct-engine literal within the small struct slice.",
+                NULL);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        sb_append(&out, "(");
+        sb_append(&out, name);
+        sb_append(&out, "){");
+        int emitted_fields = 0;
+        for (int p = 0; p < n; p++) {
+            char *part = trim_copy(parts[p]);
+            if (part[0] == '\0') {
+                free(part);
+                continue;
+            }
+            char *colon = strchr(part, ':');
+            if (colon == NULL) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected named struct literal fields",
+                    "write fields as `name: expr` inside the literal.",
+                    NULL);
+                for (int k = 0; k < n; k++) free(parts[k]);
+                free(part);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *field_raw = substr_copy(part, (size_t)(colon - part));
+            char *field = trim_copy(field_raw);
+            free(field_raw);
+            if (!direct_struct_has_field(st, field)) {
+                report_issue(path, line_no, find_col(line, field), line,
+                    "direct native emitter found an unknown struct field",
+                    "use a field declared on this struct.",
+                    NULL);
+                for (int k = 0; k < n; k++) free(parts[k]);
+                free(part);
+                free(field);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *value = trim_copy(colon + 1);
+            char *rewritten_value = direct_rewrite_struct_literals(path, line_no, line, value, structs, struct_count);
+            free(value);
+            if (rewritten_value == NULL) {
+                for (int k = 0; k < n; k++) free(parts[k]);
+                free(part);
+                free(field);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            if (emitted_fields > 0) sb_append(&out, ", ");
+            sb_append(&out, ".");
+            sb_append(&out, field);
+            sb_append(&out, " = ");
+            sb_append(&out, rewritten_value);
+            emitted_fields++;
+            free(rewritten_value);
+            free(field);
+            free(part);
+        }
+        sb_append(&out, "}");
+        for (int p = 0; p < n; p++) free(parts[p]);
+        free(name);
+        i = close + 1;
+    }
+    return sb_take(&out);
+}
+
+static int direct_expr_bare_list_local(DirectNameSet *locals, const char *expr, char **name_out) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (*s == '&') s = skip_ws(s + 1);
+    if (!is_ident_start(*s)) {
+        free(trimmed);
+        return 0;
+    }
+    const char *start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    if (*skip_ws(s) != '\0') {
+        free(trimmed);
+        return 0;
+    }
+    char *name = substr_copy(start, (size_t)(s - start));
+    int ok = direct_is_list_type(direct_names_type(locals, name));
+    if (ok && name_out != NULL) {
+        *name_out = name;
+    } else {
+        free(name);
+    }
+    free(trimmed);
+    return ok;
+}
+
+static int direct_expr_bare_map_local(DirectNameSet *locals, const char *expr, char **name_out) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (*s == '&') s = skip_ws(s + 1);
+    if (!is_ident_start(*s)) {
+        free(trimmed);
+        return 0;
+    }
+    const char *start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    if (*skip_ws(s) != '\0') {
+        free(trimmed);
+        return 0;
+    }
+    char *name = substr_copy(start, (size_t)(s - start));
+    int ok = direct_is_map_type(direct_names_type(locals, name));
+    if (ok && name_out != NULL) {
+        *name_out = name;
+    } else {
+        free(name);
+    }
+    free(trimmed);
+    return ok;
+}
+
+static DirectFnInfo *direct_expr_exact_call_fn(const char *expr, DirectFnInfo *fns, int fn_count) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (!is_ident_start(*s)) {
+        free(trimmed);
+        return NULL;
+    }
+    const char *name_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    char *name = substr_copy(name_start, (size_t)(s - name_start));
+    const char *rest = skip_ws(s);
+    if (*rest != '(') {
+        free(name);
+        free(trimmed);
+        return NULL;
+    }
+    int close = find_matching_paren_c(trimmed, (int)(rest - trimmed));
+    if (close < 0 || *skip_ws(trimmed + close + 1) != '\0') {
+        free(name);
+        free(trimmed);
+        return NULL;
+    }
+    DirectFnInfo *fn = direct_find_fn(fns, fn_count, name);
+    free(name);
+    free(trimmed);
+    return fn;
+}
+
+static int direct_expr_exact_list_return_call(const char *expr, DirectFnInfo *fns, int fn_count) {
+    DirectFnInfo *fn = direct_expr_exact_call_fn(expr, fns, fn_count);
+    return fn != NULL && direct_is_list_type(fn->return_type);
+}
+
+static int direct_expr_exact_map_return_call(const char *expr, DirectFnInfo *fns, int fn_count) {
+    DirectFnInfo *fn = direct_expr_exact_call_fn(expr, fns, fn_count);
+    return fn != NULL && direct_is_supported_map_return_type(fn->return_type);
+}
+
+static void direct_append_map_ptr_ref(StrBuf *out, const char *name, int is_ref) {
+    if (!is_ref) sb_append(out, "&");
+    sb_append(out, name);
+}
+
+static void direct_append_list_len_ref(StrBuf *out, const char *name, int is_ref) {
+    sb_append(out, name);
+    sb_append(out, is_ref ? "->len" : ".len");
+}
+
+static void direct_append_list_data_ref(StrBuf *out, const char *name, int is_ref) {
+    sb_append(out, name);
+    sb_append(out, is_ref ? "->data" : ".data");
+}
+
+static void direct_append_list_reserve_ref(StrBuf *out, const char *name, int is_ref, const char *need) {
+    const char *cap = is_ref ? "->cap" : ".cap";
+    sb_append(out, "if (");
+    sb_append(out, need);
+    sb_append(out, " > ");
+    sb_append(out, name);
+    sb_append(out, cap);
+    sb_append(out, ") ");
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, " = __vais_list_grow(");
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, ", &");
+    sb_append(out, name);
+    sb_append(out, cap);
+    sb_append(out, ", sizeof(*");
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, "), ");
+    sb_append(out, need);
+    sb_append(out, ");");
+}
+
+static void direct_append_list_push_reserve_ref(StrBuf *out, const char *name, int is_ref) {
+    StrBuf need;
+    sb_init(&need);
+    direct_append_list_len_ref(&need, name, is_ref);
+    sb_append(&need, " + 1");
+    direct_append_list_reserve_ref(out, name, is_ref, need.data);
+    free(need.data);
+}
+
+static void direct_append_list_sum_ref(StrBuf *out, const char *name, int is_ref) {
+    sb_append(out, "__vais_list_int_sum(");
+    if (!is_ref) sb_append(out, "&");
+    sb_append(out, name);
+    sb_append(out, ")");
+}
+
+static void direct_append_list_max_ref(StrBuf *out, const char *name, int is_ref) {
+    sb_append(out, "__vais_list_int_max(");
+    if (!is_ref) sb_append(out, "&");
+    sb_append(out, name);
+    sb_append(out, ")");
+}
+
+static void direct_append_list_min_ref(StrBuf *out, const char *name, int is_ref) {
+    sb_append(out, "__vais_list_int_min(");
+    if (!is_ref) sb_append(out, "&");
+    sb_append(out, name);
+    sb_append(out, ")");
+}
+
+static void direct_append_list_contains_ref(StrBuf *out, const char *name, int is_ref, const char *base_type, const char *value) {
+    sb_append(out, direct_is_list_str_type(base_type) ? "__vais_list_str_contains(" : "__vais_list_int_contains(");
+    if (!is_ref) sb_append(out, "&");
+    sb_append(out, name);
+    sb_append(out, ", ");
+    sb_append(out, value);
+    sb_append(out, ")");
+}
+
+static void direct_append_list_index_of_ref(StrBuf *out, const char *name, int is_ref, const char *base_type, const char *value) {
+    sb_append(out, direct_is_list_str_type(base_type) ? "__vais_list_str_index_of(" : "__vais_list_int_index_of(");
+    if (!is_ref) sb_append(out, "&");
+    sb_append(out, name);
+    sb_append(out, ", ");
+    sb_append(out, value);
+    sb_append(out, ")");
+}
+
+static void direct_append_list_count_ref(StrBuf *out, const char *name, int is_ref, const char *base_type, const char *value) {
+    sb_append(out, direct_is_list_str_type(base_type) ? "__vais_list_str_count(" : "__vais_list_int_count(");
+    if (!is_ref) sb_append(out, "&");
+    sb_append(out, name);
+    sb_append(out, ", ");
+    sb_append(out, value);
+    sb_append(out, ")");
+}
+
+static void direct_append_list_remove_at_ref(StrBuf *out, const char *name, int is_ref, const char *base_type, const char *index, DirectNameSet *locals) {
+    if (direct_is_list_int_type(base_type) || direct_is_list_str_type(base_type)) {
+        sb_append(out, direct_is_list_str_type(base_type) ? "__vais_list_str_remove_at(" : "__vais_list_int_remove_at(");
+        if (!is_ref) sb_append(out, "&");
+        sb_append(out, name);
+        sb_append(out, ", ");
+        sb_append(out, index);
+        sb_append(out, ")");
+        return;
+    }
+    char *elem_type = direct_list_element_type(base_type);
+    const char *ctype = direct_c_type(elem_type == NULL ? "Int" : elem_type);
+    char idx_name[64];
+    char tmp_name[64];
+    char loop_name[64];
+    int n = locals->temp_count++;
+    snprintf(idx_name, sizeof(idx_name), "__vais_list_remove_idx_%d", n);
+    snprintf(tmp_name, sizeof(tmp_name), "__vais_list_remove_value_%d", n);
+    snprintf(loop_name, sizeof(loop_name), "__vais_list_remove_i_%d", n);
+    StrBuf *dst = direct_current_prelude;
+    if (dst != NULL) {
+        sb_append(dst, "long ");
+        sb_append(dst, idx_name);
+        sb_append(dst, " = (long)(");
+        sb_append(dst, index);
+        sb_append(dst, ");\n");
+        sb_append(dst, "if (");
+        sb_append(dst, idx_name);
+        sb_append(dst, " < 0 || ");
+        sb_append(dst, idx_name);
+        sb_append(dst, " >= ");
+        direct_append_list_len_ref(dst, name, is_ref);
+        sb_append(dst, ") __vais_list_trap(0);\n");
+        sb_append(dst, ctype);
+        sb_append(dst, " ");
+        sb_append(dst, tmp_name);
+        sb_append(dst, " = ");
+        direct_append_list_data_ref(dst, name, is_ref);
+        sb_append(dst, "[");
+        sb_append(dst, idx_name);
+        sb_append(dst, "];\n");
+        sb_append(dst, "for (long ");
+        sb_append(dst, loop_name);
+        sb_append(dst, " = ");
+        sb_append(dst, idx_name);
+        sb_append(dst, "; ");
+        sb_append(dst, loop_name);
+        sb_append(dst, " < ");
+        direct_append_list_len_ref(dst, name, is_ref);
+        sb_append(dst, " - 1; ");
+        sb_append(dst, loop_name);
+        sb_append(dst, "++) ");
+        direct_append_list_data_ref(dst, name, is_ref);
+        sb_append(dst, "[");
+        sb_append(dst, loop_name);
+        sb_append(dst, "] = ");
+        direct_append_list_data_ref(dst, name, is_ref);
+        sb_append(dst, "[");
+        sb_append(dst, loop_name);
+        sb_append(dst, " + 1];\n");
+        direct_append_list_len_ref(dst, name, is_ref);
+        sb_append(dst, " -= 1;\n");
+        sb_append(out, tmp_name);
+    } else {
+        sb_append(out, "({ long ");
+        sb_append(out, idx_name);
+        sb_append(out, " = (long)(");
+        sb_append(out, index);
+        sb_append(out, "); if (");
+        sb_append(out, idx_name);
+        sb_append(out, " < 0 || ");
+        sb_append(out, idx_name);
+        sb_append(out, " >= ");
+        direct_append_list_len_ref(out, name, is_ref);
+        sb_append(out, ") __vais_list_trap(0); ");
+        sb_append(out, ctype);
+        sb_append(out, " ");
+        sb_append(out, tmp_name);
+        sb_append(out, " = ");
+        direct_append_list_data_ref(out, name, is_ref);
+        sb_append(out, "[");
+        sb_append(out, idx_name);
+        sb_append(out, "]; for (long ");
+        sb_append(out, loop_name);
+        sb_append(out, " = ");
+        sb_append(out, idx_name);
+        sb_append(out, "; ");
+        sb_append(out, loop_name);
+        sb_append(out, " < ");
+        direct_append_list_len_ref(out, name, is_ref);
+        sb_append(out, " - 1; ");
+        sb_append(out, loop_name);
+        sb_append(out, "++) ");
+        direct_append_list_data_ref(out, name, is_ref);
+        sb_append(out, "[");
+        sb_append(out, loop_name);
+        sb_append(out, "] = ");
+        direct_append_list_data_ref(out, name, is_ref);
+        sb_append(out, "[");
+        sb_append(out, loop_name);
+        sb_append(out, " + 1]; ");
+        direct_append_list_len_ref(out, name, is_ref);
+        sb_append(out, " -= 1; ");
+        sb_append(out, tmp_name);
+        sb_append(out, "; })");
+    }
+    free(elem_type);
+}
+
+static void direct_append_list_insert_at_ref(StrBuf *out, const char *name, int is_ref, const char *base_type, const char *index, const char *value, DirectNameSet *locals) {
+    if (direct_is_list_int_type(base_type) || direct_is_list_str_type(base_type)) {
+        sb_append(out, direct_is_list_str_type(base_type) ? "__vais_list_str_insert_at(" : "__vais_list_int_insert_at(");
+        if (!is_ref) sb_append(out, "&");
+        sb_append(out, name);
+        sb_append(out, ", ");
+        sb_append(out, index);
+        sb_append(out, ", ");
+        sb_append(out, value);
+        sb_append(out, ");\n");
+        return;
+    }
+    char *elem_type = direct_list_element_type(base_type);
+    const char *ctype = direct_c_type(elem_type == NULL ? "Int" : elem_type);
+    char idx_name[64];
+    char value_name[64];
+    char loop_name[64];
+    int n = locals->temp_count++;
+    snprintf(idx_name, sizeof(idx_name), "__vais_list_insert_idx_%d", n);
+    snprintf(value_name, sizeof(value_name), "__vais_list_insert_value_%d", n);
+    snprintf(loop_name, sizeof(loop_name), "__vais_list_insert_i_%d", n);
+    sb_append(out, "{ long ");
+    sb_append(out, idx_name);
+    sb_append(out, " = (long)(");
+    sb_append(out, index);
+    sb_append(out, "); if (");
+    sb_append(out, idx_name);
+    sb_append(out, " < 0 || ");
+    sb_append(out, idx_name);
+    sb_append(out, " > ");
+    direct_append_list_len_ref(out, name, is_ref);
+    sb_append(out, ") __vais_list_trap(1); ");
+    direct_append_list_push_reserve_ref(out, name, is_ref);
+    sb_append(out, " ");
+    sb_append(out, ctype);
+    sb_append(out, " ");
+    sb_append(out, value_name);
+    sb_append(out, " = ");
+    sb_append(out, value);
+    sb_append(out, "; for (long ");
+    sb_append(out, loop_name);
+    sb_append(out, " = ");
+    direct_append_list_len_ref(out, name, is_ref);
+    sb_append(out, "; ");
+    sb_append(out, loop_name);
+    sb_append(out, " > ");
+    sb_append(out, idx_name);
+    sb_append(out, "; ");
+    sb_append(out, loop_name);
+    sb_append(out, "--) ");
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, "[");
+    sb_append(out, loop_name);
+    sb_append(out, "] = ");
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, "[");
+    sb_append(out, loop_name);
+    sb_append(out, " - 1]; ");
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, "[");
+    sb_append(out, idx_name);
+    sb_append(out, "] = ");
+    sb_append(out, value_name);
+    sb_append(out, "; ");
+    direct_append_list_len_ref(out, name, is_ref);
+    sb_append(out, " += 1; }\n");
+    free(elem_type);
+}
+
+static void direct_append_list_extend_ref(StrBuf *out, const char *dst, int dst_is_ref, const char *src, int src_is_ref, const char *base_type, DirectNameSet *locals) {
+    if (direct_is_list_int_type(base_type) || direct_is_list_str_type(base_type)) {
+        sb_append(out, direct_is_list_str_type(base_type) ? "__vais_list_str_extend(" : "__vais_list_int_extend(");
+        if (!dst_is_ref) sb_append(out, "&");
+        sb_append(out, dst);
+        sb_append(out, ", ");
+        if (!src_is_ref) sb_append(out, "&");
+        sb_append(out, src);
+        sb_append(out, ");\n");
+        return;
+    }
+    char base_name[64];
+    char count_name[64];
+    char loop_name[64];
+    int n = locals->temp_count++;
+    snprintf(base_name, sizeof(base_name), "__vais_list_extend_base_%d", n);
+    snprintf(count_name, sizeof(count_name), "__vais_list_extend_n_%d", n);
+    snprintf(loop_name, sizeof(loop_name), "__vais_list_extend_i_%d", n);
+    sb_append(out, "{ long ");
+    sb_append(out, base_name);
+    sb_append(out, " = ");
+    direct_append_list_len_ref(out, dst, dst_is_ref);
+    sb_append(out, "; long ");
+    sb_append(out, count_name);
+    sb_append(out, " = ");
+    direct_append_list_len_ref(out, src, src_is_ref);
+    sb_append(out, "; ");
+    StrBuf need;
+    sb_init(&need);
+    sb_append(&need, base_name);
+    sb_append(&need, " + ");
+    sb_append(&need, count_name);
+    direct_append_list_reserve_ref(out, dst, dst_is_ref, need.data);
+    free(need.data);
+    sb_append(out, " for (long ");
+    sb_append(out, loop_name);
+    sb_append(out, " = 0; ");
+    sb_append(out, loop_name);
+    sb_append(out, " < ");
+    sb_append(out, count_name);
+    sb_append(out, "; ");
+    sb_append(out, loop_name);
+    sb_append(out, "++) ");
+    direct_append_list_data_ref(out, dst, dst_is_ref);
+    sb_append(out, "[");
+    sb_append(out, base_name);
+    sb_append(out, " + ");
+    sb_append(out, loop_name);
+    sb_append(out, "] = ");
+    direct_append_list_data_ref(out, src, src_is_ref);
+    sb_append(out, "[");
+    sb_append(out, loop_name);
+    sb_append(out, "]; ");
+    direct_append_list_len_ref(out, dst, dst_is_ref);
+    sb_append(out, " = ");
+    sb_append(out, base_name);
+    sb_append(out, " + ");
+    sb_append(out, count_name);
+    sb_append(out, "; }\n");
+}
+
+static void direct_append_list_is_empty_ref(StrBuf *out, const char *name, int is_ref) {
+    sb_append(out, "(");
+    direct_append_list_len_ref(out, name, is_ref);
+    sb_append(out, " == 0 ? 1 : 0)");
+}
+
+static void direct_append_list_last_ref(StrBuf *out, const char *name, int is_ref) {
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, "[__vais_list_checked_last(");
+    direct_append_list_len_ref(out, name, is_ref);
+    sb_append(out, ")]");
+}
+
+static void direct_append_list_first_ref(StrBuf *out, const char *name, int is_ref) {
+    direct_append_list_data_ref(out, name, is_ref);
+    sb_append(out, "[__vais_list_checked_index(0, ");
+    direct_append_list_len_ref(out, name, is_ref);
+    sb_append(out, ")]");
+}
+
+static void direct_append_list_pop_ref(StrBuf *out, const char *name, int is_ref, const char *base_type, DirectNameSet *locals) {
+    if (direct_current_prelude == NULL) {
+        direct_append_list_data_ref(out, name, is_ref);
+        sb_append(out, "[__vais_list_checked_pop_index(&");
+        direct_append_list_len_ref(out, name, is_ref);
+        sb_append(out, ")]");
+        return;
+    }
+    char *elem_type = direct_list_element_type(base_type);
+    char tmp_name[64];
+    snprintf(tmp_name, sizeof(tmp_name), "__vais_list_pop_%d", locals->temp_count++);
+    sb_append(direct_current_prelude, direct_c_type(elem_type == NULL ? "Int" : elem_type));
+    sb_append(direct_current_prelude, " ");
+    sb_append(direct_current_prelude, tmp_name);
+    sb_append(direct_current_prelude, " = ");
+    direct_append_list_data_ref(direct_current_prelude, name, is_ref);
+    sb_append(direct_current_prelude, "[__vais_list_checked_last(");
+    direct_append_list_len_ref(direct_current_prelude, name, is_ref);
+    sb_append(direct_current_prelude, ")];\n");
+    direct_append_list_len_ref(direct_current_prelude, name, is_ref);
+    sb_append(direct_current_prelude, " -= 1;\n");
+    sb_append(out, tmp_name);
+    free(elem_type);
+}
+
+static char *direct_rewrite_nested_struct_field_chains(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    StrBuf out;
+    sb_init(&out);
+    for (int i = 0; expr[i] != '\0';) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an unterminated string literal",
+                    "close the string before the end of the line.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an invalid char literal",
+                    "write a single-byte character literal such as `'A'`.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (!is_ident_start(expr[i])) {
+            sb_append_n(&out, expr + i, 1);
+            i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(expr[i])) i++;
+        char *name = substr_copy(expr + start, (size_t)(i - start));
+        const char *rest = skip_ws(expr + i);
+        if (*rest == '(') {
+            int close = find_matching_paren_c(expr, (int)(rest - expr));
+            DirectFnInfo *fn = close < 0 ? NULL : direct_find_fn(fns, fn_count, name);
+            DirectStructInfo *call_st = fn == NULL ? NULL : direct_find_struct(structs, struct_count, fn->return_type);
+            const char *after_call = close < 0 ? rest : skip_ws(expr + close + 1);
+            if (call_st != NULL && *after_call == '.') {
+                int field_start = (int)(after_call - expr) + 1;
+                while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+                int field_end = field_start;
+                while (is_ident_continue(expr[field_end])) field_end++;
+                char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+                const char *after_field = skip_ws(expr + field_end);
+                if (*after_field == '.') {
+                    const char *field_type = direct_struct_field_type(call_st, field);
+                    DirectStructInfo *nested = field_type == NULL ? NULL : direct_find_struct(structs, struct_count, field_type);
+                    int nested_start = (int)(after_field - expr) + 1;
+                    while (expr[nested_start] == ' ' || expr[nested_start] == '\t') nested_start++;
+                    int nested_end = nested_start;
+                    while (is_ident_continue(expr[nested_end])) nested_end++;
+                    char *nested_field = substr_copy(expr + nested_start, (size_t)(nested_end - nested_start));
+                    if (nested == NULL || !direct_struct_has_field(nested, nested_field)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter found an unknown nested struct return field access",
+                            "read a field declared on this nested struct.",
+                            NULL);
+                        free(nested_field);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                    sb_append_n(&out, expr + start, (size_t)(nested_end - start));
+                    i = nested_end;
+                    free(nested_field);
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                free(field);
+            }
+        }
+        const char *base_type = direct_names_type(locals, name);
+        DirectStructInfo *st = base_type == NULL ? NULL : direct_find_struct(structs, struct_count, base_type);
+        if (st == NULL || *rest != '.') {
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(name);
+            continue;
+        }
+        int field_start = (int)(rest - expr) + 1;
+        while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+        int field_end = field_start;
+        while (is_ident_continue(expr[field_end])) field_end++;
+        char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+        const char *after_field = skip_ws(expr + field_end);
+        if (*after_field != '.') {
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(field);
+            free(name);
+            continue;
+        }
+        const char *field_type = direct_struct_field_type(st, field);
+        DirectStructInfo *nested = field_type == NULL ? NULL : direct_find_struct(structs, struct_count, field_type);
+        int nested_start = (int)(after_field - expr) + 1;
+        while (expr[nested_start] == ' ' || expr[nested_start] == '\t') nested_start++;
+        int nested_end = nested_start;
+        while (is_ident_continue(expr[nested_end])) nested_end++;
+        char *nested_field = substr_copy(expr + nested_start, (size_t)(nested_end - nested_start));
+        if (nested == NULL || !direct_struct_has_field(nested, nested_field)) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter found an unknown nested struct field access",
+                "read a field declared on this nested struct.",
+                NULL);
+            free(nested_field);
+            free(field);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        sb_append_n(&out, expr + start, (size_t)(nested_end - start));
+        i = nested_end;
+        free(nested_field);
+        free(field);
+        free(name);
+    }
+    return sb_take(&out);
+}
+
+static int direct_is_parse_builtin_name(const char *name) {
+    return strcmp(name, "parse_uint") == 0 || strcmp(name, "parse_int") == 0;
+}
+
+static int direct_is_str_cmp_builtin_name(const char *name) {
+    return strcmp(name, "str_cmp") == 0;
+}
+
+static int direct_is_str_contains_builtin_name(const char *name) {
+    return strcmp(name, "str_contains") == 0;
+}
+
+static int direct_is_str_index_of_builtin_name(const char *name) {
+    return strcmp(name, "str_index_of") == 0;
+}
+
+static int direct_is_str_starts_with_builtin_name(const char *name) {
+    return strcmp(name, "str_starts_with") == 0;
+}
+
+static int direct_is_str_ends_with_builtin_name(const char *name) {
+    return strcmp(name, "str_ends_with") == 0;
+}
+
+static int direct_is_str_slice_builtin_name(const char *name) {
+    return strcmp(name, "str_slice") == 0;
+}
+
+static int direct_is_str_concat_builtin_name(const char *name) {
+    return strcmp(name, "str_concat") == 0;
+}
+
+static int direct_is_str_join_builtin_name(const char *name) {
+    return strcmp(name, "str_join") == 0;
+}
+
+static int direct_is_str_replace_builtin_name(const char *name) {
+    return strcmp(name, "str_replace") == 0;
+}
+
+static int direct_is_str_trim_builtin_name(const char *name) {
+    return strcmp(name, "str_trim") == 0;
+}
+
+static int direct_is_str_lower_builtin_name(const char *name) {
+    return strcmp(name, "str_lower") == 0;
+}
+
+static int direct_is_str_upper_builtin_name(const char *name) {
+    return strcmp(name, "str_upper") == 0;
+}
+
+static int direct_is_str_split_ws_into_builtin_name(const char *name) {
+    return strcmp(name, "str_split_ws_into") == 0;
+}
+
+static int direct_is_str_split_lines_into_builtin_name(const char *name) {
+    return strcmp(name, "str_split_lines_into") == 0;
+}
+
+static int direct_is_fs_list_files_builtin_name(const char *name) {
+    return strcmp(name, "fs_list_files") == 0;
+}
+
+static int direct_is_fs_list_dirs_builtin_name(const char *name) {
+    return strcmp(name, "fs_list_dirs") == 0;
+}
+
+static int direct_is_fs_mkdirs_builtin_name(const char *name) {
+    return strcmp(name, "fs_mkdirs") == 0;
+}
+
+static int direct_is_str_split_into_builtin_name(const char *name) {
+    return strcmp(name, "str_split_into") == 0;
+}
+
+static int direct_is_map_str_str_snapshot_builtin_name(const char *name) {
+    return strcmp(name, "map_str_str_snapshot") == 0;
+}
+
+static int direct_is_map_str_str_load_snapshot_builtin_name(const char *name) {
+    return strcmp(name, "map_str_str_load_snapshot") == 0;
+}
+
+static int direct_is_doc_term_counts_into_builtin_name(const char *name) {
+    return strcmp(name, "doc_term_counts_into") == 0;
+}
+
+static int direct_is_doc_term_overlap_score_builtin_name(const char *name) {
+    return strcmp(name, "doc_term_overlap_score") == 0;
+}
+
+static int direct_is_doc_term_weighted_score_builtin_name(const char *name) {
+    return strcmp(name, "doc_term_weighted_score") == 0;
+}
+
+static int direct_is_str_conversion_builtin_name(const char *name) {
+    return strcmp(name, "Str") == 0;
+}
+
+static int direct_is_str_byte_builtin_name(const char *name) {
+    return strcmp(name, "str_byte") == 0;
+}
+
+static int direct_is_fs_read_text_builtin_name(const char *name) {
+    return strcmp(name, "fs_read_text") == 0;
+}
+
+static int direct_is_fs_write_text_builtin_name(const char *name) {
+    return strcmp(name, "fs_write_text") == 0;
+}
+
+static int direct_is_fs_is_dir_builtin_name(const char *name) {
+    return strcmp(name, "fs_is_dir") == 0;
+}
+
+static int direct_is_fs_exists_builtin_name(const char *name) {
+    return strcmp(name, "fs_exists") == 0;
+}
+
+static int direct_is_fs_temp_dir_builtin_name(const char *name) {
+    return strcmp(name, "fs_temp_dir") == 0;
+}
+
+static int direct_is_stderr_write_builtin_name(const char *name) {
+    return strcmp(name, "stderr_write") == 0;
+}
+
+static int direct_is_stdout_write_builtin_name(const char *name) {
+    return strcmp(name, "stdout_write") == 0;
+}
+
+static int direct_is_proc_self_builtin_name(const char *name) {
+    return strcmp(name, "proc_self") == 0;
+}
+
+static int direct_is_stdin_read_all_builtin_name(const char *name) {
+    return strcmp(name, "stdin_read_all") == 0;
+}
+
+static int direct_is_fs_cwd_builtin_name(const char *name) {
+    return strcmp(name, "fs_cwd") == 0;
+}
+
+static int direct_is_path_join_builtin_name(const char *name) {
+    return strcmp(name, "path_join") == 0;
+}
+
+static int direct_is_path_basename_builtin_name(const char *name) {
+    return strcmp(name, "path_basename") == 0;
+}
+
+static int direct_is_path_dirname_builtin_name(const char *name) {
+    return strcmp(name, "path_dirname") == 0;
+}
+
+static int direct_is_str_builder_new_builtin_name(const char *name) {
+    return strcmp(name, "str_builder_new") == 0;
+}
+
+static int direct_is_str_builder_push_builtin_name(const char *name) {
+    return strcmp(name, "str_builder_push") == 0;
+}
+
+static int direct_is_str_builder_append_builtin_name(const char *name) {
+    return strcmp(name, "str_builder_append") == 0;
+}
+
+static int direct_is_str_builder_finish_builtin_name(const char *name) {
+    return strcmp(name, "str_builder_finish") == 0;
+}
+
+static int direct_is_time_millis_builtin_name(const char *name) {
+    return strcmp(name, "time_millis") == 0;
+}
+
+static int direct_is_time_nanos_builtin_name(const char *name) {
+    return strcmp(name, "time_nanos") == 0;
+}
+
+static int direct_is_index_builtin_name(const char *name) {
+    return strcmp(name, "index_new") == 0 || strcmp(name, "index_add_doc") == 0 ||
+        strcmp(name, "index_add_term") == 0 || strcmp(name, "index_remove_doc") == 0 ||
+        strcmp(name, "index_doc_count") == 0 || strcmp(name, "index_top_k") == 0 ||
+        strcmp(name, "index_hit_doc") == 0 || strcmp(name, "index_hit_score") == 0;
+}
+
+/* Arity of an index_* builtin, and whether argument a is its Str text. */
+static int direct_index_builtin_argc(const char *name) {
+    if (strcmp(name, "index_new") == 0) return 0;
+    if (strcmp(name, "index_doc_count") == 0) return 1;
+    if (strcmp(name, "index_add_doc") == 0 || strcmp(name, "index_top_k") == 0) return 3;
+    if (strcmp(name, "index_add_term") == 0) return 4;
+    return 2;
+}
+
+static int direct_index_builtin_str_arg(const char *name, int a) {
+    if (strcmp(name, "index_top_k") == 0) return a == 1;
+    if (strcmp(name, "index_add_doc") == 0 || strcmp(name, "index_add_term") == 0) return a == 2;
+    return 0;
+}
+
+static int direct_is_snap_builtin_name(const char *name) {
+    static const char *names[] = {
+        "snap_open", "snap_close", "snap_get", "snap_has", "snap_put", "snap_remove",
+        "snap_len", "snap_log_len", "snap_version", "snap_set_version",
+        "snap_key_at", "snap_value_at", "snap_compact", NULL,
+    };
+    for (int i = 0; names[i] != NULL; i++) {
+        if (strcmp(name, names[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Arity of a snap_* builtin, whether argument a is Str, and its result type. */
+static int direct_snap_builtin_argc(const char *name) {
+    if (strcmp(name, "snap_get") == 0 || strcmp(name, "snap_put") == 0) return 3;
+    if (strcmp(name, "snap_has") == 0 || strcmp(name, "snap_remove") == 0 || strcmp(name, "snap_set_version") == 0 ||
+        strcmp(name, "snap_key_at") == 0 || strcmp(name, "snap_value_at") == 0) return 2;
+    return 1;
+}
+
+static int direct_snap_builtin_str_arg(const char *name, int a) {
+    if (strcmp(name, "snap_open") == 0) return 1;
+    if (strcmp(name, "snap_get") == 0 || strcmp(name, "snap_put") == 0 || strcmp(name, "snap_has") == 0 ||
+        strcmp(name, "snap_remove") == 0) return a > 0;
+    return 0;
+}
+
+static int direct_snap_builtin_returns_str(const char *name) {
+    return strcmp(name, "snap_get") == 0 || strcmp(name, "snap_key_at") == 0 || strcmp(name, "snap_value_at") == 0;
+}
+
+/* Runtime entry points that `par` pipeline lowering emits; every argument
+   and result is Int. */
+static int direct_is_par_builtin_name(const char *name) {
+    return strcmp(name, "vais_par_begin") == 0 || strcmp(name, "vais_par_next") == 0 ||
+        strcmp(name, "vais_par_wait") == 0 || strcmp(name, "vais_par_reduce") == 0;
+}
+
+static int direct_par_builtin_argc(const char *name) {
+    if (strcmp(name, "vais_par_next") == 0) return 4;
+    if (strcmp(name, "vais_par_wait") == 0) return 1;
+    return 2;
+}
+
+static int direct_is_fs_remove_builtin_name(const char *name) {
+    return strcmp(name, "fs_remove") == 0;
+}
+
+static int direct_is_fs_stream_builtin_name(const char *name) {
+    return strcmp(name, "fs_map_text") == 0 || strcmp(name, "fs_lines_open") == 0 ||
+        strcmp(name, "fs_lines_next") == 0 || strcmp(name, "fs_lines_text") == 0 ||
+        strcmp(name, "fs_lines_close") == 0;
+}
+
+/* fs_map_text and fs_lines_open take a Str path; the other line-reader calls
+   take the reader handle. */
+static int direct_fs_stream_builtin_str_arg(const char *name) {
+    return strcmp(name, "fs_map_text") == 0 || strcmp(name, "fs_lines_open") == 0;
+}
+
+static int direct_fs_stream_builtin_returns_str(const char *name) {
+    return strcmp(name, "fs_map_text") == 0 || strcmp(name, "fs_lines_text") == 0;
+}
+
+static int direct_is_str_arena_builtin_name(const char *name) {
+    return strcmp(name, "arena_begin") == 0 || strcmp(name, "arena_reset") == 0 ||
+        strcmp(name, "arena_end") == 0 || strcmp(name, "arena_keep") == 0 ||
+        strcmp(name, "alloc_count") == 0 || strcmp(name, "alloc_bytes") == 0;
+}
+
+static int direct_is_arena_keep_builtin_name(const char *name) {
+    return strcmp(name, "arena_keep") == 0;
+}
+
+static int direct_is_proc_argc_builtin_name(const char *name) {
+    return strcmp(name, "proc_argc") == 0;
+}
+
+static int direct_is_proc_arg_builtin_name(const char *name) {
+    return strcmp(name, "proc_arg") == 0;
+}
+
+static int direct_is_proc_run_builtin_name(const char *name) {
+    return strcmp(name, "proc_run") == 0;
+}
+
+static int direct_is_proc_run_env_builtin_name(const char *name) {
+    return strcmp(name, "proc_run_env") == 0;
+}
+
+static int direct_is_proc_capture_builtin_name(const char *name) {
+    return strcmp(name, "proc_capture") == 0;
+}
+
+static int direct_is_proc_spawn_builtin_name(const char *name) {
+    return strcmp(name, "proc_spawn") == 0;
+}
+
+static int direct_is_proc_spawn_to_builtin_name(const char *name) {
+    return strcmp(name, "proc_spawn_to") == 0;
+}
+
+/* proc_wait(handle) and proc_wait_any() take and return Int handles. */
+static int direct_is_proc_wait_builtin_name(const char *name) {
+    return strcmp(name, "proc_wait") == 0 || strcmp(name, "proc_wait_any") == 0;
+}
+
+static int direct_is_some_constructor_name(const char *name) {
+    return strcmp(name, "Some") == 0;
+}
+
+static int direct_is_ok_constructor_name(const char *name) {
+    return strcmp(name, "Ok") == 0;
+}
+
+static int direct_is_err_constructor_name(const char *name) {
+    return strcmp(name, "Err") == 0;
+}
+
+static int direct_is_option_result_payload_constructor_name(const char *name) {
+    return direct_is_some_constructor_name(name) || direct_is_ok_constructor_name(name) || direct_is_err_constructor_name(name);
+}
+
+static int direct_is_none_constructor_expr(const char *expr) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    int ok = starts_with(s, "None") && !is_ident_continue(s[4]) && *skip_ws(s + 4) == '\0';
+    free(trimmed);
+    return ok;
+}
+
+static int direct_expr_is_string_literal(const char *expr) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    int ok = 0;
+    if (is_string_delim_c(*s)) {
+        int end = skip_string_literal_c(s, 0);
+        ok = end >= 0 && *skip_ws(s + end) == '\0';
+    }
+    free(trimmed);
+    return ok;
+}
+
+static int direct_expr_is_char_literal(const char *expr) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    int ok = 0;
+    if (*s == '\'') {
+        int end = skip_char_literal_c(s, 0);
+        ok = end >= 0 && *skip_ws(s + end) == '\0';
+    }
+    free(trimmed);
+    return ok;
+}
+
+static char *direct_rewrite_string_literals(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr
+) {
+    StrBuf out;
+    sb_init(&out);
+    for (int i = 0; expr[i] != '\0';) {
+        if (!is_string_delim_c(expr[i])) {
+            sb_append_n(&out, expr + i, 1);
+            i++;
+            continue;
+        }
+        char delim = expr[i];
+        int end = skip_string_literal_c(expr, i);
+        if (end < 0) {
+            report_issue(path, line_no, 1, line,
+                "direct native emitter found an unterminated string literal",
+                "close the string before the end of the line.",
+                NULL);
+            free(out.data);
+            return NULL;
+        }
+        sb_append(&out, "\"");
+        int j = i + 1;
+        while (j < end - 1) {
+            if (delim == '"' && expr[j] == '\\' && j + 1 < end - 1) {
+                j++;
+                sb_append_c_escaped_byte(&out, expr[j]);
+                j++;
+                continue;
+            }
+            sb_append_c_escaped_byte(&out, expr[j]);
+            j++;
+        }
+        sb_append(&out, "\"");
+        i = end;
+    }
+    return sb_take(&out);
+}
+
+static int direct_concat_leaf_call(const char *expr, DirectFnInfo *fns, int fn_count, char **parts) {
+    const char *s = skip_ws(expr);
+    if (!is_ident_start(*s)) return 0;
+    int n = 1;
+    while (is_ident_continue(s[n])) n++;
+    char *name = substr_copy(s, (size_t)n);
+    int kind = direct_find_fn(fns, fn_count, name) != NULL ? 0
+        : (direct_is_str_concat_builtin_name(name) ? 3
+        : (direct_is_str_conversion_builtin_name(name) ? 1
+        : (direct_is_str_byte_builtin_name(name) ? 2 : 0)));
+    free(name);
+    int open = n;
+    while (s[open] == ' ' || s[open] == '\t') open++;
+    if (kind == 0 || s[open] != '(') return 0;
+    int close = find_matching_paren_c(s, open);
+    if (close < 0 || *skip_ws(s + close + 1) != '\0') return 0;
+    char *inside = substr_copy(s + open + 1, (size_t)(close - open - 1));
+    char *args[16] = {0};
+    int argc = split_top_level_commas_c(inside, args, 16);
+    free(inside);
+    if (argc != (kind == 3 ? 2 : 1)) {
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 0;
+    }
+    parts[0] = args[0];
+    parts[1] = args[1];
+    return kind;
+}
+
+/* Appends the leaves of `expr` at `count`; never writes past `limit`. */
+static int direct_concat_collect_leaves(const char *expr, DirectFnInfo *fns, int fn_count, char **leaves, int *kinds, int count, int limit) {
+    char *parts[2] = {0};
+    int kind = count + 2 <= limit ? direct_concat_leaf_call(expr, fns, fn_count, parts) : 0;
+    if (kind == 3) {
+        count = direct_concat_collect_leaves(parts[0], fns, fn_count, leaves, kinds, count, limit - 1);
+        count = direct_concat_collect_leaves(parts[1], fns, fn_count, leaves, kinds, count, limit);
+        free(parts[0]);
+        free(parts[1]);
+        return count;
+    }
+    leaves[count] = kind == 0 ? trim_copy(expr) : parts[0];
+    kinds[count] = kind;
+    return count + 1;
+}
+
+/* The C operand for one leaf: a Str expression, or an Int tagged as a pointer. */
+static char *direct_rewrite_concat_leaf(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *leaf,
+    int kind,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    char *rewritten = direct_rewrite_expr(path, line_no, line, leaf, locals, fns, fn_count, structs, struct_count);
+    if (rewritten == NULL || kind == 0) return rewritten;
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, "(const char *)(intptr_t)(");
+    sb_append(&out, rewritten);
+    sb_append(&out, ")");
+    free(rewritten);
+    return sb_take(&out);
+}
+
+static char *direct_rewrite_concat_tree(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *left,
+    const char *right,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    char *leaves[DIRECT_CONCAT_MAX_LEAVES] = {0};
+    int kinds[DIRECT_CONCAT_MAX_LEAVES] = {0};
+    int n = direct_concat_collect_leaves(left, fns, fn_count, leaves, kinds, 0, DIRECT_CONCAT_MAX_LEAVES - 1);
+    n = direct_concat_collect_leaves(right, fns, fn_count, leaves, kinds, n, DIRECT_CONCAT_MAX_LEAVES);
+    char *acc = NULL;
+    int k = 0;
+    while (k < n) {
+        StrBuf args;
+        sb_init(&args);
+        int np = 0;
+        long tags = 0;
+        if (acc != NULL) {
+            sb_append(&args, ", ");
+            sb_append(&args, acc);
+            free(acc);
+            acc = NULL;
+            np = 1;
+        }
+        for (; np < 8 && k < n; np++, k++) {
+            char *part = direct_rewrite_concat_leaf(path, line_no, line, leaves[k], kinds[k], locals, fns, fn_count, structs, struct_count);
+            if (part == NULL) {
+                free(args.data);
+                for (int j = 0; j < n; j++) free(leaves[j]);
+                return NULL;
+            }
+            tags |= (long)kinds[k] << (2 * np);
+            sb_append(&args, ", ");
+            sb_append(&args, part);
+            free(part);
+        }
+        for (int pad = np; pad < 8; pad++) sb_append(&args, ", NULL");
+        char head[64];
+        snprintf(head, sizeof(head), "__vais_str_concat8(%ld, %d", tags, np);
+        StrBuf call;
+        sb_init(&call);
+        sb_append(&call, head);
+        sb_append(&call, args.data);
+        sb_append(&call, ")");
+        free(args.data);
+        acc = sb_take(&call);
+    }
+    for (int j = 0; j < n; j++) free(leaves[j]);
+    return acc;
+}
+
+/*
+ * Inside a multi-line while loop, `X = str_concat(X, rest)` appends to a
+ * growable buffer instead of copying X on every pass. The loop qualifies when
+ * X is a Str local and every mention of X in its condition and body is such a
+ * statement outside nested loops. The buffer starts from X before the loop and
+ * is copied back into X once the loop's closing brace is lowered.
+ */
+static int direct_concat_acc_stmt_at(const char *text, int pos, const char *name, int *after) {
+    int k = pos - 1;
+    while (k >= 0 && (text[k] == ' ' || text[k] == '\t')) k--;
+    if (k >= 0 && text[k] != '{' && text[k] != ';') return 0;
+    size_t n = strlen(name);
+    const char *p = skip_ws(text + pos + n);
+    if (p[0] != '=' || p[1] == '=') return 0;
+    p = skip_ws(p + 1);
+    if (!starts_with(p, "str_concat") || is_ident_continue(p[10])) return 0;
+    const char *open = skip_ws(p + 10);
+    if (*open != '(') return 0;
+    const char *arg = skip_ws(open + 1);
+    if (strncmp(arg, name, n) != 0 || is_ident_continue(arg[n]) || *skip_ws(arg + n) != ',') return 0;
+    int close = find_matching_paren_c(text, (int)(open - text));
+    if (close < 0) return 0;
+    const char *tail = skip_ws(text + close + 1);
+    if (*tail == ';') tail = skip_ws(tail + 1);
+    if (*tail != '\0' && *tail != '}') return 0;
+    *after = (int)(arg + n - text);
+    return 1;
+}
+
+/* Mentions of `name` in `text`; `*covered` counts the accumulating statements. */
+static int direct_concat_acc_mentions(const char *text, const char *name, int *covered) {
+    size_t n = strlen(name);
+    int mentions = 0;
+    int depth = 0;
+    *covered = 0;
+    for (int i = 0; text[i] != '\0';) {
+        if (is_string_delim_c(text[i]) || text[i] == '\'') {
+            int end = text[i] == '\'' ? skip_char_literal_c(text, i) : skip_string_literal_c(text, i);
+            if (end < 0) break;
+            i = end;
+            continue;
+        }
+        if (text[i] == '(' || text[i] == '[') depth++;
+        else if (text[i] == ')' || text[i] == ']') depth--;
+        if (!is_ident_start(text[i])) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while (is_ident_continue(text[i])) i++;
+        if ((size_t)(i - start) != n || strncmp(text + start, name, n) != 0) continue;
+        mentions++;
+        int after = 0;
+        if (depth == 0 && direct_concat_acc_stmt_at(text, start, name, &after)) {
+            (*covered)++;
+            i = after;
+            depth = 1;
+        }
+    }
+    return mentions;
+}
+
+/* Whether the Str local `name` can accumulate in the loop body lines [first, last). */
+static int direct_concat_acc_loop_ok(const LineVec *lines, size_t head, size_t last, const char *name) {
+    int covered = 0;
+    char *head_text = strip_line_comment(lines->items[head], strlen(lines->items[head]));
+    int head_mentions = direct_concat_acc_mentions(head_text, name, &covered);
+    free(head_text);
+    if (head_mentions > 0) return 0;
+    int found = 0;
+    int depth = 1;
+    int nested_at = 0;
+    for (size_t k = head + 1; k < last; k++) {
+        char *text = strip_line_comment(lines->items[k], strlen(lines->items[k]));
+        const char *t = skip_ws(text);
+        int in_nested = nested_at > 0;
+        int delta = direct_source_brace_delta(t);
+        if (!in_nested && ((starts_with(t, "while ") && !is_ident_continue(t[5])) || (starts_with(t, "for ") && !is_ident_continue(t[3])))) {
+            in_nested = 1;
+            if (delta > 0) nested_at = depth;
+        }
+        int mentions = direct_concat_acc_mentions(t, name, &covered);
+        free(text);
+        if (mentions > 0 && (in_nested || mentions != covered)) return 0;
+        found += covered;
+        depth += delta;
+        if (nested_at > 0 && depth <= nested_at) nested_at = 0;
+    }
+    return found > 0;
+}
+
+/* Opens accumulators for the multi-line while loop at lines[head]. */
+static void direct_concat_acc_open(const LineVec *lines, size_t head, int depth, DirectNameSet *locals, StrBuf *out) {
+    char *head_text = strip_line_comment(lines->items[head], strlen(lines->items[head]));
+    const char *s = skip_ws(head_text);
+    int opens = starts_with(s, "while ") && direct_source_brace_delta(s) == 1;
+    free(head_text);
+    if (!opens) return;
+    size_t last = head + 1;
+    int body_depth = 1;
+    int has_concat = 0;
+    for (; last < lines->len; last++) {
+        if (strstr(lines->items[last], "str_concat") != NULL) has_concat = 1;
+        char *text = strip_line_comment(lines->items[last], strlen(lines->items[last]));
+        body_depth += direct_source_brace_delta(text);
+        free(text);
+        if (body_depth <= 0) break;
+    }
+    if (!has_concat || last >= lines->len) return;
+    for (int i = 0; i < locals->count; i++) {
+        DirectLocalInfo *info = locals->items[i];
+        if (info->concat_acc > 0 || info->is_ref || strcmp(info->type, "Str") != 0) continue;
+        if (!direct_concat_acc_loop_ok(lines, head, last, info->name)) continue;
+        char acc[64];
+        int id = locals->temp_count++;
+        snprintf(acc, sizeof(acc), "__vais_str_acc_%d", id);
+        sb_append(out, "void *");
+        sb_append(out, acc);
+        sb_append(out, " = __vais_str_acc_new(");
+        sb_append(out, info->name);
+        sb_append(out, ");\n");
+        info->concat_acc = id + 1;
+        info->concat_acc_depth = depth;
+    }
+}
+
+/* Copies back the accumulators of loops that closed at or above `depth`. */
+static void direct_concat_acc_close(DirectNameSet *locals, int depth, StrBuf *out) {
+    for (int i = 0; i < locals->count; i++) {
+        DirectLocalInfo *info = locals->items[i];
+        if (info->concat_acc <= 0 || info->concat_acc_depth < depth) continue;
+        char line[256];
+        snprintf(line, sizeof(line), "%s = __vais_str_acc_finish(__vais_str_acc_%d);\n", info->name, info->concat_acc - 1);
+        sb_append(out, line);
+        info->concat_acc = 0;
+    }
+}
+
+/* Lowers `X = str_concat(X, rest)` for an accumulating X into pushes of rest's leaves. */
+static int direct_lower_concat_acc_push(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectLocalInfo *target,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    char *parts[2] = {0};
+    if (direct_concat_leaf_call(expr, fns, fn_count, parts) != 3) return 1;
+    char *leaves[DIRECT_CONCAT_MAX_LEAVES] = {0};
+    int kinds[DIRECT_CONCAT_MAX_LEAVES] = {0};
+    int n = direct_concat_collect_leaves(parts[1], fns, fn_count, leaves, kinds, 0, DIRECT_CONCAT_MAX_LEAVES);
+    free(parts[0]);
+    free(parts[1]);
+    StrBuf prelude;
+    StrBuf pushes;
+    sb_init(&prelude);
+    sb_init(&pushes);
+    int rc = 0;
+    direct_current_prelude = &prelude;
+    for (int k = 0; k < n && rc == 0; k++) {
+        char *part = direct_rewrite_concat_leaf(path, line_no, line, leaves[k], kinds[k], locals, fns, fn_count, structs, struct_count);
+        if (part == NULL) {
+            rc = 1;
+            break;
+        }
+        char *c_part = direct_translate_expr(part);
+        char head[96];
+        snprintf(head, sizeof(head), "__vais_str_acc_push(__vais_str_acc_%d, %d, ", target->concat_acc - 1, kinds[k]);
+        sb_append(&pushes, head);
+        sb_append(&pushes, c_part);
+        sb_append(&pushes, ");\n");
+        free(c_part);
+        free(part);
+    }
+    direct_current_prelude = NULL;
+    if (rc == 0) {
+        sb_append(out, prelude.data);
+        sb_append(out, pushes.data);
+    }
+    for (int k = 0; k < n; k++) free(leaves[k]);
+    free(prelude.data);
+    free(pushes.data);
+    return rc;
+}
+
+static char *direct_rewrite_parse_builtin_calls(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    StrBuf out;
+    sb_init(&out);
+    for (int i = 0; expr[i] != '\0';) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an unterminated string literal",
+                    "close the string before the end of the line.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an invalid char literal",
+                    "write a single-byte character literal such as `'A'`.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (!is_ident_start(expr[i])) {
+            sb_append_n(&out, expr + i, 1);
+            i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(expr[i])) i++;
+        char *name = substr_copy(expr + start, (size_t)(i - start));
+        int cursor = i;
+        while (expr[cursor] == ' ' || expr[cursor] == '\t') cursor++;
+        if (expr[cursor] == '(' && direct_find_fn(fns, fn_count, name) != NULL) {
+            /* Known helper-call group: the list rewriter already ran the full
+               pipeline over its arguments, so re-scanning would double-rewrite
+               list accesses inside them. */
+            int fn_close = find_matching_paren_c(expr, cursor);
+            if (fn_close >= 0) {
+                sb_append_n(&out, expr + start, (size_t)(fn_close + 1 - start));
+                free(name);
+                i = fn_close + 1;
+                continue;
+            }
+        }
+        int is_parse = direct_is_parse_builtin_name(name);
+        int is_contains = direct_is_str_contains_builtin_name(name);
+        int is_cmp = direct_is_str_cmp_builtin_name(name);
+        int is_index_of = direct_is_str_index_of_builtin_name(name);
+        int is_starts_with = direct_is_str_starts_with_builtin_name(name);
+        int is_ends_with = direct_is_str_ends_with_builtin_name(name);
+        int is_slice = direct_is_str_slice_builtin_name(name);
+        int is_concat = direct_is_str_concat_builtin_name(name);
+        int is_join = direct_is_str_join_builtin_name(name);
+        int is_replace = direct_is_str_replace_builtin_name(name);
+        int is_trim = direct_is_str_trim_builtin_name(name);
+        int is_lower = direct_is_str_lower_builtin_name(name);
+        int is_upper = direct_is_str_upper_builtin_name(name);
+        int is_byte = direct_is_str_byte_builtin_name(name);
+        int is_fs_read_text = direct_is_fs_read_text_builtin_name(name);
+        int is_fs_write_text = direct_is_fs_write_text_builtin_name(name);
+        int is_fs_exists = direct_is_fs_exists_builtin_name(name);
+        int is_fs_is_dir = direct_is_fs_is_dir_builtin_name(name);
+        int is_fs_temp_dir = direct_is_fs_temp_dir_builtin_name(name);
+        int is_fs_cwd = direct_is_fs_cwd_builtin_name(name);
+        int is_stdin_read = direct_is_stdin_read_all_builtin_name(name);
+        int is_proc_self = direct_is_proc_self_builtin_name(name);
+        int is_stdout_write = direct_is_stdout_write_builtin_name(name);
+        int is_stderr_write = direct_is_stderr_write_builtin_name(name);
+        int is_path_join = direct_is_path_join_builtin_name(name);
+        int is_path_basename = direct_is_path_basename_builtin_name(name);
+        int is_path_dirname = direct_is_path_dirname_builtin_name(name);
+        int is_time_millis = direct_is_time_millis_builtin_name(name);
+        int is_time_nanos = direct_is_time_nanos_builtin_name(name);
+        int is_sb_new = direct_is_str_builder_new_builtin_name(name);
+        int is_sb_push = direct_is_str_builder_push_builtin_name(name);
+        int is_sb_append = direct_is_str_builder_append_builtin_name(name);
+        int is_sb_finish = direct_is_str_builder_finish_builtin_name(name);
+        int is_proc_argc = direct_is_proc_argc_builtin_name(name);
+        int is_proc_arg = direct_is_proc_arg_builtin_name(name);
+        int is_split_ws_into = direct_is_str_split_ws_into_builtin_name(name);
+        int is_split_lines_into = direct_is_str_split_lines_into_builtin_name(name);
+        int is_fs_list_files = direct_is_fs_list_files_builtin_name(name);
+        int is_fs_list_dirs = direct_is_fs_list_dirs_builtin_name(name);
+        int is_fs_mkdirs = direct_is_fs_mkdirs_builtin_name(name);
+        int is_split_into = direct_is_str_split_into_builtin_name(name);
+        int is_map_snapshot = direct_is_map_str_str_snapshot_builtin_name(name);
+        int is_map_load = direct_is_map_str_str_load_snapshot_builtin_name(name);
+        int is_doc_counts = direct_is_doc_term_counts_into_builtin_name(name);
+        int is_doc_overlap = direct_is_doc_term_overlap_score_builtin_name(name);
+        int is_doc_weighted = direct_is_doc_term_weighted_score_builtin_name(name);
+        if ((!is_parse && !is_contains && !is_cmp && !is_index_of && !is_starts_with && !is_ends_with && !is_slice && !is_concat && !is_join && !is_replace && !is_trim && !is_lower && !is_upper && !is_byte && !is_fs_read_text && !is_fs_write_text && !is_fs_exists && !is_fs_is_dir && !is_fs_temp_dir && !is_fs_cwd && !is_stdin_read && !is_stdout_write && !is_stderr_write && !is_proc_self && !is_path_join && !is_path_basename && !is_path_dirname && !is_time_millis && !is_time_nanos && !is_sb_new && !is_sb_push && !is_sb_append && !is_sb_finish && !is_proc_argc && !is_proc_arg && !is_split_ws_into && !is_split_lines_into && !is_fs_list_files && !is_fs_list_dirs && !is_fs_mkdirs && !is_split_into && !is_map_snapshot && !is_map_load && !is_doc_counts && !is_doc_overlap && !is_doc_weighted) || expr[cursor] != '(') {
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(name);
+            continue;
+        }
+        int close = find_matching_paren_c(expr, cursor);
+        if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `)` to close the string helper call",
+                    "write `parse_uint(s)`, `parse_int(s)`, `fs_exists(path)`, `fs_read_text(path)`, `fs_write_text(path, text)`, `fs_mkdirs(path)`, `fs_cwd()`, `fs_temp_dir()`, `path_join(base, child)`, `path_basename(path)`, `path_dirname(path)`, `time_millis()`, `proc_argc()`, `proc_arg(index)`, `str_contains(text, needle)`, `str_index_of(text, needle)`, `str_starts_with(text, prefix)`, `str_ends_with(text, suffix)`, `str_slice(text, start, len)`, `str_concat(left, right)`, `str_join(parts, sep)`, `str_replace(text, needle, replacement)`, `str_trim(text)`, `str_lower(text)`, `str_upper(text)`, `str_byte(value)`, `str_split_ws_into(text, out)`, `str_split_lines_into(text, out)`, `str_split_into(text, sep, out)`, `fs_list_files(dir, out)`, `map_str_str_snapshot(docs)`, `map_str_str_load_snapshot(text, docs)`, `doc_term_counts_into(text, counts)`, `doc_term_overlap_score(query, doc)`, or `doc_term_weighted_score(query, doc)`.",
+                NULL);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+        char *args[16] = {0};
+        char *trimmed_inside = trim_copy(inside);
+        int argc = trimmed_inside[0] == '\0' ? 0 : split_top_level_commas_c(inside, args, 16);
+        free(trimmed_inside);
+        free(inside);
+        int want_argc = (is_fs_cwd || is_fs_temp_dir || is_stdin_read || is_proc_self || is_time_millis || is_time_nanos || is_sb_new || is_proc_argc) ? 0 : ((is_split_ws_into || is_split_lines_into || is_fs_list_files || is_fs_list_dirs || is_map_load || is_doc_counts || is_doc_overlap || is_doc_weighted || is_join || is_fs_write_text || is_path_join) ? 2 : ((is_replace || is_split_into) ? 3 : ((is_contains || is_cmp || is_index_of || is_starts_with || is_ends_with || is_concat || is_sb_push || is_sb_append) ? 2 : (is_slice ? 3 : 1))));
+        int bad_args = argc != want_argc || (want_argc > 0 && (args[0] == NULL || strlen(skip_ws(args[0])) == 0));
+        if (!bad_args && (is_sb_push || is_sb_append || is_contains || is_cmp || is_index_of || is_starts_with || is_ends_with || is_concat || is_join || is_fs_write_text || is_path_join || is_split_ws_into || is_split_lines_into || is_fs_list_files || is_fs_list_dirs || is_split_into || is_map_load || is_doc_counts || is_doc_overlap || is_doc_weighted)) {
+            bad_args = args[1] == NULL || strlen(skip_ws(args[1])) == 0;
+        }
+        if (!bad_args && (is_slice || is_replace || is_split_into)) {
+            bad_args = args[1] == NULL || args[2] == NULL ||
+                strlen(skip_ws(args[1])) == 0 || strlen(skip_ws(args[2])) == 0;
+        }
+        if (bad_args) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter string helper argument count does not match",
+                "write `parse_uint(s)`, `parse_int(s)`, `fs_exists(path)`, `fs_read_text(path)`, `fs_write_text(path, text)`, `fs_mkdirs(path)`, `fs_cwd()`, `fs_temp_dir()`, `path_join(base, child)`, `path_basename(path)`, `path_dirname(path)`, `time_millis()`, `proc_argc()`, `proc_arg(index)`, `str_contains(text, needle)`, `str_index_of(text, needle)`, `str_starts_with(text, prefix)`, `str_ends_with(text, suffix)`, `str_slice(text, start, len)`, `str_concat(left, right)`, `str_join(parts, sep)`, `str_replace(text, needle, replacement)`, `str_trim(text)`, `str_lower(text)`, `str_upper(text)`, `str_byte(value)`, `str_split_ws_into(text, out)`, `str_split_lines_into(text, out)`, `str_split_into(text, sep, out)`, `fs_list_files(dir, out)`, `map_str_str_snapshot(docs)`, `map_str_str_load_snapshot(text, docs)`, `doc_term_counts_into(text, counts)`, `doc_term_overlap_score(query, doc)`, or `doc_term_weighted_score(query, doc)`.",
+                NULL);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        if (is_fs_cwd || is_fs_temp_dir || is_stdin_read || is_proc_self || is_time_millis || is_time_nanos || is_sb_new || is_proc_argc) {
+            sb_append(&out, is_fs_cwd ? "fs_cwd()" : (is_fs_temp_dir ? "fs_temp_dir()" : (is_stdin_read ? "stdin_read_all()" : (is_proc_self ? "proc_self()" : (is_time_millis ? "time_millis()" : (is_time_nanos ? "time_nanos()" : (is_sb_new ? "str_builder_new()" : "proc_argc()")))))));
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (is_join) {
+            char *list_name = NULL;
+            if (!direct_expr_bare_list_local(locals, args[0], &list_name) ||
+                strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter str_join input must be a local List<Str>",
+                    "declare `let parts: List<Str> = []` and pass `parts` as the first argument.",
+                    NULL);
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *rewritten_sep = direct_rewrite_expr(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count);
+            if (rewritten_sep == NULL) {
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            StrBuf list_ref;
+            sb_init(&list_ref);
+            if (!direct_names_is_ref(locals, list_name)) sb_append(&list_ref, "&");
+            sb_append(&list_ref, list_name);
+            char *rewritten_list = sb_take(&list_ref);
+            sb_append(&out, "__vais_str_join(");
+            sb_append(&out, rewritten_list);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_sep);
+            sb_append(&out, ")");
+            free(list_name);
+            free(rewritten_sep);
+            free(rewritten_list);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (is_map_snapshot) {
+            char *map_name = NULL;
+            if (!direct_expr_bare_map_local(locals, args[0], &map_name) ||
+                strcmp(direct_names_type(locals, map_name), "Map<Str,Str>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter map_str_str_snapshot input must be a local Map<Str,Str>",
+                    "declare `let docs: Map<Str,Str> = {}` and pass `docs` as the argument.",
+                    NULL);
+                free(map_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            StrBuf map_ref;
+            sb_init(&map_ref);
+            direct_append_map_ptr_ref(&map_ref, map_name, direct_names_is_ref(locals, map_name));
+            char *rewritten_map = sb_take(&map_ref);
+            sb_append(&out, "__vais_map_str_str_snapshot(");
+            sb_append(&out, rewritten_map);
+            sb_append(&out, ")");
+            free(map_name);
+            free(rewritten_map);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (is_concat) {
+            char *tree = direct_rewrite_concat_tree(path, line_no, line, args[0], args[1], locals, fns, fn_count, structs, struct_count);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(name);
+            if (tree == NULL) {
+                free(out.data);
+                return NULL;
+            }
+            int next_i = close + 1;
+            int len_chain = 0;
+            if (direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain) && len_chain) {
+                sb_append(&out, "__vais_str_len(");
+                sb_append(&out, tree);
+                sb_append(&out, ")");
+            } else {
+                sb_append(&out, tree);
+            }
+            free(tree);
+            i = len_chain ? next_i : close + 1;
+            continue;
+        }
+        char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+        char *rewritten_arg2 = (is_sb_push || is_sb_append || is_contains || is_cmp || is_index_of || is_starts_with || is_ends_with || is_slice || is_replace || is_split_into || is_fs_write_text || is_path_join)
+            ? direct_rewrite_expr(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count)
+            : NULL;
+        if (is_split_ws_into || is_split_lines_into || is_fs_list_files || is_fs_list_dirs) {
+            char *list_name = NULL;
+            if (!direct_expr_bare_list_local(locals, args[1], &list_name) ||
+                strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    is_fs_list_dirs ? "direct native emitter fs_list_dirs output must be a local List<Str>" : is_fs_list_files ? "direct native emitter fs_list_files output must be a local List<Str>" : (is_split_lines_into ? "direct native emitter str_split_lines_into output must be a local List<Str>" : "direct native emitter str_split_ws_into output must be a local List<Str>"),
+                    "declare `let lines: List<Str> = []` and pass it as the second argument.",
+                    NULL);
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(rewritten_arg);
+                free(out.data);
+                return NULL;
+            }
+            StrBuf list_ref;
+            sb_init(&list_ref);
+            if (!direct_names_is_ref(locals, list_name)) sb_append(&list_ref, "&");
+            sb_append(&list_ref, list_name);
+            rewritten_arg2 = sb_take(&list_ref);
+            free(list_name);
+        } else if (is_split_into) {
+            char *list_name = NULL;
+            if (!direct_expr_bare_list_local(locals, args[2], &list_name) ||
+                strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter str_split_into output must be a local List<Str>",
+                    "declare `let words: List<Str> = []` and pass `words` as the third argument.",
+                    NULL);
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(rewritten_arg);
+                free(rewritten_arg2);
+                free(out.data);
+                return NULL;
+            }
+            StrBuf list_ref;
+            sb_init(&list_ref);
+            if (!direct_names_is_ref(locals, list_name)) sb_append(&list_ref, "&");
+            sb_append(&list_ref, list_name);
+            free(list_name);
+            char *rewritten_list = sb_take(&list_ref);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            if (rewritten_arg == NULL || rewritten_arg2 == NULL || rewritten_list == NULL) {
+                free(name);
+                free(rewritten_arg);
+                free(rewritten_arg2);
+                free(rewritten_list);
+                free(out.data);
+                return NULL;
+            }
+            sb_append(&out, "__vais_str_split_into(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_list);
+            sb_append(&out, ")");
+            free(rewritten_arg);
+            free(rewritten_arg2);
+            free(rewritten_list);
+            free(name);
+            i = close + 1;
+            continue;
+        } else if (is_doc_counts) {
+            char *map_name = NULL;
+            if (!direct_expr_bare_map_local(locals, args[1], &map_name) ||
+                strcmp(direct_names_type(locals, map_name), "Map<Str,Int>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter doc_term_counts_into output must be a local Map<Str,Int>",
+                    "declare `let counts: Map<Str,Int> = {}` and pass `counts` as the second argument.",
+                    NULL);
+                free(map_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(rewritten_arg);
+                free(out.data);
+                return NULL;
+            }
+            StrBuf map_ref;
+            sb_init(&map_ref);
+            direct_append_map_ptr_ref(&map_ref, map_name, direct_names_is_ref(locals, map_name));
+            rewritten_arg2 = sb_take(&map_ref);
+            free(map_name);
+        } else if (is_map_load) {
+            char *map_name = NULL;
+            if (!direct_expr_bare_map_local(locals, args[1], &map_name) ||
+                strcmp(direct_names_type(locals, map_name), "Map<Str,Str>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter map_str_str_load_snapshot output must be a local Map<Str,Str>",
+                    "declare `let docs: Map<Str,Str> = {}` and pass `docs` as the second argument.",
+                    NULL);
+                free(map_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(rewritten_arg);
+                free(out.data);
+                return NULL;
+            }
+            StrBuf map_ref;
+            sb_init(&map_ref);
+            direct_append_map_ptr_ref(&map_ref, map_name, direct_names_is_ref(locals, map_name));
+            rewritten_arg2 = sb_take(&map_ref);
+            free(map_name);
+        } else if (is_doc_overlap) {
+            char *query_name = NULL;
+            char *doc_name = NULL;
+            if (!direct_expr_bare_map_local(locals, args[0], &query_name) ||
+                strcmp(direct_names_type(locals, query_name), "Map<Str,Int>") != 0 ||
+                !direct_expr_bare_map_local(locals, args[1], &doc_name) ||
+                strcmp(direct_names_type(locals, doc_name), "Map<Str,Int>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter doc_term_overlap_score arguments must be Map<Str,Int>",
+                    "pass two local or parameter `Map<Str,Int>` values, such as `doc_term_overlap_score(query_counts, doc_counts)`.",
+                    NULL);
+                free(query_name);
+                free(doc_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(rewritten_arg);
+                free(out.data);
+                return NULL;
+            }
+            free(rewritten_arg);
+            StrBuf query_ref;
+            sb_init(&query_ref);
+            direct_append_map_ptr_ref(&query_ref, query_name, direct_names_is_ref(locals, query_name));
+            rewritten_arg = sb_take(&query_ref);
+            StrBuf doc_ref;
+            sb_init(&doc_ref);
+            direct_append_map_ptr_ref(&doc_ref, doc_name, direct_names_is_ref(locals, doc_name));
+            rewritten_arg2 = sb_take(&doc_ref);
+            free(query_name);
+            free(doc_name);
+        } else if (is_doc_weighted) {
+            char *query_name = NULL;
+            char *doc_name = NULL;
+            if (!direct_expr_bare_map_local(locals, args[0], &query_name) ||
+                strcmp(direct_names_type(locals, query_name), "Map<Str,Int>") != 0 ||
+                !direct_expr_bare_map_local(locals, args[1], &doc_name) ||
+                strcmp(direct_names_type(locals, doc_name), "Map<Str,Int>") != 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter doc_term_weighted_score arguments must be Map<Str,Int>",
+                    "pass two local or parameter `Map<Str,Int>` values, such as `doc_term_weighted_score(query_counts, doc_counts)`.",
+                    NULL);
+                free(query_name);
+                free(doc_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(rewritten_arg);
+                free(out.data);
+                return NULL;
+            }
+            free(rewritten_arg);
+            StrBuf query_ref;
+            sb_init(&query_ref);
+            direct_append_map_ptr_ref(&query_ref, query_name, direct_names_is_ref(locals, query_name));
+            rewritten_arg = sb_take(&query_ref);
+            StrBuf doc_ref;
+            sb_init(&doc_ref);
+            direct_append_map_ptr_ref(&doc_ref, doc_name, direct_names_is_ref(locals, doc_name));
+            rewritten_arg2 = sb_take(&doc_ref);
+            free(query_name);
+            free(doc_name);
+        }
+        char *rewritten_arg3 = (is_slice || is_replace)
+            ? direct_rewrite_expr(path, line_no, line, args[2], locals, fns, fn_count, structs, struct_count)
+            : NULL;
+        for (int k = 0; k < 16; k++) free(args[k]);
+        if (rewritten_arg == NULL || ((is_sb_push || is_sb_append || is_contains || is_cmp || is_index_of || is_starts_with || is_ends_with || is_slice || is_replace || is_fs_write_text || is_path_join || is_split_ws_into || is_split_lines_into || is_map_load || is_doc_counts || is_doc_overlap || is_doc_weighted) && rewritten_arg2 == NULL) ||
+            ((is_slice || is_replace) && rewritten_arg3 == NULL)) {
+            free(name);
+            free(rewritten_arg);
+            free(rewritten_arg2);
+            free(rewritten_arg3);
+            free(out.data);
+            return NULL;
+        }
+        int helper_returns_str = is_slice || is_join || is_replace || is_trim || is_lower || is_upper || is_byte || is_fs_read_text || is_fs_temp_dir || is_fs_cwd || is_path_join || is_path_basename || is_path_dirname || is_proc_arg || is_map_snapshot;
+        int next_i = close + 1;
+        int len_chain = 0;
+        if (helper_returns_str && direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain) && len_chain) {
+            sb_append(&out, "__vais_str_len(");
+        }
+        if (is_contains) {
+            sb_append(&out, "__vais_str_contains(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_cmp) {
+            sb_append(&out, "__vais_str_cmp(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_index_of) {
+            sb_append(&out, "__vais_str_index_of(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_starts_with) {
+            sb_append(&out, "__vais_str_starts_with(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_ends_with) {
+            sb_append(&out, "__vais_str_ends_with(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_slice) {
+            sb_append(&out, "__vais_str_slice(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg3);
+            sb_append(&out, ")");
+        } else if (is_replace) {
+            sb_append(&out, "__vais_str_replace(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg3);
+            sb_append(&out, ")");
+        } else if (is_trim) {
+            sb_append(&out, "__vais_str_trim(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_lower) {
+            sb_append(&out, "__vais_str_lower(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_upper) {
+            sb_append(&out, "__vais_str_upper(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_byte) {
+            sb_append(&out, "__vais_str_from_byte(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_sb_push) {
+            sb_append(&out, "str_builder_push(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_sb_append) {
+            sb_append(&out, "str_builder_append(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_sb_finish) {
+            sb_append(&out, "str_builder_finish(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_fs_exists) {
+            sb_append(&out, "fs_exists(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_fs_is_dir) {
+            sb_append(&out, "fs_is_dir(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_fs_mkdirs) {
+            sb_append(&out, "fs_mkdirs(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_stdout_write) {
+            sb_append(&out, "stdout_write(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_stderr_write) {
+            sb_append(&out, "stderr_write(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_fs_read_text) {
+            sb_append(&out, "fs_read_text(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_fs_write_text) {
+            sb_append(&out, "fs_write_text(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_path_join) {
+            sb_append(&out, "path_join(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_path_basename) {
+            sb_append(&out, "path_basename(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_path_dirname) {
+            sb_append(&out, "path_dirname(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_proc_arg) {
+            sb_append(&out, "proc_arg(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        } else if (is_split_ws_into) {
+            sb_append(&out, "__vais_str_split_ws_into(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_split_lines_into) {
+            sb_append(&out, "__vais_str_split_lines_into(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_fs_list_dirs) {
+            sb_append(&out, "__vais_fs_list_dirs(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_fs_list_files) {
+            sb_append(&out, "__vais_fs_list_files(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_map_load) {
+            sb_append(&out, "__vais_map_str_str_load_snapshot(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_doc_counts) {
+            sb_append(&out, "__vais_doc_term_counts_into(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_doc_overlap) {
+            sb_append(&out, "__vais_doc_term_overlap_score(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else if (is_doc_weighted) {
+            sb_append(&out, "__vais_doc_term_weighted_score(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_arg2);
+            sb_append(&out, ")");
+        } else {
+            sb_append(&out, strcmp(name, "parse_uint") == 0 ? "__vais_parse_uint(" : "__vais_parse_int(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+        }
+        if (len_chain) sb_append(&out, ")");
+        free(rewritten_arg);
+        free(rewritten_arg2);
+        free(rewritten_arg3);
+        free(name);
+        i = len_chain ? next_i : close + 1;
+    }
+    return sb_take(&out);
+}
+
+static char *direct_rewrite_option_result_constructors(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    StrBuf out;
+    sb_init(&out);
+    for (int i = 0; expr[i] != '\0';) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an unterminated string literal",
+                    "close the string before the end of the line.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an invalid char literal",
+                    "write a single-byte character literal such as `'A'`.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (!is_ident_start(expr[i])) {
+            sb_append_n(&out, expr + i, 1);
+            i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(expr[i])) i++;
+        char *name = substr_copy(expr + start, (size_t)(i - start));
+        int cursor = i;
+        while (expr[cursor] == ' ' || expr[cursor] == '\t') cursor++;
+        if (strcmp(name, "None") == 0 && expr[cursor] != '(') {
+            sb_append(&out, "1");
+            free(name);
+            continue;
+        }
+        if (!direct_is_option_result_payload_constructor_name(name) || expr[cursor] != '(') {
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(name);
+            continue;
+        }
+        int close = find_matching_paren_c(expr, cursor);
+        if (close < 0) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter expected `)` to close the Option/Result constructor",
+                "write `Some(value)`, `Ok(value)`, or `Err(code)`.",
+                NULL);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+        char *args[16] = {0};
+        int argc = split_top_level_commas_c(inside, args, 16);
+        free(inside);
+        if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter Option/Result constructors take one Int payload",
+                "write `Some(value)`, `Ok(value)`, or `Err(code)` with an Int-compatible payload.",
+                NULL);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        if (rewritten_arg == NULL) {
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        sb_append(&out, "(((");
+        sb_append(&out, rewritten_arg);
+        sb_append(&out, ") * 2)");
+        if (direct_is_err_constructor_name(name)) sb_append(&out, " + 1");
+        sb_append(&out, ")");
+        free(rewritten_arg);
+        free(name);
+        i = close + 1;
+    }
+    return sb_take(&out);
+}
+
+static char *direct_rewrite_str_conversion_calls(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    StrBuf out;
+    sb_init(&out);
+    for (int i = 0; expr[i] != '\0';) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an unterminated string literal",
+                    "close the string before the end of the line.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an invalid char literal",
+                    "write a single-byte character literal such as `'A'`.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (!is_ident_start(expr[i])) {
+            sb_append_n(&out, expr + i, 1);
+            i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(expr[i])) i++;
+        char *name = substr_copy(expr + start, (size_t)(i - start));
+        int cursor = i;
+        while (expr[cursor] == ' ' || expr[cursor] == '\t') cursor++;
+        if (expr[cursor] == '(' && direct_find_fn(fns, fn_count, name) != NULL) {
+            int fn_close = find_matching_paren_c(expr, cursor);
+            if (fn_close >= 0) {
+                sb_append_n(&out, expr + start, (size_t)(fn_close + 1 - start));
+                free(name);
+                i = fn_close + 1;
+                continue;
+            }
+        }
+        if (!direct_is_str_conversion_builtin_name(name) || expr[cursor] != '(') {
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(name);
+            continue;
+        }
+        int close = find_matching_paren_c(expr, cursor);
+        if (close < 0) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter expected `)` to close the Str conversion call",
+                "write `Str(value)`.",
+                NULL);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+        char *args[16] = {0};
+        int argc = split_top_level_commas_c(inside, args, 16);
+        free(inside);
+        if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter Str conversion takes one Int argument",
+                "write `Str(value)`.",
+                NULL);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        if (rewritten_arg == NULL) {
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+        sb_append(&out, "__vais_int_to_str(");
+        sb_append(&out, rewritten_arg);
+        sb_append(&out, ")");
+        free(rewritten_arg);
+        free(name);
+        i = close + 1;
+    }
+    return sb_take(&out);
+}
+
+static int direct_find_top_level_eq_op(const char *expr, int *op_len) {
+    int paren_depth = 0;
+    int bracket_depth = 0;
+    int brace_depth = 0;
+    for (int i = 0; expr[i] != '\0'; i++) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (expr[i] == '(') paren_depth++;
+        else if (expr[i] == ')') paren_depth--;
+        else if (expr[i] == '[') bracket_depth++;
+        else if (expr[i] == ']') bracket_depth--;
+        else if (expr[i] == '{') brace_depth++;
+        else if (expr[i] == '}') brace_depth--;
+        else if (paren_depth == 0 && bracket_depth == 0 && brace_depth == 0) {
+            if (expr[i] == '=' && expr[i + 1] == '=') {
+                *op_len = 2;
+                return i;
+            }
+            if (expr[i] == '!' && expr[i + 1] == '=') {
+                *op_len = 2;
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+static int direct_find_top_level_word_op(const char *expr, const char *word, int *op_len) {
+    int paren_depth = 0;
+    int bracket_depth = 0;
+    int brace_depth = 0;
+    int word_len = (int)strlen(word);
+    for (int i = 0; expr[i] != '\0'; i++) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (expr[i] == '(') paren_depth++;
+        else if (expr[i] == ')') paren_depth--;
+        else if (expr[i] == '[') bracket_depth++;
+        else if (expr[i] == ']') bracket_depth--;
+        else if (expr[i] == '{') brace_depth++;
+        else if (expr[i] == '}') brace_depth--;
+        else if (paren_depth == 0 && bracket_depth == 0 && brace_depth == 0) {
+            if (strncmp(expr + i, word, (size_t)word_len) == 0 &&
+                (i == 0 || !is_ident_continue(expr[i - 1])) &&
+                !is_ident_continue(expr[i + word_len])) {
+                *op_len = word_len;
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+static int direct_parse_if_expr_parts(const char *expr, char **cond_out, char **then_out, char **else_out) {
+    *cond_out = NULL;
+    *then_out = NULL;
+    *else_out = NULL;
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (!starts_with(s, "if") || is_ident_continue(s[2])) {
+        free(trimmed);
+        return 0;
+    }
+    int then_len = 0;
+    int else_len = 0;
+    int then_pos = direct_find_top_level_word_op(s, "then", &then_len);
+    int else_pos = direct_find_top_level_word_op(s, "else", &else_len);
+    if (then_pos <= 0 || else_pos <= then_pos) {
+        free(trimmed);
+        return 0;
+    }
+    char *cond_raw = substr_copy(s + 2, (size_t)(then_pos - 2));
+    char *then_raw = substr_copy(s + then_pos + then_len, (size_t)(else_pos - then_pos - then_len));
+    char *else_raw = trim_copy(s + else_pos + else_len);
+    *cond_out = trim_copy(cond_raw);
+    *then_out = trim_copy(then_raw);
+    *else_out = trim_copy(else_raw);
+    free(cond_raw);
+    free(then_raw);
+    free(else_raw);
+    int ok = (*cond_out)[0] != '\0' && (*then_out)[0] != '\0' && (*else_out)[0] != '\0';
+    if (!ok) {
+        free(*cond_out);
+        free(*then_out);
+        free(*else_out);
+        *cond_out = NULL;
+        *then_out = NULL;
+        *else_out = NULL;
+    }
+    free(trimmed);
+    return ok;
+}
+
+static char *direct_rewrite_str_equality_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    int bool_op_len = 0;
+    int bool_op = direct_find_top_level_word_op(expr, "or", &bool_op_len);
+    if (bool_op < 0) bool_op = direct_find_top_level_word_op(expr, "and", &bool_op_len);
+    if (bool_op >= 0) {
+        char *lhs_raw = substr_copy(expr, (size_t)bool_op);
+        char *lhs = trim_copy(lhs_raw);
+        free(lhs_raw);
+        char *rhs = trim_copy(expr + bool_op + bool_op_len);
+        char *rewritten_lhs = direct_rewrite_expr(path, line_no, line, lhs, locals, fns, fn_count, structs, struct_count);
+        char *rewritten_rhs = direct_rewrite_expr(path, line_no, line, rhs, locals, fns, fn_count, structs, struct_count);
+        free(lhs);
+        free(rhs);
+        if (rewritten_lhs == NULL || rewritten_rhs == NULL) {
+            free(rewritten_lhs);
+            free(rewritten_rhs);
+            return NULL;
+        }
+        StrBuf out;
+        sb_init(&out);
+        sb_append(&out, rewritten_lhs);
+        sb_append(&out, bool_op_len == 2 ? " or " : " and ");
+        sb_append(&out, rewritten_rhs);
+        free(rewritten_lhs);
+        free(rewritten_rhs);
+        return sb_take(&out);
+    }
+    int op_len = 0;
+    int op = direct_find_top_level_eq_op(expr, &op_len);
+    if (op < 0) return NULL;
+    char *lhs_raw = substr_copy(expr, (size_t)op);
+    char *lhs = trim_copy(lhs_raw);
+    free(lhs_raw);
+    char *rhs = trim_copy(expr + op + op_len);
+    char *lhs_type = direct_infer_expr_type(lhs, locals, fns, fn_count, structs, struct_count);
+    char *rhs_type = direct_infer_expr_type(rhs, locals, fns, fn_count, structs, struct_count);
+    int is_str_eq = direct_is_str_type(lhs_type) && direct_is_str_type(rhs_type);
+    free(lhs_type);
+    free(rhs_type);
+    if (!is_str_eq) {
+        free(lhs);
+        free(rhs);
+        return NULL;
+    }
+    char *rewritten_lhs = direct_rewrite_expr(path, line_no, line, lhs, locals, fns, fn_count, structs, struct_count);
+    char *rewritten_rhs = direct_rewrite_expr(path, line_no, line, rhs, locals, fns, fn_count, structs, struct_count);
+    free(lhs);
+    free(rhs);
+    if (rewritten_lhs == NULL || rewritten_rhs == NULL) {
+        free(rewritten_lhs);
+        free(rewritten_rhs);
+        return NULL;
+    }
+    StrBuf out;
+    sb_init(&out);
+    int not_equal = expr[op] == '!';
+    if (not_equal) sb_append(&out, "(!");
+    sb_append(&out, "__vais_str_eq(");
+    sb_append(&out, rewritten_lhs);
+    sb_append(&out, ", ");
+    sb_append(&out, rewritten_rhs);
+    sb_append(&out, ")");
+    if (not_equal) sb_append(&out, ")");
+    free(rewritten_lhs);
+    free(rewritten_rhs);
+    return sb_take(&out);
+}
+
+static char *direct_rewrite_list_literal_value_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    const char *list_type,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    if (!direct_is_list_type(list_type)) return NULL;
+    char *items[16] = {0};
+    int item_count = 0;
+    int literal_state = direct_parse_list_initializer_items(expr, items, 16, &item_count);
+    if (literal_state < 0) {
+        report_issue(path, line_no, find_col(line, "List"), line,
+            "direct native emitter supports up to 16 List literal items",
+            "bind a local list and call `push` for larger direct-engine lists.",
+            NULL);
+        for (int k = 0; k < 16; k++) free(items[k]);
+        return NULL;
+    }
+    if (literal_state != 1) {
+        for (int k = 0; k < 16; k++) free(items[k]);
+        return NULL;
+    }
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, "((");
+    sb_append(&out, direct_c_type(list_type));
+    if (item_count == 0) {
+        sb_append(&out, "){0})");
+        return sb_take(&out);
+    }
+    char *elem_type = direct_list_element_type(list_type);
+    const char *elem_ctype = direct_c_type(elem_type == NULL ? "Int" : elem_type);
+    sb_append(&out, "){ .data = __vais_list_dup((");
+    sb_append(&out, elem_ctype);
+    sb_append(&out, "[]){");
+    for (int item = 0; item < item_count; item++) {
+        char *rewritten_item = direct_rewrite_expr(path, line_no, line, items[item], locals, fns, fn_count, structs, struct_count);
+        if (rewritten_item == NULL) {
+            for (int k = item; k < 16; k++) free(items[k]);
+            free(elem_type);
+            free(out.data);
+            return NULL;
+        }
+        char *c_item = direct_translate_expr(rewritten_item);
+        if (item > 0) sb_append(&out, ", ");
+        sb_append(&out, c_item);
+        free(c_item);
+        free(rewritten_item);
+        free(items[item]);
+        items[item] = NULL;
+    }
+    char len_buf[32];
+    snprintf(len_buf, sizeof(len_buf), "%d", item_count);
+    sb_append(&out, "}, ");
+    sb_append(&out, len_buf);
+    sb_append(&out, ", sizeof(");
+    sb_append(&out, elem_ctype);
+    sb_append(&out, ")), .len = ");
+    sb_append(&out, len_buf);
+    sb_append(&out, ", .cap = ");
+    sb_append(&out, len_buf);
+    sb_append(&out, " })");
+    free(elem_type);
+    return sb_take(&out);
+}
+
+/* Binds a List argument value into a prelude temp. Inside a function the
+   temp is hoisted and owned, so the next run of the statement or a return
+   frees the buffer the call leaves behind. */
+static char *direct_bind_list_arg_temp(DirectNameSet *locals, const char *list_type, const char *c_value) {
+    char tmp_name[64];
+    snprintf(tmp_name, sizeof(tmp_name), "__vais_list_arg_%d", locals->temp_count++);
+    if (locals->hoist_decls != NULL) {
+        sb_append(direct_current_prelude, "free(");
+        sb_append(direct_current_prelude, tmp_name);
+        sb_append(direct_current_prelude, ".data);\n");
+        direct_emit_local_binding_prefix(direct_current_prelude, locals, tmp_name, list_type, 0, 0);
+        direct_names_add_typed(locals, tmp_name, list_type);
+        direct_note_owned_heap(locals, tmp_name);
+    } else {
+        sb_append(direct_current_prelude, direct_c_type(list_type));
+        sb_append(direct_current_prelude, " ");
+        sb_append(direct_current_prelude, tmp_name);
+        sb_append(direct_current_prelude, " = ");
+    }
+    sb_append(direct_current_prelude, c_value);
+    sb_append(direct_current_prelude, ";\n");
+    return strdup(tmp_name);
+}
+
+static char *direct_rewrite_list_arg_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    const char *list_type,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    if (direct_is_list_initializer_expr(expr)) {
+        char *value = direct_rewrite_list_literal_value_expr(path, line_no, line, expr, list_type, locals, fns, fn_count, structs, struct_count);
+        if (value == NULL) return NULL;
+        StrBuf out;
+        sb_init(&out);
+        sb_append(&out, "&");
+        if (direct_current_prelude != NULL && locals->hoist_decls != NULL) {
+            char *tmp_name = direct_bind_list_arg_temp(locals, list_type, value);
+            sb_append(&out, tmp_name);
+            free(tmp_name);
+        } else {
+            sb_append(&out, value);
+        }
+        free(value);
+        return sb_take(&out);
+    }
+    char *name = NULL;
+    if (direct_expr_bare_list_local(locals, expr, &name)) {
+        StrBuf out;
+        sb_init(&out);
+        if (!direct_names_is_ref(locals, name)) sb_append(&out, "&");
+        sb_append(&out, name);
+        free(name);
+        return sb_take(&out);
+    }
+    if (direct_expr_exact_list_return_call(expr, fns, fn_count)) {
+        char *rewritten_value = direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        if (rewritten_value == NULL) return NULL;
+        char *c_value = direct_translate_expr(rewritten_value);
+        free(rewritten_value);
+        if (direct_current_prelude == NULL) {
+            StrBuf out;
+            sb_init(&out);
+            sb_append(&out, "&((");
+            sb_append(&out, direct_c_type(list_type));
+            sb_append(&out, "[]){");
+            sb_append(&out, c_value);
+            sb_append(&out, "})[0]");
+            free(c_value);
+            return sb_take(&out);
+        }
+        char *tmp_name = direct_bind_list_arg_temp(locals, list_type, c_value);
+        free(c_value);
+        StrBuf out;
+        sb_init(&out);
+        sb_append(&out, "&");
+        sb_append(&out, tmp_name);
+        free(tmp_name);
+        return sb_take(&out);
+    }
+    report_issue(path, line_no, find_col(line, expr), line,
+        "direct native emitter requires a local List argument",
+        "bind the list value to a local before passing it.",
+        "let xs: List<Int> = []");
+    return NULL;
+}
+
+static char *direct_rewrite_map_arg_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals
+) {
+    char *name = NULL;
+    if (direct_expr_bare_map_local(locals, expr, &name)) {
+        StrBuf out;
+        sb_init(&out);
+        direct_append_map_ptr_ref(&out, name, direct_names_is_ref(locals, name));
+        free(name);
+        return sb_take(&out);
+    }
+    report_issue(path, line_no, find_col(line, expr), line,
+        "direct native emitter requires a local Map argument",
+        "bind the Map value to a local before passing it.",
+        "let m: Map<Int,Int> = {}");
+    return NULL;
+}
+
+static int direct_check_map_value_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    const char *map_type,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    if (!direct_is_supported_map_return_type(map_type)) {
+        report_issue(path, line_no, find_col(line, expr), line,
+            "direct native emitter Map return values are verified only for Map<Int,Int>, Map<Int,Bool>, Map<Int,Char>, Map<Str,Int>, Map<Str,Bool>, Map<Str,Char>, and Map<Str,Str>",
+            "use `Map<Int,Int>`, `Map<Int,Bool>`, `Map<Int,Char>`, `Map<Str,Int>`, `Map<Str,Bool>`, `Map<Str,Char>`, or `Map<Str,Str>` for returned Map values; keep generic Map values local.",
+            "fn make() -> Map<Int,Int>");
+        return 1;
+    }
+    char *name = NULL;
+    if (direct_expr_bare_map_local(locals, expr, &name)) {
+        const char *actual = direct_names_type(locals, name);
+        int ok = strcmp(actual, map_type) == 0;
+        free(name);
+        if (ok) return 0;
+    }
+    if (direct_expr_exact_map_return_call(expr, fns, fn_count)) {
+        char *expr_type = direct_infer_expr_type(expr, locals, fns, fn_count, structs, struct_count);
+        int ok_type = strcmp(expr_type, map_type) == 0;
+        free(expr_type);
+        if (!ok_type) {
+            report_issue(path, line_no, find_col(line, expr), line,
+                "direct native emitter Map value expression type does not match",
+                "return or initialize with the same concrete Map type.",
+                NULL);
+            return 1;
+        }
+        return direct_check_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+    }
+    report_issue(path, line_no, find_col(line, expr), line,
+        "direct native emitter Map value expression must be a local Map or Map-returning call",
+        "return a local `Map<Int,Int>`, `Map<Int,Bool>`, `Map<Int,Char>`, `Map<Str,Int>`, `Map<Str,Bool>`, `Map<Str,Char>`, or `Map<Str,Str>`, or initialize from a helper returning the same Map type.",
+        "let scores: Map<Int,Int> = make()");
+    return 1;
+}
+
+static char *direct_rewrite_map_value_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    const char *map_type,
+    int move_local,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    if (!direct_is_supported_map_return_type(map_type)) return NULL;
+    char *name = NULL;
+    if (direct_expr_bare_map_local(locals, expr, &name)) {
+        const char *actual = direct_names_type(locals, name);
+        if (actual != NULL && strcmp(actual, map_type) == 0) {
+            StrBuf out;
+            sb_init(&out);
+            int is_ref = direct_names_is_ref(locals, name);
+            /* Map storage is heap-backed, so only a returned owned local may
+             * hand its buffers over; every other binding takes its own copy. */
+            if (move_local && !is_ref) {
+                sb_append(&out, name);
+            } else {
+                sb_append(&out, direct_map_helper_name(map_type, "clone"));
+                sb_append(&out, "(");
+                direct_append_map_ptr_ref(&out, name, is_ref);
+                sb_append(&out, ")");
+            }
+            free(name);
+            return sb_take(&out);
+        }
+        free(name);
+    }
+    if (direct_expr_exact_map_return_call(expr, fns, fn_count)) {
+        return direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+    }
+    report_issue(path, line_no, find_col(line, expr), line,
+        "direct native emitter Map value expression must be a local Map or Map-returning call",
+        "return a local `Map<Int,Int>`, `Map<Int,Bool>`, `Map<Int,Char>`, `Map<Str,Int>`, `Map<Str,Bool>`, `Map<Str,Char>`, or `Map<Str,Str>`, or initialize from a helper returning the same Map type.",
+        "let scores: Map<Int,Int> = make()");
+    return NULL;
+}
+
+static char *direct_rewrite_list_value_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    const char *list_type,
+    int move_local,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    if (direct_is_list_initializer_expr(expr)) {
+        return direct_rewrite_list_literal_value_expr(path, line_no, line, expr, list_type, locals, fns, fn_count, structs, struct_count);
+    }
+    char *name = NULL;
+    if (direct_expr_bare_list_local(locals, expr, &name)) {
+        /* Lists share their heap buffer on struct copy, so only an owned local leaving scope may move. */
+        int is_ref = direct_names_is_ref(locals, name);
+        StrBuf out;
+        sb_init(&out);
+        if (move_local && !is_ref) {
+            sb_append(&out, name);
+        } else {
+            const char *src = is_ref ? "->" : ".";
+            sb_append(&out, "((");
+            sb_append(&out, direct_c_type(list_type));
+            sb_append(&out, "){ .data = __vais_list_dup(");
+            sb_append(&out, name);
+            sb_append(&out, src);
+            sb_append(&out, "data, ");
+            sb_append(&out, name);
+            sb_append(&out, src);
+            sb_append(&out, "len, sizeof(*");
+            sb_append(&out, name);
+            sb_append(&out, src);
+            sb_append(&out, "data)), .len = ");
+            sb_append(&out, name);
+            sb_append(&out, src);
+            sb_append(&out, "len, .cap = ");
+            sb_append(&out, name);
+            sb_append(&out, src);
+            sb_append(&out, "len })");
+        }
+        free(name);
+        return sb_take(&out);
+    }
+    return direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+}
+
+static int direct_map_method_returns_str(const char *map_type, const char *method) {
+    if (strcmp(method, "key_at") == 0) {
+        return direct_is_str_type(direct_map_key_type(map_type));
+    }
+    if (strcmp(method, "get") == 0 || strcmp(method, "value_at") == 0) {
+        return direct_is_str_type(direct_map_value_type(map_type));
+    }
+    return 0;
+}
+
+int direct_parse_trailing_str_len(const char *expr, int pos, int *next_i, int *has_len) {
+    *next_i = pos;
+    *has_len = 0;
+    const char *tail = skip_ws(expr + pos);
+    if (*tail != '.') return 1;
+
+    int field_start = (int)(tail - expr) + 1;
+    while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+    int field_end = field_start;
+    while (is_ident_continue(expr[field_end])) field_end++;
+    if (field_end == field_start) return 0;
+    char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+    int is_len = strcmp(field, "len") == 0;
+    free(field);
+    if (!is_len) return 0;
+
+    const char *after = skip_ws(expr + field_end);
+    int end = field_end;
+    if (*after == '(') {
+        int close = find_matching_paren_c(expr, (int)(after - expr));
+        if (close < 0) return 0;
+        char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+        char *trimmed_args = trim_copy(args);
+        int has_args = trimmed_args[0] != '\0';
+        free(trimmed_args);
+        free(args);
+        if (has_args) return 0;
+        end = close + 1;
+    }
+
+    *next_i = end;
+    *has_len = 1;
+    return 1;
+}
+
+static int direct_parse_flattened_nested_struct_tail(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    int pos,
+    DirectStructInfo *st,
+    DirectStructInfo *structs,
+    int struct_count,
+    char **flatten_field,
+    int *next_i,
+    int *len_chain
+) {
+    *flatten_field = NULL;
+    *next_i = pos;
+    if (len_chain != NULL) *len_chain = 0;
+    const char *tail = skip_ws(expr + pos);
+    if (st == NULL || *tail != '.') return 1;
+    int field_start = (int)(tail - expr) + 1;
+    while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+    int field_end = field_start;
+    while (is_ident_continue(expr[field_end])) field_end++;
+    if (field_end == field_start) return 1;
+    char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+    const char *after_field = skip_ws(expr + field_end);
+    if (*after_field != '.') {
+        free(field);
+        return 1;
+    }
+    const char *field_type = direct_struct_field_type(st, field);
+    if (direct_is_str_type(field_type)) {
+        int str_next = field_end;
+        int str_len = 0;
+        if (direct_parse_trailing_str_len(expr, field_end, &str_next, &str_len) && str_len) {
+            *flatten_field = strdup(field);
+            if (*flatten_field == NULL) die_oom();
+            *next_i = str_next;
+            if (len_chain != NULL) *len_chain = 1;
+            free(field);
+            return 1;
+        }
+        report_issue(path, line_no, find_col(line, field), line,
+            "direct native emitter supports only `.len()` after a Str field on List<Struct> method results",
+            "write `docs.first().title.len()` or bind the struct value to a local first.",
+            NULL);
+        free(field);
+        return 0;
+    }
+    int nested_start = (int)(after_field - expr) + 1;
+    while (expr[nested_start] == ' ' || expr[nested_start] == '\t') nested_start++;
+    int nested_end = nested_start;
+    while (is_ident_continue(expr[nested_end])) nested_end++;
+    if (nested_end == nested_start) {
+        report_issue(path, line_no, find_col(line, field), line,
+            "direct native emitter expected a nested struct field name after `.`",
+            "read a field declared on this nested struct.",
+            NULL);
+        free(field);
+        return 0;
+    }
+    char *nested_field = substr_copy(expr + nested_start, (size_t)(nested_end - nested_start));
+    DirectStructInfo *nested = field_type == NULL ? NULL : direct_find_struct(structs, struct_count, field_type);
+    if (nested == NULL || !direct_struct_has_field(nested, nested_field)) {
+        report_issue(path, line_no, find_col(line, field), line,
+            "direct native emitter found an unknown nested List<Struct> method field access",
+            "read a field declared on this nested struct method result.",
+            NULL);
+        free(nested_field);
+        free(field);
+        return 0;
+    }
+    StrBuf tail_buf;
+    sb_init(&tail_buf);
+    sb_append(&tail_buf, field);
+    sb_append(&tail_buf, ".");
+    sb_append(&tail_buf, nested_field);
+    *flatten_field = sb_take(&tail_buf);
+    *next_i = nested_end;
+    free(nested_field);
+    free(field);
+    return 1;
+}
+
+static char *direct_infer_struct_tail_type(
+    const char *expr,
+    int pos,
+    DirectStructInfo *st,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    const char *tail = skip_ws(expr + pos);
+    if (st == NULL || *tail != '.') return NULL;
+    int field_start = (int)(tail - expr) + 1;
+    while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+    int field_end = field_start;
+    while (is_ident_continue(expr[field_end])) field_end++;
+    if (field_end == field_start) return NULL;
+    char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+    const char *field_type = direct_struct_field_type(st, field);
+    if (field_type == NULL) {
+        free(field);
+        return NULL;
+    }
+    const char *after_field = skip_ws(expr + field_end);
+    if (*after_field == '\0') {
+        char *out = strdup(field_type);
+        if (out == NULL) die_oom();
+        free(field);
+        return out;
+    }
+    int next_i = field_end;
+    int len_chain = 0;
+    if (direct_is_str_type(field_type) &&
+        direct_parse_trailing_str_len(expr, field_end, &next_i, &len_chain) &&
+        len_chain &&
+        *skip_ws(expr + next_i) == '\0') {
+        free(field);
+        return strdup("Int");
+    }
+    if (*after_field != '.') {
+        free(field);
+        return NULL;
+    }
+    DirectStructInfo *nested = direct_find_struct(structs, struct_count, field_type);
+    int nested_start = (int)(after_field - expr) + 1;
+    while (expr[nested_start] == ' ' || expr[nested_start] == '\t') nested_start++;
+    int nested_end = nested_start;
+    while (is_ident_continue(expr[nested_end])) nested_end++;
+    if (nested_end == nested_start) {
+        free(field);
+        return NULL;
+    }
+    char *nested_field = substr_copy(expr + nested_start, (size_t)(nested_end - nested_start));
+    const char *nested_type = nested == NULL ? NULL : direct_struct_field_type(nested, nested_field);
+    if (nested_type == NULL) {
+        free(nested_field);
+        free(field);
+        return NULL;
+    }
+    const char *after_nested = skip_ws(expr + nested_end);
+    if (*after_nested == '\0') {
+        char *out = strdup(nested_type);
+        if (out == NULL) die_oom();
+        free(nested_field);
+        free(field);
+        return out;
+    }
+    next_i = nested_end;
+    len_chain = 0;
+    if (direct_is_str_type(nested_type) &&
+        direct_parse_trailing_str_len(expr, nested_end, &next_i, &len_chain) &&
+        len_chain &&
+        *skip_ws(expr + next_i) == '\0') {
+        free(nested_field);
+        free(field);
+        return strdup("Int");
+    }
+    free(nested_field);
+    free(field);
+    return NULL;
+}
+
+static char *direct_rewrite_list_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    StrBuf out;
+    sb_init(&out);
+    for (int i = 0; expr[i] != '\0';) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an unterminated string literal",
+                    "close the string before the end of the line.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an invalid char literal",
+                    "write a single-byte character literal such as `'A'`.",
+                    NULL);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + i, (size_t)(end - i));
+            i = end;
+            continue;
+        }
+        if (!is_ident_start(expr[i])) {
+            sb_append_n(&out, expr + i, 1);
+            i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(expr[i])) i++;
+        char *name = substr_copy(expr + start, (size_t)(i - start));
+        const char *base_type = direct_names_type(locals, name);
+        int cursor = i;
+        while (expr[cursor] == ' ' || expr[cursor] == '\t') cursor++;
+        if (expr[cursor] == '(' &&
+            (direct_is_str_conversion_builtin_name(name) || direct_is_parse_builtin_name(name) || direct_is_str_cmp_builtin_name(name) || direct_is_str_contains_builtin_name(name) || direct_is_str_index_of_builtin_name(name) || direct_is_str_starts_with_builtin_name(name) || direct_is_str_ends_with_builtin_name(name) || direct_is_str_slice_builtin_name(name) || direct_is_str_concat_builtin_name(name) || direct_is_str_join_builtin_name(name) || direct_is_str_replace_builtin_name(name) || direct_is_str_trim_builtin_name(name) || direct_is_str_lower_builtin_name(name) || direct_is_str_upper_builtin_name(name) || direct_is_str_byte_builtin_name(name) || direct_is_fs_exists_builtin_name(name) || direct_is_fs_is_dir_builtin_name(name) || direct_is_fs_mkdirs_builtin_name(name) || direct_is_fs_read_text_builtin_name(name) || direct_is_fs_write_text_builtin_name(name) || direct_is_fs_cwd_builtin_name(name) || direct_is_proc_self_builtin_name(name) || direct_is_stdin_read_all_builtin_name(name) || direct_is_stdout_write_builtin_name(name) || direct_is_stderr_write_builtin_name(name) || direct_is_fs_temp_dir_builtin_name(name) || direct_is_path_join_builtin_name(name) || direct_is_path_basename_builtin_name(name) || direct_is_path_dirname_builtin_name(name) || direct_is_time_millis_builtin_name(name) || direct_is_time_nanos_builtin_name(name) || direct_is_str_builder_new_builtin_name(name) || direct_is_str_builder_push_builtin_name(name) || direct_is_str_builder_append_builtin_name(name) || direct_is_str_builder_finish_builtin_name(name) || direct_is_proc_argc_builtin_name(name) || direct_is_proc_arg_builtin_name(name) || direct_is_str_split_ws_into_builtin_name(name) || direct_is_str_split_lines_into_builtin_name(name) || direct_is_fs_list_files_builtin_name(name) || direct_is_fs_list_dirs_builtin_name(name) || direct_is_str_split_into_builtin_name(name) || direct_is_doc_term_counts_into_builtin_name(name) || direct_is_doc_term_overlap_score_builtin_name(name) || direct_is_doc_term_weighted_score_builtin_name(name))) {
+            int close = find_matching_paren_c(expr, cursor);
+            if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `)` to close the string helper call",
+                    "write `parse_uint(s)`, `parse_int(s)`, `fs_exists(path)`, `fs_read_text(path)`, `fs_write_text(path, text)`, `fs_mkdirs(path)`, `fs_cwd()`, `fs_temp_dir()`, `path_join(base, child)`, `path_basename(path)`, `path_dirname(path)`, `time_millis()`, `proc_argc()`, `proc_arg(index)`, `str_contains(text, needle)`, `str_index_of(text, needle)`, `str_starts_with(text, prefix)`, `str_ends_with(text, suffix)`, `str_slice(text, start, len)`, `str_concat(left, right)`, `str_join(parts, sep)`, `str_replace(text, needle, replacement)`, `str_trim(text)`, `str_lower(text)`, `str_upper(text)`, `str_byte(value)`, `str_split_ws_into(text, out)`, `str_split_lines_into(text, out)`, `str_split_into(text, sep, out)`, `fs_list_files(dir, out)`, `doc_term_counts_into(text, counts)`, `doc_term_overlap_score(query, doc)`, or `doc_term_weighted_score(query, doc)`.",
+                    NULL);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + start, (size_t)(close + 1 - start));
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (expr[cursor] == '(' && direct_is_proc_run_env_builtin_name(name)) {
+            int close = find_matching_paren_c(expr, cursor);
+            if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `)` to close the proc_run_env call",
+                    "write `proc_run_env(argv, env)` where both are local `List<Str>` values.",
+                    NULL);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+            char *args[16] = {0};
+            int argc = split_top_level_commas_c(inside, args, 16);
+            free(inside);
+            if (argc != 2 || args[0] == NULL || args[1] == NULL ||
+                strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter proc_run_env takes argv and env List<Str> arguments",
+                    "write `proc_run_env(argv, env)` where both are local `List<Str>` values.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *rewritten_argv = direct_rewrite_list_arg_expr(path, line_no, line, args[0], "List<Str>", locals, fns, fn_count, structs, struct_count);
+            char *rewritten_env = rewritten_argv == NULL ? NULL : direct_rewrite_list_arg_expr(path, line_no, line, args[1], "List<Str>", locals, fns, fn_count, structs, struct_count);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            if (rewritten_argv == NULL || rewritten_env == NULL) {
+                free(rewritten_argv);
+                free(rewritten_env);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            sb_append(&out, "__vais_proc_run_env(");
+            sb_append(&out, rewritten_argv);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_env);
+            sb_append(&out, ")");
+            free(rewritten_argv);
+            free(rewritten_env);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (expr[cursor] == '(' && direct_is_proc_run_builtin_name(name)) {
+            int close = find_matching_paren_c(expr, cursor);
+            if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `)` to close the proc_run call",
+                    "write `proc_run(argv)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+            char *args[16] = {0};
+            int argc = split_top_level_commas_c(inside, args, 16);
+            free(inside);
+            if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter proc_run takes one List<Str> argument",
+                    "write `proc_run(argv)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *rewritten_arg = direct_rewrite_list_arg_expr(path, line_no, line, args[0], "List<Str>", locals, fns, fn_count, structs, struct_count);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            if (rewritten_arg == NULL) {
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            sb_append(&out, "__vais_proc_run(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+            free(rewritten_arg);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (expr[cursor] == '(' && direct_is_proc_spawn_to_builtin_name(name)) {
+            int close = find_matching_paren_c(expr, cursor);
+            if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `)` to close the proc_spawn_to call",
+                    "write `proc_spawn_to(argv, stdout_path, stderr_path)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+            char *args[16] = {0};
+            int argc = split_top_level_commas_c(inside, args, 16);
+            free(inside);
+            if (argc != 3 || args[0] == NULL || args[1] == NULL || args[2] == NULL ||
+                strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0 || strlen(skip_ws(args[2])) == 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter proc_spawn_to takes argv, stdout_path, and stderr_path arguments",
+                    "write `proc_spawn_to(argv, stdout_path, stderr_path)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *rewritten_argv = direct_rewrite_list_arg_expr(path, line_no, line, args[0], "List<Str>", locals, fns, fn_count, structs, struct_count);
+            char *rewritten_out = rewritten_argv == NULL ? NULL : direct_rewrite_list_expr(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count);
+            char *rewritten_err = rewritten_out == NULL ? NULL : direct_rewrite_list_expr(path, line_no, line, args[2], locals, fns, fn_count, structs, struct_count);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            if (rewritten_argv == NULL || rewritten_out == NULL || rewritten_err == NULL) {
+                free(rewritten_argv);
+                free(rewritten_out);
+                free(rewritten_err);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            sb_append(&out, "__vais_proc_spawn_to(");
+            sb_append(&out, rewritten_argv);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_out);
+            sb_append(&out, ", ");
+            sb_append(&out, rewritten_err);
+            sb_append(&out, ")");
+            free(rewritten_argv);
+            free(rewritten_out);
+            free(rewritten_err);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (expr[cursor] == '(' && direct_is_proc_spawn_builtin_name(name)) {
+            int close = find_matching_paren_c(expr, cursor);
+            if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `)` to close the proc_spawn call",
+                    "write `proc_spawn(argv)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+            char *args[16] = {0};
+            int argc = split_top_level_commas_c(inside, args, 16);
+            free(inside);
+            if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter proc_spawn takes one List<Str> argument",
+                    "write `proc_spawn(argv)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *rewritten_arg = direct_rewrite_list_arg_expr(path, line_no, line, args[0], "List<Str>", locals, fns, fn_count, structs, struct_count);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            if (rewritten_arg == NULL) {
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            sb_append(&out, "__vais_proc_spawn(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+            free(rewritten_arg);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (expr[cursor] == '(' && direct_is_proc_capture_builtin_name(name)) {
+            int close = find_matching_paren_c(expr, cursor);
+            if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `)` to close the proc_capture call",
+                    "write `proc_capture(argv)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+            char *args[16] = {0};
+            int argc = split_top_level_commas_c(inside, args, 16);
+            free(inside);
+            if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter proc_capture takes one List<Str> argument",
+                    "write `proc_capture(argv)` where `argv` is a local `List<Str>`.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *rewritten_arg = direct_rewrite_list_arg_expr(path, line_no, line, args[0], "List<Str>", locals, fns, fn_count, structs, struct_count);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            if (rewritten_arg == NULL) {
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            sb_append(&out, "__vais_proc_capture(");
+            sb_append(&out, rewritten_arg);
+            sb_append(&out, ")");
+            free(rewritten_arg);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (expr[cursor] == '(') {
+            DirectFnInfo *fn = direct_find_fn(fns, fn_count, name);
+            if (fn != NULL) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the function call",
+                        "close the call arguments.",
+                        NULL);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc == 1 && args[0] != NULL && strlen(skip_ws(args[0])) == 0) {
+                    free(args[0]);
+                    args[0] = NULL;
+                    argc = 0;
+                }
+                if (argc < 0 || argc != fn->param_count) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter function call argument count does not match",
+                        "pass exactly the parameters declared by the direct helper.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                sb_append(&out, name);
+                sb_append(&out, "(");
+                for (int a = 0; a < argc; a++) {
+                    char *rewritten_arg = NULL;
+                    if (direct_is_list_type(fn->param_types[a])) {
+                        rewritten_arg = direct_rewrite_list_arg_expr(path, line_no, line, args[a], fn->param_types[a], locals, fns, fn_count, structs, struct_count);
+                    } else if (direct_is_map_type(fn->param_types[a])) {
+                        rewritten_arg = direct_rewrite_map_arg_expr(path, line_no, line, args[a], locals);
+                    } else {
+                        rewritten_arg = direct_rewrite_expr(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count);
+                    }
+                    if (rewritten_arg == NULL) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                    if (a > 0) sb_append(&out, ", ");
+                    sb_append(&out, rewritten_arg);
+                    free(rewritten_arg);
+                }
+                sb_append(&out, ")");
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+        }
+        if (direct_is_str_type(base_type)) {
+            if (expr[cursor] == '[') {
+                int close = find_matching_bracket_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `]` to close a Str index",
+                        "write indexes as `s[i]`.",
+                        NULL);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *index_expr = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *rewritten_index = direct_rewrite_expr(path, line_no, line, index_expr, locals, fns, fn_count, structs, struct_count);
+                free(index_expr);
+                if (rewritten_index == NULL) {
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                sb_append(&out, "__vais_str_byte(");
+                sb_append(&out, name);
+                sb_append(&out, ", (long)(");
+                sb_append(&out, rewritten_index);
+                sb_append(&out, "))");
+                free(rewritten_index);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (expr[cursor] == '.') {
+                int field_start = cursor + 1;
+                while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+                int field_end = field_start;
+                while (is_ident_continue(expr[field_end])) field_end++;
+                char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+                const char *after = skip_ws(expr + field_end);
+                if (strcmp(field, "len") == 0) {
+                    int next_i = field_end;
+                    if (*after == '(') {
+                        int close = find_matching_paren_c(expr, (int)(after - expr));
+                        if (close < 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter expected `)` after Str.len",
+                                "write `s.len()` or `s.len`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                        char *trimmed_args = trim_copy(args);
+                        int has_args = trimmed_args[0] != '\0';
+                        free(trimmed_args);
+                        free(args);
+                        if (has_args) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter Str.len takes no arguments",
+                                "write `s.len()`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        next_i = close + 1;
+                    }
+                    sb_append(&out, "__vais_str_len(");
+                    sb_append(&out, name);
+                    sb_append(&out, ")");
+                    free(field);
+                    free(name);
+                    i = next_i;
+                    continue;
+                }
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter supports Str len and index expressions",
+                    "write `s.len()` or `s[i]`.",
+                    NULL);
+                free(field);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(name);
+            continue;
+        }
+        DirectStructInfo *base_st = base_type == NULL ? NULL : direct_find_struct(structs, struct_count, base_type);
+        if (base_st != NULL && expr[cursor] == '.') {
+            int field_start = cursor + 1;
+            while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+            int field_end = field_start;
+            while (is_ident_continue(expr[field_end])) field_end++;
+            char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+            const char *field_type = direct_struct_field_type(base_st, field);
+            if (direct_is_str_type(field_type)) {
+                int next_i = field_end;
+                int len_chain = 0;
+                if (!direct_parse_trailing_str_len(expr, field_end, &next_i, &len_chain)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports only `.len()` after a Str struct field",
+                        "write `doc.title.len()` or bind the field to a Str local first.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (len_chain) {
+                    sb_append(&out, "__vais_str_len(");
+                    sb_append_n(&out, expr + start, (size_t)(field_end - start));
+                    sb_append(&out, ")");
+                } else {
+                    sb_append_n(&out, expr + start, (size_t)(field_end - start));
+                }
+                free(field);
+                free(name);
+                i = next_i;
+                continue;
+            }
+            free(field);
+        }
+        if (!direct_is_list_type(base_type)) {
+            if (direct_is_map_type(base_type)) {
+                if (expr[cursor] == '.') {
+                    int field_start = cursor + 1;
+                    while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+                    int field_end = field_start;
+                    while (is_ident_continue(expr[field_end])) field_end++;
+                    char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+                    const char *after = skip_ws(expr + field_end);
+                    if (strcmp(field, "len") == 0) {
+                        if (*after != '(') {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter Map.len must be called",
+                                "write `m.len()`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        int close = find_matching_paren_c(expr, (int)(after - expr));
+                        if (close < 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter expected `)` after Map.len",
+                                "write `m.len()`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        sb_append(&out, direct_map_helper_name(base_type, "len"));
+                        sb_append(&out, "(");
+                        direct_append_map_ptr_ref(&out, name, direct_names_is_ref(locals, name));
+                        sb_append(&out, ")");
+                        free(field);
+                        free(name);
+                        i = close + 1;
+                        continue;
+                    }
+                    if ((strcmp(field, "contains") == 0 || strcmp(field, "get") == 0 || strcmp(field, "get_opt") == 0) && *after == '(') {
+                        int close = find_matching_paren_c(expr, (int)(after - expr));
+                        if (close < 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter expected `)` after Map method",
+                                "write `m.contains(key)`, `m.get(key, default)`, or `m.get_opt(key)`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                        char *args[16] = {0};
+                        int argc = split_top_level_commas_c(inside, args, 16);
+                        free(inside);
+                        int expected = strcmp(field, "get") == 0 ? 2 : 1;
+                        if (argc != expected) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter Map method argument count does not match",
+                                "write `m.contains(key)`, `m.get(key, default)`, or `m.get_opt(key)`.",
+                                NULL);
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (direct_map_method_returns_str(base_type, field)) {
+                            if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                                report_issue(path, line_no, find_col(line, name), line,
+                                    "direct native emitter supports only `.len()` after Str-returning Map methods",
+                                    "write `m.get(key, fallback).len()`, `m.key_at(index).len()`, or bind the string to a local first.",
+                                    NULL);
+                                for (int k = 0; k < 16; k++) free(args[k]);
+                                free(field);
+                                free(name);
+                                free(out.data);
+                                return NULL;
+                            }
+                        }
+                        if (len_chain) sb_append(&out, "__vais_str_len(");
+                        sb_append(&out, direct_map_helper_name(base_type, field));
+                        sb_append(&out, "(");
+                        direct_append_map_ptr_ref(&out, name, direct_names_is_ref(locals, name));
+                        for (int a = 0; a < argc; a++) {
+                            char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count);
+                            if (rewritten_arg == NULL) {
+                                for (int k = 0; k < 16; k++) free(args[k]);
+                                free(field);
+                                free(name);
+                                free(out.data);
+                                return NULL;
+                            }
+                            sb_append(&out, ", ");
+                            sb_append(&out, rewritten_arg);
+                            free(rewritten_arg);
+                        }
+                        sb_append(&out, ")");
+                        if (len_chain) sb_append(&out, ")");
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        i = next_i;
+                        continue;
+                    }
+                    if ((strcmp(field, "key_at") == 0 || strcmp(field, "value_at") == 0) && *after == '(') {
+                        int close = find_matching_paren_c(expr, (int)(after - expr));
+                        if (close < 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter expected `)` after Map entry method",
+                                "write `m.key_at(index)` or `m.value_at(index)`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                        char *args[16] = {0};
+                        int argc = split_top_level_commas_c(inside, args, 16);
+                        free(inside);
+                        if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter Map entry method argument count does not match",
+                                "write `m.key_at(index)` or `m.value_at(index)`.",
+                                NULL);
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (direct_map_method_returns_str(base_type, field)) {
+                            if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                                report_issue(path, line_no, find_col(line, name), line,
+                                    "direct native emitter supports only `.len()` after Str-returning Map entry methods",
+                                    "write `m.key_at(index).len()`, `m.value_at(index).len()`, or bind the string to a local first.",
+                                    NULL);
+                                for (int k = 0; k < 16; k++) free(args[k]);
+                                free(field);
+                                free(name);
+                                free(out.data);
+                                return NULL;
+                            }
+                        }
+                        if (len_chain) sb_append(&out, "__vais_str_len(");
+                        sb_append(&out, direct_map_helper_name(base_type, field));
+                        sb_append(&out, "(");
+                        direct_append_map_ptr_ref(&out, name, direct_names_is_ref(locals, name));
+                        char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+                        if (rewritten_arg == NULL) {
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(field);
+                            free(name);
+                            free(out.data);
+                            return NULL;
+                        }
+                        sb_append(&out, ", ");
+                        sb_append(&out, rewritten_arg);
+                        free(rewritten_arg);
+                        sb_append(&out, ")");
+                        if (len_chain) sb_append(&out, ")");
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        i = next_i;
+                        continue;
+                    }
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports Map get, get_opt, contains, len, key_at, and value_at expressions",
+                            "write `m.get(key, default)`, `m.get_opt(key)`, `m.contains(key)`, `m.len()`, `m.key_at(index)`, or `m.value_at(index)` for verified concrete Map values.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                sb_append_n(&out, expr + start, (size_t)(i - start));
+                free(name);
+                continue;
+            }
+            sb_append_n(&out, expr + start, (size_t)(i - start));
+            free(name);
+            continue;
+        }
+
+        int is_ref = direct_names_is_ref(locals, name);
+        if (expr[cursor] == '[') {
+            int close = find_matching_bracket_c(expr, cursor);
+            if (close < 0) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected `]` to close a List<Int> index",
+                    "write indexes as `xs[i]`.",
+                    NULL);
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *index_expr = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+            char *rewritten_index = direct_rewrite_list_expr(path, line_no, line, index_expr, locals, fns, fn_count, structs, struct_count);
+            free(index_expr);
+            if (rewritten_index == NULL) {
+                free(name);
+                free(out.data);
+                return NULL;
+            }
+            char *elem_type = direct_list_element_type(base_type);
+            int next_i = close + 1;
+            int len_chain = 0;
+            char *flatten_field = NULL;
+            if (direct_is_str_type(elem_type)) {
+                if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports only `.len()` after List<Str> index expressions",
+                        "write `words[i].len()` or bind the string element to a local first.",
+                        NULL);
+                    free(elem_type);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+            } else if (elem_type != NULL) {
+                DirectStructInfo *elem_st = direct_find_struct(structs, struct_count, elem_type);
+                if (!direct_parse_flattened_nested_struct_tail(path, line_no, line, expr, close + 1, elem_st, structs, struct_count, &flatten_field, &next_i, &len_chain)) {
+                    free(elem_type);
+                    free(rewritten_index);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+            }
+            free(elem_type);
+            if (len_chain) sb_append(&out, "__vais_str_len(");
+            direct_append_list_data_ref(&out, name, is_ref);
+            sb_append(&out, "[__vais_list_checked_index((long)(");
+            sb_append(&out, rewritten_index);
+            sb_append(&out, "), ");
+            direct_append_list_len_ref(&out, name, is_ref);
+            sb_append(&out, ")]");
+            if (flatten_field != NULL) {
+                sb_append(&out, ".");
+                sb_append(&out, flatten_field);
+                free(flatten_field);
+            }
+            if (len_chain) sb_append(&out, ")");
+            free(rewritten_index);
+            free(name);
+            i = next_i;
+            continue;
+        }
+
+        if (expr[cursor] == '.') {
+            int field_start = cursor + 1;
+            while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+            int field_end = field_start;
+            while (is_ident_continue(expr[field_end])) field_end++;
+            char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+            const char *after = skip_ws(expr + field_end);
+            if (strcmp(field, "len") == 0) {
+                int next_i = field_end;
+                if (*after == '(') {
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List<Int>.len",
+                            "write `xs.len()` or `xs.len`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                    char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *trimmed_args = trim_copy(args);
+                    int has_args = trimmed_args[0] != '\0';
+                    free(trimmed_args);
+                    free(args);
+                    if (has_args) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter List<Int>.len takes no arguments",
+                            "write `xs.len()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                    next_i = close + 1;
+                }
+                direct_append_list_len_ref(&out, name, is_ref);
+                free(field);
+                free(name);
+                i = next_i;
+                continue;
+            }
+            if (strcmp(field, "is_empty") == 0) {
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.is_empty must be called",
+                        "write `xs.is_empty()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.is_empty",
+                        "write `xs.is_empty()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *trimmed_args = trim_copy(args);
+                int has_args = trimmed_args[0] != '\0';
+                free(trimmed_args);
+                free(args);
+                if (has_args) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.is_empty takes no arguments",
+                        "write `xs.is_empty()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                direct_append_list_is_empty_ref(&out, name, is_ref);
+                free(field);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (strcmp(field, "contains") == 0) {
+                if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports contains only on List<Int> and List<Str>",
+                        "use `xs.contains(value)` on `List<Int>` or `words.contains(value)` on `List<Str>`; compare `List<Struct>` elements in an explicit loop for now.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.contains must be called",
+                        "write `xs.contains(value)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.contains",
+                        "write `xs.contains(value)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.contains expects one argument",
+                        "write `xs.contains(value)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                const char *expected_arg_type = direct_is_list_str_type(base_type) ? "Str" : "Int";
+                if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        direct_is_list_str_type(base_type) ?
+                            "direct native emitter List<Str>.contains argument must be Str" :
+                            "direct native emitter List<Int>.contains argument must be Int",
+                        direct_is_list_str_type(base_type) ?
+                            "pass a Str value to `words.contains(value)`." :
+                            "pass an Int-compatible value to `xs.contains(value)`.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                free(arg_type);
+                char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+                if (rewritten_arg == NULL) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                direct_append_list_contains_ref(&out, name, is_ref, base_type, rewritten_arg);
+                free(rewritten_arg);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(field);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (strcmp(field, "index_of") == 0) {
+                if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports index_of only on List<Int> and List<Str>",
+                        "use `xs.index_of(value)` on `List<Int>` or `words.index_of(value)` on `List<Str>`; scan other list element types in an explicit loop for now.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.index_of must be called",
+                        "write `words.index_of(value)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.index_of",
+                        "write `words.index_of(value)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.index_of expects one argument",
+                        "write `words.index_of(value)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                const char *expected_arg_type = direct_is_list_str_type(base_type) ? "Str" : "Int";
+                if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        direct_is_list_str_type(base_type) ?
+                            "direct native emitter List<Str>.index_of argument must be Str" :
+                            "direct native emitter List<Int>.index_of argument must be Int",
+                        direct_is_list_str_type(base_type) ?
+                            "pass a Str value to `words.index_of(value)`." :
+                            "pass an Int-compatible value to `xs.index_of(value)`.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                free(arg_type);
+                char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+                if (rewritten_arg == NULL) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                direct_append_list_index_of_ref(&out, name, is_ref, base_type, rewritten_arg);
+                free(rewritten_arg);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(field);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (strcmp(field, "count") == 0) {
+                if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports count only on List<Int> and List<Str>",
+                        "use `xs.count(value)` on `List<Int>` or `words.count(value)` on `List<Str>`; scan other list element types in an explicit loop for now.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.count must be called",
+                        "write `words.count(value)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.count",
+                        "write `words.count(value)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.count expects one argument",
+                        "write `words.count(value)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                const char *expected_arg_type = direct_is_list_str_type(base_type) ? "Str" : "Int";
+                if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        direct_is_list_str_type(base_type) ?
+                            "direct native emitter List<Str>.count argument must be Str" :
+                            "direct native emitter List<Int>.count argument must be Int",
+                        direct_is_list_str_type(base_type) ?
+                            "pass a Str value to `words.count(value)`." :
+                            "pass an Int-compatible value to `xs.count(value)`.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                free(arg_type);
+                char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+                if (rewritten_arg == NULL) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                direct_append_list_count_ref(&out, name, is_ref, base_type, rewritten_arg);
+                free(rewritten_arg);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(field);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (strcmp(field, "remove_at") == 0) {
+                if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type) && !direct_is_list_struct_type(structs, struct_count, base_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports remove_at only on List<Int>, List<Str>, and List<Struct>",
+                        "use `xs.remove_at(index)` on a verified direct-engine list type.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.remove_at must be called",
+                        "write `xs.remove_at(index)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.remove_at",
+                        "write `xs.remove_at(index)`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.remove_at expects one index argument",
+                        "write `xs.remove_at(index)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_map_arg_type_compatible("Int", arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.remove_at index must be Int",
+                        "pass an Int-compatible index to `xs.remove_at(index)`.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                free(arg_type);
+                char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+                if (rewritten_arg == NULL) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int next_i = close + 1;
+                int len_chain = 0;
+                char *flatten_field = NULL;
+                if (direct_is_list_str_type(base_type)) {
+                    if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports only `.len()` after List<Str>.remove_at(index)",
+                            "write `words.remove_at(index).len()` or bind the string to a local first.",
+                            NULL);
+                        free(rewritten_arg);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                } else {
+                    char *elem_type = direct_list_element_type(base_type);
+                    DirectStructInfo *elem_st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+                    if (!direct_parse_flattened_nested_struct_tail(path, line_no, line, expr, close + 1, elem_st, structs, struct_count, &flatten_field, &next_i, &len_chain)) {
+                        free(elem_type);
+                        free(rewritten_arg);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                    free(elem_type);
+                }
+                if (len_chain) sb_append(&out, "__vais_str_len(");
+                direct_append_list_remove_at_ref(&out, name, is_ref, base_type, rewritten_arg, locals);
+                if (flatten_field != NULL) {
+                    sb_append(&out, ".");
+                    sb_append(&out, flatten_field);
+                    free(flatten_field);
+                }
+                if (len_chain) sb_append(&out, ")");
+                free(rewritten_arg);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(field);
+                free(name);
+                i = next_i;
+                continue;
+            }
+            if (strcmp(field, "first") == 0) {
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.first must be called",
+                        "write `xs.first()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.first",
+                        "write `xs.first()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *trimmed_args = trim_copy(args);
+                int has_args = trimmed_args[0] != '\0';
+                free(trimmed_args);
+                free(args);
+                if (has_args) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.first takes no arguments",
+                        "write `xs.first()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *elem_type = direct_list_element_type(base_type);
+                int next_i = close + 1;
+                int len_chain = 0;
+                char *flatten_field = NULL;
+                if (direct_is_str_type(elem_type)) {
+                    if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports only `.len()` after List<Str>.first()",
+                            "write `words.first().len()` or bind the string to a local first.",
+                            NULL);
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                } else {
+                    DirectStructInfo *elem_st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+                    if (!direct_parse_flattened_nested_struct_tail(path, line_no, line, expr, close + 1, elem_st, structs, struct_count, &flatten_field, &next_i, &len_chain)) {
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                }
+                free(elem_type);
+                if (len_chain) sb_append(&out, "__vais_str_len(");
+                direct_append_list_first_ref(&out, name, is_ref);
+                if (flatten_field != NULL) {
+                    sb_append(&out, ".");
+                    sb_append(&out, flatten_field);
+                    free(flatten_field);
+                }
+                if (len_chain) sb_append(&out, ")");
+                free(field);
+                free(name);
+                i = next_i;
+                continue;
+            }
+            if (strcmp(field, "last") == 0) {
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.last must be called",
+                        "write `xs.last()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.last",
+                        "write `xs.last()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *trimmed_args = trim_copy(args);
+                int has_args = trimmed_args[0] != '\0';
+                free(trimmed_args);
+                free(args);
+                if (has_args) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.last takes no arguments",
+                        "write `xs.last()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *elem_type = direct_list_element_type(base_type);
+                int next_i = close + 1;
+                int len_chain = 0;
+                char *flatten_field = NULL;
+                if (direct_is_str_type(elem_type)) {
+                    if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports only `.len()` after List<Str>.last()",
+                            "write `words.last().len()` or bind the string to a local first.",
+                            NULL);
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                } else {
+                    DirectStructInfo *elem_st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+                    if (!direct_parse_flattened_nested_struct_tail(path, line_no, line, expr, close + 1, elem_st, structs, struct_count, &flatten_field, &next_i, &len_chain)) {
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                }
+                free(elem_type);
+                if (len_chain) sb_append(&out, "__vais_str_len(");
+                direct_append_list_last_ref(&out, name, is_ref);
+                if (flatten_field != NULL) {
+                    sb_append(&out, ".");
+                    sb_append(&out, flatten_field);
+                    free(flatten_field);
+                }
+                if (len_chain) sb_append(&out, ")");
+                free(field);
+                free(name);
+                i = next_i;
+                continue;
+            }
+            if (strcmp(field, "pop") == 0) {
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.pop must be called",
+                        "write `xs.pop()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List.pop",
+                        "write `xs.pop()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *trimmed_args = trim_copy(args);
+                int has_args = trimmed_args[0] != '\0';
+                free(trimmed_args);
+                free(args);
+                if (has_args) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List.pop takes no arguments",
+                        "write `xs.pop()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *elem_type = direct_list_element_type(base_type);
+                int next_i = close + 1;
+                int len_chain = 0;
+                char *flatten_field = NULL;
+                if (direct_is_str_type(elem_type)) {
+                    if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports only `.len()` after List<Str>.pop()",
+                            "write `words.pop().len()` or bind the string to a local first.",
+                            NULL);
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                } else {
+                    DirectStructInfo *elem_st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+                    if (!direct_parse_flattened_nested_struct_tail(path, line_no, line, expr, close + 1, elem_st, structs, struct_count, &flatten_field, &next_i, &len_chain)) {
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(out.data);
+                        return NULL;
+                    }
+                }
+                free(elem_type);
+                if (len_chain) sb_append(&out, "__vais_str_len(");
+                direct_append_list_pop_ref(&out, name, is_ref, base_type, locals);
+                if (flatten_field != NULL) {
+                    sb_append(&out, ".");
+                    sb_append(&out, flatten_field);
+                    free(flatten_field);
+                }
+                if (len_chain) sb_append(&out, ")");
+                free(field);
+                free(name);
+                i = next_i;
+                continue;
+            }
+            if (strcmp(field, "sum") == 0) {
+                if (!direct_is_list_int_type(base_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports sum only on List<Int>",
+                        "read struct list fields explicitly before summing.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List<Int>.sum must be called",
+                        "write `xs.sum()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List<Int>.sum",
+                        "write `xs.sum()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *trimmed_args = trim_copy(args);
+                int has_args = trimmed_args[0] != '\0';
+                free(trimmed_args);
+                free(args);
+                if (has_args) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List<Int>.sum takes no arguments",
+                        "write `xs.sum()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                direct_append_list_sum_ref(&out, name, is_ref);
+                free(field);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (strcmp(field, "max") == 0) {
+                if (!direct_is_list_int_type(base_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports max only on List<Int>",
+                        "read struct list fields explicitly before taking a maximum.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List<Int>.max must be called",
+                        "write `xs.max()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List<Int>.max",
+                        "write `xs.max()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *trimmed_args = trim_copy(args);
+                int has_args = trimmed_args[0] != '\0';
+                free(trimmed_args);
+                free(args);
+                if (has_args) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List<Int>.max takes no arguments",
+                        "write `xs.max()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                direct_append_list_max_ref(&out, name, is_ref);
+                free(field);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (strcmp(field, "min") == 0) {
+                if (!direct_is_list_int_type(base_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports min only on List<Int>",
+                        "read struct list fields explicitly before taking a minimum.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                if (*after != '(') {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List<Int>.min must be called",
+                        "write `xs.min()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                int close = find_matching_paren_c(expr, (int)(after - expr));
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` after List<Int>.min",
+                        "write `xs.min()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                char *args = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                char *trimmed_args = trim_copy(args);
+                int has_args = trimmed_args[0] != '\0';
+                free(trimmed_args);
+                free(args);
+                if (has_args) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List<Int>.min takes no arguments",
+                        "write `xs.min()`.",
+                        NULL);
+                    free(field);
+                    free(name);
+                    free(out.data);
+                    return NULL;
+                }
+                direct_append_list_min_ref(&out, name, is_ref);
+                free(field);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter supports List len, is_empty, first, last, pop, remove_at, index, List<Int>/List<Str> contains/index_of/count, and List<Int> sum/max/min expressions",
+                "write `xs.len()`, `xs.is_empty()`, `xs.first()`, `xs.last()`, `xs.pop()`, `xs.remove_at(index)`, `xs[i]`, `xs.contains(value)`, `xs.index_of(value)`, `xs.count(value)`, `xs.sum()`, `xs.max()`, or `xs.min()` for List<Int>; `words.first()`, `words.remove_at(index)`, `words.contains(value)`, `words.index_of(value)`, and `words.count(value)` are verified for List<Str>.",
+                NULL);
+            free(field);
+            free(name);
+            free(out.data);
+            return NULL;
+        }
+
+        sb_append_n(&out, expr + start, (size_t)(i - start));
+        free(name);
+    }
+    return sb_take(&out);
+}
+
+static char *direct_rewrite_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    char *if_cond = NULL;
+    char *if_then = NULL;
+    char *if_else = NULL;
+    if (direct_parse_if_expr_parts(expr, &if_cond, &if_then, &if_else)) {
+        char *rewritten_cond = direct_rewrite_expr(path, line_no, line, if_cond, locals, fns, fn_count, structs, struct_count);
+        char *rewritten_then = rewritten_cond == NULL ? NULL : direct_rewrite_expr(path, line_no, line, if_then, locals, fns, fn_count, structs, struct_count);
+        char *rewritten_else = rewritten_then == NULL ? NULL : direct_rewrite_expr(path, line_no, line, if_else, locals, fns, fn_count, structs, struct_count);
+        free(if_cond);
+        free(if_then);
+        free(if_else);
+        if (rewritten_cond == NULL || rewritten_then == NULL || rewritten_else == NULL) {
+            free(rewritten_cond);
+            free(rewritten_then);
+            free(rewritten_else);
+            return NULL;
+        }
+        StrBuf out;
+        sb_init(&out);
+        sb_append(&out, "(");
+        sb_append(&out, rewritten_cond);
+        sb_append(&out, " ? ");
+        sb_append(&out, rewritten_then);
+        sb_append(&out, " : ");
+        sb_append(&out, rewritten_else);
+        sb_append(&out, ")");
+        free(rewritten_cond);
+        free(rewritten_then);
+        free(rewritten_else);
+        return sb_take(&out);
+    }
+    char *struct_rewritten = direct_rewrite_struct_literals(path, line_no, line, expr, structs, struct_count);
+    if (struct_rewritten == NULL) return NULL;
+    char *eq_rewritten = direct_rewrite_str_equality_expr(path, line_no, line, struct_rewritten, locals, fns, fn_count, structs, struct_count);
+    if (eq_rewritten != NULL) {
+        free(struct_rewritten);
+        return eq_rewritten;
+    }
+    char *list_rewritten = direct_rewrite_list_expr(path, line_no, line, struct_rewritten, locals, fns, fn_count, structs, struct_count);
+    free(struct_rewritten);
+    if (list_rewritten == NULL) return NULL;
+    char *parse_rewritten = direct_rewrite_parse_builtin_calls(path, line_no, line, list_rewritten, locals, fns, fn_count, structs, struct_count);
+    free(list_rewritten);
+    if (parse_rewritten == NULL) return NULL;
+    char *conversion_rewritten = direct_rewrite_str_conversion_calls(path, line_no, line, parse_rewritten, locals, fns, fn_count, structs, struct_count);
+    free(parse_rewritten);
+    if (conversion_rewritten == NULL) return NULL;
+    char *option_result_rewritten = direct_rewrite_option_result_constructors(path, line_no, line, conversion_rewritten, locals, fns, fn_count, structs, struct_count);
+    free(conversion_rewritten);
+    if (option_result_rewritten == NULL) return NULL;
+    char *nested_rewritten = direct_rewrite_nested_struct_field_chains(path, line_no, line, option_result_rewritten, locals, fns, fn_count, structs, struct_count);
+    free(option_result_rewritten);
+    if (nested_rewritten == NULL) return NULL;
+    char *string_rewritten = direct_rewrite_string_literals(path, line_no, line, nested_rewritten);
+    free(nested_rewritten);
+    return string_rewritten;
+}
+
+static char *direct_infer_expr_type(
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (direct_expr_is_string_literal(trimmed)) {
+        free(trimmed);
+        return strdup("Str");
+    }
+    if (direct_expr_is_char_literal(trimmed)) {
+        free(trimmed);
+        return strdup("Char");
+    }
+    if (direct_is_none_constructor_expr(trimmed)) {
+        free(trimmed);
+        return strdup("Option<Int>");
+    }
+    if (direct_is_list_initializer_expr(trimmed)) {
+        free(trimmed);
+        return strdup("List<Int>");
+    }
+    if (strcmp(s, "true") == 0 || strcmp(s, "false") == 0) {
+        free(trimmed);
+        return strdup("Bool");
+    }
+    char *if_cond = NULL;
+    char *if_then = NULL;
+    char *if_else = NULL;
+    if (direct_parse_if_expr_parts(s, &if_cond, &if_then, &if_else)) {
+        char *then_type = direct_infer_expr_type(if_then, locals, fns, fn_count, structs, struct_count);
+        char *else_type = direct_infer_expr_type(if_else, locals, fns, fn_count, structs, struct_count);
+        char *out = NULL;
+        if (then_type != NULL && else_type != NULL && strcmp(then_type, else_type) == 0) {
+            out = strdup(then_type);
+        } else if (direct_is_intlike_scalar_type(then_type) && direct_is_intlike_scalar_type(else_type)) {
+            out = strdup("Int");
+        } else if (then_type != NULL && else_type != NULL && direct_type_compatible(then_type, else_type)) {
+            out = strdup(then_type);
+        } else {
+            out = strdup("Int");
+        }
+        free(if_cond);
+        free(if_then);
+        free(if_else);
+        free(then_type);
+        free(else_type);
+        free(trimmed);
+        return out;
+    }
+    if (*s == '&') {
+        const char *ref = skip_ws(s + 1);
+        if (is_ident_start(*ref)) {
+            const char *name_start = ref;
+            ref++;
+            while (is_ident_continue(*ref)) ref++;
+            char *name = substr_copy(name_start, (size_t)(ref - name_start));
+            if (*skip_ws(ref) == '\0') {
+                const char *local_type = direct_names_type(locals, name);
+                if (local_type != NULL) {
+                    char *out = strdup(local_type);
+                    free(name);
+                    free(trimmed);
+                    return out;
+                }
+            }
+            free(name);
+        }
+    }
+    if (is_ident_start(*s)) {
+        const char *name_start = s;
+        s++;
+        while (is_ident_continue(*s)) s++;
+        char *name = substr_copy(name_start, (size_t)(s - name_start));
+        const char *rest = skip_ws(s);
+        if (*rest == '\0') {
+            const char *local_type = direct_names_type(locals, name);
+            if (local_type != NULL) {
+                char *out = strdup(local_type);
+                free(name);
+                free(trimmed);
+                return out;
+            }
+        }
+        if (*rest == '[') {
+            int close = find_matching_bracket_c(trimmed, (int)(rest - trimmed));
+            if (close >= 0) {
+                const char *local_type = direct_names_type(locals, name);
+                if (direct_is_str_type(local_type)) {
+                    if (*skip_ws(trimmed + close + 1) == '\0') {
+                        free(name);
+                        free(trimmed);
+                        return strdup("Int");
+                    }
+                }
+                char *elem_type = direct_list_element_type(local_type);
+                if (elem_type != NULL) {
+                    if (*skip_ws(trimmed + close + 1) == '\0') {
+                        free(name);
+                        free(trimmed);
+                        return elem_type;
+                    }
+                    DirectStructInfo *elem_st = direct_find_struct(structs, struct_count, elem_type);
+                    char *tail_type = direct_infer_struct_tail_type(trimmed, close + 1, elem_st, structs, struct_count);
+                    if (tail_type != NULL) {
+                        free(elem_type);
+                        free(name);
+                        free(trimmed);
+                        return tail_type;
+                    }
+                    int next_i = close + 1;
+                    int len_chain = 0;
+                    int ok_len = direct_is_str_type(elem_type) &&
+                        direct_parse_trailing_str_len(trimmed, close + 1, &next_i, &len_chain) &&
+                        len_chain &&
+                        *skip_ws(trimmed + next_i) == '\0';
+                    free(elem_type);
+                    if (ok_len) {
+                        free(name);
+                        free(trimmed);
+                        return strdup("Int");
+                    }
+                }
+            }
+        }
+        if (*rest == '.') {
+            int field_start = (int)(rest - trimmed) + 1;
+            while (trimmed[field_start] == ' ' || trimmed[field_start] == '\t') field_start++;
+            int field_end = field_start;
+            while (is_ident_continue(trimmed[field_end])) field_end++;
+            char *field = substr_copy(trimmed + field_start, (size_t)(field_end - field_start));
+            const char *after = skip_ws(trimmed + field_end);
+            const char *local_type = direct_names_type(locals, name);
+            if (direct_is_str_type(local_type) && strcmp(field, "len") == 0) {
+                if (*after == '\0') {
+                    free(field);
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (*after == '(') {
+                    int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                    if (close >= 0 && *skip_ws(trimmed + close + 1) == '\0') {
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return strdup("Int");
+                    }
+                }
+            }
+            if (direct_is_list_type(local_type) && (strcmp(field, "first") == 0 || strcmp(field, "last") == 0 || strcmp(field, "pop") == 0) && *after == '(') {
+                int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                if (close >= 0) {
+                    char *elem_type = direct_list_element_type(local_type);
+                    if (*skip_ws(trimmed + close + 1) == '\0') {
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return elem_type;
+                    }
+                    DirectStructInfo *elem_st = direct_find_struct(structs, struct_count, elem_type);
+                    char *tail_type = direct_infer_struct_tail_type(trimmed, close + 1, elem_st, structs, struct_count);
+                    if (tail_type != NULL) {
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return tail_type;
+                    }
+                    int next_i = close + 1;
+                    int len_chain = 0;
+                    int ok_len = direct_is_str_type(elem_type) &&
+                        direct_parse_trailing_str_len(trimmed, close + 1, &next_i, &len_chain) &&
+                        len_chain &&
+                        *skip_ws(trimmed + next_i) == '\0';
+                    free(elem_type);
+                    if (ok_len) {
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return strdup("Int");
+                    }
+                }
+            }
+            if ((direct_is_list_int_type(local_type) || direct_is_list_str_type(local_type)) && strcmp(field, "contains") == 0 && *after == '(') {
+                int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                if (close >= 0 && *skip_ws(trimmed + close + 1) == '\0') {
+                    free(field);
+                    free(name);
+                    free(trimmed);
+                    return strdup("Bool");
+                }
+            }
+            if ((direct_is_list_int_type(local_type) || direct_is_list_str_type(local_type)) && strcmp(field, "index_of") == 0 && *after == '(') {
+                int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                if (close >= 0 && *skip_ws(trimmed + close + 1) == '\0') {
+                    free(field);
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+            }
+            if ((direct_is_list_int_type(local_type) || direct_is_list_str_type(local_type)) && strcmp(field, "count") == 0 && *after == '(') {
+                int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                if (close >= 0 && *skip_ws(trimmed + close + 1) == '\0') {
+                    free(field);
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+            }
+            if (direct_is_list_type(local_type) && strcmp(field, "remove_at") == 0 && *after == '(') {
+                int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                if (close >= 0) {
+                    char *elem_type = direct_list_element_type(local_type);
+                    if (*skip_ws(trimmed + close + 1) == '\0') {
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return elem_type;
+                    }
+                    DirectStructInfo *elem_st = direct_find_struct(structs, struct_count, elem_type);
+                    char *tail_type = direct_infer_struct_tail_type(trimmed, close + 1, elem_st, structs, struct_count);
+                    if (tail_type != NULL) {
+                        free(elem_type);
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return tail_type;
+                    }
+                    int next_i = close + 1;
+                    int len_chain = 0;
+                    int ok_len = direct_is_str_type(elem_type) &&
+                        direct_parse_trailing_str_len(trimmed, close + 1, &next_i, &len_chain) &&
+                        len_chain &&
+                        *skip_ws(trimmed + next_i) == '\0';
+                    free(elem_type);
+                    if (ok_len) {
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return strdup("Int");
+                    }
+                }
+            }
+            if (direct_is_map_type(local_type)) {
+                if (strcmp(field, "get") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                    if (close >= 0) {
+                        const char *value_type = direct_map_value_type(local_type);
+                        if (*skip_ws(trimmed + close + 1) == '\0') {
+                            free(field);
+                            free(name);
+                            free(trimmed);
+                            return strdup(value_type == NULL ? "Int" : value_type);
+                        }
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (direct_is_str_type(value_type) &&
+                            direct_parse_trailing_str_len(trimmed, close + 1, &next_i, &len_chain) &&
+                            len_chain &&
+                            *skip_ws(trimmed + next_i) == '\0') {
+                            free(field);
+                            free(name);
+                            free(trimmed);
+                            return strdup("Int");
+                        }
+                    }
+                }
+                if ((strcmp(field, "get_opt") == 0 || strcmp(field, "len") == 0) && *after == '(') {
+                    int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                    if (close >= 0 && *skip_ws(trimmed + close + 1) == '\0') {
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return strdup("Int");
+                    }
+                }
+                if (strcmp(field, "contains") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                    if (close >= 0 && *skip_ws(trimmed + close + 1) == '\0') {
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return strdup("Bool");
+                    }
+                }
+                if (strcmp(field, "key_at") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                    if (close >= 0) {
+                        const char *key_type = direct_map_key_type(local_type);
+                        if (*skip_ws(trimmed + close + 1) == '\0') {
+                            free(field);
+                            free(name);
+                            free(trimmed);
+                            return strdup(key_type == NULL ? "Int" : key_type);
+                        }
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (direct_is_str_type(key_type) &&
+                            direct_parse_trailing_str_len(trimmed, close + 1, &next_i, &len_chain) &&
+                            len_chain &&
+                            *skip_ws(trimmed + next_i) == '\0') {
+                            free(field);
+                            free(name);
+                            free(trimmed);
+                            return strdup("Int");
+                        }
+                    }
+                }
+                if (strcmp(field, "value_at") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(trimmed, (int)(after - trimmed));
+                    if (close >= 0) {
+                        const char *value_type = direct_map_value_type(local_type);
+                        if (*skip_ws(trimmed + close + 1) == '\0') {
+                            free(field);
+                            free(name);
+                            free(trimmed);
+                            return strdup(value_type == NULL ? "Int" : value_type);
+                        }
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (direct_is_str_type(value_type) &&
+                            direct_parse_trailing_str_len(trimmed, close + 1, &next_i, &len_chain) &&
+                            len_chain &&
+                            *skip_ws(trimmed + next_i) == '\0') {
+                            free(field);
+                            free(name);
+                            free(trimmed);
+                            return strdup("Int");
+                        }
+                    }
+                }
+            }
+            DirectStructInfo *st = local_type == NULL ? NULL : direct_find_struct(structs, struct_count, local_type);
+            if (st != NULL) {
+                char *tail_type = direct_infer_struct_tail_type(trimmed, (int)(rest - trimmed), st, structs, struct_count);
+                if (tail_type != NULL) {
+                    free(field);
+                    free(name);
+                    free(trimmed);
+                    return tail_type;
+                }
+                const char *field_type = direct_struct_field_type(st, field);
+                if (field_type != NULL) {
+                    if (*after == '\0') {
+                        char *out = strdup(field_type);
+                        free(field);
+                        free(name);
+                        free(trimmed);
+                        return out;
+                    }
+                    if (*after == '.') {
+                        DirectStructInfo *nested = direct_find_struct(structs, struct_count, field_type);
+                        int nested_start = (int)(after - trimmed) + 1;
+                        while (trimmed[nested_start] == ' ' || trimmed[nested_start] == '\t') nested_start++;
+                        int nested_end = nested_start;
+                        while (is_ident_continue(trimmed[nested_end])) nested_end++;
+                        char *nested_field = substr_copy(trimmed + nested_start, (size_t)(nested_end - nested_start));
+                        const char *nested_type = nested == NULL ? NULL : direct_struct_field_type(nested, nested_field);
+                        int ok = nested_type != NULL && *skip_ws(trimmed + nested_end) == '\0';
+                        free(nested_field);
+                        if (ok) {
+                            char *out = strdup(nested_type);
+                            free(field);
+                            free(name);
+                            free(trimmed);
+                            return out;
+                        }
+                    }
+                }
+            }
+            free(field);
+        }
+        if (*rest == '{' && direct_find_struct(structs, struct_count, name) != NULL) {
+            char *out = strdup(name);
+            free(name);
+            free(trimmed);
+            return out;
+        }
+        if (*rest == '(') {
+            int close = find_matching_paren_c(trimmed, (int)(rest - trimmed));
+            if (close >= 0) {
+                int next_i = close + 1;
+                int len_chain = 0;
+                int helper_returns_str =
+                    direct_is_str_slice_builtin_name(name) ||
+                    direct_is_str_concat_builtin_name(name) ||
+                    direct_is_str_join_builtin_name(name) ||
+                    direct_is_str_replace_builtin_name(name) ||
+                    direct_is_str_trim_builtin_name(name) ||
+                    direct_is_str_lower_builtin_name(name) ||
+                    direct_is_str_upper_builtin_name(name) ||
+                    direct_is_str_byte_builtin_name(name) ||
+                    direct_is_str_conversion_builtin_name(name) ||
+                    direct_is_fs_read_text_builtin_name(name) ||
+                    direct_is_str_builder_finish_builtin_name(name) ||
+                    direct_is_arena_keep_builtin_name(name) ||
+                    direct_is_fs_temp_dir_builtin_name(name) ||
+                    direct_is_stdin_read_all_builtin_name(name) ||
+                    direct_is_fs_cwd_builtin_name(name) ||
+                    direct_is_path_join_builtin_name(name) ||
+                    direct_is_path_basename_builtin_name(name) ||
+                    direct_is_path_dirname_builtin_name(name) ||
+                    direct_is_proc_arg_builtin_name(name) ||
+                    direct_is_map_str_str_snapshot_builtin_name(name) ||
+                    (direct_is_snap_builtin_name(name) && direct_snap_builtin_returns_str(name)) ||
+                    (direct_is_fs_stream_builtin_name(name) && direct_fs_stream_builtin_returns_str(name));
+                if (helper_returns_str &&
+                    direct_parse_trailing_str_len(trimmed, close + 1, &next_i, &len_chain) &&
+                    len_chain &&
+                    *skip_ws(trimmed + next_i) == '\0') {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+            }
+            if (close >= 0 && *skip_ws(trimmed + close + 1) == '\0') {
+                if (direct_is_some_constructor_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Option<Int>");
+                }
+                if (direct_is_ok_constructor_name(name) || direct_is_err_constructor_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Result<Int,Int>");
+                }
+                if (direct_is_parse_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_str_contains_builtin_name(name) || direct_is_str_cmp_builtin_name(name) || direct_is_str_index_of_builtin_name(name) || direct_is_str_starts_with_builtin_name(name) || direct_is_str_ends_with_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_str_slice_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_concat_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_join_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_replace_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_trim_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_lower_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_upper_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_byte_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_fs_read_text_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_builder_new_builtin_name(name) || direct_is_str_builder_push_builtin_name(name) || direct_is_str_builder_append_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_str_builder_finish_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_stdin_read_all_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_proc_self_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_stdout_write_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_stderr_write_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_fs_exists_builtin_name(name) || direct_is_fs_is_dir_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_fs_mkdirs_builtin_name(name) || direct_is_fs_remove_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_fs_write_text_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_fs_temp_dir_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_fs_cwd_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_path_join_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_path_basename_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_path_dirname_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_time_millis_builtin_name(name) || direct_is_time_nanos_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_index_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_snap_builtin_name(name)) {
+                    int str_result = direct_snap_builtin_returns_str(name);
+                    free(name);
+                    free(trimmed);
+                    return strdup(str_result ? "Str" : "Int");
+                }
+                if (direct_is_par_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_fs_stream_builtin_name(name)) {
+                    int str_result = direct_fs_stream_builtin_returns_str(name);
+                    free(name);
+                    free(trimmed);
+                    return strdup(str_result ? "Str" : "Int");
+                }
+                if (direct_is_str_arena_builtin_name(name)) {
+                    int keep = direct_is_arena_keep_builtin_name(name);
+                    free(name);
+                    free(trimmed);
+                    return strdup(keep ? "Str" : "Int");
+                }
+                if (direct_is_proc_argc_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_proc_arg_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_str_split_ws_into_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_str_split_lines_into_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_fs_list_files_builtin_name(name) || direct_is_fs_list_dirs_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_str_split_into_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_map_str_str_snapshot_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_map_str_str_load_snapshot_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_doc_term_counts_into_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_doc_term_overlap_score_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_doc_term_weighted_score_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_str_conversion_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Str");
+                }
+                if (direct_is_proc_run_builtin_name(name) || direct_is_proc_run_env_builtin_name(name) ||
+                    direct_is_proc_spawn_builtin_name(name) || direct_is_proc_spawn_to_builtin_name(name) ||
+                    direct_is_proc_wait_builtin_name(name)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("Int");
+                }
+                if (direct_is_proc_capture_builtin_name(name) && direct_has_process_result_struct(structs, struct_count)) {
+                    free(name);
+                    free(trimmed);
+                    return strdup("ProcessResult");
+                }
+                DirectFnInfo *fn = direct_find_fn(fns, fn_count, name);
+                if (fn != NULL) {
+                    char *out = strdup(fn->return_type);
+                    free(name);
+                    free(trimmed);
+                    return out;
+                }
+            }
+        }
+        free(name);
+    }
+    free(trimmed);
+    return strdup("Int");
+}
+
+static int direct_is_keyword(const char *name) {
+    return strcmp(name, "fn") == 0 || strcmp(name, "return") == 0 ||
+        strcmp(name, "let") == 0 || strcmp(name, "mut") == 0 ||
+        strcmp(name, "if") == 0 || strcmp(name, "else") == 0 ||
+        strcmp(name, "while") == 0 || strcmp(name, "for") == 0 ||
+        strcmp(name, "break") == 0 || strcmp(name, "continue") == 0 ||
+        strcmp(name, "in") == 0 || strcmp(name, "Int") == 0 ||
+        strcmp(name, "Str") == 0 || strcmp(name, "Bool") == 0 ||
+        strcmp(name, "Char") == 0 ||
+        strcmp(name, "true") == 0 || strcmp(name, "false") == 0 ||
+        strcmp(name, "and") == 0 || strcmp(name, "or") == 0 ||
+        strcmp(name, "not") == 0;
+}
+
+static int direct_check_expr_inner(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    const char *allowed_list_type
+) {
+    if (allowed_list_type != NULL) {
+        char *allowed_list_elem_type = direct_list_element_type(allowed_list_type);
+        if (allowed_list_elem_type == NULL) return 1;
+        char *items[16] = {0};
+        int item_count = 0;
+        int literal_state = direct_parse_list_initializer_items(expr, items, 16, &item_count);
+        if (literal_state < 0) {
+            report_issue(path, line_no, find_col(line, "List"), line,
+                "direct native emitter supports up to 16 List literal items",
+                "bind a local list and call `push` for larger direct-engine lists.",
+                NULL);
+            for (int k = 0; k < 16; k++) free(items[k]);
+            free(allowed_list_elem_type);
+            return 1;
+        }
+        if (literal_state == 1) {
+            for (int item = 0; item < item_count; item++) {
+                if (direct_check_expr_inner(path, line_no, line, items[item], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = item; k < 16; k++) free(items[k]);
+                    free(allowed_list_elem_type);
+                    return 1;
+                }
+                char *item_type = direct_infer_expr_type(items[item], locals, fns, fn_count, structs, struct_count);
+                if (strcmp(item_type, allowed_list_elem_type) != 0) {
+                    report_issue(path, line_no, find_col(line, "List"), line,
+                        "direct native emitter list literal item type does not match the expected list element type",
+                        "use items with the element type declared by the surrounding list.",
+                        NULL);
+                    free(item_type);
+                    for (int k = item; k < 16; k++) free(items[k]);
+                    free(allowed_list_elem_type);
+                    return 1;
+                }
+                free(item_type);
+                free(items[item]);
+            }
+            free(allowed_list_elem_type);
+            return 0;
+        }
+        free(allowed_list_elem_type);
+    }
+    char *if_cond = NULL;
+    char *if_then = NULL;
+    char *if_else = NULL;
+    if (direct_parse_if_expr_parts(expr, &if_cond, &if_then, &if_else)) {
+        if (direct_check_expr_inner(path, line_no, line, if_cond, locals, fns, fn_count, structs, struct_count, NULL)) {
+            free(if_cond);
+            free(if_then);
+            free(if_else);
+            return 1;
+        }
+        char *cond_type = direct_infer_expr_type(if_cond, locals, fns, fn_count, structs, struct_count);
+        if (!direct_is_intlike_scalar_type(cond_type)) {
+            report_issue(path, line_no, find_col(line, "if"), line,
+                "direct native emitter if-expression condition must be Int-compatible",
+                "use an Int, Bool, or Char expression before `then`.",
+                NULL);
+            free(cond_type);
+            free(if_cond);
+            free(if_then);
+            free(if_else);
+            return 1;
+        }
+        free(cond_type);
+        if (direct_check_expr_inner(path, line_no, line, if_then, locals, fns, fn_count, structs, struct_count, NULL) ||
+            direct_check_expr_inner(path, line_no, line, if_else, locals, fns, fn_count, structs, struct_count, NULL)) {
+            free(if_cond);
+            free(if_then);
+            free(if_else);
+            return 1;
+        }
+        char *then_type = direct_infer_expr_type(if_then, locals, fns, fn_count, structs, struct_count);
+        char *else_type = direct_infer_expr_type(if_else, locals, fns, fn_count, structs, struct_count);
+        int compatible = direct_type_compatible(then_type, else_type) || direct_type_compatible(else_type, then_type);
+        if (!compatible) {
+            report_issue(path, line_no, find_col(line, "then"), line,
+                "direct native emitter if-expression branches must have compatible types",
+                "return the same concrete type from both `then` and `else`, or use Int-compatible scalar branches.",
+                NULL);
+            free(then_type);
+            free(else_type);
+            free(if_cond);
+            free(if_then);
+            free(if_else);
+            return 1;
+        }
+        free(then_type);
+        free(else_type);
+        free(if_cond);
+        free(if_then);
+        free(if_else);
+        return 0;
+    }
+    for (int i = 0; expr[i] != '\0';) {
+        if (is_string_delim_c(expr[i])) {
+            int end = skip_string_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an unterminated string literal",
+                    "close the string before the end of the line.",
+                    NULL);
+                return 1;
+            }
+            i = end;
+            continue;
+        }
+        if (expr[i] == '\'') {
+            int end = skip_char_literal_c(expr, i);
+            if (end < 0) {
+                report_issue(path, line_no, 1, line,
+                    "direct native emitter found an invalid char literal",
+                    "write a single-byte character literal such as `'A'`.",
+                    NULL);
+                return 1;
+            }
+            i = end;
+            continue;
+        }
+        if (!is_ident_start(expr[i])) {
+            i++;
+            continue;
+        }
+        int prev = i - 1;
+        while (prev >= 0 && (expr[prev] == ' ' || expr[prev] == '\t')) prev--;
+        if (prev >= 0 && expr[prev] == '.') {
+            i++;
+            while (is_ident_continue(expr[i])) i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(expr[i])) i++;
+        char *name = substr_copy(expr + start, (size_t)(i - start));
+        int cursor = i;
+        while (expr[cursor] == ' ' || expr[cursor] == '\t') cursor++;
+        if (expr[cursor] == ':') {
+            free(name);
+            i = cursor + 1;
+            continue;
+        }
+        if (expr[cursor] == '[') {
+            const char *base_type = direct_names_type(locals, name);
+            if (direct_is_list_type(base_type)) {
+                int close = find_matching_bracket_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `]` after List index",
+                        "write `xs[index]` with a valid Int index expression.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *index_expr = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                if (strlen(skip_ws(index_expr)) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List index cannot be empty",
+                        "write `xs[index]` with an Int index expression.",
+                        NULL);
+                    free(index_expr);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, index_expr, locals, fns, fn_count, structs, struct_count, NULL)) {
+                    free(index_expr);
+                    free(name);
+                    return 1;
+                }
+                char *index_type = direct_infer_expr_type(index_expr, locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_intlike_scalar_type(index_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter List index must be Int",
+                        "use an Int, Bool, or Char expression as the list index.",
+                        NULL);
+                    free(index_type);
+                    free(index_expr);
+                    free(name);
+                    return 1;
+                }
+                char *elem_type = direct_list_element_type(base_type);
+                int next_i = close + 1;
+                if (direct_is_str_type(elem_type)) {
+                    int len_chain = 0;
+                    if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports only `.len()` after List<Str> index expressions",
+                            "write `words[i].len()` or pass the string value directly.",
+                            NULL);
+                        free(elem_type);
+                        free(index_type);
+                        free(index_expr);
+                        free(name);
+                        return 1;
+                    }
+                }
+                free(elem_type);
+                free(index_type);
+                free(index_expr);
+                free(name);
+                i = next_i;
+                continue;
+            }
+        }
+        if (expr[cursor] == '.') {
+            int field_start = cursor + 1;
+            while (expr[field_start] == ' ' || expr[field_start] == '\t') field_start++;
+            int field_end = field_start;
+            while (is_ident_continue(expr[field_end])) field_end++;
+            char *field = substr_copy(expr + field_start, (size_t)(field_end - field_start));
+            const char *base_type = direct_names_type(locals, name);
+            if (direct_is_str_type(base_type)) {
+                const char *after = skip_ws(expr + field_end);
+                if (strcmp(field, "len") == 0) {
+                    if (*after == '(') {
+                        int close = find_matching_paren_c(expr, (int)(after - expr));
+                        if (close < 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter expected `)` after Str.len",
+                                "write `s.len()` or `s.len`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        i = close + 1;
+                    } else {
+                        i = field_end;
+                    }
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter supports Str len and index expressions",
+                    "write `s.len()` or `s[i]`.",
+                    NULL);
+                free(field);
+                free(name);
+                return 1;
+            }
+            if (direct_is_list_type(base_type)) {
+                const char *after = skip_ws(expr + field_end);
+                if (strcmp(field, "len") == 0) {
+                    if (*after == '(') {
+                        int close = find_matching_paren_c(expr, (int)(after - expr));
+                        if (close < 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter expected `)` after List<Int>.len",
+                                "write `xs.len()` or `xs.len`.",
+                                NULL);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        i = close + 1;
+                    } else {
+                        i = field_end;
+                    }
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "is_empty") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.is_empty",
+                            "write `xs.is_empty()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "contains") == 0 && *after == '(') {
+                    if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports contains only on List<Int> and List<Str>",
+                            "use `xs.contains(value)` on `List<Int>` or `words.contains(value)` on `List<Str>`; compare `List<Struct>` elements in an explicit loop for now.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.contains",
+                            "write `xs.contains(value)`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *args[16] = {0};
+                    int argc = split_top_level_commas_c(inside, args, 16);
+                    free(inside);
+                    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter List.contains expects one argument",
+                            "write `xs.contains(value)`.",
+                            NULL);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                    const char *expected_arg_type = direct_is_list_str_type(base_type) ? "Str" : "Int";
+                    if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            direct_is_list_str_type(base_type) ?
+                                "direct native emitter List<Str>.contains argument must be Str" :
+                                "direct native emitter List<Int>.contains argument must be Int",
+                            direct_is_list_str_type(base_type) ?
+                                "pass a Str value to `words.contains(value)`." :
+                                "pass an Int-compatible value to `xs.contains(value)`.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "index_of") == 0 && *after == '(') {
+                    if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports index_of only on List<Int> and List<Str>",
+                            "use `xs.index_of(value)` on `List<Int>` or `words.index_of(value)` on `List<Str>`; scan other list element types in an explicit loop for now.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.index_of",
+                            "write `words.index_of(value)`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *args[16] = {0};
+                    int argc = split_top_level_commas_c(inside, args, 16);
+                    free(inside);
+                    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter List.index_of expects one argument",
+                            "write `words.index_of(value)`.",
+                            NULL);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                    const char *expected_arg_type = direct_is_list_str_type(base_type) ? "Str" : "Int";
+                    if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            direct_is_list_str_type(base_type) ?
+                                "direct native emitter List<Str>.index_of argument must be Str" :
+                                "direct native emitter List<Int>.index_of argument must be Int",
+                            direct_is_list_str_type(base_type) ?
+                                "pass a Str value to `words.index_of(value)`." :
+                                "pass an Int-compatible value to `xs.index_of(value)`.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "count") == 0 && *after == '(') {
+                    if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports count only on List<Int> and List<Str>",
+                            "use `xs.count(value)` on `List<Int>` or `words.count(value)` on `List<Str>`; scan other list element types in an explicit loop for now.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.count",
+                            "write `words.count(value)`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *args[16] = {0};
+                    int argc = split_top_level_commas_c(inside, args, 16);
+                    free(inside);
+                    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter List.count expects one argument",
+                            "write `words.count(value)`.",
+                            NULL);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                    const char *expected_arg_type = direct_is_list_str_type(base_type) ? "Str" : "Int";
+                    if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            direct_is_list_str_type(base_type) ?
+                                "direct native emitter List<Str>.count argument must be Str" :
+                                "direct native emitter List<Int>.count argument must be Int",
+                            direct_is_list_str_type(base_type) ?
+                                "pass a Str value to `words.count(value)`." :
+                                "pass an Int-compatible value to `xs.count(value)`.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "remove_at") == 0 && *after == '(') {
+                    if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type) && !direct_is_list_struct_type(structs, struct_count, base_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports remove_at only on List<Int>, List<Str>, and List<Struct>",
+                            "use `xs.remove_at(index)` on a verified direct-engine list type.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.remove_at",
+                            "write `xs.remove_at(index)`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *args[16] = {0};
+                    int argc = split_top_level_commas_c(inside, args, 16);
+                    free(inside);
+                    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter List.remove_at expects one index argument",
+                            "write `xs.remove_at(index)`.",
+                            NULL);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                    if (!direct_map_arg_type_compatible("Int", arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter List.remove_at index must be Int",
+                            "pass an Int-compatible index to `xs.remove_at(index)`.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                    int next_i = close + 1;
+                    if (direct_is_list_str_type(base_type)) {
+                        int len_chain = 0;
+                        if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter supports only `.len()` after List<Str>.remove_at(index)",
+                                "write `words.remove_at(index).len()` or bind the string to a local first.",
+                                NULL);
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                    }
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    i = next_i;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "first") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.first",
+                            "write `xs.first()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    char *elem_type = direct_list_element_type(base_type);
+                    if (direct_is_str_type(elem_type)) {
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter supports only `.len()` after List<Str>.first()",
+                                "write `words.first().len()` or bind the string to a local first.",
+                                NULL);
+                            free(elem_type);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        if (len_chain) i = next_i;
+                    }
+                    free(elem_type);
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "last") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.last",
+                            "write `xs.last()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    char *elem_type = direct_list_element_type(base_type);
+                    if (direct_is_str_type(elem_type)) {
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter supports only `.len()` after List<Str>.last()",
+                                "write `words.last().len()` or bind the string to a local first.",
+                                NULL);
+                            free(elem_type);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        if (len_chain) i = next_i;
+                    }
+                    free(elem_type);
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "pop") == 0 && *after == '(') {
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List.pop",
+                            "write `xs.pop()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    char *elem_type = direct_list_element_type(base_type);
+                    if (direct_is_str_type(elem_type)) {
+                        int next_i = close + 1;
+                        int len_chain = 0;
+                        if (!direct_parse_trailing_str_len(expr, close + 1, &next_i, &len_chain)) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter supports only `.len()` after List<Str>.pop()",
+                                "write `words.pop().len()` or bind the string to a local first.",
+                                NULL);
+                            free(elem_type);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        if (len_chain) i = next_i;
+                    }
+                    free(elem_type);
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "sum") == 0 && *after == '(') {
+                    if (!direct_is_list_int_type(base_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports sum only on List<Int>",
+                            "read struct list fields explicitly before summing.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List<Int>.sum",
+                            "write `xs.sum()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "max") == 0 && *after == '(') {
+                    if (!direct_is_list_int_type(base_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports max only on List<Int>",
+                            "read struct list fields explicitly before taking a maximum.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List<Int>.max",
+                            "write `xs.max()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if (strcmp(field, "min") == 0 && *after == '(') {
+                    if (!direct_is_list_int_type(base_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter supports min only on List<Int>",
+                            "read struct list fields explicitly before taking a minimum.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after List<Int>.min",
+                            "write `xs.min()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter supports List push, len, is_empty, first, last, pop, remove_at, index, List<Int>/List<Str> contains/index_of/count, and List<Int> sum/max/min",
+                    "write `xs.push(value)`, `xs.len()`, `xs.is_empty()`, `xs.first()`, `xs.last()`, `xs.pop()`, `xs.remove_at(index)`, `xs[i]`, `xs.contains(value)`, `xs.index_of(value)`, `xs.count(value)`, `xs.sum()`, `xs.max()`, or `xs.min()` for List<Int>; `words.first()`, `words.remove_at(index)`, `words.contains(value)`, `words.index_of(value)`, and `words.count(value)` are verified for List<Str>.",
+                    "xs.push(value)");
+                free(field);
+                free(name);
+                return 1;
+            }
+            if (direct_is_map_type(base_type)) {
+                const char *after = skip_ws(expr + field_end);
+                if (strcmp(field, "len") == 0) {
+                    if (*after != '(') {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter Map.len must be called",
+                            "write `m.len()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after Map.len",
+                            "write `m.len()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *args_text = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *trimmed_args = trim_copy(args_text);
+                    int has_args = trimmed_args[0] != '\0';
+                    free(trimmed_args);
+                    free(args_text);
+                    if (has_args) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter Map.len takes no arguments",
+                            "write `m.len()`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if ((strcmp(field, "contains") == 0 || strcmp(field, "get") == 0 || strcmp(field, "get_opt") == 0) && *after == '(') {
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after Map method",
+                            "write `m.contains(key)`, `m.get(key, default)`, or `m.get_opt(key)`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *args[16] = {0};
+                    int argc = split_top_level_commas_c(inside, args, 16);
+                    free(inside);
+                    int expected = strcmp(field, "get") == 0 ? 2 : 1;
+                    if (argc != expected) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter Map method argument count does not match",
+                            "write `m.contains(key)`, `m.get(key, default)`, or `m.get_opt(key)`.",
+                            NULL);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    for (int a = 0; a < argc; a++) {
+                        if (args[a] == NULL || strlen(skip_ws(args[a])) == 0) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter Map arguments cannot be empty",
+                                "pass key/value expressions to the Map method.",
+                                NULL);
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, NULL)) {
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+                        const char *expected_arg_type = a == 0 ? direct_map_key_type(base_type) : direct_map_value_type(base_type);
+                        if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter Map arguments must match key/value types",
+                                "use a key and value matching the Map's concrete key/value types.",
+                                NULL);
+                            free(arg_type);
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(field);
+                            free(name);
+                            return 1;
+                        }
+                        free(arg_type);
+                    }
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                if ((strcmp(field, "key_at") == 0 || strcmp(field, "value_at") == 0) && *after == '(') {
+                    int close = find_matching_paren_c(expr, (int)(after - expr));
+                    if (close < 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter expected `)` after Map entry method",
+                            "write `m.key_at(index)` or `m.value_at(index)`.",
+                            NULL);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *inside = substr_copy(after + 1, (size_t)(close - (after - expr) - 1));
+                    char *args[16] = {0};
+                    int argc = split_top_level_commas_c(inside, args, 16);
+                    free(inside);
+                    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter Map entry method argument count does not match",
+                            "write `m.key_at(index)` or `m.value_at(index)`.",
+                            NULL);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                    if (!direct_map_arg_type_compatible("Int", arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter Map entry index must be Int",
+                            "use an Int index in `m.key_at(index)` or `m.value_at(index)`.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(field);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    i = close + 1;
+                    free(field);
+                    free(name);
+                    continue;
+                }
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter supports Map insert/remove/clear statements and get/get_opt/contains/len/key_at/value_at expressions",
+                    "write `m.insert(key, value)`, `m.remove(key)`, `m.clear()`, `m.get(key, default)`, `m.get_opt(key)`, `m.contains(key)`, `m.len()`, `m.key_at(index)`, or `m.value_at(index)` for verified concrete Map values.",
+                    NULL);
+                free(field);
+                free(name);
+                return 1;
+            }
+            DirectStructInfo *st = base_type == NULL ? NULL : direct_find_struct(structs, struct_count, base_type);
+            if (st == NULL || !direct_struct_has_field(st, field)) {
+                int col = find_col(line, name);
+                report_issue(path, line_no, col, line,
+                    "direct native emitter found an unknown struct field access",
+                    "read fields from a known direct-engine struct local.",
+                    "return b.value");
+                free(field);
+                free(name);
+                return 1;
+            }
+            free(field);
+            free(name);
+            i = field_end;
+            continue;
+        }
+        int is_call = expr[cursor] == '(';
+        if (is_call) {
+            if (direct_is_proc_self_builtin_name(name) ||
+                direct_is_stderr_write_builtin_name(name) ||
+                direct_is_stdout_write_builtin_name(name) ||
+                direct_is_stdin_read_all_builtin_name(name) ||
+                direct_is_str_builder_new_builtin_name(name) || direct_is_str_builder_push_builtin_name(name) || direct_is_str_builder_append_builtin_name(name) || direct_is_str_builder_finish_builtin_name(name) ||
+                direct_is_fs_exists_builtin_name(name) || direct_is_fs_is_dir_builtin_name(name) || direct_is_fs_mkdirs_builtin_name(name) || direct_is_fs_read_text_builtin_name(name) || direct_is_fs_write_text_builtin_name(name) ||
+                direct_is_fs_cwd_builtin_name(name) || direct_is_fs_temp_dir_builtin_name(name) || direct_is_path_join_builtin_name(name) ||
+                direct_is_path_basename_builtin_name(name) || direct_is_path_dirname_builtin_name(name) ||
+                direct_is_time_millis_builtin_name(name) || direct_is_time_nanos_builtin_name(name) ||
+                direct_is_proc_argc_builtin_name(name) || direct_is_proc_arg_builtin_name(name) ||
+                direct_is_str_arena_builtin_name(name) || direct_is_index_builtin_name(name) || direct_is_snap_builtin_name(name) ||
+                direct_is_fs_stream_builtin_name(name) || direct_is_fs_remove_builtin_name(name) ||
+                direct_is_par_builtin_name(name) || direct_is_proc_wait_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the host helper call",
+                        "write `fs_exists(path)`, `fs_read_text(path)`, `fs_write_text(path, text)`, `fs_mkdirs(path)`, `fs_cwd()`, `fs_temp_dir()`, `path_join(base, child)`, `path_basename(path)`, `path_dirname(path)`, `time_millis()`, `proc_argc()`, or `proc_arg(index)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                char *trimmed_inside = trim_copy(inside);
+                int argc = trimmed_inside[0] == '\0' ? 0 : split_top_level_commas_c(inside, args, 16);
+                free(trimmed_inside);
+                free(inside);
+                int expected = (direct_is_fs_cwd_builtin_name(name) || direct_is_proc_self_builtin_name(name) || direct_is_stdin_read_all_builtin_name(name) || direct_is_fs_temp_dir_builtin_name(name) || direct_is_time_millis_builtin_name(name) || direct_is_time_nanos_builtin_name(name) || direct_is_str_builder_new_builtin_name(name) || direct_is_proc_argc_builtin_name(name) ||
+                    strcmp(name, "arena_begin") == 0 || strcmp(name, "alloc_count") == 0 || strcmp(name, "alloc_bytes") == 0) ? 0 :
+                    ((direct_is_fs_write_text_builtin_name(name) || direct_is_path_join_builtin_name(name) || direct_is_str_builder_push_builtin_name(name) || direct_is_str_builder_append_builtin_name(name)) ? 2 : 1);
+                if (direct_is_index_builtin_name(name)) expected = direct_index_builtin_argc(name);
+                if (direct_is_snap_builtin_name(name)) expected = direct_snap_builtin_argc(name);
+                if (direct_is_par_builtin_name(name)) expected = direct_par_builtin_argc(name);
+                if (direct_is_proc_wait_builtin_name(name)) expected = strcmp(name, "proc_wait") == 0 ? 1 : 0;
+                if (argc != expected) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter host helper argument count does not match",
+                        "write `fs_exists(path)`, `fs_read_text(path)`, `fs_write_text(path, text)`, `fs_mkdirs(path)`, `fs_cwd()`, `fs_temp_dir()`, `path_join(base, child)`, `path_basename(path)`, `path_dirname(path)`, `time_millis()`, `proc_argc()`, or `proc_arg(index)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                for (int a = 0; a < argc; a++) {
+                    if (args[a] == NULL || strlen(skip_ws(args[a])) == 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter host helper arguments cannot be empty",
+                            "pass explicit path, text, or index expressions to the host helper.",
+                            NULL);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+                    int sb_int_arg = direct_is_str_builder_push_builtin_name(name) ||
+                        direct_is_str_builder_finish_builtin_name(name) ||
+                        (direct_is_str_builder_append_builtin_name(name) && a == 0) ||
+                        (direct_is_str_arena_builtin_name(name) && !direct_is_arena_keep_builtin_name(name)) ||
+                        (direct_is_index_builtin_name(name) && !direct_index_builtin_str_arg(name, a)) ||
+                        (direct_is_snap_builtin_name(name) && !direct_snap_builtin_str_arg(name, a)) ||
+                        (direct_is_fs_stream_builtin_name(name) && !direct_fs_stream_builtin_str_arg(name)) ||
+                        direct_is_par_builtin_name(name) || direct_is_proc_wait_builtin_name(name);
+                    const char *expected_type = (direct_is_proc_arg_builtin_name(name) || sb_int_arg) ? "Int" : "Str";
+                    if (!direct_map_arg_type_compatible(expected_type, arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            (direct_is_proc_arg_builtin_name(name) || sb_int_arg) ?
+                                "direct native emitter host helper argument must be Int" :
+                                "direct native emitter host file/path helper arguments must be Str",
+                            (direct_is_proc_arg_builtin_name(name) || sb_int_arg) ?
+                                "pass an Int-compatible value to this host helper argument." :
+                                "pass Str path/text values to the host helper.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                }
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_option_result_payload_constructor_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the Option/Result constructor",
+                        "write `Some(value)`, `Ok(value)`, or `Err(code)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter Option/Result constructors take one Int payload",
+                        "write `Some(value)`, `Ok(value)`, or `Err(code)` with an Int-compatible payload.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_intlike_scalar_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter Option/Result constructors require an Int payload",
+                        "pass an Int, Bool, or Char value to the concrete Option<Int>/Result<Int,Int> constructor.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_conversion_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the Str conversion call",
+                        "write `Str(value)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter Str conversion takes one Int argument",
+                        "write `Str(value)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_intlike_scalar_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter Str conversion requires an Int argument",
+                        "pass an Int, Bool, or Char value.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_byte_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the str_byte call",
+                        "write `str_byte(value)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_byte takes one Int argument",
+                        "write `str_byte(value)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_intlike_scalar_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_byte requires an Int argument",
+                        "pass an Int, Bool, or Char value in the 0..255 range.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_parse_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the parse call",
+                        "close the call arguments.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter parse helpers take one Str argument",
+                        "write `parse_uint(s)` or `parse_int(s)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter parse helpers require a Str argument",
+                        "pass a string literal or `Str` local.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_split_ws_into_builtin_name(name) || direct_is_str_split_lines_into_builtin_name(name) || direct_is_fs_list_files_builtin_name(name) || direct_is_fs_list_dirs_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the string split call",
+                        "write `str_split_ws_into(text, out)` or `str_split_lines_into(text, out)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 2 || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter string split into takes Str and List<Str> arguments",
+                        "write `str_split_ws_into(text, words)` or `str_split_lines_into(text, lines)` where the output is a local `List<Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter string split into requires a Str text argument",
+                        "pass a string literal, Str local, or Str-returning expression as the first argument.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                char *list_name = NULL;
+                if (!direct_expr_bare_list_local(locals, args[1], &list_name) ||
+                    strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter string split into output must be a local List<Str>",
+                        "declare `let lines: List<Str> = []` and pass it as the second argument.",
+                        NULL);
+                    free(list_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_join_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the str_join call",
+                        "write `str_join(parts, sep)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 2 || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_join takes List<Str> and Str arguments",
+                        "write `str_join(parts, sep)` where `parts` is a local `List<Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *list_name = NULL;
+                if (!direct_expr_bare_list_local(locals, args[0], &list_name) ||
+                    strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_join input must be a local List<Str>",
+                        "declare `let parts: List<Str> = []` and pass `parts` as the first argument.",
+                        NULL);
+                    free(list_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(list_name);
+                if (direct_check_expr_inner(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *sep_type = direct_infer_expr_type(args[1], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(sep_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_join requires a Str separator argument",
+                        "pass a string literal, Str local, or Str-returning expression as the second argument.",
+                        NULL);
+                    free(sep_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(sep_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_split_into_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the str_split_into call",
+                        "write `str_split_into(text, sep, out)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 3 || args[0] == NULL || args[1] == NULL || args[2] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0 || strlen(skip_ws(args[2])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_split_into takes Str, Str, and List<Str> arguments",
+                        "write `str_split_into(text, sep, words)` where `words` is a local `List<Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL) ||
+                    direct_check_expr_inner(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *text_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                char *sep_type = direct_infer_expr_type(args[1], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(text_type) || !direct_is_str_type(sep_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_split_into requires Str text and separator arguments",
+                        "pass string literals, Str locals, or Str-returning expressions as the first two arguments.",
+                        NULL);
+                    free(text_type);
+                    free(sep_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(text_type);
+                free(sep_type);
+                char *list_name = NULL;
+                if (!direct_expr_bare_list_local(locals, args[2], &list_name) ||
+                    strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_split_into output must be a local List<Str>",
+                        "declare `let words: List<Str> = []` and pass `words` as the third argument.",
+                        NULL);
+                    free(list_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_map_str_str_snapshot_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the map_str_str_snapshot call",
+                        "write `map_str_str_snapshot(docs)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter map_str_str_snapshot takes one Map<Str,Str> argument",
+                        "write `map_str_str_snapshot(docs)` where `docs` is a local `Map<Str,Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *map_name = NULL;
+                if (!direct_expr_bare_map_local(locals, args[0], &map_name) ||
+                    strcmp(direct_names_type(locals, map_name), "Map<Str,Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter map_str_str_snapshot input must be a local Map<Str,Str>",
+                        "declare `let docs: Map<Str,Str> = {}` and pass `docs` as the argument.",
+                        NULL);
+                    free(map_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(map_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_map_str_str_load_snapshot_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the map_str_str_load_snapshot call",
+                        "write `map_str_str_load_snapshot(text, docs)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 2 || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter map_str_str_load_snapshot takes Str and Map<Str,Str> arguments",
+                        "write `map_str_str_load_snapshot(text, docs)` where `docs` is a local `Map<Str,Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter map_str_str_load_snapshot requires a Str snapshot argument",
+                        "pass a string literal, Str local, or Str-returning expression as the first argument.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                char *map_name = NULL;
+                if (!direct_expr_bare_map_local(locals, args[1], &map_name) ||
+                    strcmp(direct_names_type(locals, map_name), "Map<Str,Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter map_str_str_load_snapshot output must be a local Map<Str,Str>",
+                        "declare `let docs: Map<Str,Str> = {}` and pass `docs` as the second argument.",
+                        NULL);
+                    free(map_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(map_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_doc_term_overlap_score_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the doc_term_overlap_score call",
+                        "write `doc_term_overlap_score(query_counts, doc_counts)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 2 || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter doc_term_overlap_score takes two Map<Str,Int> arguments",
+                        "write `doc_term_overlap_score(query_counts, doc_counts)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *query_name = NULL;
+                char *doc_name = NULL;
+                if (!direct_expr_bare_map_local(locals, args[0], &query_name) ||
+                    strcmp(direct_names_type(locals, query_name), "Map<Str,Int>") != 0 ||
+                    !direct_expr_bare_map_local(locals, args[1], &doc_name) ||
+                    strcmp(direct_names_type(locals, doc_name), "Map<Str,Int>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter doc_term_overlap_score arguments must be Map<Str,Int>",
+                        "pass two local or parameter `Map<Str,Int>` values.",
+                        NULL);
+                    free(query_name);
+                    free(doc_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(query_name);
+                free(doc_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_doc_term_weighted_score_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the doc_term_weighted_score call",
+                        "write `doc_term_weighted_score(query_counts, doc_counts)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 2 || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter doc_term_weighted_score takes two Map<Str,Int> arguments",
+                        "write `doc_term_weighted_score(query_counts, doc_counts)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *query_name = NULL;
+                char *doc_name = NULL;
+                if (!direct_expr_bare_map_local(locals, args[0], &query_name) ||
+                    strcmp(direct_names_type(locals, query_name), "Map<Str,Int>") != 0 ||
+                    !direct_expr_bare_map_local(locals, args[1], &doc_name) ||
+                    strcmp(direct_names_type(locals, doc_name), "Map<Str,Int>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter doc_term_weighted_score arguments must be Map<Str,Int>",
+                        "pass two local or parameter `Map<Str,Int>` values.",
+                        NULL);
+                    free(query_name);
+                    free(doc_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(query_name);
+                free(doc_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_doc_term_counts_into_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the doc_term_counts_into call",
+                        "write `doc_term_counts_into(text, counts)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 2 || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter doc_term_counts_into takes Str and Map<Str,Int> arguments",
+                        "write `doc_term_counts_into(text, counts)` where `counts` is a local `Map<Str,Int>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter doc_term_counts_into requires a Str text argument",
+                        "pass a string literal, Str local, or Str-returning expression as the first argument.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                char *map_name = NULL;
+                if (!direct_expr_bare_map_local(locals, args[1], &map_name) ||
+                    strcmp(direct_names_type(locals, map_name), "Map<Str,Int>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter doc_term_counts_into output must be a local Map<Str,Int>",
+                        "declare `let counts: Map<Str,Int> = {}` and pass `counts` as the second argument.",
+                        NULL);
+                    free(map_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(map_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_slice_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the str_slice call",
+                        "write `str_slice(text, start, len)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 3 || args[0] == NULL || args[1] == NULL || args[2] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0 || strlen(skip_ws(args[2])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_slice takes Str, Int, Int arguments",
+                        "write `str_slice(text, start, len)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                for (int a = 0; a < 3; a++) {
+                    if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+                    int ok = a == 0 ? direct_is_str_type(arg_type) : direct_is_intlike_scalar_type(arg_type);
+                    if (!ok) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter str_slice takes Str, Int, Int arguments",
+                            "pass a string plus Int-compatible start and length expressions.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                }
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_trim_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the str_trim call",
+                        "write `str_trim(text)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_trim takes one Str argument",
+                        "write `str_trim(text)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter str_trim requires a Str argument",
+                        "pass a string literal, Str local, or Str-returning expression.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_lower_builtin_name(name) || direct_is_str_upper_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the string case-conversion call",
+                        "write `str_lower(text)` or `str_upper(text)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter string case conversion takes one Str argument",
+                        "write `str_lower(text)` or `str_upper(text)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count, NULL)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+                if (!direct_is_str_type(arg_type)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter string case conversion requires a Str argument",
+                        "pass a string literal, Str local, or Str-returning expression.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(arg_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_str_contains_builtin_name(name) || direct_is_str_cmp_builtin_name(name) || direct_is_str_index_of_builtin_name(name) || direct_is_str_starts_with_builtin_name(name) || direct_is_str_ends_with_builtin_name(name) || direct_is_str_concat_builtin_name(name) || direct_is_str_replace_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the string helper call",
+                        "write `str_contains(text, needle)`, `str_index_of(text, needle)`, `str_starts_with(text, prefix)`, `str_ends_with(text, suffix)`, `str_concat(left, right)`, or `str_replace(text, needle, replacement)`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                int want_argc = direct_is_str_replace_builtin_name(name) ? 3 : 2;
+                if (argc != want_argc || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0 ||
+                    (want_argc == 3 && (args[2] == NULL || strlen(skip_ws(args[2])) == 0))) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter string helper argument count does not match",
+                        "write two Str arguments for search/concat helpers or `str_replace(text, needle, replacement)` with three Str arguments.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                for (int a = 0; a < want_argc; a++) {
+                    if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+                    if (!direct_is_str_type(arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter string helper requires Str arguments",
+                            "pass string literals, Str locals, or Str-returning expressions.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                }
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_proc_run_env_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the proc_run_env call",
+                        "write `proc_run_env(argv, env)` where both are local `List<Str>` values.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                int bad = argc != 2 || args[0] == NULL || args[1] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0;
+                if (!bad) {
+                    for (int a = 0; a < 2; a++) {
+                        char *list_name = NULL;
+                        if (!direct_expr_bare_list_local(locals, args[a], &list_name) ||
+                            strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                            bad = 1;
+                        }
+                        free(list_name);
+                    }
+                }
+                if (bad) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_run_env arguments must be local List<Str> values",
+                        "declare argv and env as `let xs: List<Str> = []`, push entries, then call `proc_run_env(argv, env)`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_proc_run_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the proc_run call",
+                        "write `proc_run(argv)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_run takes one List<Str> argument",
+                        "write `proc_run(argv)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *list_name = NULL;
+                if (!direct_expr_bare_list_local(locals, args[0], &list_name) ||
+                    strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_run argument must be a local List<Str>",
+                        "declare `let argv: List<Str> = []`, push argv entries, then call `proc_run(argv)`.",
+                        NULL);
+                    free(list_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_proc_spawn_to_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the proc_spawn_to call",
+                        "write `proc_spawn_to(argv, stdout_path, stderr_path)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 3 || args[0] == NULL || args[1] == NULL || args[2] == NULL ||
+                    strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0 || strlen(skip_ws(args[2])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_spawn_to takes argv, stdout_path, and stderr_path arguments",
+                        "write `proc_spawn_to(argv, stdout_path, stderr_path)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *list_name = NULL;
+                if (!direct_expr_bare_list_local(locals, args[0], &list_name) ||
+                    strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_spawn_to argument must be a local List<Str>",
+                        "declare `let argv: List<Str> = []`, push argv entries, then call `proc_spawn_to(argv, stdout_path, stderr_path)`.",
+                        NULL);
+                    free(list_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(list_name);
+                for (int a = 1; a < 3; a++) {
+                    if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+                    if (!direct_map_arg_type_compatible("Str", arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter proc_spawn_to paths must be Str",
+                            "pass Str paths, or \"\" to keep a stream inherited.",
+                            NULL);
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                }
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_proc_spawn_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the proc_spawn call",
+                        "write `proc_spawn(argv)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_spawn takes one List<Str> argument",
+                        "write `proc_spawn(argv)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *list_name = NULL;
+                if (!direct_expr_bare_list_local(locals, args[0], &list_name) ||
+                    strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_spawn argument must be a local List<Str>",
+                        "declare `let argv: List<Str> = []`, push argv entries, then call `proc_spawn(argv)`.",
+                        NULL);
+                    free(list_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            if (direct_is_proc_capture_builtin_name(name)) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the proc_capture call",
+                        "write `proc_capture(argv)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                if (!direct_has_process_result_struct(structs, struct_count)) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_capture requires `struct ProcessResult { code: Int, stdout: Str, stderr: Str }`",
+                        "declare the standard ProcessResult shape before calling `proc_capture`.",
+                        "struct ProcessResult { code: Int, stdout: Str, stderr: Str }");
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_capture takes one List<Str> argument",
+                        "write `proc_capture(argv)` where `argv` is a local `List<Str>`.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                char *list_name = NULL;
+                if (!direct_expr_bare_list_local(locals, args[0], &list_name) ||
+                    strcmp(direct_names_type(locals, list_name), "List<Str>") != 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter proc_capture argument must be a local List<Str>",
+                        "declare `let argv: List<Str> = []`, push argv entries, then call `proc_capture(argv)`.",
+                        NULL);
+                    free(list_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                free(list_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+            DirectFnInfo *fn = direct_find_fn(fns, fn_count, name);
+            if (fn != NULL) {
+                int close = find_matching_paren_c(expr, cursor);
+                if (close < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter expected `)` to close the function call",
+                        "close the call arguments.",
+                        NULL);
+                    free(name);
+                    return 1;
+                }
+                char *inside = substr_copy(expr + cursor + 1, (size_t)(close - cursor - 1));
+                char *args[16] = {0};
+                int argc = split_top_level_commas_c(inside, args, 16);
+                free(inside);
+                if (argc == 1 && args[0] != NULL && strlen(skip_ws(args[0])) == 0) {
+                    free(args[0]);
+                    args[0] = NULL;
+                    argc = 0;
+                }
+                if (argc < 0 || argc != fn->param_count) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter function call argument count does not match",
+                        "pass exactly the parameters declared by the direct helper.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(name);
+                    return 1;
+                }
+                for (int a = 0; a < argc; a++) {
+                    int allow_arg_list = direct_is_list_type(fn->param_types[a]);
+                    int allow_arg_map = direct_is_map_type(fn->param_types[a]);
+                    int inline_list_arg = 0;
+                    int returned_list_arg = 0;
+                    if (allow_arg_list) {
+                        int literal_state = direct_list_initializer_state(args[a]);
+                        if (literal_state < 0) {
+                            report_issue(path, line_no, find_col(line, "List"), line,
+                                "direct native emitter supports up to 16 List literal items",
+                                "bind a local list and call `push` for larger direct-engine lists.",
+                                NULL);
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(name);
+                            return 1;
+                        }
+                        inline_list_arg = literal_state == 1;
+                        returned_list_arg = direct_expr_exact_list_return_call(args[a], fns, fn_count);
+                    }
+                    if (allow_arg_list && inline_list_arg) {
+                        if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, fn->param_types[a])) {
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(name);
+                            return 1;
+                        }
+                        continue;
+                    }
+                    char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+                    if (!direct_type_compatible(fn->param_types[a], arg_type)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter function call argument type does not match",
+                            "pass a value with the parameter type declared by the direct helper.",
+                            "pass a matching argument");
+                        free(arg_type);
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    free(arg_type);
+                    if (allow_arg_map) {
+                        if (!direct_expr_bare_map_local(locals, args[a], NULL)) {
+                            report_issue(path, line_no, find_col(line, name), line,
+                                "direct native emitter requires a local Map argument",
+                                "bind the Map value to a local before passing it.",
+                                "let m: Map<Int,Int> = {}");
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(name);
+                            return 1;
+                        }
+                        continue;
+                    }
+                    if (allow_arg_list && returned_list_arg) {
+                        if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, fn->param_types[a])) {
+                            for (int k = 0; k < 16; k++) free(args[k]);
+                            free(name);
+                            return 1;
+                        }
+                        continue;
+                    }
+                    if (allow_arg_list && !direct_expr_bare_list_local(locals, args[a], NULL)) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter requires a local List argument",
+                            "bind the list value to a local before passing it.",
+                            "let xs: List<Int> = []");
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                    if (direct_check_expr_inner(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count, allow_arg_list ? fn->param_types[a] : NULL)) {
+                        for (int k = 0; k < 16; k++) free(args[k]);
+                        free(name);
+                        return 1;
+                    }
+                }
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(name);
+                i = close + 1;
+                continue;
+            }
+        }
+        const char *local_type = direct_names_type(locals, name);
+        if (direct_is_list_type(local_type) && expr[cursor] != '[' && allowed_list_type == NULL) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter cannot use a List value as an Int expression",
+                "read a list element, length, or sum value instead.",
+                "xs.len()");
+            free(name);
+            return 1;
+        }
+        if (direct_is_map_type(local_type)) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter cannot use a Map value as an Int expression",
+                "read a map value with `m.get(key, default)`, `m.get_opt(key)`, `m.contains(key)`, or `m.len()`.",
+                "m.get(key, 0)");
+            free(name);
+            return 1;
+        }
+        int is_struct_literal = expr[cursor] == '{' && direct_find_struct(structs, struct_count, name) != NULL;
+        int ok = direct_is_keyword(name) || direct_names_has(locals, name) ||
+            (is_call && direct_find_fn(fns, fn_count, name) != NULL) ||
+            is_struct_literal ||
+            (strcmp(name, "None") == 0 && expr[cursor] != '(');
+        if (!ok) {
+            int col = find_col(line, name);
+            report_issue(path, line_no, col, line,
+                "direct native emitter found an unknown Int identifier",
+                "define it with `let`, pass it as an Int parameter, or call a known helper function.",
+                "return 40 + 2");
+            free(name);
+            return 1;
+        }
+        free(name);
+    }
+    return 0;
+}
+
+static int direct_check_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    return direct_check_expr_inner(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count, NULL);
+}
+
+static char *direct_after_keyword_expr(const char *s, const char *keyword, char stop) {
+    s = skip_ws(s);
+    size_t n = strlen(keyword);
+    if (strncmp(s, keyword, n) != 0) return NULL;
+    const char *expr = skip_ws(s + n);
+    const char *end = strrchr(expr, stop);
+    if (end == NULL) return NULL;
+    return trim_copy(substr_copy(expr, (size_t)(end - expr)));
+}
+
+static int direct_find_top_level_char(const char *text, char target) {
+    int paren_depth = 0;
+    int bracket_depth = 0;
+    int brace_depth = 0;
+    for (int i = 0; text[i] != '\0'; i++) {
+        if (is_string_delim_c(text[i])) {
+            int end = skip_string_literal_c(text, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (text[i] == '\'') {
+            int end = skip_char_literal_c(text, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (text[i] == target && paren_depth == 0 && bracket_depth == 0 && brace_depth == 0) return i;
+        if (text[i] == '(') paren_depth++;
+        else if (text[i] == ')') paren_depth--;
+        else if (text[i] == '[') bracket_depth++;
+        else if (text[i] == ']') bracket_depth--;
+        else if (text[i] == '{') brace_depth++;
+        else if (text[i] == '}') brace_depth--;
+    }
+    return -1;
+}
+
+static int direct_find_top_level_range_op(const char *text, int *inclusive) {
+    int paren_depth = 0;
+    int bracket_depth = 0;
+    int brace_depth = 0;
+    for (int i = 0; text[i] != '\0'; i++) {
+        if (is_string_delim_c(text[i])) {
+            int end = skip_string_literal_c(text, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (text[i] == '\'') {
+            int end = skip_char_literal_c(text, i);
+            if (end < 0) return -1;
+            i = end - 1;
+            continue;
+        }
+        if (paren_depth == 0 && bracket_depth == 0 && brace_depth == 0 &&
+            text[i] == '.' && text[i + 1] == '.') {
+            *inclusive = text[i + 2] == '=';
+            return i;
+        }
+        if (text[i] == '(') paren_depth++;
+        else if (text[i] == ')') paren_depth--;
+        else if (text[i] == '[') bracket_depth++;
+        else if (text[i] == ']') bracket_depth--;
+        else if (text[i] == '{') brace_depth++;
+        else if (text[i] == '}') brace_depth--;
+    }
+    return -1;
+}
+
+static int direct_parse_for_header(
+    const char *s,
+    char **name_out,
+    char **lo_out,
+    char **hi_out,
+    int *inclusive_out
+) {
+    s = skip_ws(s);
+    if (!starts_with(s, "for") || is_ident_continue(s[3])) return 0;
+    const char *p = skip_ws(s + 3);
+    if (!is_ident_start(*p)) return -1;
+    const char *name_start = p;
+    p++;
+    while (is_ident_continue(*p)) p++;
+    char *name = substr_copy(name_start, (size_t)(p - name_start));
+    p = skip_ws(p);
+    if (!(p[0] == 'i' && p[1] == 'n' && !is_ident_continue(p[2]))) {
+        free(name);
+        return -1;
+    }
+    p = skip_ws(p + 2);
+    int open_rel = direct_find_top_level_char(p, '{');
+    if (open_rel < 0 || *skip_ws(p + open_rel + 1) != '\0') {
+        free(name);
+        return -1;
+    }
+    char *range = substr_copy(p, (size_t)open_rel);
+    int inclusive = 0;
+    int op = direct_find_top_level_range_op(range, &inclusive);
+    if (op < 0) {
+        free(range);
+        free(name);
+        return -1;
+    }
+    int op_len = inclusive ? 3 : 2;
+    char *lo_raw = substr_copy(range, (size_t)op);
+    char *hi_raw = substr_copy(range + op + op_len, strlen(range + op + op_len));
+    char *lo = trim_copy(lo_raw);
+    char *hi = trim_copy(hi_raw);
+    free(lo_raw);
+    free(hi_raw);
+    free(range);
+    if (lo[0] == '\0' || hi[0] == '\0') {
+        free(lo);
+        free(hi);
+        free(name);
+        return -1;
+    }
+    *name_out = name;
+    *lo_out = lo;
+    *hi_out = hi;
+    *inclusive_out = inclusive;
+    return 1;
+}
+
+static int direct_parse_for_each_header(
+    const char *s,
+    char **name_out,
+    char **iterable_out
+) {
+    s = skip_ws(s);
+    if (!starts_with(s, "for") || is_ident_continue(s[3])) return 0;
+    const char *p = skip_ws(s + 3);
+    if (!is_ident_start(*p)) return -1;
+    const char *name_start = p;
+    p++;
+    while (is_ident_continue(*p)) p++;
+    char *name = substr_copy(name_start, (size_t)(p - name_start));
+    p = skip_ws(p);
+    if (!(p[0] == 'i' && p[1] == 'n' && !is_ident_continue(p[2]))) {
+        free(name);
+        return -1;
+    }
+    p = skip_ws(p + 2);
+    int open_rel = direct_find_top_level_char(p, '{');
+    if (open_rel < 0 || *skip_ws(p + open_rel + 1) != '\0') {
+        free(name);
+        return -1;
+    }
+    char *iter_raw = substr_copy(p, (size_t)open_rel);
+    char *iterable = trim_copy(iter_raw);
+    free(iter_raw);
+    if (iterable[0] == '\0') {
+        free(iterable);
+        free(name);
+        return -1;
+    }
+    int inclusive = 0;
+    if (direct_find_top_level_range_op(iterable, &inclusive) >= 0) {
+        free(iterable);
+        free(name);
+        return -1;
+    }
+    *name_out = name;
+    *iterable_out = iterable;
+    return 1;
+}
+
+static int direct_parse_inline_block(const char *s, const char *keyword, char **expr_out, char **body_out) {
+    s = skip_ws(s);
+    size_t n = strlen(keyword);
+    if (strncmp(s, keyword, n) != 0) return 0;
+    char next = s[n];
+    if (!(next == ' ' || next == '\t')) return 0;
+    const char *expr = skip_ws(s + n);
+    int open_rel = direct_find_top_level_char(expr, '{');
+    if (open_rel < 0) return 0;
+    int open_abs = (int)(expr - s) + open_rel;
+    int close_abs = find_matching_brace_c(s, open_abs);
+    if (close_abs < 0) return 0;
+    if (*skip_ws(s + close_abs + 1) != '\0') return 0;
+    char *expr_raw = substr_copy(expr, (size_t)open_rel);
+    char *body_raw = substr_copy(s + open_abs + 1, (size_t)(close_abs - open_abs - 1));
+    *expr_out = trim_copy(expr_raw);
+    *body_out = trim_copy(body_raw);
+    free(expr_raw);
+    free(body_raw);
+    return 1;
+}
+
+static int direct_parse_inline_cond_else(
+    const char *s,
+    const char *keyword,
+    char **expr_out,
+    char **then_out,
+    char **else_out
+) {
+    s = skip_ws(s);
+    size_t n = strlen(keyword);
+    if (strncmp(s, keyword, n) != 0) return 0;
+    char next = s[n];
+    if (!(next == ' ' || next == '\t')) return 0;
+    const char *expr = skip_ws(s + n);
+    int open_rel = direct_find_top_level_char(expr, '{');
+    if (open_rel < 0) return 0;
+    int open_abs = (int)(expr - s) + open_rel;
+    int then_close_abs = find_matching_brace_c(s, open_abs);
+    if (then_close_abs < 0) return 0;
+    const char *after_then = skip_ws(s + then_close_abs + 1);
+    if (!starts_with(after_then, "else") || is_ident_continue(after_then[4])) return 0;
+    const char *after_else = skip_ws(after_then + 4);
+    char *else_body = NULL;
+    if (*after_else == '{') {
+        int else_open_abs = (int)(after_else - s);
+        int else_close_abs = find_matching_brace_c(s, else_open_abs);
+        if (else_close_abs < 0 || *skip_ws(s + else_close_abs + 1) != '\0') return 0;
+        char *else_raw = substr_copy(s + else_open_abs + 1, (size_t)(else_close_abs - else_open_abs - 1));
+        else_body = trim_copy(else_raw);
+        free(else_raw);
+    } else if (starts_with(after_else, "if") && !is_ident_continue(after_else[2])) {
+        else_body = trim_copy(after_else);
+    } else {
+        return 0;
+    }
+    char *expr_raw = substr_copy(expr, (size_t)open_rel);
+    char *then_raw = substr_copy(s + open_abs + 1, (size_t)(then_close_abs - open_abs - 1));
+    *expr_out = trim_copy(expr_raw);
+    *then_out = trim_copy(then_raw);
+    *else_out = else_body;
+    free(expr_raw);
+    free(then_raw);
+    return 1;
+}
+
+static int direct_parse_field_target(const char *lhs, char **base, char **field) {
+    const char *s = skip_ws(lhs);
+    if (!is_ident_start(*s)) return 0;
+    const char *base_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *base_end = s;
+    const char *dot = skip_ws(s);
+    if (*dot != '.') return 0;
+    s = skip_ws(dot + 1);
+    if (!is_ident_start(*s)) return 0;
+    const char *field_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    if (*skip_ws(s) != '\0') return 0;
+    *base = substr_copy(base_start, (size_t)(base_end - base_start));
+    *field = substr_copy(field_start, (size_t)(s - field_start));
+    return 1;
+}
+
+static int direct_parse_nested_field_target(const char *lhs, char **base, char **field, char **nested_field) {
+    const char *s = skip_ws(lhs);
+    if (!is_ident_start(*s)) return 0;
+    const char *base_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *base_end = s;
+    const char *dot = skip_ws(s);
+    if (*dot != '.') return 0;
+    s = skip_ws(dot + 1);
+    if (!is_ident_start(*s)) return 0;
+    const char *field_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *field_end = s;
+    dot = skip_ws(s);
+    if (*dot != '.') return 0;
+    s = skip_ws(dot + 1);
+    if (!is_ident_start(*s)) return 0;
+    const char *nested_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    if (*skip_ws(s) != '\0') return 0;
+    *base = substr_copy(base_start, (size_t)(base_end - base_start));
+    *field = substr_copy(field_start, (size_t)(field_end - field_start));
+    *nested_field = substr_copy(nested_start, (size_t)(s - nested_start));
+    return 1;
+}
+
+static int direct_parse_list_field_target(const char *lhs, char **base, char **field) {
+    const char *s = skip_ws(lhs);
+    if (!is_ident_start(*s)) return 0;
+    const char *base_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *base_end = s;
+    const char *open = skip_ws(s);
+    if (*open != '[') return 0;
+    int close = find_matching_bracket_c(lhs, (int)(open - lhs));
+    if (close < 0) return 0;
+    s = skip_ws(lhs + close + 1);
+    if (*s != '.') return 0;
+    s = skip_ws(s + 1);
+    if (!is_ident_start(*s)) return 0;
+    const char *field_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    if (*skip_ws(s) != '\0') return 0;
+    *base = substr_copy(base_start, (size_t)(base_end - base_start));
+    *field = substr_copy(field_start, (size_t)(s - field_start));
+    return 1;
+}
+
+static int direct_parse_list_nested_field_target(const char *lhs, char **base, char **field, char **nested_field) {
+    const char *s = skip_ws(lhs);
+    if (!is_ident_start(*s)) return 0;
+    const char *base_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *base_end = s;
+    const char *open = skip_ws(s);
+    if (*open != '[') return 0;
+    int close = find_matching_bracket_c(lhs, (int)(open - lhs));
+    if (close < 0) return 0;
+    s = skip_ws(lhs + close + 1);
+    if (*s != '.') return 0;
+    s = skip_ws(s + 1);
+    if (!is_ident_start(*s)) return 0;
+    const char *field_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *field_end = s;
+    s = skip_ws(s);
+    if (*s != '.') return 0;
+    s = skip_ws(s + 1);
+    if (!is_ident_start(*s)) return 0;
+    const char *nested_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    if (*skip_ws(s) != '\0') return 0;
+    *base = substr_copy(base_start, (size_t)(base_end - base_start));
+    *field = substr_copy(field_start, (size_t)(field_end - field_start));
+    *nested_field = substr_copy(nested_start, (size_t)(s - nested_start));
+    return 1;
+}
+
+static int direct_parse_list_index_target(const char *lhs, char **base) {
+    const char *s = skip_ws(lhs);
+    if (!is_ident_start(*s)) return 0;
+    const char *base_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *base_end = s;
+    const char *open = skip_ws(s);
+    if (*open != '[') return 0;
+    int close = find_matching_bracket_c(lhs, (int)(open - lhs));
+    if (close < 0 || *skip_ws(lhs + close + 1) != '\0') return 0;
+    *base = substr_copy(base_start, (size_t)(base_end - base_start));
+    return 1;
+}
+
+static int direct_check_assignment_target(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *lhs,
+    DirectNameSet *locals,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    if (direct_names_has(locals, lhs)) return 0;
+    char *base = NULL;
+    char *field = NULL;
+    char *nested_field = NULL;
+    if (direct_parse_nested_field_target(lhs, &base, &field, &nested_field)) {
+        const char *base_type = direct_names_type(locals, base);
+        DirectStructInfo *st = base_type == NULL ? NULL : direct_find_struct(structs, struct_count, base_type);
+        const char *field_type = st == NULL ? NULL : direct_struct_field_type(st, field);
+        DirectStructInfo *nested = field_type == NULL ? NULL : direct_find_struct(structs, struct_count, field_type);
+        if (nested != NULL && direct_struct_has_field(nested, nested_field)) {
+            free(base);
+            free(field);
+            free(nested_field);
+            return 0;
+        }
+        report_issue(path, line_no, find_col(line, base), line,
+            "direct native emitter assignment target is not a known nested struct field",
+            "assign to a field declared on a direct-engine nested struct local.",
+            NULL);
+        free(base);
+        free(field);
+        free(nested_field);
+        return 1;
+    }
+    if (direct_parse_field_target(lhs, &base, &field)) {
+        const char *base_type = direct_names_type(locals, base);
+        DirectStructInfo *st = base_type == NULL ? NULL : direct_find_struct(structs, struct_count, base_type);
+        if (st != NULL && direct_struct_has_field(st, field)) {
+            free(base);
+            free(field);
+            return 0;
+        }
+        report_issue(path, line_no, find_col(line, base), line,
+            "direct native emitter assignment target is not a known struct field",
+            "assign to a field declared on a direct-engine struct local.",
+            NULL);
+        free(base);
+        free(field);
+        return 1;
+    }
+    if (direct_parse_list_index_target(lhs, &base)) {
+        const char *base_type = direct_names_type(locals, base);
+        char *elem_type = direct_list_element_type(base_type);
+        int ok = elem_type != NULL && (strcmp(elem_type, "Int") == 0 || strcmp(elem_type, "Str") == 0 || direct_find_struct(structs, struct_count, elem_type) != NULL);
+        if (ok) {
+            free(elem_type);
+            free(base);
+            return 0;
+        }
+        report_issue(path, line_no, find_col(line, base), line,
+            "direct native emitter assignment target is not a known List element",
+            "assign to an element of a known direct-engine list.",
+            "xs[0] = value");
+        free(elem_type);
+        free(base);
+        return 1;
+    }
+    if (direct_parse_list_nested_field_target(lhs, &base, &field, &nested_field)) {
+        const char *base_type = direct_names_type(locals, base);
+        char *elem_type = direct_list_element_type(base_type);
+        DirectStructInfo *st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+        const char *field_type = st == NULL ? NULL : direct_struct_field_type(st, field);
+        DirectStructInfo *nested = field_type == NULL ? NULL : direct_find_struct(structs, struct_count, field_type);
+        if (nested != NULL && direct_struct_has_field(nested, nested_field)) {
+            free(elem_type);
+            free(base);
+            free(field);
+            free(nested_field);
+            return 0;
+        }
+        report_issue(path, line_no, find_col(line, base), line,
+            "direct native emitter assignment target is not a known List<Struct> nested field",
+            "assign to a field declared on the nested struct element.",
+            "xs[0].inner.value = 42");
+        free(elem_type);
+        free(base);
+        free(field);
+        free(nested_field);
+        return 1;
+    }
+    if (direct_parse_list_field_target(lhs, &base, &field)) {
+        const char *base_type = direct_names_type(locals, base);
+        char *elem_type = direct_list_element_type(base_type);
+        DirectStructInfo *st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+        if (st != NULL && direct_struct_has_field(st, field)) {
+            free(elem_type);
+            free(base);
+            free(field);
+            return 0;
+        }
+        report_issue(path, line_no, find_col(line, base), line,
+            "direct native emitter assignment target is not a known List<Struct> field",
+            "assign to a field declared on the list element struct.",
+            "xs[0].value = 42");
+        free(elem_type);
+        free(base);
+        free(field);
+        return 1;
+    }
+    report_issue(path, line_no, find_col(line, lhs), line,
+        "direct native emitter assignment target is not a known local",
+        "define the target with `let` before assigning to it.",
+        NULL);
+    return 1;
+}
+
+static const char *direct_assignment_target_type(
+    const char *lhs,
+    DirectNameSet *locals,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    const char *local_type = direct_names_type(locals, lhs);
+    if (local_type != NULL) return local_type;
+    char *base = NULL;
+    char *field = NULL;
+    char *nested_field = NULL;
+    if (direct_parse_nested_field_target(lhs, &base, &field, &nested_field)) {
+        const char *base_type = direct_names_type(locals, base);
+        DirectStructInfo *st = base_type == NULL ? NULL : direct_find_struct(structs, struct_count, base_type);
+        const char *field_type = st == NULL ? NULL : direct_struct_field_type(st, field);
+        DirectStructInfo *nested = field_type == NULL ? NULL : direct_find_struct(structs, struct_count, field_type);
+        const char *nested_type = nested == NULL ? NULL : direct_struct_field_type(nested, nested_field);
+        int ok = nested_type != NULL;
+        static char bufs[4][128];
+        static int slot = 0;
+        if (ok) {
+            slot = (slot + 1) % 4;
+            snprintf(bufs[slot], sizeof(bufs[slot]), "%s", nested_type);
+        }
+        free(base);
+        free(field);
+        free(nested_field);
+        return ok ? bufs[slot] : NULL;
+    }
+    if (direct_parse_field_target(lhs, &base, &field)) {
+        const char *base_type = direct_names_type(locals, base);
+        DirectStructInfo *st = base_type == NULL ? NULL : direct_find_struct(structs, struct_count, base_type);
+        const char *field_type = st == NULL ? NULL : direct_struct_field_type(st, field);
+        int ok = field_type != NULL;
+        static char bufs[4][128];
+        static int slot = 0;
+        if (ok) {
+            slot = (slot + 1) % 4;
+            snprintf(bufs[slot], sizeof(bufs[slot]), "%s", field_type);
+        }
+        free(base);
+        free(field);
+        return ok ? bufs[slot] : NULL;
+    }
+    if (direct_parse_list_index_target(lhs, &base)) {
+        const char *base_type = direct_names_type(locals, base);
+        static char bufs[4][128];
+        static int slot = 0;
+        char *elem_type = direct_list_element_type(base_type);
+        if (elem_type == NULL) {
+            free(base);
+            return NULL;
+        }
+        slot = (slot + 1) % 4;
+        snprintf(bufs[slot], sizeof(bufs[slot]), "%s", elem_type);
+        free(elem_type);
+        free(base);
+        return bufs[slot];
+    }
+    if (direct_parse_list_nested_field_target(lhs, &base, &field, &nested_field)) {
+        const char *base_type = direct_names_type(locals, base);
+        char *elem_type = direct_list_element_type(base_type);
+        DirectStructInfo *st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+        const char *field_type = st == NULL ? NULL : direct_struct_field_type(st, field);
+        DirectStructInfo *nested = field_type == NULL ? NULL : direct_find_struct(structs, struct_count, field_type);
+        const char *nested_type = nested == NULL ? NULL : direct_struct_field_type(nested, nested_field);
+        int ok = nested_type != NULL;
+        static char bufs2[4][128];
+        static int slot2 = 0;
+        if (ok) {
+            slot2 = (slot2 + 1) % 4;
+            snprintf(bufs2[slot2], sizeof(bufs2[slot2]), "%s", nested_type);
+        }
+        free(elem_type);
+        free(base);
+        free(field);
+        free(nested_field);
+        return ok ? bufs2[slot2] : NULL;
+    }
+    if (direct_parse_list_field_target(lhs, &base, &field)) {
+        const char *base_type = direct_names_type(locals, base);
+        char *elem_type = direct_list_element_type(base_type);
+        DirectStructInfo *st = elem_type == NULL ? NULL : direct_find_struct(structs, struct_count, elem_type);
+        const char *field_type = st == NULL ? NULL : direct_struct_field_type(st, field);
+        int ok = field_type != NULL;
+        static char bufs3[4][128];
+        static int slot3 = 0;
+        if (ok) {
+            slot3 = (slot3 + 1) % 4;
+            snprintf(bufs3[slot3], sizeof(bufs3[slot3]), "%s", field_type);
+        }
+        free(elem_type);
+        free(base);
+        free(field);
+        return ok ? bufs3[slot3] : NULL;
+    }
+    return NULL;
+}
+
+static int direct_parse_method_statement(const char *s, char **base, char **method, char **args) {
+    const char *p = skip_ws(s);
+    if (!is_ident_start(*p)) return 0;
+    const char *base_start = p;
+    p++;
+    while (is_ident_continue(*p)) p++;
+    const char *base_end = p;
+    p = skip_ws(p);
+    if (*p != '.') return 0;
+    p = skip_ws(p + 1);
+    if (!is_ident_start(*p)) return 0;
+    const char *method_start = p;
+    p++;
+    while (is_ident_continue(*p)) p++;
+    const char *method_end = p;
+    p = skip_ws(p);
+    if (*p != '(') return 0;
+    int close = find_matching_paren_c(s, (int)(p - s));
+    if (close < 0) return 0;
+    const char *after = skip_ws(s + close + 1);
+    if (*after == ';') after = skip_ws(after + 1);
+    if (*after != '\0') return 0;
+    *base = substr_copy(base_start, (size_t)(base_end - base_start));
+    *method = substr_copy(method_start, (size_t)(method_end - method_start));
+    *args = substr_copy(p + 1, (size_t)(close - (p - s) - 1));
+    return 1;
+}
+
+static int direct_parse_option_some_pattern(const char *pattern, char **binder_out) {
+    char *trimmed = trim_copy(pattern);
+    const char *s = skip_ws(trimmed);
+    if (!starts_with(s, "Some") || is_ident_continue(s[4])) {
+        free(trimmed);
+        return 0;
+    }
+    const char *p = skip_ws(s + 4);
+    if (*p != '(') {
+        free(trimmed);
+        return -1;
+    }
+    int close = find_matching_paren_c(trimmed, (int)(p - trimmed));
+    if (close < 0 || *skip_ws(trimmed + close + 1) != '\0') {
+        free(trimmed);
+        return -1;
+    }
+    char *inside_raw = substr_copy(p + 1, (size_t)(close - (p - trimmed) - 1));
+    char *inside = trim_copy(inside_raw);
+    free(inside_raw);
+    if (!direct_is_plain_ident(inside)) {
+        free(inside);
+        free(trimmed);
+        return -1;
+    }
+    *binder_out = inside;
+    free(trimmed);
+    return 1;
+}
+
+static int direct_is_option_none_pattern(const char *pattern) {
+    char *trimmed = trim_copy(pattern);
+    const char *s = skip_ws(trimmed);
+    int ok = starts_with(s, "None") && !is_ident_continue(s[4]) && *skip_ws(s + 4) == '\0';
+    free(trimmed);
+    return ok;
+}
+
+static int direct_parse_result_payload_pattern(const char *pattern, const char *variant, char **binder_out) {
+    char *trimmed = trim_copy(pattern);
+    const char *s = skip_ws(trimmed);
+    size_t n = strlen(variant);
+    if (strncmp(s, variant, n) != 0 || is_ident_continue(s[n])) {
+        free(trimmed);
+        return 0;
+    }
+    const char *p = skip_ws(s + n);
+    if (*p != '(') {
+        free(trimmed);
+        return -1;
+    }
+    int close = find_matching_paren_c(trimmed, (int)(p - trimmed));
+    if (close < 0 || *skip_ws(trimmed + close + 1) != '\0') {
+        free(trimmed);
+        return -1;
+    }
+    char *inside_raw = substr_copy(p + 1, (size_t)(close - (p - trimmed) - 1));
+    char *inside = trim_copy(inside_raw);
+    free(inside_raw);
+    if (!direct_is_plain_ident(inside)) {
+        free(inside);
+        free(trimmed);
+        return -1;
+    }
+    *binder_out = inside;
+    free(trimmed);
+    return 1;
+}
+
+static int direct_parse_result_ok_pattern(const char *pattern, char **binder_out) {
+    return direct_parse_result_payload_pattern(pattern, "Ok", binder_out);
+}
+
+static int direct_parse_result_err_pattern(const char *pattern, char **binder_out) {
+    return direct_parse_result_payload_pattern(pattern, "Err", binder_out);
+}
+
+static char *direct_get_opt_payload_type(const char *expr, DirectNameSet *locals) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (!is_ident_start(*s)) {
+        free(trimmed);
+        return strdup("Int");
+    }
+    const char *name_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    char *name = substr_copy(name_start, (size_t)(s - name_start));
+    s = skip_ws(s);
+    if (*s != '.') {
+        free(name);
+        free(trimmed);
+        return strdup("Int");
+    }
+    s = skip_ws(s + 1);
+    if (!starts_with(s, "get_opt") || is_ident_continue(s[7])) {
+        free(name);
+        free(trimmed);
+        return strdup("Int");
+    }
+    s = skip_ws(s + 7);
+    if (*s != '(') {
+        free(name);
+        free(trimmed);
+        return strdup("Int");
+    }
+    int close = find_matching_paren_c(trimmed, (int)(s - trimmed));
+    if (close < 0 || *skip_ws(trimmed + close + 1) != '\0') {
+        free(name);
+        free(trimmed);
+        return strdup("Int");
+    }
+    const char *map_type = direct_names_type(locals, name);
+    const char *value_type = direct_map_value_type(map_type);
+    char *out = strdup(direct_is_str_type(value_type) ? "Str" : "Int");
+    free(name);
+    free(trimmed);
+    return out;
+}
+
+static char *direct_option_match_result_type(const char *some_type, const char *none_type) {
+    if (direct_is_str_type(some_type) && direct_is_str_type(none_type)) return strdup("Str");
+    if (direct_is_intlike_scalar_type(some_type) && direct_is_intlike_scalar_type(none_type)) return strdup("Int");
+    if (some_type != NULL && none_type != NULL && strcmp(some_type, none_type) == 0) return strdup(some_type);
+    return NULL;
+}
+
+static char *direct_translate_trailing_str_len_expr(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *expr,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count
+) {
+    char *prefix = NULL;
+    if (!lower_split_trailing_len_call(expr, &prefix)) return NULL;
+    char *prefix_type = direct_infer_expr_type(prefix, locals, fns, fn_count, structs, struct_count);
+    if (!direct_is_str_type(prefix_type)) {
+        free(prefix_type);
+        free(prefix);
+        return NULL;
+    }
+    free(prefix_type);
+    if (direct_check_expr(path, line_no, line, prefix, locals, fns, fn_count, structs, struct_count)) {
+        free(prefix);
+        return NULL;
+    }
+    char *rewritten = direct_rewrite_expr(path, line_no, line, prefix, locals, fns, fn_count, structs, struct_count);
+    free(prefix);
+    if (rewritten == NULL) return NULL;
+    char *translated = direct_translate_expr(rewritten);
+    free(rewritten);
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, "__vais_str_len(");
+    sb_append(&out, translated);
+    sb_append(&out, ")");
+    free(translated);
+    return sb_take(&out);
+}
+
+static int direct_parse_map_str_str_get_opt_components(
+    const char *expr,
+    DirectNameSet *locals,
+    char **base_out,
+    char **key_out
+) {
+    char *trimmed = trim_copy(expr);
+    const char *s = skip_ws(trimmed);
+    if (!is_ident_start(*s)) {
+        free(trimmed);
+        return 0;
+    }
+    const char *name_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    char *name = substr_copy(name_start, (size_t)(s - name_start));
+    if (!direct_is_map_str_str_type(direct_names_type(locals, name))) {
+        free(name);
+        free(trimmed);
+        return 0;
+    }
+    s = skip_ws(s);
+    if (*s != '.') {
+        free(name);
+        free(trimmed);
+        return 0;
+    }
+    s = skip_ws(s + 1);
+    if (!starts_with(s, "get_opt") || is_ident_continue(s[7])) {
+        free(name);
+        free(trimmed);
+        return 0;
+    }
+    s = skip_ws(s + 7);
+    if (*s != '(') {
+        free(name);
+        free(trimmed);
+        return 0;
+    }
+    int close = find_matching_paren_c(trimmed, (int)(s - trimmed));
+    if (close < 0 || *skip_ws(trimmed + close + 1) != '\0') {
+        free(name);
+        free(trimmed);
+        return 0;
+    }
+    char *inside = substr_copy(s + 1, (size_t)(close - (s - trimmed) - 1));
+    char *args[4] = {0};
+    int argc = split_top_level_commas_c(inside, args, 4);
+    free(inside);
+    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+        for (int i = 0; i < 4; i++) free(args[i]);
+        free(name);
+        free(trimmed);
+        return 0;
+    }
+    *base_out = name;
+    *key_out = trim_copy(args[0]);
+    for (int i = 0; i < 4; i++) free(args[i]);
+    free(trimmed);
+    return 1;
+}
+
+static int direct_emit_map_str_str_option_match_let(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *name,
+    const char *match_expr,
+    const char *payload_tmp,
+    const char *some_c,
+    const char *none_c,
+    const char *result_type,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    char *base = NULL;
+    char *key = NULL;
+    if (!direct_parse_map_str_str_get_opt_components(match_expr, locals, &base, &key)) return 0;
+    char *key_rewritten = direct_rewrite_expr(path, line_no, line, key, locals, fns, fn_count, structs, struct_count);
+    if (key_rewritten == NULL) {
+        free(base);
+        free(key);
+        return -1;
+    }
+    char *key_c = direct_translate_expr(key_rewritten);
+    free(key_rewritten);
+    StrBuf base_ref;
+    sb_init(&base_ref);
+    direct_append_map_ptr_ref(&base_ref, base, direct_names_is_ref(locals, base));
+    char *base_c = sb_take(&base_ref);
+
+    char key_tmp[80];
+    snprintf(key_tmp, sizeof(key_tmp), "__vais_match_key_%d", locals->temp_count++);
+    sb_append(out, direct_c_type(result_type));
+    sb_append(out, " ");
+    sb_append(out, name);
+    sb_append(out, direct_is_str_type(result_type) ? " = NULL;\n" : " = 0;\n");
+    sb_append(out, "{\nStr ");
+    sb_append(out, key_tmp);
+    sb_append(out, " = ");
+    sb_append(out, key_c);
+    sb_append(out, ";\nif (__vais_map_str_str_contains(");
+    sb_append(out, base_c);
+    sb_append(out, ", ");
+    sb_append(out, key_tmp);
+    sb_append(out, ")) {\nStr ");
+    sb_append(out, payload_tmp);
+    sb_append(out, " = __vais_map_str_str_get(");
+    sb_append(out, base_c);
+    sb_append(out, ", ");
+    sb_append(out, key_tmp);
+    sb_append(out, ", \"\");\n");
+    sb_append(out, name);
+    sb_append(out, " = ");
+    sb_append(out, some_c);
+    sb_append(out, ";\n} else {\n");
+    sb_append(out, name);
+    sb_append(out, " = ");
+    sb_append(out, none_c);
+    sb_append(out, ";\n}\n}\n");
+
+    free(base_c);
+    free(key_c);
+    free(base);
+    free(key);
+    return 1;
+}
+
+static int direct_lower_option_match_let(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *name,
+    const char *match_expr,
+    const char *arms_text,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    char *match_value_type = direct_infer_expr_type(match_expr, locals, fns, fn_count, structs, struct_count);
+    int match_is_map_get_opt = strstr(match_expr, "get_opt") != NULL;
+    if (!match_is_map_get_opt && !direct_is_option_int_type(match_value_type)) {
+        report_issue(path, line_no, find_col(line, "match"), line,
+            "direct native emitter supports Option match for Option<Int> or Map.get_opt results",
+            "write `let value = match maybe { Some(v) => v, None => fallback }`.",
+            NULL);
+        free(match_value_type);
+        return 1;
+    }
+    free(match_value_type);
+
+    char *arm_parts[16] = {0};
+    char *patterns[16] = {0};
+    char *exprs[16] = {0};
+    int arm_count = split_top_level_commas_c(arms_text, arm_parts, 16);
+    char *some_binder = NULL;
+    char *some_expr = NULL;
+    char *none_expr = NULL;
+    int failed = 0;
+
+    if (arm_count != 2) {
+        failed = 1;
+    }
+    for (int a = 0; a < arm_count && a < 16 && failed == 0; a++) {
+        if (!parse_arm(arm_parts[a], &patterns[a], &exprs[a])) {
+            failed = 1;
+            break;
+        }
+        char *binder = NULL;
+        int some = direct_parse_option_some_pattern(patterns[a], &binder);
+        if (some == 1) {
+            if (some_binder != NULL || some_expr != NULL) {
+                free(binder);
+                failed = 1;
+                break;
+            }
+            some_binder = binder;
+            some_expr = exprs[a];
+            exprs[a] = NULL;
+        } else if (some < 0) {
+            failed = 1;
+            break;
+        } else if (direct_is_option_none_pattern(patterns[a])) {
+            if (none_expr != NULL) {
+                failed = 1;
+                break;
+            }
+            none_expr = exprs[a];
+            exprs[a] = NULL;
+        } else {
+            failed = 1;
+            break;
+        }
+    }
+    if (some_binder == NULL || some_expr == NULL || none_expr == NULL) failed = 1;
+    if (failed) {
+        report_issue(path, line_no, find_col(line, "match"), line,
+            "direct native emitter supports Option match with one Some arm and one None arm",
+            "write `let value = match m.get_opt(key) { Some(v) => v, None => fallback }`.",
+            NULL);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(some_binder);
+        free(some_expr);
+        free(none_expr);
+        return 1;
+    }
+
+    if (direct_check_expr(path, line_no, line, match_expr, locals, fns, fn_count, structs, struct_count)) {
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(some_binder);
+        free(some_expr);
+        free(none_expr);
+        return 1;
+    }
+    char *match_rewritten = direct_rewrite_expr(path, line_no, line, match_expr, locals, fns, fn_count, structs, struct_count);
+    if (match_rewritten == NULL) {
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(some_binder);
+        free(some_expr);
+        free(none_expr);
+        return 1;
+    }
+    char *match_c = direct_translate_expr(match_rewritten);
+    free(match_rewritten);
+
+    char match_tmp[80];
+    char payload_tmp[80];
+    snprintf(match_tmp, sizeof(match_tmp), "__vais_match_%d", locals->temp_count++);
+    snprintf(payload_tmp, sizeof(payload_tmp), "__vais_match_payload_%d", locals->temp_count++);
+
+    char *payload_type = match_is_map_get_opt ? direct_get_opt_payload_type(match_expr, locals) : strdup("Int");
+    char *some_bound = replace_word_all(some_expr, some_binder, payload_tmp);
+    direct_names_add_typed(locals, payload_tmp, payload_type);
+    int some_bad = direct_check_expr(path, line_no, line, some_bound, locals, fns, fn_count, structs, struct_count);
+    char *some_type = some_bad ? NULL : direct_infer_expr_type(some_bound, locals, fns, fn_count, structs, struct_count);
+    char *some_rewritten = some_bad ? NULL : direct_rewrite_expr(path, line_no, line, some_bound, locals, fns, fn_count, structs, struct_count);
+    char *some_len_c = some_bad ? NULL : direct_translate_trailing_str_len_expr(path, line_no, line, some_bound, locals, fns, fn_count, structs, struct_count);
+    direct_names_remove(locals, payload_tmp);
+    free(some_bound);
+    if (some_bad || some_rewritten == NULL) {
+        free(match_c);
+        free(payload_type);
+        free(some_type);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(some_binder);
+        free(some_expr);
+        free(none_expr);
+        free(some_rewritten);
+        return 1;
+    }
+    char *some_c = some_len_c == NULL ? direct_translate_expr(some_rewritten) : some_len_c;
+    free(some_rewritten);
+
+    int none_bad = direct_check_expr(path, line_no, line, none_expr, locals, fns, fn_count, structs, struct_count);
+    char *none_type = none_bad ? NULL : direct_infer_expr_type(none_expr, locals, fns, fn_count, structs, struct_count);
+    char *none_rewritten = none_bad ? NULL : direct_rewrite_expr(path, line_no, line, none_expr, locals, fns, fn_count, structs, struct_count);
+    char *none_len_c = none_bad ? NULL : direct_translate_trailing_str_len_expr(path, line_no, line, none_expr, locals, fns, fn_count, structs, struct_count);
+    if (none_bad || none_rewritten == NULL) {
+        free(match_c);
+        free(payload_type);
+        free(some_type);
+        free(none_type);
+        free(some_c);
+        free(none_len_c);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(some_binder);
+        free(some_expr);
+        free(none_expr);
+        free(none_rewritten);
+        return 1;
+    }
+    char *none_c = none_len_c == NULL ? direct_translate_expr(none_rewritten) : none_len_c;
+    free(none_rewritten);
+
+    char *result_type = direct_option_match_result_type(some_type, none_type);
+    if (result_type == NULL) {
+        report_issue(path, line_no, find_col(line, "match"), line,
+            "direct native emitter Option match arms must produce the same scalar type",
+            "return matching Int-compatible values or matching Str values from the Some and None arms.",
+            NULL);
+        free(match_c);
+        free(payload_type);
+        free(some_type);
+        free(none_type);
+        free(some_c);
+        free(none_c);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(some_binder);
+        free(some_expr);
+        free(none_expr);
+        return 1;
+    }
+
+    int emitted = 0;
+    if (direct_is_str_type(payload_type)) {
+        emitted = direct_emit_map_str_str_option_match_let(
+            path,
+            line_no,
+            line,
+            name,
+            match_expr,
+            payload_tmp,
+            some_c,
+            none_c,
+            result_type,
+            locals,
+            fns,
+            fn_count,
+            structs,
+            struct_count,
+            out
+        );
+        if (emitted < 0) {
+            free(match_c);
+            free(payload_type);
+            free(result_type);
+            free(some_type);
+            free(none_type);
+            free(some_c);
+            free(none_c);
+            for (int k = 0; k < 16; k++) {
+                free(arm_parts[k]);
+                free(patterns[k]);
+                free(exprs[k]);
+            }
+            free(some_binder);
+            free(some_expr);
+            free(none_expr);
+            return 1;
+        }
+    }
+    if (!emitted) {
+        sb_append(out, direct_c_type(result_type));
+        sb_append(out, " ");
+        sb_append(out, name);
+        sb_append(out, direct_is_str_type(result_type) ? " = NULL;\n" : " = 0;\n");
+        sb_append(out, "{\nlong ");
+        sb_append(out, match_tmp);
+        sb_append(out, " = ");
+        sb_append(out, match_c);
+        sb_append(out, ";\nif (");
+        sb_append(out, match_tmp);
+        sb_append(out, " % 2 == 0) {\n");
+        sb_append(out, direct_c_type(payload_type));
+        sb_append(out, " ");
+        sb_append(out, payload_tmp);
+        if (direct_is_str_type(payload_type)) {
+            sb_append(out, " = (Str)");
+            sb_append(out, match_tmp);
+            sb_append(out, ";\n");
+        } else {
+            sb_append(out, " = (");
+            sb_append(out, match_tmp);
+            sb_append(out, " / 2) % 1000000;\n");
+        }
+        sb_append(out, name);
+        sb_append(out, " = ");
+        sb_append(out, some_c);
+        sb_append(out, ";\n} else {\n");
+        sb_append(out, name);
+        sb_append(out, " = ");
+        sb_append(out, none_c);
+        sb_append(out, ";\n}\n}\n");
+    }
+    direct_names_add_typed(locals, name, result_type);
+
+    free(match_c);
+    free(payload_type);
+    free(result_type);
+    free(some_type);
+    free(none_type);
+    free(some_c);
+    free(none_c);
+    for (int k = 0; k < 16; k++) {
+        free(arm_parts[k]);
+        free(patterns[k]);
+        free(exprs[k]);
+    }
+    free(some_binder);
+    free(some_expr);
+    free(none_expr);
+    return 0;
+}
+
+static int direct_lower_result_match_let(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *name,
+    const char *match_expr,
+    const char *arms_text,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    char *match_value_type = direct_infer_expr_type(match_expr, locals, fns, fn_count, structs, struct_count);
+    if (!direct_is_result_int_int_type(match_value_type)) {
+        report_issue(path, line_no, find_col(line, "match"), line,
+            "direct native emitter supports Result match for Result<Int,Int> values",
+            "write `let value = match result { Ok(v) => v, Err(e) => e }`.",
+            NULL);
+        free(match_value_type);
+        return 1;
+    }
+    free(match_value_type);
+
+    char *arm_parts[16] = {0};
+    char *patterns[16] = {0};
+    char *exprs[16] = {0};
+    int arm_count = split_top_level_commas_c(arms_text, arm_parts, 16);
+    char *ok_binder = NULL;
+    char *err_binder = NULL;
+    char *ok_expr = NULL;
+    char *err_expr = NULL;
+    int failed = 0;
+
+    if (arm_count != 2) failed = 1;
+    for (int a = 0; a < arm_count && a < 16 && failed == 0; a++) {
+        if (!parse_arm(arm_parts[a], &patterns[a], &exprs[a])) {
+            failed = 1;
+            break;
+        }
+        char *binder = NULL;
+        int ok = direct_parse_result_ok_pattern(patterns[a], &binder);
+        if (ok == 1) {
+            if (ok_binder != NULL || ok_expr != NULL) {
+                free(binder);
+                failed = 1;
+                break;
+            }
+            ok_binder = binder;
+            ok_expr = exprs[a];
+            exprs[a] = NULL;
+        } else if (ok < 0) {
+            failed = 1;
+            break;
+        } else {
+            int err = direct_parse_result_err_pattern(patterns[a], &binder);
+            if (err == 1) {
+                if (err_binder != NULL || err_expr != NULL) {
+                    free(binder);
+                    failed = 1;
+                    break;
+                }
+                err_binder = binder;
+                err_expr = exprs[a];
+                exprs[a] = NULL;
+            } else if (err < 0) {
+                failed = 1;
+                break;
+            } else {
+                failed = 1;
+                break;
+            }
+        }
+    }
+    if (ok_binder == NULL || ok_expr == NULL || err_binder == NULL || err_expr == NULL) failed = 1;
+    if (failed) {
+        report_issue(path, line_no, find_col(line, "match"), line,
+            "direct native emitter supports Result match with one Ok arm and one Err arm",
+            "write `let value = match result { Ok(v) => v, Err(e) => e }`.",
+            NULL);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(ok_binder);
+        free(err_binder);
+        free(ok_expr);
+        free(err_expr);
+        return 1;
+    }
+
+    if (direct_check_expr(path, line_no, line, match_expr, locals, fns, fn_count, structs, struct_count)) {
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(ok_binder);
+        free(err_binder);
+        free(ok_expr);
+        free(err_expr);
+        return 1;
+    }
+    char *match_rewritten = direct_rewrite_expr(path, line_no, line, match_expr, locals, fns, fn_count, structs, struct_count);
+    if (match_rewritten == NULL) {
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(ok_binder);
+        free(err_binder);
+        free(ok_expr);
+        free(err_expr);
+        return 1;
+    }
+    char *match_c = direct_translate_expr(match_rewritten);
+    free(match_rewritten);
+
+    char match_tmp[80];
+    char ok_tmp[80];
+    char err_tmp[80];
+    snprintf(match_tmp, sizeof(match_tmp), "__vais_match_%d", locals->temp_count++);
+    snprintf(ok_tmp, sizeof(ok_tmp), "__vais_match_ok_%d", locals->temp_count++);
+    snprintf(err_tmp, sizeof(err_tmp), "__vais_match_err_%d", locals->temp_count++);
+
+    char *ok_bound = replace_word_all(ok_expr, ok_binder, ok_tmp);
+    direct_names_add_typed(locals, ok_tmp, "Int");
+    int ok_bad = direct_check_expr(path, line_no, line, ok_bound, locals, fns, fn_count, structs, struct_count);
+    char *ok_type = ok_bad ? NULL : direct_infer_expr_type(ok_bound, locals, fns, fn_count, structs, struct_count);
+    char *ok_rewritten = ok_bad ? NULL : direct_rewrite_expr(path, line_no, line, ok_bound, locals, fns, fn_count, structs, struct_count);
+    direct_names_remove(locals, ok_tmp);
+    free(ok_bound);
+    if (ok_bad || ok_rewritten == NULL) {
+        free(match_c);
+        free(ok_type);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(ok_binder);
+        free(err_binder);
+        free(ok_expr);
+        free(err_expr);
+        free(ok_rewritten);
+        return 1;
+    }
+    char *ok_c = direct_translate_expr(ok_rewritten);
+    free(ok_rewritten);
+
+    char *err_bound = replace_word_all(err_expr, err_binder, err_tmp);
+    direct_names_add_typed(locals, err_tmp, "Int");
+    int err_bad = direct_check_expr(path, line_no, line, err_bound, locals, fns, fn_count, structs, struct_count);
+    char *err_type = err_bad ? NULL : direct_infer_expr_type(err_bound, locals, fns, fn_count, structs, struct_count);
+    char *err_rewritten = err_bad ? NULL : direct_rewrite_expr(path, line_no, line, err_bound, locals, fns, fn_count, structs, struct_count);
+    direct_names_remove(locals, err_tmp);
+    free(err_bound);
+    if (err_bad || err_rewritten == NULL) {
+        free(match_c);
+        free(ok_type);
+        free(err_type);
+        free(ok_c);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(ok_binder);
+        free(err_binder);
+        free(ok_expr);
+        free(err_expr);
+        free(err_rewritten);
+        return 1;
+    }
+    char *err_c = direct_translate_expr(err_rewritten);
+    free(err_rewritten);
+
+    char *result_type = direct_option_match_result_type(ok_type, err_type);
+    if (result_type == NULL) {
+        report_issue(path, line_no, find_col(line, "match"), line,
+            "direct native emitter Result match arms must produce the same scalar type",
+            "return matching Int-compatible values or matching Str values from the Ok and Err arms.",
+            NULL);
+        free(match_c);
+        free(ok_type);
+        free(err_type);
+        free(ok_c);
+        free(err_c);
+        for (int k = 0; k < 16; k++) {
+            free(arm_parts[k]);
+            free(patterns[k]);
+            free(exprs[k]);
+        }
+        free(ok_binder);
+        free(err_binder);
+        free(ok_expr);
+        free(err_expr);
+        return 1;
+    }
+
+    sb_append(out, direct_c_type(result_type));
+    sb_append(out, " ");
+    sb_append(out, name);
+    sb_append(out, direct_is_str_type(result_type) ? " = NULL;\n" : " = 0;\n");
+    sb_append(out, "{\nlong ");
+    sb_append(out, match_tmp);
+    sb_append(out, " = ");
+    sb_append(out, match_c);
+    sb_append(out, ";\nif (");
+    sb_append(out, match_tmp);
+    sb_append(out, " % 2 == 0) {\nlong ");
+    sb_append(out, ok_tmp);
+    sb_append(out, " = (");
+    sb_append(out, match_tmp);
+    sb_append(out, " / 2) % 1000000;\n");
+    sb_append(out, name);
+    sb_append(out, " = ");
+    sb_append(out, ok_c);
+    sb_append(out, ";\n} else {\nlong ");
+    sb_append(out, err_tmp);
+    sb_append(out, " = (");
+    sb_append(out, match_tmp);
+    sb_append(out, " / 2) % 1000000;\n");
+    sb_append(out, name);
+    sb_append(out, " = ");
+    sb_append(out, err_c);
+    sb_append(out, ";\n}\n}\n");
+    direct_names_add_typed(locals, name, result_type);
+
+    free(match_c);
+    free(ok_type);
+    free(err_type);
+    free(result_type);
+    free(ok_c);
+    free(err_c);
+    for (int k = 0; k < 16; k++) {
+        free(arm_parts[k]);
+        free(patterns[k]);
+        free(exprs[k]);
+    }
+    free(ok_binder);
+    free(err_binder);
+    free(ok_expr);
+    free(err_expr);
+    return 0;
+}
+
+static int direct_parse_named_call_statement(const char *s, const char *name, char **args_out) {
+    size_t name_len = strlen(name);
+    if (strncmp(s, name, name_len) != 0 || is_ident_continue(s[name_len])) return 0;
+    const char *p = skip_ws(s + name_len);
+    if (*p != '(') return -1;
+    int close = find_matching_paren_c(s, (int)(p - s));
+    if (close < 0) return -1;
+    const char *after = skip_ws(s + close + 1);
+    if (*after == ';') after = skip_ws(after + 1);
+    if (*after != '\0') return -1;
+    *args_out = substr_copy(p + 1, (size_t)(close - (p - s) - 1));
+    return 1;
+}
+
+static char *direct_strip_try_suffix(const char *expr) {
+    char *trimmed = trim_copy(expr);
+    size_t n = strlen(trimmed);
+    if (n == 0 || trimmed[n - 1] != '?') {
+        free(trimmed);
+        return NULL;
+    }
+    trimmed[n - 1] = '\0';
+    char *inner = trim_copy(trimmed);
+    free(trimmed);
+    if (inner[0] == '\0') {
+        free(inner);
+        return NULL;
+    }
+    return inner;
+}
+
+static void sb_append_printf_literal_byte(StrBuf *out, char ch) {
+    if (ch == '%') {
+        sb_append(out, "%%");
+    } else {
+        sb_append_c_escaped_byte(out, ch);
+    }
+}
+
+static int direct_append_print_interpolation(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *arg,
+    DirectNameSet *locals,
+    StrBuf *out,
+    int *handled
+) {
+    *handled = 0;
+    char *trimmed = trim_copy(arg);
+    const char *s = skip_ws(trimmed);
+    if (!direct_expr_is_string_literal(s)) {
+        free(trimmed);
+        return 0;
+    }
+    int end = skip_string_literal_c(s, 0);
+    int has_interpolation = 0;
+    for (int i = 1; i < end - 1; i++) {
+        if (s[0] == '"' && s[i] == '\\' && i + 1 < end - 1) {
+            i++;
+            continue;
+        }
+        if (s[i] == '{') {
+            has_interpolation = 1;
+            break;
+        }
+    }
+    if (!has_interpolation) {
+        free(trimmed);
+        return 0;
+    }
+
+    StrBuf fmt;
+    StrBuf args;
+    sb_init(&fmt);
+    sb_init(&args);
+    sb_append(&fmt, "\"");
+    for (int i = 1; i < end - 1;) {
+        if (s[0] == '"' && s[i] == '\\' && i + 1 < end - 1) {
+            i++;
+            sb_append_printf_literal_byte(&fmt, s[i]);
+            i++;
+            continue;
+        }
+        if (s[i] == '{') {
+            int close = i + 1;
+            while (close < end - 1 && s[close] != '}') close++;
+            if (close >= end - 1) {
+                report_issue(path, line_no, find_col(line, "{"), line,
+                    "direct native emitter print interpolation is missing `}`",
+                    "write placeholders as `{name}` inside the string literal.",
+                    NULL);
+                free(fmt.data);
+                free(args.data);
+                free(trimmed);
+                return 1;
+            }
+            char *raw = substr_copy(s + i + 1, (size_t)(close - i - 1));
+            char *name = trim_copy(raw);
+            free(raw);
+            if (!direct_is_plain_ident(name)) {
+                report_issue(path, line_no, find_col(line, "{"), line,
+                    "direct native emitter print interpolation supports simple identifiers",
+                    "write placeholders as `{name}` for a local Int, Bool, Char, or Str value.",
+                    NULL);
+                free(name);
+                free(fmt.data);
+                free(args.data);
+                free(trimmed);
+                return 1;
+            }
+            const char *ty = direct_names_type(locals, name);
+            if (ty == NULL) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter print interpolation name is not a known local",
+                    "define the value with `let` or pass it as a parameter before printing it.",
+                    NULL);
+                free(name);
+                free(fmt.data);
+                free(args.data);
+                free(trimmed);
+                return 1;
+            }
+            if (direct_is_str_type(ty)) {
+                sb_append(&fmt, "%s");
+            } else if (direct_is_intlike_scalar_type(ty)) {
+                sb_append(&fmt, "%ld");
+            } else {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter print interpolation supports scalar and Str values",
+                    "interpolate an Int, Bool, Char, or Str value.",
+                    NULL);
+                free(name);
+                free(fmt.data);
+                free(args.data);
+                free(trimmed);
+                return 1;
+            }
+            sb_append(&args, ", ");
+            sb_append(&args, name);
+            free(name);
+            i = close + 1;
+            continue;
+        }
+        if (s[i] == '}') {
+            report_issue(path, line_no, find_col(line, "}"), line,
+                "direct native emitter print interpolation found an unmatched `}`",
+                "write placeholders as `{name}` inside the string literal.",
+                NULL);
+            free(fmt.data);
+            free(args.data);
+            free(trimmed);
+            return 1;
+        }
+        sb_append_printf_literal_byte(&fmt, s[i]);
+        i++;
+    }
+    sb_append(&fmt, "\\n\"");
+    sb_append(out, "printf(");
+    sb_append(out, fmt.data);
+    sb_append(out, args.data);
+    sb_append(out, ");\n");
+    free(fmt.data);
+    free(args.data);
+    free(trimmed);
+    *handled = 1;
+    return 0;
+}
+
+static int direct_lower_print_statement(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *args_text,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    char *args[16] = {0};
+    int argc = split_top_level_commas_c(args_text, args, 16);
+    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+        report_issue(path, line_no, find_col(line, "print"), line,
+            "direct native emitter print expects one Str argument",
+            "write `print(\"text\")` or `print(\"value={name}\")`.",
+            NULL);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    int handled = 0;
+    if (direct_append_print_interpolation(path, line_no, line, args[0], locals, out, &handled)) {
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    if (handled) {
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 0;
+    }
+    if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count)) {
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+    if (!direct_is_str_type(arg_type)) {
+        report_issue(path, line_no, find_col(line, "print"), line,
+            "direct native emitter print expects a Str argument",
+            "print a string literal or Str value; use interpolation for scalar values.",
+            "print(\"value={x}\")");
+        free(arg_type);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    free(arg_type);
+    StrBuf prelude;
+    sb_init(&prelude);
+    direct_current_prelude = &prelude;
+    char *rewritten = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+    direct_current_prelude = NULL;
+    if (rewritten == NULL) {
+        free(prelude.data);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    char *c_arg = direct_translate_expr(rewritten);
+    sb_append(out, prelude.data);
+    sb_append(out, "puts(");
+    sb_append(out, c_arg);
+    sb_append(out, ");\n");
+    free(prelude.data);
+    free(c_arg);
+    free(rewritten);
+    for (int k = 0; k < 16; k++) free(args[k]);
+    return 0;
+}
+
+static int direct_lower_putchar_statement(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *args_text,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    char *args[16] = {0};
+    int argc = split_top_level_commas_c(args_text, args, 16);
+    if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+        report_issue(path, line_no, find_col(line, "putchar"), line,
+            "direct native emitter putchar expects one Int-compatible argument",
+            "write `putchar(33)` or pass an Int, Bool, or Char value.",
+            NULL);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count)) {
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+    if (!direct_type_compatible("Int", arg_type)) {
+        report_issue(path, line_no, find_col(line, "putchar"), line,
+            "direct native emitter putchar expects an Int-compatible argument",
+            "pass an Int, Bool, or Char value.",
+            "putchar(33)");
+        free(arg_type);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    free(arg_type);
+    StrBuf prelude;
+    sb_init(&prelude);
+    direct_current_prelude = &prelude;
+    char *rewritten = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+    direct_current_prelude = NULL;
+    if (rewritten == NULL) {
+        free(prelude.data);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    char *c_arg = direct_translate_expr(rewritten);
+    sb_append(out, prelude.data);
+    sb_append(out, "putchar((int)(");
+    sb_append(out, c_arg);
+    sb_append(out, "));\n");
+    free(prelude.data);
+    free(c_arg);
+    free(rewritten);
+    for (int k = 0; k < 16; k++) free(args[k]);
+    return 0;
+}
+
+/* The compiler core's vais_emit_* output hooks, lowered as statements so a
+   direct build of fixpoint_full.vais links the host runtime's stdio versions,
+   and the `__vais_prof_*` markers `--instrument` inserts. Parameter types are
+   listed comma-separated. */
+static const char *direct_output_hook_params(const char *name) {
+    if (strcmp(name, "vais_emit_str") == 0) return "Str";
+    if (strcmp(name, "vais_emit_bytes") == 0) return "Str,Int,Int";
+    if (strcmp(name, "vais_emit_byte") == 0) return "Int";
+    if (strcmp(name, "vais_emit_int") == 0) return "Int";
+    if (strcmp(name, "vais_emit_entry") == 0) return "";
+    if (strcmp(name, "vais_emit_linkage") == 0) return "";
+    if (strcmp(name, "__vais_prof_fn") == 0) return "Int,Str";
+    if (strcmp(name, "__vais_prof_loop") == 0) return "Int,Str";
+    if (strcmp(name, "__vais_prof_iter") == 0) return "Int";
+    if (strcmp(name, "__vais_prof_loop_end") == 0) return "Int";
+    if (strcmp(name, "__vais_prof_site") == 0) return "Int,Str";
+    return NULL;
+}
+
+static int direct_lower_output_hook_statement(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *name,
+    const char *args_text,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    const char *params = direct_output_hook_params(name);
+    int want = params[0] == '\0' ? 0 : 1;
+    for (const char *p = params; *p; p++) if (*p == ',') want++;
+    char *args[16] = {0};
+    int argc = want == 0 && skip_ws(args_text)[0] == '\0' ? 0 : split_top_level_commas_c(args_text, args, 16);
+    int bad = argc != want;
+    for (int a = 0; !bad && a < argc; a++) {
+        if (args[a] == NULL || strlen(skip_ws(args[a])) == 0) bad = 1;
+    }
+    if (bad) {
+        report_issue(path, line_no, find_col(line, name), line,
+            "direct native emitter output hook has the wrong number of arguments",
+            "write `vais_emit_str(text)`, `vais_emit_bytes(text, start, len)`, `vais_emit_byte(c)`, `vais_emit_int(value)`, `vais_emit_entry()`, or `vais_emit_linkage()`.",
+            NULL);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        return 1;
+    }
+    StrBuf prelude;
+    sb_init(&prelude);
+    StrBuf call;
+    sb_init(&call);
+    sb_append(&call, name);
+    sb_append(&call, "(");
+    const char *param = params;
+    int rc = 0;
+    for (int a = 0; a < argc; a++) {
+        const char *comma = strchr(param, ',');
+        char *want_type = comma == NULL ? strdup(param) : substr_copy(param, (size_t)(comma - param));
+        param = comma == NULL ? param + strlen(param) : comma + 1;
+        if (direct_check_expr(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count)) {
+            free(want_type);
+            rc = 1;
+            break;
+        }
+        char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+        if (!direct_type_compatible(want_type, arg_type)) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter output hook argument has the wrong type",
+                "pass Str text and Int offsets, lengths, and byte values.",
+                NULL);
+            free(arg_type);
+            free(want_type);
+            rc = 1;
+            break;
+        }
+        free(arg_type);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(want_type);
+            rc = 1;
+            break;
+        }
+        char *c_arg = direct_translate_expr(rewritten);
+        if (a > 0) sb_append(&call, ", ");
+        sb_append(&call, direct_is_str_type(want_type) ? "(" : "(int64_t)(");
+        sb_append(&call, c_arg);
+        sb_append(&call, ")");
+        free(c_arg);
+        free(rewritten);
+        free(want_type);
+    }
+    if (rc == 0) {
+        sb_append(out, prelude.data);
+        sb_append(out, call.data);
+        sb_append(out, ");\n");
+    }
+    free(prelude.data);
+    free(call.data);
+    for (int k = 0; k < 16; k++) free(args[k]);
+    return rc;
+}
+
+static int direct_lower_inline_body(
+    const char *path,
+    int line_no,
+    const char *line,
+    const char *body,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    int start = 0;
+    int paren_depth = 0;
+    int square_depth = 0;
+    int brace_depth = 0;
+    char delim = '\0';
+    int escaped = 0;
+    int rc = 0;
+    int len = (int)strlen(body);
+    for (int i = 0; i <= len; i++) {
+        char ch = body[i];
+        int split = ch == '\0';
+        if (!split) {
+            if (escaped) {
+                escaped = 0;
+            } else if ((delim == '"' || delim == '\'') && ch == '\\') {
+                escaped = 1;
+            } else if (ch == '"' || ch == '\'' || ch == '`') {
+                if (delim == '\0') delim = ch;
+                else if (delim == ch) delim = '\0';
+            } else if (delim == '\0') {
+                if (ch == '(') paren_depth++;
+                else if (ch == ')' && paren_depth > 0) paren_depth--;
+                else if (ch == '[') square_depth++;
+                else if (ch == ']' && square_depth > 0) square_depth--;
+                else if (ch == '{') brace_depth++;
+                else if (ch == '}' && brace_depth > 0) brace_depth--;
+                else if (ch == ';' && paren_depth == 0 && square_depth == 0 && brace_depth == 0) split = 1;
+            }
+        }
+        if (!split) continue;
+        char *part_raw = substr_copy(body + start, (size_t)(i - start));
+        char *part = trim_copy(part_raw);
+        free(part_raw);
+        if (part[0] != '\0') {
+            rc = direct_lower_line(path, line_no, part, locals, fns, fn_count, structs, struct_count, out);
+        }
+        free(part);
+        if (rc != 0) return rc;
+        start = i + 1;
+    }
+    return 0;
+}
+
+static int direct_has_top_level_statement_separator(const char *body) {
+    int paren_depth = 0;
+    int square_depth = 0;
+    int brace_depth = 0;
+    char delim = '\0';
+    int escaped = 0;
+    for (int i = 0; body[i] != '\0'; i++) {
+        char ch = body[i];
+        if (escaped) {
+            escaped = 0;
+        } else if ((delim == '"' || delim == '\'') && ch == '\\') {
+            escaped = 1;
+        } else if (ch == '"' || ch == '\'' || ch == '`') {
+            if (delim == '\0') delim = ch;
+            else if (delim == ch) delim = '\0';
+        } else if (delim == '\0') {
+            if (ch == '(') paren_depth++;
+            else if (ch == ')' && paren_depth > 0) paren_depth--;
+            else if (ch == '[') square_depth++;
+            else if (ch == ']' && square_depth > 0) square_depth--;
+            else if (ch == '{') brace_depth++;
+            else if (ch == '}' && brace_depth > 0) brace_depth--;
+            else if (ch == ';' && paren_depth == 0 && square_depth == 0 && brace_depth == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+static int direct_lower_line(
+    const char *path,
+    int line_no,
+    const char *line,
+    DirectNameSet *locals,
+    DirectFnInfo *fns,
+    int fn_count,
+    DirectStructInfo *structs,
+    int struct_count,
+    StrBuf *out
+) {
+    char *stripped = strip_line_comment(line, strlen(line));
+    const char *s = skip_ws(stripped);
+    if (*s == '\0') {
+        free(stripped);
+        return 0;
+    }
+    if (direct_has_top_level_statement_separator(s)) {
+        int rc = direct_lower_inline_body(path, line_no, line, s, locals, fns, fn_count, structs, struct_count, out);
+        free(stripped);
+        return rc;
+    }
+
+    DirectFnInfo header;
+    int parsed_header = parse_direct_fn_header(stripped, &header);
+    if (parsed_header == 1) {
+        direct_names_free(locals);
+        locals->current_return_type = strdup(header.return_type);
+        for (int p = 0; p < header.param_count; p++) {
+            direct_names_add_typed_ref(locals, header.params[p], header.param_types[p], direct_is_list_type(header.param_types[p]) || direct_is_map_type(header.param_types[p]));
+        }
+        sb_append(out, direct_c_type(header.return_type));
+        sb_append(out, " ");
+        sb_append(out, header.name);
+        if (vaisc_instrument) sb_append(out, "__vais_prof");
+        sb_append(out, "(");
+        for (int p = 0; p < header.param_count; p++) {
+            if (p > 0) sb_append(out, ", ");
+            sb_append(out, direct_c_param_type(header.param_types[p]));
+            sb_append(out, " ");
+            sb_append(out, header.params[p]);
+        }
+        sb_append(out, ") {\n");
+        const char *fn_open = strchr(stripped, '{');
+        if (fn_open != NULL) {
+            int fn_open_abs = (int)(fn_open - stripped);
+            int fn_close_abs = find_matching_brace_c(stripped, fn_open_abs);
+            if (fn_close_abs >= 0 && *skip_ws(stripped + fn_close_abs + 1) == '\0') {
+                char *body_raw = substr_copy(stripped + fn_open_abs + 1, (size_t)(fn_close_abs - fn_open_abs - 1));
+                char *body = trim_copy(body_raw);
+                free(body_raw);
+                int body_rc = 0;
+                if (body[0] != '\0') {
+                    body_rc = direct_lower_inline_body(path, line_no, line, body, locals, fns, fn_count, structs, struct_count, out);
+                }
+                sb_append(out, "}\n");
+                free(body);
+                direct_fns_free(&header, 1);
+                free(stripped);
+                return body_rc;
+            }
+        }
+        direct_fns_free(&header, 1);
+        free(stripped);
+        return 0;
+    }
+    if (parsed_header < 0 || starts_with(s, "fn ")) {
+        report_issue(path, line_no, find_col(line, "fn"), line,
+            "direct native emitter supports scalar/List/Struct function headers, verified concrete Map returns, and verified Map parameters",
+            "write functions with `Int`, `Bool`, `Char`, `Str`, `List<Int>`, `List<Struct>`, declared struct types, or verified concrete Map parameters/returns such as `Map<Int,Int>` or `Map<Str,Str>`.",
+            NULL);
+        free(stripped);
+        return 1;
+    }
+
+    if (strcmp(s, "}") == 0) {
+        sb_append(out, "}\n");
+        free(stripped);
+        return 0;
+    }
+    if (starts_with(s, "} else if ")) {
+        char *close_inline_expr = NULL;
+        char *close_inline_body = NULL;
+        if (direct_parse_inline_block(skip_ws(s + 1), "else if", &close_inline_expr, &close_inline_body)) {
+            if (close_inline_expr == NULL || close_inline_body == NULL ||
+                direct_check_expr(path, line_no, line, close_inline_expr, locals, fns, fn_count, structs, struct_count)) {
+                free(close_inline_expr);
+                free(close_inline_body);
+                free(stripped);
+                return 1;
+            }
+            StrBuf prelude;
+            sb_init(&prelude);
+            direct_current_prelude = &prelude;
+            char *rewritten = direct_rewrite_expr(path, line_no, line, close_inline_expr, locals, fns, fn_count, structs, struct_count);
+            direct_current_prelude = NULL;
+            if (rewritten == NULL) {
+                free(prelude.data);
+                free(close_inline_expr);
+                free(close_inline_body);
+                free(stripped);
+                return 1;
+            }
+            char *c_expr = direct_translate_expr(rewritten);
+            sb_append(out, prelude.data);
+            sb_append(out, "} else if (");
+            sb_append(out, c_expr);
+            sb_append(out, ") {\n");
+            int body_rc = direct_lower_inline_body(path, line_no, line, close_inline_body, locals, fns, fn_count, structs, struct_count, out);
+            sb_append(out, "}\n");
+            free(prelude.data);
+            free(c_expr);
+            free(rewritten);
+            free(close_inline_expr);
+            free(close_inline_body);
+            free(stripped);
+            return body_rc;
+        }
+        char *expr = direct_after_keyword_expr(s + 2, "else if", '{');
+        if (expr == NULL || direct_check_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count)) {
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *rewritten = direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        if (rewritten == NULL) {
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, "} else if (");
+        sb_append(out, c_expr);
+        sb_append(out, ") {\n");
+        free(c_expr);
+        free(rewritten);
+        free(expr);
+        free(stripped);
+        return 0;
+    }
+    if (starts_with(s, "} else")) {
+        const char *after_close = skip_ws(s + 1);
+        if (starts_with(after_close, "else") && !is_ident_continue(after_close[4])) {
+            const char *after_else = skip_ws(after_close + 4);
+            if (*after_else == '{') {
+                int close_abs = find_matching_brace_c(after_close, (int)(after_else - after_close));
+                if (close_abs >= 0 && *skip_ws(after_close + close_abs + 1) == '\0') {
+                    char *body_raw = substr_copy(after_else + 1, (size_t)(close_abs - (int)(after_else - after_close) - 1));
+                    char *body = trim_copy(body_raw);
+                    free(body_raw);
+                    sb_append(out, "} else {\n");
+                    int body_rc = 0;
+                    if (body[0] != '\0') {
+                        body_rc = direct_lower_inline_body(path, line_no, line, body, locals, fns, fn_count, structs, struct_count, out);
+                    }
+                    sb_append(out, "}\n");
+                    free(body);
+                    free(stripped);
+                    return body_rc;
+                }
+            }
+        }
+        sb_append(out, "} else {\n");
+        free(stripped);
+        return 0;
+    }
+    char *inline_expr = NULL;
+    char *inline_body = NULL;
+    char *inline_else_body = NULL;
+    if (direct_parse_inline_cond_else(s, "else if", &inline_expr, &inline_body, &inline_else_body)) {
+        if (inline_expr == NULL || inline_body == NULL || inline_else_body == NULL ||
+            direct_check_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count)) {
+            free(inline_expr);
+            free(inline_body);
+            free(inline_else_body);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(inline_expr);
+            free(inline_body);
+            free(inline_else_body);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        sb_append(out, "else if (");
+        sb_append(out, c_expr);
+        sb_append(out, ") {\n");
+        int then_rc = direct_lower_inline_body(path, line_no, line, inline_body, locals, fns, fn_count, structs, struct_count, out);
+        int else_rc = then_rc;
+        const char *else_trim = skip_ws(inline_else_body);
+        if (then_rc == 0 && starts_with(else_trim, "if") && !is_ident_continue(else_trim[2])) {
+            sb_append(out, "} else ");
+            else_rc = direct_lower_line(path, line_no, inline_else_body, locals, fns, fn_count, structs, struct_count, out);
+        } else {
+            sb_append(out, "} else {\n");
+            if (then_rc == 0) else_rc = direct_lower_inline_body(path, line_no, line, inline_else_body, locals, fns, fn_count, structs, struct_count, out);
+            sb_append(out, "}\n");
+        }
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(inline_expr);
+        free(inline_body);
+        free(inline_else_body);
+        free(stripped);
+        return then_rc != 0 ? then_rc : else_rc;
+    }
+    if (direct_parse_inline_block(s, "else if", &inline_expr, &inline_body)) {
+        if (inline_expr == NULL || inline_body == NULL ||
+            direct_check_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count)) {
+            free(inline_expr);
+            free(inline_body);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(inline_expr);
+            free(inline_body);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        sb_append(out, "else if (");
+        sb_append(out, c_expr);
+        sb_append(out, ") {\n");
+        int body_rc = direct_lower_inline_body(path, line_no, line, inline_body, locals, fns, fn_count, structs, struct_count, out);
+        sb_append(out, "}\n");
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(inline_expr);
+        free(inline_body);
+        free(stripped);
+        return body_rc;
+    }
+    if (starts_with(s, "else if ")) {
+        char *expr = direct_after_keyword_expr(s, "else if", '{');
+        if (expr == NULL || direct_check_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count)) {
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *rewritten = direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        if (rewritten == NULL) {
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, "else if (");
+        sb_append(out, c_expr);
+        sb_append(out, ") {\n");
+        free(c_expr);
+        free(rewritten);
+        free(expr);
+        free(stripped);
+        return 0;
+    }
+    if (starts_with(s, "else")) {
+        const char *after_else = skip_ws(s + 4);
+        if (*after_else == '{') {
+            int close_abs = find_matching_brace_c(s, (int)(after_else - s));
+            if (close_abs >= 0 && *skip_ws(s + close_abs + 1) == '\0') {
+                char *body_raw = substr_copy(after_else + 1, (size_t)(close_abs - (int)(after_else - s) - 1));
+                char *body = trim_copy(body_raw);
+                free(body_raw);
+                sb_append(out, "else {\n");
+                int body_rc = 0;
+                if (body[0] != '\0') {
+                    body_rc = direct_lower_inline_body(path, line_no, line, body, locals, fns, fn_count, structs, struct_count, out);
+                }
+                sb_append(out, "}\n");
+                free(body);
+                free(stripped);
+                return body_rc;
+            }
+            sb_append(out, "else {\n");
+            free(stripped);
+            return 0;
+        }
+    }
+    if (direct_parse_inline_cond_else(s, "if", &inline_expr, &inline_body, &inline_else_body)) {
+        if (inline_expr == NULL || inline_body == NULL || inline_else_body == NULL ||
+            direct_check_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count)) {
+            free(inline_expr);
+            free(inline_body);
+            free(inline_else_body);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(inline_expr);
+            free(inline_body);
+            free(inline_else_body);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        sb_append(out, "if (");
+        sb_append(out, c_expr);
+        sb_append(out, ") {\n");
+        int then_rc = direct_lower_inline_body(path, line_no, line, inline_body, locals, fns, fn_count, structs, struct_count, out);
+        int else_rc = then_rc;
+        const char *else_trim = skip_ws(inline_else_body);
+        if (then_rc == 0 && starts_with(else_trim, "if") && !is_ident_continue(else_trim[2])) {
+            sb_append(out, "} else ");
+            else_rc = direct_lower_line(path, line_no, inline_else_body, locals, fns, fn_count, structs, struct_count, out);
+        } else {
+            sb_append(out, "} else {\n");
+            if (then_rc == 0) else_rc = direct_lower_inline_body(path, line_no, line, inline_else_body, locals, fns, fn_count, structs, struct_count, out);
+            sb_append(out, "}\n");
+        }
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(inline_expr);
+        free(inline_body);
+        free(inline_else_body);
+        free(stripped);
+        return then_rc != 0 ? then_rc : else_rc;
+    }
+    if (direct_parse_inline_block(s, "if", &inline_expr, &inline_body)) {
+        if (inline_expr == NULL || inline_body == NULL ||
+            direct_check_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count)) {
+            free(inline_expr);
+            free(inline_body);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(inline_expr);
+            free(inline_body);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        sb_append(out, "if (");
+        sb_append(out, c_expr);
+        sb_append(out, ") {\n");
+        int body_rc = direct_lower_inline_body(path, line_no, line, inline_body, locals, fns, fn_count, structs, struct_count, out);
+        sb_append(out, "}\n");
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(inline_expr);
+        free(inline_body);
+        free(stripped);
+        return body_rc;
+    }
+    if (starts_with(s, "if ")) {
+        char *expr = direct_after_keyword_expr(s, "if", '{');
+        if (expr == NULL || direct_check_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count)) {
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        sb_append(out, "if (");
+        sb_append(out, c_expr);
+        sb_append(out, ") {\n");
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(expr);
+        free(stripped);
+        return 0;
+    }
+    if (direct_parse_inline_block(s, "while", &inline_expr, &inline_body)) {
+        if (inline_expr == NULL || inline_body == NULL ||
+            direct_check_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count)) {
+            free(inline_expr);
+            free(inline_body);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, inline_expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(inline_expr);
+            free(inline_body);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        if (prelude.len > 0) {
+            sb_append(out, "while (1) {\n");
+            sb_append(out, prelude.data);
+            sb_append(out, "if (!(");
+            sb_append(out, c_expr);
+            sb_append(out, ")) break;\n");
+        } else {
+            sb_append(out, "while (");
+            sb_append(out, c_expr);
+            sb_append(out, ") {\n");
+        }
+        int body_rc = direct_lower_inline_body(path, line_no, line, inline_body, locals, fns, fn_count, structs, struct_count, out);
+        sb_append(out, "}\n");
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(inline_expr);
+        free(inline_body);
+        free(stripped);
+        return body_rc;
+    }
+    if (starts_with(s, "while ")) {
+        char *expr = direct_after_keyword_expr(s, "while", '{');
+        if (expr == NULL || direct_check_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count)) {
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        if (prelude.len > 0) {
+            sb_append(out, "while (1) {\n");
+            sb_append(out, prelude.data);
+            sb_append(out, "if (!(");
+            sb_append(out, c_expr);
+            sb_append(out, ")) break;\n");
+        } else {
+            sb_append(out, "while (");
+            sb_append(out, c_expr);
+            sb_append(out, ") {\n");
+        }
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(expr);
+        free(stripped);
+        return 0;
+    }
+    char *for_name = NULL;
+    char *for_lo = NULL;
+    char *for_hi = NULL;
+    int for_inclusive = 0;
+    int parsed_for = direct_parse_for_header(s, &for_name, &for_lo, &for_hi, &for_inclusive);
+    if (parsed_for == 1) {
+        const char *existing_type = direct_names_type(locals, for_name);
+        if (existing_type != NULL && !direct_is_intlike_scalar_type(existing_type)) {
+            report_issue(path, line_no, find_col(line, for_name), line,
+                "direct native emitter for-loop variable must be an Int-compatible scalar",
+                "use a fresh loop variable name or an `Int` local.",
+                "for i in 0..n {");
+            free(for_name);
+            free(for_lo);
+            free(for_hi);
+            free(stripped);
+            return 1;
+        }
+        if (direct_check_expr(path, line_no, line, for_lo, locals, fns, fn_count, structs, struct_count)) {
+            free(for_name);
+            free(for_lo);
+            free(for_hi);
+            free(stripped);
+            return 1;
+        }
+        char *lo_type = direct_infer_expr_type(for_lo, locals, fns, fn_count, structs, struct_count);
+        if (!direct_type_compatible("Int", lo_type)) {
+            report_issue(path, line_no, find_col(line, "for"), line,
+                "direct native emitter for-loop lower bound must be Int-compatible",
+                "use an `Int`, `Bool`, or `Char` expression for the lower bound.",
+                "for i in 0..n {");
+            free(lo_type);
+            free(for_name);
+            free(for_lo);
+            free(for_hi);
+            free(stripped);
+            return 1;
+        }
+        free(lo_type);
+        int declare_loop_var = existing_type == NULL;
+        if (declare_loop_var) direct_names_add_typed(locals, for_name, "Int");
+        if (direct_check_expr(path, line_no, line, for_hi, locals, fns, fn_count, structs, struct_count)) {
+            free(for_name);
+            free(for_lo);
+            free(for_hi);
+            free(stripped);
+            return 1;
+        }
+        char *hi_type = direct_infer_expr_type(for_hi, locals, fns, fn_count, structs, struct_count);
+        if (!direct_type_compatible("Int", hi_type)) {
+            report_issue(path, line_no, find_col(line, "for"), line,
+                "direct native emitter for-loop upper bound must be Int-compatible",
+                "use an `Int`, `Bool`, or `Char` expression for the upper bound.",
+                "for i in 0..n {");
+            free(hi_type);
+            free(for_name);
+            free(for_lo);
+            free(for_hi);
+            free(stripped);
+            return 1;
+        }
+        free(hi_type);
+        StrBuf start_prelude;
+        StrBuf end_prelude;
+        sb_init(&start_prelude);
+        sb_init(&end_prelude);
+        direct_current_prelude = &start_prelude;
+        char *rewritten_lo = direct_rewrite_expr(path, line_no, line, for_lo, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = &end_prelude;
+        char *rewritten_hi = rewritten_lo == NULL ? NULL : direct_rewrite_expr(path, line_no, line, for_hi, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten_lo == NULL || rewritten_hi == NULL) {
+            free(start_prelude.data);
+            free(end_prelude.data);
+            free(rewritten_lo);
+            free(rewritten_hi);
+            free(for_name);
+            free(for_lo);
+            free(for_hi);
+            free(stripped);
+            return 1;
+        }
+        char *c_lo = direct_translate_expr(rewritten_lo);
+        char *c_hi = direct_translate_expr(rewritten_hi);
+        if (declare_loop_var) {
+            sb_append(out, "long ");
+            sb_append(out, for_name);
+            sb_append(out, ";\n");
+        }
+        sb_append(out, start_prelude.data);
+        sb_append(out, "for (");
+        sb_append(out, for_name);
+        sb_append(out, " = ");
+        sb_append(out, c_lo);
+        sb_append(out, "; ; ");
+        sb_append(out, for_name);
+        sb_append(out, "++) {\n");
+        sb_append(out, end_prelude.data);
+        sb_append(out, "if (!(");
+        sb_append(out, for_name);
+        sb_append(out, for_inclusive ? " <= " : " < ");
+        sb_append(out, c_hi);
+        sb_append(out, ")) break;\n");
+        free(start_prelude.data);
+        free(end_prelude.data);
+        free(c_lo);
+        free(c_hi);
+        free(rewritten_lo);
+        free(rewritten_hi);
+        free(for_name);
+        free(for_lo);
+        free(for_hi);
+        free(stripped);
+        return 0;
+    }
+    char *each_name = NULL;
+    char *each_iterable = NULL;
+    int parsed_each = direct_parse_for_each_header(s, &each_name, &each_iterable);
+    if (parsed_each == 1) {
+        const char *existing_type = direct_names_type(locals, each_name);
+        char *list_name = NULL;
+        if (!direct_expr_bare_list_local(locals, each_iterable, &list_name)) {
+            report_issue(path, line_no, find_col(line, each_iterable), line,
+                "direct native emitter for-each expects a local List<Int>, List<Str>, or List<Struct>",
+                "iterate a named local or parameter with type `List<Int>`, `List<Str>`, or `List<YourStruct>`.",
+                "for x in xs {");
+            free(each_name);
+            free(each_iterable);
+            free(stripped);
+            return 1;
+        }
+        const char *iter_type = direct_names_type(locals, list_name);
+        char *elem_type = direct_list_element_type(iter_type);
+        int elem_is_struct = elem_type != NULL && direct_find_struct(structs, struct_count, elem_type) != NULL;
+        if (elem_type == NULL || (strcmp(elem_type, "Int") != 0 && strcmp(elem_type, "Str") != 0 && !elem_is_struct)) {
+            report_issue(path, line_no, find_col(line, list_name), line,
+                "direct native emitter for-each currently supports List<Int>, List<Str>, and List<Struct>",
+                "iterate a `List<Int>`, `List<Str>`, or declared-struct list in this direct-engine slice.",
+                "for x in xs {");
+            free(elem_type);
+            free(list_name);
+            free(each_name);
+            free(each_iterable);
+            free(stripped);
+            return 1;
+        }
+        int existing_ok = existing_type == NULL ||
+            (strcmp(elem_type, "Int") == 0 && direct_is_intlike_scalar_type(existing_type)) ||
+            (strcmp(elem_type, "Str") == 0 && direct_is_str_type(existing_type)) ||
+            (elem_is_struct && strcmp(existing_type, elem_type) == 0);
+        if (!existing_ok) {
+            report_issue(path, line_no, find_col(line, each_name), line,
+                "direct native emitter for-each variable type must match the list element type",
+                "use a fresh loop variable name or a local whose type matches the list element.",
+                "for x in xs {");
+            free(elem_type);
+            free(list_name);
+            free(each_name);
+            free(each_iterable);
+            free(stripped);
+            return 1;
+        }
+        int declare_loop_var = existing_type == NULL;
+        if (declare_loop_var) direct_names_add_typed(locals, each_name, elem_type);
+        char idx_name[64];
+        snprintf(idx_name, sizeof(idx_name), "__vais_for_each_%d", locals->temp_count++);
+        if (declare_loop_var) {
+            sb_append(out, direct_c_type(elem_type));
+            sb_append(out, " ");
+            sb_append(out, each_name);
+            sb_append(out, ";\n");
+        }
+        sb_append(out, "for (long ");
+        sb_append(out, idx_name);
+        sb_append(out, " = 0; ");
+        sb_append(out, idx_name);
+        sb_append(out, " < ");
+        direct_append_list_len_ref(out, list_name, direct_names_is_ref(locals, list_name));
+        sb_append(out, "; ");
+        sb_append(out, idx_name);
+        sb_append(out, "++) {\n");
+        sb_append(out, each_name);
+        sb_append(out, " = ");
+        direct_append_list_data_ref(out, list_name, direct_names_is_ref(locals, list_name));
+        sb_append(out, "[");
+        sb_append(out, idx_name);
+        sb_append(out, "];\n");
+        free(elem_type);
+        free(list_name);
+        free(each_name);
+        free(each_iterable);
+        free(stripped);
+        return 0;
+    }
+    if (parsed_for < 0 || starts_with(s, "for")) {
+        report_issue(path, line_no, find_col(line, "for"), line,
+            "direct native emitter expected a for-loop range or supported List header",
+            "write `for i in 0..n {`, `for i in 0..=n {`, or `for x in xs {` where `xs` is `List<Int>`, `List<Str>`, or `List<Struct>`.",
+            "for i in 0..n {");
+        free(each_name);
+        free(each_iterable);
+        free(for_name);
+        free(for_lo);
+        free(for_hi);
+        free(stripped);
+        return 1;
+    }
+    if (strcmp(s, "break") == 0 || strcmp(s, "break;") == 0) {
+        sb_append(out, "break;\n");
+        free(stripped);
+        return 0;
+    }
+    if (strcmp(s, "continue") == 0 || strcmp(s, "continue;") == 0) {
+        sb_append(out, "continue;\n");
+        free(stripped);
+        return 0;
+    }
+    if (starts_with(s, "return ")) {
+        char *expr = trim_copy(s + 7);
+        size_t n = strlen(expr);
+        if (n > 0 && expr[n - 1] == ';') expr[n - 1] = '\0';
+        const char *return_type = locals->current_return_type == NULL ? "Int" : locals->current_return_type;
+        int allow_list_return = direct_is_list_type(return_type);
+        int allow_map_return = direct_is_supported_map_return_type(return_type);
+        int inline_list_return = allow_list_return && direct_is_list_initializer_expr(expr);
+        if (allow_map_return) {
+            if (direct_check_map_value_expr(path, line_no, line, expr, return_type, locals, fns, fn_count, structs, struct_count)) {
+                free(expr);
+                free(stripped);
+                return 1;
+            }
+        } else if (!inline_list_return) {
+            char *expr_type = direct_infer_expr_type(expr, locals, fns, fn_count, structs, struct_count);
+            if (!direct_type_compatible(return_type, expr_type)) {
+                report_issue(path, line_no, find_col(line, "return"), line,
+                    "direct native emitter return expression type does not match the function return type",
+                    "return a value with the type declared in the function header.",
+                    "return 40 + 2");
+                free(expr_type);
+                free(expr);
+                free(stripped);
+                return 1;
+            }
+            free(expr_type);
+        }
+        if (!allow_map_return && direct_check_expr_inner(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count, allow_list_return ? return_type : NULL)) {
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = allow_list_return
+            ? direct_rewrite_list_value_expr(path, line_no, line, expr, return_type, 1, locals, fns, fn_count, structs, struct_count)
+            : allow_map_return
+            ? direct_rewrite_map_value_expr(path, line_no, line, expr, return_type, 1, locals, fns, fn_count, structs, struct_count)
+            : direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        char *moved = NULL;
+        int bare_local = allow_list_return
+            ? direct_expr_bare_list_local(locals, expr, &moved)
+            : allow_map_return && direct_expr_bare_map_local(locals, expr, &moved);
+        if (bare_local && (direct_names_is_ref(locals, moved) || strcmp(direct_names_type(locals, moved), return_type) != 0)) bare_local = 0;
+        if (!bare_local) {
+            free(moved);
+            moved = NULL;
+        }
+        sb_append(out, prelude.data);
+        if (direct_names_has_owned_heap(locals, moved)) {
+            sb_append(out, "{\n");
+            sb_append(out, direct_c_type(return_type));
+            sb_append(out, " __vais_ret = ");
+            sb_append(out, c_expr);
+            sb_append(out, ";\n");
+            direct_append_owned_heap_frees(out, locals, moved);
+            sb_append(out, "return __vais_ret;\n}\n");
+        } else {
+            sb_append(out, "return ");
+            sb_append(out, c_expr);
+            sb_append(out, ";\n");
+        }
+        free(moved);
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(expr);
+        free(stripped);
+        return 0;
+    }
+    char *match_name = NULL;
+    char *match_expr = NULL;
+    char *match_arms = NULL;
+    if (parse_inline_match_let(s, &match_name, &match_expr, &match_arms)) {
+        char *match_value_type = direct_infer_expr_type(match_expr, locals, fns, fn_count, structs, struct_count);
+        int rc = direct_is_result_int_int_type(match_value_type)
+            ? direct_lower_result_match_let(path, line_no, line, match_name, match_expr, match_arms, locals, fns, fn_count, structs, struct_count, out)
+            : direct_lower_option_match_let(path, line_no, line, match_name, match_expr, match_arms, locals, fns, fn_count, structs, struct_count, out);
+        free(match_value_type);
+        free(match_name);
+        free(match_expr);
+        free(match_arms);
+        free(stripped);
+        return rc;
+    }
+    free(match_name);
+    free(match_expr);
+    free(match_arms);
+    if (starts_with(s, "let ")) {
+        const char *p = skip_ws(s + 4);
+        if (starts_with(p, "mut ")) p = skip_ws(p + 4);
+        if (!is_ident_start(*p)) {
+            report_issue(path, line_no, find_col(line, "let"), line,
+                "direct native emitter expected an Int local binding",
+                "write `let name = expr` or `let mut name = expr`.",
+                NULL);
+            free(stripped);
+            return 1;
+        }
+        const char *name_start = p;
+        while (is_ident_continue(*p)) p++;
+        char *name = substr_copy(name_start, (size_t)(p - name_start));
+        p = skip_ws(p);
+        char *local_type = NULL;
+        if (*p == ':') {
+            p = skip_ws(p + 1);
+            local_type = direct_parse_local_type(&p);
+            if (local_type == NULL) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter expected a local type",
+                    "use `Int`, `Bool`, `Char`, `Str`, `Option<Int>`, `Result<Int,Int>`, `List<Int>`, `List<Struct>`, `Map<Int,Int>`, `Map<Int,Bool>`, `Map<Int,Char>`, `Map<Str,Int>`, `Map<Str,Bool>`, `Map<Str,Char>`, `Map<Str,Str>`, or a declared struct type in this direct-engine slice.",
+                    NULL);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            p = skip_ws(p);
+            if (!direct_local_type_allowed(structs, struct_count, local_type)) {
+                report_issue(path, line_no, find_col(line, local_type), line,
+                    "direct native emitter supports Int, Bool, Char, Str, Option<Int>, Result<Int,Int>, List<Int>, List<Struct>, Map<Int,Int>, Map<Int,Bool>, Map<Int,Char>, Map<Str,Int>, Map<Str,Bool>, Map<Str,Char>, Map<Str,Str>, and declared struct locals only",
+                    "use `let name: Int = expr`, `let name: Option<Int> = expr`, `let name: Result<Int,Int> = expr`, `let name: Str = expr`, `let name: List<Int> = []`, `let name: Map<Int,Int> = {}`, `let name: Map<Int,Bool> = {}`, `let name: Map<Int,Char> = {}`, `let name: Map<Str,Int> = {}`, `let name: Map<Str,Bool> = {}`, `let name: Map<Str,Char> = {}`, `let name: Map<Str,Str> = {}`, `let name: Struct = expr`, or omit the annotation.",
+                    NULL);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+        }
+        if (*p != '=') {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter expected an initialized local",
+                "write `let name = expr`.",
+                NULL);
+            free(local_type);
+            free(name);
+            free(stripped);
+            return 1;
+        }
+        char *expr = trim_copy(p + 1);
+        size_t n = strlen(expr);
+        if (n > 0 && expr[n - 1] == ';') expr[n - 1] = '\0';
+        if (local_type == NULL && direct_is_map_empty_initializer_expr(expr)) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter requires a Map type annotation for `{}`",
+                "write `let name: Map<Int,Int> = {}`, `let name: Map<Int,Bool> = {}`, `let name: Map<Int,Char> = {}`, `let name: Map<Str,Int> = {}`, `let name: Map<Str,Bool> = {}`, `let name: Map<Str,Char> = {}`, or `let name: Map<Str,Str> = {}` for the verified local Map slices.",
+                "let m: Map<Int,Int> = {}");
+            free(expr);
+            free(name);
+            free(stripped);
+            return 1;
+        }
+        char *try_inner = direct_strip_try_suffix(expr);
+        if (try_inner != NULL) {
+            const char *return_type = locals->current_return_type == NULL ? "Int" : locals->current_return_type;
+            if (!direct_is_option_result_type(return_type)) {
+                report_issue(path, line_no, find_col(line, "?"), line,
+                    "direct native emitter `?` requires an Option<Int> or Result<Int,Int> return type",
+                    "use `?` inside a helper returning `Option<Int>` or `Result<Int,Int>`.",
+                    NULL);
+                free(try_inner);
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            if (direct_check_expr(path, line_no, line, try_inner, locals, fns, fn_count, structs, struct_count)) {
+                free(try_inner);
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            char *try_type = direct_infer_expr_type(try_inner, locals, fns, fn_count, structs, struct_count);
+            if (!direct_type_compatible(return_type, try_type) || !direct_is_option_result_type(try_type)) {
+                report_issue(path, line_no, find_col(line, "?"), line,
+                    "direct native emitter `?` input must match the enclosing Option/Result type",
+                    "bind `Option<Int>` with `?` inside `Option<Int>` helpers and `Result<Int,Int>` inside `Result<Int,Int>` helpers.",
+                    NULL);
+                free(try_type);
+                free(try_inner);
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            free(try_type);
+            if (local_type != NULL && !direct_type_compatible(local_type, "Int")) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter `?` local binding payload is Int",
+                    "bind the unwrapped payload as `Int` or omit the annotation.",
+                    NULL);
+                free(try_inner);
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            StrBuf prelude;
+            sb_init(&prelude);
+            direct_current_prelude = &prelude;
+            char *rewritten = direct_rewrite_expr(path, line_no, line, try_inner, locals, fns, fn_count, structs, struct_count);
+            direct_current_prelude = NULL;
+            if (rewritten == NULL) {
+                free(prelude.data);
+                free(try_inner);
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            char *c_expr = direct_translate_expr(rewritten);
+            char tmp_name[80];
+            snprintf(tmp_name, sizeof(tmp_name), "__vais_try_%d", locals->temp_count++);
+            sb_append(out, prelude.data);
+            sb_append(out, "long ");
+            sb_append(out, tmp_name);
+            sb_append(out, " = ");
+            sb_append(out, c_expr);
+            sb_append(out, ";\nif (");
+            sb_append(out, tmp_name);
+            sb_append(out, " % 2 != 0) {\n");
+            direct_append_owned_heap_frees(out, locals, NULL);
+            sb_append(out, "return ");
+            sb_append(out, tmp_name);
+            sb_append(out, ";\n}\n");
+            const char *existing_local_type = direct_names_type(locals, name);
+            int already_bound = existing_local_type != NULL;
+            int redeclare_local = already_bound && strcmp(existing_local_type, "Int") != 0;
+            direct_emit_local_binding_prefix(out, locals, name, "Int", already_bound, redeclare_local);
+            sb_append(out, "(");
+            sb_append(out, tmp_name);
+            sb_append(out, " / 2) % 1000000;\n");
+            if (!already_bound || redeclare_local) direct_names_add_typed(locals, name, "Int");
+            free(prelude.data);
+            free(c_expr);
+            free(rewritten);
+            free(try_inner);
+            free(expr);
+            free(local_type);
+            free(name);
+            free(stripped);
+            return 0;
+        }
+        if (local_type == NULL) local_type = direct_infer_expr_type(expr, locals, fns, fn_count, structs, struct_count);
+        const char *existing_local_type = direct_names_type(locals, name);
+        int already_bound = existing_local_type != NULL;
+        int redeclare_local = already_bound && strcmp(existing_local_type, local_type) != 0;
+        if (direct_is_map_type(local_type)) {
+            if (direct_is_map_empty_initializer_expr(expr)) {
+                if (direct_let_replaces_heap(locals, name, already_bound, redeclare_local)) direct_append_heap_free(out, local_type, name);
+                direct_emit_local_binding_prefix(out, locals, name, local_type, already_bound, redeclare_local);
+                if (locals->hoist_decls != NULL && !redeclare_local) direct_append_cast_initializer_prefix(out, local_type);
+                sb_append(out, "{0};\n");
+                if (!already_bound || redeclare_local) direct_names_add_typed(locals, name, local_type);
+                if (locals->hoist_decls != NULL && !redeclare_local) direct_note_owned_heap(locals, name);
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 0;
+            }
+            if (!direct_is_supported_map_return_type(local_type)) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter Map locals must start with `{}`",
+                    "initialize Map locals with `{}`; verified return-capable concrete maps may also use a same-type helper returning Map<Int,Int>, Map<Int,Bool>, Map<Int,Char>, Map<Str,Int>, Map<Str,Bool>, Map<Str,Char>, or Map<Str,Str>.",
+                    "let m: Map<Int,Int> = {}");
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            if (direct_check_map_value_expr(path, line_no, line, expr, local_type, locals, fns, fn_count, structs, struct_count)) {
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            StrBuf prelude;
+            sb_init(&prelude);
+            direct_current_prelude = &prelude;
+            char *rewritten = direct_rewrite_map_value_expr(path, line_no, line, expr, local_type, 0, locals, fns, fn_count, structs, struct_count);
+            direct_current_prelude = NULL;
+            if (rewritten == NULL) {
+                free(prelude.data);
+                free(expr);
+                free(local_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            char *c_expr = direct_translate_expr(rewritten);
+            sb_append(out, prelude.data);
+            char old_value[64] = {0};
+            if (direct_let_replaces_heap(locals, name, already_bound, redeclare_local)) {
+                direct_append_heap_old_value(out, locals, name, local_type, 0, old_value, sizeof(old_value));
+            }
+            direct_emit_local_binding_prefix(out, locals, name, local_type, already_bound, redeclare_local);
+            sb_append(out, c_expr);
+            sb_append(out, ";\n");
+            if (old_value[0] != '\0') direct_append_heap_free(out, local_type, old_value);
+            if (!already_bound || redeclare_local) direct_names_add_typed(locals, name, local_type);
+            if (locals->hoist_decls != NULL && !redeclare_local) direct_note_owned_heap(locals, name);
+            free(prelude.data);
+            free(c_expr);
+            free(rewritten);
+            free(expr);
+            free(local_type);
+            free(name);
+            free(stripped);
+            return 0;
+        }
+        if (direct_is_list_type(local_type)) {
+            char *list_elem_type = direct_list_element_type(local_type);
+            if (direct_is_list_initializer_expr(expr)) {
+                char old_buffer[64] = {0};
+                if (direct_let_replaces_heap(locals, name, already_bound, redeclare_local)) {
+                    direct_append_heap_old_value(out, locals, name, local_type, 0, old_buffer, sizeof(old_buffer));
+                }
+                direct_emit_local_binding_prefix(out, locals, name, local_type, already_bound, redeclare_local);
+                if (locals->hoist_decls != NULL && !redeclare_local) direct_append_cast_initializer_prefix(out, local_type);
+                sb_append(out, "{0};\n");
+                if (!already_bound || redeclare_local) direct_names_add_typed(locals, name, local_type);
+                if (locals->hoist_decls != NULL && !redeclare_local) direct_note_owned_heap(locals, name);
+                char *items[16] = {0};
+                int item_count = 0;
+                int literal_state = direct_parse_list_literal_items(expr, items, 16, &item_count);
+                if (literal_state < 0) {
+                    report_issue(path, line_no, find_col(line, name), line,
+                        "direct native emitter supports up to 16 List literal items",
+                        "start with `[]` and call `push` for larger direct-engine lists.",
+                        NULL);
+                    for (int k = 0; k < 16; k++) free(items[k]);
+                    free(expr);
+                    free(local_type);
+                    free(list_elem_type);
+                    free(name);
+                    free(stripped);
+                    return 1;
+                }
+                for (int item = 0; item < item_count; item++) {
+                    if (direct_check_expr(path, line_no, line, items[item], locals, fns, fn_count, structs, struct_count)) {
+                        for (int k = item; k < item_count; k++) free(items[k]);
+                        free(expr);
+                        free(local_type);
+                        free(list_elem_type);
+                        free(name);
+                        free(stripped);
+                        return 1;
+                    }
+                    char *item_type = direct_infer_expr_type(items[item], locals, fns, fn_count, structs, struct_count);
+                    if (strcmp(item_type, list_elem_type) != 0) {
+                        report_issue(path, line_no, find_col(line, name), line,
+                            "direct native emitter list literal item type does not match the local list element type",
+                            "push values with the element type declared by the local list.",
+                            NULL);
+                        free(item_type);
+                        for (int k = item; k < item_count; k++) free(items[k]);
+                        free(expr);
+                        free(local_type);
+                        free(list_elem_type);
+                        free(name);
+                        free(stripped);
+                        return 1;
+                    }
+                    free(item_type);
+                    StrBuf prelude;
+                    sb_init(&prelude);
+                    direct_current_prelude = &prelude;
+                    char *rewritten_item = direct_rewrite_expr(path, line_no, line, items[item], locals, fns, fn_count, structs, struct_count);
+                    direct_current_prelude = NULL;
+                    if (rewritten_item == NULL) {
+                        free(prelude.data);
+                        for (int k = item; k < item_count; k++) free(items[k]);
+                        free(expr);
+                        free(local_type);
+                        free(list_elem_type);
+                        free(name);
+                        free(stripped);
+                        return 1;
+                    }
+                    char *c_item = direct_translate_expr(rewritten_item);
+                    sb_append(out, prelude.data);
+                    direct_append_list_push_reserve_ref(out, name, 0);
+                    sb_append(out, "\n");
+                    sb_append(out, name);
+                    sb_append(out, ".data[");
+                    sb_append(out, name);
+                    sb_append(out, ".len++] = ");
+                    sb_append(out, c_item);
+                    sb_append(out, ";\n");
+                    free(prelude.data);
+                    free(c_item);
+                    free(rewritten_item);
+                    free(items[item]);
+                }
+                if (old_buffer[0] != '\0') direct_append_heap_free(out, local_type, old_buffer);
+                free(expr);
+                free(local_type);
+                free(list_elem_type);
+                free(name);
+                free(stripped);
+                return 0;
+            }
+            if (direct_check_expr_inner(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count, local_type)) {
+                free(expr);
+                free(local_type);
+                free(list_elem_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            char *expr_type = direct_infer_expr_type(expr, locals, fns, fn_count, structs, struct_count);
+            if (!direct_type_compatible(local_type, expr_type)) {
+                report_issue(path, line_no, find_col(line, name), line,
+                    "direct native emitter local initializer type does not match the annotation",
+                    "initialize the local with a value of the annotated type.",
+                    NULL);
+                free(expr_type);
+                free(expr);
+                free(local_type);
+                free(list_elem_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            free(expr_type);
+            StrBuf prelude;
+            sb_init(&prelude);
+            direct_current_prelude = &prelude;
+            char *rewritten = direct_rewrite_list_value_expr(path, line_no, line, expr, local_type, 0, locals, fns, fn_count, structs, struct_count);
+            direct_current_prelude = NULL;
+            if (rewritten == NULL) {
+                free(prelude.data);
+                free(expr);
+                free(local_type);
+                free(list_elem_type);
+                free(name);
+                free(stripped);
+                return 1;
+            }
+            char *c_expr = direct_translate_expr(rewritten);
+            sb_append(out, prelude.data);
+            char old_buffer[64] = {0};
+            if (direct_let_replaces_heap(locals, name, already_bound, redeclare_local)) {
+                direct_append_heap_old_value(out, locals, name, local_type, 0, old_buffer, sizeof(old_buffer));
+            }
+            direct_emit_local_binding_prefix(out, locals, name, local_type, already_bound, redeclare_local);
+            sb_append(out, c_expr);
+            sb_append(out, ";\n");
+            if (old_buffer[0] != '\0') direct_append_heap_free(out, local_type, old_buffer);
+            if (!already_bound || redeclare_local) direct_names_add_typed(locals, name, local_type);
+            if (locals->hoist_decls != NULL && !redeclare_local) direct_note_owned_heap(locals, name);
+            free(prelude.data);
+            free(c_expr);
+            free(rewritten);
+            free(expr);
+            free(local_type);
+            free(list_elem_type);
+            free(name);
+            free(stripped);
+            return 0;
+        }
+        if (direct_check_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count)) {
+            free(expr);
+            free(local_type);
+            free(name);
+            free(stripped);
+            return 1;
+        }
+        char *expr_type = direct_infer_expr_type(expr, locals, fns, fn_count, structs, struct_count);
+        if (!direct_type_compatible(local_type, expr_type)) {
+            report_issue(path, line_no, find_col(line, name), line,
+                "direct native emitter local initializer type does not match the annotation",
+                "initialize the local with a value of the annotated type.",
+                NULL);
+            free(expr_type);
+            free(expr);
+            free(local_type);
+            free(name);
+            free(stripped);
+            return 1;
+        }
+        free(expr_type);
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(expr);
+            free(local_type);
+            free(name);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        direct_emit_local_binding_prefix(out, locals, name, local_type, already_bound, redeclare_local);
+        sb_append(out, c_expr);
+        sb_append(out, ";\n");
+        if (!already_bound || redeclare_local) direct_names_add_typed(locals, name, local_type);
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(expr);
+        free(local_type);
+        free(name);
+        free(stripped);
+        return 0;
+    }
+
+    char *call_args = NULL;
+    int parsed_print = direct_parse_named_call_statement(s, "print", &call_args);
+    if (parsed_print == 1) {
+        int rc = direct_lower_print_statement(path, line_no, line, call_args, locals, fns, fn_count, structs, struct_count, out);
+        free(call_args);
+        free(stripped);
+        return rc;
+    }
+    if (parsed_print < 0) {
+        report_issue(path, line_no, find_col(line, "print"), line,
+            "direct native emitter expected a valid print call statement",
+            "write `print(\"text\")` or `print(\"value={name}\")`.",
+            NULL);
+        free(stripped);
+        return 1;
+    }
+    int parsed_putchar = direct_parse_named_call_statement(s, "putchar", &call_args);
+    if (parsed_putchar == 1) {
+        int rc = direct_lower_putchar_statement(path, line_no, line, call_args, locals, fns, fn_count, structs, struct_count, out);
+        free(call_args);
+        free(stripped);
+        return rc;
+    }
+    if (parsed_putchar < 0) {
+        report_issue(path, line_no, find_col(line, "putchar"), line,
+            "direct native emitter expected a valid putchar call statement",
+            "write `putchar(33)` or pass an Int, Bool, or Char value.",
+            NULL);
+        free(stripped);
+        return 1;
+    }
+    static const char *output_hooks[] = {
+        "vais_emit_str", "vais_emit_bytes", "vais_emit_byte", "vais_emit_int", "vais_emit_entry", "vais_emit_linkage",
+        "__vais_prof_fn", "__vais_prof_loop", "__vais_prof_iter", "__vais_prof_loop_end", "__vais_prof_site", NULL,
+    };
+    for (int h = 0; output_hooks[h] != NULL; h++) {
+        int parsed_hook = direct_parse_named_call_statement(s, output_hooks[h], &call_args);
+        if (parsed_hook == 1) {
+            int rc = direct_lower_output_hook_statement(path, line_no, line, output_hooks[h], call_args, locals, fns, fn_count, structs, struct_count, out);
+            free(call_args);
+            free(stripped);
+            return rc;
+        }
+    }
+    char *call_stmt_expr = trim_copy(s);
+    size_t call_stmt_len = strlen(call_stmt_expr);
+    if (call_stmt_len > 0 && call_stmt_expr[call_stmt_len - 1] == ';') {
+        call_stmt_expr[call_stmt_len - 1] = '\0';
+        char *trimmed_call_stmt = trim_copy(call_stmt_expr);
+        free(call_stmt_expr);
+        call_stmt_expr = trimmed_call_stmt;
+    }
+    DirectFnInfo *call_stmt_fn = direct_expr_exact_call_fn(call_stmt_expr, fns, fn_count);
+    if (call_stmt_fn != NULL) {
+        if (direct_check_expr(path, line_no, line, call_stmt_expr, locals, fns, fn_count, structs, struct_count)) {
+            free(call_stmt_expr);
+            free(stripped);
+            return 1;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten = direct_rewrite_expr(path, line_no, line, call_stmt_expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(call_stmt_expr);
+            free(stripped);
+            return 1;
+        }
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        sb_append(out, c_expr);
+        sb_append(out, ";\n");
+        free(prelude.data);
+        free(c_expr);
+        free(rewritten);
+        free(call_stmt_expr);
+        free(stripped);
+        return 0;
+    }
+    free(call_stmt_expr);
+
+    char *method_base = NULL;
+    char *method_name = NULL;
+    char *method_args = NULL;
+    if (direct_parse_method_statement(s, &method_base, &method_name, &method_args)) {
+        const char *base_type = direct_names_type(locals, method_base);
+        if (direct_is_map_type(base_type)) {
+            int is_insert = strcmp(method_name, "insert") == 0;
+            int is_remove = strcmp(method_name, "remove") == 0;
+            int is_clear = strcmp(method_name, "clear") == 0;
+            if (!is_insert && !is_remove && !is_clear) {
+                report_issue(path, line_no, find_col(line, method_base), line,
+                    "direct native emitter supports Map.insert, Map.remove, and Map.clear statements only",
+                    "write `m.insert(key, value)`, `m.remove(key)`, or `m.clear()` on a local Map<Int,Int>, Map<Int,Bool>, Map<Int,Char>, Map<Str,Int>, Map<Str,Bool>, Map<Str,Char>, or Map<Str,Str>.",
+                    NULL);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            char *args[16] = {0};
+            int argc = split_top_level_commas_c(method_args, args, 16);
+            if (is_clear && argc == 1 && args[0] != NULL && strlen(skip_ws(args[0])) == 0) argc = 0;
+            int expected_argc = is_insert ? 2 : (is_clear ? 0 : 1);
+            int bad_args = argc != expected_argc;
+            if (!is_clear && (args[0] == NULL || strlen(skip_ws(args[0])) == 0)) bad_args = 1;
+            if (is_insert && (args[1] == NULL || strlen(skip_ws(args[1])) == 0)) bad_args = 1;
+            if (bad_args) {
+                report_issue(path, line_no, find_col(line, method_name), line,
+                    is_insert ? "direct native emitter Map.insert expects key and value arguments" : (is_clear ? "direct native emitter Map.clear expects no arguments" : "direct native emitter Map.remove expects one key argument"),
+                    is_insert ? "write `m.insert(key, value)`." : (is_clear ? "write `m.clear()`." : "write `m.remove(key)`."),
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            for (int a = 0; a < argc; a++) {
+                if (direct_check_expr(path, line_no, line, args[a], locals, fns, fn_count, structs, struct_count)) {
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(method_base);
+                    free(method_name);
+                    free(method_args);
+                    free(stripped);
+                    return 1;
+                }
+                char *arg_type = direct_infer_expr_type(args[a], locals, fns, fn_count, structs, struct_count);
+                const char *expected_arg_type = a == 0 ? direct_map_key_type(base_type) : direct_map_value_type(base_type);
+                if (!direct_map_arg_type_compatible(expected_arg_type, arg_type)) {
+                    report_issue(path, line_no, find_col(line, method_name), line,
+                        is_insert ? "direct native emitter Map.insert arguments must match key/value types" : "direct native emitter Map.remove key must match the Map key type",
+                        is_insert ? "use a key and value matching the Map's concrete key/value types." : "use a key matching the Map's concrete key type.",
+                        NULL);
+                    free(arg_type);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(method_base);
+                    free(method_name);
+                    free(method_args);
+                    free(stripped);
+                    return 1;
+                }
+                free(arg_type);
+            }
+            StrBuf prelude;
+            sb_init(&prelude);
+            direct_current_prelude = &prelude;
+            char *rewritten_key = is_clear ? NULL : direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+            char *rewritten_value = (is_insert && rewritten_key != NULL) ? direct_rewrite_expr(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count) : NULL;
+            direct_current_prelude = NULL;
+            if ((!is_clear && rewritten_key == NULL) || (is_insert && rewritten_value == NULL)) {
+                free(prelude.data);
+                free(rewritten_key);
+                free(rewritten_value);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            char *c_key = is_clear ? NULL : direct_translate_expr(rewritten_key);
+            char *c_value = is_insert ? direct_translate_expr(rewritten_value) : NULL;
+            sb_append(out, prelude.data);
+            sb_append(out, direct_map_helper_name(base_type, is_insert ? "insert" : (is_clear ? "clear" : "remove")));
+            sb_append(out, "(");
+            direct_append_map_ptr_ref(out, method_base, direct_names_is_ref(locals, method_base));
+            if (!is_clear) {
+                sb_append(out, ", ");
+                sb_append(out, c_key);
+            }
+            if (is_insert) {
+                sb_append(out, ", ");
+                sb_append(out, c_value);
+            }
+            sb_append(out, ");\n");
+            free(prelude.data);
+            free(c_key);
+            free(c_value);
+            free(rewritten_key);
+            free(rewritten_value);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 0;
+        }
+        int is_push = strcmp(method_name, "push") == 0;
+        int is_clear = strcmp(method_name, "clear") == 0;
+        int is_insert_at = strcmp(method_name, "insert_at") == 0;
+        int is_extend = strcmp(method_name, "extend") == 0;
+        int is_remove_at_stmt = strcmp(method_name, "remove_at") == 0;
+        int is_pop_stmt = strcmp(method_name, "pop") == 0;
+        if (direct_is_list_type(base_type) && (is_remove_at_stmt || is_pop_stmt)) {
+            /* Value-discarding forms: reuse the expression translation (which
+               emits the bounds-checked prelude) and drop the result. */
+            StrBuf call_text;
+            sb_init(&call_text);
+            sb_append(&call_text, method_base);
+            sb_append(&call_text, ".");
+            sb_append(&call_text, method_name);
+            sb_append(&call_text, "(");
+            if (method_args != NULL) sb_append(&call_text, method_args);
+            sb_append(&call_text, ")");
+            StrBuf prelude;
+            sb_init(&prelude);
+            direct_current_prelude = &prelude;
+            char *rewritten = direct_rewrite_expr(path, line_no, line, call_text.data, locals, fns, fn_count, structs, struct_count);
+            direct_current_prelude = NULL;
+            if (rewritten == NULL) {
+                free(prelude.data);
+                free(call_text.data);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            char *c_expr = direct_translate_expr(rewritten);
+            sb_append(out, prelude.data);
+            sb_append(out, "(void)(");
+            sb_append(out, c_expr);
+            sb_append(out, ");\n");
+            free(prelude.data);
+            free(c_expr);
+            free(rewritten);
+            free(call_text.data);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 0;
+        }
+        if (!direct_is_list_type(base_type) || (!is_push && !is_clear && !is_insert_at && !is_extend)) {
+            report_issue(path, line_no, find_col(line, method_base), line,
+                "direct native emitter supports List.push/List.clear/List.insert_at/List.extend/List.remove_at/List.pop and Map.insert/Map.remove/Map.clear statements only",
+                "write `xs.push(value)`, `xs.clear()`, `xs.insert_at(index, value)`, `xs.extend(other)`, `xs.remove_at(index)`, `xs.pop()`, `m.insert(key, value)`, `m.remove(key)`, or `m.clear()`.",
+                NULL);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 1;
+        }
+        char *args[16] = {0};
+        int argc = split_top_level_commas_c(method_args, args, 16);
+        if (is_clear && argc == 1 && args[0] != NULL && strlen(skip_ws(args[0])) == 0) argc = 0;
+        if (is_clear) {
+            if (argc != 0) {
+                report_issue(path, line_no, find_col(line, method_name), line,
+                    "direct native emitter List.clear expects no arguments",
+                    "write `xs.clear()`.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            int base_is_ref = direct_names_is_ref(locals, method_base);
+            direct_append_list_len_ref(out, method_base, base_is_ref);
+            sb_append(out, " = 0;\n");
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 0;
+        }
+	        if (is_extend) {
+	            if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type) && !direct_is_list_struct_type(structs, struct_count, base_type)) {
+	                report_issue(path, line_no, find_col(line, method_name), line,
+	                    "direct native emitter supports List.extend only on List<Int>, List<Str>, and List<Struct>",
+	                    "use `xs.extend(other)` on a verified direct-engine list type.",
+	                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            if (argc != 1 || args[0] == NULL || strlen(skip_ws(args[0])) == 0) {
+                report_issue(path, line_no, find_col(line, method_name), line,
+                    "direct native emitter List.extend expects one list argument",
+                    "write `xs.extend(other)` with another list of the same type.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            char *source_name = trim_copy(args[0]);
+            if (!direct_is_plain_ident(source_name)) {
+                int source_is_literal = direct_is_list_initializer_expr(source_name);
+                DirectFnInfo *source_fn = source_is_literal ? NULL : direct_expr_exact_call_fn(source_name, fns, fn_count);
+                if (!source_is_literal && (source_fn == NULL || !direct_is_list_type(source_fn->return_type) || strcmp(source_fn->return_type, base_type) != 0)) {
+                    report_issue(path, line_no, find_col(line, method_name), line,
+                        "direct native emitter List.extend expects a named list source, inline list literal, or same-type list-returning call",
+                        "pass a local/parameter list name such as `xs.extend(other)`, an inline list literal such as `xs.extend([1, 2])`, or a helper call such as `xs.extend(make_items())`.",
+                        NULL);
+                    free(source_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(method_base);
+                    free(method_name);
+                    free(method_args);
+                    free(stripped);
+                    return 1;
+                }
+                if (direct_check_expr_inner(path, line_no, line, source_name, locals, fns, fn_count, structs, struct_count, base_type)) {
+                    free(source_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(method_base);
+                    free(method_name);
+                    free(method_args);
+                    free(stripped);
+                    return 1;
+                }
+                StrBuf prelude;
+                sb_init(&prelude);
+                direct_current_prelude = &prelude;
+                char *rewritten_source = direct_rewrite_list_value_expr(path, line_no, line, source_name, base_type, 0, locals, fns, fn_count, structs, struct_count);
+                direct_current_prelude = NULL;
+                if (rewritten_source == NULL) {
+                    free(prelude.data);
+                    free(source_name);
+                    for (int k = 0; k < 16; k++) free(args[k]);
+                    free(method_base);
+                    free(method_name);
+                    free(method_args);
+                    free(stripped);
+                    return 1;
+                }
+                char *c_source = direct_translate_expr(rewritten_source);
+                char tmp_name[64];
+                snprintf(tmp_name, sizeof(tmp_name), "__vais_list_extend_src_%d", locals->temp_count++);
+                sb_append(out, prelude.data);
+                sb_append(out, direct_c_type(base_type));
+                sb_append(out, " ");
+                sb_append(out, tmp_name);
+                sb_append(out, " = ");
+                sb_append(out, c_source);
+                sb_append(out, ";\n");
+                int base_is_ref = direct_names_is_ref(locals, method_base);
+                direct_append_list_extend_ref(out, method_base, base_is_ref, tmp_name, 0, base_type, locals);
+                sb_append(out, "free(");
+                sb_append(out, tmp_name);
+                sb_append(out, ".data);\n");
+                free(c_source);
+                free(rewritten_source);
+                free(prelude.data);
+                free(source_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 0;
+            }
+            const char *source_type = direct_names_type(locals, source_name);
+            if (source_type == NULL || strcmp(source_type, base_type) != 0) {
+                report_issue(path, line_no, find_col(line, method_name), line,
+                    "direct native emitter List.extend source type does not match the target list",
+                    "extend with a local or parameter list of the same element type.",
+                    NULL);
+                free(source_name);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+	            }
+	            int base_is_ref = direct_names_is_ref(locals, method_base);
+	            int source_is_ref = direct_names_is_ref(locals, source_name);
+	            direct_append_list_extend_ref(out, method_base, base_is_ref, source_name, source_is_ref, base_type, locals);
+            free(source_name);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 0;
+        }
+	        if (is_insert_at) {
+	            if (!direct_is_list_int_type(base_type) && !direct_is_list_str_type(base_type) && !direct_is_list_struct_type(structs, struct_count, base_type)) {
+	                report_issue(path, line_no, find_col(line, method_name), line,
+	                    "direct native emitter supports List.insert_at only on List<Int>, List<Str>, and List<Struct>",
+	                    "use `xs.insert_at(index, value)` on a verified direct-engine list type.",
+	                    NULL);
+	                for (int k = 0; k < 16; k++) free(args[k]);
+	                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            if (argc != 2 || args[0] == NULL || args[1] == NULL || strlen(skip_ws(args[0])) == 0 || strlen(skip_ws(args[1])) == 0) {
+                report_issue(path, line_no, find_col(line, method_name), line,
+                    "direct native emitter List.insert_at expects index and value arguments",
+                    "write `xs.insert_at(index, value)`.",
+                    NULL);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count) ||
+                direct_check_expr(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count)) {
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            char *index_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+            if (!direct_map_arg_type_compatible("Int", index_type)) {
+                report_issue(path, line_no, find_col(line, method_name), line,
+                    "direct native emitter List.insert_at index must be Int",
+                    "pass an Int-compatible index to `xs.insert_at(index, value)`.",
+                    NULL);
+                free(index_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            free(index_type);
+            char *list_elem_type = direct_list_element_type(base_type);
+            char *value_type = direct_infer_expr_type(args[1], locals, fns, fn_count, structs, struct_count);
+            if (strcmp(value_type, list_elem_type) != 0) {
+                report_issue(path, line_no, find_col(line, method_name), line,
+                    "direct native emitter List.insert_at value type does not match the list element type",
+                    "insert a value with the element type declared by the local list.",
+                    NULL);
+                free(value_type);
+                free(list_elem_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            free(value_type);
+            StrBuf prelude;
+            sb_init(&prelude);
+            direct_current_prelude = &prelude;
+            char *rewritten_index = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+            char *rewritten_value = rewritten_index == NULL ? NULL : direct_rewrite_expr(path, line_no, line, args[1], locals, fns, fn_count, structs, struct_count);
+            direct_current_prelude = NULL;
+            if (rewritten_index == NULL || rewritten_value == NULL) {
+                free(prelude.data);
+                free(rewritten_index);
+                free(rewritten_value);
+                free(list_elem_type);
+                for (int k = 0; k < 16; k++) free(args[k]);
+                free(method_base);
+                free(method_name);
+                free(method_args);
+                free(stripped);
+                return 1;
+            }
+            char *c_index = direct_translate_expr(rewritten_index);
+            char *c_value = direct_translate_expr(rewritten_value);
+            int base_is_ref = direct_names_is_ref(locals, method_base);
+	            sb_append(out, prelude.data);
+	            direct_append_list_insert_at_ref(out, method_base, base_is_ref, base_type, c_index, c_value, locals);
+            free(prelude.data);
+            free(c_index);
+            free(c_value);
+            free(rewritten_index);
+            free(rewritten_value);
+            free(list_elem_type);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 0;
+        }
+        char *list_elem_type = direct_list_element_type(base_type);
+        if (argc != 1 || strlen(skip_ws(args[0])) == 0) {
+            report_issue(path, line_no, find_col(line, method_name), line,
+                "direct native emitter List.push expects one argument",
+                "write `xs.push(value)`.",
+                NULL);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(list_elem_type);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 1;
+        }
+        if (direct_check_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count)) {
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(list_elem_type);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 1;
+        }
+        char *arg_type = direct_infer_expr_type(args[0], locals, fns, fn_count, structs, struct_count);
+        if (strcmp(arg_type, list_elem_type) != 0) {
+            report_issue(path, line_no, find_col(line, method_name), line,
+                "direct native emitter List.push argument type does not match the list element type",
+                "push a value with the element type declared by the local list.",
+                NULL);
+            free(arg_type);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(list_elem_type);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 1;
+        }
+        free(arg_type);
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten_arg = direct_rewrite_expr(path, line_no, line, args[0], locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten_arg == NULL) {
+            free(prelude.data);
+            for (int k = 0; k < 16; k++) free(args[k]);
+            free(list_elem_type);
+            free(method_base);
+            free(method_name);
+            free(method_args);
+            free(stripped);
+            return 1;
+        }
+        char *c_arg = direct_translate_expr(rewritten_arg);
+        int base_is_ref = direct_names_is_ref(locals, method_base);
+        sb_append(out, prelude.data);
+        direct_append_list_push_reserve_ref(out, method_base, base_is_ref);
+        sb_append(out, "\n");
+        direct_append_list_data_ref(out, method_base, base_is_ref);
+        sb_append(out, "[");
+        direct_append_list_len_ref(out, method_base, base_is_ref);
+        sb_append(out, "++] = ");
+        sb_append(out, c_arg);
+        sb_append(out, ";\n");
+        free(prelude.data);
+        free(c_arg);
+        free(rewritten_arg);
+        for (int k = 0; k < 16; k++) free(args[k]);
+        free(list_elem_type);
+        free(method_base);
+        free(method_name);
+        free(method_args);
+        free(stripped);
+        return 0;
+    }
+
+    const char *eq = strchr(s, '=');
+    const char *semi = strchr(s, ';');
+    if (eq != NULL && (semi == NULL || eq < semi)) {
+        char *lhs = trim_copy(substr_copy(s, (size_t)(eq - s)));
+        char *expr = trim_copy(eq + 1);
+        size_t n = strlen(expr);
+        if (n > 0 && expr[n - 1] == ';') expr[n - 1] = '\0';
+        if (direct_check_assignment_target(path, line_no, line, lhs, locals, structs, struct_count)) {
+            free(lhs);
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        const char *target_type = direct_assignment_target_type(lhs, locals, structs, struct_count);
+        int allow_list_assignment = direct_is_list_type(target_type);
+        if (direct_is_map_type(target_type)) {
+            if (direct_expr_exact_map_return_call(expr, fns, fn_count)) {
+                char *expr_type = direct_infer_expr_type(expr, locals, fns, fn_count, structs, struct_count);
+                int ok_type = expr_type != NULL && strcmp(target_type, expr_type) == 0;
+                free(expr_type);
+                if (!ok_type) {
+                    report_issue(path, line_no, find_col(line, lhs), line,
+                        "direct native emitter Map assignment source type must match the target Map type",
+                        "copy from a Map-returning call with the same concrete Map type.",
+                        "scores = make_scores()");
+                    free(lhs);
+                    free(expr);
+                    free(stripped);
+                    return 1;
+                }
+                StrBuf prelude;
+                sb_init(&prelude);
+                direct_current_prelude = &prelude;
+                char *rewritten = direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+                direct_current_prelude = NULL;
+                if (rewritten == NULL) {
+                    free(prelude.data);
+                    free(lhs);
+                    free(expr);
+                    free(stripped);
+                    return 1;
+                }
+                char *c_expr = direct_translate_expr(rewritten);
+                sb_append(out, prelude.data);
+                DirectLocalInfo *map_target = direct_names_find(locals, lhs);
+                char old_value[64] = {0};
+                if (map_target != NULL && (map_target->is_ref || direct_local_owns_heap(map_target))) {
+                    direct_append_heap_old_value(out, locals, lhs, target_type, map_target->is_ref, old_value, sizeof(old_value));
+                }
+                if (direct_names_is_ref(locals, lhs)) sb_append(out, "*");
+                sb_append(out, lhs);
+                sb_append(out, " = ");
+                sb_append(out, c_expr);
+                sb_append(out, ";\n");
+                if (old_value[0] != '\0') direct_append_heap_free(out, target_type, old_value);
+                free(prelude.data);
+                free(c_expr);
+                free(rewritten);
+                free(lhs);
+                free(expr);
+                free(stripped);
+                return 0;
+            }
+            char *rhs_name = trim_copy(expr);
+            const char *rhs_type = direct_is_plain_ident(rhs_name) ? direct_names_type(locals, rhs_name) : NULL;
+            if (!direct_is_map_type(rhs_type)) {
+                report_issue(path, line_no, find_col(line, lhs), line,
+                    "direct native emitter Map assignment requires another local or parameter Map value",
+                    "assign from a local, same-type parameter, or same-type Map-returning call for `Map<Int,Int>`, `Map<Int,Bool>`, `Map<Int,Char>`, `Map<Str,Int>`, `Map<Str,Bool>`, `Map<Str,Char>`, or `Map<Str,Str>`; broader generic key/value forms are not in this direct slice.",
+                    "scores = other");
+                free(rhs_name);
+                free(lhs);
+                free(expr);
+                free(stripped);
+                return 1;
+            }
+            if (strcmp(target_type, rhs_type) != 0) {
+                report_issue(path, line_no, find_col(line, lhs), line,
+                    "direct native emitter Map assignment source type must match the target Map type",
+                    "copy between locals with the same concrete Map type.",
+                    "scores = other");
+                free(rhs_name);
+                free(lhs);
+                free(expr);
+                free(stripped);
+                return 1;
+            }
+            sb_append(out, direct_map_helper_name(target_type, "copy"));
+            sb_append(out, "(");
+            direct_append_map_ptr_ref(out, lhs, direct_names_is_ref(locals, lhs));
+            sb_append(out, ", ");
+            direct_append_map_ptr_ref(out, rhs_name, direct_names_is_ref(locals, rhs_name));
+            sb_append(out, ");\n");
+            free(rhs_name);
+            free(lhs);
+            free(expr);
+            free(stripped);
+            return 0;
+        }
+        if (direct_check_expr_inner(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count, allow_list_assignment ? target_type : NULL)) {
+            free(lhs);
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        int contextual_list_assignment = allow_list_assignment && direct_is_list_initializer_expr(expr);
+        if (!contextual_list_assignment) {
+            char *expr_type = direct_infer_expr_type(expr, locals, fns, fn_count, structs, struct_count);
+            if (target_type != NULL && !direct_type_compatible(target_type, expr_type)) {
+                report_issue(path, line_no, find_col(line, lhs), line,
+                    "direct native emitter assignment expression type does not match the target",
+                    "assign a value with the same type as the target local.",
+                    NULL);
+                free(expr_type);
+                free(lhs);
+                free(expr);
+                free(stripped);
+                return 1;
+            }
+            free(expr_type);
+        }
+        DirectLocalInfo *acc_target = direct_names_find(locals, lhs);
+        int acc_after = 0;
+        if (acc_target != NULL && acc_target->concat_acc > 0 && direct_concat_acc_stmt_at(s, 0, lhs, &acc_after)) {
+            int acc_rc = direct_lower_concat_acc_push(path, line_no, line, expr, acc_target, locals, fns, fn_count, structs, struct_count, out);
+            free(lhs);
+            free(expr);
+            free(stripped);
+            return acc_rc;
+        }
+        StrBuf prelude;
+        sb_init(&prelude);
+        direct_current_prelude = &prelude;
+        char *rewritten_lhs = direct_rewrite_expr(path, line_no, line, lhs, locals, fns, fn_count, structs, struct_count);
+        if (rewritten_lhs == NULL) {
+            direct_current_prelude = NULL;
+            free(prelude.data);
+            free(lhs);
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *rewritten = allow_list_assignment
+            ? direct_rewrite_list_value_expr(path, line_no, line, expr, target_type, 0, locals, fns, fn_count, structs, struct_count)
+            : direct_rewrite_expr(path, line_no, line, expr, locals, fns, fn_count, structs, struct_count);
+        direct_current_prelude = NULL;
+        if (rewritten == NULL) {
+            free(prelude.data);
+            free(rewritten_lhs);
+            free(lhs);
+            free(expr);
+            free(stripped);
+            return 1;
+        }
+        char *c_lhs = direct_translate_expr(rewritten_lhs);
+        char *c_expr = direct_translate_expr(rewritten);
+        sb_append(out, prelude.data);
+        /* The replaced buffer belongs to this local, or through a List
+           parameter to the caller's local, and nothing else points at it. */
+        DirectLocalInfo *list_target = allow_list_assignment ? direct_names_find(locals, lhs) : NULL;
+        char old_buffer[64] = {0};
+        if (list_target != NULL && (list_target->is_ref || direct_local_owns_heap(list_target))) {
+            direct_append_heap_old_value(out, locals, lhs, target_type, list_target->is_ref, old_buffer, sizeof(old_buffer));
+        }
+        if (allow_list_assignment && direct_names_is_ref(locals, lhs)) sb_append(out, "*");
+        sb_append(out, c_lhs);
+        sb_append(out, " = ");
+        sb_append(out, c_expr);
+        sb_append(out, ";\n");
+        if (old_buffer[0] != '\0') direct_append_heap_free(out, target_type, old_buffer);
+        free(prelude.data);
+        free(c_lhs);
+        free(c_expr);
+        free(rewritten_lhs);
+        free(rewritten);
+        free(lhs);
+        free(expr);
+        free(stripped);
+        return 0;
+    }
+
+    report_issue(path, line_no, 1, line,
+        "direct native emitter supports Int functions, struct locals, List locals, concrete Map locals/parameters, lets, assignment, if, while, for, break, continue, calls, and return",
+        "use the full engine for syntax outside the direct subset.",
+        NULL);
+    free(stripped);
+    return 1;
+}
+
+static int direct_struct_literal_join_allowed(const char *line) {
+    const char *s = skip_ws(line);
+    if ((starts_with(s, "fn") && !is_ident_continue(s[2])) ||
+        (starts_with(s, "if") && !is_ident_continue(s[2])) ||
+        (starts_with(s, "while") && !is_ident_continue(s[5])) ||
+        (starts_with(s, "for") && !is_ident_continue(s[3])) ||
+        (starts_with(s, "else") && !is_ident_continue(s[4])) ||
+        (starts_with(s, "struct") && !is_ident_continue(s[6])) ||
+        (starts_with(s, "enum") && !is_ident_continue(s[4])) ||
+        (starts_with(s, "impl") && !is_ident_continue(s[4])) ||
+        (starts_with(s, "trait") && !is_ident_continue(s[5]))) {
+        return 0;
+    }
+    return 1;
+}
+
+static void direct_struct_literal_depth_after_text(
+    const char *text,
+    DirectStructInfo *structs,
+    int struct_count,
+    int *brace_depth
+) {
+    char delim = '\0';
+    int escaped = 0;
+    for (int i = 0; text[i] != '\0';) {
+        char ch = text[i];
+        if (escaped) {
+            escaped = 0;
+            i++;
+            continue;
+        }
+        if ((delim == '"' || delim == '\'') && ch == '\\') {
+            escaped = 1;
+            i++;
+            continue;
+        }
+        if (ch == '"' || ch == '\'' || ch == '`') {
+            if (delim == '\0') delim = ch;
+            else if (delim == ch) delim = '\0';
+            i++;
+            continue;
+        }
+        if (delim != '\0') {
+            i++;
+            continue;
+        }
+        if (*brace_depth > 0) {
+            if (ch == '{') (*brace_depth)++;
+            else if (ch == '}' && *brace_depth > 0) (*brace_depth)--;
+            i++;
+            continue;
+        }
+        if (!is_ident_start(ch)) {
+            i++;
+            continue;
+        }
+        int start = i;
+        i++;
+        while (is_ident_continue(text[i])) i++;
+        char *name = substr_copy(text + start, (size_t)(i - start));
+        int cursor = i;
+        while (text[cursor] == ' ' || text[cursor] == '\t') cursor++;
+        int opens_literal = text[cursor] == '{' && direct_find_struct(structs, struct_count, name) != NULL;
+        free(name);
+        if (opens_literal) {
+            (*brace_depth)++;
+            i = cursor + 1;
+        }
+    }
+}
+
+static char *direct_join_delimited_statement(LineVec *lines, size_t start, size_t *end_out, DirectStructInfo *structs, int struct_count) {
+    char *first = strip_line_comment(lines->items[start], strlen(lines->items[start]));
+    int paren_depth = 0;
+    int square_depth = 0;
+    int struct_brace_depth = 0;
+    paren_square_depth_after_text(first, &paren_depth, &square_depth);
+    int allow_struct_join = direct_struct_literal_join_allowed(first);
+    if (allow_struct_join) {
+        direct_struct_literal_depth_after_text(first, structs, struct_count, &struct_brace_depth);
+    }
+    free(first);
+    if (paren_depth <= 0 && square_depth <= 0 && struct_brace_depth <= 0) {
+        *end_out = start;
+        return strdup(lines->items[start]);
+    }
+    StrBuf joined;
+    sb_init(&joined);
+    sb_append(&joined, lines->items[start]);
+    size_t j = start + 1;
+    while (j < lines->len && (paren_depth > 0 || square_depth > 0 || struct_brace_depth > 0)) {
+        sb_append(&joined, "\n");
+        sb_append(&joined, lines->items[j]);
+        char *code = strip_line_comment(lines->items[j], strlen(lines->items[j]));
+        paren_square_depth_after_text(code, &paren_depth, &square_depth);
+        if (allow_struct_join) {
+            direct_struct_literal_depth_after_text(code, structs, struct_count, &struct_brace_depth);
+        }
+        free(code);
+        j++;
+    }
+    *end_out = j == 0 ? start : j - 1;
+    return joined.data;
+}
+
+/* Under `--instrument` a function body is emitted as NAME__vais_prof and NAME
+   becomes this wrapper, which closes whatever profiling frames the body left
+   open when it returned from inside a loop. */
+static void direct_append_prof_wrapper(StrBuf *out, DirectFnInfo *fns, int fn_count, const char *name) {
+    DirectFnInfo *fn = direct_find_fn(fns, fn_count, name);
+    if (fn == NULL) return;
+    const char *ret = direct_c_type(fn->return_type);
+    sb_append(out, ret);
+    sb_append(out, " ");
+    sb_append(out, fn->name);
+    sb_append(out, "(");
+    for (int p = 0; p < fn->param_count; p++) {
+        if (p > 0) sb_append(out, ", ");
+        sb_append(out, direct_c_param_type(fn->param_types[p]));
+        sb_append(out, " ");
+        sb_append(out, fn->params[p]);
+    }
+    sb_append(out, ") {\n    int64_t __vais_prof_mark = __vais_prof_depth();\n    ");
+    sb_append(out, ret);
+    sb_append(out, " __vais_prof_ret = ");
+    sb_append(out, fn->name);
+    sb_append(out, "__vais_prof(");
+    for (int p = 0; p < fn->param_count; p++) {
+        if (p > 0) sb_append(out, ", ");
+        sb_append(out, fn->params[p]);
+    }
+    sb_append(out, ");\n    __vais_prof_leave(__vais_prof_mark);\n    return __vais_prof_ret;\n}\n");
+}
+
+static void direct_append_function_with_decls(StrBuf *out, StrBuf *fn, StrBuf *decls) {
+    if (decls->len == 0) {
+        sb_append(out, fn->data);
+        return;
+    }
+    char *insert = strstr(fn->data, "{\n");
+    if (insert == NULL) {
+        sb_append(out, fn->data);
+        return;
+    }
+    size_t head_len = (size_t)(insert - fn->data) + 2;
+    sb_append_n(out, fn->data, head_len);
+    sb_append(out, decls->data);
+    sb_append(out, fn->data + head_len);
+}
+
+static int direct_source_brace_delta(const char *text) {
+    int delta = 0;
+    for (int i = 0; text[i] != '\0'; i++) {
+        if (is_string_delim_c(text[i])) {
+            int end = skip_string_literal_c(text, i);
+            if (end < 0) break;
+            i = end - 1;
+            continue;
+        }
+        if (text[i] == '\'') {
+            int end = skip_char_literal_c(text, i);
+            if (end < 0) break;
+            i = end - 1;
+            continue;
+        }
+        if (text[i] == '{') delta++;
+        else if (text[i] == '}') delta--;
+    }
+    return delta;
+}
+
+/*
+ * Fixed direct-engine runtime prelude: headers, List/Map layouts, and the
+ * `__vais_*` helpers every lowered program shares. It does not depend on the
+ * program, so debug builds compile it once into a cached object (see
+ * `runtime_cache_object`) and the lowered C only carries its declarations.
+ */
+static void direct_append_runtime_prelude(StrBuf *out) {
+    sb_append(out, "#include <dirent.h>\n");
+    sb_append(out, "#include <errno.h>\n");
+    sb_append(out, "#include <stdbool.h>\n");
+    sb_append(out, "#include <stdint.h>\n");
+    sb_append(out, "#include <stdio.h>\n");
+    sb_append(out, "#include <stdlib.h>\n");
+    sb_append(out, "#include <string.h>\n");
+    sb_append(out, "#include <sys/stat.h>\n");
+    sb_append(out, "#include <sys/time.h>\n");
+    sb_append(out, "#include <sys/wait.h>\n");
+    sb_append(out, "#include <time.h>\n");
+    if (vaisc_instrument) {
+        /* Instrumented builds inline the prelude, so its helpers' allocations
+           reach the profiler's per-site byte counts too. */
+        sb_append(out, "void *__vais_prof_malloc(size_t);\n");
+        sb_append(out, "void *__vais_prof_calloc(size_t, size_t);\n");
+        sb_append(out, "void *__vais_prof_realloc(void *, size_t);\n");
+        sb_append(out, "#define malloc(n) __vais_prof_malloc(n)\n");
+        sb_append(out, "#define calloc(count, size) __vais_prof_calloc(count, size)\n");
+        sb_append(out, "#define realloc(ptr, n) __vais_prof_realloc(ptr, n)\n");
+    }
+    sb_append(out, "typedef long Int;\n");
+    sb_append(out, "typedef long Bool;\n");
+    sb_append(out, "typedef const char *Str;\n");
+    sb_append(out, "int64_t proc_argc(void);\n");
+    sb_append(out, "char *proc_arg(int64_t index);\n");
+    sb_append(out, "int64_t fs_exists(const char *path);\n");
+    sb_append(out, "int64_t str_builder_new(void);\n");
+    sb_append(out, "int64_t str_builder_push(int64_t, int64_t);\n");
+    sb_append(out, "int64_t str_builder_append(int64_t, const char *);\n");
+    sb_append(out, "char *str_builder_finish(int64_t);\n");
+    sb_append(out, "int64_t index_new(void);\n");
+    sb_append(out, "int64_t index_add_doc(int64_t, int64_t, const char *);\n");
+    sb_append(out, "int64_t index_add_term(int64_t, int64_t, const char *, int64_t);\n");
+    sb_append(out, "int64_t index_remove_doc(int64_t, int64_t);\n");
+    sb_append(out, "int64_t index_doc_count(int64_t);\n");
+    sb_append(out, "int64_t index_top_k(int64_t, const char *, int64_t);\n");
+    sb_append(out, "int64_t index_hit_doc(int64_t, int64_t);\n");
+    sb_append(out, "int64_t index_hit_score(int64_t, int64_t);\n");
+    sb_append(out, "int64_t snap_open(const char *);\n");
+    sb_append(out, "int64_t snap_close(int64_t);\n");
+    sb_append(out, "char *snap_get(int64_t, const char *, const char *);\n");
+    sb_append(out, "int64_t snap_has(int64_t, const char *);\n");
+    sb_append(out, "int64_t snap_put(int64_t, const char *, const char *);\n");
+    sb_append(out, "int64_t snap_remove(int64_t, const char *);\n");
+    sb_append(out, "int64_t snap_len(int64_t);\n");
+    sb_append(out, "int64_t snap_log_len(int64_t);\n");
+    sb_append(out, "int64_t snap_version(int64_t);\n");
+    sb_append(out, "int64_t snap_set_version(int64_t, int64_t);\n");
+    sb_append(out, "char *snap_key_at(int64_t, int64_t);\n");
+    sb_append(out, "char *snap_value_at(int64_t, int64_t);\n");
+    sb_append(out, "int64_t snap_compact(int64_t);\n");
+    sb_append(out, "int64_t vais_par_begin(int64_t, int64_t);\n");
+    sb_append(out, "int64_t vais_par_next(int64_t, int64_t, int64_t, int64_t);\n");
+    sb_append(out, "int64_t vais_par_wait(int64_t);\n");
+    sb_append(out, "int64_t vais_par_reduce(int64_t, int64_t);\n");
+    sb_append(out, "int64_t proc_wait(int64_t);\n");
+    sb_append(out, "int64_t proc_wait_any(void);\n");
+    sb_append(out, "int64_t fs_is_dir(const char *path);\n");
+    sb_append(out, "char *fs_read_text(const char *path);\n");
+    sb_append(out, "char *fs_map_text(const char *path);\n");
+    sb_append(out, "int64_t fs_lines_open(const char *path);\n");
+    sb_append(out, "int64_t fs_lines_next(int64_t handle);\n");
+    sb_append(out, "char *fs_lines_text(int64_t handle);\n");
+    sb_append(out, "int64_t fs_lines_close(int64_t handle);\n");
+    sb_append(out, "char *stdin_read_all(void);\n");
+    sb_append(out, "char *proc_self(void);\n");
+    sb_append(out, "int64_t stdout_write(const char *);\n");
+    sb_append(out, "int64_t vais_emit_str(const char *);\n");
+    sb_append(out, "int64_t vais_emit_bytes(const char *, int64_t, int64_t);\n");
+    sb_append(out, "int64_t vais_emit_byte(int64_t);\n");
+    sb_append(out, "int64_t vais_emit_int(int64_t);\n");
+    sb_append(out, "int64_t vais_emit_entry(void);\n");
+    sb_append(out, "int64_t vais_emit_linkage(void);\n");
+    sb_append(out, "int64_t __vais_prof_fn(int64_t, const char *);\n");
+    sb_append(out, "int64_t __vais_prof_loop(int64_t, const char *);\n");
+    sb_append(out, "int64_t __vais_prof_iter(int64_t);\n");
+    sb_append(out, "int64_t __vais_prof_loop_end(int64_t);\n");
+    sb_append(out, "int64_t __vais_prof_site(int64_t, const char *);\n");
+    sb_append(out, "int64_t __vais_prof_depth(void);\n");
+    sb_append(out, "int64_t __vais_prof_leave(int64_t);\n");
+    sb_append(out, "int64_t stderr_write(const char *);\n");
+    sb_append(out, "int64_t fs_mkdirs(const char *path);\n");
+    sb_append(out, "int64_t fs_remove(const char *path);\n");
+    sb_append(out, "int64_t fs_write_text(const char *path, const char *text);\n");
+    sb_append(out, "char *fs_cwd(void);\n");
+    sb_append(out, "char *fs_temp_dir(void);\n");
+    sb_append(out, "char *path_join(const char *base, const char *child);\n");
+    sb_append(out, "char *path_basename(const char *path);\n");
+    sb_append(out, "char *path_dirname(const char *path);\n");
+    sb_append(out, "int64_t time_millis(void);\n");
+    sb_append(out, "int64_t time_nanos(void);\n");
+    /*
+     * Runtime string region: every string helper allocates through
+     * __vais_str_alloc, from the libc heap unless an arena_begin() region is
+     * open, in which case it bumps through reusable segments that arena_reset
+     * rewinds. State lives behind an accessor so the split runtime object owns
+     * the only copy.
+     */
+    sb_append(out, "typedef struct { char *segs[1024]; size_t sizes[1024]; long seg; size_t off; long depth; long allocs; long heap; } __VaisStrArena;\n");
+    sb_append(out, "static __VaisStrArena *__vais_str_arena(void) { static __VaisStrArena arena = { {0}, {0}, -1, 0, 0, 0, 0 }; return &arena; }\n");
+    sb_append(out, "static char *__vais_str_alloc(size_t n) { __VaisStrArena *a = __vais_str_arena(); a->allocs++; if (a->depth > 0) { if (a->seg >= 0 && a->off + n <= a->sizes[a->seg]) { char *p = a->segs[a->seg] + a->off; a->off += n; return p; } long ns = a->seg + 1; if (ns < 1024) { if (a->sizes[ns] < n) { free(a->segs[ns]); size_t want = n < 1048576 ? 1048576 : n; a->segs[ns] = (char *)malloc(want); a->sizes[ns] = a->segs[ns] == NULL ? 0 : want; } if (a->segs[ns] != NULL) { a->seg = ns; a->off = n; return a->segs[ns]; } } } a->heap += (long)n; return (char *)malloc(n); }\n");
+    sb_append(out, "static long arena_begin(void) { __VaisStrArena *a = __vais_str_arena(); a->depth++; return (long)(((unsigned long)a->seg << 40) | a->off); }\n");
+    sb_append(out, "static long arena_reset(long mark) { __VaisStrArena *a = __vais_str_arena(); long s = mark >> 40; size_t o = (size_t)(mark & 1099511627775L); if (a->depth <= 0 || s > a->seg || (s == a->seg && o > a->off)) return 1; a->seg = s; a->off = o; return 0; }\n");
+    sb_append(out, "static long arena_end(long mark) { long rc = arena_reset(mark); if (rc == 0) __vais_str_arena()->depth--; return rc; }\n");
+    sb_append(out, "static const char *arena_keep(const char *s) { __VaisStrArena *a = __vais_str_arena(); size_t n = strlen(s) + 1; char *out = (char *)malloc(n); if (out == NULL) return \"\"; a->allocs++; a->heap += (long)n; memcpy(out, s, n); return out; }\n");
+    sb_append(out, "static long alloc_count(void) { return __vais_str_arena()->allocs; }\n");
+    sb_append(out, "static long alloc_bytes(void) { __VaisStrArena *a = __vais_str_arena(); long total = a->heap; for (long i = 0; i < a->seg; i++) total += (long)a->sizes[i]; return total + (long)a->off; }\n");
+    sb_append(out, "static long __vais_str_len(const char *s) { return (long)strlen(s); }\n");
+    sb_append(out, "static long __vais_str_byte(const char *s, long index) { return (long)(unsigned char)s[index]; }\n");
+    sb_append(out, "static long __vais_str_eq(const char *a, const char *b) { return strcmp(a, b) == 0 ? 1 : 0; }\n");
+    sb_append(out, "static long __vais_str_contains(const char *text, const char *needle) { return strstr(text, needle) != NULL ? 1 : 0; }\n");
+    sb_append(out, "static long __vais_str_cmp(const char *a, const char *b) { int r = strcmp(a ? a : \"\", b ? b : \"\"); return r < 0 ? -1 : (r > 0 ? 1 : 0); }\n");
+    sb_append(out, "static long __vais_str_index_of(const char *text, const char *needle) { const char *p = strstr(text, needle); return p == NULL ? -1 : (long)(p - text); }\n");
+    sb_append(out, "static long __vais_str_starts_with(const char *text, const char *prefix) { size_t n = strlen(prefix); return strncmp(text, prefix, n) == 0 ? 1 : 0; }\n");
+    sb_append(out, "static long __vais_str_ends_with(const char *text, const char *suffix) { size_t n = strlen(text); size_t m = strlen(suffix); return m <= n && strcmp(text + n - m, suffix) == 0 ? 1 : 0; }\n");
+    sb_append(out, "static const char *__vais_str_copy_n(const char *p, long len) { char *out = __vais_str_alloc((size_t)len + 1); if (out == NULL) return \"\"; memcpy(out, p, (size_t)len); out[len] = '\\0'; return out; }\n");
+    sb_append(out, "static const char *__vais_str_slice(const char *s, long start, long len) { if (start < 0 || len < 0 || memchr(s, 0, (size_t)start + (size_t)len) != NULL) __builtin_trap(); return __vais_str_copy_n(s + start, len); }\n");
+    sb_append(out, "static const char *__vais_str_concat8(long kinds, long n, const char *a0, const char *a1, const char *a2, const char *a3, const char *a4, const char *a5, const char *a6, const char *a7) { const char *parts[8] = { a0, a1, a2, a3, a4, a5, a6, a7 }; size_t lens[8]; char nums[8][24]; size_t total = 0; for (long i = 0; i < n; i++) { long kind = (kinds >> (2 * i)) & 3; if (kind == 1) { lens[i] = (size_t)snprintf(nums[i], sizeof(nums[i]), \"%ld\", (long)(intptr_t)parts[i]); parts[i] = nums[i]; } else if (kind == 2) { long v = (long)(intptr_t)parts[i]; if (v < 0 || v > 255) __builtin_trap(); nums[i][0] = (char)v; lens[i] = 1; parts[i] = nums[i]; } else { lens[i] = strlen(parts[i]); } total += lens[i]; } char *out = __vais_str_alloc(total + 1); if (out == NULL) return \"\"; size_t pos = 0; for (long i = 0; i < n; i++) { memcpy(out + pos, parts[i], lens[i]); pos += lens[i]; } out[pos] = '\\0'; return out; }\n");
+    sb_append(out, "typedef struct { char *data; size_t len; size_t cap; } __VaisStrAcc;\n");
+    sb_append(out, "static void *__vais_str_acc_new(const char *init) { __VaisStrAcc *acc = (__VaisStrAcc *)malloc(sizeof(__VaisStrAcc)); if (acc == NULL) __builtin_trap(); acc->len = strlen(init); acc->cap = acc->len + 1 < 64 ? 64 : acc->len + 1; acc->data = (char *)malloc(acc->cap); if (acc->data == NULL) __builtin_trap(); memcpy(acc->data, init, acc->len + 1); return acc; }\n");
+    sb_append(out, "static void __vais_str_acc_push(void *state, long kind, const char *part) { __VaisStrAcc *acc = (__VaisStrAcc *)state; char num[24]; size_t n; if (kind == 1) { n = (size_t)snprintf(num, sizeof(num), \"%ld\", (long)(intptr_t)part); part = num; } else if (kind == 2) { long v = (long)(intptr_t)part; if (v < 0 || v > 255) __builtin_trap(); num[0] = (char)v; n = 1; part = num; } else { n = strlen(part); } if (acc->len + n + 1 > acc->cap) { size_t cap = acc->cap * 2; if (cap < acc->len + n + 1) cap = acc->len + n + 1; char *grown = (char *)realloc(acc->data, cap); if (grown == NULL) __builtin_trap(); acc->data = grown; acc->cap = cap; } memcpy(acc->data + acc->len, part, n); acc->len += n; acc->data[acc->len] = '\\0'; }\n");
+    sb_append(out, "static const char *__vais_str_acc_finish(void *state) { __VaisStrAcc *acc = (__VaisStrAcc *)state; char *out = __vais_str_alloc(acc->len + 1); if (out != NULL) memcpy(out, acc->data, acc->len + 1); free(acc->data); free(acc); return out == NULL ? \"\" : out; }\n");
+    sb_append(out, "static const char *__vais_str_replace(const char *text, const char *needle, const char *replacement) { size_t tn = strlen(text), nn = strlen(needle), rn = strlen(replacement); if (nn == 0) { char *copy = __vais_str_alloc(tn + 1); if (copy == NULL) return \"\"; memcpy(copy, text, tn + 1); return copy; } size_t count = 0; const char *scan = text; const char *hit = NULL; while ((hit = strstr(scan, needle)) != NULL) { count++; scan = hit + nn; } size_t out_len = rn >= nn ? tn + count * (rn - nn) : tn - count * (nn - rn); char *out = __vais_str_alloc(out_len + 1); if (out == NULL) return \"\"; const char *src = text; size_t pos = 0; while ((hit = strstr(src, needle)) != NULL) { size_t chunk = (size_t)(hit - src); memcpy(out + pos, src, chunk); pos += chunk; memcpy(out + pos, replacement, rn); pos += rn; src = hit + nn; } size_t tail = strlen(src); memcpy(out + pos, src, tail); pos += tail; out[pos] = '\\0'; return out; }\n");
+    sb_append(out, "static int __vais_str_trim_space(unsigned char c) { return c == 32 || (c >= 9 && c <= 13); }\n");
+    /*
+     * Text kernels behind the split, trim, lower, and doc_term helpers: a
+     * 16-byte block step on SSE2 (x86-64) or NEON (arm64), both baseline for
+     * those targets, with the scalar loop finishing each tail and standing in
+     * everywhere else.
+     */
+    sb_append(out, "#if defined(__SSE2__)\n");
+    sb_append(out, "#include <emmintrin.h>\n");
+    sb_append(out, "static long __vais_text_block_space(const unsigned char *p, long space) { __m128i v = _mm_loadu_si128((const __m128i *)p); __m128i c = _mm_sub_epi8(v, _mm_set1_epi8(9)); __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(32)), _mm_cmpeq_epi8(_mm_min_epu8(c, _mm_set1_epi8(4)), c)); int bits = _mm_movemask_epi8(m); if (!space) bits = ~bits & 0xffff; return bits == 0 ? 16 : (long)__builtin_ctz((unsigned)bits); }\n");
+    sb_append(out, "static void __vais_text_block_lower(char *dst, const char *src) { __m128i v = _mm_loadu_si128((const __m128i *)src); __m128i c = _mm_sub_epi8(v, _mm_set1_epi8(65)); __m128i up = _mm_cmpeq_epi8(_mm_min_epu8(c, _mm_set1_epi8(25)), c); _mm_storeu_si128((__m128i *)dst, _mm_add_epi8(v, _mm_and_si128(up, _mm_set1_epi8(32)))); }\n");
+    sb_append(out, "#elif defined(__ARM_NEON) && defined(__aarch64__)\n");
+    sb_append(out, "#include <arm_neon.h>\n");
+    sb_append(out, "static long __vais_text_block_space(const unsigned char *p, long space) { uint8x16_t v = vld1q_u8(p); uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8(32)), vcleq_u8(vsubq_u8(v, vdupq_n_u8(9)), vdupq_n_u8(4))); if (!space) m = vmvnq_u8(m); if (vmaxvq_u8(m) == 0) return 16; long j = 0; while (__vais_str_trim_space(p[j]) != space) j++; return j; }\n");
+    sb_append(out, "static void __vais_text_block_lower(char *dst, const char *src) { uint8x16_t v = vld1q_u8((const uint8_t *)src); uint8x16_t up = vcleq_u8(vsubq_u8(v, vdupq_n_u8(65)), vdupq_n_u8(25)); vst1q_u8((uint8_t *)dst, vaddq_u8(v, vandq_u8(up, vdupq_n_u8(32)))); }\n");
+    sb_append(out, "#else\n");
+    sb_append(out, "static long __vais_text_block_space(const unsigned char *p, long space) { long j = 0; while (j < 16 && __vais_str_trim_space(p[j]) != space) j++; return j; }\n");
+    sb_append(out, "static void __vais_text_block_lower(char *dst, const char *src) { for (long j = 0; j < 16; j++) { unsigned char c = (unsigned char)src[j]; dst[j] = (char)((c >= 'A' && c <= 'Z') ? c + 32 : c); } }\n");
+    sb_append(out, "#endif\n");
+    sb_append(out, "static long __vais_text_scan_space(const char *text, long i, long n, long space) { const unsigned char *s = (const unsigned char *)text; long head = n - i < 16 ? n : i + 16; while (i < head && __vais_str_trim_space(s[i]) != space) i++; if (i < head) return i; while (i + 16 <= n) { long j = __vais_text_block_space(s + i, space); i += j; if (j < 16) return i; } while (i < n && __vais_str_trim_space(s[i]) != space) i++; return i; }\n");
+    sb_append(out, "static void __vais_text_lower_n(char *dst, const char *src, long n) { long i = 0; for (; i + 16 <= n; i += 16) __vais_text_block_lower(dst + i, src + i); for (; i < n; i++) { unsigned char c = (unsigned char)src[i]; dst[i] = (char)((c >= 'A' && c <= 'Z') ? c + 32 : c); } }\n");
+    sb_append(out, "static const char *__vais_str_trim(const char *s) { long n = (long)strlen(s); long start = __vais_text_scan_space(s, 0, n, 0); long end = n; while (end > start && __vais_str_trim_space((unsigned char)s[end - 1])) end--; return __vais_str_copy_n(s + start, end - start); }\n");
+    sb_append(out, "static const char *__vais_str_lower(const char *s) { long len = (long)strlen(s); char *out = __vais_str_alloc((size_t)len + 1); if (out == NULL) return \"\"; __vais_text_lower_n(out, s, len); out[len] = '\\0'; return out; }\n");
+    sb_append(out, "static const char *__vais_str_upper(const char *s) { size_t len = strlen(s); char *out = __vais_str_alloc(len + 1); if (out == NULL) return \"\"; for (size_t i = 0; i < len; i++) { unsigned char c = (unsigned char)s[i]; out[i] = (char)((c >= 'a' && c <= 'z') ? c - 32 : c); } out[len] = '\\0'; return out; }\n");
+    sb_append(out, "static const char *__vais_int_to_str(long value) { static char buffers[8][32]; static int next = 0; char *out = buffers[next++ & 7]; snprintf(out, 32, \"%ld\", value); return out; }\n");
+    sb_append(out, "static const char *__vais_str_from_byte(long value) { if (value < 0 || value > 255) __builtin_trap(); char *out = __vais_str_alloc(2); if (out == NULL) return \"\"; out[0] = (char)value; out[1] = '\\0'; return out; }\n");
+    sb_append(out, "static long __vais_parse_uint(const char *s) { long value = 0; for (long i = 0; s[i] != '\\0'; i++) { unsigned char b = (unsigned char)s[i]; if (b < '0' || b > '9') break; value = value * 10 + (long)(b - '0'); } return value; }\n");
+    sb_append(out, "static long __vais_parse_int(const char *s) { if (s[0] == '-') return 0 - __vais_parse_uint(s + 1); return __vais_parse_uint(s); }\n");
+    sb_append(out, "static void __vais_list_trap(int kind) { if (kind == 2) fprintf(stderr, \"vais list trap: empty-list access\\n\"); else fprintf(stderr, \"vais list trap: index out of range\\n\"); abort(); }\n");
+    sb_append(out, "static long __vais_list_checked_index(long index, long len) { if (index < 0 || index >= len) __vais_list_trap(0); return index; }\n");
+    sb_append(out, "static long __vais_list_checked_last(long len) { if (len <= 0) __vais_list_trap(2); return len - 1; }\n");
+    sb_append(out, "static long __vais_list_checked_pop_index(long *len) { if (*len <= 0) __vais_list_trap(2); *len -= 1; return *len; }\n");
+    /*
+     * Every direct List is a {data, len, cap} header over a heap buffer that
+     * doubles on demand, so locals stay small on the C stack and pushes past
+     * the old 4096-slot layout keep going. Bounds checks read len inline;
+     * only the grow path calls out of line.
+     */
+    sb_append(out, "static void *__vais_grow_array(void *data, long count, size_t elem) { void *next = realloc(data, (size_t)count * elem); if (next == NULL) __builtin_trap(); return next; }\n");
+    sb_append(out, "static void *__vais_list_grow(void *data, long *cap, size_t elem, long need) { long next = *cap < 8 ? 8 : *cap; while (next < need) next *= 2; data = __vais_grow_array(data, next, elem); *cap = next; return data; }\n");
+    sb_append(out, "static void *__vais_list_dup(const void *data, long len, size_t elem) { if (len <= 0) return NULL; void *out = malloc((size_t)len * elem); if (out == NULL) __builtin_trap(); memcpy(out, data, (size_t)len * elem); return out; }\n");
+    sb_append(out, "typedef struct { long *data; long len; long cap; } DirectListInt;\n");
+    sb_append(out, "typedef struct { const char **data; long len; long cap; } DirectList_Str;\n");
+    sb_append(out, "static const char *__vais_str_join(DirectList_Str *parts, const char *sep) { size_t sn = strlen(sep); size_t total = 0; for (long i = 0; i < parts->len; i++) { total += strlen(parts->data[i]); if (i > 0) total += sn; } char *out = __vais_str_alloc(total + 1); if (out == NULL) return \"\"; size_t pos = 0; for (long i = 0; i < parts->len; i++) { if (i > 0) { memcpy(out + pos, sep, sn); pos += sn; } size_t pn = strlen(parts->data[i]); memcpy(out + pos, parts->data[i], pn); pos += pn; } out[pos] = '\\0'; return out; }\n");
+    sb_append(out, "static long __vais_str_split_ws_into(const char *text, DirectList_Str *out) { out->len = 0; long n = (long)strlen(text); long i = 0; while (i < n) { i = __vais_text_scan_space(text, i, n, 0); long start = i; i = __vais_text_scan_space(text, i, n, 1); if (i > start) { if (out->len >= out->cap) out->data = __vais_list_grow(out->data, &out->cap, sizeof(*out->data), out->len + 1); out->data[out->len++] = __vais_str_copy_n(text + start, i - start); } } return out->len; }\n");
+    sb_append(out, "static long __vais_str_split_lines_into(const char *text, DirectList_Str *out) { out->len = 0; long n = (long)strlen(text); long start = 0; while (start < n) { const char *hit = (const char *)memchr(text + start, '\\n', (size_t)(n - start)); long end = hit == NULL ? n : (long)(hit - text); long len = end - start; if (len > 0 && text[end - 1] == '\\r') len--; if (out->len >= out->cap) out->data = __vais_list_grow(out->data, &out->cap, sizeof(*out->data), out->len + 1); out->data[out->len++] = __vais_str_copy_n(text + start, len); start = end + 1; } return out->len; }\n");
+
+    sb_append(out, "static int __vais_fs_list_name_cmp(const void *a, const void *b) { return strcmp(*(const char *const *)a, *(const char *const *)b); }\n");
+    sb_append(out, "static int __vais_fs_list_entry_is(const char *dir, struct dirent *entry, mode_t kind) { if (entry->d_type == DT_REG) return kind == S_IFREG; if (entry->d_type == DT_DIR) return kind == S_IFDIR; if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) return 0; size_t dn = strlen(dir); size_t en = strlen(entry->d_name); char *full = (char *)malloc(dn + en + 2); if (full == 0) __builtin_trap(); memcpy(full, dir, dn); full[dn] = '/'; memcpy(full + dn + 1, entry->d_name, en + 1); struct stat st; int match = stat(full, &st) == 0 && (st.st_mode & S_IFMT) == kind; free(full); return match; }\n");
+    sb_append(out, "static long __vais_fs_list_files(const char *dir, DirectList_Str *out) { out->len = 0; if (dir == 0) return 0; DIR *d = opendir(dir); if (d == 0) return 0; struct dirent *entry; while ((entry = readdir(d)) != 0) { if (strcmp(entry->d_name, \".\") == 0 || strcmp(entry->d_name, \"..\") == 0) continue; if (!__vais_fs_list_entry_is(dir, entry, S_IFREG)) continue; size_t en = strlen(entry->d_name); if (out->len >= out->cap) out->data = __vais_list_grow(out->data, &out->cap, sizeof(*out->data), out->len + 1); char *copy = (char *)malloc(en + 1); if (copy == 0) { closedir(d); __builtin_trap(); } memcpy(copy, entry->d_name, en + 1); out->data[out->len++] = copy; } closedir(d); if (out->len > 1) qsort(out->data, (size_t)out->len, sizeof(char *), __vais_fs_list_name_cmp); return out->len; }\n");
+    sb_append(out, "static long __vais_fs_list_dirs(const char *dir, DirectList_Str *out) { out->len = 0; if (dir == 0) return 0; DIR *d = opendir(dir); if (d == 0) return 0; struct dirent *entry; while ((entry = readdir(d)) != 0) { if (strcmp(entry->d_name, \".\") == 0 || strcmp(entry->d_name, \"..\") == 0) continue; if (!__vais_fs_list_entry_is(dir, entry, S_IFDIR)) continue; size_t en = strlen(entry->d_name); if (out->len >= out->cap) out->data = __vais_list_grow(out->data, &out->cap, sizeof(*out->data), out->len + 1); char *copy = (char *)malloc(en + 1); if (copy == 0) { closedir(d); __builtin_trap(); } memcpy(copy, entry->d_name, en + 1); out->data[out->len++] = copy; } closedir(d); if (out->len > 1) qsort(out->data, (size_t)out->len, sizeof(char *), __vais_fs_list_name_cmp); return out->len; }\n");
+    sb_append(out, "static long __vais_str_split_into(const char *text, const char *sep, DirectList_Str *out) { out->len = 0; size_t sn = strlen(sep); if (sn == 0) { if (out->len >= out->cap) out->data = __vais_list_grow(out->data, &out->cap, sizeof(*out->data), out->len + 1); out->data[out->len++] = __vais_str_copy_n(text, (long)strlen(text)); return out->len; } const char *cursor = text; const char *hit = NULL; while ((hit = strstr(cursor, sep)) != NULL) { if (out->len >= out->cap) out->data = __vais_list_grow(out->data, &out->cap, sizeof(*out->data), out->len + 1); out->data[out->len++] = __vais_str_copy_n(cursor, (long)(hit - cursor)); cursor = hit + sn; } if (out->len >= out->cap) out->data = __vais_list_grow(out->data, &out->cap, sizeof(*out->data), out->len + 1); out->data[out->len++] = __vais_str_copy_n(cursor, (long)strlen(cursor)); return out->len; }\n");
+    sb_append(out, "static long __vais_list_int_sum(DirectListInt *xs) { long total = 0; for (long i = 0; i < xs->len; i++) total += xs->data[i]; return total; }\n");
+    sb_append(out, "static long __vais_list_int_max(DirectListInt *xs) { if (xs->len <= 0) __vais_list_trap(2); long best = xs->data[0]; for (long i = 1; i < xs->len; i++) if (xs->data[i] > best) best = xs->data[i]; return best; }\n");
+    sb_append(out, "static long __vais_list_int_min(DirectListInt *xs) { if (xs->len <= 0) __vais_list_trap(2); long best = xs->data[0]; for (long i = 1; i < xs->len; i++) if (xs->data[i] < best) best = xs->data[i]; return best; }\n");
+    sb_append(out, "static long __vais_list_int_contains(DirectListInt *xs, long value) { for (long i = 0; i < xs->len; i++) if (xs->data[i] == value) return 1; return 0; }\n");
+    sb_append(out, "static long __vais_list_int_index_of(DirectListInt *xs, long value) { for (long i = 0; i < xs->len; i++) if (xs->data[i] == value) return i; return -1; }\n");
+    sb_append(out, "static long __vais_list_int_count(DirectListInt *xs, long value) { long total = 0; for (long i = 0; i < xs->len; i++) if (xs->data[i] == value) total++; return total; }\n");
+    sb_append(out, "static long __vais_list_int_remove_at(DirectListInt *xs, long index) { if (index < 0 || index >= xs->len) __vais_list_trap(0); long value = xs->data[index]; for (long i = index; i < xs->len - 1; i++) xs->data[i] = xs->data[i + 1]; xs->len -= 1; return value; }\n");
+    sb_append(out, "static void __vais_list_int_insert_at(DirectListInt *xs, long index, long value) { if (index < 0 || index > xs->len) __vais_list_trap(1); if (xs->len >= xs->cap) xs->data = __vais_list_grow(xs->data, &xs->cap, sizeof(*xs->data), xs->len + 1); for (long i = xs->len; i > index; i--) xs->data[i] = xs->data[i - 1]; xs->data[index] = value; xs->len += 1; }\n");
+    sb_append(out, "static void __vais_list_int_extend(DirectListInt *dst, DirectListInt *src) { long base = dst->len; long n = src->len; if (base + n > dst->cap) dst->data = __vais_list_grow(dst->data, &dst->cap, sizeof(*dst->data), base + n); for (long i = 0; i < n; i++) dst->data[base + i] = src->data[i]; dst->len = base + n; }\n");
+    sb_append(out, "static long __vais_list_str_contains(DirectList_Str *xs, const char *value) { for (long i = 0; i < xs->len; i++) if (__vais_str_eq(xs->data[i], value)) return 1; return 0; }\n");
+    sb_append(out, "static long __vais_list_str_index_of(DirectList_Str *xs, const char *value) { for (long i = 0; i < xs->len; i++) if (__vais_str_eq(xs->data[i], value)) return i; return -1; }\n");
+    sb_append(out, "static long __vais_list_str_count(DirectList_Str *xs, const char *value) { long total = 0; for (long i = 0; i < xs->len; i++) if (__vais_str_eq(xs->data[i], value)) total++; return total; }\n");
+    sb_append(out, "static const char *__vais_list_str_remove_at(DirectList_Str *xs, long index) { if (index < 0 || index >= xs->len) __vais_list_trap(0); const char *value = xs->data[index]; for (long i = index; i < xs->len - 1; i++) xs->data[i] = xs->data[i + 1]; xs->len -= 1; return value; }\n");
+    sb_append(out, "static void __vais_list_str_insert_at(DirectList_Str *xs, long index, const char *value) { if (index < 0 || index > xs->len) { __vais_list_trap(1); } if (xs->len >= xs->cap) xs->data = __vais_list_grow(xs->data, &xs->cap, sizeof(*xs->data), xs->len + 1); for (long i = xs->len; i > index; i--) xs->data[i] = xs->data[i - 1]; xs->data[index] = value; xs->len += 1; }\n");
+    sb_append(out, "static void __vais_list_str_extend(DirectList_Str *dst, DirectList_Str *src) { long base = dst->len; long n = src->len; if (base + n > dst->cap) dst->data = __vais_list_grow(dst->data, &dst->cap, sizeof(*dst->data), base + n); for (long i = 0; i < n; i++) dst->data[base + i] = src->data[i]; dst->len = base + n; }\n");
+    /*
+     * Concrete maps keep their entries dense in insertion order (key_at,
+     * value_at, and snapshots walk them directly) and index them through a
+     * power-of-two open-addressing table of entry+1 slots with cached key
+     * hashes. Removal backward-shifts the probe run and moves the last entry
+     * into the hole, matching the order the fixed 256-slot layout produced.
+     */
+    sb_append(out, "static unsigned long __vais_map_hash_int(long key) { unsigned long h = (unsigned long)key * 0x9e3779b97f4a7c15UL; return h ^ (h >> 31); }\n");
+    sb_append(out, "static unsigned long __vais_map_hash_str(const char *key) { unsigned long h = 1469598103934665603UL; for (const unsigned char *p = (const unsigned char *)key; *p != 0; p++) { h ^= *p; h *= 1099511628211UL; } return h ^ (h >> 29); }\n");
+    sb_append(out, "static void __vais_map_index_place(long *slots, long slot_cap, unsigned long hash, long entry) { unsigned long mask = (unsigned long)slot_cap - 1; unsigned long s = hash & mask; while (slots[s] != 0) s = (s + 1) & mask; slots[s] = entry + 1; }\n");
+    sb_append(out, "static void __vais_map_index_reserve(long **slots, long *slot_cap, const unsigned long *hashes, long len, long need) { if (need * 4 <= *slot_cap * 3) return; long cap = *slot_cap < 16 ? 16 : *slot_cap; while (need * 4 > cap * 3) cap *= 2; long *next = (long *)calloc((size_t)cap, sizeof(long)); if (next == NULL) __builtin_trap(); for (long i = 0; i < len; i++) __vais_map_index_place(next, cap, hashes[i], i); free(*slots); *slots = next; *slot_cap = cap; }\n");
+    sb_append(out, "static unsigned long __vais_map_index_slot_of(const long *slots, long slot_cap, unsigned long hash, long entry) { unsigned long mask = (unsigned long)slot_cap - 1; unsigned long s = hash & mask; while (slots[s] != entry + 1) s = (s + 1) & mask; return s; }\n");
+    sb_append(out, "static void __vais_map_index_remove(long *slots, long slot_cap, const unsigned long *hashes, long entry, long last) { unsigned long mask = (unsigned long)slot_cap - 1; unsigned long i = __vais_map_index_slot_of(slots, slot_cap, hashes[entry], entry); for (;;) { slots[i] = 0; unsigned long j = i; for (;;) { j = (j + 1) & mask; long e = slots[j]; if (e == 0) goto shifted; unsigned long home = hashes[e - 1] & mask; if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue; slots[i] = e; break; } i = j; } shifted: if (entry != last) slots[__vais_map_index_slot_of(slots, slot_cap, hashes[last], last)] = entry + 1; }\n");
+    sb_append(out, "typedef struct { long *keys; long *values; unsigned long *hashes; long *slots; long len; long cap; long slot_cap; } DirectMapIntInt;\n");
+    sb_append(out, "static long __vais_map_int_int_find_hashed(DirectMapIntInt *m, long key, unsigned long hash) { if (m->slot_cap == 0) return -1; unsigned long mask = (unsigned long)m->slot_cap - 1; for (unsigned long s = hash & mask; m->slots[s] != 0; s = (s + 1) & mask) { long e = m->slots[s] - 1; if (m->hashes[e] == hash && m->keys[e] == key) return e; } return -1; }\n");
+    sb_append(out, "static long __vais_map_int_int_find(DirectMapIntInt *m, long key) { return __vais_map_int_int_find_hashed(m, key, __vais_map_hash_int(key)); }\n");
+    sb_append(out, "static void __vais_map_int_int_reserve(DirectMapIntInt *m, long need) { if (need > m->cap) { long cap = m->cap < 8 ? 8 : m->cap; while (cap < need) cap *= 2; m->keys = (long *)__vais_grow_array((void *)m->keys, cap, sizeof(*m->keys)); m->values = (long *)__vais_grow_array((void *)m->values, cap, sizeof(*m->values)); m->hashes = (unsigned long *)__vais_grow_array(m->hashes, cap, sizeof(unsigned long)); m->cap = cap; } __vais_map_index_reserve(&m->slots, &m->slot_cap, m->hashes, m->len, need); }\n");
+    sb_append(out, "static void __vais_map_int_int_insert(DirectMapIntInt *m, long key, long value) { unsigned long hash = __vais_map_hash_int(key); long i = __vais_map_int_int_find_hashed(m, key, hash); if (i >= 0) { m->values[i] = value; return; } __vais_map_int_int_reserve(m, m->len + 1); i = m->len++; m->keys[i] = key; m->values[i] = value; m->hashes[i] = hash; __vais_map_index_place(m->slots, m->slot_cap, hash, i); }\n");
+    sb_append(out, "static void __vais_map_int_int_remove(DirectMapIntInt *m, long key) { long i = __vais_map_int_int_find(m, key); if (i < 0) return; long last = m->len - 1; __vais_map_index_remove(m->slots, m->slot_cap, m->hashes, i, last); if (i != last) { m->keys[i] = m->keys[last]; m->values[i] = m->values[last]; m->hashes[i] = m->hashes[last]; } m->len = last; }\n");
+    sb_append(out, "static void __vais_map_int_int_clear(DirectMapIntInt *m) { if (m->slot_cap > 0) memset(m->slots, 0, (size_t)m->slot_cap * sizeof(long)); m->len = 0; }\n");
+    sb_append(out, "static void __vais_map_int_int_copy(DirectMapIntInt *dst, DirectMapIntInt *src) { if (dst == src) return; __vais_map_int_int_clear(dst); __vais_map_int_int_reserve(dst, src->len); for (long i = 0; i < src->len; i++) { dst->keys[i] = src->keys[i]; dst->values[i] = src->values[i]; dst->hashes[i] = src->hashes[i]; __vais_map_index_place(dst->slots, dst->slot_cap, src->hashes[i], i); } dst->len = src->len; }\n");
+    sb_append(out, "static DirectMapIntInt __vais_map_int_int_clone(DirectMapIntInt *src) { DirectMapIntInt out = {0}; __vais_map_int_int_copy(&out, src); return out; }\n");
+    sb_append(out, "static void __vais_map_int_int_free(DirectMapIntInt *m) { free(m->keys); free(m->values); free(m->hashes); free(m->slots); }\n");
+    sb_append(out, "static long __vais_map_int_int_get(DirectMapIntInt *m, long key, long fallback) { long i = __vais_map_int_int_find(m, key); return i >= 0 ? m->values[i] : fallback; }\n");
+    sb_append(out, "static long __vais_map_int_int_get_opt(DirectMapIntInt *m, long key) { long i = __vais_map_int_int_find(m, key); return i >= 0 ? (m->values[i] * 2) : 1; }\n");
+    sb_append(out, "static long __vais_map_int_int_contains(DirectMapIntInt *m, long key) { return __vais_map_int_int_find(m, key) >= 0 ? 1 : 0; }\n");
+    sb_append(out, "static long __vais_map_int_int_len(DirectMapIntInt *m) { return m->len; }\n");
+    sb_append(out, "static long __vais_map_int_int_key_at(DirectMapIntInt *m, long index) { if (index < 0 || index >= m->len) __vais_list_trap(0); return m->keys[index]; }\n");
+    sb_append(out, "static long __vais_map_int_int_value_at(DirectMapIntInt *m, long index) { if (index < 0 || index >= m->len) __vais_list_trap(0); return m->values[index]; }\n");
+    sb_append(out, "typedef struct { const char **keys; long *values; unsigned long *hashes; long *slots; long len; long cap; long slot_cap; } DirectMapStrInt;\n");
+    sb_append(out, "static long __vais_map_str_int_find_hashed(DirectMapStrInt *m, const char *key, unsigned long hash) { if (m->slot_cap == 0) return -1; unsigned long mask = (unsigned long)m->slot_cap - 1; for (unsigned long s = hash & mask; m->slots[s] != 0; s = (s + 1) & mask) { long e = m->slots[s] - 1; if (m->hashes[e] == hash && strcmp(m->keys[e], key) == 0) return e; } return -1; }\n");
+    sb_append(out, "static long __vais_map_str_int_find(DirectMapStrInt *m, const char *key) { return __vais_map_str_int_find_hashed(m, key, __vais_map_hash_str(key)); }\n");
+    sb_append(out, "static void __vais_map_str_int_reserve(DirectMapStrInt *m, long need) { if (need > m->cap) { long cap = m->cap < 8 ? 8 : m->cap; while (cap < need) cap *= 2; m->keys = (const char **)__vais_grow_array((void *)m->keys, cap, sizeof(*m->keys)); m->values = (long *)__vais_grow_array((void *)m->values, cap, sizeof(*m->values)); m->hashes = (unsigned long *)__vais_grow_array(m->hashes, cap, sizeof(unsigned long)); m->cap = cap; } __vais_map_index_reserve(&m->slots, &m->slot_cap, m->hashes, m->len, need); }\n");
+    sb_append(out, "static void __vais_map_str_int_insert(DirectMapStrInt *m, const char *key, long value) { unsigned long hash = __vais_map_hash_str(key); long i = __vais_map_str_int_find_hashed(m, key, hash); if (i >= 0) { m->values[i] = value; return; } __vais_map_str_int_reserve(m, m->len + 1); i = m->len++; m->keys[i] = key; m->values[i] = value; m->hashes[i] = hash; __vais_map_index_place(m->slots, m->slot_cap, hash, i); }\n");
+    sb_append(out, "static void __vais_map_str_int_remove(DirectMapStrInt *m, const char *key) { long i = __vais_map_str_int_find(m, key); if (i < 0) return; long last = m->len - 1; __vais_map_index_remove(m->slots, m->slot_cap, m->hashes, i, last); if (i != last) { m->keys[i] = m->keys[last]; m->values[i] = m->values[last]; m->hashes[i] = m->hashes[last]; } m->len = last; }\n");
+    sb_append(out, "static void __vais_map_str_int_clear(DirectMapStrInt *m) { if (m->slot_cap > 0) memset(m->slots, 0, (size_t)m->slot_cap * sizeof(long)); m->len = 0; }\n");
+    sb_append(out, "static void __vais_map_str_int_copy(DirectMapStrInt *dst, DirectMapStrInt *src) { if (dst == src) return; __vais_map_str_int_clear(dst); __vais_map_str_int_reserve(dst, src->len); for (long i = 0; i < src->len; i++) { dst->keys[i] = src->keys[i]; dst->values[i] = src->values[i]; dst->hashes[i] = src->hashes[i]; __vais_map_index_place(dst->slots, dst->slot_cap, src->hashes[i], i); } dst->len = src->len; }\n");
+    sb_append(out, "static DirectMapStrInt __vais_map_str_int_clone(DirectMapStrInt *src) { DirectMapStrInt out = {0}; __vais_map_str_int_copy(&out, src); return out; }\n");
+    sb_append(out, "static void __vais_map_str_int_free(DirectMapStrInt *m) { free(m->keys); free(m->values); free(m->hashes); free(m->slots); }\n");
+    sb_append(out, "static long __vais_map_str_int_get(DirectMapStrInt *m, const char *key, long fallback) { long i = __vais_map_str_int_find(m, key); return i >= 0 ? m->values[i] : fallback; }\n");
+    sb_append(out, "static long __vais_map_str_int_get_opt(DirectMapStrInt *m, const char *key) { long i = __vais_map_str_int_find(m, key); return i >= 0 ? (m->values[i] * 2) : 1; }\n");
+    sb_append(out, "static long __vais_map_str_int_contains(DirectMapStrInt *m, const char *key) { return __vais_map_str_int_find(m, key) >= 0 ? 1 : 0; }\n");
+    sb_append(out, "static long __vais_map_str_int_len(DirectMapStrInt *m) { return m->len; }\n");
+    sb_append(out, "static const char *__vais_map_str_int_key_at(DirectMapStrInt *m, long index) { if (index < 0 || index >= m->len) __vais_list_trap(0); return m->keys[index]; }\n");
+    sb_append(out, "static long __vais_map_str_int_value_at(DirectMapStrInt *m, long index) { if (index < 0 || index >= m->len) __vais_list_trap(0); return m->values[index]; }\n");
+    sb_append(out, "static long __vais_doc_term_counts_into(const char *text, DirectMapStrInt *out) { __vais_map_str_int_clear(out); long total = 0; long n = (long)strlen(text); long i = 0; while (i < n) { i = __vais_text_scan_space(text, i, n, 0); long start = i; i = __vais_text_scan_space(text, i, n, 1); if (i > start) { char *token = __vais_str_alloc((size_t)(i - start) + 1); if (token == NULL) return total; __vais_text_lower_n(token, text + start, i - start); token[i - start] = '\\0'; unsigned long hash = __vais_map_hash_str(token); long slot = __vais_map_str_int_find_hashed(out, token, hash); if (slot >= 0) { out->values[slot] += 1; } else { __vais_map_str_int_insert(out, token, 1); } total++; } } return total; }\n");
+    sb_append(out, "static long __vais_doc_term_overlap_score(DirectMapStrInt *query, DirectMapStrInt *doc) { long score = 0; for (long i = 0; i < query->len; i++) { long qv = query->values[i]; long slot = __vais_map_str_int_find_hashed(doc, query->keys[i], query->hashes[i]); long dv = slot >= 0 ? doc->values[slot] : 0; score += qv < dv ? qv : dv; } return score; }\n");
+    sb_append(out, "static long __vais_doc_term_weighted_score(DirectMapStrInt *query, DirectMapStrInt *doc) { long score = 0; for (long i = 0; i < query->len; i++) { long qv = query->values[i]; long slot = __vais_map_str_int_find_hashed(doc, query->keys[i], query->hashes[i]); long dv = slot >= 0 ? doc->values[slot] : 0; score += qv * dv; } return score; }\n");
+    sb_append(out, "typedef struct { const char **keys; const char **values; unsigned long *hashes; long *slots; long len; long cap; long slot_cap; } DirectMapStrStr;\n");
+    sb_append(out, "static long __vais_map_str_str_find_hashed(DirectMapStrStr *m, const char *key, unsigned long hash) { if (m->slot_cap == 0) return -1; unsigned long mask = (unsigned long)m->slot_cap - 1; for (unsigned long s = hash & mask; m->slots[s] != 0; s = (s + 1) & mask) { long e = m->slots[s] - 1; if (m->hashes[e] == hash && strcmp(m->keys[e], key) == 0) return e; } return -1; }\n");
+    sb_append(out, "static long __vais_map_str_str_find(DirectMapStrStr *m, const char *key) { return __vais_map_str_str_find_hashed(m, key, __vais_map_hash_str(key)); }\n");
+    sb_append(out, "static void __vais_map_str_str_reserve(DirectMapStrStr *m, long need) { if (need > m->cap) { long cap = m->cap < 8 ? 8 : m->cap; while (cap < need) cap *= 2; m->keys = (const char **)__vais_grow_array((void *)m->keys, cap, sizeof(*m->keys)); m->values = (const char **)__vais_grow_array((void *)m->values, cap, sizeof(*m->values)); m->hashes = (unsigned long *)__vais_grow_array(m->hashes, cap, sizeof(unsigned long)); m->cap = cap; } __vais_map_index_reserve(&m->slots, &m->slot_cap, m->hashes, m->len, need); }\n");
+    sb_append(out, "static void __vais_map_str_str_insert(DirectMapStrStr *m, const char *key, const char *value) { unsigned long hash = __vais_map_hash_str(key); long i = __vais_map_str_str_find_hashed(m, key, hash); if (i >= 0) { m->values[i] = value; return; } __vais_map_str_str_reserve(m, m->len + 1); i = m->len++; m->keys[i] = key; m->values[i] = value; m->hashes[i] = hash; __vais_map_index_place(m->slots, m->slot_cap, hash, i); }\n");
+    sb_append(out, "static void __vais_map_str_str_remove(DirectMapStrStr *m, const char *key) { long i = __vais_map_str_str_find(m, key); if (i < 0) return; long last = m->len - 1; __vais_map_index_remove(m->slots, m->slot_cap, m->hashes, i, last); if (i != last) { m->keys[i] = m->keys[last]; m->values[i] = m->values[last]; m->hashes[i] = m->hashes[last]; } m->len = last; }\n");
+    sb_append(out, "static void __vais_map_str_str_clear(DirectMapStrStr *m) { if (m->slot_cap > 0) memset(m->slots, 0, (size_t)m->slot_cap * sizeof(long)); m->len = 0; }\n");
+    sb_append(out, "static void __vais_map_str_str_copy(DirectMapStrStr *dst, DirectMapStrStr *src) { if (dst == src) return; __vais_map_str_str_clear(dst); __vais_map_str_str_reserve(dst, src->len); for (long i = 0; i < src->len; i++) { dst->keys[i] = src->keys[i]; dst->values[i] = src->values[i]; dst->hashes[i] = src->hashes[i]; __vais_map_index_place(dst->slots, dst->slot_cap, src->hashes[i], i); } dst->len = src->len; }\n");
+    sb_append(out, "static DirectMapStrStr __vais_map_str_str_clone(DirectMapStrStr *src) { DirectMapStrStr out = {0}; __vais_map_str_str_copy(&out, src); return out; }\n");
+    sb_append(out, "static void __vais_map_str_str_free(DirectMapStrStr *m) { free(m->keys); free(m->values); free(m->hashes); free(m->slots); }\n");
+    sb_append(out, "static const char *__vais_map_str_str_get(DirectMapStrStr *m, const char *key, const char *fallback) { long i = __vais_map_str_str_find(m, key); return i >= 0 ? m->values[i] : fallback; }\n");
+    sb_append(out, "static long __vais_map_str_str_get_opt(DirectMapStrStr *m, const char *key) { long i = __vais_map_str_str_find(m, key); return i >= 0 ? (long)(uintptr_t)m->values[i] : 1; }\n");
+    sb_append(out, "static long __vais_map_str_str_contains(DirectMapStrStr *m, const char *key) { return __vais_map_str_str_find(m, key) >= 0 ? 1 : 0; }\n");
+    sb_append(out, "static long __vais_map_str_str_len(DirectMapStrStr *m) { return m->len; }\n");
+    sb_append(out, "static const char *__vais_map_str_str_key_at(DirectMapStrStr *m, long index) { if (index < 0 || index >= m->len) __vais_list_trap(0); return m->keys[index]; }\n");
+    sb_append(out, "static const char *__vais_map_str_str_value_at(DirectMapStrStr *m, long index) { if (index < 0 || index >= m->len) __vais_list_trap(0); return m->values[index]; }\n");
+    sb_append(out, "static const char *__vais_map_str_str_snapshot(DirectMapStrStr *m) { size_t total = 0; for (long i = 0; i < m->len; i++) { total += strlen(m->keys[i]) + strlen(m->values[i]) + 2; } char *out = __vais_str_alloc(total + 1); if (out == NULL) return \"\"; size_t pos = 0; for (long i = 0; i < m->len; i++) { size_t kn = strlen(m->keys[i]); size_t vn = strlen(m->values[i]); memcpy(out + pos, m->keys[i], kn); pos += kn; out[pos++] = '='; memcpy(out + pos, m->values[i], vn); pos += vn; out[pos++] = '\\n'; } out[pos] = '\\0'; return out; }\n");
+    sb_append(out, "static long __vais_map_str_str_load_snapshot_line(const char *text, DirectMapStrStr *out, long start, long end, long eq) { while (end > start && text[end - 1] == '\\r') end--; if (eq < start || eq >= end || eq == start) return 0; const char *key = __vais_str_copy_n(text + start, eq - start); const char *value = __vais_str_copy_n(text + eq + 1, end - eq - 1); __vais_map_str_str_insert(out, key, value); return 1; }\n");
+    sb_append(out, "static long __vais_map_str_str_load_snapshot(const char *text, DirectMapStrStr *out) { __vais_map_str_str_clear(out); long count = 0; long i = 0; long start = 0; long eq = -1; while (text[i] != '\\0') { if (text[i] == '\\n') { count += __vais_map_str_str_load_snapshot_line(text, out, start, i, eq); i++; start = i; eq = -1; } else { if (text[i] == '=' && eq < 0) eq = i; i++; } } count += __vais_map_str_str_load_snapshot_line(text, out, start, i, eq); return count; }\n");
+}
+
+static int direct_runtime_fn_line(const char *line) {
+    return starts_with(line, "static ") && strchr(line, '{') != NULL;
+}
+
+/* The prelude with each helper reduced to a prototype, for programs that link
+   the cached direct runtime object. */
+static void direct_append_runtime_decls(StrBuf *out) {
+    StrBuf prelude;
+    sb_init(&prelude);
+    direct_append_runtime_prelude(&prelude);
+    LineVec lines = split_lines(prelude.data);
+    for (size_t i = 0; i < lines.len; i++) {
+        const char *line = lines.items[i];
+        if (direct_runtime_fn_line(line)) {
+            const char *sig = line + 7;
+            size_t len = (size_t)(strchr(sig, '{') - sig);
+            while (len > 0 && sig[len - 1] == ' ') len--;
+            sb_append_n(out, sig, len);
+            sb_append(out, ";\n");
+        } else {
+            sb_append(out, line);
+            sb_append(out, "\n");
+        }
+    }
+    lines_free(&lines);
+    free(prelude.data);
+}
+
+/* The prelude as a standalone translation unit with external helpers. */
+char *direct_runtime_c_text(void) {
+    StrBuf prelude;
+    sb_init(&prelude);
+    direct_append_runtime_prelude(&prelude);
+    LineVec lines = split_lines(prelude.data);
+    StrBuf out;
+    sb_init(&out);
+    for (size_t i = 0; i < lines.len; i++) {
+        const char *line = lines.items[i];
+        sb_append(&out, direct_runtime_fn_line(line) ? line + 7 : line);
+        sb_append(&out, "\n");
+    }
+    lines_free(&lines);
+    free(prelude.data);
+    return sb_take(&out);
+}
+
+static char *direct_lower_to_c(const char *path, const char *raw) {
+    LineVec lines = split_lines(raw);
+    DirectFnInfo *fns = NULL;
+    DirectStructInfo *structs = NULL;
+    int fn_count = 0;
+    int fn_cap = 0;
+    int struct_count = 0;
+    int struct_cap = 0;
+    int *skip_lines = (int *)calloc(lines.len == 0 ? 1 : lines.len, sizeof(int));
+    if (skip_lines == NULL) die_oom();
+    int has_main = 0;
+
+    for (size_t i = 0; i < lines.len; i++) {
+        char *code = strip_line_comment(lines.items[i], strlen(lines.items[i]));
+        const char *trim = skip_ws(code);
+        if (starts_with(trim, "import") && !is_ident_continue(trim[6])) {
+            report_issue(path, (int)i + 1, find_col(lines.items[i], "import"), lines.items[i],
+                "direct native emitter expected imports to be resolved before lowering",
+                "run direct compilation through `scripts/vaisc`, which resolves local dotted imports before lowering.",
+                NULL);
+            free(code);
+            free(skip_lines);
+            lines_free(&lines);
+            direct_structs_free(structs, struct_count);
+            free(structs);
+            direct_fns_free(fns, fn_count);
+            free(fns);
+            return NULL;
+        }
+        if ((starts_with(trim, "module") && !is_ident_continue(trim[6])) ||
+            (starts_with(trim, "package") && !is_ident_continue(trim[7]))) {
+            const char *kw = starts_with(trim, "module") ? "module" : "package";
+            report_issue(path, (int)i + 1, find_col(lines.items[i], kw), lines.items[i],
+                "module and package declarations are not implemented yet",
+                "omit the declaration; module names are derived from file paths in the first import slice.",
+                NULL);
+            free(code);
+            free(skip_lines);
+            lines_free(&lines);
+            direct_structs_free(structs, struct_count);
+            free(structs);
+            direct_fns_free(fns, fn_count);
+            free(fns);
+            return NULL;
+        }
+        free(code);
+
+        DirectStructInfo st;
+        memset(&st, 0, sizeof(st));
+        size_t struct_end = i;
+        int parsed_struct = direct_parse_struct_decl(&lines, i, &st, &struct_end, structs, struct_count, path);
+        if (parsed_struct == 1) {
+            if (direct_find_struct(structs, struct_count, st.name) != NULL) {
+                report_issue(path, st.line_no, find_col(lines.items[i], st.name), lines.items[i],
+                    "direct native emitter found a duplicate struct name",
+                    "use a unique name for each direct-engine struct declaration.",
+                    NULL);
+                direct_struct_free_one(&st);
+                free(skip_lines);
+                lines_free(&lines);
+                direct_structs_free(structs, struct_count);
+                free(structs);
+                direct_fns_free(fns, fn_count);
+                free(fns);
+                return NULL;
+            }
+            for (size_t j = i; j <= struct_end && j < lines.len; j++) skip_lines[j] = 1;
+            if (struct_count == struct_cap) {
+                struct_cap = struct_cap == 0 ? 16 : struct_cap * 2;
+                structs = (DirectStructInfo *)realloc(structs, (size_t)struct_cap * sizeof(DirectStructInfo));
+                if (structs == NULL) die_oom();
+            }
+            structs[struct_count++] = st;
+            direct_name_index_note(&direct_struct_index, structs, struct_count, st.name);
+            i = struct_end;
+            continue;
+        }
+        if (parsed_struct < 0) {
+            free(skip_lines);
+            lines_free(&lines);
+            direct_structs_free(structs, struct_count);
+            free(structs);
+            direct_fns_free(fns, fn_count);
+            free(fns);
+            return NULL;
+        }
+
+        DirectFnInfo info;
+        memset(&info, 0, sizeof(info));
+        int parsed = parse_direct_fn_header(lines.items[i], &info);
+        if (parsed == 1) {
+            info.line_no = (int)i + 1;
+            if (strcmp(info.name, "main") == 0) {
+                if (info.param_count != 0 || strcmp(info.return_type, "Int") != 0) {
+                    report_issue(path, (int)i + 1, find_col(lines.items[i], "main"), lines.items[i],
+                        "direct native emitter requires `fn main() -> Int`",
+                        "write the entrypoint without parameters.",
+                        NULL);
+                    direct_fns_free(&info, 1);
+                    free(skip_lines);
+                    lines_free(&lines);
+                    direct_structs_free(structs, struct_count);
+                    free(structs);
+                    direct_fns_free(fns, fn_count);
+                    free(fns);
+                    return NULL;
+                }
+                has_main = 1;
+            }
+            if (fn_count == fn_cap) {
+                fn_cap = fn_cap == 0 ? 64 : fn_cap * 2;
+                fns = (DirectFnInfo *)realloc(fns, (size_t)fn_cap * sizeof(DirectFnInfo));
+                if (fns == NULL) die_oom();
+            }
+            fns[fn_count++] = info;
+            direct_name_index_note(&direct_fn_index, fns, fn_count, info.name);
+        } else if (parsed < 0) {
+            report_issue(path, (int)i + 1, 1, lines.items[i],
+                "direct native emitter supports scalar/Option/Result/List/Struct function headers, verified concrete Map returns, and verified Map parameters",
+                "write functions with `Int`, `Bool`, `Char`, `Str`, `Option<Int>`, `Result<Int,Int>`, `List<Int>`, `List<Struct>`, declared struct types, or verified concrete Map parameters/returns such as `Map<Int,Int>` or `Map<Str,Str>`.",
+                NULL);
+            free(skip_lines);
+            lines_free(&lines);
+            direct_structs_free(structs, struct_count);
+            free(structs);
+            direct_fns_free(fns, fn_count);
+            free(fns);
+            return NULL;
+        }
+    }
+
+    for (int f = 0; f < fn_count; f++) {
+        if (direct_validate_fn_types(path, lines.items[fns[f].line_no - 1], &fns[f], structs, struct_count) != 0) {
+            free(skip_lines);
+            lines_free(&lines);
+            direct_structs_free(structs, struct_count);
+            free(structs);
+            direct_fns_free(fns, fn_count);
+            free(fns);
+            return NULL;
+        }
+    }
+
+    if (!has_main) {
+        report_issue(path, 1, 1, lines.len ? lines.items[0] : "",
+            "direct native emitter requires `fn main() -> Int`",
+            "add `fn main() -> Int { return <int> }` as the program entrypoint.",
+            NULL);
+        free(skip_lines);
+        lines_free(&lines);
+        direct_structs_free(structs, struct_count);
+        free(structs);
+        direct_fns_free(fns, fn_count);
+        free(fns);
+        return NULL;
+    }
+
+    StrBuf out;
+    sb_init(&out);
+    if (vaisc_direct_runtime_split) {
+        direct_append_runtime_decls(&out);
+    } else {
+        direct_append_runtime_prelude(&out);
+    }
+    for (int s = 0; s < struct_count; s++) {
+        sb_append(&out, "typedef struct {");
+        for (int f = 0; f < structs[s].field_count; f++) {
+            sb_append(&out, " ");
+            sb_append(&out, direct_c_type(structs[s].field_types[f]));
+            sb_append(&out, " ");
+            sb_append(&out, structs[s].fields[f]);
+            sb_append(&out, ";");
+        }
+        sb_append(&out, " } ");
+        sb_append(&out, structs[s].name);
+        sb_append(&out, ";\n");
+    }
+    sb_append(&out, "extern pid_t fork(void);\n");
+    sb_append(&out, "extern int execvp(const char *, char *const []);\n");
+    sb_append(&out, "extern void _exit(int);\n");
+    sb_append(&out, "extern int setenv(const char *, const char *, int);\n");
+    sb_append(&out, "static long __vais_proc_run_env(DirectList_Str *argv_list, DirectList_Str *env_list) { if (argv_list == NULL || argv_list->len <= 0) return 1; char **argv = (char **)malloc((size_t)(argv_list->len + 1) * sizeof(char *)); if (argv == NULL) return 1; for (long i = 0; i < argv_list->len; i++) argv[i] = (char *)argv_list->data[i]; argv[argv_list->len] = NULL; pid_t pid = fork(); if (pid < 0) { free(argv); return errno == 0 ? 1 : errno; } if (pid == 0) { if (env_list != NULL) { for (long i = 0; i < env_list->len; i++) { const char *entry = env_list->data[i]; if (entry == NULL) _exit(127); const char *eq = strchr(entry, '='); if (eq == NULL || eq == entry) _exit(127); size_t key_len = (size_t)(eq - entry); char *key = (char *)malloc(key_len + 1); if (key == NULL) _exit(127); memcpy(key, entry, key_len); key[key_len] = '\\0'; if (setenv(key, eq + 1, 1) != 0) _exit(127); free(key); } } execvp(argv[0], argv); fprintf(stderr, \"vais direct proc_run_env failed: %s: %s\\n\", argv[0], strerror(errno == 0 ? EIO : errno)); _exit(127); } int status = 0; while (waitpid(pid, &status, 0) < 0) { if (errno == EINTR) continue; int err = errno == 0 ? 1 : errno; free(argv); return err; } free(argv); if (WIFEXITED(status)) return WEXITSTATUS(status); if (WIFSIGNALED(status)) return 128 + WTERMSIG(status); return 1; }\n");
+    sb_append(&out, "static long __vais_proc_run(DirectList_Str *argv_list) { if (argv_list == NULL || argv_list->len <= 0) return 1; char **argv = (char **)malloc((size_t)(argv_list->len + 1) * sizeof(char *)); if (argv == NULL) return 1; for (long i = 0; i < argv_list->len; i++) argv[i] = (char *)argv_list->data[i]; argv[argv_list->len] = NULL; pid_t pid = fork(); if (pid < 0) { free(argv); return errno == 0 ? 1 : errno; } if (pid == 0) { execvp(argv[0], argv); fprintf(stderr, \"vais direct proc_run failed: %s: %s\\n\", argv[0], strerror(errno == 0 ? EIO : errno)); _exit(127); } int status = 0; while (waitpid(pid, &status, 0) < 0) { if (errno == EINTR) continue; int err = errno == 0 ? 1 : errno; free(argv); return err; } free(argv); if (WIFEXITED(status)) return WEXITSTATUS(status); if (WIFSIGNALED(status)) return 128 + WTERMSIG(status); return 1; }\n");
+    sb_append(&out, "extern int64_t vais_proc_spawn_argv(char **, const char *, const char *);\n");
+    sb_append(&out, "static long __vais_proc_spawn(DirectList_Str *argv_list) { if (argv_list == NULL || argv_list->len <= 0) return 0; char **argv = (char **)malloc((size_t)(argv_list->len + 1) * sizeof(char *)); if (argv == NULL) return 0; for (long i = 0; i < argv_list->len; i++) argv[i] = (char *)argv_list->data[i]; argv[argv_list->len] = NULL; long handle = (long)vais_proc_spawn_argv(argv, NULL, NULL); free(argv); return handle; }\n");
+    sb_append(&out, "static long __vais_proc_spawn_to(DirectList_Str *argv_list, const char *stdout_path, const char *stderr_path) { if (argv_list == NULL || argv_list->len <= 0) return 0; char **argv = (char **)malloc((size_t)(argv_list->len + 1) * sizeof(char *)); if (argv == NULL) return 0; for (long i = 0; i < argv_list->len; i++) argv[i] = (char *)argv_list->data[i]; argv[argv_list->len] = NULL; long handle = (long)vais_proc_spawn_argv(argv, stdout_path, stderr_path); free(argv); return handle; }\n");
+    if (direct_has_process_result_struct(structs, struct_count)) {
+        sb_append(&out, "extern int64_t vais_proc_capture_argv(char **, char **, char **);\n");
+        sb_append(&out, "static ProcessResult __vais_proc_capture(DirectList_Str *argv_list) { ProcessResult result = {0}; result.code = 1; result.stdout = \"\"; result.stderr = \"\"; if (argv_list == NULL || argv_list->len <= 0) return result; char **argv = (char **)malloc((size_t)(argv_list->len + 1) * sizeof(char *)); if (argv == NULL) return result; for (long i = 0; i < argv_list->len; i++) argv[i] = (char *)argv_list->data[i]; argv[argv_list->len] = NULL; char *out_text = NULL; char *err_text = NULL; result.code = (long)vais_proc_capture_argv(argv, &out_text, &err_text); free(argv); result.stdout = out_text; result.stderr = err_text; return result; }\n");
+    }
+    sb_append(&out, "#define div __vais_user_div\n");
+    if (strcmp(vaisc_entry_symbol, "main") != 0) {
+        sb_append(&out, "#define main ");
+        sb_append(&out, vaisc_entry_symbol);
+        sb_append(&out, "\n");
+    }
+    for (int s = 0; s < struct_count; s++) {
+        sb_append(&out, "typedef struct { ");
+        sb_append(&out, structs[s].name);
+        sb_append(&out, " *data; long len; long cap; } DirectList_");
+        sb_append(&out, structs[s].name);
+        sb_append(&out, ";\n");
+    }
+    for (int f = 0; f < fn_count; f++) {
+        sb_append(&out, direct_c_type(fns[f].return_type));
+        sb_append(&out, " ");
+        sb_append(&out, fns[f].name);
+        sb_append(&out, "(");
+        for (int p = 0; p < fns[f].param_count; p++) {
+            if (p > 0) sb_append(&out, ", ");
+            sb_append(&out, direct_c_param_type(fns[f].param_types[p]));
+            sb_append(&out, " ");
+            sb_append(&out, fns[f].params[p]);
+        }
+        sb_append(&out, ");\n");
+    }
+    DirectNameSet locals;
+    memset(&locals, 0, sizeof(locals));
+    int in_main = 0;
+    int main_depth = 0;
+    int main_has_return = 0;
+    int in_func = 0;
+    int func_depth = 0;
+    char *prof_fn = NULL;
+    StrBuf fn_out;
+    StrBuf fn_decls;
+    sb_init(&fn_out);
+    sb_init(&fn_decls);
+    for (size_t i = 0; i < lines.len; i++) {
+        if (skip_lines[i]) continue;
+        size_t stmt_end = i;
+        char *line_for_lower = direct_join_delimited_statement(&lines, i, &stmt_end, structs, struct_count);
+        DirectFnInfo line_header;
+        memset(&line_header, 0, sizeof(line_header));
+        int header_state = parse_direct_fn_header(line_for_lower, &line_header);
+        if (header_state == 1 && !in_func) {
+            free(fn_out.data);
+            free(fn_decls.data);
+            sb_init(&fn_out);
+            sb_init(&fn_decls);
+            locals.hoist_decls = &fn_decls;
+            in_func = 1;
+            func_depth = 0;
+            if (vaisc_instrument) prof_fn = strdup(line_header.name);
+        }
+        if (header_state == 1 && strcmp(line_header.name, "main") == 0) {
+            in_main = 1;
+            main_depth = 0;
+        }
+        if (in_main && strstr(skip_ws(line_for_lower), "return ") != NULL) main_has_return = 1;
+        StrBuf *target_out = in_func ? &fn_out : &out;
+        if (in_func && stmt_end == i) direct_concat_acc_open(&lines, i, func_depth, &locals, target_out);
+        if (direct_lower_line(path, (int)i + 1, line_for_lower, &locals, fns, fn_count, structs, struct_count, target_out) != 0) {
+            if (header_state == 1) {
+                direct_fns_free(&line_header, 1);
+            }
+            free(line_for_lower);
+            free(prof_fn);
+            free(out.data);
+            free(fn_out.data);
+            free(fn_decls.data);
+            free(skip_lines);
+            direct_names_free(&locals);
+            lines_free(&lines);
+            direct_structs_free(structs, struct_count);
+            free(structs);
+            direct_fns_free(fns, fn_count);
+            free(fns);
+            return NULL;
+        }
+        if (header_state == 1) {
+            direct_fns_free(&line_header, 1);
+        }
+        if (in_func) {
+            func_depth += direct_source_brace_delta(line_for_lower);
+            direct_concat_acc_close(&locals, func_depth, &fn_out);
+            if (func_depth <= 0) {
+                direct_append_function_with_decls(&out, &fn_out, &fn_decls);
+                if (prof_fn != NULL) direct_append_prof_wrapper(&out, fns, fn_count, prof_fn);
+                free(prof_fn);
+                prof_fn = NULL;
+                free(fn_out.data);
+                free(fn_decls.data);
+                sb_init(&fn_out);
+                sb_init(&fn_decls);
+                locals.hoist_decls = NULL;
+                in_func = 0;
+                func_depth = 0;
+            }
+        }
+        if (in_main) {
+            main_depth += direct_source_brace_delta(line_for_lower);
+            if (main_depth <= 0) {
+                in_main = 0;
+                main_depth = 0;
+            }
+        }
+        free(line_for_lower);
+        i = stmt_end;
+    }
+    if (in_func) {
+        direct_append_function_with_decls(&out, &fn_out, &fn_decls);
+        if (prof_fn != NULL) direct_append_prof_wrapper(&out, fns, fn_count, prof_fn);
+        free(prof_fn);
+        prof_fn = NULL;
+        free(fn_out.data);
+        free(fn_decls.data);
+        fn_out.data = NULL;
+        fn_decls.data = NULL;
+        locals.hoist_decls = NULL;
+    }
+    if (!main_has_return) {
+        report_issue(path, 1, 1, lines.len ? lines.items[0] : "",
+            "direct native emitter requires at least one `return` statement",
+            "write `fn main() -> Int { return 40 + 2 }` for the direct Int subset.",
+            "fn main() -> Int { return 40 + 2 }");
+        free(out.data);
+        free(fn_out.data);
+        free(fn_decls.data);
+        free(skip_lines);
+        direct_names_free(&locals);
+        lines_free(&lines);
+        direct_structs_free(structs, struct_count);
+        free(structs);
+        direct_fns_free(fns, fn_count);
+        free(fns);
+        return NULL;
+    }
+
+    free(skip_lines);
+    free(fn_out.data);
+    free(fn_decls.data);
+    direct_names_free(&locals);
+    lines_free(&lines);
+    direct_structs_free(structs, struct_count);
+    free(structs);
+    direct_fns_free(fns, fn_count);
+    free(fns);
+    return sb_take(&out);
+}
+
+/* Resolves, prepares, and lowers a direct-engine program to C text. */
+char *direct_lower_file(const char *source) {
+    return direct_lower_resolved(source, NULL);
+}
+
+/* Same as direct_lower_file from an already merged module graph (freed
+   here); NULL resolves source first. */
+char *direct_lower_resolved(const char *source, char *merged) {
+    if (!has_vais_suffix(source)) {
+        fprintf(stderr, "error: Vais source files must use the .vais extension: %s\n", source);
+        free(merged);
+        return NULL;
+    }
+    if (merged == NULL) merged = resolve_module_graph_source_timed(source);
+    if (merged == NULL) return NULL;
+    int prepare_phase = stats_phase_begin("prepare", strlen(merged));
+    SourceLines src;
+    source_lines_init(&src, merged);
+    free(merged);
+    run_source_pass(&src, "split_statement_lines", split_statement_lines);
+    run_source_pass(&src, "lower_self_recursion", lower_self_recursion_lines);
+    run_source_pass(&src, "lower_map_str_str_get_opt_embedded_match", lower_map_str_str_get_opt_embedded_match_lines);
+    run_source_pass(&src, "lower_result_str_int", lower_result_str_int_lines);
+    run_source_pass(&src, "lower_result_str_str", lower_result_str_str_lines);
+    run_source_pass(&src, "lower_result_struct_int", lower_result_struct_int_lines);
+    run_source_pass(&src, "lower_enum", lower_enum_lines);
+    run_source_pass(&src, "lower_nested_list", lower_nested_list_lines);
+    run_source_pass(&src, "lower_list_method", lower_list_method_lines);
+    char *prepared = source_lines_take(&src);
+    stats_phase_end(prepare_phase, strlen(prepared));
+    int lower_phase = stats_phase_begin("direct_lower_to_c", strlen(prepared));
+    char *c_src = direct_lower_to_c(source, prepared);
+    stats_phase_end(lower_phase, c_src == NULL ? 0 : strlen(c_src));
+    free(prepared);
+    return c_src;
+}
+
+/* Pipes lowered C into clang and writes its LLVM IR to out_path ("-" is
+   stdout, which clang writes directly). */
+int direct_emit_ir_text(const char *c_src, const char *out_path, const char *clang) {
+    size_t c_len = strlen(c_src);
+    char *const argv[] = {(char *)clang, "-S", "-emit-llvm", "-Wno-main-return-type", (char *)vaisc_opt_flag(), "-o", (char *)out_path, "-x", "c", "-", NULL};
+    int emit_phase = stats_child_phase_begin("clang_emit_ir", c_len);
+    int rc = run_program_feed(argv, c_src, c_len);
+    stats_phase_end(emit_phase, strcmp(out_path, "-") == 0 ? 0 : stats_file_size(out_path));
+    if (rc != 0) {
+        fprintf(stderr, "error: clang direct emit failed with exit code %d\n", rc);
+        return 1;
+    }
+    return 0;
+}
+
+int direct_emit_ir_file(const char *source, const char *out_path, const char *clang) {
+    char *c_src = direct_lower_file(source);
+    if (c_src == NULL) return 1;
+    int rc = direct_emit_ir_text(c_src, out_path, clang);
+    free(c_src);
+    return rc;
+}
+
+/* Output hooks called by the compiler core for all IR text. While
+   compile_to_buffer runs they append to its buffer; the core's own weak
+   putchar fallbacks are only used by standalone self-host builds. */
+static StrBuf *vaisc_emit_buffer = NULL;
+
+int64_t vais_emit_bytes(const char *text, int64_t start, int64_t len) {
+    if (len <= 0) return 0;
+    if (vaisc_emit_buffer == NULL) {
+        fwrite(text + start, 1, (size_t)len, stdout);
+        return 0;
+    }
+    sb_append_n(vaisc_emit_buffer, text + start, (size_t)len);
+    return 0;
+}
+
+int64_t vais_emit_str(const char *text) {
+    return vais_emit_bytes(text, 0, (int64_t)strlen(text));
+}
+
+int64_t vais_emit_byte(int64_t c) {
+    StrBuf *sb = vaisc_emit_buffer;
+    if (sb == NULL) {
+        putchar((int)c);
+        return 0;
+    }
+    sb_reserve(sb, sb->len + 2);
+    sb->data[sb->len++] = (char)c;
+    sb->data[sb->len] = '\0';
+    return 0;
+}
+
+int64_t vais_emit_int(int64_t value) {
+    char digits[32];
+    int n = snprintf(digits, sizeof(digits), "%lld", (long long)value);
+    return vais_emit_bytes(digits, 0, n);
+}
+
+int64_t vais_emit_entry(void) {
+    vaisc_entry_count++;
+    return vais_emit_str(vaisc_entry_symbol);
+}
+
+/* A module linked into a program (the entrypoint renamed for the host
+   runtime) keeps only that entrypoint external; emit-ir output, such as the
+   core, whose functions the driver calls by name, keeps default linkage. */
+int64_t vais_emit_linkage(void) {
+    if (strcmp(vaisc_entry_symbol, "main") == 0) return 0;
+    return vais_emit_str("internal ");
+}
+
+/* Run the compiler core on prepared source and return the complete module
+   (host intrinsic declarations followed by the core's IR) as one block.
+   A non-NULL entry names the program entrypoint for a link and requires the
+   module to define exactly one. */
+char *compile_to_buffer(char *prepared, const char *entry, size_t *out_len) {
+    int phase = stats_phase_begin("self_host_compile", strlen(prepared));
+    StrBuf out;
+    sb_init(&out);
+    sb_reserve(&out, strlen(prepared) * 6);
+    sb_append(&out, HOST_INTRINSIC_IR);
+    StrBuf *saved = vaisc_emit_buffer;
+    const char *saved_entry = vaisc_entry_symbol;
+    vaisc_emit_buffer = &out;
+    if (entry != NULL) vaisc_entry_symbol = entry;
+    vaisc_entry_count = 0;
+    int64_t rc = compile(prepared);
+    vaisc_emit_buffer = saved;
+    vaisc_entry_symbol = saved_entry;
+    stats_phase_end(phase, out.len);
+    if (rc != 0) {
+        fprintf(stderr, "error: self-host compiler exited %lld\n", (long long)rc);
+        free(out.data);
+        return NULL;
+    }
+    if (entry != NULL && vaisc_entry_count != 1) {
+        fprintf(stderr, "error: invalid Vais build IR: expected one @main, found %d\n", vaisc_entry_count);
+        free(out.data);
+        return NULL;
+    }
+    if (out_len != NULL) *out_len = out.len;
+    return sb_take(&out);
+}
+
+int compile_to_stream(char *prepared) {
+    size_t len = 0;
+    char *ir = compile_to_buffer(prepared, NULL, &len);
+    if (ir == NULL) return 1;
+    int rc = fwrite(ir, 1, len, stdout) == len && fflush(stdout) == 0 ? 0 : 1;
+    if (rc != 0) fprintf(stderr, "error: cannot write IR to stdout: %s\n", strerror(errno));
+    free(ir);
+    return rc;
+}
+
+int compile_to_file(char *prepared, const char *out_path) {
+    char *ir = compile_to_buffer(prepared, NULL, NULL);
+    if (ir == NULL) return 1;
+    int rc = write_file_text(out_path, ir);
+    free(ir);
+    return rc;
+}
@@ -0,0 +1,2272 @@
+/* The C host runtime text linked into every built program. */
+#include "vaisc_native.h"
+
+const char *host_runtime_c_text(void) {
+    return
+        "#include <dirent.h>\n"
+        "#include <errno.h>\n"
+        "#include <fcntl.h>\n"
+        "#include <poll.h>\n"
+        "#include <stdint.h>\n"
+        "#include <stdio.h>\n"
+        "#include <string.h>\n"
+        "#include <stdlib.h>\n"
+        "#include <sys/mman.h>\n"
+        "#include <sys/stat.h>\n"
+        "#include <sys/time.h>\n"
+        "#include <sys/wait.h>\n"
+        "#include <time.h>\n"
+        "#include <unistd.h>\n"
+        "\n"
+        "/* `vaisc build --instrument` profiler. The resolver gives every function,\n"
+        "   statement loop, and allocating call site a marker id and a `path:line`\n"
+        "   label; these hooks count calls, loop iterations, clock ticks, and\n"
+        "   allocation bytes per id and write one TSV row per id at exit, to\n"
+        "   $VAIS_PROFILE_OUT or vais-profile.tsv. A function's `cycles` include its\n"
+        "   callees (outermost recursive activation only) and `self` excludes them;\n"
+        "   the header's total is the time spent in outermost functions.\n"
+        "   The allocation hooks stand in for malloc/calloc/realloc in this runtime\n"
+        "   and in instrumented programs; until the first marker runs they only\n"
+        "   forward. */\n"
+        "#if defined(__x86_64__) || defined(__i386__)\n"
+        "#define VAIS_PROF_UNIT \"cycles\"\n"
+        "#elif defined(__aarch64__)\n"
+        "#define VAIS_PROF_UNIT \"ticks\"\n"
+        "#else\n"
+        "#define VAIS_PROF_UNIT \"ns\"\n"
+        "#endif\n"
+        "\n"
+        "typedef struct {\n"
+        "    const char *where;\n"
+        "    int64_t kind;\n"
+        "    int64_t calls;\n"
+        "    int64_t iters;\n"
+        "    uint64_t cycles;\n"
+        "    uint64_t self;\n"
+        "    int64_t allocs;\n"
+        "    int64_t bytes;\n"
+        "    int64_t active;\n"
+        "} VaisProfEntry;\n"
+        "\n"
+        "typedef struct {\n"
+        "    int64_t id;\n"
+        "    uint64_t start;\n"
+        "    uint64_t child;\n"
+        "    int64_t saved_site;\n"
+        "    int64_t saved_fn;\n"
+        "} VaisProfFrame;\n"
+        "\n"
+        "static VaisProfEntry *vais_prof_entries = 0;\n"
+        "static int64_t vais_prof_cap = 0;\n"
+        "static VaisProfFrame *vais_prof_frames = 0;\n"
+        "static int64_t vais_prof_frame_count = 0;\n"
+        "static int64_t vais_prof_frame_cap = 0;\n"
+        "static int64_t vais_prof_site_now = -1;\n"
+        "static int64_t vais_prof_fn_now = -1;\n"
+        "static int vais_prof_on = 0;\n"
+        "static pid_t vais_prof_pid = 0;\n"
+        "static uint64_t vais_prof_total = 0;\n"
+        "\n"
+        "static uint64_t vais_prof_clock(void) {\n"
+        "#if defined(__x86_64__) || defined(__i386__)\n"
+        "    return (uint64_t)__builtin_ia32_rdtsc();\n"
+        "#elif defined(__aarch64__)\n"
+        "    uint64_t value;\n"
+        "    __asm__ __volatile__(\"mrs %0, cntvct_el0\" : \"=r\"(value));\n"
+        "    return value;\n"
+        "#else\n"
+        "    struct timespec ts;\n"
+        "    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+        "    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;\n"
+        "#endif\n"
+        "}\n"
+        "\n"
+        "static void vais_prof_pop(void) {\n"
+        "    VaisProfFrame *f = &vais_prof_frames[--vais_prof_frame_count];\n"
+        "    uint64_t elapsed = vais_prof_clock() - f->start;\n"
+        "    VaisProfEntry *e = &vais_prof_entries[f->id];\n"
+        "    if (--e->active == 0) e->cycles += elapsed;\n"
+        "    if (e->kind == 1) {\n"
+        "        e->self += elapsed - f->child;\n"
+        "        vais_prof_site_now = f->saved_site;\n"
+        "        vais_prof_fn_now = f->saved_fn;\n"
+        "        if (vais_prof_fn_now >= 0) vais_prof_frames[vais_prof_fn_now].child += elapsed;\n"
+        "        else vais_prof_total += elapsed;\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "static void vais_prof_write(void) {\n"
+        "    if (getpid() != vais_prof_pid) return;\n"
+        "    while (vais_prof_frame_count > 0) vais_prof_pop();\n"
+        "    const char *path = getenv(\"VAIS_PROFILE_OUT\");\n"
+        "    if (path == 0 || path[0] == '\\0') path = \"vais-profile.tsv\";\n"
+        "    FILE *fp = fopen(path, \"w\");\n"
+        "    if (fp == 0) {\n"
+        "        fprintf(stderr, \"vais profile: cannot write %s: %s\\n\", path, strerror(errno == 0 ? EIO : errno));\n"
+        "        return;\n"
+        "    }\n"
+        "    static const char *kinds[] = {\"\", \"fn\", \"loop\", \"site\"};\n"
+        "    fprintf(fp, \"# vais-profile 1 unit=%s total=%llu\\n\", VAIS_PROF_UNIT, (unsigned long long)vais_prof_total);\n"
+        "    fprintf(fp, \"kind\\tcalls\\titers\\tcycles\\tself\\tallocs\\tbytes\\twhere\\n\");\n"
+        "    for (int64_t id = 0; id < vais_prof_cap; id++) {\n"
+        "        VaisProfEntry *e = &vais_prof_entries[id];\n"
+        "        if (e->where == 0) continue;\n"
+        "        fprintf(fp, \"%s\\t%lld\\t%lld\\t%llu\\t%llu\\t%lld\\t%lld\\t%s\\n\", kinds[e->kind], (long long)e->calls,\n"
+        "            (long long)e->iters, (unsigned long long)e->cycles, (unsigned long long)e->self,\n"
+        "            (long long)e->allocs, (long long)e->bytes, e->where);\n"
+        "    }\n"
+        "    fclose(fp);\n"
+        "}\n"
+        "\n"
+        "static VaisProfEntry *vais_prof_entry(int64_t id, int64_t kind, const char *where) {\n"
+        "    if (!vais_prof_on) {\n"
+        "        vais_prof_on = 1;\n"
+        "        vais_prof_pid = getpid();\n"
+        "        atexit(vais_prof_write);\n"
+        "    }\n"
+        "    if (id < 0) id = 0;\n"
+        "    if (id >= vais_prof_cap) {\n"
+        "        int64_t cap = vais_prof_cap == 0 ? 256 : vais_prof_cap;\n"
+        "        while (cap <= id) cap *= 2;\n"
+        "        VaisProfEntry *next = (VaisProfEntry *)realloc(vais_prof_entries, (size_t)cap * sizeof(VaisProfEntry));\n"
+        "        if (next == 0) abort();\n"
+        "        memset(next + vais_prof_cap, 0, (size_t)(cap - vais_prof_cap) * sizeof(VaisProfEntry));\n"
+        "        vais_prof_entries = next;\n"
+        "        vais_prof_cap = cap;\n"
+        "    }\n"
+        "    VaisProfEntry *e = &vais_prof_entries[id];\n"
+        "    if (e->where == 0 && where != 0) {\n"
+        "        e->where = where;\n"
+        "        e->kind = kind;\n"
+        "    }\n"
+        "    return e;\n"
+        "}\n"
+        "\n"
+        "static void vais_prof_push(int64_t id) {\n"
+        "    if (vais_prof_frame_count == vais_prof_frame_cap) {\n"
+        "        vais_prof_frame_cap = vais_prof_frame_cap == 0 ? 256 : vais_prof_frame_cap * 2;\n"
+        "        vais_prof_frames = (VaisProfFrame *)realloc(vais_prof_frames, (size_t)vais_prof_frame_cap * sizeof(VaisProfFrame));\n"
+        "        if (vais_prof_frames == 0) abort();\n"
+        "    }\n"
+        "    VaisProfFrame *f = &vais_prof_frames[vais_prof_frame_count++];\n"
+        "    f->id = id;\n"
+        "    f->child = 0;\n"
+        "    f->saved_site = vais_prof_site_now;\n"
+        "    f->saved_fn = vais_prof_fn_now;\n"
+        "    f->start = vais_prof_clock();\n"
+        "}\n"
+        "\n"
+        "int64_t __vais_prof_fn(int64_t id, char *where) {\n"
+        "    VaisProfEntry *e = vais_prof_entry(id, 1, where);\n"
+        "    e->calls++;\n"
+        "    e->active++;\n"
+        "    vais_prof_push(id);\n"
+        "    vais_prof_fn_now = vais_prof_frame_count - 1;\n"
+        "    vais_prof_site_now = -1;\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t __vais_prof_loop(int64_t id, char *where) {\n"
+        "    VaisProfEntry *e = vais_prof_entry(id, 2, where);\n"
+        "    e->calls++;\n"
+        "    e->active++;\n"
+        "    vais_prof_push(id);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t __vais_prof_iter(int64_t id) {\n"
+        "    if (id >= 0 && id < vais_prof_cap) vais_prof_entries[id].iters++;\n"
+        "    vais_prof_site_now = -1;\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t __vais_prof_loop_end(int64_t id) {\n"
+        "    for (int64_t d = vais_prof_frame_count - 1; d > vais_prof_fn_now; d--) {\n"
+        "        if (vais_prof_frames[d].id != id) continue;\n"
+        "        while (vais_prof_frame_count > d) vais_prof_pop();\n"
+        "        break;\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t __vais_prof_site(int64_t id, char *where) {\n"
+        "    vais_prof_entry(id, 3, where)->calls++;\n"
+        "    vais_prof_site_now = id;\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "/* Instrumented function wrappers bracket each call with these, so early\n"
+        "   returns out of loops still close every frame the body opened. */\n"
+        "int64_t __vais_prof_depth(void) {\n"
+        "    return vais_prof_frame_count;\n"
+        "}\n"
+        "\n"
+        "int64_t __vais_prof_leave(int64_t depth) {\n"
+        "    while (vais_prof_frame_count > depth) vais_prof_pop();\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "static void vais_prof_count(size_t n) {\n"
+        "    if (vais_prof_site_now >= 0) {\n"
+        "        vais_prof_entries[vais_prof_site_now].allocs++;\n"
+        "        vais_prof_entries[vais_prof_site_now].bytes += (int64_t)n;\n"
+        "    }\n"
+        "    if (vais_prof_fn_now >= 0) {\n"
+        "        VaisProfEntry *e = &vais_prof_entries[vais_prof_frames[vais_prof_fn_now].id];\n"
+        "        e->allocs++;\n"
+        "        e->bytes += (int64_t)n;\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "void *__vais_prof_malloc(size_t n) {\n"
+        "    if (vais_prof_on) vais_prof_count(n);\n"
+        "    return malloc(n);\n"
+        "}\n"
+        "\n"
+        "void *__vais_prof_calloc(size_t count, size_t size) {\n"
+        "    if (vais_prof_on) vais_prof_count(count * size);\n"
+        "    return calloc(count, size);\n"
+        "}\n"
+        "\n"
+        "void *__vais_prof_realloc(void *ptr, size_t n) {\n"
+        "    if (vais_prof_on) vais_prof_count(n);\n"
+        "    return realloc(ptr, n);\n"
+        "}\n"
+        "\n"
+        "#define malloc(n) __vais_prof_malloc(n)\n"
+        "#define calloc(count, size) __vais_prof_calloc(count, size)\n"
+        "#define realloc(ptr, n) __vais_prof_realloc(ptr, n)\n"
+        "\n"
+        "/* Full-engine List<T> values are a header: [0] element block, [1] len,\n"
+        "   [2] block capacity in words. The block is heap-backed. */\n"
+        "static int64_t *vais_list_items(int64_t *list) {\n"
+        "    return (int64_t *)(intptr_t)list[0];\n"
+        "}\n"
+        "\n"
+        "static int64_t *vais_list_grow(int64_t *list, int64_t words) {\n"
+        "    if (words <= list[2]) return vais_list_items(list);\n"
+        "    int64_t cap = list[2] * 2;\n"
+        "    if (cap < 16) cap = 16;\n"
+        "    if (cap < words) cap = words;\n"
+        "    int64_t *items = (int64_t *)realloc(vais_list_items(list), (size_t)cap * sizeof(int64_t));\n"
+        "    if (items == 0) return 0;\n"
+        "    list[0] = (int64_t)(intptr_t)items;\n"
+        "    list[2] = cap;\n"
+        "    return items;\n"
+        "}\n"
+        "\n"
+        "int64_t fs_exists(char *path) {\n"
+        "    if (path == 0) return 0;\n"
+        "    return access(path, F_OK) == 0 ? 1 : 0;\n"
+        "}\n"
+        "\n"
+        "int64_t fs_is_dir(char *path) {\n"
+        "    if (path == 0) return 0;\n"
+        "    struct stat st;\n"
+        "    if (stat(path, &st) != 0) return 0;\n"
+        "    return S_ISDIR(st.st_mode) ? 1 : 0;\n"
+        "}\n"
+        "\n"
+
+        "static void fs_host_trap(const char *op, const char *path) {\n"
+        "    fprintf(stderr, \"vais host %s failed: %s: %s\\n\", op, path == 0 ? \"<null>\" : path, strerror(errno == 0 ? EIO : errno));\n"
+        "    abort();\n"
+        "}\n"
+        "\n"
+        "static char *fs_host_copy_n(const char *text, size_t len) {\n"
+        "    char *out = (char *)malloc(len + 1);\n"
+        "    if (out == 0) fs_host_trap(\"alloc\", text);\n"
+        "    memcpy(out, text, len);\n"
+        "    out[len] = '\\0';\n"
+        "    return out;\n"
+        "}\n"
+        "\n"        "static int fs_list_name_cmp(const void *a, const void *b) {\n"
+        "    return strcmp((const char *)(intptr_t)*(const int64_t *)a, (const char *)(intptr_t)*(const int64_t *)b);\n"
+        "}\n"
+        "\n"
+        "/* Most filesystems report the entry type in d_type, so listing needs no stat.\n"
+        "   Symlinks and DT_UNKNOWN entries still stat, which follows the link. */\n"
+        "static int fs_list_entry_is(const char *dir, struct dirent *entry, mode_t kind) {\n"
+        "    if (entry->d_type == DT_REG) return kind == S_IFREG;\n"
+        "    if (entry->d_type == DT_DIR) return kind == S_IFDIR;\n"
+        "    if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) return 0;\n"
+        "    size_t dn = strlen(dir);\n"
+        "    size_t en = strlen(entry->d_name);\n"
+        "    char *full = (char *)malloc(dn + en + 2);\n"
+        "    if (full == 0) fs_host_trap(\"list\", dir);\n"
+        "    memcpy(full, dir, dn);\n"
+        "    full[dn] = '/';\n"
+        "    memcpy(full + dn + 1, entry->d_name, en + 1);\n"
+        "    struct stat st;\n"
+        "    int match = stat(full, &st) == 0 && (st.st_mode & S_IFMT) == kind;\n"
+        "    free(full);\n"
+        "    return match;\n"
+        "}\n"
+        "\n"
+        "int64_t fs_list_files(char *dir, int64_t *out) {\n"
+        "    out[1] = 0;\n"
+        "    if (dir == 0) return 0;\n"
+        "    DIR *d = opendir(dir);\n"
+        "    if (d == 0) return 0;\n"
+        "    int64_t count = 0;\n"
+        "    struct dirent *entry;\n"
+        "    while ((entry = readdir(d)) != 0) {\n"
+        "        if (strcmp(entry->d_name, \".\") == 0 || strcmp(entry->d_name, \"..\") == 0) continue;\n"
+        "        if (!fs_list_entry_is(dir, entry, S_IFREG)) continue;\n"
+        "        size_t en = strlen(entry->d_name);\n"
+        "        int64_t *items = vais_list_grow(out, count + 1);\n"
+        "        if (items == 0) { closedir(d); fs_host_trap(\"list\", dir); }\n"
+        "        items[count++] = (int64_t)(intptr_t)fs_host_copy_n(entry->d_name, en);\n"
+        "    }\n"
+        "    closedir(d);\n"
+        "    if (count > 1) qsort(vais_list_items(out), (size_t)count, sizeof(int64_t), fs_list_name_cmp);\n"
+        "    out[1] = count;\n"
+        "    return count;\n"
+        "}\n"
+        "\n"
+        "int64_t fs_list_dirs(char *dir, int64_t *out) {\n"
+        "    out[1] = 0;\n"
+        "    if (dir == 0) return 0;\n"
+        "    DIR *d = opendir(dir);\n"
+        "    if (d == 0) return 0;\n"
+        "    int64_t count = 0;\n"
+        "    struct dirent *entry;\n"
+        "    while ((entry = readdir(d)) != 0) {\n"
+        "        if (strcmp(entry->d_name, \".\") == 0 || strcmp(entry->d_name, \"..\") == 0) continue;\n"
+        "        if (!fs_list_entry_is(dir, entry, S_IFDIR)) continue;\n"
+        "        size_t en = strlen(entry->d_name);\n"
+        "        int64_t *items = vais_list_grow(out, count + 1);\n"
+        "        if (items == 0) { closedir(d); fs_host_trap(\"list\", dir); }\n"
+        "        items[count++] = (int64_t)(intptr_t)fs_host_copy_n(entry->d_name, en);\n"
+        "    }\n"
+        "    closedir(d);\n"
+        "    if (count > 1) qsort(vais_list_items(out), (size_t)count, sizeof(int64_t), fs_list_name_cmp);\n"
+        "    out[1] = count;\n"
+        "    return count;\n"
+        "}\n"
+        "\n"
+        "char *stdin_read_all(void) {\n"
+        "    size_t cap = 4096;\n"
+        "    size_t len = 0;\n"
+        "    char *buf = (char *)malloc(cap);\n"
+        "    if (buf == 0) fs_host_trap(\"stdin\", \"<alloc>\");\n"
+        "    for (;;) {\n"
+        "        if (len == cap) {\n"
+        "            cap = cap * 2;\n"
+        "            char *next = (char *)realloc(buf, cap);\n"
+        "            if (next == 0) fs_host_trap(\"stdin\", \"<alloc>\");\n"
+        "            buf = next;\n"
+        "        }\n"
+        "        size_t got = fread(buf + len, 1, cap - len, stdin);\n"
+        "        len += got;\n"
+        "        if (got == 0) break;\n"
+        "    }\n"
+        "    char *out = fs_host_copy_n(buf, len);\n"
+        "    free(buf);\n"
+        "    return out;\n"
+        "}\n"
+        "\n"
+        "int64_t stderr_write(char *text) {\n"
+        "    if (text == 0) return 0;\n"
+        "    size_t n = strlen(text);\n"
+        "    size_t got = fwrite(text, 1, n, stderr);\n"
+        "    fflush(stderr);\n"
+        "    return (int64_t)got;\n"
+        "}\n"
+        "\n"
+        "int64_t stdout_write(char *text) {\n"
+        "    if (text == 0) return 0;\n"
+        "    size_t n = strlen(text);\n"
+        "    size_t got = fwrite(text, 1, n, stdout);\n"
+        "    fflush(stdout);\n"
+        "    return (int64_t)got;\n"
+        "}\n"
+        "\n"
+        "int64_t vais_emit_bytes(char *text, int64_t start, int64_t len) {\n"
+        "    if (text == 0 || len <= 0) return 0;\n"
+        "    fwrite(text + start, 1, (size_t)len, stdout);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t vais_emit_str(char *text) {\n"
+        "    if (text != 0) fputs(text, stdout);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t vais_emit_byte(int64_t c) {\n"
+        "    putchar((int)c);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t vais_emit_int(int64_t value) {\n"
+        "    printf(\"%lld\", (long long)value);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t vais_emit_entry(void) {\n"
+        "    fputs(\"main\", stdout);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t vais_emit_linkage(void) {\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "static char *fs_host_copy(const char *text) {\n"
+        "    if (text == 0) fs_host_trap(\"copy\", text);\n"
+        "    return fs_host_copy_n(text, strlen(text));\n"
+        "}\n"
+        "\n"
+        "int64_t time_millis(void) {\n"
+        "#if defined(CLOCK_MONOTONIC)\n"
+        "    struct timespec ts;\n"
+        "    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {\n"
+        "        return (int64_t)ts.tv_sec * 1000 + (int64_t)(ts.tv_nsec / 1000000);\n"
+        "    }\n"
+        "#endif\n"
+        "    struct timeval tv;\n"
+        "    if (gettimeofday(&tv, 0) != 0) return 0;\n"
+        "    return (int64_t)tv.tv_sec * 1000 + (int64_t)(tv.tv_usec / 1000);\n"
+        "}\n"
+        "\n"
+        "int64_t time_nanos(void) {\n"
+        "#if defined(CLOCK_MONOTONIC)\n"
+        "    struct timespec ts;\n"
+        "    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {\n"
+        "        return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;\n"
+        "    }\n"
+        "#endif\n"
+        "    struct timeval tv;\n"
+        "    if (gettimeofday(&tv, 0) != 0) return 0;\n"
+        "    return (int64_t)tv.tv_sec * 1000000000 + (int64_t)tv.tv_usec * 1000;\n"
+        "}\n"
+        "\n"
+        "static int vais_host_argc = 0;\n"
+        "static char **vais_host_argv = 0;\n"
+        "static const char *vais_host_self = \"\";\n"
+        "\n"
+        "extern int64_t vais_user_main(void);\n"
+        "\n"
+        "int main(int argc, char **argv) {\n"
+        "    if (argc > 0) {\n"
+        "        vais_host_self = argv[0];\n"
+        "        vais_host_argc = argc - 1;\n"
+        "        vais_host_argv = argv + 1;\n"
+        "    } else {\n"
+        "        vais_host_argc = 0;\n"
+        "        vais_host_argv = argv;\n"
+        "    }\n"
+        "    return (int)vais_user_main();\n"
+        "}\n"
+        "\n"
+        "int64_t proc_argc(void) {\n"
+        "    if (vais_host_argv != 0) return (int64_t)vais_host_argc;\n"
+        "    const char *raw = getenv(\"VAIS_RUN_ARGC\");\n"
+        "    if (raw == 0 || raw[0] == '\\0') return 0;\n"
+        "    char *end = 0;\n"
+        "    long n = strtol(raw, &end, 10);\n"
+        "    if (end == raw || n < 0) return 0;\n"
+        "    return (int64_t)n;\n"
+        "}\n"
+        "\n"
+        "char *proc_arg(int64_t index) {\n"
+        "    int64_t count = proc_argc();\n"
+        "    if (index < 0 || index >= count) fs_host_trap(\"proc_arg\", \"\");\n"
+        "    if (vais_host_argv != 0) return fs_host_copy(vais_host_argv[index]);\n"
+        "    char name[64];\n"
+        "    snprintf(name, sizeof(name), \"VAIS_RUN_ARG_%lld\", (long long)index);\n"
+        "    const char *value = getenv(name);\n"
+        "    if (value == 0) fs_host_trap(\"proc_arg\", name);\n"
+        "    return fs_host_copy(value);\n"
+        "}\n"
+        "\n"
+        "char *proc_self(void) {\n"
+        "    return fs_host_copy(vais_host_self);\n"
+        "}\n"
+        "\n"
+        "static int path_is_absolute(const char *path) {\n"
+        "    if (path == 0 || path[0] == '\\0') return 0;\n"
+        "    return path[0] == '/';\n"
+        "}\n"
+        "\n"
+        "char *fs_read_text(const char *path) {\n"
+        "    if (path == 0) fs_host_trap(\"read\", path);\n"
+        "    FILE *fp = fopen(path, \"rb\");\n"
+        "    if (fp == 0) fs_host_trap(\"read\", path);\n"
+        "    if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); fs_host_trap(\"read\", path); }\n"
+        "    long size = ftell(fp);\n"
+        "    if (size < 0) { fclose(fp); fs_host_trap(\"read\", path); }\n"
+        "    if (fseek(fp, 0, SEEK_SET) != 0) { fclose(fp); fs_host_trap(\"read\", path); }\n"
+        "    char *buf = (char *)malloc((size_t)size + 1);\n"
+        "    if (buf == 0) { fclose(fp); fs_host_trap(\"read\", path); }\n"
+        "    size_t got = fread(buf, 1, (size_t)size, fp);\n"
+        "    if (got != (size_t)size) { free(buf); fclose(fp); fs_host_trap(\"read\", path); }\n"
+        "    buf[size] = '\\0';\n"
+        "    if (fclose(fp) != 0) { free(buf); fs_host_trap(\"read\", path); }\n"
+        "    return buf;\n"
+        "}\n"
+        "\n"
+        "/* fs_map_text maps the file read-only over an anonymous reservation one byte\n"
+        "   longer than the file, so the byte after the last one is always a NUL: either\n"
+        "   the zero fill of the file's last page or the spare anonymous page. The\n"
+        "   mapping stays valid for the rest of the run; the file must not shrink while\n"
+        "   it is mapped. */\n"
+        "char *fs_map_text(const char *path) {\n"
+        "    if (path == 0) fs_host_trap(\"map\", path);\n"
+        "    int fd = open(path, O_RDONLY);\n"
+        "    if (fd < 0) fs_host_trap(\"map\", path);\n"
+        "    struct stat st;\n"
+        "    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) { close(fd); fs_host_trap(\"map\", path); }\n"
+        "    size_t size = (size_t)st.st_size;\n"
+        "    if (size == 0) { close(fd); return fs_host_copy_n(\"\", 0); }\n"
+        "    size_t page = (size_t)sysconf(_SC_PAGESIZE);\n"
+        "    size_t span = (size + page) / page * page;\n"
+        "    char *base = (char *)mmap(0, span, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);\n"
+        "    if (base == MAP_FAILED) { close(fd); fs_host_trap(\"map\", path); }\n"
+        "    if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {\n"
+        "        munmap(base, span);\n"
+        "        close(fd);\n"
+        "        fs_host_trap(\"map\", path);\n"
+        "    }\n"
+        "    close(fd);\n"
+        "    return base;\n"
+        "}\n"
+        "\n"
+        "/* fs_lines_* stream a file through a fixed read buffer. The current line is\n"
+        "   copied into one reused buffer, so memory stays bounded by the longest line\n"
+        "   however large the file is. */\n"
+        "#define FS_LINES_CHUNK 65536\n"
+        "\n"
+        "typedef struct {\n"
+        "    int fd;\n"
+        "    int eof;\n"
+        "    char *buf;\n"
+        "    size_t pos;\n"
+        "    size_t end;\n"
+        "    char *line;\n"
+        "    size_t line_cap;\n"
+        "} FsLineReader;\n"
+        "\n"
+        "int64_t fs_lines_open(const char *path) {\n"
+        "    if (path == 0) return 0;\n"
+        "    int fd = open(path, O_RDONLY);\n"
+        "    if (fd < 0) return 0;\n"
+        "    FsLineReader *r = (FsLineReader *)calloc(1, sizeof(FsLineReader));\n"
+        "    if (r == 0) { close(fd); fs_host_trap(\"lines\", path); }\n"
+        "    r->buf = (char *)malloc(FS_LINES_CHUNK);\n"
+        "    r->line = (char *)malloc(256);\n"
+        "    if (r->buf == 0 || r->line == 0) { close(fd); fs_host_trap(\"lines\", path); }\n"
+        "    r->fd = fd;\n"
+        "    r->line_cap = 256;\n"
+        "    r->line[0] = '\\0';\n"
+        "    return (int64_t)(intptr_t)r;\n"
+        "}\n"
+        "\n"
+        "int64_t fs_lines_next(int64_t handle) {\n"
+        "    FsLineReader *r = (FsLineReader *)(intptr_t)handle;\n"
+        "    if (r == 0) return 0;\n"
+        "    size_t len = 0;\n"
+        "    int any = 0;\n"
+        "    int found = 0;\n"
+        "    while (!found) {\n"
+        "        if (r->pos == r->end) {\n"
+        "            if (r->eof) break;\n"
+        "            ssize_t got = read(r->fd, r->buf, FS_LINES_CHUNK);\n"
+        "            if (got < 0 && errno == EINTR) continue;\n"
+        "            if (got < 0) fs_host_trap(\"lines\", \"\");\n"
+        "            if (got == 0) { r->eof = 1; break; }\n"
+        "            r->pos = 0;\n"
+        "            r->end = (size_t)got;\n"
+        "        }\n"
+        "        char *start = r->buf + r->pos;\n"
+        "        char *nl = (char *)memchr(start, '\\n', r->end - r->pos);\n"
+        "        size_t take = nl != 0 ? (size_t)(nl - start) : r->end - r->pos;\n"
+        "        if (len + take + 1 > r->line_cap) {\n"
+        "            size_t cap = r->line_cap;\n"
+        "            while (cap < len + take + 1) cap *= 2;\n"
+        "            char *line = (char *)realloc(r->line, cap);\n"
+        "            if (line == 0) fs_host_trap(\"lines\", \"\");\n"
+        "            r->line = line;\n"
+        "            r->line_cap = cap;\n"
+        "        }\n"
+        "        memcpy(r->line + len, start, take);\n"
+        "        len += take;\n"
+        "        r->pos += take;\n"
+        "        any = 1;\n"
+        "        if (nl != 0) { r->pos++; found = 1; }\n"
+        "    }\n"
+        "    if (len > 0 && r->line[len - 1] == '\\r') len--;\n"
+        "    r->line[len] = '\\0';\n"
+        "    return any;\n"
+        "}\n"
+        "\n"
+        "char *fs_lines_text(int64_t handle) {\n"
+        "    FsLineReader *r = (FsLineReader *)(intptr_t)handle;\n"
+        "    if (r == 0) fs_host_trap(\"lines\", \"\");\n"
+        "    return r->line;\n"
+        "}\n"
+        "\n"
+        "int64_t fs_lines_close(int64_t handle) {\n"
+        "    FsLineReader *r = (FsLineReader *)(intptr_t)handle;\n"
+        "    if (r == 0) return 1;\n"
+        "    close(r->fd);\n"
+        "    free(r->buf);\n"
+        "    free(r->line);\n"
+        "    free(r);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "char *fs_cwd(void) {\n"
+        "    char *cwd = getcwd(0, 0);\n"
+        "    if (cwd == 0) fs_host_trap(\"cwd\", \"\");\n"
+        "    return cwd;\n"
+        "}\n"
+        "\n"
+        "char *fs_temp_dir(void) {\n"
+        "    const char *tmp = getenv(\"TMPDIR\");\n"
+        "    if (tmp == 0 || tmp[0] == '\\0') tmp = getenv(\"TEMP\");\n"
+        "    if (tmp == 0 || tmp[0] == '\\0') tmp = getenv(\"TMP\");\n"
+        "    if (tmp == 0 || tmp[0] == '\\0') tmp = \"/tmp\";\n"
+        "    return fs_host_copy(tmp);\n"
+        "}\n"
+        "\n"
+        "char *path_join(const char *base, const char *child) {\n"
+        "    if (base == 0 || child == 0) fs_host_trap(\"path_join\", base == 0 ? base : child);\n"
+        "    if (child[0] == '\\0') return fs_host_copy(base);\n"
+        "    if (path_is_absolute(child)) return fs_host_copy(child);\n"
+        "    size_t blen = strlen(base);\n"
+        "    size_t clen = strlen(child);\n"
+        "    if (blen == 0) return fs_host_copy(child);\n"
+        "    int need_sep = base[blen - 1] != '/';\n"
+        "    char *out = (char *)malloc(blen + (size_t)need_sep + clen + 1);\n"
+        "    if (out == 0) fs_host_trap(\"path_join\", base);\n"
+        "    memcpy(out, base, blen);\n"
+        "    size_t pos = blen;\n"
+        "    if (need_sep) {\n"
+        "        out[pos] = '/';\n"
+        "        pos = pos + 1;\n"
+        "    }\n"
+        "    memcpy(out + pos, child, clen);\n"
+        "    out[pos + clen] = '\\0';\n"
+        "    return out;\n"
+        "}\n"
+        "\n"
+        "static size_t path_trim_trailing(const char *path, size_t len) {\n"
+        "    while (len > 1 && path[len - 1] == '/') len = len - 1;\n"
+        "    return len;\n"
+        "}\n"
+        "\n"
+        "char *path_basename(char *path) {\n"
+        "    if (path == 0) fs_host_trap(\"path_basename\", path);\n"
+        "    size_t len = path_trim_trailing(path, strlen(path));\n"
+        "    if (len == 0) return fs_host_copy(\"\");\n"
+        "    if (len == 1 && path[0] == '/') return fs_host_copy_n(path, 1);\n"
+        "    size_t start = len;\n"
+        "    while (start > 0 && path[start - 1] != '/') start = start - 1;\n"
+        "    return fs_host_copy_n(path + start, len - start);\n"
+        "}\n"
+        "\n"
+        "char *path_dirname(char *path) {\n"
+        "    if (path == 0) fs_host_trap(\"path_dirname\", path);\n"
+        "    size_t len = path_trim_trailing(path, strlen(path));\n"
+        "    if (len == 0) return fs_host_copy(\".\");\n"
+        "    if (len == 1 && path[0] == '/') return fs_host_copy(\"/\");\n"
+        "    size_t end = len;\n"
+        "    while (end > 0 && path[end - 1] != '/') end = end - 1;\n"
+        "    if (end == 0) return fs_host_copy(\".\");\n"
+        "    while (end > 1 && path[end - 1] == '/') end = end - 1;\n"
+        "    if (end == 0) return fs_host_copy(\".\");\n"
+        "    return fs_host_copy_n(path, end);\n"
+        "}\n"
+        "\n"
+        "char *str_concat(char *left, char *right) {\n"
+        "    if (left == 0 || right == 0) fs_host_trap(\"str_concat\", left == 0 ? left : right);\n"
+        "    size_t llen = strlen(left);\n"
+        "    size_t rlen = strlen(right);\n"
+        "    char *out = (char *)malloc(llen + rlen + 1);\n"
+        "    if (out == 0) fs_host_trap(\"str_concat\", left);\n"
+        "    memcpy(out, left, llen);\n"
+        "    memcpy(out + llen, right, rlen);\n"
+        "    out[llen + rlen] = '\\0';\n"
+        "    return out;\n"
+        "}\n"
+        "\n"
+        "int64_t str_cmp(char *left, char *right) {\n"
+        "    const char *a = left == 0 ? \"\" : left;\n"
+        "    const char *b = right == 0 ? \"\" : right;\n"
+        "    int r = strcmp(a, b);\n"
+        "    if (r < 0) return -1;\n"
+        "    if (r > 0) return 1;\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "char *str_slice(char *text, int64_t start, int64_t len) {\n"
+        "    if (text == 0) fs_host_trap(\"str_slice\", text);\n"
+        "    if (start < 0 || len < 0) fs_host_trap(\"str_slice\", text);\n"
+        "    size_t n = strlen(text);\n"
+        "    if ((size_t)start > n || (size_t)len > n - (size_t)start) fs_host_trap(\"str_slice\", text);\n"
+        "    return fs_host_copy_n(text + start, (size_t)len);\n"
+        "}\n"
+        "\n"
+        "char *str_byte(int64_t value) {\n"
+        "    if (value < 0 || value > 255) fs_host_trap(\"str_byte\", \"\");\n"
+        "    char tmp[2];\n"
+        "    tmp[0] = (char)value;\n"
+        "    tmp[1] = '\\0';\n"
+        "    return fs_host_copy_n(tmp, 1);\n"
+        "}\n"
+        "\n"
+        "typedef struct {\n"
+        "    char *data;\n"
+        "    size_t len;\n"
+        "    size_t cap;\n"
+        "} VaisStrBuilder;\n"
+        "\n"
+        "static VaisStrBuilder *str_builder_ptr(int64_t handle) {\n"
+        "    if (handle == 0) fs_host_trap(\"str_builder\", \"\");\n"
+        "    return (VaisStrBuilder *)(intptr_t)handle;\n"
+        "}\n"
+        "\n"
+        "static void str_builder_reserve(VaisStrBuilder *builder, size_t extra) {\n"
+        "    if (builder == 0) fs_host_trap(\"str_builder\", \"\");\n"
+        "    if (extra > (size_t)-1 - builder->len - 1) fs_host_trap(\"str_builder\", \"\");\n"
+        "    size_t need = builder->len + extra + 1;\n"
+        "    if (need <= builder->cap) return;\n"
+        "    size_t cap = builder->cap == 0 ? 64 : builder->cap;\n"
+        "    while (cap < need) {\n"
+        "        if (cap > (size_t)-1 / 2) {\n"
+        "            cap = need;\n"
+        "            break;\n"
+        "        }\n"
+        "        cap = cap * 2;\n"
+        "    }\n"
+        "    char *data = (char *)realloc(builder->data, cap);\n"
+        "    if (data == 0) fs_host_trap(\"str_builder_alloc\", \"\");\n"
+        "    builder->data = data;\n"
+        "    builder->cap = cap;\n"
+        "}\n"
+        "\n"
+        "int64_t str_builder_new(void) {\n"
+        "    VaisStrBuilder *builder = (VaisStrBuilder *)calloc(1, sizeof(VaisStrBuilder));\n"
+        "    if (builder == 0) fs_host_trap(\"str_builder_new\", \"\");\n"
+        "    str_builder_reserve(builder, 0);\n"
+        "    builder->data[0] = '\\0';\n"
+        "    return (int64_t)(intptr_t)builder;\n"
+        "}\n"
+        "\n"
+        "int64_t str_builder_push(int64_t handle, int64_t value) {\n"
+        "    if (value < 0 || value > 255) fs_host_trap(\"str_builder_push\", \"\");\n"
+        "    VaisStrBuilder *builder = str_builder_ptr(handle);\n"
+        "    str_builder_reserve(builder, 1);\n"
+        "    builder->data[builder->len] = (char)value;\n"
+        "    builder->len += 1;\n"
+        "    builder->data[builder->len] = '\\0';\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t str_builder_append(int64_t handle, char *text) {\n"
+        "    if (text == 0) fs_host_trap(\"str_builder_append\", \"\");\n"
+        "    VaisStrBuilder *builder = str_builder_ptr(handle);\n"
+        "    size_t len = strlen(text);\n"
+        "    str_builder_reserve(builder, len);\n"
+        "    memcpy(builder->data + builder->len, text, len);\n"
+        "    builder->len += len;\n"
+        "    builder->data[builder->len] = '\\0';\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "char *str_builder_finish(int64_t handle) {\n"
+        "    VaisStrBuilder *builder = str_builder_ptr(handle);\n"
+        "    return fs_host_copy_n(builder->data, builder->len);\n"
+        "}\n"
+        "\n"
+        "/* Inverted index behind the index_* builtins: a hashed term dictionary whose\n"
+        "   postings stay sorted by doc id, plus a doc table that remembers each\n"
+        "   document's terms so index_remove_doc only touches its own postings. */\n"
+        "typedef struct {\n"
+        "    int64_t doc;\n"
+        "    int64_t tf;\n"
+        "} VaisPosting;\n"
+        "\n"
+        "typedef struct {\n"
+        "    char *term;\n"
+        "    uint64_t hash;\n"
+        "    VaisPosting *items;\n"
+        "    int64_t len;\n"
+        "    int64_t cap;\n"
+        "    int64_t mark;\n"
+        "    int64_t mark_pos;\n"
+        "} VaisPostings;\n"
+        "\n"
+        "typedef struct {\n"
+        "    int64_t doc;\n"
+        "    int64_t *terms;\n"
+        "    int64_t len;\n"
+        "    int64_t cap;\n"
+        "} VaisIndexDoc;\n"
+        "\n"
+        "typedef struct {\n"
+        "    VaisPostings *terms;\n"
+        "    int64_t term_len;\n"
+        "    int64_t term_cap;\n"
+        "    int64_t *term_slots;\n"
+        "    int64_t term_slot_cap;\n"
+        "    VaisIndexDoc *docs;\n"
+        "    int64_t doc_used;\n"
+        "    int64_t doc_live;\n"
+        "    int64_t doc_cap;\n"
+        "    int64_t mark;\n"
+        "    int64_t *scratch;\n"
+        "    int64_t scratch_cap;\n"
+        "    VaisPosting *hits;\n"
+        "    int64_t hit_len;\n"
+        "    int64_t hit_cap;\n"
+        "    char *token;\n"
+        "    size_t token_cap;\n"
+        "} VaisIndex;\n"
+        "\n"
+        "static void *index_grow(void *data, int64_t *cap, size_t item, int64_t need) {\n"
+        "    if (need <= *cap) return data;\n"
+        "    int64_t next = *cap == 0 ? 8 : *cap;\n"
+        "    while (next < need) next *= 2;\n"
+        "    void *grown = realloc(data, (size_t)next * item);\n"
+        "    if (grown == 0) fs_host_trap(\"index_alloc\", \"\");\n"
+        "    *cap = next;\n"
+        "    return grown;\n"
+        "}\n"
+        "\n"
+        "static VaisIndex *index_ptr(int64_t handle) {\n"
+        "    if (handle == 0) fs_host_trap(\"index\", \"\");\n"
+        "    return (VaisIndex *)(intptr_t)handle;\n"
+        "}\n"
+        "\n"
+        "static uint64_t index_hash(const char *s, size_t n) {\n"
+        "    uint64_t h = 1469598103934665603ULL;\n"
+        "    for (size_t i = 0; i < n; i++) h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;\n"
+        "    return h;\n"
+        "}\n"
+        "\n"
+        "static int index_space(unsigned char c) {\n"
+        "    return c == 32 || (c >= 9 && c <= 13);\n"
+        "}\n"
+        "\n"
+        "static void index_rehash_terms(VaisIndex *ix) {\n"
+        "    int64_t cap = ix->term_slot_cap == 0 ? 64 : ix->term_slot_cap * 2;\n"
+        "    int64_t *slots = (int64_t *)calloc((size_t)cap, sizeof(int64_t));\n"
+        "    if (slots == 0) fs_host_trap(\"index_alloc\", \"\");\n"
+        "    for (int64_t t = 0; t < ix->term_len; t++) {\n"
+        "        int64_t s = (int64_t)(ix->terms[t].hash & (uint64_t)(cap - 1));\n"
+        "        while (slots[s] != 0) s = (s + 1) & (cap - 1);\n"
+        "        slots[s] = t + 1;\n"
+        "    }\n"
+        "    free(ix->term_slots);\n"
+        "    ix->term_slots = slots;\n"
+        "    ix->term_slot_cap = cap;\n"
+        "}\n"
+        "\n"
+        "/* Term id for term[0..n), or -1 when it is absent and create is 0. */\n"
+        "static int64_t index_term_id(VaisIndex *ix, const char *term, size_t n, int create) {\n"
+        "    uint64_t h = index_hash(term, n);\n"
+        "    if (ix->term_slot_cap > 0) {\n"
+        "        int64_t s = (int64_t)(h & (uint64_t)(ix->term_slot_cap - 1));\n"
+        "        while (ix->term_slots[s] != 0) {\n"
+        "            VaisPostings *p = &ix->terms[ix->term_slots[s] - 1];\n"
+        "            if (p->hash == h && strncmp(p->term, term, n) == 0 && p->term[n] == '\\0') return ix->term_slots[s] - 1;\n"
+        "            s = (s + 1) & (ix->term_slot_cap - 1);\n"
+        "        }\n"
+        "    }\n"
+        "    if (!create) return -1;\n"
+        "    if ((ix->term_len + 1) * 2 > ix->term_slot_cap) index_rehash_terms(ix);\n"
+        "    ix->terms = (VaisPostings *)index_grow(ix->terms, &ix->term_cap, sizeof(VaisPostings), ix->term_len + 1);\n"
+        "    VaisPostings *p = &ix->terms[ix->term_len];\n"
+        "    memset(p, 0, sizeof(*p));\n"
+        "    p->term = (char *)malloc(n + 1);\n"
+        "    if (p->term == 0) fs_host_trap(\"index_alloc\", \"\");\n"
+        "    memcpy(p->term, term, n);\n"
+        "    p->term[n] = '\\0';\n"
+        "    p->hash = h;\n"
+        "    int64_t s = (int64_t)(h & (uint64_t)(ix->term_slot_cap - 1));\n"
+        "    while (ix->term_slots[s] != 0) s = (s + 1) & (ix->term_slot_cap - 1);\n"
+        "    ix->term_slots[s] = ix->term_len + 1;\n"
+        "    return ix->term_len++;\n"
+        "}\n"
+        "\n"
+        "/* Slot of doc in the open-addressed doc table (doc -1 = empty, -2 = removed). */\n"
+        "static int64_t index_doc_slot(VaisIndex *ix, int64_t doc) {\n"
+        "    if (ix->doc_cap == 0) return -1;\n"
+        "    int64_t s = (int64_t)(((uint64_t)doc * 11400714819323198485ULL) >> 20) & (ix->doc_cap - 1);\n"
+        "    while (ix->docs[s].doc != -1) {\n"
+        "        if (ix->docs[s].doc == doc) return s;\n"
+        "        s = (s + 1) & (ix->doc_cap - 1);\n"
+        "    }\n"
+        "    return -1;\n"
+        "}\n"
+        "\n"
+        "static VaisIndexDoc *index_doc_insert(VaisIndex *ix, int64_t doc) {\n"
+        "    if ((ix->doc_used + 1) * 2 > ix->doc_cap) {\n"
+        "        int64_t cap = 64;\n"
+        "        while (cap < (ix->doc_live + 1) * 4) cap *= 2;\n"
+        "        VaisIndexDoc *docs = (VaisIndexDoc *)malloc((size_t)cap * sizeof(VaisIndexDoc));\n"
+        "        if (docs == 0) fs_host_trap(\"index_alloc\", \"\");\n"
+        "        for (int64_t i = 0; i < cap; i++) docs[i].doc = -1;\n"
+        "        for (int64_t i = 0; i < ix->doc_cap; i++) {\n"
+        "            if (ix->docs[i].doc < 0) continue;\n"
+        "            int64_t s = (int64_t)(((uint64_t)ix->docs[i].doc * 11400714819323198485ULL) >> 20) & (cap - 1);\n"
+        "            while (docs[s].doc != -1) s = (s + 1) & (cap - 1);\n"
+        "            docs[s] = ix->docs[i];\n"
+        "        }\n"
+        "        free(ix->docs);\n"
+        "        ix->docs = docs;\n"
+        "        ix->doc_cap = cap;\n"
+        "        ix->doc_used = ix->doc_live;\n"
+        "    }\n"
+        "    int64_t s = (int64_t)(((uint64_t)doc * 11400714819323198485ULL) >> 20) & (ix->doc_cap - 1);\n"
+        "    while (ix->docs[s].doc >= 0) s = (s + 1) & (ix->doc_cap - 1);\n"
+        "    if (ix->docs[s].doc == -1) ix->doc_used++;\n"
+        "    ix->doc_live++;\n"
+        "    VaisIndexDoc *d = &ix->docs[s];\n"
+        "    memset(d, 0, sizeof(*d));\n"
+        "    d->doc = doc;\n"
+        "    return d;\n"
+        "}\n"
+        "\n"
+        "/* First posting position whose doc is >= doc. */\n"
+        "static int64_t index_posting_lower(VaisPostings *p, int64_t doc) {\n"
+        "    int64_t lo = 0;\n"
+        "    int64_t hi = p->len;\n"
+        "    while (lo < hi) {\n"
+        "        int64_t mid = lo + (hi - lo) / 2;\n"
+        "        if (p->items[mid].doc < doc) lo = mid + 1; else hi = mid;\n"
+        "    }\n"
+        "    return lo;\n"
+        "}\n"
+        "\n"
+        "static void index_posting_add(VaisIndex *ix, VaisIndexDoc *d, int64_t term, int64_t tf) {\n"
+        "    VaisPostings *p = &ix->terms[term];\n"
+        "    int64_t at = p->len > 0 && p->items[p->len - 1].doc < d->doc ? p->len : index_posting_lower(p, d->doc);\n"
+        "    if (at < p->len && p->items[at].doc == d->doc) {\n"
+        "        p->items[at].tf += tf;\n"
+        "        return;\n"
+        "    }\n"
+        "    p->items = (VaisPosting *)index_grow(p->items, &p->cap, sizeof(VaisPosting), p->len + 1);\n"
+        "    memmove(p->items + at + 1, p->items + at, (size_t)(p->len - at) * sizeof(VaisPosting));\n"
+        "    p->items[at].doc = d->doc;\n"
+        "    p->items[at].tf = tf;\n"
+        "    p->len++;\n"
+        "    d->terms = (int64_t *)index_grow(d->terms, &d->cap, sizeof(int64_t), d->len + 1);\n"
+        "    d->terms[d->len++] = term;\n"
+        "}\n"
+        "\n"
+        "/* Distinct terms of text with their counts, lowercased like doc_term_counts_into:\n"
+        "   ids land in ix->scratch, counts in terms[id].mark_pos; returns the token total. */\n"
+        "static int64_t index_tokenize(VaisIndex *ix, const char *text, int create, int64_t *distinct) {\n"
+        "    if (text == 0) fs_host_trap(\"index_text\", \"\");\n"
+        "    ix->mark++;\n"
+        "    int64_t total = 0;\n"
+        "    int64_t count = 0;\n"
+        "    size_t i = 0;\n"
+        "    while (text[i] != '\\0') {\n"
+        "        while (text[i] != '\\0' && index_space((unsigned char)text[i])) i++;\n"
+        "        size_t start = i;\n"
+        "        while (text[i] != '\\0' && !index_space((unsigned char)text[i])) i++;\n"
+        "        if (i == start) continue;\n"
+        "        size_t n = i - start;\n"
+        "        if (n + 1 > ix->token_cap) {\n"
+        "            ix->token_cap = n + 64;\n"
+        "            ix->token = (char *)realloc(ix->token, ix->token_cap);\n"
+        "            if (ix->token == 0) fs_host_trap(\"index_alloc\", \"\");\n"
+        "        }\n"
+        "        for (size_t k = 0; k < n; k++) {\n"
+        "            unsigned char c = (unsigned char)text[start + k];\n"
+        "            ix->token[k] = (char)((c >= 'A' && c <= 'Z') ? c + 32 : c);\n"
+        "        }\n"
+        "        ix->token[n] = '\\0';\n"
+        "        total++;\n"
+        "        int64_t term = index_term_id(ix, ix->token, n, create);\n"
+        "        if (term < 0) continue;\n"
+        "        VaisPostings *p = &ix->terms[term];\n"
+        "        if (p->mark != ix->mark) {\n"
+        "            p->mark = ix->mark;\n"
+        "            p->mark_pos = 0;\n"
+        "            ix->scratch = (int64_t *)index_grow(ix->scratch, &ix->scratch_cap, sizeof(int64_t), count + 1);\n"
+        "            ix->scratch[count++] = term;\n"
+        "        }\n"
+        "        p->mark_pos++;\n"
+        "    }\n"
+        "    *distinct = count;\n"
+        "    return total;\n"
+        "}\n"
+        "\n"
+        "int64_t index_new(void) {\n"
+        "    VaisIndex *ix = (VaisIndex *)calloc(1, sizeof(VaisIndex));\n"
+        "    if (ix == 0) fs_host_trap(\"index_new\", \"\");\n"
+        "    return (int64_t)(intptr_t)ix;\n"
+        "}\n"
+        "\n"
+        "int64_t index_remove_doc(int64_t handle, int64_t doc) {\n"
+        "    VaisIndex *ix = index_ptr(handle);\n"
+        "    int64_t s = index_doc_slot(ix, doc);\n"
+        "    if (s < 0) return 0;\n"
+        "    VaisIndexDoc *d = &ix->docs[s];\n"
+        "    for (int64_t i = 0; i < d->len; i++) {\n"
+        "        VaisPostings *p = &ix->terms[d->terms[i]];\n"
+        "        int64_t at = index_posting_lower(p, doc);\n"
+        "        if (at < p->len && p->items[at].doc == doc) {\n"
+        "            memmove(p->items + at, p->items + at + 1, (size_t)(p->len - at - 1) * sizeof(VaisPosting));\n"
+        "            p->len--;\n"
+        "        }\n"
+        "    }\n"
+        "    free(d->terms);\n"
+        "    memset(d, 0, sizeof(*d));\n"
+        "    d->doc = -2;\n"
+        "    ix->doc_live--;\n"
+        "    return 1;\n"
+        "}\n"
+        "\n"
+        "int64_t index_add_doc(int64_t handle, int64_t doc, char *text) {\n"
+        "    VaisIndex *ix = index_ptr(handle);\n"
+        "    if (doc < 0) fs_host_trap(\"index_add_doc\", \"\");\n"
+        "    index_remove_doc(handle, doc);\n"
+        "    int64_t distinct = 0;\n"
+        "    int64_t total = index_tokenize(ix, text, 1, &distinct);\n"
+        "    VaisIndexDoc *d = index_doc_insert(ix, doc);\n"
+        "    for (int64_t i = 0; i < distinct; i++) {\n"
+        "        int64_t term = ix->scratch[i];\n"
+        "        index_posting_add(ix, d, term, ix->terms[term].mark_pos);\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n"
+        "\n"
+        "int64_t index_add_term(int64_t handle, int64_t doc, char *term, int64_t tf) {\n"
+        "    VaisIndex *ix = index_ptr(handle);\n"
+        "    if (doc < 0 || term == 0 || tf <= 0) fs_host_trap(\"index_add_term\", \"\");\n"
+        "    int64_t s = index_doc_slot(ix, doc);\n"
+        "    VaisIndexDoc *d = s >= 0 ? &ix->docs[s] : index_doc_insert(ix, doc);\n"
+        "    index_posting_add(ix, d, index_term_id(ix, term, strlen(term), 1), tf);\n"
+        "    return tf;\n"
+        "}\n"
+        "\n"
+        "int64_t index_doc_count(int64_t handle) {\n"
+        "    return index_ptr(handle)->doc_live;\n"
+        "}\n"
+        "\n"
+        "typedef struct {\n"
+        "    VaisPosting *items;\n"
+        "    int64_t len;\n"
+        "    int64_t pos;\n"
+        "    int64_t weight;\n"
+        "} VaisIndexCursor;\n"
+        "\n"
+        "static void index_cursor_sift(VaisIndexCursor *c, int64_t n, int64_t i) {\n"
+        "    for (;;) {\n"
+        "        int64_t m = i;\n"
+        "        int64_t l = 2 * i + 1;\n"
+        "        int64_t r = l + 1;\n"
+        "        if (l < n && c[l].items[c[l].pos].doc < c[m].items[c[m].pos].doc) m = l;\n"
+        "        if (r < n && c[r].items[c[r].pos].doc < c[m].items[c[m].pos].doc) m = r;\n"
+        "        if (m == i) return;\n"
+        "        VaisIndexCursor t = c[i];\n"
+        "        c[i] = c[m];\n"
+        "        c[m] = t;\n"
+        "        i = m;\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "/* Hits reuse VaisPosting as (doc, score); a worse hit has the lower score,\n"
+        "   or the higher doc id on a tie. */\n"
+        "static int index_hit_worse(VaisPosting a, VaisPosting b) {\n"
+        "    return a.tf < b.tf || (a.tf == b.tf && a.doc > b.doc);\n"
+        "}\n"
+        "\n"
+        "static void index_hit_sift(VaisPosting *h, int64_t n, int64_t i) {\n"
+        "    for (;;) {\n"
+        "        int64_t w = i;\n"
+        "        int64_t l = 2 * i + 1;\n"
+        "        int64_t r = l + 1;\n"
+        "        if (l < n && index_hit_worse(h[l], h[w])) w = l;\n"
+        "        if (r < n && index_hit_worse(h[r], h[w])) w = r;\n"
+        "        if (w == i) return;\n"
+        "        VaisPosting t = h[i];\n"
+        "        h[i] = h[w];\n"
+        "        h[w] = t;\n"
+        "        i = w;\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "/* Scores every document that shares a term with query (the sum of query tf\n"
+        "   times doc tf, as in doc_term_weighted_score) by merging the query terms'\n"
+        "   postings through a heap of cursors, and keeps the best k in a min-heap.\n"
+        "   Returns the hit count; index_hit_doc/index_hit_score read them best first. */\n"
+        "int64_t index_top_k(int64_t handle, char *query, int64_t k) {\n"
+        "    VaisIndex *ix = index_ptr(handle);\n"
+        "    ix->hit_len = 0;\n"
+        "    int64_t distinct = 0;\n"
+        "    index_tokenize(ix, query, 0, &distinct);\n"
+        "    if (k <= 0 || distinct == 0) return 0;\n"
+        "    VaisIndexCursor *c = (VaisIndexCursor *)malloc((size_t)distinct * sizeof(VaisIndexCursor));\n"
+        "    if (c == 0) fs_host_trap(\"index_alloc\", \"\");\n"
+        "    int64_t n = 0;\n"
+        "    for (int64_t i = 0; i < distinct; i++) {\n"
+        "        VaisPostings *p = &ix->terms[ix->scratch[i]];\n"
+        "        if (p->len == 0) continue;\n"
+        "        c[n].items = p->items;\n"
+        "        c[n].len = p->len;\n"
+        "        c[n].pos = 0;\n"
+        "        c[n].weight = p->mark_pos;\n"
+        "        n++;\n"
+        "    }\n"
+        "    for (int64_t i = n / 2 - 1; i >= 0; i--) index_cursor_sift(c, n, i);\n"
+        "    int64_t cap = k < ix->doc_live ? k : ix->doc_live;\n"
+        "    ix->hits = (VaisPosting *)index_grow(ix->hits, &ix->hit_cap, sizeof(VaisPosting), cap + 1);\n"
+        "    while (n > 0) {\n"
+        "        VaisPosting hit;\n"
+        "        hit.doc = c[0].items[c[0].pos].doc;\n"
+        "        hit.tf = 0;\n"
+        "        while (n > 0 && c[0].items[c[0].pos].doc == hit.doc) {\n"
+        "            hit.tf += c[0].weight * c[0].items[c[0].pos].tf;\n"
+        "            c[0].pos++;\n"
+        "            if (c[0].pos == c[0].len) c[0] = c[--n];\n"
+        "            index_cursor_sift(c, n, 0);\n"
+        "        }\n"
+        "        if (ix->hit_len < cap) {\n"
+        "            int64_t i = ix->hit_len++;\n"
+        "            ix->hits[i] = hit;\n"
+        "            while (i > 0 && index_hit_worse(ix->hits[i], ix->hits[(i - 1) / 2])) {\n"
+        "                VaisPosting t = ix->hits[i];\n"
+        "                ix->hits[i] = ix->hits[(i - 1) / 2];\n"
+        "                ix->hits[(i - 1) / 2] = t;\n"
+        "                i = (i - 1) / 2;\n"
+        "            }\n"
+        "        } else if (cap > 0 && index_hit_worse(ix->hits[0], hit)) {\n"
+        "            ix->hits[0] = hit;\n"
+        "            index_hit_sift(ix->hits, cap, 0);\n"
+        "        }\n"
+        "    }\n"
+        "    free(c);\n"
+        "    for (int64_t end = ix->hit_len - 1; end > 0; end--) {\n"
+        "        VaisPosting t = ix->hits[0];\n"
+        "        ix->hits[0] = ix->hits[end];\n"
+        "        ix->hits[end] = t;\n"
+        "        index_hit_sift(ix->hits, end, 0);\n"
+        "    }\n"
+        "    return ix->hit_len;\n"
+        "}\n"
+        "\n"
+        "int64_t index_hit_doc(int64_t handle, int64_t i) {\n"
+        "    VaisIndex *ix = index_ptr(handle);\n"
+        "    if (i < 0 || i >= ix->hit_len) fs_host_trap(\"index_hit_doc\", \"\");\n"
+        "    return ix->hits[i].doc;\n"
+        "}\n"
+        "\n"
+        "int64_t index_hit_score(int64_t handle, int64_t i) {\n"
+        "    VaisIndex *ix = index_ptr(handle);\n"
+        "    if (i < 0 || i >= ix->hit_len) fs_host_trap(\"index_hit_score\", \"\");\n"
+        "    return ix->hits[i].tf;\n"
+        "}\n"
+        "\n"
+        "/* Binary snapshot store behind the snap_* builtins. A snapshot file is\n"
+        " * \"VAISSNP1\", the user version, the entry count, and a key-sorted offset\n"
+        " * table over 8-byte aligned {klen, vlen, key NUL, value NUL} records, all\n"
+        " * in native byte order; an empty file is an empty store. snap_open maps it\n"
+        " * read-only and binary-searches it in place; puts and removes go to an\n"
+        " * in-memory overlay and are appended to <path>.log, and snap_compact folds\n"
+        " * both into a fresh snapshot. Returned strings point into the mapping or\n"
+        " * the overlay and stay valid until snap_close. */\n"
+        "typedef struct {\n"
+        "    char *key;\n"
+        "    char *value;\n"
+        "    size_t klen;\n"
+        "    uint64_t hash;\n"
+        "} VaisSnapDelta;\n"
+        "\n"
+        "typedef struct {\n"
+        "    void *addr;\n"
+        "    size_t size;\n"
+        "} VaisSnapMap;\n"
+        "\n"
+        "typedef struct {\n"
+        "    char *path;\n"
+        "    char *log_path;\n"
+        "    const unsigned char *base;\n"
+        "    size_t base_size;\n"
+        "    int64_t base_count;\n"
+        "    VaisSnapMap *maps;\n"
+        "    int64_t map_len;\n"
+        "    int64_t map_cap;\n"
+        "    VaisSnapDelta *delta;\n"
+        "    int64_t delta_len;\n"
+        "    int64_t delta_cap;\n"
+        "    int64_t *slots;\n"
+        "    int64_t slot_cap;\n"
+        "    char **pool;\n"
+        "    int64_t pool_len;\n"
+        "    int64_t pool_cap;\n"
+        "    const char **view_keys;\n"
+        "    const char **view_values;\n"
+        "    int64_t view_len;\n"
+        "    int view_dirty;\n"
+        "    int64_t version;\n"
+        "    int64_t live;\n"
+        "    int64_t log_records;\n"
+        "    int log_fd;\n"
+        "} VaisSnap;\n"
+        "\n"
+        "#define VAIS_SNAP_HEADER 24\n"
+        "\n"
+        "static void *snap_grow(void *data, int64_t *cap, size_t item, int64_t need) {\n"
+        "    if (need <= *cap) return data;\n"
+        "    int64_t next = *cap == 0 ? 8 : *cap;\n"
+        "    while (next < need) next *= 2;\n"
+        "    void *grown = realloc(data, (size_t)next * item);\n"
+        "    if (grown == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    *cap = next;\n"
+        "    return grown;\n"
+        "}\n"
+        "\n"
+        "static VaisSnap *snap_ptr(int64_t handle) {\n"
+        "    if (handle == 0) fs_host_trap(\"snap\", \"\");\n"
+        "    return (VaisSnap *)(intptr_t)handle;\n"
+        "}\n"
+        "\n"
+        "static char *snap_keep(VaisSnap *s, const char *text, size_t n) {\n"
+        "    char *out = (char *)malloc(n + 1);\n"
+        "    if (out == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    memcpy(out, text, n);\n"
+        "    out[n] = '\\0';\n"
+        "    s->pool = (char **)snap_grow(s->pool, &s->pool_cap, sizeof(char *), s->pool_len + 1);\n"
+        "    s->pool[s->pool_len++] = out;\n"
+        "    return out;\n"
+        "}\n"
+        "\n"
+        "static uint64_t snap_word(const unsigned char *p) {\n"
+        "    uint64_t v;\n"
+        "    memcpy(&v, p, sizeof(v));\n"
+        "    return v;\n"
+        "}\n"
+        "\n"
+        "/* Key and value of base record i; traps when the record leaves the file. */\n"
+        "static const char *snap_base_record(VaisSnap *s, int64_t i, size_t *klen, const char **value) {\n"
+        "    uint64_t off = snap_word(s->base + VAIS_SNAP_HEADER + (size_t)i * 8);\n"
+        "    if (off > s->base_size || s->base_size - off < 18) fs_host_trap(\"snap_corrupt\", \"\");\n"
+        "    uint64_t kl = snap_word(s->base + off);\n"
+        "    uint64_t vl = snap_word(s->base + off + 8);\n"
+        "    if (kl > s->base_size || vl > s->base_size || s->base_size - off - 16 < kl + vl + 2) fs_host_trap(\"snap_corrupt\", \"\");\n"
+        "    const char *key = (const char *)s->base + off + 16;\n"
+        "    if (key[kl] != '\\0' || key[kl + 1 + vl] != '\\0') fs_host_trap(\"snap_corrupt\", \"\");\n"
+        "    *klen = (size_t)kl;\n"
+        "    if (value != 0) *value = key + kl + 1;\n"
+        "    return key;\n"
+        "}\n"
+        "\n"
+        "static int snap_key_cmp(const char *a, size_t an, const char *b, size_t bn) {\n"
+        "    int c = memcmp(a, b, an < bn ? an : bn);\n"
+        "    if (c != 0) return c;\n"
+        "    return an < bn ? -1 : (an > bn ? 1 : 0);\n"
+        "}\n"
+        "\n"
+        "static const char *snap_base_find(VaisSnap *s, const char *key, size_t n) {\n"
+        "    int64_t lo = 0;\n"
+        "    int64_t hi = s->base_count;\n"
+        "    while (lo < hi) {\n"
+        "        int64_t mid = lo + (hi - lo) / 2;\n"
+        "        size_t klen = 0;\n"
+        "        const char *value = 0;\n"
+        "        const char *k = snap_base_record(s, mid, &klen, &value);\n"
+        "        int c = snap_key_cmp(k, klen, key, n);\n"
+        "        if (c == 0) return value;\n"
+        "        if (c < 0) lo = mid + 1;\n"
+        "        else hi = mid;\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "static void snap_rehash(VaisSnap *s) {\n"
+        "    int64_t cap = s->slot_cap == 0 ? 64 : s->slot_cap * 2;\n"
+        "    int64_t *slots = (int64_t *)malloc((size_t)cap * sizeof(int64_t));\n"
+        "    if (slots == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    for (int64_t i = 0; i < cap; i++) slots[i] = -1;\n"
+        "    for (int64_t i = 0; i < s->delta_len; i++) {\n"
+        "        int64_t at = (int64_t)(s->delta[i].hash & (uint64_t)(cap - 1));\n"
+        "        while (slots[at] >= 0) at = (at + 1) & (cap - 1);\n"
+        "        slots[at] = i;\n"
+        "    }\n"
+        "    free(s->slots);\n"
+        "    s->slots = slots;\n"
+        "    s->slot_cap = cap;\n"
+        "}\n"
+        "\n"
+        "/* Overlay entry for key, created when create is set. */\n"
+        "static VaisSnapDelta *snap_delta(VaisSnap *s, const char *key, size_t n, int create) {\n"
+        "    uint64_t h = index_hash(key, n);\n"
+        "    if (s->slot_cap > 0) {\n"
+        "        int64_t at = (int64_t)(h & (uint64_t)(s->slot_cap - 1));\n"
+        "        while (s->slots[at] >= 0) {\n"
+        "            VaisSnapDelta *d = &s->delta[s->slots[at]];\n"
+        "            if (d->hash == h && d->klen == n && memcmp(d->key, key, n) == 0) return d;\n"
+        "            at = (at + 1) & (s->slot_cap - 1);\n"
+        "        }\n"
+        "    }\n"
+        "    if (!create) return 0;\n"
+        "    if ((s->delta_len + 1) * 4 > s->slot_cap * 3) snap_rehash(s);\n"
+        "    s->delta = (VaisSnapDelta *)snap_grow(s->delta, &s->delta_cap, sizeof(VaisSnapDelta), s->delta_len + 1);\n"
+        "    VaisSnapDelta *d = &s->delta[s->delta_len];\n"
+        "    d->key = snap_keep(s, key, n);\n"
+        "    d->value = 0;\n"
+        "    d->klen = n;\n"
+        "    d->hash = h;\n"
+        "    int64_t at = (int64_t)(h & (uint64_t)(s->slot_cap - 1));\n"
+        "    while (s->slots[at] >= 0) at = (at + 1) & (s->slot_cap - 1);\n"
+        "    s->slots[at] = s->delta_len++;\n"
+        "    return d;\n"
+        "}\n"
+        "\n"
+        "/* The live value for key, or 0 when it is absent or removed. */\n"
+        "static const char *snap_lookup(VaisSnap *s, const char *key, size_t n) {\n"
+        "    VaisSnapDelta *d = snap_delta(s, key, n, 0);\n"
+        "    if (d != 0) return d->value;\n"
+        "    return snap_base_find(s, key, n);\n"
+        "}\n"
+        "\n"
+        "static void snap_apply_put(VaisSnap *s, const char *key, size_t kn, const char *value, size_t vn) {\n"
+        "    if (snap_lookup(s, key, kn) == 0) s->live++;\n"
+        "    VaisSnapDelta *d = snap_delta(s, key, kn, 1);\n"
+        "    d->value = snap_keep(s, value, vn);\n"
+        "    s->view_dirty = 1;\n"
+        "}\n"
+        "\n"
+        "static int snap_apply_remove(VaisSnap *s, const char *key, size_t kn) {\n"
+        "    if (snap_lookup(s, key, kn) == 0) return 0;\n"
+        "    snap_delta(s, key, kn, 1)->value = 0;\n"
+        "    s->live--;\n"
+        "    s->view_dirty = 1;\n"
+        "    return 1;\n"
+        "}\n"
+        "\n"
+        "static int snap_map_base(VaisSnap *s) {\n"
+        "    int fd = open(s->path, O_RDONLY);\n"
+        "    if (fd < 0) return errno == ENOENT ? 0 : -1;\n"
+        "    struct stat st;\n"
+        "    if (fstat(fd, &st) != 0 || (st.st_size > 0 && st.st_size < VAIS_SNAP_HEADER)) {\n"
+        "        close(fd);\n"
+        "        return -1;\n"
+        "    }\n"
+        "    if (st.st_size == 0) {\n"
+        "        close(fd);\n"
+        "        return 0;\n"
+        "    }\n"
+        "    void *addr = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);\n"
+        "    close(fd);\n"
+        "    if (addr == MAP_FAILED) return -1;\n"
+        "    const unsigned char *p = (const unsigned char *)addr;\n"
+        "    uint64_t count = snap_word(p + 16);\n"
+        "    if (memcmp(p, \"VAISSNP1\", 8) != 0 || count > ((uint64_t)st.st_size - VAIS_SNAP_HEADER) / 8) {\n"
+        "        munmap(addr, (size_t)st.st_size);\n"
+        "        return -1;\n"
+        "    }\n"
+        "    s->maps = (VaisSnapMap *)snap_grow(s->maps, &s->map_cap, sizeof(VaisSnapMap), s->map_len + 1);\n"
+        "    s->maps[s->map_len].addr = addr;\n"
+        "    s->maps[s->map_len].size = (size_t)st.st_size;\n"
+        "    s->map_len++;\n"
+        "    s->base = p;\n"
+        "    s->base_size = (size_t)st.st_size;\n"
+        "    s->base_count = (int64_t)count;\n"
+        "    s->live = (int64_t)count;\n"
+        "    s->version = (int64_t)snap_word(p + 8);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "/* Replays <path>.log; a torn final record is cut off so appends stay aligned. */\n"
+        "static int snap_replay(VaisSnap *s) {\n"
+        "    int fd = open(s->log_path, O_RDONLY);\n"
+        "    if (fd < 0) return errno == ENOENT ? 0 : -1;\n"
+        "    struct stat st;\n"
+        "    if (fstat(fd, &st) != 0) {\n"
+        "        close(fd);\n"
+        "        return -1;\n"
+        "    }\n"
+        "    size_t size = (size_t)st.st_size;\n"
+        "    unsigned char *buf = (unsigned char *)malloc(size + 1);\n"
+        "    if (buf == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    size_t got = 0;\n"
+        "    while (got < size) {\n"
+        "        ssize_t n = read(fd, buf + got, size - got);\n"
+        "        if (n <= 0) break;\n"
+        "        got += (size_t)n;\n"
+        "    }\n"
+        "    close(fd);\n"
+        "    size_t at = 0;\n"
+        "    while (at < got) {\n"
+        "        unsigned char op = buf[at];\n"
+        "        if (op == 'V' && got - at >= 9) {\n"
+        "            s->version = (int64_t)snap_word(buf + at + 1);\n"
+        "            at += 9;\n"
+        "        } else if (op == 'D' && got - at >= 9 && snap_word(buf + at + 1) <= got - at - 9) {\n"
+        "            uint64_t kn = snap_word(buf + at + 1);\n"
+        "            snap_apply_remove(s, (const char *)buf + at + 9, (size_t)kn);\n"
+        "            at += 9 + (size_t)kn;\n"
+        "        } else if (op == 'P' && got - at >= 17 && snap_word(buf + at + 1) <= got - at - 17 &&\n"
+        "            snap_word(buf + at + 9) <= got - at - 17 - snap_word(buf + at + 1)) {\n"
+        "            uint64_t kn = snap_word(buf + at + 1);\n"
+        "            uint64_t vn = snap_word(buf + at + 9);\n"
+        "            snap_apply_put(s, (const char *)buf + at + 17, (size_t)kn, (const char *)buf + at + 17 + kn, (size_t)vn);\n"
+        "            at += 17 + (size_t)(kn + vn);\n"
+        "        } else {\n"
+        "            break;\n"
+        "        }\n"
+        "        s->log_records++;\n"
+        "    }\n"
+        "    free(buf);\n"
+        "    if (at < got && truncate(s->log_path, (off_t)at) != 0) return -1;\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "static int snap_log(VaisSnap *s, unsigned char op, const char *key, size_t kn, const char *value, size_t vn) {\n"
+        "    if (s->log_fd < 0) {\n"
+        "        s->log_fd = open(s->log_path, O_WRONLY | O_CREAT | O_APPEND, 0644);\n"
+        "        if (s->log_fd < 0) return 1;\n"
+        "    }\n"
+        "    unsigned char head[17];\n"
+        "    size_t hn = 1;\n"
+        "    head[0] = op;\n"
+        "    if (op == 'V') {\n"
+        "        uint64_t v = (uint64_t)s->version;\n"
+        "        memcpy(head + 1, &v, 8);\n"
+        "        hn = 9;\n"
+        "    } else {\n"
+        "        uint64_t k = (uint64_t)kn;\n"
+        "        memcpy(head + 1, &k, 8);\n"
+        "        hn = 9;\n"
+        "        if (op == 'P') {\n"
+        "            uint64_t v = (uint64_t)vn;\n"
+        "            memcpy(head + 9, &v, 8);\n"
+        "            hn = 17;\n"
+        "        }\n"
+        "    }\n"
+        "    size_t total = hn + (op == 'V' ? 0 : kn) + (op == 'P' ? vn : 0);\n"
+        "    unsigned char *rec = (unsigned char *)malloc(total);\n"
+        "    if (rec == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    memcpy(rec, head, hn);\n"
+        "    if (op != 'V') memcpy(rec + hn, key, kn);\n"
+        "    if (op == 'P') memcpy(rec + hn + kn, value, vn);\n"
+        "    ssize_t wrote = write(s->log_fd, rec, total);\n"
+        "    free(rec);\n"
+        "    if (wrote != (ssize_t)total) return 1;\n"
+        "    s->log_records++;\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "static int snap_view_cmp(const void *a, const void *b) {\n"
+        "    const VaisSnapDelta *x = *(const VaisSnapDelta *const *)a;\n"
+        "    const VaisSnapDelta *y = *(const VaisSnapDelta *const *)b;\n"
+        "    return snap_key_cmp(x->key, x->klen, y->key, y->klen);\n"
+        "}\n"
+        "\n"
+        "/* Key-sorted merge of the base records and the overlay. */\n"
+        "static void snap_build_view(VaisSnap *s) {\n"
+        "    if (!s->view_dirty) return;\n"
+        "    VaisSnapDelta **order = (VaisSnapDelta **)malloc((size_t)(s->delta_len + 1) * sizeof(VaisSnapDelta *));\n"
+        "    if (order == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    for (int64_t i = 0; i < s->delta_len; i++) order[i] = &s->delta[i];\n"
+        "    qsort(order, (size_t)s->delta_len, sizeof(VaisSnapDelta *), snap_view_cmp);\n"
+        "    free(s->view_keys);\n"
+        "    free(s->view_values);\n"
+        "    s->view_keys = (const char **)malloc((size_t)(s->live + 1) * sizeof(char *));\n"
+        "    s->view_values = (const char **)malloc((size_t)(s->live + 1) * sizeof(char *));\n"
+        "    if (s->view_keys == 0 || s->view_values == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    int64_t n = 0;\n"
+        "    int64_t b = 0;\n"
+        "    int64_t d = 0;\n"
+        "    while (b < s->base_count || d < s->delta_len) {\n"
+        "        size_t klen = 0;\n"
+        "        const char *value = 0;\n"
+        "        const char *key = b < s->base_count ? snap_base_record(s, b, &klen, &value) : 0;\n"
+        "        int c = key == 0 ? 1 : (d == s->delta_len ? -1 : snap_key_cmp(key, klen, order[d]->key, order[d]->klen));\n"
+        "        if (c >= 0) {\n"
+        "            if (order[d]->value != 0) {\n"
+        "                s->view_keys[n] = order[d]->key;\n"
+        "                s->view_values[n++] = order[d]->value;\n"
+        "            }\n"
+        "            d++;\n"
+        "            if (c == 0) b++;\n"
+        "        } else {\n"
+        "            s->view_keys[n] = key;\n"
+        "            s->view_values[n++] = value;\n"
+        "            b++;\n"
+        "        }\n"
+        "    }\n"
+        "    free(order);\n"
+        "    s->view_len = n;\n"
+        "    s->view_dirty = 0;\n"
+        "}\n"
+        "\n"
+        "int64_t snap_close(int64_t handle) {\n"
+        "    VaisSnap *s = snap_ptr(handle);\n"
+        "    if (s->log_fd >= 0) close(s->log_fd);\n"
+        "    for (int64_t i = 0; i < s->map_len; i++) munmap(s->maps[i].addr, s->maps[i].size);\n"
+        "    for (int64_t i = 0; i < s->pool_len; i++) free(s->pool[i]);\n"
+        "    free(s->maps);\n"
+        "    free(s->pool);\n"
+        "    free(s->delta);\n"
+        "    free(s->slots);\n"
+        "    free(s->view_keys);\n"
+        "    free(s->view_values);\n"
+        "    free(s->path);\n"
+        "    free(s->log_path);\n"
+        "    free(s);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t snap_open(char *path) {\n"
+        "    if (path == 0 || path[0] == '\\0') fs_host_trap(\"snap_open\", \"\");\n"
+        "    VaisSnap *s = (VaisSnap *)calloc(1, sizeof(VaisSnap));\n"
+        "    if (s == 0) fs_host_trap(\"snap_open\", \"\");\n"
+        "    size_t n = strlen(path);\n"
+        "    s->path = strdup(path);\n"
+        "    s->log_path = (char *)malloc(n + 5);\n"
+        "    if (s->path == 0 || s->log_path == 0) fs_host_trap(\"snap_open\", \"\");\n"
+        "    memcpy(s->log_path, path, n);\n"
+        "    memcpy(s->log_path + n, \".log\", 5);\n"
+        "    s->log_fd = -1;\n"
+        "    s->view_dirty = 1;\n"
+        "    int64_t handle = (int64_t)(intptr_t)s;\n"
+        "    if (snap_map_base(s) != 0 || snap_replay(s) != 0) {\n"
+        "        snap_close(handle);\n"
+        "        return 0;\n"
+        "    }\n"
+        "    return handle;\n"
+        "}\n"
+        "\n"
+        "char *snap_get(int64_t handle, char *key, char *fallback) {\n"
+        "    if (key == 0) fs_host_trap(\"snap_get\", \"\");\n"
+        "    const char *value = snap_lookup(snap_ptr(handle), key, strlen(key));\n"
+        "    return value != 0 ? (char *)value : fallback;\n"
+        "}\n"
+        "\n"
+        "int64_t snap_has(int64_t handle, char *key) {\n"
+        "    if (key == 0) fs_host_trap(\"snap_has\", \"\");\n"
+        "    return snap_lookup(snap_ptr(handle), key, strlen(key)) != 0;\n"
+        "}\n"
+        "\n"
+        "/* Appends to the log only when the stored value changes; 1 means the log\n"
+        " * write failed and the store is unchanged. */\n"
+        "int64_t snap_put(int64_t handle, char *key, char *value) {\n"
+        "    VaisSnap *s = snap_ptr(handle);\n"
+        "    if (key == 0 || value == 0) fs_host_trap(\"snap_put\", \"\");\n"
+        "    size_t kn = strlen(key);\n"
+        "    size_t vn = strlen(value);\n"
+        "    const char *old = snap_lookup(s, key, kn);\n"
+        "    if (old != 0 && strcmp(old, value) == 0) return 0;\n"
+        "    if (snap_log(s, 'P', key, kn, value, vn) != 0) return 1;\n"
+        "    snap_apply_put(s, key, kn, value, vn);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t snap_remove(int64_t handle, char *key) {\n"
+        "    VaisSnap *s = snap_ptr(handle);\n"
+        "    if (key == 0) fs_host_trap(\"snap_remove\", \"\");\n"
+        "    size_t kn = strlen(key);\n"
+        "    if (snap_lookup(s, key, kn) == 0) return 0;\n"
+        "    if (snap_log(s, 'D', key, kn, 0, 0) != 0) return 0;\n"
+        "    return snap_apply_remove(s, key, kn);\n"
+        "}\n"
+        "\n"
+        "int64_t snap_len(int64_t handle) {\n"
+        "    return snap_ptr(handle)->live;\n"
+        "}\n"
+        "\n"
+        "int64_t snap_log_len(int64_t handle) {\n"
+        "    return snap_ptr(handle)->log_records;\n"
+        "}\n"
+        "\n"
+        "int64_t snap_version(int64_t handle) {\n"
+        "    return snap_ptr(handle)->version;\n"
+        "}\n"
+        "\n"
+        "int64_t snap_set_version(int64_t handle, int64_t version) {\n"
+        "    VaisSnap *s = snap_ptr(handle);\n"
+        "    if (version == s->version) return 0;\n"
+        "    int64_t old = s->version;\n"
+        "    s->version = version;\n"
+        "    if (snap_log(s, 'V', 0, 0, 0, 0) != 0) {\n"
+        "        s->version = old;\n"
+        "        return 1;\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "char *snap_key_at(int64_t handle, int64_t i) {\n"
+        "    VaisSnap *s = snap_ptr(handle);\n"
+        "    snap_build_view(s);\n"
+        "    if (i < 0 || i >= s->view_len) fs_host_trap(\"snap_key_at\", \"\");\n"
+        "    return (char *)s->view_keys[i];\n"
+        "}\n"
+        "\n"
+        "char *snap_value_at(int64_t handle, int64_t i) {\n"
+        "    VaisSnap *s = snap_ptr(handle);\n"
+        "    snap_build_view(s);\n"
+        "    if (i < 0 || i >= s->view_len) fs_host_trap(\"snap_value_at\", \"\");\n"
+        "    return (char *)s->view_values[i];\n"
+        "}\n"
+        "\n"
+        "/* fsyncs the directory holding path, so a rename into it is durable. */\n"
+        "static int snap_sync_dir(const char *path) {\n"
+        "    const char *last = strrchr(path, '/');\n"
+        "    size_t n = last == 0 ? 0 : last == path ? 1 : (size_t)(last - path);\n"
+        "    char *dir = (char *)malloc(n + 2);\n"
+        "    if (dir == 0) return -1;\n"
+        "    if (n == 0) dir[n++] = '.';\n"
+        "    else memcpy(dir, path, n);\n"
+        "    dir[n] = '\\0';\n"
+        "    int fd = open(dir, O_RDONLY);\n"
+        "    free(dir);\n"
+        "    if (fd < 0) return -1;\n"
+        "    int rc = fsync(fd);\n"
+        "    close(fd);\n"
+        "    return rc;\n"
+        "}\n"
+        "\n"
+        "/* Writes the merged view to <path>.tmp, fsyncs it, renames it over the\n"
+        " * snapshot, and drops the log only once the directory entry is synced, so a\n"
+        " * crash leaves either the old snapshot and its log or the new snapshot;\n"
+        " * replaying a stale log over the new snapshot is harmless. Returns the entry\n"
+        " * count, or -1 when the snapshot could not be written. */\n"
+        "int64_t snap_compact(int64_t handle) {\n"
+        "    VaisSnap *s = snap_ptr(handle);\n"
+        "    snap_build_view(s);\n"
+        "    size_t n = strlen(s->path);\n"
+        "    char *tmp = (char *)malloc(n + 5);\n"
+        "    if (tmp == 0) fs_host_trap(\"snap_alloc\", \"\");\n"
+        "    memcpy(tmp, s->path, n);\n"
+        "    memcpy(tmp + n, \".tmp\", 5);\n"
+        "    FILE *f = fopen(tmp, \"wb\");\n"
+        "    if (f == 0) {\n"
+        "        free(tmp);\n"
+        "        return -1;\n"
+        "    }\n"
+        "    uint64_t head[3] = {0, (uint64_t)s->version, (uint64_t)s->view_len};\n"
+        "    memcpy(head, \"VAISSNP1\", 8);\n"
+        "    int ok = fwrite(head, 8, 3, f) == 3;\n"
+        "    uint64_t off = VAIS_SNAP_HEADER + (uint64_t)s->view_len * 8;\n"
+        "    for (int64_t i = 0; ok && i < s->view_len; i++) {\n"
+        "        ok = fwrite(&off, 8, 1, f) == 1;\n"
+        "        off += (16 + strlen(s->view_keys[i]) + strlen(s->view_values[i]) + 2 + 7) & ~(uint64_t)7;\n"
+        "    }\n"
+        "    static const char pad[8] = {0};\n"
+        "    for (int64_t i = 0; ok && i < s->view_len; i++) {\n"
+        "        uint64_t rec[2] = {strlen(s->view_keys[i]), strlen(s->view_values[i])};\n"
+        "        size_t body = (size_t)(rec[0] + rec[1] + 2);\n"
+        "        size_t fill = ((16 + body + 7) & ~(size_t)7) - 16 - body;\n"
+        "        ok = fwrite(rec, 8, 2, f) == 2 &&\n"
+        "            fwrite(s->view_keys[i], 1, (size_t)rec[0] + 1, f) == rec[0] + 1 &&\n"
+        "            fwrite(s->view_values[i], 1, (size_t)rec[1] + 1, f) == rec[1] + 1 &&\n"
+        "            fwrite(pad, 1, fill, f) == fill;\n"
+        "    }\n"
+        "    if (ok && (fflush(f) != 0 || fsync(fileno(f)) != 0)) ok = 0;\n"
+        "    if (fclose(f) != 0) ok = 0;\n"
+        "    if (!ok || rename(tmp, s->path) != 0) {\n"
+        "        unlink(tmp);\n"
+        "        free(tmp);\n"
+        "        return -1;\n"
+        "    }\n"
+        "    free(tmp);\n"
+        "    if (s->log_fd >= 0) close(s->log_fd);\n"
+        "    s->log_fd = -1;\n"
+        "    if (snap_sync_dir(s->path) == 0) unlink(s->log_path);\n"
+        "    s->log_records = 0;\n"
+        "    if (snap_map_base(s) != 0) fs_host_trap(\"snap_compact\", \"\");\n"
+        "    for (int64_t i = 0; i < s->slot_cap; i++) s->slots[i] = -1;\n"
+        "    s->delta_len = 0;\n"
+        "    s->view_dirty = 1;\n"
+        "    return s->live;\n"
+        "}\n"
+        "\n"
+        "/* Parallel pipeline workers behind `par` list pipelines. vais_par_begin\n"
+        "   forks up to one worker per core, and every process, parent included,\n"
+        "   claims fixed-size chunks from a shared counter until none are left. Each\n"
+        "   chunk's partial result goes into its own slot in a shared mapping, and\n"
+        "   vais_par_reduce folds the slots in chunk order, so the result does not\n"
+        "   depend on which worker ran which chunk. A pipeline started inside a worker\n"
+        "   or inside another pipeline runs on the calling process alone. */\n"
+        "typedef struct {\n"
+        "    int64_t next;\n"
+        "    int64_t chunks;\n"
+        "    int64_t workers;\n"
+        "    size_t bytes;\n"
+        "    pid_t pids[64];\n"
+        "    int64_t slots[];\n"
+        "} VaisPar;\n"
+        "\n"
+        "static VaisPar *vais_par_forked_for = 0;\n"
+        "static int vais_par_depth = 0;\n"
+        "\n"
+        "static int64_t vais_par_worker_count(int64_t chunks) {\n"
+        "    if (vais_par_forked_for != 0 || vais_par_depth > 0) return 1;\n"
+        "    long want = sysconf(_SC_NPROCESSORS_ONLN);\n"
+        "    const char *env = getenv(\"VAIS_PAR_WORKERS\");\n"
+        "    if (env != 0 && env[0] != '\\0') want = strtol(env, 0, 10);\n"
+        "    if (want > 65) want = 65;\n"
+        "    if (want > chunks) want = (long)chunks;\n"
+        "    return want < 1 ? 1 : want;\n"
+        "}\n"
+        "\n"
+        "int64_t vais_par_begin(int64_t len, int64_t chunk) {\n"
+        "    if (chunk < 1) chunk = 1;\n"
+        "    int64_t chunks = len > 0 ? (len + chunk - 1) / chunk : 0;\n"
+        "    size_t bytes = sizeof(VaisPar) + (size_t)chunks * 2 * sizeof(int64_t);\n"
+        "    VaisPar *p = (VaisPar *)mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);\n"
+        "    if (p == MAP_FAILED) fs_host_trap(\"par\", \"\");\n"
+        "    p->bytes = bytes;\n"
+        "    p->chunks = chunks;\n"
+        "    int64_t want = vais_par_worker_count(chunks);\n"
+        "    fflush(0);\n"
+        "    while (p->workers + 1 < want) {\n"
+        "        pid_t pid = fork();\n"
+        "        if (pid < 0) break;\n"
+        "        if (pid == 0) {\n"
+        "            vais_par_forked_for = p;\n"
+        "            return (int64_t)(intptr_t)p;\n"
+        "        }\n"
+        "        p->pids[p->workers++] = pid;\n"
+        "    }\n"
+        "    vais_par_depth++;\n"
+        "    return (int64_t)(intptr_t)p;\n"
+        "}\n"
+        "\n"
+        "/* Stores the finished chunk's partial (chunk < 0 on the first call) and\n"
+        "   claims the next chunk, or returns -1 when every chunk is taken. */\n"
+        "int64_t vais_par_next(int64_t handle, int64_t chunk, int64_t value, int64_t seen) {\n"
+        "    VaisPar *p = (VaisPar *)(intptr_t)handle;\n"
+        "    if (chunk >= 0 && chunk < p->chunks) {\n"
+        "        p->slots[chunk * 2] = value;\n"
+        "        p->slots[chunk * 2 + 1] = seen;\n"
+        "    }\n"
+        "    int64_t claimed = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED);\n"
+        "    return claimed < p->chunks ? claimed : -1;\n"
+        "}\n"
+        "\n"
+        "/* Workers exit here. The parent waits for them and returns how many chunks\n"
+        "   produced a value. */\n"
+        "int64_t vais_par_wait(int64_t handle) {\n"
+        "    VaisPar *p = (VaisPar *)(intptr_t)handle;\n"
+        "    if (vais_par_forked_for == p) _exit(0);\n"
+        "    int failed = 0;\n"
+        "    for (int64_t w = 0; w < p->workers; w++) {\n"
+        "        int status = 0;\n"
+        "        while (waitpid(p->pids[w], &status, 0) < 0) {\n"
+        "            if (errno != EINTR) { failed = 1; break; }\n"
+        "        }\n"
+        "        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;\n"
+        "    }\n"
+        "    p->workers = 0;\n"
+        "    vais_par_depth--;\n"
+        "    if (failed) fs_host_trap(\"par\", \"worker failed\");\n"
+        "    int64_t seen = 0;\n"
+        "    for (int64_t c = 0; c < p->chunks; c++) {\n"
+        "        if (p->slots[c * 2 + 1] != 0) seen++;\n"
+        "    }\n"
+        "    return seen;\n"
+        "}\n"
+        "\n"
+        "/* Folds the chunk partials in chunk order (op 0 sum, 1 min, 2 max) and\n"
+        "   releases the pipeline. */\n"
+        "int64_t vais_par_reduce(int64_t handle, int64_t op) {\n"
+        "    VaisPar *p = (VaisPar *)(intptr_t)handle;\n"
+        "    int64_t acc = 0;\n"
+        "    int have = 0;\n"
+        "    for (int64_t c = 0; c < p->chunks; c++) {\n"
+        "        if (p->slots[c * 2 + 1] == 0) continue;\n"
+        "        int64_t v = p->slots[c * 2];\n"
+        "        if (op == 0) acc = (int64_t)((uint64_t)acc + (uint64_t)v);\n"
+        "        else if (!have || (op == 1 ? v < acc : v > acc)) acc = v;\n"
+        "        have = 1;\n"
+        "    }\n"
+        "    munmap(p, p->bytes);\n"
+        "    return acc;\n"
+        "}\n"
+        "\n"
+        "/* Output collected from one capture pipe. */\n"
+        "typedef struct {\n"
+        "    int fd;\n"
+        "    char *data;\n"
+        "    size_t len;\n"
+        "    size_t cap;\n"
+        "} ProcPipeText;\n"
+        "\n"
+        "static char **proc_argv_from_list(int64_t *argv_buf) {\n"
+        "    if (argv_buf == 0) return 0;\n"
+        "    int64_t argc = argv_buf[1];\n"
+        "    int64_t *items = vais_list_items(argv_buf);\n"
+        "    if (argc <= 0 || items == 0) return 0;\n"
+        "    char **argv = (char **)malloc((size_t)(argc + 1) * sizeof(char *));\n"
+        "    if (argv == 0) return 0;\n"
+        "    for (int64_t i = 0; i < argc; i++) {\n"
+        "        argv[i] = (char *)(intptr_t)items[i];\n"
+        "        if (argv[i] == 0) {\n"
+        "            free(argv);\n"
+        "            return 0;\n"
+        "        }\n"
+        "    }\n"
+        "    argv[argc] = 0;\n"
+        "    return argv;\n"
+        "}\n"
+        "\n"
+        "static int64_t proc_status_code(int status) {\n"
+        "    if (WIFEXITED(status)) return WEXITSTATUS(status);\n"
+        "    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);\n"
+        "    return 1;\n"
+        "}\n"
+        "\n"
+        "/* Runs argv with stdout and/or stderr on pipes (a NULL text pointer leaves\n"
+        "   that stream inherited) and drains both with poll until they close, so a\n"
+        "   child that fills one pipe never blocks while the other is being read.\n"
+        "   Returns the exit code; the texts are heap strings. */\n"
+        "static int64_t proc_capture_pipes(const char *op, char **argv, char **out_text, char **err_text) {\n"
+        "    char **texts[2] = { out_text, err_text };\n"
+        "    int targets[2] = { STDOUT_FILENO, STDERR_FILENO };\n"
+        "    int fds[2][2] = { { -1, -1 }, { -1, -1 } };\n"
+        "    for (int s = 0; s < 2; s++) {\n"
+        "        if (texts[s] != 0 && pipe(fds[s]) != 0) fs_host_trap(op, \"pipe\");\n"
+        "    }\n"
+        "    pid_t pid = fork();\n"
+        "    if (pid < 0) fs_host_trap(op, \"fork\");\n"
+        "    if (pid == 0) {\n"
+        "        for (int s = 0; s < 2; s++) {\n"
+        "            if (texts[s] == 0) continue;\n"
+        "            close(fds[s][0]);\n"
+        "            if (dup2(fds[s][1], targets[s]) < 0) _exit(127);\n"
+        "            close(fds[s][1]);\n"
+        "        }\n"
+        "        execvp(argv[0], argv);\n"
+        "        fprintf(stderr, \"vais host %s failed: %s: %s\\n\", op, argv[0], strerror(errno == 0 ? EIO : errno));\n"
+        "        _exit(127);\n"
+        "    }\n"
+        "    ProcPipeText streams[2];\n"
+        "    int live = 0;\n"
+        "    for (int s = 0; s < 2; s++) {\n"
+        "        streams[s].fd = -1;\n"
+        "        streams[s].data = 0;\n"
+        "        streams[s].len = 0;\n"
+        "        streams[s].cap = 0;\n"
+        "        if (texts[s] == 0) continue;\n"
+        "        close(fds[s][1]);\n"
+        "        streams[s].fd = fds[s][0];\n"
+        "        streams[s].cap = 256;\n"
+        "        streams[s].data = (char *)malloc(streams[s].cap);\n"
+        "        if (streams[s].data == 0) fs_host_trap(op, \"alloc\");\n"
+        "        live++;\n"
+        "    }\n"
+        "    char buf[65536];\n"
+        "    while (live > 0) {\n"
+        "        struct pollfd polls[2];\n"
+        "        for (int s = 0; s < 2; s++) {\n"
+        "            polls[s].fd = streams[s].fd;\n"
+        "            polls[s].events = POLLIN;\n"
+        "            polls[s].revents = 0;\n"
+        "        }\n"
+        "        if (poll(polls, 2, -1) < 0) {\n"
+        "            if (errno == EINTR) continue;\n"
+        "            fs_host_trap(op, \"poll\");\n"
+        "        }\n"
+        "        for (int s = 0; s < 2; s++) {\n"
+        "            ProcPipeText *t = &streams[s];\n"
+        "            if (t->fd < 0 || polls[s].revents == 0) continue;\n"
+        "            ssize_t n = read(t->fd, buf, sizeof(buf));\n"
+        "            if (n < 0 && errno == EINTR) continue;\n"
+        "            if (n < 0) fs_host_trap(op, \"read\");\n"
+        "            if (n == 0) {\n"
+        "                close(t->fd);\n"
+        "                t->fd = -1;\n"
+        "                live--;\n"
+        "                continue;\n"
+        "            }\n"
+        "            if (t->len + (size_t)n + 1 > t->cap) {\n"
+        "                while (t->len + (size_t)n + 1 > t->cap) t->cap = t->cap * 2;\n"
+        "                char *next = (char *)realloc(t->data, t->cap);\n"
+        "                if (next == 0) fs_host_trap(op, \"alloc\");\n"
+        "                t->data = next;\n"
+        "            }\n"
+        "            memcpy(t->data + t->len, buf, (size_t)n);\n"
+        "            t->len = t->len + (size_t)n;\n"
+        "        }\n"
+        "    }\n"
+        "    int64_t code = 1;\n"
+        "    int status = 0;\n"
+        "    for (;;) {\n"
+        "        if (waitpid(pid, &status, 0) >= 0) {\n"
+        "            code = proc_status_code(status);\n"
+        "            break;\n"
+        "        }\n"
+        "        if (errno != EINTR) {\n"
+        "            code = errno == 0 ? 1 : errno;\n"
+        "            break;\n"
+        "        }\n"
+        "    }\n"
+        "    for (int s = 0; s < 2; s++) {\n"
+        "        if (texts[s] == 0) continue;\n"
+        "        streams[s].data[streams[s].len] = '\\0';\n"
+        "        *texts[s] = streams[s].data;\n"
+        "    }\n"
+        "    return code;\n"
+        "}\n"
+        "\n"
+        "/* Capture entry point for the direct prelude, which passes a C argv. */\n"
+        "int64_t vais_proc_capture_argv(char **argv, char **out_text, char **err_text) {\n"
+        "    return proc_capture_pipes(\"proc_capture\", argv, out_text, err_text);\n"
+        "}\n"
+        "\n"
+        "char *proc_capture_stdout(int64_t *argv_buf) {\n"
+        "    char **argv = proc_argv_from_list(argv_buf);\n"
+        "    if (argv == 0) return fs_host_copy(\"\");\n"
+        "    char *out = 0;\n"
+        "    proc_capture_pipes(\"proc_capture_stdout\", argv, &out, 0);\n"
+        "    free(argv);\n"
+        "    return out;\n"
+        "}\n"
+        "\n"
+        "char *proc_capture_stderr(int64_t *argv_buf) {\n"
+        "    char **argv = proc_argv_from_list(argv_buf);\n"
+        "    if (argv == 0) return fs_host_copy(\"\");\n"
+        "    char *err = 0;\n"
+        "    proc_capture_pipes(\"proc_capture_stderr\", argv, 0, &err);\n"
+        "    free(argv);\n"
+        "    return err;\n"
+        "}\n"
+        "\n"
+        "static int proc_redirect_path(const char *path, int fd) {\n"
+        "    if (path == 0 || path[0] == '\\0') return 0;\n"
+        "    int out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);\n"
+        "    if (out < 0) return 1;\n"
+        "    if (dup2(out, fd) < 0) { close(out); return 1; }\n"
+        "    close(out);\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t proc_capture_to(int64_t *argv_buf, char *stdout_path, char *stderr_path) {\n"
+        "    if (argv_buf == 0) return 1;\n"
+        "    int64_t argc = argv_buf[1];\n"
+        "    int64_t *items = vais_list_items(argv_buf);\n"
+        "    if (argc <= 0 || items == 0) return 1;\n"
+        "    char **argv = (char **)malloc((size_t)(argc + 1) * sizeof(char *));\n"
+        "    if (argv == 0) return errno == 0 ? 1 : errno;\n"
+        "    for (int64_t i = 0; i < argc; i++) {\n"
+        "        argv[i] = (char *)(intptr_t)items[i];\n"
+        "        if (argv[i] == 0) {\n"
+        "            free(argv);\n"
+        "            return 1;\n"
+        "        }\n"
+        "    }\n"
+        "    argv[argc] = 0;\n"
+        "    pid_t pid = fork();\n"
+        "    if (pid < 0) {\n"
+        "        int err = errno == 0 ? 1 : errno;\n"
+        "        free(argv);\n"
+        "        return err;\n"
+        "    }\n"
+        "    if (pid == 0) {\n"
+        "        if (proc_redirect_path(stdout_path, STDOUT_FILENO) != 0) _exit(127);\n"
+        "        if (proc_redirect_path(stderr_path, STDERR_FILENO) != 0) _exit(127);\n"
+        "        execvp(argv[0], argv);\n"
+        "        fprintf(stderr, \"vais host proc_capture_to failed: %s: %s\\n\", argv[0], strerror(errno == 0 ? EIO : errno));\n"
+        "        _exit(127);\n"
+        "    }\n"
+        "    int status = 0;\n"
+        "    while (waitpid(pid, &status, 0) < 0) {\n"
+        "        if (errno == EINTR) continue;\n"
+        "        int err = errno == 0 ? 1 : errno;\n"
+        "        free(argv);\n"
+        "        return err;\n"
+        "    }\n"
+        "    free(argv);\n"
+        "    if (WIFEXITED(status)) return WEXITSTATUS(status);\n"
+        "    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);\n"
+        "    return 1;\n"
+        "}\n"
+        "\n"
+        "void proc_capture(int64_t *argv_buf, int64_t *out) {\n"
+        "    if (out == 0) fs_host_trap(\"proc_capture\", \"out\");\n"
+        "    char **argv = proc_argv_from_list(argv_buf);\n"
+        "    if (argv == 0) {\n"
+        "        out[0] = 1;\n"
+        "        out[1] = (int64_t)(intptr_t)fs_host_copy(\"\");\n"
+        "        out[2] = (int64_t)(intptr_t)fs_host_copy(\"\");\n"
+        "        return;\n"
+        "    }\n"
+        "    char *stdout_text = 0;\n"
+        "    char *stderr_text = 0;\n"
+        "    int64_t code = proc_capture_pipes(\"proc_capture\", argv, &stdout_text, &stderr_text);\n"
+        "    free(argv);\n"
+        "    out[0] = code;\n"
+        "    out[1] = (int64_t)(intptr_t)stdout_text;\n"
+        "    out[2] = (int64_t)(intptr_t)stderr_text;\n"
+        "}\n"
+        "\n"
+        "static int proc_apply_env(int64_t *env_buf) {\n"
+        "    if (env_buf == 0) return 0;\n"
+        "    int64_t envc = env_buf[1];\n"
+        "    int64_t *items = vais_list_items(env_buf);\n"
+        "    if (envc < 0 || (envc > 0 && items == 0)) return 1;\n"
+        "    for (int64_t i = 0; i < envc; i++) {\n"
+        "        char *entry = (char *)(intptr_t)items[i];\n"
+        "        if (entry == 0) return 1;\n"
+        "        char *eq = strchr(entry, '=');\n"
+        "        if (eq == 0 || eq == entry) return 1;\n"
+        "        size_t key_len = (size_t)(eq - entry);\n"
+        "        char *key = (char *)malloc(key_len + 1);\n"
+        "        if (key == 0) return 1;\n"
+        "        memcpy(key, entry, key_len);\n"
+        "        key[key_len] = '\\0';\n"
+        "        if (setenv(key, eq + 1, 1) != 0) {\n"
+        "            free(key);\n"
+        "            return 1;\n"
+        "        }\n"
+        "        free(key);\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "int64_t proc_run(int64_t *argv_buf) {\n"
+        "    if (argv_buf == 0) return 1;\n"
+        "    int64_t argc = argv_buf[1];\n"
+        "    int64_t *items = vais_list_items(argv_buf);\n"
+        "    if (argc <= 0 || items == 0) return 1;\n"
+        "    char **argv = (char **)malloc((size_t)(argc + 1) * sizeof(char *));\n"
+        "    if (argv == 0) return errno == 0 ? 1 : errno;\n"
+        "    for (int64_t i = 0; i < argc; i++) {\n"
+        "        argv[i] = (char *)(intptr_t)items[i];\n"
+        "        if (argv[i] == 0) {\n"
+        "            free(argv);\n"
+        "            return 1;\n"
+        "        }\n"
+        "    }\n"
+        "    argv[argc] = 0;\n"
+        "    pid_t pid = fork();\n"
+        "    if (pid < 0) {\n"
+        "        int err = errno == 0 ? 1 : errno;\n"
+        "        free(argv);\n"
+        "        return err;\n"
+        "    }\n"
+        "    if (pid == 0) {\n"
+        "        execvp(argv[0], argv);\n"
+        "        fprintf(stderr, \"vais host proc_run failed: %s: %s\\n\", argv[0], strerror(errno == 0 ? EIO : errno));\n"
+        "        _exit(127);\n"
+        "    }\n"
+        "    int status = 0;\n"
+        "    while (waitpid(pid, &status, 0) < 0) {\n"
+        "        if (errno == EINTR) continue;\n"
+        "        int err = errno == 0 ? 1 : errno;\n"
+        "        free(argv);\n"
+        "        return err;\n"
+        "    }\n"
+        "    free(argv);\n"
+        "    if (WIFEXITED(status)) return WEXITSTATUS(status);\n"
+        "    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);\n"
+        "    return 1;\n"
+        "}\n"
+        "\n"
+        "int64_t proc_run_env(int64_t *argv_buf, int64_t *env_buf) {\n"
+        "    if (argv_buf == 0) return 1;\n"
+        "    int64_t argc = argv_buf[1];\n"
+        "    int64_t *items = vais_list_items(argv_buf);\n"
+        "    if (argc <= 0 || items == 0) return 1;\n"
+        "    char **argv = (char **)malloc((size_t)(argc + 1) * sizeof(char *));\n"
+        "    if (argv == 0) return errno == 0 ? 1 : errno;\n"
+        "    for (int64_t i = 0; i < argc; i++) {\n"
+        "        argv[i] = (char *)(intptr_t)items[i];\n"
+        "        if (argv[i] == 0) {\n"
+        "            free(argv);\n"
+        "            return 1;\n"
+        "        }\n"
+        "    }\n"
+        "    argv[argc] = 0;\n"
+        "    pid_t pid = fork();\n"
+        "    if (pid < 0) {\n"
+        "        int err = errno == 0 ? 1 : errno;\n"
+        "        free(argv);\n"
+        "        return err;\n"
+        "    }\n"
+        "    if (pid == 0) {\n"
+        "        if (proc_apply_env(env_buf) != 0) _exit(127);\n"
+        "        execvp(argv[0], argv);\n"
+        "        fprintf(stderr, \"vais host proc_run_env failed: %s: %s\\n\", argv[0], strerror(errno == 0 ? EIO : errno));\n"
+        "        _exit(127);\n"
+        "    }\n"
+        "    int status = 0;\n"
+        "    while (waitpid(pid, &status, 0) < 0) {\n"
+        "        if (errno == EINTR) continue;\n"
+        "        int err = errno == 0 ? 1 : errno;\n"
+        "        free(argv);\n"
+        "        return err;\n"
+        "    }\n"
+        "    free(argv);\n"
+        "    if (WIFEXITED(status)) return WEXITSTATUS(status);\n"
+        "    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);\n"
+        "    return 1;\n"
+        "}\n"
+        "\n"
+        "/* Children started by proc_spawn. The pid is the handle; a child reaped by\n"
+        "   proc_wait_any keeps its exit code here until proc_wait collects it. */\n"
+        "typedef struct {\n"
+        "    pid_t pid;\n"
+        "    int done;\n"
+        "    int64_t code;\n"
+        "} ProcChild;\n"
+        "\n"
+        "static ProcChild *proc_children = 0;\n"
+        "static int64_t proc_children_len = 0;\n"
+        "static int64_t proc_children_cap = 0;\n"
+        "\n"
+        "static int64_t proc_child_slot(int64_t handle) {\n"
+        "    for (int64_t i = 0; i < proc_children_len; i++) {\n"
+        "        if ((int64_t)proc_children[i].pid == handle) return i;\n"
+        "    }\n"
+        "    return -1;\n"
+        "}\n"
+        "\n"
+        "/* Starts argv without waiting and returns its handle, or 0 when the child\n"
+        "   cannot be forked. Non-empty paths redirect stdout/stderr like\n"
+        "   proc_capture_to, and the same path for both shares one descriptor. An\n"
+        "   exec or redirect failure surfaces as exit code 127 from proc_wait. */\n"
+        "int64_t vais_proc_spawn_argv(char **argv, const char *stdout_path, const char *stderr_path) {\n"
+        "    if (proc_children_len == proc_children_cap) {\n"
+        "        int64_t cap = proc_children_cap == 0 ? 16 : proc_children_cap * 2;\n"
+        "        ProcChild *next = (ProcChild *)realloc(proc_children, (size_t)cap * sizeof(ProcChild));\n"
+        "        if (next == 0) return 0;\n"
+        "        proc_children = next;\n"
+        "        proc_children_cap = cap;\n"
+        "    }\n"
+        "    pid_t pid = fork();\n"
+        "    if (pid < 0) return 0;\n"
+        "    if (pid == 0) {\n"
+        "        if (proc_redirect_path(stdout_path, STDOUT_FILENO) != 0) _exit(127);\n"
+        "        if (stderr_path != 0 && stderr_path[0] != '\\0' && stdout_path != 0 && strcmp(stderr_path, stdout_path) == 0) {\n"
+        "            if (dup2(STDOUT_FILENO, STDERR_FILENO) < 0) _exit(127);\n"
+        "        } else if (proc_redirect_path(stderr_path, STDERR_FILENO) != 0) {\n"
+        "            _exit(127);\n"
+        "        }\n"
+        "        execvp(argv[0], argv);\n"
+        "        fprintf(stderr, \"vais host proc_spawn failed: %s: %s\\n\", argv[0], strerror(errno == 0 ? EIO : errno));\n"
+        "        _exit(127);\n"
+        "    }\n"
+        "    proc_children[proc_children_len].pid = pid;\n"
+        "    proc_children[proc_children_len].done = 0;\n"
+        "    proc_children[proc_children_len].code = 0;\n"
+        "    proc_children_len++;\n"
+        "    return (int64_t)pid;\n"
+        "}\n"
+        "\n"
+        "int64_t proc_spawn(int64_t *argv_buf) {\n"
+        "    char **argv = proc_argv_from_list(argv_buf);\n"
+        "    if (argv == 0) return 0;\n"
+        "    int64_t handle = vais_proc_spawn_argv(argv, 0, 0);\n"
+        "    free(argv);\n"
+        "    return handle;\n"
+        "}\n"
+        "\n"
+        "int64_t proc_spawn_to(int64_t *argv_buf, char *stdout_path, char *stderr_path) {\n"
+        "    char **argv = proc_argv_from_list(argv_buf);\n"
+        "    if (argv == 0) return 0;\n"
+        "    int64_t handle = vais_proc_spawn_argv(argv, stdout_path, stderr_path);\n"
+        "    free(argv);\n"
+        "    return handle;\n"
+        "}\n"
+        "\n"
+        "/* Blocks until the spawned child exits (or returns at once if proc_wait_any\n"
+        "   already reaped it) and returns its exit code; an unknown handle yields -1. */\n"
+        "int64_t proc_wait(int64_t handle) {\n"
+        "    int64_t slot = proc_child_slot(handle);\n"
+        "    if (slot < 0) return -1;\n"
+        "    ProcChild *child = &proc_children[slot];\n"
+        "    if (!child->done) {\n"
+        "        int status = 0;\n"
+        "        for (;;) {\n"
+        "            if (waitpid(child->pid, &status, 0) >= 0) {\n"
+        "                child->code = proc_status_code(status);\n"
+        "                break;\n"
+        "            }\n"
+        "            if (errno != EINTR) {\n"
+        "                child->code = -1;\n"
+        "                break;\n"
+        "            }\n"
+        "        }\n"
+        "    }\n"
+        "    int64_t code = child->code;\n"
+        "    proc_children[slot] = proc_children[proc_children_len - 1];\n"
+        "    proc_children_len--;\n"
+        "    return code;\n"
+        "}\n"
+        "\n"
+        "/* Blocks until any running spawned child exits and returns its handle, or 0\n"
+        "   when none is running. The exit code stays available to proc_wait. */\n"
+        "int64_t proc_wait_any(void) {\n"
+        "    for (;;) {\n"
+        "        int running = 0;\n"
+        "        for (int64_t i = 0; i < proc_children_len; i++) {\n"
+        "            if (!proc_children[i].done) running = 1;\n"
+        "        }\n"
+        "        if (!running) return 0;\n"
+        "        int status = 0;\n"
+        "        pid_t pid = waitpid(-1, &status, 0);\n"
+        "        if (pid < 0) {\n"
+        "            if (errno == EINTR) continue;\n"
+        "            return 0;\n"
+        "        }\n"
+        "        int64_t slot = proc_child_slot((int64_t)pid);\n"
+        "        if (slot < 0 || proc_children[slot].done) continue;\n"
+        "        proc_children[slot].done = 1;\n"
+        "        proc_children[slot].code = proc_status_code(status);\n"
+        "        return (int64_t)pid;\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "int64_t fs_write_text(const char *path, const char *text) {\n"
+        "    if (path == 0 || text == 0) return 1;\n"
+        "    FILE *fp = fopen(path, \"wb\");\n"
+        "    if (fp == 0) return errno == 0 ? 1 : errno;\n"
+        "    if (fputs(text, fp) < 0) {\n"
+        "        int err = errno == 0 ? 1 : errno;\n"
+        "        fclose(fp);\n"
+        "        return err;\n"
+        "    }\n"
+        "    if (fclose(fp) != 0) return errno == 0 ? 1 : errno;\n"
+        "    return 0;\n"
+        "}\n"
+        "\n"
+        "static int64_t fs_mkdir_one(const char *path) {\n"
+        "    if (path == 0 || path[0] == '\\0') return 0;\n"
+        "    if (mkdir(path, 0777) == 0) return 0;\n"
+        "    if (errno == EEXIST) {\n"
+        "        struct stat st;\n"
+        "        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) return 0;\n"
+        "        return ENOTDIR;\n"
+        "    }\n"
+        "    return errno == 0 ? 1 : errno;\n"
+        "}\n"
+        "\n"
+        "int64_t fs_mkdirs(const char *path) {\n"
+        "    if (path == 0 || path[0] == '\\0') return 1;\n"
+        "    char buf[4096];\n"
+        "    size_t len = strlen(path);\n"
+        "    if (len >= sizeof(buf)) return ENAMETOOLONG;\n"
+        "    memcpy(buf, path, len + 1);\n"
+        "    while (len > 1 && buf[len - 1] == '/') {\n"
+        "        buf[len - 1] = '\\0';\n"
+        "        len = len - 1;\n"
+        "    }\n"
+        "    for (char *p = buf + 1; *p != '\\0'; p++) {\n"
+        "        if (*p == '/') {\n"
+        "            *p = '\\0';\n"
+        "            int64_t rc = fs_mkdir_one(buf);\n"
+        "            *p = '/';\n"
+        "            if (rc != 0) return rc;\n"
+        "        }\n"
+        "    }\n"
+        "    return fs_mkdir_one(buf);\n"
+        "}\n"
+        "\n"
+        "int64_t fs_remove(char *path) {\n"
+        "    if (path == 0 || path[0] == '\\0') return 1;\n"
+        "    if (unlink(path) == 0) return 0;\n"
+        "    if (errno == ENOENT) return 0;\n"
+        "    return errno == 0 ? 1 : errno;\n"
+        "}\n";
+}
@@ -0,0 +1,565 @@
+/* Declarations shared by the vaisc driver units. */
+#ifndef VAISC_NATIVE_H
+#define VAISC_NATIVE_H
+
+#include <errno.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <utime.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define VAIS_VERSION "1.0.1"
+#define DIRECT_MAX_STRUCT_FIELDS 64
+#define DIRECT_MAX_STRUCT_LITERAL_FIELDS 64
+#define VAISC_MAX_PHASES 256
+/*
+ * `par` pipelines: `let n = par xs.map(|x| body).sum()` (or `.min()`/`.max()`,
+ * optionally after `.filter(|x| cond)`, and `return par ...`) runs the same
+ * loop as the sequential lowering, split into VAIS_PAR_CHUNK-element chunks
+ * that the runtime's forked workers claim from a shared counter. Closures
+ * must be capture-free (they read only the element, member calls, and the
+ * verified builtins) because each worker evaluates them in its own copy of
+ * the process. A `par` pipeline the lowering cannot prove capture-free is
+ * handed back without the marker and lowers sequentially.
+ */
+#define VAIS_PAR_CHUNK "1024"
+#define FRONT_CALLABLE_CAP 4096
+/*
+ * str_concat ladders are flattened into their leaves and lowered to
+ * __vais_str_concat8 calls that size the result once. Str(int) and
+ * str_byte(value) leaves travel as tagged integers (kind 1 and 2) and are
+ * formatted in place, so they allocate nothing. Past eight leaves, each call
+ * starts from the previous result.
+ */
+#define DIRECT_CONCAT_MAX_LEAVES 64
+/*
+ * `vaisc serve` listens on a Unix socket. A request is the NUL-separated
+ * fields "vaisc-serve 1", cwd, argc, argv..., then the client's environment,
+ * sent with the client's stdin/stdout/stderr attached as SCM_RIGHTS. Each
+ * connection gets a handler process that forks a worker to adopt those
+ * descriptors, directory, and environment and run the command; the reply is
+ * the worker's exit status as decimal text. Workers start from the server's
+ * pristine driver state, and the runtime objects are compiled before the
+ * first request, so requests skip driver startup and the runtime compile.
+ */
+#define SERVE_MAGIC "vaisc-serve 1"
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} StrBuf;
+
+typedef struct {
+    char **items;
+    size_t len;
+    size_t cap;
+} LineVec;
+
+typedef struct {
+    char *name;
+    char *path;
+    int line_no;
+} ModuleSymbol;
+
+typedef struct {
+    char *path;
+    char *module;
+} ModuleStackEntry;
+
+typedef struct {
+    char *alias;
+    char *source_root;
+} PackageRootInfo;
+
+/* Open-addressing index from a borrowed string key to a caller-side slot
+   number; keys must outlive the index. */
+typedef struct {
+    const char *key;
+    uint64_t hash;
+    int value;
+} StrIndexSlot;
+
+typedef struct {
+    StrIndexSlot *slots;
+    size_t cap;
+    size_t len;
+} StrIndex;
+
+typedef struct {
+    char *root;
+    PackageRootInfo *packages;
+    int package_count;
+    int package_cap;
+    PackageRootInfo *dependencies;
+    int dependency_count;
+    int dependency_cap;
+    LineVec visited;
+    StrIndex visited_index;
+    ModuleStackEntry *stack;
+    int stack_count;
+    int stack_cap;
+    ModuleSymbol *symbols;
+    int symbol_count;
+    int symbol_cap;
+    StrIndex symbol_index;
+    int prof_next;
+} ModuleResolver;
+
+typedef struct {
+    char *name;
+    int tag;
+    int field_count;
+    int field_is_struct[8];
+    int field_is_option_int[8];
+} VariantInfo;
+
+typedef struct {
+    char *name;
+    int builtin_kind;
+    int is_payload;
+    int count;
+    char *struct_names[16];
+    int struct_count;
+    VariantInfo variants[16];
+} EnumInfo;
+
+typedef struct {
+    char *maker;
+    char *apply;
+} ClosureMaker;
+
+typedef struct {
+    char *name;
+    char *fn_param;
+    char *value_param;
+    char *body;
+} ClosureHigherOrder;
+
+typedef struct {
+    char *name;
+    char *params[16];
+    char *param_types[16];
+    int param_count;
+    char *return_type;
+    int line_no;
+} DirectFnInfo;
+
+typedef struct {
+    char *name; /* interned; owned by the direct engine's intern table */
+    int name_id;
+    char *type;
+    int is_ref;
+    int concat_acc;
+    int concat_acc_depth;
+    int heap_owned; /* hoisted List whose buffer this binding frees */
+} DirectLocalInfo;
+
+/* A function's locals, in declaration order, plus an interned-name-id ->
+   item index + 1 map; removing a name unwinds it from both. */
+typedef struct {
+    DirectLocalInfo **items;
+    int count;
+    int cap;
+    int *slot_of;
+    int slot_cap;
+    char *current_return_type;
+    int temp_count;
+    StrBuf *hoist_decls;
+} DirectNameSet;
+
+/* Interned-name-id -> entry index + 1 for one function or struct table.
+   `table` and `count` name the table it describes; lookups into any other
+   table (or a stale one) fall back to a linear scan. */
+typedef struct {
+    const void *table;
+    int count;
+    int *slot_of;
+    int cap;
+} DirectNameIndex;
+
+typedef struct {
+    char *name;
+    char *fields[DIRECT_MAX_STRUCT_FIELDS];
+    char *field_types[DIRECT_MAX_STRUCT_FIELDS];
+    int field_count;
+    int line_no;
+} DirectStructInfo;
+
+/*
+ * Per-phase driver statistics for `--time-passes` / `--stats=json`. Phases
+ * nest (prepare -> each lowering pass), keep wall time, bytes in/out, and the
+ * cumulative RSS high-water mark observed when the phase ended -- vaisc's own,
+ * or for phases that spawn clang or the program, the children's -- and are
+ * reported in start order at exit.
+ */
+typedef struct {
+    const char *name;
+    int depth;
+    double start_ms;
+    double wall_ms;
+    size_t bytes_in;
+    size_t bytes_out;
+    long peak_rss_kb;
+    int children;
+} VaiscPhaseStat;
+
+/*
+ * Line-form source for the prepare pipeline. The merged module text is split
+ * once, every lowering pass reads `lines` and hands its output vector back
+ * through source_lines_replace, and the text is joined once at the end.
+ * Passes borrow `lines` by value and never grow it. The invariant is that
+ * `lines` is exactly split_lines() of the joined text, so a pass sees the
+ * same lines it would have seen after a join/split round trip; `text` caches
+ * that joined view for the few passes that still scan the whole program.
+ */
+typedef struct {
+    LineVec lines;
+    int trailing_newline;
+    char *text;
+} SourceLines;
+
+typedef struct {
+    char *name;
+    char *wrapper;
+    char *fields[DIRECT_MAX_STRUCT_FIELDS];
+    char *field_types[DIRECT_MAX_STRUCT_FIELDS];
+    int field_count;
+    int decl_start_line;
+    int decl_end_line;
+    int used;
+    int wrapper_emitted;
+} ResultStructIntInfo;
+
+typedef struct {
+    char *name;
+    char *type;
+} ListMethodLocal;
+
+typedef struct {
+    char *name;
+    char *fields[64];
+    char *field_types[64];
+    int field_count;
+} ListMethodStruct;
+
+typedef struct {
+    char *name;
+    char *param_types[16];
+    int param_count;
+    char *return_type;
+} ListMethodFnSig;
+
+typedef struct {
+    ListMethodLocal items[256];
+    int count;
+    char current_return_type[64];
+    ListMethodStruct structs[64];
+    int struct_count;
+    ListMethodFnSig fns[128];
+    int fn_count;
+} ListMethodEnv;
+
+typedef enum {
+    LIST_MAP_FILTER_SCALAR_LEN = 0,
+    LIST_MAP_FILTER_SCALAR_CONTAINS = 1,
+    LIST_MAP_FILTER_SCALAR_INDEX_OF = 2,
+    LIST_MAP_FILTER_SCALAR_COUNT = 3
+} ListMapFilterScalarKind;
+
+typedef struct {
+    char *name;
+    char *rows[16];
+    int row_count;
+} NestedListInfo;
+
+typedef struct {
+    char *name;
+    char *struct_name;
+    int arity;
+} TupleFnInfo;
+
+typedef struct {
+    TupleFnInfo items[16];
+    int count;
+    int temp_count;
+} TupleLowerInfo;
+
+typedef struct {
+    char *owner;
+    char *name;
+    char *lowered;
+} StructMethodInfo;
+
+typedef struct {
+    StructMethodInfo *method;
+    char *args;
+} StructMethodCall;
+
+typedef struct {
+    char *items[128];
+    int count;
+} SourceNameList;
+
+typedef struct {
+    char *name;
+    int line_no;
+    char *line;
+} ImportInfo;
+
+typedef struct {
+    char *alias;
+    char *path;
+    int line_no;
+    char *line;
+} PackageDependencyInfo;
+
+typedef struct {
+    char *name;
+    char *version;
+    char *source;
+    char *binary;
+    char *assets;
+    char *profile;
+    int name_line;
+    int version_line;
+    int source_line;
+    int binary_line;
+    int assets_line;
+    int profile_line;
+    char *name_text;
+    char *version_text;
+    char *source_text;
+    char *binary_text;
+    char *assets_text;
+    char *profile_text;
+    PackageDependencyInfo dependencies[32];
+    int dependency_count;
+} PackageManifestInfo;
+
+typedef struct {
+    ImportInfo *imports;
+    int import_count;
+    int import_cap;
+    ImportInfo *symbols;
+    int symbol_count;
+    int symbol_cap;
+    char *body;
+} ModuleParse;
+
+typedef struct {
+    int has_name;
+    int has_version;
+    int has_source;
+    int has_binary;
+    int has_assets;
+    int has_profile;
+    char *source;
+    int source_line;
+    char *assets;
+    int assets_line;
+} PreflightManifest;
+
+typedef struct {
+    const char *root;
+    LineVec dep_aliases;
+    LineVec dep_roots;
+    LineVec stack;
+    LineVec visited;
+    StrIndex visited_index;
+    LineVec symbols;
+    StrIndex symbol_index;
+} PreflightGraph;
+
+typedef struct {
+    char *path;
+    long long size;
+    time_t mtime;
+} BuildCacheEntry;
+
+typedef struct {
+    char *entry;
+    char *output;
+    int line_no;
+    pid_t pid;
+    int status;
+    int done;
+    char log_path[512];
+} BuildManyJob;
+
+extern const char *HOST_INTRINSIC_IR;
+extern StrBuf *direct_current_prelude;
+extern char vaisc_tmp_root[512];
+extern int vaisc_tmp_root_ready;
+extern int vaisc_tmp_counter;
+extern int vaisc_keep_tmp;
+extern int vaisc_opt_level;
+extern int vaisc_direct_runtime_split;
+extern const char *vaisc_entry_symbol;
+extern int vaisc_entry_count;
+extern int vaisc_no_cache;
+extern int vaisc_instrument;
+extern const char *vaisc_argv0;
+extern int vaisc_stats_mode;
+extern double vaisc_stats_start_ms;
+extern const char *vaisc_stats_command;
+
+/* compiler/self/vaisc_core.ll */
+extern int64_t compile(char *src);
+
+/* vaisc_util.c */
+void die_oom(void);
+void sb_init(StrBuf *sb);
+void sb_reserve(StrBuf *sb, size_t need);
+void sb_append_n(StrBuf *sb, const char *text, size_t n);
+void sb_append(StrBuf *sb, const char *text);
+char *sb_take(StrBuf *sb);
+void lines_init(LineVec *lv);
+void lines_push(LineVec *lv, char *line);
+void lines_free(LineVec *lv);
+LineVec split_lines(const char *text);
+char *join_lines(LineVec *lv, int trailing_newline);
+uint64_t str_hash64(const char *text);
+int str_index_get(const StrIndex *ix, const char *key);
+void str_index_put(StrIndex *ix, const char *key, int value);
+void str_index_free(StrIndex *ix);
+double vaisc_now_ms(void);
+int stats_phase_begin(const char *name, size_t bytes_in);
+int stats_child_phase_begin(const char *name, size_t bytes_in);
+void stats_phase_end(int index, size_t bytes_out);
+size_t stats_file_size(const char *path);
+void stats_report(void);
+void source_lines_init(SourceLines *src, const char *text);
+const char *source_lines_text(SourceLines *src);
+void source_lines_replace(SourceLines *src, LineVec *out, int trailing_newline);
+char *source_lines_take(SourceLines *src);
+void source_lines_free(SourceLines *src);
+size_t source_lines_bytes(const SourceLines *src);
+void run_source_pass(SourceLines *src, const char *name, void (*pass)(SourceLines *));
+int starts_with(const char *s, const char *prefix);
+int is_ident_start(char ch);
+int is_ident_continue(char ch);
+char *read_file(const char *path);
+int write_file_text(const char *path, const char *text);
+int has_vais_suffix(const char *path);
+char *strip_line_comment(const char *line, size_t n);
+const char *skip_ws(const char *p);
+int statement_needs_semicolon(const char *line);
+int square_depth_after_text(const char *text, int depth);
+void paren_square_depth_after_text(const char *text, int *paren_depth, int *square_depth);
+char *lower_struct_field_line(const char *line);
+char *lower_struct_one_line_fields(const char *line);
+char *replace_print_token(const char *line);
+
+/* vaisc_lower.c */
+char *trim_copy(const char *text);
+char *substr_copy(const char *start, size_t n);
+int is_string_delim_c(char ch);
+int skip_string_literal_c(const char *text, int start);
+int skip_char_literal_c(const char *text, int start);
+void sb_append_c_escaped_byte(StrBuf *out, char ch);
+int split_top_level_commas_c(const char *text, char **parts, int max_parts);
+int split_top_level_type_commas_c(const char *text, char **parts, int max_parts);
+int find_matching_paren_c(const char *text, int open_index);
+int find_matching_bracket_c(const char *text, int open_index);
+int parse_inline_match_let(const char *line, char **name, char **match_expr, char **arms_text);
+int parse_arm(const char *line, char **pattern, char **expr);
+void lower_result_str_int_lines(SourceLines *src);
+void lower_result_str_str_lines(SourceLines *src);
+void lower_result_struct_int_lines(SourceLines *src);
+int lower_split_trailing_len_call(const char *expr, char **prefix_out);
+void lower_map_str_str_get_opt_embedded_match_lines(SourceLines *src);
+void lower_enum_lines(SourceLines *src);
+char *replace_word_all(const char *text, const char *name, const char *replacement);
+void lower_closure_lines(SourceLines *src);
+void lower_list_method_lines(SourceLines *src);
+void lower_nested_list_lines(SourceLines *src);
+int tuple_line_brace_delta(const char *line);
+void lower_tuple_lines(SourceLines *src);
+int parse_trait_start_line(const char *line);
+void lower_struct_method_lines(SourceLines *src);
+void lower_generic_identity_struct_lines(SourceLines *src);
+void split_statement_lines(SourceLines *src);
+void normalize_surface_lines(SourceLines *src);
+void normalize_core_lines(SourceLines *src);
+void lower_self_recursion_lines(SourceLines *src);
+int find_col(const char *line, const char *needle);
+void report_issue(const char *path, int line_no, int col, const char *line, const char *message, const char *help, const char *fix);
+int check_option_result_generic_surface_lines(SourceLines *src, const char *path);
+int check_front_contract_lines(SourceLines *src, const char *path);
+
+/* vaisc_resolve.c */
+char *dirname_copy(const char *path);
+char *path_join2(const char *base, const char *part);
+void package_manifest_info_free(PackageManifestInfo *info);
+int profile_opt_level(const char *profile);
+int vaisc_effective_opt_level(void);
+const char *vaisc_opt_flag(void);
+void apply_manifest_profile(PackageManifestInfo *info);
+int parse_package_manifest_info(const char *manifest_path, PackageManifestInfo *info);
+char *package_manifest_source_root(const char *manifest_path, PackageManifestInfo *info);
+char *package_manifest_assets_root(const char *manifest_path, PackageManifestInfo *info);
+int path_is_directory_c(const char *path);
+int path_is_regular_file_c(const char *path);
+char *resolve_cli_source_path(const char *source);
+int package_binary_name_is_safe_c(const char *name);
+int mkdir_p_c(const char *path);
+int copy_file_text_c(const char *src, const char *dst);
+int write_package_manifest_copy(const char *manifest_path, const PackageManifestInfo *info, const char *dst);
+int copy_file_binary_c(const char *src, const char *dst);
+int copy_tree_c(const char *src, const char *dst);
+int package_create_archive(const char *output_dir, const char *binary_name, const char *version, const char *bin_path, const char *manifest_path, const char *assets_root, char **archive_path_out);
+char *resolve_module_graph_source(const char *path);
+char *resolve_module_graph_source_timed(const char *path);
+void run_vais_preflight(const char *source);
+char *prepare_source_file(const char *path);
+char *prepare_resolved_source(const char *path, char *merged);
+
+/* vaisc_direct.c */
+int find_matching_brace_c(const char *text, int open_index);
+int direct_parse_trailing_str_len(const char *expr, int pos, int *next_i, int *has_len);
+char *direct_runtime_c_text(void);
+char *direct_lower_file(const char *source);
+char *direct_lower_resolved(const char *source, char *merged);
+int direct_emit_ir_text(const char *c_src, const char *out_path, const char *clang);
+int direct_emit_ir_file(const char *source, const char *out_path, const char *clang);
+char *compile_to_buffer(char *prepared, const char *entry, size_t *out_len);
+int compile_to_stream(char *prepared);
+int compile_to_file(char *prepared, const char *out_path);
+
+/* vaisc_host_runtime.c */
+const char *host_runtime_c_text(void);
+
+/* vaisc_build.c */
+int run_program_wait(char *const argv[]);
+int run_program_feed(char *const argv[], const char *data, size_t len);
+uint64_t runtime_cache_hash(uint64_t h, const char *text);
+int vaisc_cache_disabled(void);
+char *vaisc_cache_root(void);
+int cache_mkdirs(const char *path);
+int runtime_cache_object(const char *clang, const char *name, const char *text, int lto, char *out, size_t outlen);
+int clang_build(const char *clang, const char *lang, const char *text, size_t len, const char *out_path);
+void runtime_cache_warm(const char *clang);
+void append_self_identity(StrBuf *sb);
+int build_cache_paths(const char *entry, const char *merged, const char *engine, const char *clang, char *bin, size_t bin_len, char *ir, size_t ir_len);
+int build_cache_fetch(const char *bin, const char *ir, const char *output, const char *ir_out);
+void build_cache_evict(const char *dir);
+void build_cache_store(const char *bin, const char *ir, const char *output, const char *ir_path);
+int make_tmp_path(char *buf, size_t buflen, const char *suffix);
+void set_keep_tmp(void);
+
+#endif
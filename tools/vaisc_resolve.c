@@ -0,0 +1,2790 @@
+/* Module graph resolution, manifests, and source preparation. */
+#include "vaisc_native.h"
+
+static int linevec_contains(LineVec *lv, const char *text);
+static char *module_resolver_load(ModuleResolver *r, const char *path, const char *issue_path, int issue_line, const char *issue_text);
+static int preflight_check_manifest(const char *path, LineVec *stack, const char *entry_path);
+static int preflight_check_file(PreflightGraph *g, const char *path);
+
+char *dirname_copy(const char *path) {
+    const char *slash = strrchr(path, '/');
+    if (slash == NULL) return strdup(".");
+    if (slash == path) return strdup("/");
+    return substr_copy(path, (size_t)(slash - path));
+}
+
+static char *canonical_existing_path(const char *path) {
+    char resolved[4096];
+    if (realpath(path, resolved) == NULL) return NULL;
+    return strdup(resolved);
+}
+
+char *path_join2(const char *base, const char *part) {
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, base);
+    if (base[0] != '\0' && base[strlen(base) - 1] != '/') sb_append(&out, "/");
+    sb_append(&out, part);
+    return sb_take(&out);
+}
+
+static const char *path_basename_ptr(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash == NULL ? path : slash + 1;
+}
+
+static int str_ends_with(const char *s, const char *suffix) {
+    size_t slen = strlen(s);
+    size_t suffix_len = strlen(suffix);
+    return slen >= suffix_len && strcmp(s + slen - suffix_len, suffix) == 0;
+}
+
+static int is_repo_self_host_tier_path(const char *resolved) {
+    return str_ends_with(resolved, "/compiler/self/fixpoint.vais") ||
+        str_ends_with(resolved, "/compiler/self/fixpoint2.vais") ||
+        str_ends_with(resolved, "/compiler/self/fixpoint3.vais") ||
+        str_ends_with(resolved, "/compiler/self/fixpoint_full.vais");
+}
+
+static int trust_root_matches_source(const char *resolved, const char *source_name, const char *raw_root) {
+    if (raw_root == NULL || raw_root[0] == '\0') return 0;
+    char *compiler_dir = path_join2(raw_root, "compiler/self");
+    char *trusted_path = path_join2(compiler_dir, source_name);
+    char *trusted_real = canonical_existing_path(trusted_path);
+    int ok = trusted_real != NULL && strcmp(resolved, trusted_real) == 0;
+    free(compiler_dir);
+    free(trusted_path);
+    free(trusted_real);
+    return ok;
+}
+
+static int is_trusted_self_host_source(const char *path) {
+    char *resolved = canonical_existing_path(path);
+    if (resolved == NULL) return 0;
+    if (is_repo_self_host_tier_path(resolved)) {
+        free(resolved);
+        return 1;
+    }
+
+    const char *env = getenv("VAISC_SELF_HOST_TRUST_ROOTS");
+    if (env == NULL || env[0] == '\0') {
+        free(resolved);
+        return 0;
+    }
+
+    const char *source_name = path_basename_ptr(resolved);
+    char *roots = strdup(env);
+    if (roots == NULL) die_oom();
+    int ok = 0;
+    char *cursor = roots;
+    while (cursor != NULL && ok == 0) {
+        char *next = strchr(cursor, ':');
+        if (next != NULL) {
+            *next = '\0';
+            next++;
+        }
+        if (trust_root_matches_source(resolved, source_name, cursor)) ok = 1;
+        cursor = next;
+    }
+    free(roots);
+    free(resolved);
+    return ok;
+}
+
+static char *strip_manifest_comment_c(const char *line) {
+    StrBuf out;
+    sb_init(&out);
+    int in_string = 0;
+    int escaped = 0;
+    for (const char *p = line; *p != '\0'; p++) {
+        char ch = *p;
+        if (escaped) {
+            sb_append_n(&out, &ch, 1);
+            escaped = 0;
+            continue;
+        }
+        if (ch == '\\' && in_string) {
+            sb_append_n(&out, &ch, 1);
+            escaped = 1;
+            continue;
+        }
+        if (ch == '"') {
+            in_string = !in_string;
+            sb_append_n(&out, &ch, 1);
+            continue;
+        }
+        if (ch == '#' && !in_string) break;
+        sb_append_n(&out, &ch, 1);
+    }
+    return sb_take(&out);
+}
+
+static int parse_manifest_assignment_c(const char *code, char **key_out, char **value_out) {
+    const char *s = skip_ws(code);
+    if (!is_ident_start(*s)) return 0;
+    const char *key_start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *key_end = s;
+    s = skip_ws(s);
+    if (*s != '=') return 0;
+    s = skip_ws(s + 1);
+    if (*s != '"') return 0;
+    s++;
+    const char *value_start = s;
+    while (*s != '\0' && *s != '"') s++;
+    if (*s != '"') return 0;
+    const char *value_end = s;
+    s = skip_ws(s + 1);
+    if (*s != '\0') return 0;
+    *key_out = substr_copy(key_start, (size_t)(key_end - key_start));
+    *value_out = substr_copy(value_start, (size_t)(value_end - value_start));
+    return 1;
+}
+
+static char *parse_manifest_section_c(const char *code) {
+    const char *s = skip_ws(code);
+    if (*s != '[') return NULL;
+    s++;
+    if (!is_ident_start(*s)) return NULL;
+    const char *start = s;
+    s++;
+    while (is_ident_continue(*s)) s++;
+    const char *end = s;
+    s = skip_ws(s);
+    if (*s != ']') return NULL;
+    s = skip_ws(s + 1);
+    if (*s != '\0') return NULL;
+    return substr_copy(start, (size_t)(end - start));
+}
+
+static int package_source_path_is_safe_c(const char *value) {
+    if (value[0] == '\0' || value[0] == '/' || strchr(value, '\\') != NULL) return 0;
+    const char *p = value;
+    while (*p != '\0') {
+        const char *start = p;
+        while (*p != '\0' && *p != '/') p++;
+        size_t n = (size_t)(p - start);
+        if (n == 0) return 0;
+        if (n == 2 && start[0] == '.' && start[1] == '.') return 0;
+        if (*p == '/') p++;
+    }
+    return 1;
+}
+
+static int package_dependency_path_is_safe_c(const char *value) {
+    if (value[0] == '\0' || value[0] == '/' || strchr(value, '\\') != NULL || strchr(value, ':') != NULL) return 0;
+    const char *p = value;
+    while (*p != '\0') {
+        const char *start = p;
+        while (*p != '\0' && *p != '/') p++;
+        if (p == start) return 0;
+        if (*p == '/') p++;
+    }
+    return 1;
+}
+
+static int canonical_path_is_under(const char *path, const char *root) {
+    if (strcmp(path, root) == 0) return 1;
+    size_t n = strlen(root);
+    if (strcmp(root, "/") == 0) return path[0] == '/';
+    return strncmp(path, root, n) == 0 && path[n] == '/';
+}
+
+void package_manifest_info_free(PackageManifestInfo *info) {
+    free(info->name);
+    free(info->version);
+    free(info->source);
+    free(info->binary);
+    free(info->assets);
+    free(info->profile);
+    free(info->name_text);
+    free(info->version_text);
+    free(info->source_text);
+    free(info->binary_text);
+    free(info->assets_text);
+    free(info->profile_text);
+    for (int i = 0; i < info->dependency_count; i++) {
+        free(info->dependencies[i].alias);
+        free(info->dependencies[i].path);
+        free(info->dependencies[i].line);
+    }
+}
+
+int profile_opt_level(const char *profile) {
+    if (strcmp(profile, "debug") == 0) return 0;
+    if (strcmp(profile, "release") == 0) return 2;
+    return -1;
+}
+
+int vaisc_effective_opt_level(void) {
+    return vaisc_opt_level < 0 ? 0 : vaisc_opt_level;
+}
+
+const char *vaisc_opt_flag(void) {
+    static const char *const flags[] = {"-O0", "-O1", "-O2", "-O3"};
+    return flags[vaisc_effective_opt_level()];
+}
+
+void apply_manifest_profile(PackageManifestInfo *info) {
+    if (vaisc_opt_level < 0 && info->profile != NULL) vaisc_opt_level = profile_opt_level(info->profile);
+}
+
+static int set_manifest_key(
+    PackageManifestInfo *info,
+    const char *manifest_path,
+    int line_no,
+    const char *line,
+    const char *key,
+    char *value
+) {
+    char **slot = NULL;
+    int *line_slot = NULL;
+    char **text_slot = NULL;
+    if (strcmp(key, "name") == 0) {
+        slot = &info->name;
+        line_slot = &info->name_line;
+        text_slot = &info->name_text;
+    } else if (strcmp(key, "version") == 0) {
+        slot = &info->version;
+        line_slot = &info->version_line;
+        text_slot = &info->version_text;
+    } else if (strcmp(key, "source") == 0) {
+        slot = &info->source;
+        line_slot = &info->source_line;
+        text_slot = &info->source_text;
+    } else if (strcmp(key, "binary") == 0) {
+        slot = &info->binary;
+        line_slot = &info->binary_line;
+        text_slot = &info->binary_text;
+    } else if (strcmp(key, "assets") == 0) {
+        slot = &info->assets;
+        line_slot = &info->assets_line;
+        text_slot = &info->assets_text;
+    } else if (strcmp(key, "profile") == 0) {
+        slot = &info->profile;
+        line_slot = &info->profile_line;
+        text_slot = &info->profile_text;
+    } else {
+        report_issue(manifest_path, line_no, 1, line,
+            "unsupported package manifest key",
+            "use only top-level `name`, `version`, `source`, optional `binary`, optional `assets`, and optional `profile`; put local packages under `[dependencies]`.",
+            NULL);
+        free(value);
+        return 1;
+    }
+    if (*slot != NULL) {
+        StrBuf msg;
+        sb_init(&msg);
+        sb_append(&msg, "duplicate package manifest key `");
+        sb_append(&msg, key);
+        sb_append(&msg, "`");
+        report_issue(manifest_path, line_no, 1, line, msg.data,
+            "keep exactly one `name`, one `version`, one `source`, at most one `binary`, at most one `assets`, and at most one `profile` key.",
+            NULL);
+        free(msg.data);
+        free(value);
+        return 1;
+    }
+    *slot = value;
+    *line_slot = line_no;
+    *text_slot = strdup(line);
+    if (*text_slot == NULL) die_oom();
+    return 0;
+}
+
+static int add_manifest_dependency(
+    PackageManifestInfo *info,
+    const char *manifest_path,
+    int line_no,
+    const char *line,
+    char *alias,
+    char *path
+) {
+    for (int i = 0; i < info->dependency_count; i++) {
+        if (strcmp(info->dependencies[i].alias, alias) == 0) {
+            StrBuf msg;
+            sb_init(&msg);
+            sb_append(&msg, "duplicate local dependency alias `");
+            sb_append(&msg, alias);
+            sb_append(&msg, "`");
+            report_issue(manifest_path, line_no, 1, line, msg.data,
+                "keep exactly one path for each local dependency alias.",
+                NULL);
+            free(msg.data);
+            free(alias);
+            free(path);
+            return 1;
+        }
+    }
+    if (info->dependency_count >= 32) {
+        report_issue(manifest_path, line_no, 1, line,
+            "too many local dependencies in package manifest",
+            "split the package or reduce dependencies in this first package slice.",
+            NULL);
+        free(alias);
+        free(path);
+        return 1;
+    }
+    PackageDependencyInfo *dep = &info->dependencies[info->dependency_count++];
+    dep->alias = alias;
+    dep->path = path;
+    dep->line_no = line_no;
+    dep->line = strdup(line);
+    if (dep->line == NULL) die_oom();
+    return 0;
+}
+
+int parse_package_manifest_info(const char *manifest_path, PackageManifestInfo *info) {
+    memset(info, 0, sizeof(*info));
+    char *raw = read_file(manifest_path);
+    if (raw == NULL) return 1;
+    LineVec lines = split_lines(raw);
+    int failed = 0;
+    int section = 0;
+    for (size_t i = 0; i < lines.len && !failed; i++) {
+        const char *line = lines.items[i];
+        char *code = strip_manifest_comment_c(line);
+        if (strlen(skip_ws(code)) == 0) {
+            free(code);
+            continue;
+        }
+        char *section_name = parse_manifest_section_c(code);
+        if (section_name != NULL) {
+            if (strcmp(section_name, "dependencies") != 0) {
+                StrBuf msg;
+                sb_init(&msg);
+                sb_append(&msg, "unsupported package manifest section `[");
+                sb_append(&msg, section_name);
+                sb_append(&msg, "]`");
+                report_issue(manifest_path, (int)i + 1, 1, line, msg.data,
+                    "only the `[dependencies]` section is supported in this package manifest slice.",
+                    NULL);
+                free(msg.data);
+                failed = 1;
+            } else {
+                section = 1;
+            }
+            free(section_name);
+            free(code);
+            continue;
+        }
+        char *key = NULL;
+        char *value = NULL;
+        if (!parse_manifest_assignment_c(code, &key, &value)) {
+            report_issue(manifest_path, (int)i + 1, 1, line,
+                "invalid package manifest entry",
+                "write top-level string keys `name`, `version`, `source`, optional `binary`, optional `assets`, plus optional `[dependencies]` string entries.",
+                NULL);
+            failed = 1;
+            free(code);
+            break;
+        }
+        if (section == 1) {
+            failed = add_manifest_dependency(info, manifest_path, (int)i + 1, line, key, value);
+        } else {
+            failed = set_manifest_key(info, manifest_path, (int)i + 1, line, key, value);
+            free(key);
+        }
+        free(code);
+    }
+
+    const char *first_line = lines.len > 0 ? lines.items[0] : "";
+    const char *missing_key = NULL;
+    if (!failed && info->name == NULL) missing_key = "name";
+    else if (!failed && info->version == NULL) missing_key = "version";
+    else if (!failed && info->source == NULL) missing_key = "source";
+    if (missing_key != NULL) {
+        StrBuf msg;
+        sb_init(&msg);
+        sb_append(&msg, "package manifest is missing required key `");
+        sb_append(&msg, missing_key);
+        sb_append(&msg, "`");
+        report_issue(manifest_path, 1, 1, first_line, msg.data,
+            "write `name`, `version`, and `source` before compiling this package.",
+            NULL);
+        free(msg.data);
+        failed = 1;
+    }
+
+    if (!failed && !package_source_path_is_safe_c(info->source)) {
+        report_issue(manifest_path, info->source_line, 1, info->source_text,
+            "package manifest source must be a local relative path",
+            "use a source path such as `src`; absolute paths and `..` are not supported.",
+            NULL);
+        failed = 1;
+    }
+    if (!failed && info->profile != NULL && profile_opt_level(info->profile) < 0) {
+        report_issue(manifest_path, info->profile_line, 1, info->profile_text,
+            "package manifest profile must be `debug` or `release`",
+            "use `profile = \"release\"` for optimized package builds or `profile = \"debug\"` for the default.",
+            NULL);
+        failed = 1;
+    }
+    if (!failed && info->assets != NULL && !package_source_path_is_safe_c(info->assets)) {
+        report_issue(manifest_path, info->assets_line, 1, info->assets_text,
+            "package manifest assets must be a local relative path",
+            "use an assets path such as `assets`; absolute paths and `..` are not supported.",
+            NULL);
+        failed = 1;
+    }
+
+    lines_free(&lines);
+    free(raw);
+    return failed;
+}
+
+static char *find_package_manifest_path(const char *start_dir) {
+    char *current = canonical_existing_path(start_dir);
+    if (current == NULL) current = strdup(start_dir);
+    if (current == NULL) die_oom();
+    while (1) {
+        char *candidate = path_join2(current, "vais.toml");
+        if (access(candidate, R_OK) == 0) {
+            free(current);
+            return candidate;
+        }
+        free(candidate);
+        char *parent = dirname_copy(current);
+        if (strcmp(parent, current) == 0) {
+            free(parent);
+            free(current);
+            return NULL;
+        }
+        free(current);
+        current = parent;
+    }
+}
+
+static void linevec_pop(LineVec *lv) {
+    if (lv->len == 0) return;
+    lv->len--;
+    free(lv->items[lv->len]);
+    lv->items[lv->len] = NULL;
+}
+
+char *package_manifest_source_root(const char *manifest_path, PackageManifestInfo *info) {
+    char *manifest_dir = dirname_copy(manifest_path);
+    char *raw_source_root = path_join2(manifest_dir, info->source);
+    char *source_root = canonical_existing_path(raw_source_root);
+    if (source_root == NULL) {
+        StrBuf help;
+        sb_init(&help);
+        sb_append(&help, "create the source directory at ");
+        sb_append(&help, raw_source_root);
+        sb_append(&help, " or update `source`.");
+        report_issue(manifest_path, info->source_line, 1, info->source_text,
+            "package manifest source directory not found", help.data, NULL);
+        free(help.data);
+    }
+    free(raw_source_root);
+    free(manifest_dir);
+    return source_root;
+}
+
+char *package_manifest_assets_root(const char *manifest_path, PackageManifestInfo *info) {
+    if (info->assets == NULL) return NULL;
+    char *manifest_dir = dirname_copy(manifest_path);
+    char *assets_root = path_join2(manifest_dir, info->assets);
+    free(manifest_dir);
+    struct stat st;
+    if (stat(assets_root, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        StrBuf help;
+        sb_init(&help);
+        sb_append(&help, "create the assets directory at ");
+        sb_append(&help, assets_root);
+        sb_append(&help, " or remove `assets` from the manifest.");
+        report_issue(manifest_path, info->assets_line, 1, info->assets_text,
+            "package manifest assets directory not found", help.data, NULL);
+        free(help.data);
+        free(assets_root);
+        return NULL;
+    }
+    return assets_root;
+}
+
+int path_is_directory_c(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+int path_is_regular_file_c(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static char *resolve_cli_package_entry(const char *source) {
+    char *manifest_path = path_join2(source, "vais.toml");
+    if (path_is_regular_file_c(manifest_path)) {
+        PackageManifestInfo info;
+        if (parse_package_manifest_info(manifest_path, &info) != 0) {
+            package_manifest_info_free(&info);
+            free(manifest_path);
+            return NULL;
+        }
+        apply_manifest_profile(&info);
+        char *source_root = package_manifest_source_root(manifest_path, &info);
+        if (source_root == NULL) {
+            package_manifest_info_free(&info);
+            free(manifest_path);
+            return NULL;
+        }
+        char *entry = path_join2(source_root, "main.vais");
+        if (!path_is_regular_file_c(entry)) {
+            StrBuf help;
+            sb_init(&help);
+            sb_append(&help, "create ");
+            sb_append(&help, entry);
+            sb_append(&help, " or compile an explicit `.vais` entry file.");
+            report_issue(manifest_path, info.source_line, 1, info.source_text,
+                "package directory entry `main.vais` not found", help.data, NULL);
+            free(help.data);
+            free(entry);
+            entry = NULL;
+        }
+        free(source_root);
+        package_manifest_info_free(&info);
+        free(manifest_path);
+        return entry;
+    }
+    free(manifest_path);
+
+    char *entry = path_join2(source, "main.vais");
+    if (!path_is_regular_file_c(entry)) {
+        fprintf(stderr, "error: package directory entry not found: %s\n", entry);
+        fprintf(stderr, "help: add main.vais, or add vais.toml with source = \"src\" and src/main.vais.\n");
+        free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+char *resolve_cli_source_path(const char *source) {
+    if (!path_is_directory_c(source)) {
+        char *copy = strdup(source);
+        if (copy == NULL) die_oom();
+        return copy;
+    }
+    return resolve_cli_package_entry(source);
+}
+
+int package_binary_name_is_safe_c(const char *name) {
+    if (name == NULL || name[0] == '\0') return 0;
+    if (name[0] == '.' || name[0] == '-') return 0;
+    for (const char *p = name; *p != '\0'; p++) {
+        char ch = *p;
+        if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '-' || ch == '.') {
+            continue;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+static char *package_archive_root_name(const char *binary_name, const char *version) {
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, binary_name);
+    sb_append(&out, "-");
+    sb_append(&out, version);
+    return sb_take(&out);
+}
+
+int mkdir_p_c(const char *path) {
+    if (path == NULL || path[0] == '\0') return 1;
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s", path) >= (int)sizeof(tmp)) {
+        fprintf(stderr, "error: output path too long: %s\n", path);
+        return 1;
+    }
+    size_t len = strlen(tmp);
+    while (len > 1 && tmp[len - 1] == '/') {
+        tmp[len - 1] = '\0';
+        len--;
+    }
+    for (char *p = tmp + 1; *p != '\0'; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (tmp[0] != '\0' && mkdir(tmp, 0777) != 0 && errno != EEXIST) {
+            fprintf(stderr, "error: cannot create directory %s: %s\n", tmp, strerror(errno));
+            *p = '/';
+            return 1;
+        }
+        *p = '/';
+    }
+    if (mkdir(tmp, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "error: cannot create directory %s: %s\n", tmp, strerror(errno));
+        return 1;
+    }
+    if (!path_is_directory_c(tmp)) {
+        fprintf(stderr, "error: output path exists but is not a directory: %s\n", tmp);
+        return 1;
+    }
+    return 0;
+}
+
+int copy_file_text_c(const char *src, const char *dst) {
+    char *text = read_file(src);
+    if (text == NULL) return 1;
+    int rc = write_file_text(dst, text);
+    free(text);
+    return rc;
+}
+
+/* Copies a package manifest into a dist tree with `profile` set to the one the
+   package was built with, replacing the manifest's own line or adding one
+   after the last top-level key. An opt level that is not the profile's default
+   (say -O3 or -O1) is noted in a trailing comment. */
+int write_package_manifest_copy(const char *manifest_path, const PackageManifestInfo *info, const char *dst) {
+    char *raw = read_file(manifest_path);
+    if (raw == NULL) return 1;
+    int level = vaisc_effective_opt_level();
+    const char *profile = level == 0 ? "debug" : "release";
+    StrBuf entry;
+    sb_init(&entry);
+    sb_append(&entry, "profile = \"");
+    sb_append(&entry, profile);
+    sb_append(&entry, "\"");
+    if (level != profile_opt_level(profile)) {
+        sb_append(&entry, "  # built at ");
+        sb_append(&entry, vaisc_opt_flag());
+    }
+    LineVec lines = split_lines(raw);
+    size_t at = 0;
+    for (size_t i = 0; i < lines.len && skip_ws(lines.items[i])[0] != '['; i++) {
+        if (info->profile != NULL && (int)i + 1 == info->profile_line) at = i;
+        else if (info->profile == NULL && skip_ws(lines.items[i])[0] != '\0') at = i + 1;
+    }
+    LineVec out;
+    lines_init(&out);
+    for (size_t i = 0; i < lines.len; i++) {
+        if (i == at) lines_push(&out, strdup(entry.data));
+        if (info->profile == NULL || (int)i + 1 != info->profile_line) lines_push(&out, strdup(lines.items[i]));
+    }
+    if (at == lines.len) lines_push(&out, strdup(entry.data));
+    char *text = join_lines(&out, 1);
+    int rc = write_file_text(dst, text);
+    free(text);
+    lines_free(&out);
+    lines_free(&lines);
+    free(entry.data);
+    free(raw);
+    return rc;
+}
+
+int copy_file_binary_c(const char *src, const char *dst) {
+    struct stat st;
+    if (stat(src, &st) != 0) {
+        fprintf(stderr, "error: cannot stat %s: %s\n", src, strerror(errno));
+        return 1;
+    }
+    FILE *in = fopen(src, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "error: cannot open %s: %s\n", src, strerror(errno));
+        return 1;
+    }
+    FILE *out = fopen(dst, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "error: cannot write %s: %s\n", dst, strerror(errno));
+        fclose(in);
+        return 1;
+    }
+    char buf[65536];
+    int rc = 0;
+    while (1) {
+        size_t n = fread(buf, 1, sizeof(buf), in);
+        if (n > 0 && fwrite(buf, 1, n, out) != n) {
+            fprintf(stderr, "error: cannot write %s: %s\n", dst, strerror(errno));
+            rc = 1;
+            break;
+        }
+        if (n < sizeof(buf)) {
+            if (ferror(in)) {
+                fprintf(stderr, "error: cannot read %s: %s\n", src, strerror(errno));
+                rc = 1;
+            }
+            break;
+        }
+    }
+    if (fclose(out) != 0) {
+        fprintf(stderr, "error: cannot close %s: %s\n", dst, strerror(errno));
+        rc = 1;
+    }
+    if (fclose(in) != 0) {
+        fprintf(stderr, "error: cannot close %s: %s\n", src, strerror(errno));
+        rc = 1;
+    }
+    if (rc == 0 && chmod(dst, st.st_mode & 0777) != 0) {
+        fprintf(stderr, "error: cannot chmod %s: %s\n", dst, strerror(errno));
+        rc = 1;
+    }
+    return rc;
+}
+
+int copy_tree_c(const char *src, const char *dst) {
+    struct stat st;
+    if (lstat(src, &st) != 0) {
+        fprintf(stderr, "error: cannot stat %s: %s\n", src, strerror(errno));
+        return 1;
+    }
+    if (S_ISREG(st.st_mode)) return copy_file_binary_c(src, dst);
+    if (!S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "error: package assets support regular files and directories only: %s\n", src);
+        return 1;
+    }
+    if (mkdir_p_c(dst) != 0) return 1;
+    DIR *dir = opendir(src);
+    if (dir == NULL) {
+        fprintf(stderr, "error: cannot open directory %s: %s\n", src, strerror(errno));
+        return 1;
+    }
+    int rc = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        char *src_child = path_join2(src, entry->d_name);
+        char *dst_child = path_join2(dst, entry->d_name);
+        rc = copy_tree_c(src_child, dst_child);
+        free(src_child);
+        free(dst_child);
+        if (rc != 0) break;
+    }
+    closedir(dir);
+    if (rc == 0 && chmod(dst, st.st_mode & 0777) != 0) {
+        fprintf(stderr, "error: cannot chmod %s: %s\n", dst, strerror(errno));
+        rc = 1;
+    }
+    return rc;
+}
+
+int package_create_archive(
+    const char *output_dir,
+    const char *binary_name,
+    const char *version,
+    const char *bin_path,
+    const char *manifest_path,
+    const char *assets_root,
+    char **archive_path_out
+) {
+    *archive_path_out = NULL;
+    char stage_root[512];
+    if (make_tmp_path(stage_root, sizeof(stage_root), "package-archive") != 0) return 1;
+    if (mkdir_p_c(stage_root) != 0) return 1;
+
+    char *archive_root_name = package_archive_root_name(binary_name, version);
+    StrBuf archive_file_name;
+    sb_init(&archive_file_name);
+    sb_append(&archive_file_name, archive_root_name);
+    sb_append(&archive_file_name, ".tar.gz");
+    char *archive_path = path_join2(output_dir, archive_file_name.data);
+
+    char *stage_package_root = path_join2(stage_root, archive_root_name);
+    char *stage_bin_dir = path_join2(stage_package_root, "bin");
+    char *stage_bin_path = path_join2(stage_bin_dir, binary_name);
+    char *stage_manifest_path = path_join2(stage_package_root, "vais.toml");
+    char *stage_assets_path = path_join2(stage_package_root, "assets");
+
+    int rc = mkdir_p_c(stage_bin_dir);
+    if (rc == 0) rc = copy_file_binary_c(bin_path, stage_bin_path);
+    if (rc == 0) rc = copy_file_text_c(manifest_path, stage_manifest_path);
+    if (rc == 0 && assets_root != NULL) rc = copy_tree_c(assets_root, stage_assets_path);
+    if (rc == 0) {
+        char *const tar_argv[] = {
+            "tar",
+            "-C",
+            stage_root,
+            "-czf",
+            archive_path,
+            archive_root_name,
+            NULL
+        };
+        rc = run_program_wait(tar_argv);
+        if (rc != 0) {
+            fprintf(stderr, "error: tar failed while creating package archive\n");
+            rc = 1;
+        }
+    }
+    if (rc == 0) {
+        *archive_path_out = archive_path;
+    } else {
+        free(archive_path);
+    }
+    free(archive_file_name.data);
+    free(stage_assets_path);
+    free(stage_manifest_path);
+    free(stage_bin_path);
+    free(stage_bin_dir);
+    free(stage_package_root);
+    free(archive_root_name);
+    return rc;
+}
+
+static int module_resolver_add_package_root(ModuleResolver *r, const char *alias, const char *source_root) {
+    for (int i = 0; i < r->package_count; i++) {
+        if (strcmp(r->packages[i].source_root, source_root) == 0) return 0;
+    }
+    if (r->package_count == r->package_cap) {
+        r->package_cap = r->package_cap == 0 ? 16 : r->package_cap * 2;
+        r->packages = (PackageRootInfo *)realloc(r->packages, (size_t)r->package_cap * sizeof(PackageRootInfo));
+        if (r->packages == NULL) die_oom();
+    }
+    PackageRootInfo *item = &r->packages[r->package_count++];
+    item->alias = strdup(alias);
+    item->source_root = strdup(source_root);
+    if (item->alias == NULL || item->source_root == NULL) die_oom();
+    return 0;
+}
+
+static int module_resolver_add_dependency_root(
+    ModuleResolver *r,
+    const char *issue_path,
+    int issue_line,
+    const char *issue_text,
+    const char *alias,
+    const char *source_root
+) {
+    for (int i = 0; i < r->dependency_count; i++) {
+        if (strcmp(r->dependencies[i].alias, alias) == 0) {
+            if (strcmp(r->dependencies[i].source_root, source_root) == 0) return 0;
+            StrBuf msg;
+            sb_init(&msg);
+            sb_append(&msg, "duplicate local dependency alias `");
+            sb_append(&msg, alias);
+            sb_append(&msg, "`");
+            report_issue(issue_path, issue_line > 0 ? issue_line : 1, 1, issue_text ? issue_text : "", msg.data,
+                "use distinct dependency aliases across the loaded package graph.",
+                NULL);
+            free(msg.data);
+            return 1;
+        }
+    }
+    if (r->dependency_count == r->dependency_cap) {
+        r->dependency_cap = r->dependency_cap == 0 ? 16 : r->dependency_cap * 2;
+        r->dependencies = (PackageRootInfo *)realloc(r->dependencies, (size_t)r->dependency_cap * sizeof(PackageRootInfo));
+        if (r->dependencies == NULL) die_oom();
+    }
+    PackageRootInfo *item = &r->dependencies[r->dependency_count++];
+    item->alias = strdup(alias);
+    item->source_root = strdup(source_root);
+    if (item->alias == NULL || item->source_root == NULL) die_oom();
+    return 0;
+}
+
+static char *package_dependency_cycle_help(LineVec *stack, const char *next_manifest) {
+    StrBuf help;
+    sb_init(&help);
+    sb_append(&help, "remove one dependency from the cycle: ");
+    for (size_t i = 0; i < stack->len; i++) {
+        if (i > 0) sb_append(&help, " -> ");
+        sb_append(&help, stack->items[i]);
+    }
+    sb_append(&help, " -> ");
+    sb_append(&help, next_manifest);
+    sb_append(&help, ".");
+    return sb_take(&help);
+}
+
+static int module_resolver_collect_manifest(
+    ModuleResolver *r,
+    const char *manifest_path,
+    const char *alias,
+    const char *entry_path,
+    const char *issue_path,
+    int issue_line,
+    const char *issue_text,
+    LineVec *stack
+) {
+    char *manifest_real = canonical_existing_path(manifest_path);
+    if (manifest_real == NULL) manifest_real = strdup(manifest_path);
+    if (manifest_real == NULL) die_oom();
+    lines_push(stack, strdup(manifest_real));
+    if (stack->items[stack->len - 1] == NULL) die_oom();
+
+    PackageManifestInfo info;
+    if (parse_package_manifest_info(manifest_real, &info) != 0) {
+        package_manifest_info_free(&info);
+        linevec_pop(stack);
+        free(manifest_real);
+        return 1;
+    }
+
+    int failed = 0;
+    char *source_root = package_manifest_source_root(manifest_real, &info);
+    if (source_root == NULL) {
+        failed = 1;
+    }
+    if (!failed && r->root == NULL) {
+        r->root = strdup(source_root);
+        if (r->root == NULL) die_oom();
+    }
+    if (!failed && entry_path != NULL) {
+        char *entry_real = canonical_existing_path(entry_path);
+        if (entry_real == NULL || !canonical_path_is_under(entry_real, source_root)) {
+            StrBuf help;
+            sb_init(&help);
+            sb_append(&help, "compile a `.vais` file under ");
+            sb_append(&help, source_root);
+            sb_append(&help, " or update `source`.");
+            report_issue(manifest_real, info.source_line, 1, info.source_text,
+                "package entry is outside manifest source root", help.data, NULL);
+            free(help.data);
+            failed = 1;
+        }
+        free(entry_real);
+    }
+    if (!failed) failed = module_resolver_add_package_root(r, alias, source_root);
+    if (!failed && alias[0] != '\0') {
+        failed = module_resolver_add_dependency_root(
+            r,
+            issue_path ? issue_path : manifest_real,
+            issue_line,
+            issue_text,
+            alias,
+            source_root);
+    }
+
+    char *manifest_dir = dirname_copy(manifest_real);
+    for (int i = 0; i < info.dependency_count && !failed; i++) {
+        PackageDependencyInfo *dep = &info.dependencies[i];
+        if (!package_dependency_path_is_safe_c(dep->path)) {
+            report_issue(manifest_real, dep->line_no, 1, dep->line,
+                "local dependency path must be a relative local path",
+                "use a path such as `../mathlib`; absolute paths, URLs, and empty segments are not supported.",
+                NULL);
+            failed = 1;
+            break;
+        }
+        char *dep_dir = path_join2(manifest_dir, dep->path);
+        char *dep_manifest_raw = path_join2(dep_dir, "vais.toml");
+        char *dep_manifest = canonical_existing_path(dep_manifest_raw);
+        if (dep_manifest == NULL) {
+            StrBuf help;
+            sb_init(&help);
+            sb_append(&help, "expected local dependency manifest at ");
+            sb_append(&help, dep_manifest_raw);
+            sb_append(&help, ".");
+            report_issue(manifest_real, dep->line_no, 1, dep->line,
+                "local dependency manifest not found", help.data, NULL);
+            free(help.data);
+            failed = 1;
+        } else if (linevec_contains(stack, dep_manifest)) {
+            char *help = package_dependency_cycle_help(stack, dep_manifest);
+            report_issue(manifest_real, dep->line_no, 1, dep->line,
+                "local dependency cycle detected", help, NULL);
+            free(help);
+            failed = 1;
+        } else {
+            failed = module_resolver_collect_manifest(
+                r,
+                dep_manifest,
+                dep->alias,
+                NULL,
+                manifest_real,
+                dep->line_no,
+                dep->line,
+                stack);
+        }
+        free(dep_manifest);
+        free(dep_manifest_raw);
+        free(dep_dir);
+    }
+    free(manifest_dir);
+    free(source_root);
+    package_manifest_info_free(&info);
+    linevec_pop(stack);
+    free(manifest_real);
+    return failed;
+}
+
+static int module_resolver_init_roots(ModuleResolver *r, const char *path) {
+    char *dir = dirname_copy(path);
+    char *manifest = find_package_manifest_path(dir);
+    if (manifest == NULL) {
+        char *root = canonical_existing_path(dir);
+        if (root == NULL) root = strdup(dir);
+        if (root == NULL) die_oom();
+        r->root = strdup(root);
+        if (r->root == NULL) die_oom();
+        int failed = module_resolver_add_package_root(r, "", root);
+        free(root);
+        free(dir);
+        return failed;
+    }
+    LineVec stack;
+    lines_init(&stack);
+    int failed = module_resolver_collect_manifest(r, manifest, "", path, NULL, 0, NULL, &stack);
+    lines_free(&stack);
+    free(manifest);
+    free(dir);
+    return failed;
+}
+
+static int linevec_contains(LineVec *lv, const char *text) {
+    for (size_t i = 0; i < lv->len; i++) {
+        if (strcmp(lv->items[i], text) == 0) return 1;
+    }
+    return 0;
+}
+
+static const char *module_resolver_root_for_path(ModuleResolver *r, const char *path) {
+    const char *root = r->root;
+    size_t best_len = root ? strlen(root) : 0;
+    for (int i = 0; i < r->package_count; i++) {
+        const char *candidate = r->packages[i].source_root;
+        size_t len = strlen(candidate);
+        if (len >= best_len && canonical_path_is_under(path, candidate)) {
+            root = candidate;
+            best_len = len;
+        }
+    }
+    return root;
+}
+
+static const char *module_resolver_alias_for_root(ModuleResolver *r, const char *root) {
+    for (int i = 0; i < r->package_count; i++) {
+        if (strcmp(r->packages[i].source_root, root) == 0) return r->packages[i].alias;
+    }
+    return "";
+}
+
+static char *module_name_for_path_c(ModuleResolver *r, const char *path) {
+    const char *rel = path;
+    const char *root = module_resolver_root_for_path(r, path);
+    size_t root_len = strlen(root);
+    if (strcmp(path, root) == 0) rel = "";
+    else if (strncmp(path, root, root_len) == 0 && path[root_len] == '/') rel = path + root_len + 1;
+    char *out = strdup(rel);
+    if (out == NULL) die_oom();
+    size_t n = strlen(out);
+    if (n >= 5 && strcmp(out + n - 5, ".vais") == 0) out[n - 5] = '\0';
+    for (char *p = out; *p != '\0'; p++) {
+        if (*p == '/') *p = '.';
+    }
+    const char *alias = module_resolver_alias_for_root(r, root);
+    if (alias[0] == '\0') return out;
+    StrBuf prefixed;
+    sb_init(&prefixed);
+    sb_append(&prefixed, alias);
+    if (out[0] != '\0') {
+        sb_append(&prefixed, ".");
+        sb_append(&prefixed, out);
+    }
+    free(out);
+    return sb_take(&prefixed);
+}
+
+static char *module_path_under_root(const char *root, const char *name) {
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, root);
+    sb_append(&out, "/");
+    for (const char *p = name; *p != '\0'; p++) {
+        char ch = *p == '.' ? '/' : *p;
+        sb_append_n(&out, &ch, 1);
+    }
+    sb_append(&out, ".vais");
+    return sb_take(&out);
+}
+
+static char *module_path_for_import(ModuleResolver *r, const char *current_path, const char *name) {
+    const char *current_root = module_resolver_root_for_path(r, current_path);
+    char *local = module_path_under_root(current_root, name);
+    if (access(local, R_OK) == 0) return local;
+
+    const char *dot = strchr(name, '.');
+    if (dot != NULL && dot != name && dot[1] != '\0') {
+        char *alias = substr_copy(name, (size_t)(dot - name));
+        const char *rest = dot + 1;
+        for (int i = 0; i < r->dependency_count; i++) {
+            if (strcmp(r->dependencies[i].alias, alias) == 0) {
+                free(local);
+                char *target = module_path_under_root(r->dependencies[i].source_root, rest);
+                free(alias);
+                return target;
+            }
+        }
+        free(alias);
+    }
+    return local;
+}
+
+static char *parse_import_name_c(const char *code) {
+    const char *s = skip_ws(code);
+    if (!starts_with(s, "import") || is_ident_continue(s[6])) return NULL;
+    s = skip_ws(s + 6);
+    const char *start = s;
+    if (!is_ident_start(*s)) return NULL;
+    while (1) {
+        while (is_ident_continue(*s)) s++;
+        if (*s != '.') break;
+        s++;
+        if (!is_ident_start(*s)) return NULL;
+    }
+    const char *end = s;
+    s = skip_ws(s);
+    if (*s == ';') s = skip_ws(s + 1);
+    if (*s != '\0') return NULL;
+    return substr_copy(start, (size_t)(end - start));
+}
+
+static char *parse_top_level_symbol_c(const char *code) {
+    const char *s = skip_ws(code);
+    const char *name = NULL;
+    if (starts_with(s, "fn") && !is_ident_continue(s[2])) name = skip_ws(s + 2);
+    else if (starts_with(s, "struct") && !is_ident_continue(s[6])) name = skip_ws(s + 6);
+    else if (starts_with(s, "enum") && !is_ident_continue(s[4])) name = skip_ws(s + 4);
+    else return NULL;
+    if (!is_ident_start(*name)) return NULL;
+    const char *end = name + 1;
+    while (is_ident_continue(*end)) end++;
+    return substr_copy(name, (size_t)(end - name));
+}
+
+static int import_info_cmp(const void *a, const void *b) {
+    const ImportInfo *ia = (const ImportInfo *)a;
+    const ImportInfo *ib = (const ImportInfo *)b;
+    return strcmp(ia->name, ib->name);
+}
+
+static int module_resolver_stack_index(ModuleResolver *r, const char *path) {
+    for (int i = 0; i < r->stack_count; i++) {
+        if (strcmp(r->stack[i].path, path) == 0) return i;
+    }
+    return -1;
+}
+
+static int module_resolver_add_symbol(ModuleResolver *r, const char *path, int line_no, const char *line, const char *name) {
+    int i = str_index_get(&r->symbol_index, name);
+    if (i >= 0) {
+        StrBuf help;
+        sb_init(&help);
+        sb_append(&help, "first definition is at ");
+        sb_append(&help, r->symbols[i].path);
+        sb_append(&help, ":");
+        char num[32];
+        snprintf(num, sizeof(num), "%d", r->symbols[i].line_no);
+        sb_append(&help, num);
+        sb_append(&help, "; rename one symbol before importing both files.");
+        StrBuf msg;
+        sb_init(&msg);
+        sb_append(&msg, "duplicate top-level symbol `");
+        sb_append(&msg, name);
+        sb_append(&msg, "`");
+        report_issue(path, line_no, find_col(line, name), line, msg.data, help.data, NULL);
+        free(help.data);
+        free(msg.data);
+        return 1;
+    }
+    if (r->symbol_count == r->symbol_cap) {
+        r->symbol_cap = r->symbol_cap == 0 ? 256 : r->symbol_cap * 2;
+        r->symbols = (ModuleSymbol *)realloc(r->symbols, (size_t)r->symbol_cap * sizeof(ModuleSymbol));
+        if (r->symbols == NULL) die_oom();
+    }
+    r->symbols[r->symbol_count].name = strdup(name);
+    r->symbols[r->symbol_count].path = strdup(path);
+    r->symbols[r->symbol_count].line_no = line_no;
+    if (r->symbols[r->symbol_count].name == NULL || r->symbols[r->symbol_count].path == NULL) die_oom();
+    str_index_put(&r->symbol_index, r->symbols[r->symbol_count].name, r->symbol_count);
+    r->symbol_count++;
+    return 0;
+}
+
+static char *module_resolver_cycle_help(ModuleResolver *r, int start) {
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, "remove one import from the cycle: ");
+    for (int i = start; i < r->stack_count; i++) {
+        if (i > start) sb_append(&out, " -> ");
+        sb_append(&out, r->stack[i].module);
+    }
+    sb_append(&out, " -> ");
+    sb_append(&out, r->stack[start].module);
+    sb_append(&out, ".");
+    return sb_take(&out);
+}
+
+static void module_parse_push(ImportInfo **items, int *count, int *cap, char *name, int line_no, const char *line) {
+    if (*count == *cap) {
+        *cap = *cap == 0 ? 16 : *cap * 2;
+        *items = (ImportInfo *)realloc(*items, (size_t)*cap * sizeof(ImportInfo));
+        if (*items == NULL) die_oom();
+    }
+    ImportInfo *item = &(*items)[(*count)++];
+    item->name = name;
+    item->line_no = line_no;
+    item->line = strdup(line);
+    if (item->name == NULL || item->line == NULL) die_oom();
+}
+
+static void module_parse_free(ModuleParse *parse) {
+    for (int i = 0; i < parse->import_count; i++) {
+        free(parse->imports[i].name);
+        free(parse->imports[i].line);
+    }
+    for (int i = 0; i < parse->symbol_count; i++) {
+        free(parse->symbols[i].name);
+        free(parse->symbols[i].line);
+    }
+    free(parse->imports);
+    free(parse->symbols);
+    free(parse->body);
+    memset(parse, 0, sizeof(*parse));
+}
+
+/*
+ * Splits one module file into its imports, top-level symbols, and body text,
+ * registering each symbol as it is met so duplicate-symbol and per-file
+ * diagnostics fire in source order. Returns 1 after reporting an issue.
+ */
+static int module_parse_source(ModuleResolver *r, const char *real, const char *raw, ModuleParse *parse) {
+    LineVec lines = split_lines(raw);
+    LineVec body;
+    lines_init(&body);
+    int failed = 0;
+    int in_trait_decl = 0;
+    int trait_decl_depth = 0;
+    for (size_t i = 0; i < lines.len && !failed; i++) {
+        const char *line = lines.items[i];
+        int line_no = (int)i + 1;
+        char *code = strip_line_comment(line, strlen(line));
+        const char *trim = skip_ws(code);
+        char *import_name = parse_import_name_c(code);
+        if (import_name != NULL) {
+            module_parse_push(&parse->imports, &parse->import_count, &parse->import_cap, import_name, line_no, line);
+            free(code);
+            continue;
+        }
+        if (starts_with(trim, "import") && !is_ident_continue(trim[6])) {
+            report_issue(real, line_no, find_col(line, "import"), line,
+                "invalid import path",
+                "write a static dotted local import such as `import math.add`.",
+                NULL);
+            failed = 1;
+            free(code);
+            break;
+        }
+        if ((starts_with(trim, "module") && !is_ident_continue(trim[6])) ||
+            (starts_with(trim, "package") && !is_ident_continue(trim[7]))) {
+            const char *kw = starts_with(trim, "module") ? "module" : "package";
+            report_issue(real, line_no, find_col(line, kw), line,
+                "module and package declarations are not implemented yet",
+                "omit the declaration; module names are derived from file paths in the first import slice.",
+                NULL);
+            failed = 1;
+            free(code);
+            break;
+        }
+        if (in_trait_decl) {
+            trait_decl_depth += tuple_line_brace_delta(line);
+            lines_push(&body, strdup(line));
+            if (body.items[body.len - 1] == NULL) die_oom();
+            if (trait_decl_depth <= 0) in_trait_decl = 0;
+            free(code);
+            continue;
+        }
+        if (parse_trait_start_line(code)) {
+            in_trait_decl = 1;
+            trait_decl_depth = tuple_line_brace_delta(line);
+            lines_push(&body, strdup(line));
+            if (body.items[body.len - 1] == NULL) die_oom();
+            if (trait_decl_depth <= 0) in_trait_decl = 0;
+            free(code);
+            continue;
+        }
+        char *symbol = parse_top_level_symbol_c(code);
+        if (symbol != NULL) {
+            failed = module_resolver_add_symbol(r, real, line_no, line, symbol);
+            if (failed) {
+                free(symbol);
+                free(code);
+                break;
+            }
+            module_parse_push(&parse->symbols, &parse->symbol_count, &parse->symbol_cap, symbol, line_no, line);
+        }
+        lines_push(&body, strdup(line));
+        if (body.items[body.len - 1] == NULL) die_oom();
+        free(code);
+    }
+    if (!failed) parse->body = join_lines(&body, 1);
+    lines_free(&body);
+    lines_free(&lines);
+    return failed;
+}
+
+/*
+ * On-disk module parse cache: <cache>/modules/<hash>.mod, one entry per
+ * (vaisc binary, module path), holding the imports, top-level symbols, and
+ * body text of the last successful parse. An entry is used only when the
+ * recorded size and content hash match the file just read, so edits within a
+ * single mtime tick still reparse. Files that fail to parse are never cached,
+ * which keeps every per-file diagnostic on the uncached path.
+ */
+static int module_cache_state = 0;
+
+static char *module_cache_dir = NULL;
+
+static char *module_cache_identity = NULL;
+
+static int module_cache_stored = 0;
+
+static int module_cache_ready(void) {
+    if (module_cache_state != 0) return module_cache_state > 0;
+    module_cache_state = -1;
+    if (vaisc_cache_disabled()) return 0;
+    char *root = vaisc_cache_root();
+    if (root == NULL) return 0;
+    module_cache_dir = path_join2(root, "modules");
+    free(root);
+    if (cache_mkdirs(module_cache_dir) != 0) return 0;
+    StrBuf id;
+    sb_init(&id);
+    sb_append(&id, VAIS_VERSION);
+    sb_append(&id, "\n");
+    append_self_identity(&id);
+    module_cache_identity = sb_take(&id);
+    module_cache_state = 1;
+    return 1;
+}
+
+static char *module_cache_path(const char *real) {
+    uint64_t h = runtime_cache_hash(1469598103934665603ULL, module_cache_identity);
+    h = runtime_cache_hash(h, real);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.mod", (unsigned long long)h);
+    return path_join2(module_cache_dir, name);
+}
+
+static int module_cache_read_items(const char **cursor, const char *end, ImportInfo **items, int *count, int *cap, int n) {
+    for (int i = 0; i < n; i++) {
+        char *next = NULL;
+        long line_no = strtol(*cursor, &next, 10);
+        long name_len = strtol(next, &next, 10);
+        long line_len = strtol(next, &next, 10);
+        if (*next != '\n' || line_no <= 0 || name_len <= 0 || line_len < 0 || next + 1 + name_len + line_len + 1 > end) return 1;
+        const char *p = next + 1;
+        char *name = (char *)malloc((size_t)name_len + 1);
+        if (name == NULL) die_oom();
+        memcpy(name, p, (size_t)name_len);
+        name[name_len] = '\0';
+        char *line = (char *)malloc((size_t)line_len + 1);
+        if (line == NULL) die_oom();
+        memcpy(line, p + name_len, (size_t)line_len);
+        line[line_len] = '\0';
+        module_parse_push(items, count, cap, name, (int)line_no, line);
+        free(line);
+        p += name_len + line_len;
+        if (*p != '\n') return 1;
+        *cursor = p + 1;
+    }
+    return 0;
+}
+
+static int module_cache_load(const char *real, const char *raw, ModuleParse *parse) {
+    if (!module_cache_ready()) return 1;
+    char *path = module_cache_path(real);
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        free(path);
+        return 1;
+    }
+    char *text = read_file(path);
+    free(path);
+    if (text == NULL) return 1;
+    const char *end = text + strlen(text);
+    char expect[128];
+    snprintf(expect, sizeof(expect), "vaisc-module 1\n%zu %016llx\n", strlen(raw), (unsigned long long)str_hash64(raw));
+    int bad = strncmp(text, expect, strlen(expect)) != 0;
+    const char *cursor = text + strlen(expect);
+    char *next = NULL;
+    long import_count = 0;
+    long symbol_count = 0;
+    long body_len = 0;
+    if (!bad) {
+        import_count = strtol(cursor, &next, 10);
+        symbol_count = strtol(next, &next, 10);
+        body_len = strtol(next, &next, 10);
+        bad = *next != '\n' || import_count < 0 || symbol_count < 0 || body_len < 0;
+        cursor = next + 1;
+    }
+    if (!bad) bad = module_cache_read_items(&cursor, end, &parse->imports, &parse->import_count, &parse->import_cap, (int)import_count);
+    if (!bad) bad = module_cache_read_items(&cursor, end, &parse->symbols, &parse->symbol_count, &parse->symbol_cap, (int)symbol_count);
+    if (!bad && cursor + body_len == end) {
+        parse->body = (char *)malloc((size_t)body_len + 1);
+        if (parse->body == NULL) die_oom();
+        memcpy(parse->body, cursor, (size_t)body_len);
+        parse->body[body_len] = '\0';
+    } else {
+        bad = 1;
+    }
+    free(text);
+    if (bad) module_parse_free(parse);
+    return bad;
+}
+
+static void module_cache_append_items(StrBuf *out, const ImportInfo *items, int count) {
+    for (int i = 0; i < count; i++) {
+        char head[96];
+        snprintf(head, sizeof(head), "%d %zu %zu\n", items[i].line_no, strlen(items[i].name), strlen(items[i].line));
+        sb_append(out, head);
+        sb_append(out, items[i].name);
+        sb_append(out, items[i].line);
+        sb_append(out, "\n");
+    }
+}
+
+static void module_cache_store(const char *real, const char *raw, const ModuleParse *parse) {
+    if (!module_cache_ready()) return;
+    StrBuf out;
+    sb_init(&out);
+    char head[160];
+    snprintf(head, sizeof(head), "vaisc-module 1\n%zu %016llx\n%d %d %zu\n", strlen(raw), (unsigned long long)str_hash64(raw),
+        parse->import_count, parse->symbol_count, strlen(parse->body));
+    sb_append(&out, head);
+    module_cache_append_items(&out, parse->imports, parse->import_count);
+    module_cache_append_items(&out, parse->symbols, parse->symbol_count);
+    sb_append(&out, parse->body);
+    char *path = module_cache_path(real);
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid()) < (int)sizeof(tmp)) {
+        FILE *fp = fopen(tmp, "wb");
+        if (fp != NULL) {
+            int ok = fwrite(out.data, 1, out.len, fp) == out.len;
+            ok = fclose(fp) == 0 && ok;
+            if (!ok || rename(tmp, path) != 0) unlink(tmp);
+            else module_cache_stored = 1;
+        }
+    }
+    free(path);
+    free(out.data);
+}
+
+/*
+ * `--instrument` markers. Each module body is re-emitted with calls to the
+ * host runtime's `__vais_prof_*` hooks: one at the top of every function
+ * body, one around every statement loop, and one before each single-line
+ * statement that calls an allocating builtin. Every marker carries a
+ * build-wide id and a `path:line` label taken from the original file, so the
+ * profile the program writes at exit points back at the source the user
+ * edits rather than at lowered helper names. Lines the scan cannot place a
+ * marker on safely (continuations, expression blocks, multi-line strings)
+ * are copied unchanged.
+ */
+enum {
+    PROF_BLOCK_OTHER,
+    PROF_BLOCK_FN,
+    PROF_BLOCK_STMT,
+    PROF_BLOCK_LOOP,
+    PROF_BLOCK_IMPL,
+};
+
+typedef struct {
+    int kind;
+    int id;
+} ProfBlock;
+
+typedef struct {
+    int first_open;
+    int first_close;
+    int nest;
+    int unterminated;
+} ProfLineScan;
+
+static const char *prof_alloc_builtins[] = {
+    "str_concat", "str_slice", "str_join", "str_replace", "str_trim", "str_lower",
+    "str_upper", "str_byte", "str_split_ws_into", "str_split_lines_into", "str_split_into",
+    "str_builder_new", "str_builder_push", "str_builder_append", "str_builder_finish",
+    "fs_read_text", "fs_list_files", "fs_list_dirs", "stdin_read_all",
+    "path_join", "path_basename", "path_dirname",
+    "proc_capture", "proc_capture_stdout", "proc_capture_stderr", "proc_capture_to",
+    "map_str_str_snapshot", "map_str_str_load_snapshot", "doc_term_counts_into",
+    "Str", NULL,
+};
+
+static const char *prof_alloc_methods[] = {"push", "insert", "extend", NULL};
+
+/* Brace and bracket structure of one comment-stripped line; `nest` carries
+   the open paren/bracket depth across lines. */
+static void prof_scan_line(const char *code, ProfLineScan *scan) {
+    scan->first_open = -1;
+    scan->first_close = -1;
+    scan->unterminated = 0;
+    for (int i = 0; code[i] != '\0'; i++) {
+        if (is_string_delim_c(code[i])) {
+            int end = skip_string_literal_c(code, i);
+            if (end < 0) {
+                scan->unterminated = code[i];
+                return;
+            }
+            i = end - 1;
+            continue;
+        }
+        if (code[i] == '\'') {
+            int end = skip_char_literal_c(code, i);
+            if (end < 0) return;
+            i = end - 1;
+            continue;
+        }
+        if (code[i] == '(' || code[i] == '[') scan->nest++;
+        else if ((code[i] == ')' || code[i] == ']') && scan->nest > 0) scan->nest--;
+        else if (code[i] == '{' && scan->first_open < 0 && scan->nest == 0) scan->first_open = i;
+        else if (code[i] == '}' && scan->first_close < 0) scan->first_close = i;
+    }
+}
+
+static int prof_starts_word(const char *s, const char *word) {
+    size_t n = strlen(word);
+    return strncmp(s, word, n) == 0 && !is_ident_continue(s[n]);
+}
+
+/* The first allocating builtin or collection method the line calls, or NULL. */
+static char *prof_alloc_callee(const char *code) {
+    for (int i = 0; code[i] != '\0'; i++) {
+        if (is_string_delim_c(code[i])) {
+            int end = skip_string_literal_c(code, i);
+            if (end < 0) return NULL;
+            i = end - 1;
+            continue;
+        }
+        if (!is_ident_start(code[i]) || (i > 0 && is_ident_continue(code[i - 1]))) continue;
+        int end = i;
+        while (is_ident_continue(code[end])) end++;
+        if (code[end] == '(') {
+            const char **names = i > 0 && code[i - 1] == '.' ? prof_alloc_methods : prof_alloc_builtins;
+            for (int k = 0; names[k] != NULL; k++) {
+                if (strlen(names[k]) == (size_t)(end - i) && strncmp(code + i, names[k], (size_t)(end - i)) == 0) {
+                    return substr_copy(code + i - (names == prof_alloc_methods), (size_t)(end - i) + (names == prof_alloc_methods));
+                }
+            }
+        }
+        i = end - 1;
+    }
+    return NULL;
+}
+
+/* Source path for profile labels: relative to the working directory when
+   the module lives under it, absolute otherwise. */
+static char *prof_label_path(const char *real) {
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) != NULL) {
+        size_t n = strlen(cwd);
+        if (n > 1 && strncmp(real, cwd, n) == 0 && real[n] == '/') return strdup(real + n + 1);
+    }
+    return strdup(real);
+}
+
+/* Appends `__vais_prof_<hook>(id, "path:line detail")`, with characters that
+   could end or split the string literal replaced by `?`. */
+static void prof_append_marker(StrBuf *out, const char *hook, int id, const char *path, int line_no, const char *detail) {
+    char num[64];
+    sb_append(out, "__vais_prof_");
+    sb_append(out, hook);
+    snprintf(num, sizeof(num), "(%d", id);
+    sb_append(out, num);
+    if (path != NULL) {
+        StrBuf label;
+        sb_init(&label);
+        snprintf(num, sizeof(num), ":%d", line_no);
+        sb_append(&label, path);
+        sb_append(&label, num);
+        if (detail != NULL && detail[0] != '\0') {
+            sb_append(&label, " ");
+            sb_append(&label, detail);
+        }
+        for (size_t i = 0; i < label.len; i++) {
+            unsigned char ch = (unsigned char)label.data[i];
+            if (ch < 32 || ch == '"' || ch == '\\' || ch == '`' || ch == '{' || ch == '}') label.data[i] = '?';
+        }
+        sb_append(out, ", \"");
+        sb_append(out, label.data);
+        sb_append(out, "\"");
+        free(label.data);
+    }
+    sb_append(out, ")");
+}
+
+static void prof_push_line(LineVec *out, const char *indent, const char *extra, StrBuf *text) {
+    StrBuf line;
+    sb_init(&line);
+    sb_append(&line, indent);
+    if (extra != NULL) sb_append(&line, extra);
+    sb_append(&line, text->data);
+    lines_push(out, sb_take(&line));
+    text->len = 0;
+    text->data[0] = '\0';
+}
+
+static void prof_push_block(ProfBlock **blocks, int *count, int *cap, int kind, int id) {
+    if (*count == *cap) {
+        *cap = *cap == 0 ? 16 : *cap * 2;
+        *blocks = (ProfBlock *)realloc(*blocks, (size_t)*cap * sizeof(ProfBlock));
+        if (*blocks == NULL) die_oom();
+    }
+    (*blocks)[*count].kind = kind;
+    (*blocks)[*count].id = id;
+    (*count)++;
+}
+
+static int prof_ends_statement(const char *code) {
+    size_t n = strlen(code);
+    while (n > 0 && (code[n - 1] == ' ' || code[n - 1] == '\t' || code[n - 1] == '\r' || code[n - 1] == ';')) n--;
+    if (n == 0) return 1;
+    return strchr(",([+-*/%=&|<>.!", code[n - 1]) == NULL;
+}
+
+/* Rebuilds a module body from its raw text (import lines dropped, as
+   module_parse_source does) with profiling markers inserted. */
+static char *module_instrument_body(ModuleResolver *r, const char *real, const char *raw) {
+    char *path = prof_label_path(real);
+    LineVec lines = split_lines(raw);
+    LineVec out;
+    lines_init(&out);
+    ProfBlock *blocks = NULL;
+    int block_count = 0;
+    int block_cap = 0;
+    int nest = 0;
+    int ready = 1;
+    char in_text = 0;
+    char *impl_name = NULL;
+    StrBuf marker;
+    sb_init(&marker);
+    for (size_t i = 0; i < lines.len; i++) {
+        const char *line = lines.items[i];
+        int line_no = (int)i + 1;
+        if (in_text) {
+            lines_push(&out, strdup(line));
+            if (strchr(line, in_text) != NULL) in_text = 0;
+            continue;
+        }
+        char *code = strip_line_comment(line, strlen(line));
+        char *import_name = parse_import_name_c(code);
+        if (import_name != NULL) {
+            free(import_name);
+            free(code);
+            continue;
+        }
+        const char *trim = skip_ws(code);
+        if (trim[0] == '\0') {
+            lines_push(&out, strdup(line));
+            free(code);
+            continue;
+        }
+        char *indent = substr_copy(line, (size_t)(skip_ws(line) - line));
+        int start_nest = nest;
+        ProfLineScan scan;
+        scan.nest = nest;
+        prof_scan_line(code, &scan);
+        nest = scan.nest;
+        int top = block_count == 0 ? -1 : blocks[block_count - 1].kind;
+        int stmt_ctx = (top == PROF_BLOCK_FN || top == PROF_BLOCK_STMT || top == PROF_BLOCK_LOOP) &&
+            start_nest == 0 && ready && !scan.unterminated;
+        int close = scan.first_open >= 0 ? find_matching_brace_c(code, scan.first_open) : -1;
+        int single = close >= 0 && skip_ws(code + close + 1)[0] == '\0';
+        int opens_block = scan.first_open >= 0 && close < 0 && skip_ws(code + scan.first_open + 1)[0] == '\0' &&
+            (scan.first_close < 0 || scan.first_close > scan.first_open);
+        int open_kind = -1;
+        int open_id = 0;
+        int loop_end_id = 0;
+        const char *fn_head = prof_starts_word(trim, "pub") ? skip_ws(trim + 3) : trim;
+        if ((top == -1 || top == PROF_BLOCK_IMPL) && start_nest == 0 && prof_starts_word(fn_head, "fn") &&
+            scan.first_open >= 0 && (single || opens_block)) {
+            const char *name = skip_ws(fn_head + 2);
+            const char *end = name;
+            while (is_ident_continue(*end)) end++;
+            char *fn_name = substr_copy(name, (size_t)(end - name));
+            StrBuf detail;
+            sb_init(&detail);
+            if (top == PROF_BLOCK_IMPL && impl_name != NULL) {
+                sb_append(&detail, impl_name);
+                sb_append(&detail, ".");
+            }
+            sb_append(&detail, fn_name);
+            prof_append_marker(&marker, "fn", ++r->prof_next, path, line_no, detail.data);
+            if (single) {
+                StrBuf text;
+                sb_init(&text);
+                sb_append_n(&text, line, (size_t)scan.first_open + 1);
+                sb_append(&text, " ");
+                sb_append(&text, marker.data);
+                sb_append(&text, skip_ws(code + scan.first_open + 1)[0] == '}' ? " " : ";");
+                sb_append(&text, line + scan.first_open + 1);
+                lines_push(&out, sb_take(&text));
+                marker.len = 0;
+                marker.data[0] = '\0';
+            } else {
+                lines_push(&out, strdup(line));
+                prof_push_line(&out, indent, "    ", &marker);
+                open_kind = PROF_BLOCK_FN;
+            }
+            free(detail.data);
+            free(fn_name);
+        } else if (stmt_ctx && scan.first_open >= 0 && (single || opens_block) &&
+            (prof_starts_word(trim, "while") || prof_starts_word(trim, "for") || prof_starts_word(trim, "loop"))) {
+            int id = ++r->prof_next;
+            char *kw = substr_copy(trim, prof_starts_word(trim, "for") ? 3 : prof_starts_word(trim, "loop") ? 4 : 5);
+            prof_append_marker(&marker, "loop", id, path, line_no, kw);
+            free(kw);
+            prof_push_line(&out, indent, NULL, &marker);
+            prof_append_marker(&marker, "iter", id, NULL, 0, NULL);
+            if (single) {
+                StrBuf text;
+                sb_init(&text);
+                sb_append_n(&text, line, (size_t)scan.first_open + 1);
+                sb_append(&text, " ");
+                sb_append(&text, marker.data);
+                sb_append(&text, skip_ws(code + scan.first_open + 1)[0] == '}' ? " " : ";");
+                sb_append(&text, line + scan.first_open + 1);
+                lines_push(&out, sb_take(&text));
+                marker.len = 0;
+                marker.data[0] = '\0';
+                loop_end_id = id;
+            } else {
+                lines_push(&out, strdup(line));
+                prof_push_line(&out, indent, "    ", &marker);
+                open_kind = PROF_BLOCK_LOOP;
+                open_id = id;
+            }
+        } else {
+            char *callee = NULL;
+            if (stmt_ctx && scan.first_open < 0 && scan.first_close < 0 && nest == 0 && is_ident_start(trim[0]) &&
+                !prof_starts_word(trim, "else") && !prof_starts_word(trim, "and") && !prof_starts_word(trim, "or") &&
+                strstr(code, "=>") == NULL && prof_ends_statement(code)) {
+                callee = prof_alloc_callee(trim);
+            } else if (stmt_ctx && single && prof_starts_word(trim, "if") && strstr(code, "=>") == NULL) {
+                callee = prof_alloc_callee(trim);
+            }
+            if (callee != NULL) {
+                prof_append_marker(&marker, "site", ++r->prof_next, path, line_no, callee);
+                prof_push_line(&out, indent, NULL, &marker);
+                free(callee);
+            }
+            lines_push(&out, strdup(line));
+        }
+        /* Block bookkeeping: closes pop, opens push with the kind the line
+           names; an `else` continues whatever kind its `if` had. */
+        int popped = -1;
+        int first = 1;
+        for (int c = 0; code[c] != '\0' && !scan.unterminated; c++) {
+            if (is_string_delim_c(code[c])) {
+                int end = skip_string_literal_c(code, c);
+                if (end < 0) break;
+                c = end - 1;
+                continue;
+            }
+            if (code[c] == '\'') {
+                int end = skip_char_literal_c(code, c);
+                if (end < 0) break;
+                c = end - 1;
+                continue;
+            }
+            if (code[c] == '}') {
+                if (block_count > 0) {
+                    block_count--;
+                    popped = blocks[block_count].kind;
+                    if (popped == PROF_BLOCK_LOOP && strcmp(trim, "}") == 0) loop_end_id = blocks[block_count].id;
+                    if (popped == PROF_BLOCK_IMPL) {
+                        free(impl_name);
+                        impl_name = NULL;
+                    }
+                }
+            } else if (code[c] == '{') {
+                int kind = PROF_BLOCK_OTHER;
+                if (first && open_kind >= 0) {
+                    kind = open_kind;
+                } else if (prof_starts_word(trim, "else") || starts_with(trim, "} else")) {
+                    kind = popped == PROF_BLOCK_OTHER ? PROF_BLOCK_OTHER : PROF_BLOCK_STMT;
+                } else if (prof_starts_word(trim, "if") || prof_starts_word(trim, "while") ||
+                    prof_starts_word(trim, "for") || prof_starts_word(trim, "loop")) {
+                    kind = start_nest == 0 && (top == PROF_BLOCK_FN || top == PROF_BLOCK_STMT || top == PROF_BLOCK_LOOP) ?
+                        PROF_BLOCK_STMT : PROF_BLOCK_OTHER;
+                } else if (prof_starts_word(trim, "impl") && block_count == 0) {
+                    const char *s = skip_ws(trim + 4);
+                    const char *name = s;
+                    while (is_ident_continue(*s)) s++;
+                    const char *after = skip_ws(s);
+                    if (prof_starts_word(after, "for")) {
+                        name = skip_ws(after + 3);
+                        s = name;
+                        while (is_ident_continue(*s)) s++;
+                    }
+                    free(impl_name);
+                    impl_name = substr_copy(name, (size_t)(s - name));
+                    kind = PROF_BLOCK_IMPL;
+                }
+                prof_push_block(&blocks, &block_count, &block_cap, kind, open_id);
+                first = 0;
+            }
+        }
+        if (loop_end_id > 0) {
+            prof_append_marker(&marker, "loop_end", loop_end_id, NULL, 0, NULL);
+            prof_push_line(&out, indent, NULL, &marker);
+        }
+        if (scan.unterminated) in_text = (char)scan.unterminated;
+        ready = !scan.unterminated && nest == 0 && prof_ends_statement(code);
+        free(indent);
+        free(code);
+    }
+    char *body = join_lines(&out, 1);
+    lines_free(&out);
+    lines_free(&lines);
+    free(blocks);
+    free(impl_name);
+    free(marker.data);
+    free(path);
+    return body;
+}
+
+static char *module_resolver_load(ModuleResolver *r, const char *path, const char *issue_path, int issue_line, const char *issue_text) {
+    char *real = canonical_existing_path(path);
+    if (real == NULL) {
+        if (issue_path != NULL && issue_text != NULL) {
+            StrBuf help;
+            sb_init(&help);
+            sb_append(&help, "expected local module file at ");
+            sb_append(&help, path);
+            sb_append(&help, ".");
+            report_issue(issue_path, issue_line, find_col(issue_text, "import"), issue_text,
+                "import path not found", help.data, NULL);
+            free(help.data);
+        } else {
+            fprintf(stderr, "error: source not found: %s\n", path);
+        }
+        return NULL;
+    }
+    int cycle_start = module_resolver_stack_index(r, real);
+    if (cycle_start >= 0) {
+        char *help = module_resolver_cycle_help(r, cycle_start);
+        report_issue(issue_path ? issue_path : path, issue_line > 0 ? issue_line : 1, issue_text ? find_col(issue_text, "import") : 1, issue_text ? issue_text : "",
+            "import cycle detected", help, NULL);
+        free(help);
+        free(real);
+        return NULL;
+    }
+    if (str_index_get(&r->visited_index, real) >= 0) {
+        free(real);
+        return strdup("");
+    }
+    if (r->stack_count == r->stack_cap) {
+        r->stack_cap = r->stack_cap == 0 ? 32 : r->stack_cap * 2;
+        r->stack = (ModuleStackEntry *)realloc(r->stack, (size_t)r->stack_cap * sizeof(ModuleStackEntry));
+        if (r->stack == NULL) die_oom();
+    }
+    char *module_name = module_name_for_path_c(r, real);
+    r->stack[r->stack_count].path = strdup(real);
+    r->stack[r->stack_count].module = module_name;
+    if (r->stack[r->stack_count].path == NULL) die_oom();
+    r->stack_count++;
+
+    char *raw = read_file(real);
+    if (raw == NULL) {
+        r->stack_count--;
+        free(r->stack[r->stack_count].path);
+        free(r->stack[r->stack_count].module);
+        free(real);
+        return NULL;
+    }
+    ModuleParse parse;
+    memset(&parse, 0, sizeof(parse));
+    int failed = 0;
+    if (module_cache_load(real, raw, &parse) == 0) {
+        /* Replaying the cached symbols in line order reports the same first
+           duplicate a fresh parse would. */
+        for (int i = 0; i < parse.symbol_count && !failed; i++) {
+            failed = module_resolver_add_symbol(r, real, parse.symbols[i].line_no, parse.symbols[i].line, parse.symbols[i].name);
+        }
+    } else {
+        failed = module_parse_source(r, real, raw, &parse);
+        if (!failed) module_cache_store(real, raw, &parse);
+    }
+
+    StrBuf merged;
+    sb_init(&merged);
+    if (!failed) {
+        qsort(parse.imports, (size_t)parse.import_count, sizeof(ImportInfo), import_info_cmp);
+        for (int i = 0; i < parse.import_count; i++) {
+            char *target = module_path_for_import(r, real, parse.imports[i].name);
+            char *piece = module_resolver_load(r, target, real, parse.imports[i].line_no, parse.imports[i].line);
+            free(target);
+            if (piece == NULL) {
+                failed = 1;
+                break;
+            }
+            if (piece[0] != '\0') {
+                sb_append(&merged, piece);
+                if (merged.len > 0 && merged.data[merged.len - 1] != '\n') sb_append(&merged, "\n");
+            }
+            free(piece);
+        }
+    }
+    if (!failed) {
+        if (vaisc_instrument) {
+            char *instrumented = module_instrument_body(r, real, raw);
+            sb_append(&merged, instrumented);
+            free(instrumented);
+        } else {
+            sb_append(&merged, parse.body);
+        }
+        lines_push(&r->visited, strdup(real));
+        if (r->visited.items[r->visited.len - 1] == NULL) die_oom();
+        str_index_put(&r->visited_index, r->visited.items[r->visited.len - 1], (int)r->visited.len - 1);
+    }
+
+    module_parse_free(&parse);
+    free(raw);
+    r->stack_count--;
+    free(r->stack[r->stack_count].path);
+    free(r->stack[r->stack_count].module);
+    free(real);
+    if (failed) {
+        free(merged.data);
+        return NULL;
+    }
+    return sb_take(&merged);
+}
+
+static void module_resolver_free(ModuleResolver *r) {
+    free(r->root);
+    for (int i = 0; i < r->package_count; i++) {
+        free(r->packages[i].alias);
+        free(r->packages[i].source_root);
+    }
+    free(r->packages);
+    for (int i = 0; i < r->dependency_count; i++) {
+        free(r->dependencies[i].alias);
+        free(r->dependencies[i].source_root);
+    }
+    free(r->dependencies);
+    lines_free(&r->visited);
+    str_index_free(&r->visited_index);
+    free(r->stack);
+    for (int i = 0; i < r->symbol_count; i++) {
+        free(r->symbols[i].name);
+        free(r->symbols[i].path);
+    }
+    free(r->symbols);
+    str_index_free(&r->symbol_index);
+}
+
+char *resolve_module_graph_source(const char *path) {
+    ModuleResolver r;
+    memset(&r, 0, sizeof(r));
+    lines_init(&r.visited);
+    if (module_resolver_init_roots(&r, path) != 0) {
+        module_resolver_free(&r);
+        return NULL;
+    }
+    char *merged = module_resolver_load(&r, path, NULL, 0, NULL);
+    module_resolver_free(&r);
+    if (module_cache_stored) {
+        module_cache_stored = 0;
+        build_cache_evict(module_cache_dir);
+    }
+    return merged;
+}
+
+char *resolve_module_graph_source_timed(const char *path) {
+    int phase = stats_phase_begin("resolve_modules", 0);
+    char *merged = resolve_module_graph_source(path);
+    stats_phase_end(phase, merged == NULL ? 0 : strlen(merged));
+    return merged;
+}
+
+static int preflight_is_space(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+static char *preflight_trim_n(const char *text, size_t n) {
+    size_t start = 0;
+    while (start < n && preflight_is_space(text[start])) start++;
+    while (n > start && preflight_is_space(text[n - 1])) n--;
+    return substr_copy(text + start, n - start);
+}
+
+static char *preflight_code_line(const char *text, size_t start, size_t end) {
+    if (end > start && text[end - 1] == '\r') end--;
+    const char *hash = memchr(text + start, '#', end - start);
+    if (hash != NULL) end = (size_t)(hash - text);
+    return preflight_trim_n(text + start, end - start);
+}
+
+static size_t preflight_line_end(const char *text, size_t pos, size_t len) {
+    const char *nl = memchr(text + pos, '\n', len - pos);
+    return nl == NULL ? len : (size_t)(nl - text);
+}
+
+static char *preflight_path_join(const char *base, const char *child) {
+    if (child[0] == '/' || base[0] == '\0') return strdup(child);
+    return path_join2(base, child);
+}
+
+static char *preflight_dirname(const char *path) {
+    const char *last = strrchr(path, '/');
+    if (last == NULL) return strdup(".");
+    if (last == path) return strdup("/");
+    return substr_copy(path, (size_t)(last - path));
+}
+
+static int preflight_exists(const char *path) {
+    return access(path, F_OK) == 0;
+}
+
+static char *preflight_normalize_path(const char *path) {
+    char *out = strdup(path);
+    if (out == NULL) die_oom();
+    char *dot;
+    while ((dot = strstr(out, "/./")) != NULL) {
+        memmove(dot, dot + 2, strlen(dot + 2) + 1);
+    }
+    char *up;
+    while ((up = strstr(out, "/../")) != NULL) {
+        char *start = up - 1;
+        while (start > out && *start != '/') start--;
+        if (start < out) start = out;
+        if (start == out && out[0] != '/') {
+            memmove(out, up + 4, strlen(up + 4) + 1);
+        } else {
+            memmove(start, up + 3, strlen(up + 3) + 1);
+        }
+    }
+    return out;
+}
+
+static int preflight_path_is_under(const char *path, const char *root) {
+    char *p = preflight_normalize_path(path);
+    char *r = preflight_normalize_path(root);
+    size_t rlen = strlen(r);
+    int under = strcmp(p, r) == 0 || (strncmp(p, r, rlen) == 0 && p[rlen] == '/');
+    free(p);
+    free(r);
+    return under;
+}
+
+static int preflight_stack_contains(LineVec *stack, const char *path) {
+    char *id = preflight_normalize_path(path);
+    int found = 0;
+    for (size_t i = 0; i < stack->len && !found; i++) {
+        found = strcmp(stack->items[i], id) == 0;
+    }
+    free(id);
+    return found;
+}
+
+static char *preflight_section_name(const char *code) {
+    size_t n = strlen(code);
+    if (n < 3 || code[0] != '[' || !is_ident_start(code[1])) return NULL;
+    size_t i = 1;
+    while (i < n && is_ident_continue(code[i])) i++;
+    if (i >= n || code[i] != ']') return NULL;
+    size_t end = i;
+    for (i++; i < n; i++) {
+        if (!preflight_is_space(code[i])) return NULL;
+    }
+    return substr_copy(code + 1, end - 1);
+}
+
+static int preflight_assignment_ok(const char *code) {
+    size_t n = strlen(code);
+    size_t i = 0;
+    if (n == 0 || !is_ident_start(code[0])) return 0;
+    while (i < n && is_ident_continue(code[i])) i++;
+    while (i < n && preflight_is_space(code[i])) i++;
+    if (i >= n || code[i] != '=') return 0;
+    i++;
+    while (i < n && preflight_is_space(code[i])) i++;
+    if (i >= n || code[i] != '"') return 0;
+    const char *close = strchr(code + i + 1, '"');
+    if (close == NULL) return 0;
+    for (const char *p = close + 1; *p != '\0'; p++) {
+        if (!preflight_is_space(*p)) return 0;
+    }
+    return 1;
+}
+
+static char *preflight_assignment_key(const char *code) {
+    size_t i = 0;
+    while (code[i] != '\0' && is_ident_continue(code[i])) i++;
+    return substr_copy(code, i);
+}
+
+static char *preflight_assignment_value(const char *code) {
+    const char *eq = strchr(code, '=');
+    if (eq == NULL) return strdup("");
+    const char *p = eq + 1;
+    while (preflight_is_space(*p)) p++;
+    if (*p != '"') return strdup("");
+    const char *close = strchr(p + 1, '"');
+    if (close == NULL) return strdup("");
+    return substr_copy(p + 1, (size_t)(close - p - 1));
+}
+
+static int preflight_path_is_safe(const char *value, int reject_dotdot, int reject_colon) {
+    size_t n = strlen(value);
+    if (n == 0 || value[0] == '/') return 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= n; i++) {
+        if (i == n || value[i] == '/') {
+            if (i == start) return 0;
+            if (reject_dotdot && i - start == 2 && value[start] == '.' && value[start + 1] == '.') return 0;
+            start = i + 1;
+        } else if (value[i] == '\\' || (reject_colon && value[i] == ':')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int preflight_report(const char *path, int line_no, const char *message, const char *help) {
+    fprintf(stderr, "error: %s\n", message);
+    fprintf(stderr, "  --> %s:%d:1\n", path, line_no);
+    fprintf(stderr, "  help: %s\n", help);
+    return 1;
+}
+
+static int preflight_report_owned(const char *path, int line_no, char *message, char *help) {
+    preflight_report(path, line_no, message, help);
+    free(message);
+    free(help);
+    return 1;
+}
+
+static char *preflight_concat3(const char *a, const char *b, const char *c) {
+    StrBuf out;
+    sb_init(&out);
+    sb_append(&out, a);
+    sb_append(&out, b);
+    sb_append(&out, c);
+    return sb_take(&out);
+}
+
+static const char *PREFLIGHT_ENTRY_HELP =
+    "write top-level string keys `name`, `version`, `source`, optional `binary`, optional `assets`, plus optional `[dependencies]` string entries";
+
+static const char *PREFLIGHT_DUPLICATE_HELP =
+    "keep exactly one `name`, one `version`, one `source` key, at most one `binary`, and at most one `assets` key";
+
+static const char *PREFLIGHT_MISSING_HELP =
+    "write `name`, `version`, and `source` before compiling this package; `binary` and `assets` are optional";
+
+static int preflight_manifest_key(PreflightManifest *m, const char *path, int line_no, const char *key, const char *value) {
+    int *seen = NULL;
+    if (strcmp(key, "name") == 0) {
+        seen = &m->has_name;
+    } else if (strcmp(key, "version") == 0) {
+        seen = &m->has_version;
+    } else if (strcmp(key, "source") == 0) {
+        seen = &m->has_source;
+    } else if (strcmp(key, "binary") == 0) {
+        seen = &m->has_binary;
+    } else if (strcmp(key, "assets") == 0) {
+        seen = &m->has_assets;
+    } else if (strcmp(key, "profile") == 0) {
+        if (m->has_profile) return preflight_report(path, line_no, "duplicate package manifest key `profile`", "keep at most one `profile` key");
+        m->has_profile = 1;
+        if (strcmp(value, "debug") != 0 && strcmp(value, "release") != 0) {
+            return preflight_report(path, line_no, "package manifest profile must be `debug` or `release`",
+                "use `profile = \"release\"` for optimized package builds or `profile = \"debug\"` for the default");
+        }
+        return 0;
+    } else {
+        return preflight_report(path, line_no, "unsupported package manifest key",
+            "use only top-level `name`, `version`, `source`, optional `binary`, optional `assets`, and optional `profile`; put local packages under `[dependencies]`");
+    }
+    if (*seen) {
+        return preflight_report_owned(path, line_no, preflight_concat3("duplicate package manifest key `", key, "`"), strdup(PREFLIGHT_DUPLICATE_HELP));
+    }
+    *seen = 1;
+    if (seen == &m->has_source) {
+        free(m->source);
+        m->source = strdup(value);
+        m->source_line = line_no;
+    } else if (seen == &m->has_assets) {
+        free(m->assets);
+        m->assets = strdup(value);
+        m->assets_line = line_no;
+    }
+    return 0;
+}
+
+static int preflight_manifest_dependency(const char *path, int line_no, const char *manifest_dir, const char *value, LineVec *stack) {
+    if (!preflight_path_is_safe(value, 0, 1)) {
+        return preflight_report(path, line_no, "local dependency path must be a relative local path",
+            "use a relative local dependency path without a scheme, colon, backslash, or empty segment");
+    }
+    char *dep_dir = preflight_path_join(manifest_dir, value);
+    char *dep_manifest = preflight_path_join(dep_dir, "vais.toml");
+    free(dep_dir);
+    int rc = 0;
+    if (!preflight_exists(dep_manifest)) {
+        rc = preflight_report_owned(path, line_no, strdup("local dependency manifest not found"),
+            preflight_concat3("expected local dependency manifest at ", dep_manifest, ""));
+    } else if (preflight_stack_contains(stack, dep_manifest)) {
+        char *id = preflight_normalize_path(dep_manifest);
+        rc = preflight_report_owned(path, line_no, strdup("local dependency cycle detected"),
+            preflight_concat3("remove one dependency from the cycle ending at ", id, ""));
+        free(id);
+    } else {
+        rc = preflight_check_manifest(dep_manifest, stack, "");
+    }
+    free(dep_manifest);
+    return rc;
+}
+
+static int preflight_manifest_lines(const char *path, const char *text, const char *manifest_dir, LineVec *stack, PreflightManifest *m) {
+    StrIndex aliases;
+    memset(&aliases, 0, sizeof(aliases));
+    LineVec alias_names;
+    lines_init(&alias_names);
+    int in_dependencies = 0;
+    int rc = 0;
+    size_t len = strlen(text);
+    int line_no = 1;
+    for (size_t pos = 0; pos <= len && rc == 0; line_no++) {
+        size_t line_end = preflight_line_end(text, pos, len);
+        char *code = preflight_code_line(text, pos, line_end);
+        pos = line_end + 1;
+        if (code[0] == '\0') {
+            free(code);
+            continue;
+        }
+        if (code[0] == '[') {
+            char *section = preflight_section_name(code);
+            if (section != NULL && strcmp(section, "dependencies") == 0) {
+                in_dependencies = 1;
+            } else if (section != NULL && section[0] != '\0') {
+                rc = preflight_report_owned(path, line_no, preflight_concat3("unsupported package manifest section `[", section, "]`"),
+                    strdup("only the `[dependencies]` section is supported in this package manifest slice"));
+            } else {
+                rc = preflight_report(path, line_no, "invalid package manifest entry", PREFLIGHT_ENTRY_HELP);
+            }
+            free(section);
+        } else if (!preflight_assignment_ok(code)) {
+            rc = preflight_report(path, line_no, "invalid package manifest entry", PREFLIGHT_ENTRY_HELP);
+        } else {
+            char *key = preflight_assignment_key(code);
+            char *value = preflight_assignment_value(code);
+            if (!in_dependencies) {
+                rc = preflight_manifest_key(m, path, line_no, key, value);
+            } else if (str_index_get(&aliases, key) >= 0) {
+                rc = preflight_report_owned(path, line_no, preflight_concat3("duplicate local dependency alias `", key, "`"),
+                    strdup("keep exactly one path for each local dependency alias"));
+            } else {
+                lines_push(&alias_names, strdup(key));
+                str_index_put(&aliases, alias_names.items[alias_names.len - 1], 1);
+                rc = preflight_manifest_dependency(path, line_no, manifest_dir, value, stack);
+            }
+            free(key);
+            free(value);
+        }
+        free(code);
+    }
+    str_index_free(&aliases);
+    lines_free(&alias_names);
+    return rc;
+}
+
+static int preflight_manifest_roots(const char *path, const char *manifest_dir, PreflightManifest *m, int top_level, const char *entry_path) {
+    if (!m->has_name) return preflight_report(path, 1, "package manifest is missing required key `name`", PREFLIGHT_MISSING_HELP);
+    if (!m->has_version) return preflight_report(path, 1, "package manifest is missing required key `version`", PREFLIGHT_MISSING_HELP);
+    if (!m->has_source) return preflight_report(path, 1, "package manifest is missing required key `source`", PREFLIGHT_MISSING_HELP);
+    if (!preflight_path_is_safe(m->source, 1, 0)) {
+        return preflight_report(path, m->source_line, "package manifest source must be a local relative path",
+            "use a source path such as `src`; absolute paths and `..` are not supported");
+    }
+    if (m->has_assets && !preflight_path_is_safe(m->assets, 1, 0)) {
+        return preflight_report(path, m->assets_line, "package manifest assets must be a local relative path",
+            "use an assets path such as `assets`; absolute paths and `..` are not supported");
+    }
+    char *source_root = preflight_path_join(manifest_dir, m->source);
+    int rc = 0;
+    if (!preflight_exists(source_root)) {
+        rc = preflight_report_owned(path, m->source_line, strdup("package manifest source directory not found"),
+            preflight_concat3("create the source directory at ", source_root, " or update `source`."));
+    }
+    if (rc == 0 && m->has_assets) {
+        char *assets_root = preflight_path_join(manifest_dir, m->assets);
+        if (!preflight_exists(assets_root)) {
+            rc = preflight_report_owned(path, m->assets_line, strdup("package manifest assets directory not found"),
+                preflight_concat3("create the assets directory at ", assets_root, " or remove `assets`."));
+        }
+        free(assets_root);
+    }
+    if (rc == 0 && top_level && entry_path[0] != '\0' && !preflight_path_is_under(entry_path, source_root)) {
+        char *id = preflight_normalize_path(source_root);
+        rc = preflight_report_owned(path, m->source_line, strdup("package entry is outside manifest source root"),
+            preflight_concat3("compile a `.vais` file under ", id, " or update `source`."));
+        free(id);
+    }
+    free(source_root);
+    return rc;
+}
+
+static int preflight_check_manifest(const char *path, LineVec *stack, const char *entry_path) {
+    if (!preflight_exists(path)) {
+        fprintf(stderr, "error: package manifest not found: %s\n", path);
+        return 1;
+    }
+    int top_level = stack->len == 0;
+    char *text = read_file(path);
+    if (text == NULL) return 1;
+    lines_push(stack, preflight_normalize_path(path));
+    char *manifest_dir = preflight_dirname(path);
+    PreflightManifest m;
+    memset(&m, 0, sizeof(m));
+    m.source_line = 1;
+    m.assets_line = 1;
+    int rc = preflight_manifest_lines(path, text, manifest_dir, stack, &m);
+    if (rc == 0) rc = preflight_manifest_roots(path, manifest_dir, &m, top_level, entry_path);
+    free(stack->items[--stack->len]);
+    free(m.source);
+    free(m.assets);
+    free(manifest_dir);
+    free(text);
+    return rc;
+}
+
+static char *preflight_manifest_scan(const char *manifest, LineVec *aliases, LineVec *paths) {
+    char *source = NULL;
+    char *text = preflight_exists(manifest) ? read_file(manifest) : NULL;
+    if (text == NULL) return strdup("");
+    int in_dependencies = 0;
+    size_t len = strlen(text);
+    for (size_t pos = 0; pos <= len;) {
+        size_t line_end = preflight_line_end(text, pos, len);
+        char *code = preflight_code_line(text, pos, line_end);
+        pos = line_end + 1;
+        if (code[0] == '[') {
+            in_dependencies = strcmp(code, "[dependencies]") == 0;
+        } else if (code[0] != '\0' && in_dependencies) {
+            if (aliases != NULL) lines_push(aliases, preflight_assignment_key(code));
+            if (paths != NULL) lines_push(paths, preflight_assignment_value(code));
+        } else if (code[0] != '\0' && source == NULL) {
+            char *key = preflight_assignment_key(code);
+            if (strcmp(key, "source") == 0) source = preflight_assignment_value(code);
+            free(key);
+        }
+        free(code);
+        if (source != NULL && aliases == NULL && paths == NULL) break;
+    }
+    free(text);
+    return source == NULL ? strdup("") : source;
+}
+
+static void preflight_dependency_roots(PreflightGraph *g, const char *manifest_dir, LineVec *dep_paths) {
+    for (size_t i = 0; i < dep_paths->len; i++) {
+        char *dep_dir = preflight_path_join(manifest_dir, dep_paths->items[i]);
+        char *dep_manifest = preflight_path_join(dep_dir, "vais.toml");
+        char *dep_source = preflight_manifest_scan(dep_manifest, NULL, NULL);
+        char *dep_root = strdup("");
+        if (dep_source[0] != '\0') {
+            char *dep_manifest_dir = preflight_dirname(dep_manifest);
+            free(dep_root);
+            dep_root = preflight_path_join(dep_manifest_dir, dep_source);
+            free(dep_manifest_dir);
+        }
+        lines_push(&g->dep_roots, dep_root);
+        free(dep_source);
+        free(dep_manifest);
+        free(dep_dir);
+    }
+}
+
+static const char *preflight_root_for_alias(PreflightGraph *g, const char *alias, size_t alias_len) {
+    for (size_t i = 0; i < g->dep_aliases.len && i < g->dep_roots.len; i++) {
+        const char *name = g->dep_aliases.items[i];
+        if (strlen(name) == alias_len && strncmp(name, alias, alias_len) == 0) return g->dep_roots.items[i];
+    }
+    return "";
+}
+
+static const char *preflight_root_for_path(PreflightGraph *g, const char *path) {
+    for (size_t i = 0; i < g->dep_roots.len; i++) {
+        const char *root = g->dep_roots.items[i];
+        if (root[0] != '\0' && preflight_path_is_under(path, root)) return root;
+    }
+    return "";
+}
+
+static int preflight_valid_dotted_name(const char *name) {
+    int need_start = 1;
+    for (const char *p = name; *p != '\0'; p++) {
+        if (need_start) {
+            if (!is_ident_start(*p)) return 0;
+            need_start = 0;
+        } else if (*p == '.') {
+            need_start = 1;
+        } else if (!is_ident_continue(*p)) {
+            return 0;
+        }
+    }
+    return !need_start;
+}
+
+static char *preflight_module_path(const char *root, const char *name) {
+    StrBuf rel;
+    sb_init(&rel);
+    for (const char *p = name; *p != '\0'; p++) sb_append_n(&rel, *p == '.' ? "/" : p, 1);
+    sb_append(&rel, ".vais");
+    char *out = preflight_path_join(root, rel.data);
+    free(rel.data);
+    return out;
+}
+
+static char *preflight_import_name(const char *text, size_t start, size_t end) {
+    char *code = preflight_code_line(text, start, end);
+    char *name = NULL;
+    if (starts_with(code, "import ")) {
+        name = preflight_trim_n(code + 7, strlen(code + 7));
+        if (!preflight_valid_dotted_name(name)) {
+            free(name);
+            name = NULL;
+        }
+    }
+    free(code);
+    return name;
+}
+
+static char *preflight_top_symbol(const char *text, size_t start, size_t end) {
+    char *code = preflight_code_line(text, start, end);
+    const char *p = NULL;
+    if (starts_with(code, "fn ")) {
+        p = code + 3;
+    } else if (starts_with(code, "struct ")) {
+        p = code + 7;
+    } else if (starts_with(code, "enum ")) {
+        p = code + 5;
+    }
+    char *name = NULL;
+    if (p != NULL) {
+        while (preflight_is_space(*p)) p++;
+        if (is_ident_start(*p)) {
+            const char *begin = p;
+            while (is_ident_continue(*p)) p++;
+            name = substr_copy(begin, (size_t)(p - begin));
+        }
+    }
+    free(code);
+    return name;
+}
+
+static int preflight_brace_delta(const char *text, size_t start, size_t end) {
+    int delta = 0;
+    char quote = 0;
+    int escaped = 0;
+    if (end > start && text[end - 1] == '\r') end--;
+    for (size_t i = start; i < end; i++) {
+        char ch = text[i];
+        if (quote != 0) {
+            if (escaped) {
+                escaped = 0;
+            } else if (ch == '\\') {
+                escaped = 1;
+            } else if (ch == quote) {
+                quote = 0;
+            }
+        } else if (ch == '#') {
+            return delta;
+        } else if (ch == '"' || ch == '\'' || ch == '`') {
+            quote = ch;
+            escaped = 0;
+        } else if (ch == '{') {
+            delta++;
+        } else if (ch == '}') {
+            delta--;
+        }
+    }
+    return delta;
+}
+
+static int preflight_has_top_level_import(const char *text) {
+    if (!starts_with(text, "import ") && strstr(text, "\nimport ") == NULL) return 0;
+    size_t len = strlen(text);
+    int depth = 0;
+    for (size_t pos = 0; pos <= len;) {
+        size_t line_end = preflight_line_end(text, pos, len);
+        if (depth == 0) {
+            char *name = preflight_import_name(text, pos, line_end);
+            if (name != NULL) {
+                free(name);
+                return 1;
+            }
+        }
+        depth += preflight_brace_delta(text, pos, line_end);
+        if (depth < 0) depth = 0;
+        pos = line_end + 1;
+    }
+    return 0;
+}
+
+static char *preflight_import_target(PreflightGraph *g, const char *path, const char *name) {
+    const char *current_root = g->root;
+    const char *dep_root = preflight_root_for_path(g, path);
+    if (dep_root[0] != '\0') current_root = dep_root;
+    char *local = preflight_module_path(current_root, name);
+    if (preflight_exists(local)) return local;
+    if (strcmp(current_root, g->root) == 0) {
+        const char *dot = strchr(name, '.');
+        const char *alias_root = preflight_root_for_alias(g, name, dot == NULL ? strlen(name) : (size_t)(dot - name));
+        if (alias_root[0] != '\0' && dot != NULL && dot[1] != '\0') {
+            free(local);
+            return preflight_module_path(alias_root, dot + 1);
+        }
+    }
+    return local;
+}
+
+static int preflight_graph_symbols(PreflightGraph *g, const char *path, const char *text) {
+    size_t len = strlen(text);
+    int depth = 0;
+    int line_no = 1;
+    for (size_t pos = 0; pos <= len; line_no++) {
+        size_t line_end = preflight_line_end(text, pos, len);
+        if (depth == 0) {
+            char *symbol = preflight_top_symbol(text, pos, line_end);
+            if (symbol != NULL && str_index_get(&g->symbol_index, symbol) >= 0) {
+                return preflight_report_owned(path, line_no, preflight_concat3("duplicate top-level symbol `", symbol, "`"),
+                    strdup("first definition already loaded in the import graph"));
+            }
+            if (symbol != NULL) {
+                lines_push(&g->symbols, symbol);
+                str_index_put(&g->symbol_index, symbol, 1);
+            }
+        }
+        depth += preflight_brace_delta(text, pos, line_end);
+        if (depth < 0) depth = 0;
+        pos = line_end + 1;
+    }
+    return 0;
+}
+
+static int preflight_graph_imports(PreflightGraph *g, const char *path, const char *text) {
+    size_t len = strlen(text);
+    int depth = 0;
+    int line_no = 1;
+    for (size_t pos = 0; pos <= len; line_no++) {
+        size_t line_end = preflight_line_end(text, pos, len);
+        if (depth == 0) {
+            char *name = preflight_import_name(text, pos, line_end);
+            if (name != NULL) {
+                char *target = preflight_import_target(g, path, name);
+                int rc = 0;
+                if (!preflight_exists(target)) {
+                    rc = preflight_report_owned(path, line_no, strdup("missing import path"), preflight_concat3("expected import at ", target, ""));
+                } else {
+                    rc = preflight_check_file(g, target);
+                }
+                free(target);
+                free(name);
+                if (rc != 0) return rc;
+            }
+        }
+        depth += preflight_brace_delta(text, pos, line_end);
+        if (depth < 0) depth = 0;
+        pos = line_end + 1;
+    }
+    return 0;
+}
+
+static int preflight_check_file(PreflightGraph *g, const char *path) {
+    if (!preflight_exists(path)) {
+        fprintf(stderr, "error: source file not found: %s\n", path);
+        return 1;
+    }
+    char *id = preflight_normalize_path(path);
+    if (preflight_stack_contains(&g->stack, path)) {
+        preflight_report_owned(path, 1, strdup("import cycle detected"), preflight_concat3("remove one import from the cycle ending at ", id, ""));
+        free(id);
+        return 1;
+    }
+    if (str_index_get(&g->visited_index, id) >= 0) {
+        free(id);
+        return 0;
+    }
+    lines_push(&g->visited, id);
+    str_index_put(&g->visited_index, id, 1);
+    char *text = read_file(path);
+    if (text == NULL) return 1;
+    lines_push(&g->stack, strdup(id));
+    int rc = preflight_graph_symbols(g, path, text);
+    if (rc == 0) rc = preflight_graph_imports(g, path, text);
+    free(g->stack.items[--g->stack.len]);
+    free(text);
+    return rc;
+}
+
+static char *preflight_find_manifest(const char *start_dir) {
+    char *dir = strdup(start_dir);
+    while (dir[0] != '\0') {
+        char *candidate = preflight_path_join(dir, "vais.toml");
+        if (preflight_exists(candidate)) {
+            free(dir);
+            return candidate;
+        }
+        free(candidate);
+        char *parent = preflight_dirname(dir);
+        if (strcmp(parent, dir) == 0) {
+            free(parent);
+            break;
+        }
+        free(dir);
+        dir = parent;
+    }
+    free(dir);
+    return NULL;
+}
+
+static int preflight_check_import_graph(const char *entry) {
+    char *entry_dir = preflight_dirname(entry);
+    char *manifest = preflight_find_manifest(entry_dir);
+    PreflightGraph g;
+    memset(&g, 0, sizeof(g));
+    lines_init(&g.dep_aliases);
+    lines_init(&g.dep_roots);
+    lines_init(&g.stack);
+    lines_init(&g.visited);
+    lines_init(&g.symbols);
+    char *root = strdup(entry_dir);
+    if (manifest != NULL) {
+        char *manifest_dir = preflight_dirname(manifest);
+        LineVec dep_paths;
+        lines_init(&dep_paths);
+        char *source = preflight_manifest_scan(manifest, &g.dep_aliases, &dep_paths);
+        if (source[0] != '\0') {
+            free(root);
+            root = preflight_path_join(manifest_dir, source);
+        }
+        preflight_dependency_roots(&g, manifest_dir, &dep_paths);
+        lines_free(&dep_paths);
+        free(source);
+        free(manifest_dir);
+    }
+    g.root = root;
+    int rc = 0;
+    if (!preflight_exists(entry)) {
+        fprintf(stderr, "error: source file not found: %s\n", entry);
+        rc = 1;
+    } else {
+        char *text = read_file(entry);
+        if (text == NULL) {
+            rc = 1;
+        } else if (preflight_has_top_level_import(text)) {
+            rc = preflight_check_file(&g, entry);
+        }
+        free(text);
+    }
+    lines_free(&g.dep_aliases);
+    lines_free(&g.dep_roots);
+    lines_free(&g.stack);
+    lines_free(&g.visited);
+    str_index_free(&g.visited_index);
+    lines_free(&g.symbols);
+    str_index_free(&g.symbol_index);
+    free(root);
+    free(manifest);
+    free(entry_dir);
+    return rc;
+}
+
+static char *preflight_nearest_manifest(const char *source_dir) {
+    char *dir = strdup(source_dir);
+    for (;;) {
+        char *candidate = path_join2(dir, "vais.toml");
+        if (path_is_regular_file_c(candidate)) {
+            free(dir);
+            return candidate;
+        }
+        free(candidate);
+        char *parent = preflight_dirname(dir);
+        if (strcmp(parent, dir) == 0) {
+            free(parent);
+            free(dir);
+            return NULL;
+        }
+        free(dir);
+        dir = parent;
+    }
+}
+
+void run_vais_preflight(const char *source) {
+    const char *off = getenv("VAISC_NO_PREFLIGHT");
+    if (off != NULL && strcmp(off, "1") == 0) return;
+    if (!has_vais_suffix(source) || !path_is_regular_file_c(source)) return;
+    char *source_dir = preflight_dirname(source);
+    char *real_dir = canonical_existing_path(source_dir);
+    free(source_dir);
+    char *checked = real_dir != NULL ? path_join2(real_dir, path_basename_ptr(source)) : strdup(source);
+    if (strstr(checked, "/compiler/self/") != NULL) {
+        free(checked);
+        free(real_dir);
+        return;
+    }
+    int phase = stats_phase_begin("preflight", stats_file_size(checked));
+    char *manifest = real_dir != NULL ? preflight_nearest_manifest(real_dir) : NULL;
+    if (manifest != NULL) {
+        LineVec stack;
+        lines_init(&stack);
+        preflight_check_manifest(manifest, &stack, checked);
+        lines_free(&stack);
+    }
+    preflight_check_import_graph(checked);
+    stats_phase_end(phase, 0);
+    free(manifest);
+    free(checked);
+    free(real_dir);
+}
+
+char *prepare_source_file(const char *path) {
+    return prepare_resolved_source(path, NULL);
+}
+
+/* Prepares path from its already merged module graph (freed here), or
+   resolves it first when merged is NULL. */
+char *prepare_resolved_source(const char *path, char *merged) {
+    if (!has_vais_suffix(path)) {
+        fprintf(stderr, "error: Vais source files must use the .vais extension: %s\n", path);
+        free(merged);
+        return NULL;
+    }
+    int trusted_self_host = is_trusted_self_host_source(path);
+    if (merged == NULL) merged = resolve_module_graph_source_timed(path);
+    if (merged == NULL) return NULL;
+    int prepare_phase = stats_phase_begin("prepare", strlen(merged));
+    SourceLines src;
+    source_lines_init(&src, merged);
+    free(merged);
+    if (!trusted_self_host) {
+        int phase = stats_phase_begin("check_option_result_generic_surface", source_lines_bytes(&src));
+        int rc = check_option_result_generic_surface_lines(&src, path);
+        stats_phase_end(phase, 0);
+        if (rc != 0) {
+            stats_phase_end(prepare_phase, 0);
+            source_lines_free(&src);
+            return NULL;
+        }
+    }
+    run_source_pass(&src, "normalize_source", normalize_surface_lines);
+    run_source_pass(&src, "split_statement_lines", split_statement_lines);
+    run_source_pass(&src, "lower_self_recursion", lower_self_recursion_lines);
+    run_source_pass(&src, "lower_map_str_str_get_opt_embedded_match", lower_map_str_str_get_opt_embedded_match_lines);
+    run_source_pass(&src, "lower_result_str_int", lower_result_str_int_lines);
+    run_source_pass(&src, "lower_result_str_str", lower_result_str_str_lines);
+    run_source_pass(&src, "lower_enum", lower_enum_lines);
+    run_source_pass(&src, "lower_closure", lower_closure_lines);
+    run_source_pass(&src, "lower_list_method", lower_list_method_lines);
+    run_source_pass(&src, "lower_nested_list", lower_nested_list_lines);
+    run_source_pass(&src, "lower_tuple", lower_tuple_lines);
+    run_source_pass(&src, "lower_struct_method", lower_struct_method_lines);
+    if (!trusted_self_host) {
+        int phase = stats_phase_begin("check_front_contract", source_lines_bytes(&src));
+        int rc = check_front_contract_lines(&src, path);
+        stats_phase_end(phase, 0);
+        if (rc != 0) {
+            stats_phase_end(prepare_phase, 0);
+            source_lines_free(&src);
+            return NULL;
+        }
+    }
+    run_source_pass(&src, "lower_generic_identity_struct", lower_generic_identity_struct_lines);
+    run_source_pass(&src, "normalize_core", normalize_core_lines);
+    char *prepared = source_lines_take(&src);
+    stats_phase_end(prepare_phase, strlen(prepared));
+    return prepared;
+}
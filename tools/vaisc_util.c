@@ -0,0 +1,859 @@
+/* String buffers, line lists, file and process helpers, and phase stats. */
+#include "vaisc_native.h"
+
+/* Bootstrap-safe real symbol: a core .ll regenerated by an older driver still
+   declares (rather than internally defines) @vais_list_trap, so the driver
+   link keeps this fallback. Converged cores carry their own internal define,
+   which shadows this for emitted modules. */
+void vais_list_trap(int64_t kind) {
+    if (kind == 3) fprintf(stderr, "vais list trap: allocation failed\n");
+    else if (kind == 2) fprintf(stderr, "vais list trap: empty-list access\n");
+    else fprintf(stderr, "vais list trap: index out of range\n");
+    abort();
+}
+
+const char *HOST_INTRINSIC_IR =
+    "declare i64 @fs_exists(i8*)\n"
+    "declare i64 @fs_is_dir(i8*)\n"
+    "declare i64 @fs_list_files(i8*, i64*)\n"
+    "declare i64 @fs_list_dirs(i8*, i64*)\n"
+    "declare i8* @fs_read_text(i8*)\n"
+    "declare i8* @fs_map_text(i8*)\n"
+    "declare i64 @fs_lines_open(i8*)\n"
+    "declare i64 @fs_lines_next(i64)\n"
+    "declare i8* @fs_lines_text(i64)\n"
+    "declare i64 @fs_lines_close(i64)\n"
+    "declare i8* @fs_cwd()\n"
+    "declare i8* @stdin_read_all()\n"
+    "declare i8* @proc_self()\n"
+    "declare i64 @stdout_write(i8*)\n"
+    "declare i64 @stderr_write(i8*)\n"
+    "declare i8* @fs_temp_dir()\n"
+    "declare i8* @path_join(i8*, i8*)\n"
+    "declare i8* @path_basename(i8*)\n"
+    "declare i8* @path_dirname(i8*)\n"
+    "declare i64 @time_millis()\n"
+    "declare i64 @time_nanos()\n"
+    "declare i8* @str_concat(i8*, i8*)\n"
+    "declare i64 @str_cmp(i8*, i8*)\n"
+    "declare i8* @str_slice(i8*, i64, i64)\n"
+    "declare i8* @str_byte(i64)\n"
+    "declare i64 @str_builder_new()\n"
+    "declare i64 @str_builder_push(i64, i64)\n"
+    "declare i64 @str_builder_append(i64, i8*)\n"
+    "declare i8* @str_builder_finish(i64)\n"
+    "declare i64 @index_new()\n"
+    "declare i64 @index_add_doc(i64, i64, i8*)\n"
+    "declare i64 @index_add_term(i64, i64, i8*, i64)\n"
+    "declare i64 @index_remove_doc(i64, i64)\n"
+    "declare i64 @index_doc_count(i64)\n"
+    "declare i64 @index_top_k(i64, i8*, i64)\n"
+    "declare i64 @index_hit_doc(i64, i64)\n"
+    "declare i64 @index_hit_score(i64, i64)\n"
+    "declare i64 @snap_open(i8*)\n"
+    "declare i64 @snap_close(i64)\n"
+    "declare i8* @snap_get(i64, i8*, i8*)\n"
+    "declare i64 @snap_has(i64, i8*)\n"
+    "declare i64 @snap_put(i64, i8*, i8*)\n"
+    "declare i64 @snap_remove(i64, i8*)\n"
+    "declare i64 @snap_len(i64)\n"
+    "declare i64 @snap_log_len(i64)\n"
+    "declare i64 @snap_version(i64)\n"
+    "declare i64 @snap_set_version(i64, i64)\n"
+    "declare i8* @snap_key_at(i64, i64)\n"
+    "declare i8* @snap_value_at(i64, i64)\n"
+    "declare i64 @snap_compact(i64)\n"
+    "declare i64 @vais_par_begin(i64, i64)\n"
+    "declare i64 @vais_par_next(i64, i64, i64, i64)\n"
+    "declare i64 @vais_par_wait(i64)\n"
+    "declare i64 @vais_par_reduce(i64, i64)\n"
+    "declare i64 @fs_write_text(i8*, i8*)\n"
+    "declare i64 @fs_mkdirs(i8*)\n"
+    "declare i64 @fs_remove(i8*)\n"
+    "declare i64 @proc_argc()\n"
+    "declare i8* @proc_arg(i64)\n"
+    "declare i8* @proc_capture_stdout(i64*)\n"
+    "declare i8* @proc_capture_stderr(i64*)\n"
+    "declare i64 @proc_capture_to(i64*, i8*, i8*)\n"
+    "declare void @proc_capture(i64*, i64*)\n"
+    "declare i64 @proc_run(i64*)\n"
+    "declare i64 @proc_run_env(i64*, i64*)\n"
+    "declare i64 @proc_spawn(i64*)\n"
+    "declare i64 @proc_spawn_to(i64*, i8*, i8*)\n"
+    "declare i64 @proc_wait(i64)\n"
+    "declare i64 @proc_wait_any()\n"
+    "declare i64 @__vais_prof_fn(i64, i8*)\n"
+    "declare i64 @__vais_prof_loop(i64, i8*)\n"
+    "declare i64 @__vais_prof_iter(i64)\n"
+    "declare i64 @__vais_prof_loop_end(i64)\n"
+    "declare i64 @__vais_prof_site(i64, i8*)\n"
+    "declare i64 @__vais_prof_depth()\n"
+    "declare i64 @__vais_prof_leave(i64)\n"
+    "declare i8* @__vais_prof_malloc(i64)\n"
+    "declare i8* @__vais_prof_calloc(i64, i64)\n"
+    "declare i8* @__vais_prof_realloc(i8*, i64)\n";
+
+StrBuf *direct_current_prelude = NULL;
+
+char vaisc_tmp_root[512];
+
+int vaisc_tmp_root_ready = 0;
+
+int vaisc_tmp_counter = 0;
+
+int vaisc_keep_tmp = 0;
+
+/* Optimization level for build/run/package; -1 until `--profile`, `--release`,
+   `-O<n>`, or a package manifest `profile` picks one (debug / -O0 otherwise). */
+int vaisc_opt_level = -1;
+
+/* Set by build/package when the direct engine links the cached runtime object
+   instead of inlining the fixed prelude into each lowered program. */
+int vaisc_direct_runtime_split = 0;
+
+/* Symbol the emitted module gives the program entrypoint. build/package set
+   vais_user_main so the host runtime's main can call it; each vais_emit_entry
+   call bumps vaisc_entry_count so a build can insist on exactly one. */
+const char *vaisc_entry_symbol = "main";
+
+int vaisc_entry_count = 0;
+
+/* `--no-cache` (or VAISC_NO_CACHE=1) skips the content-addressed build cache. */
+int vaisc_no_cache = 0;
+
+/* `--instrument` has the resolver insert __vais_prof_* markers into every
+   module and the engines wrap functions and allocations, so the built program
+   writes a source-level profile when it exits. */
+int vaisc_instrument = 0;
+
+const char *vaisc_argv0 = "vaisc";
+
+/* `--time-passes` (1) prints a per-phase table and `--stats=json` (2) one JSON
+   line to stderr when the command exits; 0 records nothing. */
+int vaisc_stats_mode = 0;
+
+void die_oom(void) {
+    fprintf(stderr, "error: out of memory\n");
+    exit(1);
+}
+
+void sb_init(StrBuf *sb) {
+    sb->cap = 4096;
+    sb->len = 0;
+    sb->data = (char *)malloc(sb->cap);
+    if (sb->data == NULL) die_oom();
+    sb->data[0] = '\0';
+}
+
+void sb_reserve(StrBuf *sb, size_t need) {
+    if (need <= sb->cap) return;
+    while (sb->cap < need) sb->cap *= 2;
+    char *next = (char *)realloc(sb->data, sb->cap);
+    if (next == NULL) die_oom();
+    sb->data = next;
+}
+
+void sb_append_n(StrBuf *sb, const char *text, size_t n) {
+    sb_reserve(sb, sb->len + n + 1);
+    memcpy(sb->data + sb->len, text, n);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+}
+
+void sb_append(StrBuf *sb, const char *text) {
+    sb_append_n(sb, text, strlen(text));
+}
+
+char *sb_take(StrBuf *sb) {
+    char *out = sb->data;
+    sb->data = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+    return out;
+}
+
+void lines_init(LineVec *lv) {
+    lv->len = 0;
+    lv->cap = 32;
+    lv->items = (char **)calloc(lv->cap, sizeof(char *));
+    if (lv->items == NULL) die_oom();
+}
+
+void lines_push(LineVec *lv, char *line) {
+    if (lv->len + 1 > lv->cap) {
+        lv->cap *= 2;
+        char **next = (char **)realloc(lv->items, lv->cap * sizeof(char *));
+        if (next == NULL) die_oom();
+        lv->items = next;
+    }
+    lv->items[lv->len++] = line;
+}
+
+void lines_free(LineVec *lv) {
+    for (size_t i = 0; i < lv->len; i++) free(lv->items[i]);
+    free(lv->items);
+    lv->items = NULL;
+    lv->len = 0;
+    lv->cap = 0;
+}
+
+LineVec split_lines(const char *text) {
+    LineVec lv;
+    lines_init(&lv);
+    const char *line = text;
+    while (*line != '\0') {
+        const char *end = strchr(line, '\n');
+        size_t n = end ? (size_t)(end - line) : strlen(line);
+        char *copy = (char *)malloc(n + 1);
+        if (copy == NULL) die_oom();
+        memcpy(copy, line, n);
+        copy[n] = '\0';
+        lines_push(&lv, copy);
+        if (end == NULL) break;
+        line = end + 1;
+    }
+    return lv;
+}
+
+char *join_lines(LineVec *lv, int trailing_newline) {
+    StrBuf out;
+    sb_init(&out);
+    for (size_t i = 0; i < lv->len; i++) {
+        sb_append(&out, lv->items[i]);
+        if (i + 1 < lv->len || trailing_newline) sb_append(&out, "\n");
+    }
+    return sb_take(&out);
+}
+
+uint64_t str_hash64(const char *text) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int str_index_get(const StrIndex *ix, const char *key) {
+    if (ix->cap == 0) return -1;
+    uint64_t h = str_hash64(key);
+    for (size_t i = (size_t)h & (ix->cap - 1);; i = (i + 1) & (ix->cap - 1)) {
+        const StrIndexSlot *slot = &ix->slots[i];
+        if (slot->key == NULL) return -1;
+        if (slot->hash == h && strcmp(slot->key, key) == 0) return slot->value;
+    }
+}
+
+void str_index_put(StrIndex *ix, const char *key, int value) {
+    if ((ix->len + 1) * 4 > ix->cap * 3) {
+        size_t cap = ix->cap == 0 ? 64 : ix->cap * 2;
+        StrIndexSlot *slots = (StrIndexSlot *)calloc(cap, sizeof(StrIndexSlot));
+        if (slots == NULL) die_oom();
+        for (size_t i = 0; i < ix->cap; i++) {
+            if (ix->slots[i].key == NULL) continue;
+            size_t j = (size_t)ix->slots[i].hash & (cap - 1);
+            while (slots[j].key != NULL) j = (j + 1) & (cap - 1);
+            slots[j] = ix->slots[i];
+        }
+        free(ix->slots);
+        ix->slots = slots;
+        ix->cap = cap;
+    }
+    uint64_t h = str_hash64(key);
+    size_t i = (size_t)h & (ix->cap - 1);
+    while (ix->slots[i].key != NULL) {
+        if (ix->slots[i].hash == h && strcmp(ix->slots[i].key, key) == 0) {
+            ix->slots[i].value = value;
+            return;
+        }
+        i = (i + 1) & (ix->cap - 1);
+    }
+    ix->slots[i].key = key;
+    ix->slots[i].hash = h;
+    ix->slots[i].value = value;
+    ix->len++;
+}
+
+void str_index_free(StrIndex *ix) {
+    free(ix->slots);
+    ix->slots = NULL;
+    ix->cap = 0;
+    ix->len = 0;
+}
+
+static VaiscPhaseStat vaisc_phases[VAISC_MAX_PHASES];
+
+static int vaisc_phase_count = 0;
+
+static int vaisc_phase_depth = 0;
+
+double vaisc_stats_start_ms = 0.0;
+
+const char *vaisc_stats_command = "";
+
+double vaisc_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+/* Cumulative high-water mark so far, of vaisc itself or of the largest
+   waited-for child; ru_maxrss is bytes on macOS, KiB elsewhere. */
+static long vaisc_peak_rss_kb(int who) {
+    struct rusage ru;
+    if (getrusage(who, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;
+#else
+    return ru.ru_maxrss;
+#endif
+}
+
+static int stats_phase_begin_as(const char *name, size_t bytes_in, int children) {
+    if (vaisc_stats_mode == 0 || vaisc_phase_count >= VAISC_MAX_PHASES) return -1;
+    VaiscPhaseStat *ph = &vaisc_phases[vaisc_phase_count];
+    ph->name = name;
+    ph->children = children;
+    ph->depth = vaisc_phase_depth++;
+    ph->bytes_in = bytes_in;
+    ph->bytes_out = 0;
+    ph->wall_ms = 0.0;
+    ph->peak_rss_kb = 0;
+    ph->start_ms = vaisc_now_ms();
+    return vaisc_phase_count++;
+}
+
+int stats_phase_begin(const char *name, size_t bytes_in) {
+    return stats_phase_begin_as(name, bytes_in, 0);
+}
+
+/* For phases whose work happens in a spawned clang or user program: they
+   report the children's high-water mark, since vaisc's own barely moves. */
+int stats_child_phase_begin(const char *name, size_t bytes_in) {
+    return stats_phase_begin_as(name, bytes_in, 1);
+}
+
+void stats_phase_end(int index, size_t bytes_out) {
+    if (index < 0) return;
+    VaiscPhaseStat *ph = &vaisc_phases[index];
+    ph->wall_ms = vaisc_now_ms() - ph->start_ms;
+    ph->bytes_out = bytes_out;
+    ph->peak_rss_kb = vaisc_peak_rss_kb(ph->children ? RUSAGE_CHILDREN : RUSAGE_SELF);
+    vaisc_phase_depth = ph->depth;
+}
+
+size_t stats_file_size(const char *path) {
+    struct stat st;
+    if (path == NULL || stat(path, &st) != 0) return 0;
+    return (size_t)st.st_size;
+}
+
+void stats_report(void) {
+    double total_ms = vaisc_now_ms() - vaisc_stats_start_ms;
+    long peak = vaisc_peak_rss_kb(RUSAGE_SELF);
+    long child_peak = vaisc_peak_rss_kb(RUSAGE_CHILDREN);
+    if (vaisc_stats_mode == 2) {
+        fprintf(stderr, "{\"vaisc\":\"%s\",\"command\":\"%s\",\"total_ms\":%.3f,\"peak_rss_kb\":%ld,\"children_peak_rss_kb\":%ld,\"phases\":[",
+            VAIS_VERSION, vaisc_stats_command, total_ms, peak, child_peak);
+        for (int i = 0; i < vaisc_phase_count; i++) {
+            VaiscPhaseStat *ph = &vaisc_phases[i];
+            fprintf(stderr, "%s{\"name\":\"%s\",\"depth\":%d,\"wall_ms\":%.3f,\"bytes_in\":%zu,\"bytes_out\":%zu,\"process_peak_rss_kb\":%ld,\"rss_of\":\"%s\"}",
+                i == 0 ? "" : ",", ph->name, ph->depth, ph->wall_ms, ph->bytes_in, ph->bytes_out, ph->peak_rss_kb,
+                ph->children ? "children" : "self");
+        }
+        fprintf(stderr, "]}\n");
+        return;
+    }
+    fprintf(stderr, "vaisc %s time-passes (%s)\n", VAIS_VERSION, vaisc_stats_command);
+    fprintf(stderr, "  %-44s %10s %12s %12s %10s %s\n", "phase", "wall ms", "bytes in", "bytes out", "hwm KiB", "hwm of");
+    for (int i = 0; i < vaisc_phase_count; i++) {
+        VaiscPhaseStat *ph = &vaisc_phases[i];
+        int indent = ph->depth * 2;
+        fprintf(stderr, "  %*s%-*s %10.3f %12zu %12zu %10ld %s\n", indent, "", 44 - indent, ph->name,
+            ph->wall_ms, ph->bytes_in, ph->bytes_out, ph->peak_rss_kb, ph->children ? "children" : "self");
+    }
+    fprintf(stderr, "  %-44s %10.3f %12s %12s %10ld %s\n", "total", total_ms, "", "", peak, "self");
+    fprintf(stderr, "  %-44s %10s %12s %12s %10ld %s\n", "", "", "", "", child_peak, "children");
+    fprintf(stderr, "  hwm KiB is a cumulative high-water mark when the phase ended (of vaisc, or of the\n"
+                    "  largest child it waited for); it never goes down and is not the phase's own use\n");
+}
+
+void source_lines_init(SourceLines *src, const char *text) {
+    size_t n = strlen(text);
+    src->lines = split_lines(text);
+    src->trailing_newline = n > 0 && text[n - 1] == '\n';
+    src->text = NULL;
+}
+
+const char *source_lines_text(SourceLines *src) {
+    if (src->text == NULL) src->text = join_lines(&src->lines, src->trailing_newline);
+    return src->text;
+}
+
+/*
+ * Take ownership of a pass's output. Output items may carry embedded
+ * newlines (statement splitting emits several lines per input line) and a
+ * final empty item without a trailing newline disappears on the next split,
+ * so both are folded back into canonical split_lines() form here.
+ */
+void source_lines_replace(SourceLines *src, LineVec *out, int trailing_newline) {
+    free(src->text);
+    src->text = NULL;
+    if (out->items != src->lines.items) {
+        for (size_t i = 0; i < src->lines.len; i++) free(src->lines.items[i]);
+        free(src->lines.items);
+    }
+    src->lines = *out;
+    src->trailing_newline = trailing_newline;
+    out->items = NULL;
+    out->len = 0;
+    out->cap = 0;
+    int embedded = 0;
+    for (size_t i = 0; i < src->lines.len && !embedded; i++) {
+        if (strchr(src->lines.items[i], '\n') != NULL) embedded = 1;
+    }
+    if (embedded) {
+        LineVec flat;
+        lines_init(&flat);
+        for (size_t i = 0; i < src->lines.len; i++) {
+            char *item = src->lines.items[i];
+            if (strchr(item, '\n') == NULL) {
+                lines_push(&flat, item);
+                continue;
+            }
+            const char *piece = item;
+            for (;;) {
+                const char *end = strchr(piece, '\n');
+                size_t n = end ? (size_t)(end - piece) : strlen(piece);
+                char *copy = (char *)malloc(n + 1);
+                if (copy == NULL) die_oom();
+                memcpy(copy, piece, n);
+                copy[n] = '\0';
+                lines_push(&flat, copy);
+                if (end == NULL) break;
+                piece = end + 1;
+            }
+            free(item);
+        }
+        free(src->lines.items);
+        src->lines = flat;
+    }
+    if (src->lines.len > 0 && !src->trailing_newline &&
+        src->lines.items[src->lines.len - 1][0] == '\0') {
+        free(src->lines.items[--src->lines.len]);
+        src->trailing_newline = 1;
+    }
+}
+
+char *source_lines_take(SourceLines *src) {
+    char *text = src->text != NULL ? src->text : join_lines(&src->lines, src->trailing_newline);
+    src->text = NULL;
+    lines_free(&src->lines);
+    return text;
+}
+
+void source_lines_free(SourceLines *src) {
+    free(src->text);
+    src->text = NULL;
+    lines_free(&src->lines);
+}
+
+size_t source_lines_bytes(const SourceLines *src) {
+    size_t n = 0;
+    for (size_t i = 0; i < src->lines.len; i++) n += strlen(src->lines.items[i]) + 1;
+    if (n > 0 && !src->trailing_newline) n--;
+    return n;
+}
+
+void run_source_pass(SourceLines *src, const char *name, void (*pass)(SourceLines *)) {
+    if (vaisc_stats_mode == 0) {
+        pass(src);
+        return;
+    }
+    int phase = stats_phase_begin(name, source_lines_bytes(src));
+    pass(src);
+    stats_phase_end(phase, source_lines_bytes(src));
+}
+
+int starts_with(const char *s, const char *prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+int is_ident_start(char ch) {
+    return (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || ch == '_';
+}
+
+int is_ident_continue(char ch) {
+    return is_ident_start(ch) || (ch >= '0' && ch <= '9');
+}
+
+char *read_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "error: cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0) {
+        fprintf(stderr, "error: cannot seek %s\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    long size = ftell(fp);
+    if (size < 0) {
+        fprintf(stderr, "error: cannot size %s\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "error: cannot rewind %s\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    char *buf = (char *)malloc((size_t)size + 1);
+    if (buf == NULL) die_oom();
+    size_t nread = fread(buf, 1, (size_t)size, fp);
+    if (nread != (size_t)size) {
+        fprintf(stderr, "error: short read for %s\n", path);
+        free(buf);
+        fclose(fp);
+        return NULL;
+    }
+    buf[size] = '\0';
+    fclose(fp);
+    return buf;
+}
+
+int write_file_text(const char *path, const char *text) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "error: cannot write %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (fputs(text, fp) < 0) {
+        fprintf(stderr, "error: cannot write %s: %s\n", path, strerror(errno));
+        fclose(fp);
+        return 1;
+    }
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "error: cannot close %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+int has_vais_suffix(const char *path) {
+    size_t n = strlen(path);
+    return n >= 5 && strcmp(path + n - 5, ".vais") == 0;
+}
+
+char *strip_line_comment(const char *line, size_t n) {
+    StrBuf out;
+    sb_init(&out);
+    char delim = '\0';
+    int escaped = 0;
+    for (size_t i = 0; i < n; i++) {
+        char ch = line[i];
+        if (escaped) {
+            sb_append_n(&out, &ch, 1);
+            escaped = 0;
+            continue;
+        }
+        if ((delim == '"' || delim == '\'') && ch == '\\') {
+            sb_append_n(&out, &ch, 1);
+            escaped = 1;
+            continue;
+        }
+        if (ch == '"' || ch == '`') {
+            if (delim == '\0') delim = ch;
+            else if (delim == ch) delim = '\0';
+            sb_append_n(&out, &ch, 1);
+            continue;
+        }
+        if (delim == '\0' && ch == '#') break;
+        sb_append_n(&out, &ch, 1);
+    }
+    while (out.len > 0 && (out.data[out.len - 1] == ' ' || out.data[out.len - 1] == '\t' || out.data[out.len - 1] == '\r')) {
+        out.len--;
+        out.data[out.len] = '\0';
+    }
+    return out.data;
+}
+
+const char *skip_ws(const char *p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    return p;
+}
+
+static int line_starts_stmt(const char *s, const char *word) {
+    s = skip_ws(s);
+    size_t n = strlen(word);
+    if (strncmp(s, word, n) != 0) return 0;
+    char next = s[n];
+    return next == '\0' || next == ' ' || next == '\t' || next == '(';
+}
+
+static const char *skip_index_brackets_for_stmt(const char *p) {
+    int depth = 0;
+    char delim = '\0';
+    int escaped = 0;
+    while (*p != '\0') {
+        char ch = *p;
+        if (escaped) {
+            escaped = 0;
+        } else if ((delim == '"' || delim == '\'') && ch == '\\') {
+            escaped = 1;
+        } else if (ch == '"' || ch == '\'' || ch == '`') {
+            if (delim == '\0') delim = ch;
+            else if (delim == ch) delim = '\0';
+        } else if (delim == '\0') {
+            if (ch == '[') depth++;
+            else if (ch == ']') {
+                depth--;
+                if (depth == 0) return p + 1;
+            }
+        }
+        p++;
+    }
+    return NULL;
+}
+
+static int indexed_lvalue_needs_semicolon(const char *p) {
+    int saw_index = 0;
+    while (1) {
+        p = skip_ws(p);
+        if (*p == '[') {
+            p = skip_index_brackets_for_stmt(p);
+            if (p == NULL) return 0;
+            saw_index = 1;
+        } else if (*p == '.') {
+            p++;
+            p = skip_ws(p);
+            if (!is_ident_start(*p)) return 0;
+            while (is_ident_continue(*p)) p++;
+        } else {
+            break;
+        }
+    }
+    return saw_index && *p == '=' && p[1] != '=' && p[1] != '>';
+}
+
+int statement_needs_semicolon(const char *line) {
+    const char *s = skip_ws(line);
+    size_t n = strlen(s);
+    if (n == 0) return 0;
+    if (s[n - 1] == ';' || s[n - 1] == '{' || s[n - 1] == ',' || strcmp(s, "{") == 0 || strcmp(s, "}") == 0) return 0;
+    if (starts_with(s, "fn ") || starts_with(s, "struct ") || starts_with(s, "enum ") ||
+        starts_with(s, "if ") || starts_with(s, "else") || starts_with(s, "while ") || starts_with(s, "for ")) {
+        return 0;
+    }
+    if (line_starts_stmt(s, "let") || line_starts_stmt(s, "return") ||
+        starts_with(s, "print(") || starts_with(s, "putchar(") || starts_with(s, "puts(")) {
+        return 1;
+    }
+    if (is_ident_start(*s)) {
+        const char *p = s;
+        while (is_ident_continue(*p) || *p == '.') p++;
+        p = skip_ws(p);
+        if ((*p == '=' && p[1] != '=' && p[1] != '>') || *p == '(') return 1;
+        if (indexed_lvalue_needs_semicolon(p)) return 1;
+    }
+    return 0;
+}
+
+int square_depth_after_text(const char *text, int depth) {
+    char delim = '\0';
+    int escaped = 0;
+    for (int i = 0; text[i] != '\0'; i++) {
+        char ch = text[i];
+        if (escaped) {
+            escaped = 0;
+        } else if ((delim == '"' || delim == '\'') && ch == '\\') {
+            escaped = 1;
+        } else if (ch == '"' || ch == '\'' || ch == '`') {
+            if (delim == '\0') delim = ch;
+            else if (delim == ch) delim = '\0';
+        } else if (delim == '\0') {
+            if (ch == '[') depth++;
+            else if (ch == ']' && depth > 0) depth--;
+        }
+    }
+    return depth;
+}
+
+void paren_square_depth_after_text(const char *text, int *paren_depth, int *square_depth) {
+    char delim = '\0';
+    int escaped = 0;
+    for (int i = 0; text[i] != '\0'; i++) {
+        char ch = text[i];
+        if (escaped) {
+            escaped = 0;
+        } else if ((delim == '"' || delim == '\'') && ch == '\\') {
+            escaped = 1;
+        } else if (ch == '"' || ch == '\'' || ch == '`') {
+            if (delim == '\0') delim = ch;
+            else if (delim == ch) delim = '\0';
+        } else if (delim == '\0') {
+            if (ch == '(') (*paren_depth)++;
+            else if (ch == ')' && *paren_depth > 0) (*paren_depth)--;
+            else if (ch == '[') (*square_depth)++;
+            else if (ch == ']' && *square_depth > 0) (*square_depth)--;
+        }
+    }
+}
+
+static int should_strip_struct_field_type(const char *start, const char *end) {
+    while (start < end && (*start == ' ' || *start == '\t' || *start == '\r')) start++;
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    size_t n = (size_t)(end - start);
+    return (n == 3 && strncmp(start, "Int", 3) == 0) ||
+        (n == 4 && strncmp(start, "Bool", 4) == 0) ||
+        (n == 4 && strncmp(start, "Char", 4) == 0);
+}
+
+char *lower_struct_field_line(const char *line) {
+    const char *s = skip_ws(line);
+    if (!is_ident_start(*s)) return strdup(line);
+    const char *name_start = s;
+    const char *p = s + 1;
+    while (is_ident_continue(*p)) p++;
+    const char *after_name = skip_ws(p);
+    if (*after_name != ':') return strdup(line);
+    const char *q = after_name + 1;
+    int saw_type = 0;
+    while (*q != '\0' && *q != ',') {
+        if (*q != ' ' && *q != '\t' && *q != '\r') saw_type = 1;
+        q++;
+    }
+    if (!saw_type) return strdup(line);
+    if (*q == ',') {
+        const char *rest = skip_ws(q + 1);
+        if (*rest != '\0') return strdup(line);
+    }
+    if (!should_strip_struct_field_type(after_name + 1, q)) return strdup(line);
+    StrBuf out;
+    sb_init(&out);
+    sb_append_n(&out, line, (size_t)(name_start - line));
+    sb_append_n(&out, name_start, (size_t)(p - name_start));
+    if (*q == ',') sb_append(&out, ",");
+    return out.data;
+}
+
+static int append_lowered_struct_part(StrBuf *out, const char *start, const char *end) {
+    while (start < end && (*start == ' ' || *start == '\t' || *start == '\r')) start++;
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    if (start >= end) return 0;
+    const char *p = start;
+    if (!is_ident_start(*p)) {
+        sb_append_n(out, start, (size_t)(end - start));
+        return 0;
+    }
+    p++;
+    while (p < end && is_ident_continue(*p)) p++;
+    const char *after_name = skip_ws(p);
+    if (after_name >= end || *after_name != ':') {
+        sb_append_n(out, start, (size_t)(end - start));
+        return 0;
+    }
+    const char *type_start = skip_ws(after_name + 1);
+    if (type_start >= end) {
+        sb_append_n(out, start, (size_t)(end - start));
+        return 0;
+    }
+    if (!should_strip_struct_field_type(type_start, end)) {
+        sb_append_n(out, start, (size_t)(end - start));
+        return 0;
+    }
+    sb_append_n(out, start, (size_t)(p - start));
+    return 1;
+}
+
+char *lower_struct_one_line_fields(const char *line) {
+    const char *trim = skip_ws(line);
+    if (!starts_with(trim, "struct ")) return strdup(line);
+    const char *open = strchr(trim, '{');
+    const char *close = open == NULL ? NULL : strchr(open + 1, '}');
+    if (open == NULL || close == NULL) return strdup(line);
+
+    StrBuf body;
+    sb_init(&body);
+    int changed = 0;
+    int first = 1;
+    const char *part_start = open + 1;
+    int depth = 0;
+    char delim = '\0';
+    int escaped = 0;
+    for (const char *p = open + 1; p <= close; p++) {
+        char ch = *p;
+        if (p < close) {
+            if (escaped) {
+                escaped = 0;
+                continue;
+            }
+            if (delim == '"' && ch == '\\') {
+                escaped = 1;
+                continue;
+            }
+            if (ch == '"' || ch == '`') {
+                if (delim == '\0') delim = ch;
+                else if (delim == ch) delim = '\0';
+                continue;
+            }
+            if (delim == '\0') {
+                if (ch == '(' || ch == '[' || ch == '{' || ch == '<') depth++;
+                else if (ch == ')' || ch == ']' || ch == '}' || ch == '>') depth--;
+            }
+        }
+        if ((p == close || (ch == ',' && depth == 0 && delim == '\0'))) {
+            if (!first) sb_append(&body, ", ");
+            changed |= append_lowered_struct_part(&body, part_start, p);
+            first = 0;
+            part_start = p + 1;
+        }
+    }
+    if (!changed) {
+        free(body.data);
+        return strdup(line);
+    }
+
+    StrBuf out;
+    sb_init(&out);
+    sb_append_n(&out, line, (size_t)(open + 1 - line));
+    sb_append(&out, body.data);
+    sb_append(&out, close);
+    free(body.data);
+    return out.data;
+}
+
+char *replace_print_token(const char *line) {
+    StrBuf out;
+    sb_init(&out);
+    int in_dquote = 0;
+    int in_backtick = 0;
+    int escaped = 0;
+    for (size_t i = 0; line[i] != '\0';) {
+        if (!in_dquote && !in_backtick && strncmp(line + i, "print", 5) == 0) {
+            int before_ok = i == 0 || !is_ident_continue(line[i - 1]);
+            const char *after_name = line + i + 5;
+            const char *after_ws = skip_ws(after_name);
+            if (before_ok && *after_ws == '(') {
+                sb_append(&out, "puts(");
+                i = (size_t)(after_ws - line) + 1;
+                continue;
+            }
+        }
+
+        char c = line[i];
+        sb_append_n(&out, line + i, 1);
+        if (escaped) {
+            escaped = 0;
+        } else if (in_dquote && c == '\\') {
+            escaped = 1;
+        } else if (!in_backtick && c == '"') {
+            in_dquote = !in_dquote;
+        } else if (!in_dquote && c == '`') {
+            in_backtick = !in_backtick;
+        }
+        i++;
+    }
+    return out.data;
+}